@@ -9,10 +9,13 @@
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <utility>
 
 #include "vpl/preview/defs.hpp"
 #include "vpl/preview/exception.hpp"
+#include "vpl/preview/extension_buffer_list.hpp"
+#include "vpl/preview/stat.hpp"
 
 #include "vpl/preview/detail/sdk_callable.hpp"
 #include "vpl/preview/detail/string_helpers.hpp"
@@ -208,7 +211,14 @@ public:
 class bitstream_as_dst : public bitstream {
 public:
     /// @brief Default ctor
-    bitstream_as_dst() : bitstream(), sp_(nullptr), session_(nullptr), valid_(false) {}
+    bitstream_as_dst()
+            : bitstream(),
+              sp_(nullptr),
+              session_(nullptr),
+              valid_(false),
+              probe_(),
+              ctrl_(),
+              ctrl_list_() {}
     /// @brief Constructs bitstream object with given codec ID and given buffer length
     /// @param[in] codecID codec's fourCC code
     /// @param[in] buffersize circular buffer size in bytes
@@ -216,7 +226,10 @@ public:
             : bitstream(codecID, buffersize),
               sp_(nullptr),
               session_(nullptr),
-              valid_(false) {}
+              valid_(false),
+              probe_(),
+              ctrl_(),
+              ctrl_list_() {}
 
     /// @brief Indefinitely waits for operation completion.
     void wait() {
@@ -227,9 +240,46 @@ public:
                                   sp_,
                                   MFX_INFINITE);
             valid_ = true;
+            probe_.fire();
         }
     }
 
+    /// @brief Drops the data and sync context, so the object can be reused for the next operation.
+    /// Internal buffer is kept, as well as the storage of the extension buffers list.
+    void recycle() {
+        reset();
+        sp_      = nullptr;
+        session_ = nullptr;
+        valid_   = false;
+        probe_.disarm();
+        ctrl_ = {};
+    }
+
+    /// @brief Fills the encode control of the frame producing this bitstream. Control and the copy of the list are
+    /// owned by the bitstream, so every frame in flight has its own ones, valid until the bitstream is recycled.
+    /// The extension buffers themselves aren't copied and must outlive the operation.
+    /// @param[in] list Frozen list of the extension buffers. Storage of the previous copy is reused, so the copy
+    /// doesn't allocate once the bitstream has seen a list of the same size.
+    /// @return Pointer to the encode control.
+    mfxEncodeCtrl* attach_encode_ctrl(const encoder_process_list& list) {
+        ctrl_list_           = list;
+        auto [buffers, size] = ctrl_list_.get_raw_ext_buffers();
+        ctrl_.NumExtParam    = static_cast<uint16_t>(size);
+        ctrl_.ExtParam       = buffers;
+        return &ctrl_;
+    }
+
+    /// @brief Enables accounting of the submission to synchronization latency of the operation producing this
+    /// bitstream.
+    /// @param[in] stat Timing statistic to account the operation in.
+    /// @param[in] submitted Time of the operation submission.
+    /// @param[in] queued Time when the submitting call returned.
+    void track_sync(const std::shared_ptr<timing_stat>& stat,
+                    timing_stat::clock::time_point submitted,
+                    timing_stat::clock::time_point queued) {
+        probe_.arm(stat, submitted, queued);
+    }
+
     /// @brief Temporal method to assotiate externally allocated surface with sync point generated
     /// by the processing function.
     /// @param[in] context Pair of session handle and sync point.
@@ -272,6 +322,7 @@ public:
         switch (e.sts_) {
             case MFX_ERR_NONE:
                 surf_sts = async_op_status::ready;
+                probe_.fire();
                 break;
             case MFX_WRN_IN_EXECUTION:
                 surf_sts = async_op_status::timeout;
@@ -295,6 +346,12 @@ protected:
     mfxSession session_;
     /// @todo Remove it nafik.
     bool valid_;
+    /// Latency probe of the operation producing the bitstream. Fired from const wait_for().
+    mutable detail::sync_probe probe_;
+    /// Encode control of the frame producing the bitstream
+    mfxEncodeCtrl ctrl_;
+    /// Copy of the extension buffers list, which holds the array of pointers referenced by the encode control
+    encoder_process_list ctrl_list_;
 };
 
 } // namespace vpl
@@ -0,0 +1,199 @@
+/*############################################################################
+  # Copyright Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace oneapi {
+namespace vpl {
+namespace detail {
+
+/// @brief Pool of the reusable objects handed out as std::shared_ptr. When last owner drops the object it is
+/// recycled and returned to the pool instead of deletion. Control blocks of the shared pointers are allocated from the
+/// free list owned by the pool, so once the pool is warmed up acquire/release cycle doesn't touch the heap.
+/// @tparam T Type of the pooled object. Must be default constructible and provide recycle() method, which drops
+/// all per-use state of the object.
+template <typename T>
+class object_pool {
+protected:
+    /// @brief Pool's state shared with the handed out objects, so objects can outlive the pool's owner.
+    struct storage {
+        storage() : lock(), objects(), blocks(nullptr), block_size(0), closed(false) {}
+
+        ~storage() {
+            for (auto object : objects) {
+                delete object;
+            }
+            while (blocks) {
+                void *next = *static_cast<void **>(blocks);
+                ::operator delete(blocks);
+                blocks = next;
+            }
+        }
+
+        /// @brief Takes object from the free list.
+        /// @return Pointer to the object or nullptr if free list is empty.
+        T *pop() {
+            std::lock_guard<std::mutex> guard(lock);
+            if (objects.empty())
+                return nullptr;
+            T *object = objects.back();
+            objects.pop_back();
+            return object;
+        }
+
+        /// @brief Recycles the object and puts it back to the free list. Object is deleted if the pool is closed.
+        /// @param[in] object Pointer to the object.
+        void push(T *object) {
+            object->recycle();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!closed) {
+                    objects.push_back(object);
+                    return;
+                }
+            }
+            delete object;
+        }
+
+        /// @brief Returns memory block of given size for the shared pointer's control block.
+        /// @param[in] size Size of the block in bytes.
+        /// @return Pointer to the memory block.
+        void *get_block(std::size_t size) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (size == block_size && blocks) {
+                    void *block = blocks;
+                    blocks      = *static_cast<void **>(block);
+                    return block;
+                }
+                if (!block_size && size >= sizeof(void *))
+                    block_size = size;
+            }
+            return ::operator new(size);
+        }
+
+        /// @brief Returns memory block to the free list.
+        /// @param[in] block Pointer to the memory block.
+        /// @param[in] size Size of the block in bytes.
+        void put_block(void *block, std::size_t size) {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (size == block_size) {
+                    *static_cast<void **>(block) = blocks;
+                    blocks                       = block;
+                    return;
+                }
+            }
+            ::operator delete(block);
+        }
+
+        /// @brief Deletes free objects and switches storage to the mode when returned objects are deleted.
+        void close() {
+            std::vector<T *> tmp;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                closed = true;
+                tmp.swap(objects);
+            }
+            // Objects are deleted outside of the lock: their dtors may return control blocks to the storage.
+            for (auto object : tmp) {
+                delete object;
+            }
+        }
+
+        /// Storage guard.
+        std::mutex lock;
+        /// Free objects.
+        std::vector<T *> objects;
+        /// Intrusive list of free control blocks.
+        void *blocks;
+        /// Size of the control block. Blocks of other sizes are not cached.
+        std::size_t block_size;
+        /// Flag indicating that pool's owner is gone.
+        bool closed;
+    };
+
+    /// @brief Returns object to the storage when last shared pointer is released.
+    struct recycler {
+        void operator()(T *object) const {
+            pool->push(object);
+        }
+        /// Storage to return object to.
+        std::shared_ptr<storage> pool;
+    };
+
+    /// @brief Allocator of the shared pointer's control blocks.
+    template <typename U>
+    struct block_allocator {
+        using value_type = U;
+
+        explicit block_allocator(std::shared_ptr<storage> s) : pool(std::move(s)) {}
+        template <typename V>
+        block_allocator(const block_allocator<V> &other) : pool(other.pool) {}
+
+        U *allocate(std::size_t n) {
+            return static_cast<U *>(pool->get_block(n * sizeof(U)));
+        }
+        void deallocate(U *p, std::size_t n) {
+            pool->put_block(p, n * sizeof(U));
+        }
+
+        template <typename V>
+        bool operator==(const block_allocator<V> &other) const {
+            return pool == other.pool;
+        }
+        template <typename V>
+        bool operator!=(const block_allocator<V> &other) const {
+            return pool != other.pool;
+        }
+
+        /// Storage to take blocks from.
+        std::shared_ptr<storage> pool;
+    };
+
+public:
+    /// @brief Default ctor
+    object_pool() : storage_(std::make_shared<storage>()) {}
+
+    object_pool(const object_pool &) = delete;
+    object_pool &operator=(const object_pool &) = delete;
+
+    /// @brief Dtor. Free objects are deleted, objects which are still in use are deleted once released.
+    ~object_pool() {
+        storage_->close();
+    }
+
+    /// @brief Returns object from the pool. New object is created if the pool is empty.
+    /// @return Shared pointer to the object.
+    std::shared_ptr<T> acquire() {
+        T *object = storage_->pop();
+        if (!object)
+            object = new T();
+        return std::shared_ptr<T>(object, recycler{ storage_ }, block_allocator<T>(storage_));
+    }
+
+    /// @brief Returns number of objects in the pool ready for the reuse.
+    /// @return Number of free objects.
+    std::size_t get_free_count() const {
+        std::lock_guard<std::mutex> guard(storage_->lock);
+        return storage_->objects.size();
+    }
+
+protected:
+    /// Pool's state.
+    std::shared_ptr<storage> storage_;
+};
+
+} // namespace detail
+} // namespace vpl
+} // namespace oneapi
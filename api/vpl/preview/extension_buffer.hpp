@@ -767,6 +767,30 @@ public:
         this->buffer_.BlockSize = other.buffer_.BlockSize;
     }
 
+    /// @brief Returns number of elements in the QP array.
+    /// @return Number of elements.
+    uint32_t get_NumQPAlloc() const {
+        return buffer_.NumQPAlloc;
+    }
+
+    /// @brief Returns QP array for in place update between the frames.
+    /// @return Pointer to the QP array or nullptr if buffer holds values of the other mode.
+    uint8_t* get_QP() {
+        return (buffer_.Mode == MFX_MBQP_MODE_QP_VALUE) ? buffer_.QP : nullptr;
+    }
+
+    /// @brief Returns delta QP array for in place update between the frames.
+    /// @return Pointer to the delta QP array or nullptr if buffer holds values of the other mode.
+    mfxI8* get_DeltaQP() {
+        return (buffer_.Mode == MFX_MBQP_MODE_QP_DELTA) ? buffer_.DeltaQP : nullptr;
+    }
+
+    /// @brief Returns QP mode array for in place update between the frames.
+    /// @return Pointer to the QP mode array or nullptr if buffer holds values of the other mode.
+    mfxQPandMode* get_QPmode() {
+        return (buffer_.Mode == MFX_MBQP_MODE_QP_ADAPTIVE) ? buffer_.QPmode : nullptr;
+    }
+
     /// @brief Dtor
     ~ExtMBQP() {
         if (this->buffer_.Mode == MFX_MBQP_MODE_QP_VALUE)
@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <exception>
 #include <map>
+#include <utility>
 #include <vector>
 
 #include "vpl/preview/extension_buffer.hpp"
@@ -21,27 +23,39 @@ static constexpr uint32_t ignore_ID_list[IGNORE_LIST_LEN] = { 0, MFX_EXTBUFF_VPP
 /// @brief Base class to replerent list of extension buffers.
 /// Buffer pointers are stored as a map, so a single occurance of the same
 /// extension buffer is possible.
+/// List can be frozen for the repeated processing calls: array of pointers to the extension buffers is built once
+/// and reused by every call, while fields of the buffers can still be updated in place between the calls.
 class buffer_list {
 public:
     /// @brief default ctor
-    buffer_list() : extBuffers_() , mfxBuffers_(0) {}
-
-    buffer_list(const buffer_list& other) : extBuffers_(other.extBuffers_), mfxBuffers_(0){}
-    buffer_list& operator=(const buffer_list& other){
-        if(mfxBuffers_ != other.mfxBuffers_){
-            if(mfxBuffers_){
-                delete[] mfxBuffers_;
-                mfxBuffers_ = nullptr;
-            }
+    buffer_list() : extBuffers_(), mfxBuffers_(), frozen_(false) {}
+
+    /// @brief Copy ctor. Copy of the frozen list is frozen as well.
+    /// @param[in] other another object to use as data source
+    buffer_list(const buffer_list& other)
+            : extBuffers_(other.extBuffers_),
+              mfxBuffers_(),
+              frozen_(other.frozen_) {
+        if (frozen_)
+            build_raw_ext_buffers();
+    }
+
+    /// @brief Copy operator. Copy of the frozen list is frozen as well.
+    /// @param[in] other another object to use as data source
+    /// @return Reference to this object
+    buffer_list& operator=(const buffer_list& other) {
+        if (this != &other) {
             extBuffers_ = other.extBuffers_;
+            frozen_     = other.frozen_;
+            mfxBuffers_.clear();
+            if (frozen_)
+                build_raw_ext_buffers();
         }
         return *this;
-    }	
+    }
 
     /// @brief dtor
-    virtual ~buffer_list() {
-        delete[] mfxBuffers_;
-    }
+    virtual ~buffer_list() {}
 
     /// @brief returns reference to the map with extension buffers. Key is buffer ID in the form of FourCC codes
     /// value is the pointer to the extension buffer.
@@ -58,6 +72,8 @@ public:
     /// @brief adds extension buffer pointer to the map
     /// @param[in] o pointer to the extension buffer
     void add_buffer(extension_buffer_base* o) {
+        if (frozen_)
+            throw base_exception("Can't add buffer to the frozen list", MFX_ERR_UNDEFINED_BEHAVIOR);
         // extBuffers_.insert(std::pair<uint32_t,eb>(o.get_ID(),o)); // this is language hack. ref can't be in the std::map
         extBuffers_[o->get_ID()] = o;
     }
@@ -66,7 +82,7 @@ public:
     /// @tparam ID extension buffer ID in the form of FourCC code.
     /// @return true if buffer exists in the map.
     template <uint32_t ID>
-    bool has_buffer() {
+    bool has_buffer() const {
         if (extBuffers_.find(ID) != extBuffers_.end())
             return true;
         return false;
@@ -75,7 +91,7 @@ public:
     /// @brief verifies that map contains given key (extension buffer)
     /// @tparam ID extension buffer ID in the form of FourCC code.
     /// @return true if buffer exists in the map.
-    bool has_buffer(uint32_t ID) {
+    bool has_buffer(uint32_t ID) const {
         if (extBuffers_.find(ID) != extBuffers_.end())
             return true;
         return false;
@@ -107,21 +123,39 @@ public:
         return nullptr;
     }
 
-    /// @brief returns pair of array of pointers to the extension buffer and number of buffers
-    /// @return pair of array of pointers to the extension buffer and number of buffers
-    /// @todo output unique_ptr instead of pointer to the member variable
-    auto get_raw_ext_buffers() {
-        uint32_t ignoreNum = 0;
+    /// @brief Freezes the list. Array of pointers to the extension buffers is built once and returned by every
+    /// subsequent get_raw_ext_buffers() call without rebuild. Buffers can't be added to the frozen list, but their
+    /// fields can be updated in place, e.g. per-frame ROI or QP map.
+    void freeze() {
+        build_raw_ext_buffers();
+        frozen_ = true;
+    }
 
-        std::for_each(ignore_ID_list, ignore_ID_list + IGNORE_LIST_LEN, [&](uint32_t id) {
-            if (has_buffer(id))
-                ignoreNum++;
-        });
+    /// @brief Unfreezes the list, so buffers can be added again.
+    void unfreeze() {
+        frozen_ = false;
+    }
 
-        delete[] mfxBuffers_;
-        mfxBuffers_ = new mfxExtBuffer*[extBuffers_.size() - ignoreNum];
-        int i       = 0;
+    /// @brief Checks if list is frozen.
+    /// @return true if list is frozen.
+    bool is_frozen() const {
+        return frozen_;
+    }
 
+    /// @brief returns pair of array of pointers to the extension buffer and number of buffers. Array is owned by
+    /// the list and stays valid till the next call or list's modification.
+    /// @return pair of array of pointers to the extension buffer and number of buffers
+    std::pair<mfxExtBuffer**, std::size_t> get_raw_ext_buffers() const {
+        if (!frozen_)
+            build_raw_ext_buffers();
+        return std::pair(mfxBuffers_.data(), mfxBuffers_.size());
+    }
+
+protected:
+    /// @brief Fills array of pointers to the extension buffers. Storage is reused, so once array reached its size
+    /// no allocation happens.
+    void build_raw_ext_buffers() const {
+        mfxBuffers_.clear();
         for (const auto& buf : extBuffers_) {
             auto& id           = buf.first;
             auto& value        = buf.second;
@@ -132,19 +166,18 @@ public:
                                              });
             if (exists_ignore)
                 continue;
-            mfxBuffers_[i] = value->get_ptr();
-            i++;
+            mfxBuffers_.push_back(value->get_ptr());
         }
-        return std::pair(mfxBuffers_, extBuffers_.size() - ignoreNum);
     }
 
-protected:
     /// Map of extension buffers with key equal to the buffer ID
     /// @tparam extension_buffer_base* pointer to the extension buffer class.
     /// @tparam uint32_t extension buffer ID in the form of FourCC code.
     std::map<uint32_t, extension_buffer_base*> extBuffers_;
-    /// @todo remove
-    mfxExtBuffer** mfxBuffers_;
+    /// Array of pointers to the extension buffers passed to the C API.
+    mutable std::vector<mfxExtBuffer*> mfxBuffers_;
+    /// Flag indicating that array of pointers is built and must not be rebuilt.
+    bool frozen_;
 };
 
 /// @brief This class hold list of extension buffers used during decoder's initialization stage
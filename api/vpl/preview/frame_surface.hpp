@@ -15,6 +15,7 @@
 
 #include "vpl/preview/defs.hpp"
 #include "vpl/preview/exception.hpp"
+#include "vpl/preview/stat.hpp"
 #include "vpl/preview/video_param.hpp"
 
 #include "vpl/preview/detail/sdk_callable.hpp"
@@ -27,7 +28,7 @@ namespace vpl {
 class frame_surface : public std::enable_shared_from_this<frame_surface> {
 public:
     /// @brief Default dtor
-    frame_surface() : surface_(nullptr), lazy_sync_(false) {}
+    frame_surface() : surface_(nullptr), lazy_sync_(false), map_count_(0), probe_() {}
 
     /// @brief Creates object on top of mfxFrameSurface1 object.
     /// Increments mfxFrameSurface1 reference counter value.
@@ -36,7 +37,9 @@ public:
     /// @todo Remove flag with API 2.1 support
     explicit frame_surface(mfxFrameSurface1* surface, bool lazy_sync = false)
             : surface_(surface),
-              lazy_sync_(lazy_sync) {
+              lazy_sync_(lazy_sync),
+              map_count_(0),
+              probe_() {
         detail::c_api_invoker(detail::default_checker,
                                 surface_->FrameInterface->AddRef,
                                 surface_);
@@ -45,7 +48,7 @@ public:
     /// @brief Copy ctor.
     /// Increments mfxFrameSurface1 reference counter value.
     /// @param[in] other another object to use as data source
-    frame_surface(const frame_surface& other) {
+    frame_surface(const frame_surface& other) : map_count_(0) {
         surface_   = other.surface_;
         lazy_sync_ = other.lazy_sync_;
         detail::c_api_invoker(detail::default_checker,
@@ -56,7 +59,7 @@ public:
     /// @brief Move ctor.
     /// mfxFrameSurface1 reference counter value isn't incremented
     /// @param[in] other another object to use as data source
-    frame_surface(frame_surface&& other) {
+    frame_surface(frame_surface&& other) : map_count_(other.map_count_) {
         lazy_sync_ = other.lazy_sync_;
         surface_   = std::move(other.surface_);
     }
@@ -118,12 +121,38 @@ public:
         }
     }
 
+    /// @brief Releases mfxFrameSurface1 object and returns instance to the default state, so it can be reused
+    /// for another surface. Called by the deleter of the pooled shared pointer, so it doesn't throw: status of the
+    /// release is ignored.
+    void recycle() {
+        if (surface_) {
+            if (surface_->FrameInterface && surface_->FrameInterface->Release) {
+                (void)surface_->FrameInterface->Release(surface_);
+            }
+            surface_ = nullptr;
+        }
+        lazy_sync_ = false;
+        map_count_ = 0;
+        probe_.disarm();
+    }
+
+    /// @brief Enables accounting of the submission to synchronization latency of the operation producing this surface.
+    /// @param[in] stat Timing statistic to account the operation in.
+    /// @param[in] submitted Time of the operation submission.
+    /// @param[in] queued Time when the submitting call returned.
+    void track_sync(const std::shared_ptr<timing_stat>& stat,
+                    timing_stat::clock::time_point submitted,
+                    timing_stat::clock::time_point queued) {
+        probe_.arm(stat, submitted, queued);
+    }
+
     /// @brief Indefinetely wait for operation completion.
     void wait() {
         detail::c_api_invoker(detail::default_checker,
                                 surface_->FrameInterface->Synchronize,
                                 surface_,
                                 MFX_INFINITE);
+        probe_.fire();
     }
 
     /// @brief Waits for the operation completion. Waits for the result to become available. Blocks until specified
@@ -160,6 +189,7 @@ public:
         switch (e.sts_) {
             case MFX_ERR_NONE:
                 surf_sts = async_op_status::ready;
+                probe_.fire();
                 break;
             case MFX_WRN_IN_EXECUTION:
                 surf_sts = async_op_status::timeout;
@@ -191,6 +221,7 @@ public:
                                 surface_->FrameInterface->Map,
                                 surface_,
                                 (mfxMemoryFlags)flags);
+        map_count_++;
         return std::pair(frame_info(surface_->Info), frame_data(surface_->Data));
     }
 
@@ -203,12 +234,21 @@ public:
                                 surface_->FrameInterface->Map,
                                 surface_,
                                 (mfxMemoryFlags)flags);
+        map_count_++;
         return frame_data(surface_->Data);
     }
 
     /// @brief Unmaps data to the system memory.
     void unmap() {
         detail::c_api_invoker(detail::default_checker, surface_->FrameInterface->Unmap, surface_);
+        if (map_count_)
+            map_count_--;
+    }
+
+    /// @brief Tells whether the data is mapped to the system memory by map() or map_data() of this object.
+    /// @return True if the data is mapped.
+    bool is_mapped() const {
+        return map_count_ > 0;
     }
 
     /// @brief Provides native surface handle of the surface.
@@ -282,6 +322,10 @@ protected:
     mfxFrameSurface1* surface_;
     /// @brief Flag indicating that lazy sync technique must be used.
     bool lazy_sync_;
+    /// @brief Number of map() and map_data() calls not yet paired with unmap().
+    uint32_t map_count_;
+    /// @brief Latency probe of the operation producing the surface. Fired from const wait_for().
+    mutable detail::sync_probe probe_;
 };
 
 inline std::ostream& operator<<(std::ostream& out, const frame_surface& f) {
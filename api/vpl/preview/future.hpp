@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
-#include <deque>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -23,6 +25,9 @@ namespace vpl {
 /// processing (decode/encode/vpp)
 /// operation.
 struct operation_status {
+    /// @brief Default ctor. Initializes structure with values of unknown component.
+    operation_status() : operation_status(component::unknown, nullptr) {}
+
     /// @brief Ctor. Initializes structure with default values.
     /// @param[in] component Type of the component generated from the status.
     /// @param[in] owner Pointer to the component generated from this status.
@@ -58,6 +63,90 @@ inline std::ostream &operator<<(std::ostream &out, const operation_status &o) {
     return out;
 }
 
+/// @brief Processing history of the future object. Records are stored inline in the fixed size array, so
+/// history doesn't allocate memory. When capacity is exceeded, oldest records are dropped.
+class operation_history {
+public:
+    /// Max number of the records. Pipelines built with this API are not deeper than decode->vpp->encode.
+    static constexpr std::size_t max_depth = 8;
+
+    /// @brief Default ctor
+    operation_history() : records_(), size_(0) {}
+
+    /// @brief Checks if history is empty.
+    /// @return true if there are no records.
+    bool empty() const {
+        return 0 == size_;
+    }
+
+    /// @brief Returns number of the records.
+    /// @return Number of the records.
+    std::size_t size() const {
+        return size_;
+    }
+
+    /// @brief Returns the latest record.
+    /// @return Reference to the latest record.
+    const operation_status &back() const {
+        return records_[size_ - 1];
+    }
+
+    /// @brief Adds record as the latest one. The oldest record is dropped if history is full.
+    /// @param[in] op Operation's status
+    void push_back(const operation_status &op) {
+        if (size_ == max_depth) {
+            std::move(records_.begin() + 1, records_.end(), records_.begin());
+            size_--;
+        }
+        records_[size_++] = op;
+    }
+
+    /// @brief Adds record as the oldest one. Record is dropped if history is full.
+    /// @param[in] op Operation's status
+    void push_front(const operation_status &op) {
+        if (size_ == max_depth)
+            return;
+        std::move_backward(records_.begin(), records_.begin() + size_, records_.begin() + size_ + 1);
+        records_[0] = op;
+        size_++;
+    }
+
+    /// @brief Removes all records.
+    void clear() {
+        size_ = 0;
+    }
+
+    /// @brief Returns iterator to the oldest record.
+    /// @return Iterator to the oldest record.
+    const operation_status *begin() const {
+        return records_.data();
+    }
+
+    /// @brief Returns iterator past the latest record.
+    /// @return Iterator past the latest record.
+    const operation_status *end() const {
+        return records_.data() + size_;
+    }
+
+    /// @brief Returns reverse iterator to the latest record.
+    /// @return Reverse iterator to the latest record.
+    std::reverse_iterator<const operation_status *> rbegin() const {
+        return std::reverse_iterator<const operation_status *>(end());
+    }
+
+    /// @brief Returns reverse iterator past the oldest record.
+    /// @return Reverse iterator past the oldest record.
+    std::reverse_iterator<const operation_status *> rend() const {
+        return std::reverse_iterator<const operation_status *>(begin());
+    }
+
+protected:
+    /// Records storage
+    std::array<operation_status, max_depth> records_;
+    /// Number of valid records
+    std::size_t size_;
+};
+
 /// @brief This class represent future data container and used to glue processing of the individual components
 /// into the pipeline. Once component which is down in the pipeline recieved that object, it must use it to wait for
 /// the data. States of the data in this object:
@@ -74,10 +163,26 @@ template <typename data,
               std::is_base_of<std::shared_ptr<bitstream_as_dst>, data>::value>::type>
 class future {
 public:
-    /// @brief Default ctor
+    /// @brief Default ctor. Creates future object without data.
+    future() : data_(), fatal_happened_(false) {}
+
+    /// @brief Ctor
     /// @param[in] future_data Data object to take care about.
     explicit future(data future_data) : data_(future_data), fatal_happened_(false) {}
 
+    /// @brief Attaches data object to the future.
+    /// @param[in] future_data Data object to take care about.
+    void set_data(data future_data) {
+        data_ = future_data;
+    }
+
+    /// @brief Drops data and processing history, so the object can be reused for the next operation.
+    void recycle() {
+        data_ = data();
+        history_.clear();
+        fatal_happened_ = false;
+    }
+
     /// @brief Indefinitely waits for operation completion.
     void wait() {
         if (have_to_wait() && data_) {
@@ -150,7 +255,7 @@ public:
     }
 
     /// Processing history
-    std::deque<operation_status> history_;
+    operation_history history_;
 
 protected:
     /// @brief Checks if we need to wait for the data or skip the processing.
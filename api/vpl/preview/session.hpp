@@ -24,6 +24,7 @@
 
 #include "vpl/mfxvideo.h"
 
+#include "vpl/preview/detail/object_pool.hpp"
 #include "vpl/preview/detail/sdk_callable.hpp"
 
 #ifdef LIBVA_SUPPORT
@@ -58,6 +59,7 @@ protected:
             : c_api_callable_(callable),
               state_(state::Processing),
               component_(component::unknown),
+              timing_(std::make_shared<timing_stat>()),
               accelerator_handle(nullptr) {
         auto [l_, s_]  = sel.session();
         this->loader_  = l_;
@@ -172,6 +174,14 @@ public:
         return version_;
     }
 
+    /// @brief Retrieves client-side timing statistic of the session: submission to synchronization latency, CPU
+    /// and wall time per call, surface starvation count and output frame rate. Statistic is updated while
+    /// the session works.
+    /// @return Timing statistic
+    std::shared_ptr<timing_stat> getTimingStat() {
+        return timing_;
+    }
+
 protected:
     /// @brief Session handle.
     mfxSession session_;
@@ -181,6 +191,8 @@ protected:
     state state_;
     /// @brief Session's type identifier. Domain in other words
     component component_;
+    /// @brief Client-side timing statistic
+    std::shared_ptr<timing_stat> timing_;
 
     /// @brief Selected actual implementation
     mfxIMPL selected_impl_;
@@ -399,12 +411,14 @@ public:
 
     /// @brief Decodes frame
     /// @param[out] out_surface Future object with decoded data.
-    /// @param[in] list List of extension buffers to attach to bitstream.
+    /// @param[in] list List of extension buffers to attach to bitstream. Frozen list is attached without rebuild of
+    /// the pointers array.
     /// @return Ok or warning
     status decode_frame(std::shared_ptr<frame_surface> out_surface,
-                        decoder_process_list list = {}) {
+                        const decoder_process_list &list = {}) {
         mfxSyncPoint syncp;
         mfxFrameSurface1 *surf = NULL;
+        detail::call_timer timer(*timing_);
 
         rdr_->get_data(&bits_);
 
@@ -414,14 +428,14 @@ public:
             state_ = state::Draining;
         }
         else {
-            bts = bits_();
-            if (auto [buffers, size] = list.get_raw_ext_buffers(); size) {
-                bts->NumExtParam = static_cast<uint16_t>(size);
-                bts->ExtParam    = buffers;
-            }
-            else {
-                bts->NumExtParam = 0;
-                bts->ExtParam    = nullptr;
+            bts              = bits_();
+            bts->NumExtParam = 0;
+            bts->ExtParam    = nullptr;
+            if (list.get_size()) {
+                if (auto [buffers, size] = list.get_raw_ext_buffers(); size) {
+                    bts->NumExtParam = static_cast<uint16_t>(size);
+                    bts->ExtParam    = buffers;
+                }
             }
         }
 
@@ -444,13 +458,17 @@ public:
                                 nullptr,
                                 &surf,
                                 &syncp);
+        timer.stop(e.sts_ == MFX_ERR_NONE, e.sts_ == MFX_ERR_MORE_SURFACE || e.sts_ == MFX_WRN_DEVICE_BUSY);
 
         if (surf) {
             // out_surface = std::make_shared<frame_surface>(surf);
             // out_surface.reset(new frame_surface(surf));
             // std::shared_ptr<frame_surface> tmp = std::make_shared<frame_surface>(surf);
             // out_surface.swap(tmp);
-            out_surface->inject(surf, out_surface.use_count() + 1);
+            // reference of the output surface is given to the caller by the runtime
+            out_surface->inject(surf, 0);
+            if (e.sts_ == MFX_ERR_NONE)
+                out_surface->track_sync(timing_, timer.get_start_time(), timer.get_stop_time());
         }
 
         if (e.sts_ == MFX_ERR_MORE_DATA && state_ == state::Draining) {
@@ -460,31 +478,30 @@ public:
         return mfxstatus_to_onevplstatus(e.sts_);
     }
 
-    /// @brief Decodes frame
+    /// @brief Decodes frame. Surface and future objects are taken from the session's pools and returned back
+    /// once released by the user.
     /// @param[in] list List of extension buffers to attach to bitstream
     /// @return Future object with decoded data
     std::shared_ptr<future<std::shared_ptr<frame_surface>>> process(
-        decoder_process_list list = {}) {
-        std::shared_ptr<frame_surface> surface = std::make_shared<frame_surface>();
-        std::shared_ptr<future_surface_t> f;
+        const decoder_process_list &list = {}) {
+        std::shared_ptr<future_surface_t> f = futures_.acquire();
 
         operation_status op(component_, this);
 
         if (state_ != state::Done) {
             try {
+                std::shared_ptr<frame_surface> surface = surfaces_.acquire();
                 status schedule_status;
                 schedule_status     = decode_frame(surface, list);
-                f                   = std::make_shared<future_surface_t>(surface);
+                f->set_data(surface);
                 op.schedule_status_ = schedule_status;
             }
             catch (base_exception &e) {
-                f                   = std::make_shared<future_surface_t>(nullptr);
                 op.schedule_status_ = mfxstatus_to_onevplstatus(e.get_status());
                 op.fatal_           = true;
             }
         }
         else {
-            f                   = std::make_shared<future_surface_t>(nullptr);
             op.schedule_status_ = status::EndOfStreamReached;
         }
 
@@ -518,6 +535,10 @@ protected:
     decoder_video_param params_;
     /// @brief Process list
     decoder_process_list list_;
+    /// @brief Pool of the output surfaces
+    detail::object_pool<frame_surface> surfaces_;
+    /// @brief Pool of the future objects
+    detail::object_pool<future_surface_t> futures_;
 };
 
 /// @brief Manages encoder's sessions.
@@ -554,7 +575,9 @@ public:
                                 session_,
                                 &surface);
 
-        return std::make_shared<frame_surface>(surface);
+        std::shared_ptr<frame_surface> input = inputs_.acquire();
+        input->inject(surface, 1);
+        return input;
     }
 
     /// @brief Temporal method to sync the surface's data.
@@ -573,17 +596,28 @@ public:
     /// @brief Encodes frame
     /// @param[in] in_surface Object with the data to encode.
     /// @param[out] bs Future object with bitstream portion.
-    /// @param[in] list List of extension buffers to use
+    /// @param[in] list Frozen list of extension buffers to attach to the encode control. The list is copied into the
+    /// @p bs object together with the encode control, so it can be dropped right after the call. Buffers themselves
+    /// aren't copied: they must be alive and not modified until the frame is synchronized, so frames in flight with
+    /// different controls need separate buffers. Per-frame controls (ROI, QP map) can be updated in place.
     /// @return Ok or warning
     status encode_frame(std::shared_ptr<frame_surface> in_surface,
                         std::shared_ptr<bitstream_as_dst> bs,
-                        encoder_process_list list = {}) {
+                        const encoder_process_list &list = {}) {
         mfxSyncPoint sp;
         mfxFrameSurface1 *surf = in_surface.get() ? in_surface.get()->get_raw_ptr() : nullptr;
+        mfxEncodeCtrl *ctrl    = nullptr;
+        detail::call_timer timer(*timing_);
 
         if (nullptr == surf) {
             state_ = state::Draining;
         }
+        if (list.get_size()) {
+            if (!list.is_frozen())
+                throw base_exception("Extension buffers list of the encoded frame must be frozen",
+                                     MFX_ERR_UNDEFINED_BEHAVIOR);
+            ctrl = bs->attach_encode_ctrl(list);
+        }
         detail::c_api_invoker e({ [](mfxStatus s) {
                                     switch (s) {
                                         case MFX_ERR_MORE_DATA:
@@ -599,11 +633,14 @@ public:
                                 } },
                                 MFXVideoENCODE_EncodeFrameAsync,
                                 session_,
-                                nullptr,
+                                ctrl,
                                 surf,
                                 (*bs.get())(),
                                 &sp);
         bs->associate_context({ session_, sp });
+        timer.stop(e.sts_ == MFX_ERR_NONE, e.sts_ == MFX_WRN_DEVICE_BUSY);
+        if (e.sts_ == MFX_ERR_NONE)
+            bs->track_sync(timing_, timer.get_start_time(), timer.get_stop_time());
 
         if (e.sts_ == MFX_ERR_MORE_DATA && state_ == state::Draining) {
             state_ = state::Done;
@@ -615,9 +652,9 @@ public:
 
     /// @brief Encodes frame by using provided source reader to get data to encode
     /// @param[out] bs Future object with bitstream portion.
-    /// @param[in] list List of extension buffers to use
+    /// @param[in] list Frozen list of extension buffers to use
     /// @return Ok or warning
-    status encode_frame(std::shared_ptr<bitstream_as_dst> bs, encoder_process_list list = {}) {
+    status encode_frame(std::shared_ptr<bitstream_as_dst> bs, const encoder_process_list &list = {}) {
         status sts;
         if (!rdr_)
             throw base_exception("NULL reader ptr", MFX_ERR_NULL_PTR);
@@ -657,13 +694,13 @@ public:
     /// @brief Encode frame. Function returns the future object with the bitstream which will hold processed data. User
     /// needs to sync up the future object before accessing.
     /// This function expected to work in the chain and uses provided future object to get the data to process.
+    /// Bitstream and future objects are taken from the session's pools and returned back once released by the user.
     /// @param[in] in_future Future object with the surface from the previous operation.
-    /// @param[in] list List of extension buffers to use
+    /// @param[in] list Frozen list of extension buffers to use
     /// @return Future object with the bitstream.
     std::shared_ptr<future_bitstream_t> process(std::shared_ptr<future_surface_t> in_future,
-                                                encoder_process_list list = {}) {
-        std::shared_ptr<bitstream_as_dst> bits;
-        std::shared_ptr<future_bitstream_t> f_out = std::make_shared<future_bitstream_t>(nullptr);
+                                                const encoder_process_list &list = {}) {
+        std::shared_ptr<future_bitstream_t> f_out = futures_.acquire();
         operation_status op(component_, this);
 
         /// @todo add smart wait with status propagation
@@ -679,10 +716,9 @@ public:
                     try {
                         status schedule_status;
 
-                        bits            = std::make_shared<bitstream_as_dst>();
+                        std::shared_ptr<bitstream_as_dst> bits = bitstreams_.acquire();
                         schedule_status = encode_frame(in_surface, bits, list);
-                        f_out           = std::make_shared<future_bitstream_t>(bits);
-                        f_out.reset(new future_bitstream_t(bits));
+                        f_out->set_data(bits);
                         op.schedule_status_ = schedule_status;
                     }
                     catch (base_exception &e) {
@@ -717,6 +753,12 @@ public:
 protected:
     /// @brief Raw freames reader
     frame_source_reader *rdr_;
+    /// @brief Pool of the input surfaces
+    detail::object_pool<frame_surface> inputs_;
+    /// @brief Pool of the output bitstreams
+    detail::object_pool<bitstream_as_dst> bitstreams_;
+    /// @brief Pool of the future objects
+    detail::object_pool<future_bitstream_t> futures_;
 };
 
 /// @brief Manages VPP's sessions.
@@ -796,6 +838,7 @@ public:
                          std::shared_ptr<frame_surface> out_surface) {
         mfxSyncPoint sp;
         mfxFrameSurface1 *surf = in_surface.get() ? in_surface->get_raw_ptr() : nullptr;
+        detail::call_timer timer(*timing_);
 
         if (nullptr == surf) {
             state_ = state::Draining;
@@ -821,8 +864,12 @@ public:
                                 nullptr,
                                 &sp);
 
+        timer.stop(e.sts_ == MFX_ERR_NONE, e.sts_ == MFX_ERR_MORE_SURFACE || e.sts_ == MFX_WRN_DEVICE_BUSY);
+
         if (out_surface) {
             out_surface->associate_context(session_, sp);
+            if (e.sts_ == MFX_ERR_NONE)
+                out_surface->track_sync(timing_, timer.get_start_time(), timer.get_stop_time());
         }
 
         if (e.sts_ == MFX_ERR_MORE_DATA && state_ == state::Draining) {
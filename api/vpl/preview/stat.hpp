@@ -6,7 +6,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#if !defined(_WIN32)
+    #include <time.h>
+#endif
+
 #include "vpl/mfxstructures.h"
 namespace oneapi {
 namespace vpl {
@@ -143,5 +158,489 @@ protected:
     mfxVPPStat stat_;
 };
 
+/// @brief Lock-free histogram of durations with fixed memory footprint. Each power of two range of values is split
+/// into 16 equal buckets, so relative error of the percentile estimation doesn't exceed 6.25%. Values are recorded
+/// in nanoseconds.
+class latency_histogram {
+public:
+    /// Number of bits used to split power of two range into buckets
+    static constexpr uint32_t sub_bucket_bits = 4;
+    /// Number of buckets in the power of two range
+    static constexpr uint32_t sub_bucket_count = 1u << sub_bucket_bits;
+    /// Total number of buckets
+    static constexpr uint32_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    /// @brief Default ctor
+    latency_histogram() : buckets_(), count_(0), sum_(0), min_(UINT64_MAX), max_(0) {
+        reset();
+    }
+
+    latency_histogram(const latency_histogram &) = delete;
+    latency_histogram &operator=(const latency_histogram &) = delete;
+
+    /// @brief Records the value. Safe to call from several threads.
+    /// @param[in] value Value in nanoseconds
+    void record(uint64_t value) {
+        buckets_[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t current = min_.load(std::memory_order_relaxed);
+        while (value < current &&
+               !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+        current = max_.load(std::memory_order_relaxed);
+        while (value > current &&
+               !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    /// @brief Records the duration.
+    /// @param[in] value Duration
+    template <class Rep, class Period>
+    void record(const std::chrono::duration<Rep, Period> &value) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+        record(static_cast<uint64_t>(ns > 0 ? ns : 0));
+    }
+
+    /// @brief Drops all recorded values.
+    void reset() {
+        for (auto &bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(UINT64_MAX, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves number of recorded values
+    /// @return Number of recorded values
+    uint64_t get_count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves sum of recorded values
+    /// @return Sum of recorded values in nanoseconds
+    uint64_t get_sum() const {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves minimal recorded value
+    /// @return Minimal value in nanoseconds or 0 if nothing is recorded
+    uint64_t get_min() const {
+        return get_count() ? min_.load(std::memory_order_relaxed) : 0;
+    }
+
+    /// @brief Retrieves maximal recorded value
+    /// @return Maximal value in nanoseconds
+    uint64_t get_max() const {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves mean of recorded values
+    /// @return Mean value in nanoseconds or 0 if nothing is recorded
+    double get_mean() const {
+        uint64_t count = get_count();
+        return count ? static_cast<double>(get_sum()) / count : 0.0;
+    }
+
+    /// @brief Estimates percentile of recorded values. Values recorded concurrently with the call may be partially
+    /// accounted.
+    /// @param[in] percentile Percentile in range [0, 100]
+    /// @return Upper bound of the bucket holding the percentile in nanoseconds or 0 if nothing is recorded
+    uint64_t get_percentile(double percentile) const {
+        uint64_t total = 0;
+        for (auto &bucket : buckets_) {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        if (!total)
+            return 0;
+
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t rank =
+            std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+        uint64_t accumulated = 0;
+        for (uint32_t i = 0; i < bucket_count; i++) {
+            accumulated += buckets_[i].load(std::memory_order_relaxed);
+            if (accumulated >= rank)
+                return std::min(get_bucket_upper_bound(i), get_max());
+        }
+        return get_max();
+    }
+
+    /// @brief Returns index of the bucket for the value
+    /// @param[in] value Value
+    /// @return Index of the bucket
+    static uint32_t get_bucket_index(uint64_t value) {
+        if (value < sub_bucket_count)
+            return static_cast<uint32_t>(value);
+        uint32_t exponent = get_log2(value);
+        uint32_t shift    = exponent - sub_bucket_bits;
+        return ((shift + 1) << sub_bucket_bits) +
+               static_cast<uint32_t>((value >> shift) & (sub_bucket_count - 1));
+    }
+
+    /// @brief Returns largest value which falls into the bucket
+    /// @param[in] index Index of the bucket
+    /// @return Upper bound of the bucket
+    static uint64_t get_bucket_upper_bound(uint32_t index) {
+        if (index < sub_bucket_count)
+            return index;
+        uint32_t shift = (index >> sub_bucket_bits) - 1;
+        uint64_t lower = static_cast<uint64_t>(sub_bucket_count + (index & (sub_bucket_count - 1)))
+                         << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+protected:
+    static uint32_t get_log2(uint64_t value) {
+        uint32_t result = 0;
+        for (uint32_t step = 32; step; step >>= 1) {
+            if (value >> step) {
+                value >>= step;
+                result += step;
+            }
+        }
+        return result;
+    }
+
+    /// Buckets' counters
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_;
+    /// Number of recorded values
+    std::atomic<uint64_t> count_;
+    /// Sum of recorded values
+    std::atomic<uint64_t> sum_;
+    /// Minimal recorded value
+    std::atomic<uint64_t> min_;
+    /// Maximal recorded value
+    std::atomic<uint64_t> max_;
+};
+
+/// @brief Lock-free meter of the events rate over sliding window. Time is split into 100ms slots, last 64 slots are
+/// kept, so window can be up to 6.3 seconds long.
+class frame_rate_meter {
+public:
+    /// Clock used for the measurements
+    using clock = std::chrono::steady_clock;
+    /// Number of slots kept
+    static constexpr uint32_t slot_count = 64;
+    /// Duration of the slot in milliseconds
+    static constexpr int64_t slot_duration_ms = 100;
+
+    /// @brief Default ctor
+    frame_rate_meter() : slots_() {
+        reset();
+    }
+
+    frame_rate_meter(const frame_rate_meter &) = delete;
+    frame_rate_meter &operator=(const frame_rate_meter &) = delete;
+
+    /// @brief Accounts event. Safe to call from several threads.
+    /// @param[in] now Time of the event
+    void tick(clock::time_point now = clock::now()) {
+        uint64_t slot              = get_slot(now);
+        std::atomic<uint64_t> &val = slots_[slot % slot_count];
+        uint64_t current           = val.load(std::memory_order_relaxed);
+        uint64_t next;
+        // Slot's epoch and counter are packed into the single word, so stale slot is reused atomically.
+        do {
+            if ((current >> count_bits) == (slot & epoch_mask))
+                next = current + 1;
+            else
+                next = ((slot & epoch_mask) << count_bits) | 1;
+        } while (!val.compare_exchange_weak(current, next, std::memory_order_relaxed));
+    }
+
+    /// @brief Drops all accounted events.
+    void reset() {
+        for (auto &slot : slots_) {
+            slot.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Retrieves events rate over the window of completed slots preceding now.
+    /// @param[in] window Window duration. Clamped to [100ms, 6300ms].
+    /// @param[in] now Current time
+    /// @return Number of events per second
+    double get_rate(std::chrono::milliseconds window, clock::time_point now = clock::now()) const {
+        int64_t n = window.count() / slot_duration_ms;
+        n         = std::min<int64_t>(std::max<int64_t>(n, 1), slot_count - 1);
+
+        uint64_t current = get_slot(now);
+        uint64_t events  = 0;
+        for (int64_t i = 1; i <= n; i++) {
+            uint64_t slot = current - i;
+            uint64_t val  = slots_[slot % slot_count].load(std::memory_order_relaxed);
+            if ((val >> count_bits) == (slot & epoch_mask))
+                events += val & count_mask;
+        }
+        return static_cast<double>(events) * 1000.0 / static_cast<double>(n * slot_duration_ms);
+    }
+
+protected:
+    static constexpr uint32_t count_bits = 24;
+    static constexpr uint64_t count_mask = (uint64_t(1) << count_bits) - 1;
+    static constexpr uint64_t epoch_mask = (uint64_t(1) << (64 - count_bits)) - 1;
+
+    static uint64_t get_slot(clock::time_point t) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count() /
+            slot_duration_ms);
+    }
+
+    /// Packed slots: epoch in the upper bits, events counter in the lower bits
+    std::array<std::atomic<uint64_t>, slot_count> slots_;
+};
+
+/// @brief Client-side timing statistic of the session. Unlike the run-time statistic it is collected by the session
+/// itself for every processing call and every synchronized output. All counters are lock-free, so statistic can be
+/// read while the session works.
+class timing_stat {
+public:
+    /// Clock used for the measurements
+    using clock = std::chrono::steady_clock;
+
+    /// @brief Default ctor
+    timing_stat()
+            : sync_latency_(),
+              queue_wait_(),
+              cpu_time_(),
+              call_latency_(),
+              output_rate_(),
+              starvation_count_(0) {}
+
+    timing_stat(const timing_stat &) = delete;
+    timing_stat &operator=(const timing_stat &) = delete;
+
+    /// @brief Accounts processing call.
+    /// @param[in] started Wall time when the call was started
+    /// @param[in] cpu_time CPU time consumed by the call
+    /// @param[in] accepted True if work was accepted by the implementation
+    /// @param[in] starved True if implementation lacked surfaces or device resources
+    /// @param[in] finished Wall time when the call returned
+    void record_call(clock::time_point started,
+                     std::chrono::nanoseconds cpu_time,
+                     bool accepted,
+                     bool starved,
+                     clock::time_point finished = clock::now()) {
+        cpu_time_.record(cpu_time);
+        if (accepted)
+            call_latency_.record(finished - started);
+        if (starved)
+            starvation_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// @brief Accounts synchronized output.
+    /// @param[in] submitted Wall time when the processing call submitting the operation was started
+    /// @param[in] queued Wall time when the call returned and the operation was queued in the implementation
+    void record_sync(clock::time_point submitted, clock::time_point queued) {
+        clock::time_point now = clock::now();
+        sync_latency_.record(now - submitted);
+        queue_wait_.record(now - queued);
+        output_rate_.tick(now);
+    }
+
+    /// @brief Drops all accounted data.
+    void reset() {
+        sync_latency_.reset();
+        queue_wait_.reset();
+        cpu_time_.reset();
+        call_latency_.reset();
+        output_rate_.reset();
+        starvation_count_.store(0, std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves histogram of the time from operation submission till its synchronization
+    /// @return Histogram
+    const latency_histogram &get_sync_latency() const {
+        return sync_latency_;
+    }
+
+    /// @brief Retrieves histogram of the time the operation spent in the implementation after the processing call
+    /// returned, till its synchronization. Together with the call latency it makes the sync latency.
+    /// @return Histogram
+    const latency_histogram &get_queue_wait() const {
+        return queue_wait_;
+    }
+
+    /// @brief Retrieves histogram of CPU time consumed by the calling thread per processing call
+    /// @return Histogram
+    const latency_histogram &get_cpu_time() const {
+        return cpu_time_;
+    }
+
+    /// @brief Retrieves histogram of the wall time of the processing calls which were accepted by the implementation,
+    /// from the call start till its return. It includes the time the implementation blocked the call, but not the
+    /// time the work waits in the implementation after the call returned, which is the queue wait.
+    /// @return Histogram
+    const latency_histogram &get_call_latency() const {
+        return call_latency_;
+    }
+
+    /// @brief Retrieves number of calls rejected due to lack of surfaces or device resources
+    /// @return Number of calls
+    uint64_t get_starvation_count() const {
+        return starvation_count_.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Retrieves rate of synchronized outputs over sliding window
+    /// @param[in] window Window duration
+    /// @return Frames per second
+    double get_frame_rate(std::chrono::milliseconds window = std::chrono::milliseconds(1000)) const {
+        return output_rate_.get_rate(window);
+    }
+
+    /// @brief Exports statistic in JSON format. Durations are in nanoseconds.
+    /// @return JSON string
+    std::string to_json() const {
+        std::ostringstream out;
+        out << "{\"sync_latency_ns\":";
+        dump(out, sync_latency_);
+        out << ",\"queue_wait_ns\":";
+        dump(out, queue_wait_);
+        out << ",\"cpu_time_ns\":";
+        dump(out, cpu_time_);
+        out << ",\"call_latency_ns\":";
+        dump(out, call_latency_);
+        out << ",\"starvation_count\":" << get_starvation_count();
+        out << ",\"fps\":{\"1s\":" << get_frame_rate(std::chrono::milliseconds(1000))
+            << ",\"5s\":" << get_frame_rate(std::chrono::milliseconds(5000)) << "}}";
+        return out.str();
+    }
+
+protected:
+    static void dump(std::ostream &out, const latency_histogram &h) {
+        out << "{\"count\":" << h.get_count() << ",\"min\":" << h.get_min()
+            << ",\"mean\":" << static_cast<uint64_t>(h.get_mean())
+            << ",\"p50\":" << h.get_percentile(50.0) << ",\"p90\":" << h.get_percentile(90.0)
+            << ",\"p99\":" << h.get_percentile(99.0) << ",\"p999\":" << h.get_percentile(99.9)
+            << ",\"max\":" << h.get_max() << "}";
+    }
+
+    /// Submission to synchronization latency
+    latency_histogram sync_latency_;
+    /// Time from the call return to synchronization
+    latency_histogram queue_wait_;
+    /// CPU time per call
+    latency_histogram cpu_time_;
+    /// Wall time of accepted calls
+    latency_histogram call_latency_;
+    /// Rate of synchronized outputs
+    frame_rate_meter output_rate_;
+    /// Number of calls rejected due to resources starvation
+    std::atomic<uint64_t> starvation_count_;
+};
+
+namespace detail {
+
+/// @brief Returns CPU time consumed by the calling thread. Falls back to the process CPU time where per-thread clock
+/// is not available.
+/// @return CPU time
+inline std::chrono::nanoseconds thread_cpu_time() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+        return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+    return std::chrono::nanoseconds(
+        static_cast<int64_t>(static_cast<double>(std::clock()) * 1e9 / CLOCKS_PER_SEC));
+}
+
+/// @brief Measures processing call of the session and accounts it in the timing statistic.
+class call_timer {
+public:
+    /// @brief Starts measurement
+    /// @param[in] stat Timing statistic to account the call in
+    explicit call_timer(timing_stat &stat)
+            : stat_(stat),
+              started_(timing_stat::clock::now()),
+              stopped_(started_),
+              cpu_started_(thread_cpu_time()) {}
+
+    /// @brief Finishes measurement
+    /// @param[in] accepted True if work was accepted by the implementation
+    /// @param[in] starved True if implementation lacked surfaces or device resources
+    void stop(bool accepted, bool starved) {
+        std::chrono::nanoseconds cpu_time = thread_cpu_time() - cpu_started_;
+        stopped_                          = timing_stat::clock::now();
+        stat_.record_call(started_, cpu_time, accepted, starved, stopped_);
+    }
+
+    /// @brief Returns time when the call was started
+    /// @return Time of the call start
+    timing_stat::clock::time_point get_start_time() const {
+        return started_;
+    }
+
+    /// @brief Returns time when the call returned
+    /// @return Time of the call return, or start if the measurement isn't finished
+    timing_stat::clock::time_point get_stop_time() const {
+        return stopped_;
+    }
+
+protected:
+    timing_stat &stat_;
+    timing_stat::clock::time_point started_;
+    timing_stat::clock::time_point stopped_;
+    std::chrono::nanoseconds cpu_started_;
+};
+
+/// @brief Accounts submission to synchronization latency of the single operation. Armed by the session when operation
+/// is submitted and fired by the data container when operation is synchronized for the first time. Probe may be
+/// armed, fired and disarmed from different threads, the operation is accounted at most once.
+class sync_probe {
+public:
+    /// @brief Default ctor
+    sync_probe() : lock_(), stat_(), submitted_(), queued_() {}
+
+    sync_probe(const sync_probe &) = delete;
+    sync_probe &operator=(const sync_probe &) = delete;
+
+    /// @brief Arms the probe
+    /// @param[in] stat Timing statistic to account the operation in
+    /// @param[in] submitted Time of the operation submission
+    /// @param[in] queued Time when the submitting call returned
+    void arm(const std::shared_ptr<timing_stat> &stat,
+             timing_stat::clock::time_point submitted,
+             timing_stat::clock::time_point queued) {
+        std::lock_guard<std::mutex> guard(lock_);
+        stat_      = stat;
+        submitted_ = submitted;
+        queued_    = queued;
+    }
+
+    /// @brief Accounts synchronization and disarms the probe
+    void fire() {
+        std::shared_ptr<timing_stat> stat;
+        timing_stat::clock::time_point submitted, queued;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!stat_)
+                return;
+            stat.swap(stat_);
+            submitted = submitted_;
+            queued    = queued_;
+        }
+        stat->record_sync(submitted, queued);
+    }
+
+    /// @brief Disarms the probe
+    void disarm() {
+        std::shared_ptr<timing_stat> stat;
+        std::lock_guard<std::mutex> guard(lock_);
+        // Statistic is released out of the lock.
+        stat.swap(stat_);
+    }
+
+protected:
+    std::mutex lock_;
+    std::shared_ptr<timing_stat> stat_;
+    timing_stat::clock::time_point submitted_;
+    timing_stat::clock::time_point queued_;
+};
+
+} // namespace detail
+
 } // namespace vpl
 } // namespace oneapi
@@ -7,6 +7,7 @@
 #include "vpl/mfx.h"
 
 #include "src/caps.h"
+#include "src/session.h"
 
 // the auto-generated capabilities structs
 // only include one time in this library
@@ -19,7 +20,7 @@ mfxStatus MFXInitialize(mfxInitializationParam par, mfxSession *session) {
     if (!session)
         return MFX_ERR_NULL_PTR;
 
-    *session = (mfxSession)0x01;
+    *session = (mfxSession) new StubSession();
 
     return MFX_ERR_NONE;
 }
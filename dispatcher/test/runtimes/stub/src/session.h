@@ -0,0 +1,52 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef DISPATCHER_TEST_RUNTIMES_STUB_SRC_SESSION_H_
+#define DISPATCHER_TEST_RUNTIMES_STUB_SRC_SESSION_H_
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "vpl/mfxvideo.h"
+
+// Minimal processing, enough to run decode and encode sessions of the preview API in the tests:
+// decoder returns a frame of its bounded pool for each portion of the bitstream, encoder copies the
+// extension buffers of the encode control into the bitstream. Tasks are executed when they are
+// synchronized, so the encode control has to stay valid until then, as with a real runtime.
+
+#define STUB_MAX_TASKS    256
+#define STUB_MAX_SURFACES 16
+
+struct StubSurface {
+    mfxFrameSurface1 surface;
+    mfxFrameSurfaceInterface iface;
+    std::atomic<mfxU32> refCount;
+};
+
+struct StubTask {
+    bool done;
+    mfxEncodeCtrl *ctrl;
+    mfxFrameSurface1 *input;
+    mfxBitstream *bs;
+};
+
+struct StubSession {
+    StubSession() : lock(), surfaces(), tasks(), nextTask(0), frameOrder(0) {}
+
+    std::mutex lock;
+    std::vector<StubSurface *> surfaces;
+    StubTask tasks[STUB_MAX_TASKS];
+    mfxU32 nextTask;
+    mfxU32 frameOrder;
+
+    ~StubSession() {
+        for (auto surface : surfaces)
+            delete surface;
+    }
+};
+
+#endif // DISPATCHER_TEST_RUNTIMES_STUB_SRC_SESSION_H_
@@ -4,8 +4,111 @@
   # SPDX-License-Identifier: MIT
   ############################################################################*/
 
+#include <stdint.h>
+#include <string.h>
+
 #include "vpl/mfx.h"
 
+#include "src/session.h"
+
+static StubSurface *GetStubSurface(mfxFrameSurface1 *surface) {
+    if (!surface || !surface->FrameInterface || !surface->FrameInterface->Context)
+        return nullptr;
+    return (StubSurface *)surface->FrameInterface->Context;
+}
+
+static mfxStatus StubAddRef(mfxFrameSurface1 *surface) {
+    StubSurface *stub = GetStubSurface(surface);
+    if (!stub)
+        return MFX_ERR_INVALID_HANDLE;
+    stub->refCount++;
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus StubRelease(mfxFrameSurface1 *surface) {
+    StubSurface *stub = GetStubSurface(surface);
+    if (!stub)
+        return MFX_ERR_INVALID_HANDLE;
+    mfxU32 count = stub->refCount.load();
+    do {
+        if (!count)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+    } while (!stub->refCount.compare_exchange_weak(count, count - 1));
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus StubGetRefCounter(mfxFrameSurface1 *surface, mfxU32 *counter) {
+    StubSurface *stub = GetStubSurface(surface);
+    if (!stub)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!counter)
+        return MFX_ERR_NULL_PTR;
+    *counter = stub->refCount.load();
+    return MFX_ERR_NONE;
+}
+
+static mfxStatus StubSynchronize(mfxFrameSurface1 *surface, mfxU32 wait) {
+    return GetStubSurface(surface) ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
+}
+
+// surface of the session's pool with a reference for the caller, pool grows only if all are in
+// use, so the surfaces which are never released exhaust it
+static mfxFrameSurface1 *GetFreeSurface(StubSession *stub) {
+    for (auto surface : stub->surfaces) {
+        mfxU32 count = 0;
+        if (surface->refCount.compare_exchange_strong(count, 1))
+            return &surface->surface;
+    }
+    if (stub->surfaces.size() == STUB_MAX_SURFACES)
+        return nullptr;
+
+    StubSurface *surface               = new StubSurface();
+    surface->iface.Context             = surface;
+    surface->iface.Version.Version     = MFX_FRAMESURFACEINTERFACE_VERSION;
+    surface->iface.AddRef              = StubAddRef;
+    surface->iface.Release             = StubRelease;
+    surface->iface.GetRefCounter       = StubGetRefCounter;
+    surface->iface.Synchronize         = StubSynchronize;
+    surface->surface.Version.Version   = MFX_FRAMESURFACE1_VERSION;
+    surface->surface.FrameInterface    = &surface->iface;
+    surface->surface.Info.FourCC       = MFX_FOURCC_I420;
+    surface->surface.Info.ChromaFormat = MFX_CHROMAFORMAT_YUV420;
+    surface->refCount                  = 1;
+    stub->surfaces.push_back(surface);
+    return &surface->surface;
+}
+
+static mfxSyncPoint AddTask(StubSession *stub,
+                            mfxEncodeCtrl *ctrl,
+                            mfxFrameSurface1 *input,
+                            mfxBitstream *bs) {
+    mfxU32 index   = stub->nextTask++ % STUB_MAX_TASKS;
+    StubTask &task = stub->tasks[index];
+    task.done      = !bs;
+    task.ctrl      = ctrl;
+    task.input     = input;
+    task.bs        = bs;
+    return (mfxSyncPoint)(uintptr_t)(index + 1);
+}
+
+static mfxStatus RunTask(StubTask &task) {
+    mfxBitstream *bs = task.bs;
+    if (task.ctrl) {
+        for (mfxU16 i = 0; i < task.ctrl->NumExtParam; i++) {
+            mfxExtBuffer *buffer = task.ctrl->ExtParam[i];
+            if (!buffer)
+                return MFX_ERR_NULL_PTR;
+            if (bs->DataOffset + bs->DataLength + buffer->BufferSz > bs->MaxLength)
+                return MFX_ERR_NOT_ENOUGH_BUFFER;
+            memcpy(bs->Data + bs->DataOffset + bs->DataLength, buffer, buffer->BufferSz);
+            bs->DataLength += buffer->BufferSz;
+        }
+    }
+    bs->FrameType = MFX_FRAMETYPE_I;
+    task.done     = true;
+    return StubRelease(task.input);
+}
+
 mfxStatus MFXInit(mfxIMPL implParam, mfxVersion *ver, mfxSession *session) {
     return MFX_ERR_NOT_IMPLEMENTED;
 }
@@ -15,7 +118,10 @@ mfxStatus MFXInitEx(mfxInitParam par, mfxSession *session) {
 }
 
 mfxStatus MFXClose(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    delete (StubSession *)session;
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXJoinSession(mfxSession session, mfxSession child) {
@@ -55,7 +161,16 @@ mfxStatus MFXVideoCORE_QueryPlatform(mfxSession session, mfxPlatform *platform)
 }
 
 mfxStatus MFXVideoCORE_SyncOperation(mfxSession session, mfxSyncPoint syncp, mfxU32 wait) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    uintptr_t index = (uintptr_t)syncp;
+    if (!index || index > STUB_MAX_TASKS)
+        return MFX_ERR_NULL_PTR;
+
+    StubSession *stub = (StubSession *)session;
+    std::lock_guard<std::mutex> guard(stub->lock);
+    StubTask &task = stub->tasks[index - 1];
+    return task.done ? MFX_ERR_NONE : RunTask(task);
 }
 
 mfxStatus MFXVideoDECODE_DecodeHeader(mfxSession session, mfxBitstream *bs, mfxVideoParam *par) {
@@ -73,11 +188,11 @@ mfxStatus MFXVideoDECODE_QueryIOSurf(mfxSession session,
 }
 
 mfxStatus MFXVideoDECODE_Init(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return session ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
 }
 
 mfxStatus MFXVideoDECODE_Close(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return session ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
 }
 
 mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
@@ -85,7 +200,25 @@ mfxStatus MFXVideoDECODE_DecodeFrameAsync(mfxSession session,
                                           mfxFrameSurface1 *surface_work,
                                           mfxFrameSurface1 **surface_out,
                                           mfxSyncPoint *syncp) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!surface_out || !syncp)
+        return MFX_ERR_NULL_PTR;
+    // each portion of the bitstream is a frame, nothing is buffered
+    if (!bs || !bs->DataLength)
+        return MFX_ERR_MORE_DATA;
+
+    StubSession *stub = (StubSession *)session;
+    std::lock_guard<std::mutex> guard(stub->lock);
+    *surface_out = GetFreeSurface(stub);
+    if (!*surface_out)
+        return MFX_ERR_MEMORY_ALLOC;
+
+    bs->DataOffset += bs->DataLength;
+    bs->DataLength = 0;
+    (*surface_out)->Data.FrameOrder = stub->frameOrder++;
+    *syncp                          = AddTask(stub, nullptr, nullptr, nullptr);
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXVideoDECODE_GetVideoParam(mfxSession session, mfxVideoParam *par) {
@@ -151,11 +284,11 @@ mfxStatus MFXVideoENCODE_QueryIOSurf(mfxSession session,
 }
 
 mfxStatus MFXVideoENCODE_Init(mfxSession session, mfxVideoParam *par) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return session ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
 }
 
 mfxStatus MFXVideoENCODE_Close(mfxSession session) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    return session ? MFX_ERR_NONE : MFX_ERR_INVALID_HANDLE;
 }
 
 mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
@@ -163,7 +296,23 @@ mfxStatus MFXVideoENCODE_EncodeFrameAsync(mfxSession session,
                                           mfxFrameSurface1 *surface,
                                           mfxBitstream *bs,
                                           mfxSyncPoint *syncp) {
-    return MFX_ERR_NOT_IMPLEMENTED;
+    if (!session)
+        return MFX_ERR_INVALID_HANDLE;
+    if (!bs || !syncp)
+        return MFX_ERR_NULL_PTR;
+    // nothing is buffered
+    if (!surface)
+        return MFX_ERR_MORE_DATA;
+
+    // input is held until the task is synchronized
+    mfxStatus sts = StubAddRef(surface);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    StubSession *stub = (StubSession *)session;
+    std::lock_guard<std::mutex> guard(stub->lock);
+    *syncp = AddTask(stub, ctrl, surface, bs);
+    return MFX_ERR_NONE;
 }
 
 mfxStatus MFXVideoENCODE_Reset(mfxSession session, mfxVideoParam *par) {
@@ -0,0 +1,96 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+// Global allocation functions counting the allocations. They are kept out of the
+// test code, so the compiler doesn't inline them into the callers and mistake
+// operator new paired with free() for a mismatched allocation.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_counter.h"
+
+static std::atomic<size_t> allocations(0);
+
+size_t get_allocation_count() {
+    return allocations.load();
+}
+
+void *operator new(std::size_t size) {
+    allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Aligned overloads pair with each other, so the memory is released by the matching function
+static void *aligned_allocate(std::size_t size, std::align_val_t align) {
+    allocations++;
+    std::size_t alignment = static_cast<std::size_t>(align);
+    size                  = (size + alignment - 1) / alignment * alignment;
+#if defined(_WIN32)
+    void *p = _aligned_malloc(size ? size : alignment, alignment);
+#else
+    void *p = std::aligned_alloc(alignment, size ? size : alignment);
+#endif
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void aligned_free(void *p) noexcept {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    return aligned_allocate(size, align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    return aligned_allocate(size, align);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    aligned_free(p);
+}
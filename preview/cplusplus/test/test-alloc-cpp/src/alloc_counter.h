@@ -0,0 +1,12 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+#pragma once
+
+#include <cstddef>
+
+// Returns number of the allocations made by the replaced global operator new so far
+size_t get_allocation_count();
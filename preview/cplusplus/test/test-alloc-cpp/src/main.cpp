@@ -0,0 +1,312 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "vpl/preview/vpl.hpp"
+
+#include "alloc_counter.h"
+
+namespace vpl = oneapi::vpl;
+
+#define WARMUP_FRAMES 16
+#define TEST_FRAMES   1000
+
+// Implementation ID of the stub runtime the test is run against
+#define STUB_VENDOR_IMPL_ID 0xFFFF
+
+static int TestHistoryIsBounded() {
+    vpl::future_surface_t dec;
+    vpl::future_bitstream_t enc;
+    const size_t depth = vpl::operation_history::max_depth;
+
+    printf("Checking history capacity");
+
+    for (size_t i = 0; i < 2 * depth; i++) {
+        vpl::operation_status op(vpl::component::decoder, nullptr);
+        op.schedule_status_ = (i == 2 * depth - 1) ? vpl::status::EndOfStreamReached
+                                                   : vpl::status::Ok;
+        dec.add_operation(op);
+    }
+    enc.add_operation(vpl::operation_status(vpl::component::encoder, nullptr));
+    enc.propagate_history(dec);
+
+    if (dec.history_.size() != depth ||
+        dec.get_last_schedule_status() != vpl::status::EndOfStreamReached ||
+        enc.history_.size() != depth ||
+        enc.history_.back().component_ != vpl::component::encoder) {
+        printf("\n   Error!\n");
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+// Gives a small portion of the stream per call, the stub runtime returns a frame for each portion.
+class stream_reader : public vpl::bitstream_source_reader {
+public:
+    bool get_data(vpl::bitstream_as_src *bits) {
+        bits->pull_in([](uint8_t *ptr, uint32_t max, bool &eos) {
+            uint32_t size = (max < 16) ? max : 16;
+            std::memset(ptr, 0, size);
+            return size;
+        });
+        return true;
+    }
+
+    bool is_EOS() const {
+        return false;
+    }
+};
+
+// AVC decode and encode sessions of the stub runtime
+struct stub_sessions {
+    stub_sessions()
+            : name(),
+              impl(name / "mfxImplDescription" / "VendorImplID", (uint32_t)STUB_VENDOR_IMPL_ID),
+              sel({ impl }),
+              reader(),
+              decoder(sel, vpl::codec_format_fourcc::avc, &reader),
+              encoder(sel),
+              dec_params(),
+              enc_params() {
+        dec_params.set_CodecId(vpl::codec_format_fourcc::avc);
+        enc_params.set_CodecId(vpl::codec_format_fourcc::avc);
+        decoder.Init(&dec_params);
+        encoder.Init(&enc_params);
+    }
+
+    vpl::property_name name;
+    vpl::property impl;
+    vpl::default_selector sel;
+    stream_reader reader;
+    vpl::decode_session<stream_reader> decoder;
+    vpl::encode_session encoder;
+    vpl::decoder_video_param dec_params;
+    vpl::encoder_video_param enc_params;
+};
+
+static int TestSteadyStateAllocations() {
+    printf("Checking steady state allocations");
+
+    try {
+        stub_sessions sessions;
+
+        auto run_frame = [&]() {
+            std::shared_ptr<vpl::future_surface_t> dec_future = sessions.decoder.process();
+            std::shared_ptr<vpl::future_bitstream_t> enc_future =
+                sessions.encoder.process(dec_future);
+            enc_future->wait();
+            return enc_future->get_last_schedule_status();
+        };
+
+        for (int i = 0; i < WARMUP_FRAMES; i++) {
+            run_frame();
+        }
+
+        size_t before = get_allocation_count();
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            if (run_frame() != vpl::status::Ok) {
+                printf("\n   Error! Frame %d is not encoded\n", i);
+                return -1;
+            }
+        }
+        size_t count = get_allocation_count() - before;
+
+        if (count) {
+            printf("\n   Error! %zu allocations in %d frames\n", count, TEST_FRAMES);
+            return -1;
+        }
+    }
+    catch (vpl::base_exception &e) {
+        printf("\n   Error! %s\n", e.what());
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int TestFrozenList() {
+    vpl::ExtEncoderROI roi;
+    vpl::ExtMBQP qp(std::vector<uint8_t>(16, 30));
+    vpl::encoder_process_list list(&roi, &qp);
+
+    printf("Checking frozen extension buffers list");
+
+    list.freeze();
+    auto [buffers, size] = list.get_raw_ext_buffers();
+    if (size != 2) {
+        printf("\n   Error! %zu buffers in the list\n", size);
+        return -1;
+    }
+
+    size_t before = get_allocation_count();
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        // Per-frame controls are updated in place.
+        roi.get_ref().NumROI      = 1;
+        roi.get_ref().ROI[0].Left = static_cast<uint32_t>(i);
+        qp.get_QP()[0]            = static_cast<uint8_t>(i % 52);
+
+        auto [frame_buffers, frame_size] = list.get_raw_ext_buffers();
+        if (frame_buffers != buffers || frame_size != size) {
+            printf("\n   Error! Pointers array is rebuilt\n");
+            return -1;
+        }
+    }
+    size_t count = get_allocation_count() - before;
+    if (count) {
+        printf("\n   Error! %zu allocations in %d frames\n", count, TEST_FRAMES);
+        return -1;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        if (buffers[i]->BufferId == MFX_EXTBUFF_ENCODER_ROI &&
+            reinterpret_cast<mfxExtEncoderROI *>(buffers[i])->ROI[0].Left != TEST_FRAMES - 1) {
+            printf("\n   Error! In place update is not visible\n");
+            return -1;
+        }
+    }
+
+    try {
+        vpl::ExtCodingOption2 co2;
+        list.add_buffer(&co2);
+        printf("\n   Error! Buffer is added to the frozen list\n");
+        return -1;
+    }
+    catch (vpl::base_exception &) {
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int TestFramesInFlightControls() {
+    vpl::ExtEncoderROI roi_a, roi_b;
+    roi_a.get_ref().NumROI      = 1;
+    roi_a.get_ref().ROI[0].Left = 1;
+    roi_b.get_ref().NumROI      = 1;
+    roi_b.get_ref().ROI[0].Left = 2;
+    vpl::encoder_process_list list_a(&roi_a);
+    vpl::encoder_process_list list_b(&roi_b);
+    list_a.freeze();
+    list_b.freeze();
+
+    printf("Checking encode controls of frames in flight");
+
+    try {
+        stub_sessions sessions;
+        vpl::encode_session &encoder = sessions.encoder;
+        auto &decoder                = sessions.decoder;
+
+        // stub runtime reads the controls when the frame is synchronized
+        std::shared_ptr<vpl::future_bitstream_t> enc_a = encoder.process(decoder.process(), list_a);
+        std::shared_ptr<vpl::future_bitstream_t> enc_b = encoder.process(decoder.process(), list_b);
+        enc_a->wait();
+        enc_b->wait();
+
+        auto [data_a, size_a] = enc_a->get()->get_valid_data();
+        auto [data_b, size_b] = enc_b->get()->get_valid_data();
+        if (size_a != sizeof(mfxExtEncoderROI) || size_b != sizeof(mfxExtEncoderROI) ||
+            std::memcmp(data_a, &roi_a.get_ref(), size_a) ||
+            std::memcmp(data_b, &roi_b.get_ref(), size_b)) {
+            printf("\n   Error! Frame is encoded with the control of another frame\n");
+            return -1;
+        }
+    }
+    catch (vpl::base_exception &e) {
+        printf("\n   Error! %s\n", e.what());
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static vpl::encoder_process_list make_frozen_list(vpl::ExtEncoderROI *roi) {
+    vpl::encoder_process_list list(roi);
+    list.freeze();
+    return list;
+}
+
+static int TestDroppedList() {
+    vpl::ExtEncoderROI roi, other_roi;
+    roi.get_ref().NumROI            = 1;
+    roi.get_ref().ROI[0].Left       = 3;
+    other_roi.get_ref().NumROI      = 1;
+    other_roi.get_ref().ROI[0].Left = 4;
+
+    printf("Checking encode controls of a dropped list");
+
+    try {
+        stub_sessions sessions;
+
+        // List is a temporary which dies right after the call, while the stub runtime reads the controls when the
+        // frame is synchronized. Another list likely takes over the memory of the dropped one.
+        std::shared_ptr<vpl::future_bitstream_t> enc =
+            sessions.encoder.process(sessions.decoder.process(), make_frozen_list(&roi));
+        vpl::encoder_process_list other_list = make_frozen_list(&other_roi);
+        enc->wait();
+
+        auto [data, size] = enc->get()->get_valid_data();
+        if (size != sizeof(mfxExtEncoderROI) || std::memcmp(data, &roi.get_ref(), size)) {
+            printf("\n   Error! Frame is encoded with the control of another list\n");
+            return -1;
+        }
+
+        // Copy of the list reuses the storage of the bitstream's previous copy.
+        for (int i = 0; i < WARMUP_FRAMES; i++) {
+            sessions.encoder.process(sessions.decoder.process(), other_list)->wait();
+        }
+        size_t before = get_allocation_count();
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            sessions.encoder.process(sessions.decoder.process(), other_list)->wait();
+        }
+        size_t count = get_allocation_count() - before;
+        if (count) {
+            printf("\n   Error! %zu allocations in %d frames with the list\n", count, TEST_FRAMES);
+            return -1;
+        }
+
+        // Unfrozen list is rejected, the operation is failed.
+        vpl::encoder_process_list unfrozen(&roi);
+        enc = sessions.encoder.process(sessions.decoder.process(), unfrozen);
+        if (!enc->had_fatal()) {
+            printf("\n   Error! Unfrozen list is accepted\n");
+            return -1;
+        }
+    }
+    catch (vpl::base_exception &e) {
+        printf("\n   Error! %s\n", e.what());
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int res;
+
+    res = 0;
+    res |= TestHistoryIsBounded();
+    res |= TestSteadyStateAllocations();
+    res |= TestFrozenList();
+    res |= TestFramesInFlightControls();
+    res |= TestDroppedList();
+
+    if (res)
+        printf("\nErrors in allocation tests\n");
+    else
+        printf("\nSuccess!\n");
+
+    return res;
+}
@@ -0,0 +1,222 @@
+//==============================================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+//==============================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vpl/preview/vpl.hpp"
+
+namespace vpl = oneapi::vpl;
+
+#define NUM_THREADS       4
+#define VALUES_PER_THREAD 100000
+
+static int TestBuckets() {
+    printf("Checking histogram buckets");
+
+    for (uint64_t v = 0; v < 4096; v++) {
+        uint32_t index = vpl::latency_histogram::get_bucket_index(v);
+        if (index >= vpl::latency_histogram::bucket_count ||
+            vpl::latency_histogram::get_bucket_upper_bound(index) < v ||
+            (index && vpl::latency_histogram::get_bucket_upper_bound(index - 1) >= v)) {
+            printf("\n   Error! Wrong bucket %u for %llu\n", index, (unsigned long long)v);
+            return -1;
+        }
+    }
+    if (vpl::latency_histogram::get_bucket_index(UINT64_MAX) !=
+            vpl::latency_histogram::bucket_count - 1 ||
+        vpl::latency_histogram::get_bucket_upper_bound(vpl::latency_histogram::bucket_count - 1) !=
+            UINT64_MAX) {
+        printf("\n   Error! Wrong last bucket\n");
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int CheckPercentile(const vpl::latency_histogram &h, double p, uint64_t expected) {
+    uint64_t value = h.get_percentile(p);
+    // Relative error is bounded by the bucket width.
+    if (value < expected || value > expected + expected / vpl::latency_histogram::sub_bucket_count) {
+        printf("\n   Error! p%.1f = %llu, expected %llu\n",
+               p,
+               (unsigned long long)value,
+               (unsigned long long)expected);
+        return -1;
+    }
+    return 0;
+}
+
+static int TestPercentiles() {
+    vpl::latency_histogram h;
+
+    printf("Checking histogram percentiles");
+
+    if (h.get_percentile(99.0) != 0 || h.get_min() != 0 || h.get_max() != 0) {
+        printf("\n   Error! Empty histogram is not empty\n");
+        return -1;
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&h, t]() {
+            for (uint64_t v = t; v < NUM_THREADS * VALUES_PER_THREAD; v += NUM_THREADS) {
+                h.record(std::chrono::microseconds(v + 1));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const uint64_t total = NUM_THREADS * VALUES_PER_THREAD;
+    if (h.get_count() != total || h.get_min() != 1000 || h.get_max() != total * 1000) {
+        printf("\n   Error! count = %llu, min = %llu, max = %llu\n",
+               (unsigned long long)h.get_count(),
+               (unsigned long long)h.get_min(),
+               (unsigned long long)h.get_max());
+        return -1;
+    }
+
+    int res = 0;
+    res |= CheckPercentile(h, 50.0, total / 2 * 1000);
+    res |= CheckPercentile(h, 99.0, total * 99 / 100 * 1000);
+    res |= CheckPercentile(h, 100.0, total * 1000);
+    if (res)
+        return res;
+
+    h.reset();
+    if (h.get_count() != 0 || h.get_percentile(50.0) != 0) {
+        printf("\n   Error! Histogram is not reset\n");
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int TestFrameRate() {
+    vpl::frame_rate_meter meter;
+    auto start = vpl::frame_rate_meter::clock::now();
+
+    printf("Checking frame rate meter");
+
+    // 30 fps for 3 seconds followed by 60 fps for 2 seconds.
+    auto t = start;
+    for (int i = 0; i < 90; i++, t += std::chrono::microseconds(33333)) {
+        meter.tick(t);
+    }
+    for (int i = 0; i < 120; i++, t += std::chrono::microseconds(16667)) {
+        meter.tick(t);
+    }
+
+    double fps_1s = meter.get_rate(std::chrono::milliseconds(1000), t);
+    double fps_5s = meter.get_rate(std::chrono::milliseconds(5000), t);
+    if (fps_1s < 55.0 || fps_1s > 65.0 || fps_5s < 38.0 || fps_5s > 46.0) {
+        printf("\n   Error! fps over 1s = %.2f, over 5s = %.2f\n", fps_1s, fps_5s);
+        return -1;
+    }
+
+    // Stale slots must not be accounted.
+    t += std::chrono::seconds(10);
+    if (meter.get_rate(std::chrono::milliseconds(5000), t) != 0.0) {
+        printf("\n   Error! Stale slots are accounted\n");
+        return -1;
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int TestExport() {
+    vpl::timing_stat stat;
+    auto submitted = vpl::timing_stat::clock::now();
+
+    printf("Checking timing statistic export");
+
+    stat.record_call(submitted, std::chrono::microseconds(10), true, false);
+    stat.record_call(submitted, std::chrono::microseconds(20), false, true);
+    stat.record_sync(submitted, submitted + std::chrono::microseconds(30));
+
+    if (stat.get_queue_wait().get_max() > stat.get_sync_latency().get_max()) {
+        printf("\n   Error! Queue wait exceeds sync latency\n");
+        return -1;
+    }
+
+    std::string json = stat.to_json();
+    const char *keys[] = { "\"sync_latency_ns\":{\"count\":1",
+                           "\"queue_wait_ns\":{\"count\":1",
+                           "\"cpu_time_ns\":{\"count\":2",
+                           "\"call_latency_ns\":{\"count\":1",
+                           "\"starvation_count\":1",
+                           "\"p99\":",
+                           "\"fps\":{" };
+    for (auto key : keys) {
+        if (json.find(key) == std::string::npos) {
+            printf("\n   Error! %s not found in %s\n", key, json.c_str());
+            return -1;
+        }
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+static int TestSyncProbe() {
+    auto stat = std::make_shared<vpl::timing_stat>();
+
+    printf("Checking sync probe");
+
+    // Each operation is fired from every thread at once and disarmed by another one, as the futures of the
+    // Python binding and the surface pool do.
+    for (int i = 0; i < 1000; i++) {
+        vpl::detail::sync_probe probe;
+        auto now = vpl::timing_stat::clock::now();
+        probe.arm(stat, now, now);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; t++) {
+            threads.emplace_back([&probe]() {
+                probe.fire();
+            });
+        }
+        threads.emplace_back([&probe]() {
+            probe.disarm();
+        });
+        for (auto &t : threads) {
+            t.join();
+        }
+        if (stat->get_sync_latency().get_count() > (uint64_t)i + 1) {
+            printf("\n   Error! Operation %d is accounted more than once\n", i);
+            return -1;
+        }
+    }
+
+    printf(" ... OK\n");
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int res;
+
+    res = 0;
+    res |= TestBuckets();
+    res |= TestPercentiles();
+    res |= TestFrameRate();
+    res |= TestExport();
+    res |= TestSyncProbe();
+
+    if (res)
+        printf("\nErrors in statistic tests\n");
+    else
+        printf("\nSuccess!\n");
+
+    return res;
+}
@@ -28,7 +28,13 @@ void init_extension_buffer_list(const py::module &m) {
             "check if list has buffer")
         .def("get_buffer",
              &vpl::buffer_list::get_buffer<vpl::extension_buffer_base>,
-             "get buffer from list");
+             "get buffer from list")
+        .def(
+            "freeze",
+            &vpl::buffer_list::freeze,
+            "freezes the list: array of buffer pointers is built once and reused by every processing call. Buffers can't be added to the frozen list, but their fields can be updated in place.")
+        .def("unfreeze", &vpl::buffer_list::unfreeze, "unfreezes the list")
+        .def_property_readonly("frozen", &vpl::buffer_list::is_frozen, "check if list is frozen");
 
     py::class_<vpl::decoder_init_reset_list, vpl::buffer_list>(m, "decoder_init_reset_list")
         .def(py::init<>())
@@ -7,26 +7,85 @@
 #include "vpl_python.hpp"
 namespace vpl = oneapi::vpl;
 
+// Describes all planes as the single 2D array. Planes must follow each other in memory and have the same layout of
+// rows, as Y and UV planes of NV12 and P010 surfaces. Frames with other layouts are exposed by planes().
+static py::buffer_info merge_planes(std::vector<image_plane> &planes) {
+    py::buffer_info frame = planes[0].buffer_info();
+    for (size_t i = 1; i < planes.size(); i++) {
+        py::buffer_info plane = planes[i].buffer_info();
+        auto frame_end = reinterpret_cast<uint8_t *>(frame.ptr) + frame.shape[0] * frame.strides[0];
+        if (plane.ptr != frame_end || plane.format != frame.format || plane.shape[1] != frame.shape[1] ||
+            plane.strides != frame.strides)
+            throw py::buffer_error("Planes of the surface are not contiguous, use planes()");
+        frame.shape[0] += plane.shape[0];
+    }
+    return py::buffer_info(frame.ptr,
+                           frame.itemsize,
+                           frame.format,
+                           2,
+                           { frame.shape[0], frame.shape[1] },
+                           { frame.strides[0], frame.strides[1] });
+}
+
 void init_frame_surface(const py::module &m) {
-    py::class_<vpl::frame_surface, std::shared_ptr<vpl::frame_surface>>(m, "frame_surface")
+    py::class_<vpl::frame_surface, std::shared_ptr<vpl::frame_surface>>(m,
+                                                                      "frame_surface",
+                                                                      py::buffer_protocol())
         .def(py::init<>())
         .def(
             "inject",
             &vpl::frame_surface::inject,
             "Inject mfxFrameSurface1 object to take care of it. This is temporal method until VPL RT will support all functions for the internal memory allocation")
-        .def("wait", &vpl::frame_surface::wait, "Indefinitely wait for operation completion.")
+        .def("wait",
+             &vpl::frame_surface::wait,
+             py::call_guard<py::gil_scoped_release>(),
+             "Indefinitely wait for operation completion.")
         .def(
             "wait_for",
             [](vpl::frame_surface &s, int milliseconds) {
                 std::chrono::duration<int, std::milli> waitduration(milliseconds);
                 return s.wait_for(waitduration);
             },
+            py::call_guard<py::gil_scoped_release>(),
             "Waits for the operation completion. Waits for the result to become available. Blocks until specified timeout_duration has elapsed or the result becomes available, whichever comes first. Returns value identifying the state of the result.")
         .def_property_readonly("frame_info",
                                &vpl::frame_surface::get_frame_info,
                                "Provide frame information.")
-        .def("map", &vpl::frame_surface::map, "Maps data to the system memory.")
+        .def("map",
+             &vpl::frame_surface::map,
+             py::call_guard<py::gil_scoped_release>(),
+             "Maps data to the system memory. While mapped, the surface exposes its planes through buffer protocol.")
         .def("unmap", &vpl::frame_surface::unmap, "Unmaps data to the system memory.")
+        .def(
+            "planes",
+            [](std::shared_ptr<vpl::frame_surface> self, vpl::memory_access flags) {
+                py::gil_scoped_release release;
+                auto [info, data] = self->map(flags);
+                // Surface stays mapped until the last plane view is released.
+                std::shared_ptr<void> mapping(self.get(), [self](void *) {
+                    try {
+                        self->unmap();
+                    }
+                    catch (...) {
+                    }
+                });
+                return get_image_planes(data, info, mapping);
+            },
+            "Maps data to the system memory and returns zero-copy views of the frame planes. Views support buffer protocol, so they can be wrapped by memoryview or numpy.asarray without copy. Surface is unmapped when all views are released.")
+        .def_buffer([](vpl::frame_surface &self) {
+            // Buffer protocol has no hook to unmap the surface when the buffer is released, so the surface must be
+            // mapped by the caller for the lifetime of the buffer.
+            mfxFrameSurface1 *surface = self.get_raw_ptr();
+            if (!surface)
+                throw py::buffer_error("Surface is empty");
+            if (!self.is_mapped())
+                throw py::buffer_error("Surface is not mapped, call map() or use planes()");
+            auto planes = get_image_planes(vpl::frame_data(surface->Data),
+                                           vpl::frame_info(surface->Info));
+            if (planes.empty())
+                throw py::buffer_error("Color format is not supported");
+            return merge_planes(planes);
+        })
         .def_property_readonly("native_handle",
                                &vpl::frame_surface::get_native_handle,
                                "native surface handle of the surface.")
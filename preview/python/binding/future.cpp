@@ -3,8 +3,246 @@
 //
 // SPDX-License-Identifier: MIT
 //==============================================================================
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
 #include "vpl/preview/future.hpp"
 #include "vpl_python.hpp"
 namespace vpl = oneapi::vpl;
 
-void init_future(const py::module &m) {}
\ No newline at end of file
+/// @brief Native threads which wait for the sync points of scheduled operations and resolve asyncio futures. Each
+/// worker blocks in the synchronization of one operation, idle workers sleep until a job is submitted or the workers
+/// are stopped. Workers are created on demand up to the number of operations in flight, so the streams served from
+/// one event loop don't wait for each other.
+class completion_workers {
+public:
+    /// @brief Scheduled operation.
+    struct job {
+        std::function<vpl::async_op_status(std::chrono::milliseconds)> wait_for;
+        std::function<py::object(vpl::async_op_status)> result;
+        py::object loop;
+        py::object future;
+        vpl::async_op_status status;
+        std::string error;
+    };
+
+    completion_workers() : lock_(), cv_(), queue_(), threads_(), idle_(0), stop_(false) {}
+
+    ~completion_workers() {
+        stop();
+    }
+
+    /// @brief Returns running event loop of the calling thread.
+    py::object get_running_loop() {
+        return py::module::import("asyncio").attr("get_running_loop")();
+    }
+
+    /// @brief Adds job to the completion queue. Must be called with GIL held.
+    void submit(job &&j) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (stop_)
+            throw std::runtime_error("Completion workers are stopped");
+        queue_.push_back(std::move(j));
+        if (idle_ < queue_.size() && threads_.size() < max_workers)
+            threads_.emplace_back(&completion_workers::run, this);
+        else
+            cv_.notify_one();
+    }
+
+    /// @brief Stops the workers and drops not completed jobs. Must be called with GIL held.
+    void stop() {
+        std::list<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+            cv_.notify_all();
+            threads.swap(threads_);
+        }
+        if (!threads.empty()) {
+            // Workers might wait for GIL to resolve futures.
+            py::gil_scoped_release release;
+            for (auto &t : threads)
+                t.join();
+        }
+        queue_.clear();
+    }
+
+private:
+    /// @brief Upper limit of the workers, jobs above it wait in the queue.
+    static constexpr size_t max_workers = 64;
+    /// @brief Time of a single wait of the synchronization. Operation completion ends the wait immediately, the
+    /// limit only lets the worker notice the stop.
+    static constexpr std::chrono::milliseconds wait_slice = std::chrono::milliseconds(100);
+
+    void run() {
+        std::unique_lock<std::mutex> guard(lock_);
+        while (true) {
+            idle_++;
+            cv_.wait(guard, [&]() {
+                return stop_ || !queue_.empty();
+            });
+            idle_--;
+            if (stop_)
+                break;
+            std::list<job> current;
+            current.splice(current.end(), queue_, queue_.begin());
+            guard.unlock();
+
+            bool completed = wait(current.front());
+            {
+                py::gil_scoped_acquire gil;
+                if (completed)
+                    resolve(current.front());
+                // Python objects are released with GIL held.
+                current.clear();
+            }
+            guard.lock();
+        }
+    }
+
+    /// @brief Blocks until the operation is completed or the workers are stopped.
+    /// @return False if the workers are stopped first.
+    bool wait(job &j) {
+        try {
+            while ((j.status = j.wait_for(wait_slice)) == vpl::async_op_status::timeout) {
+                std::lock_guard<std::mutex> guard(lock_);
+                if (stop_)
+                    return false;
+            }
+        }
+        catch (std::exception &e) {
+            j.status = vpl::async_op_status::aborted;
+            j.error  = e.what();
+        }
+        return true;
+    }
+
+    static void set_future(py::object future, py::object value, bool failed) {
+        // Future might be cancelled by the user while operation was in flight.
+        if (future.attr("done")().cast<bool>())
+            return;
+        if (failed)
+            future.attr("set_exception")(value);
+        else
+            future.attr("set_result")(value);
+    }
+
+    void resolve(job &j) {
+        try {
+            py::object value;
+            bool failed = !j.error.empty();
+            if (failed) {
+                value = py::module::import("builtins").attr("RuntimeError")(j.error);
+            }
+            else {
+                try {
+                    value = j.result(j.status);
+                }
+                catch (py::error_already_set &e) {
+                    failed = true;
+                    value  = e.value();
+                }
+                catch (std::exception &e) {
+                    failed = true;
+                    value  = py::module::import("builtins").attr("RuntimeError")(e.what());
+                }
+            }
+            j.loop.attr("call_soon_threadsafe")(py::cpp_function(&completion_workers::set_future),
+                                                j.future,
+                                                value,
+                                                failed);
+        }
+        catch (py::error_already_set &) {
+            // Event loop is closed, nobody waits for the result.
+        }
+    }
+
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::list<job> queue_;
+    std::list<std::thread> threads_;
+    size_t idle_;
+    bool stop_;
+};
+
+// Owned by the module object, see init_future().
+static completion_workers *completion = nullptr;
+
+py::object schedule_completion(
+    std::function<vpl::async_op_status(std::chrono::milliseconds)> wait_for,
+    std::function<py::object(vpl::async_op_status)> result) {
+    py::object loop   = completion->get_running_loop();
+    py::object future = loop.attr("create_future")();
+    completion->submit({ wait_for, result, loop, future, vpl::async_op_status::unknown, "" });
+    return future;
+}
+
+py::object make_failed_future(py::object exception) {
+    py::object future = completion->get_running_loop().attr("create_future")();
+    future.attr("set_exception")(exception);
+    return future;
+}
+
+template <typename Data>
+void init_future_template(const py::module &m, const char *name) {
+    using Class = vpl::future<Data>;
+    py::class_<Class, std::shared_ptr<Class>>(m, name)
+        .def("wait",
+             &Class::wait,
+             py::call_guard<py::gil_scoped_release>(),
+             "Indefinitely waits for operation completion.")
+        .def(
+            "wait_for",
+            [](Class &self, int milliseconds) {
+                std::chrono::duration<int, std::milli> waitduration(milliseconds);
+                return self.wait_for(waitduration);
+            },
+            py::call_guard<py::gil_scoped_release>(),
+            "Waits for the operation completion. Blocks until specified timeout_duration has elapsed or the result becomes available, whichever comes first. Returns value identifying the state of the result.")
+        .def("get",
+             &Class::get,
+             py::call_guard<py::gil_scoped_release>(),
+             "Provides syncronized data. Waits indefinitely for the synchronization.")
+        .def("get_last_schedule_status",
+             &Class::get_last_schedule_status,
+             "Retrieve last operation scheduling status.")
+        .def("get_last_exec_status",
+             &Class::get_last_exec_status,
+             "Retrieve last operation exec status.")
+        .def("had_fatal", &Class::had_fatal, "Check if fatal error happened.")
+        .def(
+            "__await__",
+            [](std::shared_ptr<Class> self) {
+                return schedule_completion(
+                           [self](std::chrono::milliseconds timeout) {
+                               return self->wait_for(timeout);
+                           },
+                           [self](vpl::async_op_status status) -> py::object {
+                               // Future without data (more data required, end of stream) resolves to None.
+                               if (status != vpl::async_op_status::ready)
+                                   return py::none();
+                               return py::cast(self->get());
+                           })
+                    .attr("__await__")();
+            },
+            "Awaits for operation completion without blocking the event loop. Returns synchronized data or None if operation doesn't produce data.");
+}
+
+void init_future(const py::module &m) {
+    // Workers live as long as the module. They are stopped at exit, before interpreter finalization makes GIL
+    // unavailable to them; the module releases them afterwards.
+    completion = new completion_workers();
+    m.attr("_completion_workers") = py::capsule(completion, [](void *p) {
+        delete static_cast<completion_workers *>(p);
+        completion = nullptr;
+    });
+    py::module::import("atexit").attr("register")(py::cpp_function([]() {
+        if (completion)
+            completion->stop();
+    }));
+
+    init_future_template<std::shared_ptr<vpl::frame_surface>>(m, "future_surface");
+    init_future_template<std::shared_ptr<vpl::bitstream_as_dst>>(m, "future_bitstream");
+}
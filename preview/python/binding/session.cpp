@@ -20,8 +20,14 @@ public:
                 "Verify",
                 &Class::Verify,
                 "Verifies that implementation supports such capabilities. On output, corrected capabilities are returned.")
-            .def("Init", &Class::Init, "Initializes the session by using provided parameters.")
-            .def("Reset", &Class::Reset, "Resets the session by using provided parameters.")
+            .def("Init",
+                 &Class::Init,
+                 py::call_guard<py::gil_scoped_release>(),
+                 "Initializes the session by using provided parameters.")
+            .def("Reset",
+                 &Class::Reset,
+                 py::call_guard<py::gil_scoped_release>(),
+                 "Resets the session by using provided parameters.")
             .def("working_params", &Class::working_params, "Retrieves current session parameters.")
             .def_property_readonly("component_domain",
                                    &Class::get_component_domain,
@@ -34,7 +40,10 @@ public:
                                      (vpl::implementation_via)(impl & 0xFF00));
                 },
                 "Implementation")
-            .def_property_readonly("version", &Class::get_version, "Returns version");
+            .def_property_readonly("version", &Class::get_version, "Returns version")
+            .def_property_readonly("TimingStat",
+                                   &Class::getTimingStat,
+                                   "Retrieve client-side timing statistic");
     }
 };
 
@@ -65,45 +74,95 @@ public:
             .def(
                 "init_by_header",
                 &Class::init_by_header,
+                py::call_guard<py::gil_scoped_release>(),
                 "Initialize the session by using bitream portion. This step can be omitted if the codec ID is known or we don't need to get SSP or PPS data from the bitstream.")
-            .def("decode_frame", &Class::decode_frame, "Decodes frame")
-            .def("process", &Class::process, "Decodes frame")
+            .def("decode_frame",
+                 &Class::decode_frame,
+                 py::call_guard<py::gil_scoped_release>(),
+                 "Decodes frame")
+            .def("process",
+                 &Class::process,
+                 py::call_guard<py::gil_scoped_release>(),
+                 "Decodes frame. Function returns the future object with the surface. Future can be awaited from asyncio coroutine.")
             .def_property_readonly("Stat", &Class::getStat, "Retrieve decoder statistic")
             .def_property_readonly("Params", &Class::getParams, "Get video params")
             .def("__iter__",
                  [](Class *self) -> Class & {
                      return *self;
                  })
+            .def("__aiter__",
+                 [](Class *self) -> Class & {
+                     return *self;
+                 })
+            .def("__anext__",
+                 [](Class *self) {
+                     // Only scheduling is done here, synchronization is left to the completion workers.
+                     std::shared_ptr<vpl::frame_surface> out = [self]() {
+                         py::gil_scoped_release release;
+                         while (true) {
+                             std::shared_ptr<vpl::frame_surface> dec_surface_out =
+                                 std::make_shared<vpl::frame_surface>();
+                             switch (self->decode_frame(dec_surface_out)) {
+                                 case vpl::status::Ok:
+                                     return dec_surface_out;
+                                 case vpl::status::NotEnoughData:
+                                 case vpl::status::DeviceBusy:
+                                     continue;
+                                 default:
+                                     return std::shared_ptr<vpl::frame_surface>();
+                             }
+                         }
+                     }();
+                     if (!out)
+                         return make_failed_future(
+                             py::module::import("builtins").attr("StopAsyncIteration")());
+                     return schedule_completion(
+                         [out](std::chrono::milliseconds timeout) {
+                             return out->wait_for(timeout);
+                         },
+                         [out](vpl::async_op_status status) {
+                             if (status != vpl::async_op_status::ready)
+                                 throw std::runtime_error("Frame synchronization failed");
+                             return py::cast(out);
+                         });
+                 })
             .def("__next__", [](Class *self) {
-                bool is_stillgoing = true;
-                while (is_stillgoing == true) {
-                    std::shared_ptr<vpl::frame_surface> dec_surface_out =
-                        std::make_shared<vpl::frame_surface>();
-                    vpl::status ret = self->decode_frame(dec_surface_out);
-                    vpl::async_op_status st;
-                    switch (ret) {
-                        case vpl::status::Ok:
-                            do {
-                                std::chrono::duration<int, std::milli> waitduration(100);
-                                st = dec_surface_out->wait_for(waitduration);
-                                if (vpl::async_op_status::ready == st) {
-                                    return dec_surface_out;
-                                }
-                            } while (st == vpl::async_op_status::timeout);
-                            break;
-                        case vpl::status::EndOfStreamReached:
-                            is_stillgoing = false;
-                            break;
-                        case vpl::status::NotEnoughData:
-                            break;
-                        case vpl::status::DeviceBusy:
-                            break;
-                        default:
-                            is_stillgoing = false;
-                            break;
+                // Native decode loop runs without GIL, so other Python threads keep running.
+                std::shared_ptr<vpl::frame_surface> out = [self]() {
+                    py::gil_scoped_release release;
+                    bool is_stillgoing = true;
+                    while (is_stillgoing == true) {
+                        std::shared_ptr<vpl::frame_surface> dec_surface_out =
+                            std::make_shared<vpl::frame_surface>();
+                        vpl::status ret = self->decode_frame(dec_surface_out);
+                        vpl::async_op_status st;
+                        switch (ret) {
+                            case vpl::status::Ok:
+                                do {
+                                    std::chrono::duration<int, std::milli> waitduration(100);
+                                    st = dec_surface_out->wait_for(waitduration);
+                                    if (vpl::async_op_status::ready == st) {
+                                        return dec_surface_out;
+                                    }
+                                } while (st == vpl::async_op_status::timeout);
+                                break;
+                            case vpl::status::EndOfStreamReached:
+                                is_stillgoing = false;
+                                break;
+                            case vpl::status::NotEnoughData:
+                                break;
+                            case vpl::status::DeviceBusy:
+                                break;
+                            default:
+                                is_stillgoing = false;
+                                break;
+                        }
                     }
-                }
-                throw py::stop_iteration();
+                    return std::shared_ptr<vpl::frame_surface>();
+                }();
+                if (!out)
+                    throw py::stop_iteration();
+                return out;
             });
     }
 };
@@ -128,45 +187,90 @@ void init_session(const py::module &m) {
         .def(py::init<vpl::implemetation_selector &, vpl::frame_source_reader *>())
         .def("alloc_input",
              &vpl::encode_session::alloc_input,
+             py::call_guard<py::gil_scoped_release>(),
              "Allocate and return shared pointer to the surface")
         //.def("sync", &vpl::encode_session::sync)
         .def("encode_frame",
              py::overload_cast<std::shared_ptr<vpl::frame_surface>,
                                std::shared_ptr<vpl::bitstream_as_dst>,
-                               vpl::encoder_process_list>(&vpl::encode_session::encode_frame),
+                               const vpl::encoder_process_list &>(
+                 &vpl::encode_session::encode_frame),
+             py::call_guard<py::gil_scoped_release>(),
              "Encodes frame")
         .def("encode_frame",
-             py::overload_cast<std::shared_ptr<vpl::bitstream_as_dst>, vpl::encoder_process_list>(
+             py::overload_cast<std::shared_ptr<vpl::bitstream_as_dst>,
+                               const vpl::encoder_process_list &>(
                  &vpl::encode_session::encode_frame),
+             py::call_guard<py::gil_scoped_release>(),
              "Encodes frame by using provided source reader to get data to encode")
         .def(
             "process",
             &vpl::encode_session::process,
-            "Encode frame. Function returns the future object with the bitstream which will hold processed data. User needs to sync up the future object before accessing.")
+            py::call_guard<py::gil_scoped_release>(),
+            "Encode frame. Function returns the future object with the bitstream which will hold processed data. User needs to sync up the future object before accessing or await it from asyncio coroutine.")
         .def_property_readonly("Stat", &vpl::encode_session::getStat, "Retrieve encoder statistic")
         .def("__iter__",
              [](vpl::encode_session *self) -> vpl::encode_session & {
                  return *self;
              })
+        .def("__aiter__",
+             [](vpl::encode_session *self) -> vpl::encode_session & {
+                 return *self;
+             })
+        .def("__anext__",
+             [](vpl::encode_session *self) {
+                 std::shared_ptr<vpl::bitstream_as_dst> out = [self]() {
+                     py::gil_scoped_release release;
+                     std::shared_ptr<vpl::bitstream_as_dst> bits =
+                         std::make_shared<vpl::bitstream_as_dst>();
+                     while (true) {
+                         switch (self->encode_frame(bits)) {
+                             case vpl::status::Ok:
+                                 return bits;
+                             case vpl::status::DeviceBusy:
+                                 continue;
+                             default:
+                                 return std::shared_ptr<vpl::bitstream_as_dst>();
+                         }
+                     }
+                 }();
+                 if (!out)
+                     return make_failed_future(
+                         py::module::import("builtins").attr("StopAsyncIteration")());
+                 return schedule_completion(
+                     [out](std::chrono::milliseconds timeout) {
+                         return out->wait_for(timeout);
+                     },
+                     [out](vpl::async_op_status status) {
+                         if (status != vpl::async_op_status::ready)
+                             throw std::runtime_error("Bitstream synchronization failed");
+                         return py::cast(out);
+                     });
+             })
         .def("__next__", [](vpl::encode_session *self) -> std::shared_ptr<vpl::bitstream_as_dst> {
-            std::shared_ptr<vpl::bitstream_as_dst> bits = std::make_shared<vpl::bitstream_as_dst>();
-            while (true) {
-                vpl::status wrn = vpl::status::Ok;
-                wrn             = self->encode_frame(bits);
-                switch (wrn) {
-                    case vpl::status::Ok: {
-                        std::chrono::duration<int, std::milli> waitduration(100);
-                        bits->wait_for(waitduration);
-                        return bits;
-                    } break;
-                    case vpl::status::EndOfStreamReached:
-                        throw py::stop_iteration();
-                    case vpl::status::DeviceBusy:
-                        continue;
-                    default:
-                        throw py::stop_iteration();
+            std::shared_ptr<vpl::bitstream_as_dst> out = [self]() {
+                py::gil_scoped_release release;
+                std::shared_ptr<vpl::bitstream_as_dst> bits =
+                    std::make_shared<vpl::bitstream_as_dst>();
+                while (true) {
+                    vpl::status wrn = vpl::status::Ok;
+                    wrn             = self->encode_frame(bits);
+                    switch (wrn) {
+                        case vpl::status::Ok: {
+                            std::chrono::duration<int, std::milli> waitduration(100);
+                            bits->wait_for(waitduration);
+                            return bits;
+                        } break;
+                        case vpl::status::DeviceBusy:
+                            continue;
+                        default:
+                            return std::shared_ptr<vpl::bitstream_as_dst>();
+                    }
                 }
-            }
+            }();
+            if (!out)
+                throw py::stop_iteration();
+            return out;
         });
 
     session_template<vpl::vpp_video_param, vpl::vpp_init_reset_list, vpl::vpp_init_reset_list>(
@@ -182,9 +286,11 @@ void init_session(const py::module &m) {
         .def(py::init<vpl::implemetation_selector &, vpl::frame_source_reader *>())
         .def("alloc_input",
              &vpl::vpp_session::alloc_input,
+             py::call_guard<py::gil_scoped_release>(),
              "Allocate and return shared pointer to the surface")
         .def("Init",
              &vpl::vpp_session::Init,
+             py::call_guard<py::gil_scoped_release>(),
              "Initializes session with given parameters and extention buffers.")
         //.def("sync", &vpl::vpp_session::sync)
         .def(
@@ -192,15 +298,18 @@ void init_session(const py::module &m) {
             py::overload_cast<std::shared_ptr<vpl::frame_surface>,
                               std::shared_ptr<vpl::frame_surface>>(
                 &vpl::vpp_session::process_frame),
+            py::call_guard<py::gil_scoped_release>(),
             "Process frame. Function returns the surface which will hold processed data. User need to sync up the surface data before accessing.")
         .def(
             "process_frame",
             py::overload_cast<std::shared_ptr<vpl::frame_surface>>(
                 &vpl::vpp_session::process_frame),
+            py::call_guard<py::gil_scoped_release>(),
             "Process frame. Function returns the surface which will hold processed data. User need to sync up the surface data before accessing.")
         .def(
             "process",
             &vpl::vpp_session::process,
+            py::call_guard<py::gil_scoped_release>(),
             "Process frame. Function returns the future object with the surface which will hold processed data. User need to sync up the future object before accessing.")
         .def_property_readonly("Stat", &vpl::vpp_session::getStat, "Retrieve vpp statistic")
         .def("__iter__",
@@ -208,33 +317,38 @@ void init_session(const py::module &m) {
                  return *self;
              })
         .def("__next__", [](vpl::vpp_session *self) -> std::shared_ptr<vpl::frame_surface> {
-            std::shared_ptr<vpl::frame_surface> proc_surface_out =
-                std::make_shared<vpl::frame_surface>();
-            oneapi::vpl::status wrn = oneapi::vpl::status::Ok;
-            bool is_stillgoing      = true;
-            while (is_stillgoing == true) {
-                wrn = self->process_frame(proc_surface_out);
-                switch (wrn) {
-                    case oneapi::vpl::status::Ok: {
-                        oneapi::vpl::async_op_status st;
-                        do {
-                            std::chrono::duration<int, std::milli> waitduration(100);
-                            st = proc_surface_out->wait_for(waitduration);
-                            if (oneapi::vpl::async_op_status::ready == st) {
-                                return proc_surface_out;
-                            }
-                        } while (st == oneapi::vpl::async_op_status::timeout);
-                    } break;
-                    case oneapi::vpl::status::NotEnoughBuffer:
-                        break;
-                    case oneapi::vpl::status::NotEnoughData:
-                        throw py::stop_iteration();
-                    case oneapi::vpl::status::DeviceBusy:
-                        break;
-                    default:
-                        throw py::stop_iteration();
+            std::shared_ptr<vpl::frame_surface> out = [self]() {
+                py::gil_scoped_release release;
+                std::shared_ptr<vpl::frame_surface> proc_surface_out =
+                    std::make_shared<vpl::frame_surface>();
+                oneapi::vpl::status wrn = oneapi::vpl::status::Ok;
+                bool is_stillgoing      = true;
+                while (is_stillgoing == true) {
+                    wrn = self->process_frame(proc_surface_out);
+                    switch (wrn) {
+                        case oneapi::vpl::status::Ok: {
+                            oneapi::vpl::async_op_status st;
+                            do {
+                                std::chrono::duration<int, std::milli> waitduration(100);
+                                st = proc_surface_out->wait_for(waitduration);
+                                if (oneapi::vpl::async_op_status::ready == st) {
+                                    return proc_surface_out;
+                                }
+                            } while (st == oneapi::vpl::async_op_status::timeout);
+                        } break;
+                        case oneapi::vpl::status::NotEnoughBuffer:
+                            break;
+                        case oneapi::vpl::status::DeviceBusy:
+                            break;
+                        default:
+                            is_stillgoing = false;
+                            break;
+                    }
                 }
-            }
-            throw py::stop_iteration();
+                return std::shared_ptr<vpl::frame_surface>();
+            }();
+            if (!out)
+                throw py::stop_iteration();
+            return out;
         });
 }
\ No newline at end of file
@@ -36,4 +36,51 @@ void init_stat(const py::module &m) {
     py::class_<vpl::vpp_stat, vpl::stat>(m, "vpp_stat")
         .def(py::init<>())
         .def_property_readonly("raw", &vpl::vpp_stat::get_raw, "Retrieves raw data pointer");
-}
\ No newline at end of file
+
+    py::class_<vpl::latency_histogram>(m, "latency_histogram")
+        .def_property_readonly("count",
+                               &vpl::latency_histogram::get_count,
+                               "Retrieves number of recorded values")
+        .def_property_readonly("min",
+                               &vpl::latency_histogram::get_min,
+                               "Retrieves minimal recorded value in nanoseconds")
+        .def_property_readonly("max",
+                               &vpl::latency_histogram::get_max,
+                               "Retrieves maximal recorded value in nanoseconds")
+        .def_property_readonly("mean",
+                               &vpl::latency_histogram::get_mean,
+                               "Retrieves mean of recorded values in nanoseconds")
+        .def("percentile",
+             &vpl::latency_histogram::get_percentile,
+             "Estimates percentile of recorded values in nanoseconds");
+
+    py::class_<vpl::timing_stat, std::shared_ptr<vpl::timing_stat>>(m, "timing_stat")
+        .def_property_readonly("sync_latency",
+                               &vpl::timing_stat::get_sync_latency,
+                               py::return_value_policy::reference_internal,
+                               "Retrieves histogram of submission to synchronization latency")
+        .def_property_readonly("queue_wait",
+                               &vpl::timing_stat::get_queue_wait,
+                               py::return_value_policy::reference_internal,
+                               "Retrieves histogram of the time from the processing call return to synchronization")
+        .def_property_readonly("cpu_time",
+                               &vpl::timing_stat::get_cpu_time,
+                               py::return_value_policy::reference_internal,
+                               "Retrieves histogram of CPU time per processing call")
+        .def_property_readonly("call_latency",
+                               &vpl::timing_stat::get_call_latency,
+                               py::return_value_policy::reference_internal,
+                               "Retrieves histogram of the wall time of accepted processing calls")
+        .def_property_readonly("starvation_count",
+                               &vpl::timing_stat::get_starvation_count,
+                               "Retrieves number of calls rejected due to resources starvation")
+        .def(
+            "frame_rate",
+            [](vpl::timing_stat &self, int milliseconds) {
+                return self.get_frame_rate(std::chrono::milliseconds(milliseconds));
+            },
+            py::arg("window_ms") = 1000,
+            "Retrieves rate of synchronized outputs over sliding window")
+        .def("reset", &vpl::timing_stat::reset, "Drops all accounted data")
+        .def("to_json", &vpl::timing_stat::to_json, "Exports statistic in JSON format");
+}
@@ -7,48 +7,425 @@
 #include "vpl_python.hpp"
 namespace vpl = oneapi::vpl;
 
-class image_plane {
-public:
-    image_plane(void *base,
-                py::ssize_t item_size,
-                py::ssize_t cols,
-                py::ssize_t rows,
-                py::ssize_t sample_pitch,
-                py::ssize_t row_pitch,
-                std::string format,
-                std::string desc)
-            : base(base),
-              item_size(item_size),
-              rows(rows),
-              cols(cols),
-              row_pitch(row_pitch),
-              sample_pitch(sample_pitch),
-              format(format),
-              desc(desc) {}
-
-    py::buffer_info buffer_info() {
-        return py::buffer_info(base,
-                               item_size,
-                               format,
-                               2,
-                               { cols, rows },
-                               { sample_pitch, row_pitch });
-    }
-
-    std::string get_desc() {
-        return desc;
+std::vector<image_plane> get_image_planes(const vpl::frame_data &data,
+                                          const vpl::frame_info &info,
+                                          std::shared_ptr<void> owner) {
+    auto size   = info.get_frame_size();
+    auto pitch  = data.get_pitch();
+    auto width  = size.first;
+    auto height = size.second;
+    switch (info.get_FourCC()) {
+        case vpl::color_format_fourcc::yuy2:
+            //  YUV 4:2:2   8       2   w2xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 2,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "YUYV",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::uyvy:
+            //  YUV 4:2:2   8       2   w2xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 2,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "UYVY",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::bgra:
+            //  RGB 4:4:4   8       4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1_BGRA();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 4,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "BGRA",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::bgr4:
+            //  RGB 4:4:4   8       4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1_BGRA();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 4,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "BGRA",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::ayuv:
+            //  YUV 4:4:4   8       4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 4,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "AYUV",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::y210:
+            //  YUV 4:2:2   10      4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    2,
+                    width * 2,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint16_t>::format(),
+                    "YUYV",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::y216:
+            //  YUV 4:2:2   16      4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    2,
+                    width * 2,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint16_t>::format(),
+                    "YUYV",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::y410:
+            //  YUV 4:4:4   10      4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    4,
+                    width,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint32_t>::format(),
+                    "A:2 VYU:10",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::a2rgb10:
+            //  RGB 4:4:4   10:2    4   w4xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    1,
+                    width * 4,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint8_t>::format(),
+                    "A:2 RGB:10",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::y416:
+            //  YUV 4:4:4   16      8   w8xh1
+            {
+                auto ptr = data.get_plane_ptrs_1();
+                return std::vector{ image_plane(
+                    ptr,
+                    2,
+                    width * 4,
+                    height,
+                    1,
+                    pitch,
+                    py::format_descriptor<uint16_t>::format(),
+                    "AVYU",
+                    owner) };
+            }
+        case vpl::color_format_fourcc::nv12:
+            //  YUV 4:2:0   8       1:1 w1xh1:w1xh/2    Y   UV
+            {
+                auto ptr = data.get_plane_ptrs_2();
+                auto p1  = ptr.first;
+                auto p2  = ptr.second;
+                return std::vector{
+                    image_plane(p1,
+                                1,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                1,
+                                width,
+                                height / 2,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "UV",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::p010:
+            //  YUV 4:2:0   10      2:2 w2xh1:w2xh/2    Y   UV
+            {
+                auto ptr = data.get_plane_ptrs_2();
+                auto p1  = ptr.first;
+                auto p2  = ptr.second;
+                return std::vector{
+                    image_plane(p1,
+                                2,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                2,
+                                width,
+                                height / 2,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "UV",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::p016:
+            //  YUV 4:2:0   16      2:2 w2xh1:w2xh/2    Y   UV
+            {
+                auto ptr = data.get_plane_ptrs_2();
+                auto p1  = ptr.first;
+                auto p2  = ptr.second;
+                return std::vector{
+                    image_plane(p1,
+                                2,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                2,
+                                width,
+                                height / 2,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "UV",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::nv16:
+            //  YUV 4:2:2   8       1:1 w1xh1:w1xh1     Y   UV
+            {
+                auto ptr = data.get_plane_ptrs_2();
+                auto p1  = ptr.first;
+                auto p2  = ptr.second;
+                return std::vector{
+                    image_plane(p1,
+                                1,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                1,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "UV",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::p210:
+            //  YUV 4:2:2   10      2:2 w2xh1:w2xh1     Y   UV
+            {
+                auto ptr = data.get_plane_ptrs_2();
+                auto p1  = ptr.first;
+                auto p2  = ptr.second;
+                return std::vector{
+                    image_plane(p1,
+                                2,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                2,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "UV",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::i420:
+            //  YUV 4:2:0   8       1:1:1   w1xh1:w1xh/2:w1xh/2     Y   U   V
+            {
+                auto ptr = data.get_plane_ptrs_3();
+                auto p1  = std::get<0>(ptr);
+                auto p2  = std::get<1>(ptr);
+                auto p3  = std::get<2>(ptr);
+                return std::vector{
+                    image_plane(p1,
+                                1,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                1,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint8_t>::format(),
+                                "U",
+                                owner),
+                    image_plane(p3,
+                                1,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint8_t>::format(),
+                                "V",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::yv12:
+            //  YUV 4:2:0   8       1:1:1   w1xh1:w1xh/2:w1xh/2     Y   V   U
+            {
+                auto ptr = data.get_plane_ptrs_3();
+                auto p1  = std::get<0>(ptr);
+                auto p2  = std::get<1>(ptr);
+                auto p3  = std::get<2>(ptr);
+                return std::vector{
+                    image_plane(p1,
+                                1,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint8_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                1,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint8_t>::format(),
+                                "U",
+                                owner),
+                    image_plane(p3,
+                                1,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint8_t>::format(),
+                                "V",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::i010:
+            //  YUV 4:2:0   10      2:2:2   w2xh1:w1xh/2:w1xh/2     Y   U   V
+            {
+                auto ptr = data.get_plane_ptrs_3();
+                auto p1  = std::get<0>(ptr);
+                auto p2  = std::get<1>(ptr);
+                auto p3  = std::get<2>(ptr);
+                return std::vector{
+                    image_plane(p1,
+                                2,
+                                width,
+                                height,
+                                1,
+                                pitch,
+                                py::format_descriptor<uint16_t>::format(),
+                                "Y",
+                                owner),
+                    image_plane(p2,
+                                2,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint16_t>::format(),
+                                "U",
+                                owner),
+                    image_plane(p3,
+                                2,
+                                width / 2,
+                                height / 2,
+                                1,
+                                pitch / 2,
+                                py::format_descriptor<uint16_t>::format(),
+                                "V",
+                                owner)
+                };
+            }
+        case vpl::color_format_fourcc::rgb465:
+        case vpl::color_format_fourcc::rgbp:
+        case vpl::color_format_fourcc::rgb3:
+        case vpl::color_format_fourcc::p8:
+        case vpl::color_format_fourcc::p8_texture:
+        case vpl::color_format_fourcc::argb16:
+        case vpl::color_format_fourcc::abgr16:
+        case vpl::color_format_fourcc::r16:
+        case vpl::color_format_fourcc::ayuv_rgb4:
+        case vpl::color_format_fourcc::nv21:
+        case vpl::color_format_fourcc::bgrp:
+            throw std::range_error("Format not known");
     }
-
-private:
-    void *base;
-    py::ssize_t item_size;
-    py::ssize_t rows;
-    py::ssize_t cols;
-    py::ssize_t row_pitch;
-    py::ssize_t sample_pitch;
-    std::string format;
-    std::string desc;
-};
+    throw std::range_error("Format not known");
+}
 
 void init_video_param(const py::module &m) {
     py::class_<image_plane>(m, "image_plane", py::buffer_protocol())
@@ -128,392 +505,7 @@ void init_video_param(const py::module &m) {
         .def(
             "get_planes",
             [](vpl::frame_data *self, vpl::frame_info &info) {
-                auto size   = info.get_frame_size();
-                auto pitch  = self->get_pitch();
-                auto width  = size.first;
-                auto height = size.second;
-                switch (info.get_FourCC()) {
-                    case vpl::color_format_fourcc::yuy2:
-                        //  YUV 4:2:2   8       2   w2xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 2,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "YUYV") };
-                        }
-                    case vpl::color_format_fourcc::uyvy:
-                        //  YUV 4:2:2   8       2   w2xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 2,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "UYVY") };
-                        }
-                    case vpl::color_format_fourcc::bgra:
-                        //  RGB 4:4:4   8       4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "BGRA") };
-                        }
-                    case vpl::color_format_fourcc::bgr4:
-                        //  RGB 4:4:4   8       4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "BGRA") };
-                        }
-                    case vpl::color_format_fourcc::ayuv:
-                        //  YUV 4:4:4   8       4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "AYUV") };
-                        }
-                    case vpl::color_format_fourcc::y210:
-                        //  YUV 4:2:2   10      4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                2,
-                                width * 2,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint16_t>::format(),
-                                "YUYV") };
-                        }
-                    case vpl::color_format_fourcc::y216:
-                        //  YUV 4:2:2   16      4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                2,
-                                width * 2,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint16_t>::format(),
-                                "YUYV") };
-                        }
-                    case vpl::color_format_fourcc::y410:
-                        //  YUV 4:4:4   10      4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint16_t>::format(),
-                                "A:2 VYU:10") };
-                        }
-                    case vpl::color_format_fourcc::a2rgb10:
-                        //  RGB 4:4:4   10:2    4   w4xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                1,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint8_t>::format(),
-                                "A:2 RGB:10") };
-                        }
-                    case vpl::color_format_fourcc::y416:
-                        //  YUV 4:4:4   16      8   w8xh1
-                        {
-                            auto ptr = self->get_plane_ptrs_1();
-                            return std::vector{ image_plane(
-                                ptr,
-                                2,
-                                width * 4,
-                                height,
-                                1,
-                                pitch,
-                                py::format_descriptor<uint16_t>::format(),
-                                "AVYU") };
-                        }
-                    case vpl::color_format_fourcc::nv12:
-                        //  YUV 4:2:0   8       1:1 w1xh1:w1xh/2    Y   UV
-                        {
-                            auto ptr = self->get_plane_ptrs_2();
-                            auto p1  = ptr.first;
-                            auto p2  = ptr.second;
-                            return std::vector{
-                                image_plane(p1,
-                                            1,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            1,
-                                            width,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "UV")
-                            };
-                        }
-                    case vpl::color_format_fourcc::p010:
-                        //  YUV 4:2:0   10      2:2 w2xh1:w2xh/2    Y   UV
-                        {
-                            auto ptr = self->get_plane_ptrs_2();
-                            auto p1  = ptr.first;
-                            auto p2  = ptr.second;
-                            return std::vector{
-                                image_plane(p1,
-                                            2,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            2,
-                                            width,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "UV")
-                            };
-                        }
-                    case vpl::color_format_fourcc::p016:
-                        //  YUV 4:2:0   16      2:2 w2xh1:w2xh/2    Y   UV
-                        {
-                            auto ptr = self->get_plane_ptrs_2();
-                            auto p1  = ptr.first;
-                            auto p2  = ptr.second;
-                            return std::vector{
-                                image_plane(p1,
-                                            2,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            2,
-                                            width,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "UV")
-                            };
-                        }
-                    case vpl::color_format_fourcc::nv16:
-                        //  YUV 4:2:2   8       1:1 w1xh1:w1xh1     Y   UV
-                        {
-                            auto ptr = self->get_plane_ptrs_2();
-                            auto p1  = ptr.first;
-                            auto p2  = ptr.second;
-                            return std::vector{
-                                image_plane(p1,
-                                            1,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            1,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "UV")
-                            };
-                        }
-                    case vpl::color_format_fourcc::p210:
-                        //  YUV 4:2:2   10      2:2 w2xh1:w2xh1     Y   UV
-                        {
-                            auto ptr = self->get_plane_ptrs_2();
-                            auto p1  = ptr.first;
-                            auto p2  = ptr.second;
-                            return std::vector{
-                                image_plane(p1,
-                                            2,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            2,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "UV")
-                            };
-                        }
-                    case vpl::color_format_fourcc::i420:
-                        //  YUV 4:2:0   8       1:1:1   w1xh1:w1xh/2:w1xh/2     Y   U   V
-                        {
-                            auto ptr = self->get_plane_ptrs_3();
-                            auto p1  = std::get<0>(ptr);
-                            auto p2  = std::get<1>(ptr);
-                            auto p3  = std::get<2>(ptr);
-                            return std::vector{
-                                image_plane(p1,
-                                            1,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            1,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "U"),
-                                image_plane(p3,
-                                            1,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "V")
-                            };
-                        }
-                    case vpl::color_format_fourcc::yv12:
-                        //  YUV 4:2:0   8       1:1:1   w1xh1:w1xh/2:w1xh/2     Y   V   U
-                        {
-                            auto ptr = self->get_plane_ptrs_3();
-                            auto p1  = std::get<0>(ptr);
-                            auto p2  = std::get<1>(ptr);
-                            auto p3  = std::get<2>(ptr);
-                            return std::vector{
-                                image_plane(p1,
-                                            1,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            1,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "U"),
-                                image_plane(p3,
-                                            1,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint8_t>::format(),
-                                            "V")
-                            };
-                        }
-                    case vpl::color_format_fourcc::i010:
-                        //  YUV 4:2:0   10      2:2:2   w2xh1:w1xh/2:w1xh/2     Y   U   V
-                        {
-                            auto ptr = self->get_plane_ptrs_3();
-                            auto p1  = std::get<0>(ptr);
-                            auto p2  = std::get<1>(ptr);
-                            auto p3  = std::get<2>(ptr);
-                            return std::vector{
-                                image_plane(p1,
-                                            2,
-                                            width,
-                                            height,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "Y"),
-                                image_plane(p2,
-                                            2,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "U"),
-                                image_plane(p3,
-                                            2,
-                                            width / 2,
-                                            height / 2,
-                                            1,
-                                            pitch,
-                                            py::format_descriptor<uint16_t>::format(),
-                                            "V")
-                            };
-                        }
-                    case vpl::color_format_fourcc::rgb465:
-                    case vpl::color_format_fourcc::rgbp:
-                    case vpl::color_format_fourcc::rgb3:
-                    case vpl::color_format_fourcc::p8:
-                    case vpl::color_format_fourcc::p8_texture:
-                    case vpl::color_format_fourcc::argb16:
-                    case vpl::color_format_fourcc::abgr16:
-                    case vpl::color_format_fourcc::r16:
-                    case vpl::color_format_fourcc::ayuv_rgb4:
-                    case vpl::color_format_fourcc::nv21:
-                    case vpl::color_format_fourcc::bgrp:
-                        throw std::range_error("Format not known");
-                }
-                throw std::range_error("Format not known");
+                return get_image_planes(*self, info);
             },
             "Get Planes");
 
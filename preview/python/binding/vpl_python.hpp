@@ -5,6 +5,12 @@
 //==============================================================================
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <pybind11/chrono.h>
 #include <pybind11/functional.h>
 #include <pybind11/numpy.h>
@@ -13,8 +19,87 @@
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include "vpl/preview/defs.hpp"
+#include "vpl/preview/video_param.hpp"
+
 namespace py = pybind11;
 
+/// @brief Zero-copy view of the single image plane. Exposed to Python through the buffer protocol, so it can be
+/// wrapped by memoryview or NumPy array without copy. Optional owner keeps the underlying memory alive (and mapped)
+/// while the view exists.
+class image_plane {
+public:
+    image_plane(void *base,
+                py::ssize_t item_size,
+                py::ssize_t cols,
+                py::ssize_t rows,
+                py::ssize_t sample_pitch,
+                py::ssize_t row_pitch,
+                std::string format,
+                std::string desc,
+                std::shared_ptr<void> owner = nullptr)
+            : base(base),
+              item_size(item_size),
+              rows(rows),
+              cols(cols),
+              row_pitch(row_pitch),
+              sample_pitch(sample_pitch),
+              format(format),
+              desc(desc),
+              owner(owner) {}
+
+    /// @brief Describes plane as 2D row-major array. Row stride is the plane's pitch in bytes, sample stride is
+    /// given in items.
+    py::buffer_info buffer_info() {
+        return py::buffer_info(base,
+                               item_size,
+                               format,
+                               2,
+                               { rows, cols },
+                               { row_pitch, sample_pitch * item_size });
+    }
+
+    std::string get_desc() {
+        return desc;
+    }
+
+private:
+    void *base;
+    py::ssize_t item_size;
+    py::ssize_t rows;
+    py::ssize_t cols;
+    py::ssize_t row_pitch;
+    py::ssize_t sample_pitch;
+    std::string format;
+    std::string desc;
+    std::shared_ptr<void> owner;
+};
+
+/// @brief Builds views of all planes of the frame.
+/// @param[in] data Frame data with the plane pointers.
+/// @param[in] info Frame info with the color format and frame size.
+/// @param[in] owner Object to keep alive while the views exist.
+/// @return List of the planes.
+std::vector<image_plane> get_image_planes(const oneapi::vpl::frame_data &data,
+                                          const oneapi::vpl::frame_info &info,
+                                          std::shared_ptr<void> owner = nullptr);
+
+/// @brief Schedules waiting for the native asynchronous operation on the completion workers. Worker resolves
+/// returned asyncio future in the context of the running event loop once operation is completed, so the caller's
+/// thread is never blocked. Must be called with GIL held and from the thread with running event loop.
+/// @param[in] wait_for Function which waits for the operation completion for the given time.
+/// @param[in] result Function which converts operation status into the future's result. Called with GIL held.
+/// Exceptions thrown by the function are forwarded to the future.
+/// @return asyncio future.
+py::object schedule_completion(
+    std::function<oneapi::vpl::async_op_status(std::chrono::milliseconds)> wait_for,
+    std::function<py::object(oneapi::vpl::async_op_status)> result);
+
+/// @brief Creates asyncio future in the running event loop which is already completed with the exception.
+/// @param[in] exception Exception object.
+/// @return asyncio future.
+py::object make_failed_future(py::object exception);
+
 #ifdef __linux__
     #define strncpy_s(dst, size, src, cnt) strncpy((dst), (src), cnt) // NOLINT
 #endif
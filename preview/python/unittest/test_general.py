@@ -8,8 +8,10 @@
 Test basic use cases
 """
 import unittest
+import asyncio
 import os
 import math
+import threading
 import pyvpl
 
 # Folder this script is in
@@ -71,6 +73,114 @@ class TestUseCases(unittest.TestCase):
                     frame = None
         self.assertEqual(frame_count, 60)
 
+    def test_decode_threads(self):
+        """Test Decode in parallel threads with zero-copy plane views"""
+        frame_counts = [0, 0]
+
+        def decode(index):
+            with pyvpl.bitstream_file_reader_name(HEVC_CLIP) as source:
+                opts = []
+                opts.append(
+                    pyvpl.property("mfxImplDescription.Impl",
+                                   pyvpl.implementation.software))
+                sel_default = pyvpl.default_selector(opts)
+
+                params = pyvpl.decoder_video_param()
+                params.IOPattern = pyvpl.io_pattern.out_system_memory
+                params.CodecId = pyvpl.codec_format_fourcc.hevc
+                decoder = pyvpl.decode_session(sel_default, params, source)
+                init_header_list = pyvpl.decoder_init_header_list()
+                init_reset_list = pyvpl.decoder_init_reset_list()
+                decoder.init_by_header(init_header_list, init_reset_list)
+
+                for frame in decoder:
+                    # Surface stays mapped while views are alive
+                    planes = [
+                        memoryview(plane)
+                        for plane in frame.planes(pyvpl.memory_access.read)
+                    ]
+                    self.assertEqual(len(planes), 3)
+                    self.assertEqual(planes[0].shape, (96, 128))
+                    self.assertEqual(planes[1].shape, (48, 64))
+                    self.assertEqual(planes[2].shape, (48, 64))
+                    frame_counts[index] += 1
+                    planes = None
+                    frame = None
+
+        threads = [
+            threading.Thread(target=decode, args=(index, ))
+            for index in range(len(frame_counts))
+        ]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual(frame_counts, [60, 60])
+
+    def test_surface_buffer(self):
+        """Test buffer protocol of the surface"""
+        with pyvpl.bitstream_file_reader_name(HEVC_CLIP) as source:
+            opts = []
+            opts.append(
+                pyvpl.property("mfxImplDescription.Impl",
+                               pyvpl.implementation.software))
+            sel_default = pyvpl.default_selector(opts)
+
+            params = pyvpl.decoder_video_param()
+            params.IOPattern = pyvpl.io_pattern.out_system_memory
+            params.CodecId = pyvpl.codec_format_fourcc.hevc
+            decoder = pyvpl.decode_session(sel_default, params, source)
+            init_header_list = pyvpl.decoder_init_header_list()
+            init_reset_list = pyvpl.decoder_init_reset_list()
+            decoder.init_by_header(init_header_list, init_reset_list)
+
+            frame = next(iter(decoder))
+            # Data of the unmapped surface is not accessible
+            with self.assertRaises(BufferError):
+                memoryview(frame)
+            info, _ = frame.map(pyvpl.memory_access.read)
+            try:
+                if info.FourCC == pyvpl.color_format_fourcc.nv12:
+                    self.assertEqual(memoryview(frame).shape, (144, 128))
+                else:
+                    # Planes of I420 have different widths
+                    with self.assertRaises(BufferError):
+                        memoryview(frame)
+            finally:
+                frame.unmap()
+            with self.assertRaises(BufferError):
+                memoryview(frame)
+            frame = None
+
+    def test_decode_async(self):
+        """Test Decode of several streams from single event loop"""
+        async def decode():
+            frame_count = 0
+            with pyvpl.bitstream_file_reader_name(HEVC_CLIP) as source:
+                opts = []
+                opts.append(
+                    pyvpl.property("mfxImplDescription.Impl",
+                                   pyvpl.implementation.software))
+                sel_default = pyvpl.default_selector(opts)
+
+                params = pyvpl.decoder_video_param()
+                params.IOPattern = pyvpl.io_pattern.out_system_memory
+                params.CodecId = pyvpl.codec_format_fourcc.hevc
+                decoder = pyvpl.decode_session(sel_default, params, source)
+                init_header_list = pyvpl.decoder_init_header_list()
+                init_reset_list = pyvpl.decoder_init_reset_list()
+                decoder.init_by_header(init_header_list, init_reset_list)
+
+                async for frame in decoder:
+                    frame_count += 1
+                    frame = None
+            return frame_count
+
+        async def decode_all():
+            return await asyncio.gather(decode(), decode(), decode())
+
+        self.assertEqual(asyncio.run(decode_all()), [60, 60, 60])
+
     def test_encode(self):
         """Test Encode"""
         frame_count = 0
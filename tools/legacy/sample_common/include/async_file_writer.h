@@ -0,0 +1,114 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __ASYNC_FILE_WRITER_H__
+#define __ASYNC_FILE_WRITER_H__
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+#include "vm/strings_defs.h"
+
+// Writes data to the file from the dedicated I/O thread, so slow storage doesn't
+// stall the pipeline thread. Data is copied to the fixed size chunks, so caller's
+// buffer may be reused right after Write() returns. Queued chunks are written in
+// batches with a single writev(). Memory is bounded by the number of chunks:
+// Write() blocks when all of them are queued.
+// With direct I/O every chunk is written at an aligned file offset. The unaligned
+// tail written by Flush() goes through the page cache and stays in the current
+// chunk, which is written again at the aligned offset once filled, so direct I/O
+// is kept for the rest of the file.
+class CAsyncFileWriter {
+public:
+    enum {
+        DEFAULT_CHUNK_SIZE  = 4 * 1024 * 1024,
+        DEFAULT_CHUNK_COUNT = 8,
+        // Alignment of the buffers, sizes and offsets for the direct I/O
+        DIRECT_IO_ALIGNMENT = 4096
+    };
+
+    CAsyncFileWriter();
+    virtual ~CAsyncFileWriter();
+
+    // Opens the file. With directIO set the page cache is bypassed (O_DIRECT),
+    // writer falls back to the buffered I/O if file system doesn't support it.
+    // chunkSize is rounded up to the DIRECT_IO_ALIGNMENT, at least 2 chunks are used.
+    virtual mfxStatus Open(const msdk_char* strFileName,
+                           bool directIO      = false,
+                           mfxU32 chunkSize   = DEFAULT_CHUNK_SIZE,
+                           mfxU32 chunkCount  = DEFAULT_CHUNK_COUNT);
+    // Queues data for writing. Returns error if previous write failed.
+    virtual mfxStatus Write(const void* data, size_t size);
+    // Waits until all queued data reaches the file.
+    virtual mfxStatus Flush();
+    // Flushes queued data and overwrites 'size' bytes at the given file offset.
+    virtual mfxStatus WriteAt(mfxU64 offset, const void* data, size_t size);
+    // Flushes queued data, stops I/O thread and closes the file.
+    virtual mfxStatus Close();
+
+    bool IsOpen() const {
+        return m_bOpened;
+    }
+    // True while the file is written bypassing the page cache
+    bool IsDirectIO() const {
+        return m_bDirectIO;
+    }
+
+protected:
+    struct Chunk {
+        mfxU8* data;
+        size_t size;
+    };
+
+    void IOThreadRoutine();
+    // Writes chunks at m_offset. With direct I/O the unaligned tail of the last chunk
+    // is written through the page cache, its size is returned in tailSize and the
+    // tail isn't accounted in m_offset.
+    mfxStatus WriteChunks(std::vector<Chunk*>& chunks, size_t& tailSize);
+    mfxStatus SetDirectIO(bool enable);
+    // Takes free chunk, blocks if all chunks are in the queue. Called under the lock.
+    Chunk* GetFreeChunk(std::unique_lock<std::mutex>& lock);
+    void FreeChunks();
+
+#if defined(_WIN32) || defined(_WIN64)
+    FILE* m_file;
+#else
+    int m_fd;
+#endif
+    bool m_bOpened;
+    bool m_bUseDirectIO; // direct I/O is requested and supported by the file system
+    std::atomic<bool> m_bDirectIO; // O_DIRECT is set on the file, cleared around the tails
+    mfxU64 m_offset; // file offset of the next chunk written by the I/O thread
+
+    size_t m_chunkSize;
+    size_t m_chunkCount;
+    std::vector<Chunk*> m_chunks; // all allocated chunks
+    std::vector<Chunk*> m_free; // chunks available for filling
+    std::deque<Chunk*> m_queue; // chunks waiting for the I/O thread
+    Chunk* m_current; // chunk being filled by the caller
+    size_t m_written; // bytes of the current chunk already in the file, the flushed tail
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueCond; // signals I/O thread about new data or stop
+    std::condition_variable m_freeCond; // signals caller about free chunk or idle I/O thread
+    std::thread m_thread;
+    bool m_bStop;
+    bool m_bWriting; // I/O thread holds chunks out of the queue
+    mfxStatus m_sts; // first error of the I/O thread
+
+private:
+    CAsyncFileWriter(const CAsyncFileWriter&);
+    void operator=(const CAsyncFileWriter&);
+};
+
+#endif //__ASYNC_FILE_WRITER_H__
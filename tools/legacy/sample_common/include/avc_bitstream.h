@@ -9,6 +9,7 @@
 
 #include "avc_headers.h"
 #include "avc_structures.h"
+#include "hevc_structures.h"
 #include "vpl/mfxstructures.h"
 
 namespace ProtectedLibrary {
@@ -27,6 +28,11 @@ namespace ProtectedLibrary {
 // NAL unit definitions
 enum { NAL_STORAGE_IDC_BITS = 0x60, NAL_UNITTYPE_BITS = 0x1f };
 
+// Lazy mode parses only the fields needed to find access unit boundaries: parameter
+// sets stop before VUI, slice headers stop before reference lists. It is enough for
+// splitting the stream into frames, but not for locating the slice data.
+enum HeaderParseMode { PARSE_HEADERS_FULL = 0, PARSE_HEADERS_LAZY };
+
 class AVCBaseBitstream {
 public:
     AVCBaseBitstream();
@@ -38,6 +44,7 @@ public:
     void Reset(mfxU8* const pb, mfxI32 offset, mfxU32 maxsize);
 
     inline mfxU32 GetBits(mfxU32 nbits);
+    inline void SkipBits(mfxU32 nbits);
 
     // Read one VLC mfxI32 or mfxU32 value from bitstream
     mfxI32 GetVLCElement(bool bIsSigned);
@@ -58,6 +65,10 @@ public:
     void AlignPointerRight(void);
 
 protected:
+    // Returns the next 33 to 64 bits of the stream aligned to the most significant bit.
+    // Buffer is read by dwords, so it has to have 8 bytes of padding after the data.
+    inline mfxU64 PeekWindow() const;
+
     mfxU32* m_pbs; // pointer to the current position of the buffer.
     mfxI32 m_bitOffset; // the bit position (0 to 31) in the dword pointed by m_pbs.
     mfxU32* m_pbsBase; // pointer to the first byte of the buffer.
@@ -70,7 +81,7 @@ public:
     AVCHeadersBitstream(mfxU8* const pb, const mfxU32 maxsize);
 
     // Decode sequence parameter set
-    mfxStatus GetSequenceParamSet(AVCSeqParamSet* sps);
+    mfxStatus GetSequenceParamSet(AVCSeqParamSet* sps, HeaderParseMode mode = PARSE_HEADERS_FULL);
     // Decode sequence parameter set extension
     mfxStatus GetSequenceParamSetExtension(AVCSeqParamSetExtension* sps_ex);
 
@@ -118,6 +129,33 @@ private:
     mfxStatus GetHRDParam(AVCSeqParamSet* sps);
 };
 
+// Parses HEVC parameter sets and the beginning of the slice segment header. Input is
+// prepared the same way as for AVC (see BytesSwapper::SwapMemory).
+class HEVCHeadersBitstream : public AVCBaseBitstream {
+public:
+    HEVCHeadersBitstream();
+    HEVCHeadersBitstream(mfxU8* const pb, const mfxU32 maxsize);
+
+    mfxStatus GetNALUnitHeader(HEVC_NAL_Unit_Type& uNALUnitType,
+                               mfxU8& uLayerId,
+                               mfxU8& uTemporalId);
+
+    mfxStatus GetVideoParamSet(HEVCVideoParamSet* vps);
+    mfxStatus GetSequenceParamSet(HEVCSeqParamSet* sps, HeaderParseMode mode = PARSE_HEADERS_FULL);
+    mfxStatus GetPictureParamSet(HEVCPicParamSet* pps, HeaderParseMode mode = PARSE_HEADERS_FULL);
+
+    // nal_unit_type of the header has to be set
+    mfxStatus GetSliceHeaderPart1(HEVCSliceHeader* hdr);
+    mfxStatus GetSliceHeaderPart2(HEVCSliceHeader* hdr,
+                                  const HEVCPicParamSet* pps,
+                                  const HEVCSeqParamSet* sps);
+
+private:
+    void GetProfileTierLevel(HEVCProfileTierLevel* ptl, mfxU32 maxSubLayersMinus1);
+    void SkipScalingListData();
+    mfxStatus GetShortTermRefPicSet(HEVCSeqParamSet* sps, mfxU32 idx);
+};
+
 void SetDefaultScalingLists(AVCSeqParamSet* sps);
 
 extern const mfxU32 bits_data[];
@@ -174,10 +212,24 @@ extern const mfxU32 bits_data[];
 #define avcGetNBits(current_data, offset, nbits, data) \
     _avcGetBits(current_data, offset, nbits, data);
 
-inline mfxU32 AVCBaseBitstream::GetBits(mfxU32 nbits) {
-    mfxU32 w, n = nbits;
+inline mfxU64 AVCBaseBitstream::PeekWindow() const {
+    mfxU64 w = ((mfxU64)m_pbs[0] << 32) | m_pbs[1];
+    return w << (31 - m_bitOffset);
+}
 
-    avcGetNBits(m_pbs, m_bitOffset, n, w);
+inline void AVCBaseBitstream::SkipBits(mfxU32 nbits) {
+    SAMPLE_ASSERT(nbits <= 32);
+    mfxI32 offset = m_bitOffset - (mfxI32)nbits;
+    // Move to the next dword if offset went below zero
+    m_pbs += (mfxU32)offset >> 31;
+    m_bitOffset = offset & 31;
+}
+
+inline mfxU32 AVCBaseBitstream::GetBits(mfxU32 nbits) {
+    SAMPLE_ASSERT(nbits <= 32);
+    // Two shifts keep nbits == 0 defined
+    mfxU32 w = (mfxU32)((PeekWindow() >> 1) >> (63 - nbits));
+    SkipBits(nbits);
     return w;
 }
 
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include "avc_structures.h"
+#include "hevc_structures.h"
 
 namespace ProtectedLibrary {
 
@@ -117,6 +118,19 @@ public:
     AVCNalExtension m_nalExtension;
 };
 
+class HEVCHeaders {
+public:
+    void Reset() {
+        m_VideoParams.Reset();
+        m_SeqParams.Reset();
+        m_PicParams.Reset();
+    }
+
+    HeaderSet<HEVCVideoParamSet> m_VideoParams;
+    HeaderSet<HEVCSeqParamSet> m_SeqParams;
+    HeaderSet<HEVCPicParamSet> m_PicParams;
+};
+
 } //namespace ProtectedLibrary
 
 #endif // __AVC_HEADERS_H
@@ -29,9 +29,13 @@ public:
         return m_sliceHeader.field_pic_flag != 0;
     }
 
+    // Parses the first part of the slice header, DecodeHeader() continues from there
+    // if it is called with the same data
     mfxI32 RetrievePicParamSetNumber(mfxU8* pSource, mfxU32 nSourceSize);
 
-    bool DecodeHeader(mfxU8* pSource, mfxU32 nSourceSize);
+    bool DecodeHeader(mfxU8* pSource,
+                      mfxU32 nSourceSize,
+                      HeaderParseMode mode = PARSE_HEADERS_FULL);
 
     AVCHeadersBitstream* GetBitStream(void) {
         return &m_bitStream;
@@ -47,6 +51,7 @@ public:
 protected:
     AVCSliceHeader m_sliceHeader;
     AVCHeadersBitstream m_bitStream;
+    mfxU8* m_pPart1Source; // data the first part of the header was parsed from
 
     void Reset();
 };
@@ -75,6 +80,11 @@ public:
 
     void ResetCurrentState();
 
+    // Lazy mode is enough if only frame data is used, slice header lengths are 0 then
+    void SetParseMode(HeaderParseMode mode) {
+        m_parseMode = mode;
+    }
+
 protected:
     std::unique_ptr<NALUnitSplitter> m_pNALSplitter;
 
@@ -100,6 +110,7 @@ protected:
                            const AVCSliceHeader* slice2);
 
     bool m_WaitForIDR;
+    HeaderParseMode m_parseMode;
 
     AVCHeaders m_headers;
     std::unique_ptr<AVCFrameInfo> m_AUInfo;
@@ -0,0 +1,49 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __BITSTREAM_POOL_H__
+#define __BITSTREAM_POOL_H__
+
+#include <mutex>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+// Storage of bitstream buffers shared by the sessions. Buffers are kept in the size
+// classes of powers of two, a buffer of the class large enough for the request is
+// reused instead of being allocated, so the encoders which keep growing their buffers
+// don't leave the smaller ones to the heap. All methods are thread-safe.
+class CBitstreamBufferPool {
+public:
+    enum {
+        MIN_CLASS_SIZE   = 1 << 16,
+        NUM_CLASSES      = 16, // up to 2 GB
+        MAX_FREE_BUFFERS = 32 // of a class, the rest is freed
+    };
+
+    CBitstreamBufferPool();
+
+    // Returns a buffer of at least size bytes
+    std::vector<mfxU8> Acquire(mfxU32 size);
+    // Keeps the buffer for the next Acquire() if it's of one of the classes
+    void Release(std::vector<mfxU8>&& buffer);
+
+    // Size of the class the buffer of size bytes belongs to
+    static mfxU32 GetClassSize(mfxU32 size);
+
+protected:
+    // Returns NUM_CLASSES if the size is too big
+    static mfxU32 GetClassIndex(mfxU32 size);
+
+    std::mutex m_mutex;
+    std::vector<std::vector<mfxU8>> m_free[NUM_CLASSES];
+
+private:
+    CBitstreamBufferPool(const CBitstreamBufferPool&);
+    void operator=(const CBitstreamBufferPool&);
+};
+
+#endif //__BITSTREAM_POOL_H__
@@ -0,0 +1,55 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __FRAME_KERNELS_H__
+#define __FRAME_KERNELS_H__
+
+#include "vpl/mfxdefs.h"
+
+// Instruction set of the raw frame kernels
+enum FrameKernelsIsa {
+    FRAME_KERNELS_SCALAR = 0,
+    FRAME_KERNELS_SSE2,
+    FRAME_KERNELS_AVX2,
+    FRAME_KERNELS_AVX512
+};
+
+// Row kernels used to move raw frames between files and surfaces.
+// All kernels accept unaligned pointers and any width.
+// Packed formats (YUY2, AYUV, Y210, Y216, Y410, Y416) have the same layout in files and
+// surfaces, so they need no repack kernels: their rows are copied, and the MS-bit shifts
+// of Y210, Y216 and Y416 use ShiftLeft16 and ShiftRight16.
+struct FrameKernels {
+    FrameKernelsIsa isa;
+
+    // u[0..w) and v[0..w) -> uv[0..2w)
+    void (*InterleaveUV)(const mfxU8* u, const mfxU8* v, mfxU8* uv, mfxU32 w);
+    // uv[0..2w) -> u[0..w) and v[0..w)
+    void (*DeinterleaveUV)(const mfxU8* uv, mfxU8* u, mfxU8* v, mfxU32 w);
+    // dst[i] = src[i] << shift, src may be equal to dst
+    void (*ShiftLeft16)(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift);
+    // dst[i] = src[i] >> shift, src may be equal to dst
+    void (*ShiftRight16)(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift);
+};
+
+// Returns kernels for the best instruction set supported by the CPU.
+// Selection is done once, SAMPLE_FRAME_KERNELS environment variable
+// (scalar, sse2, avx2, avx512) may be used to cap the instruction set.
+const FrameKernels& GetFrameKernels();
+
+// Returns kernels for the given instruction set or NULL if it is not supported
+// by the CPU or by the build.
+const FrameKernels* GetFrameKernels(FrameKernelsIsa isa);
+
+// Copies plane of 'rowBytes' x 'height' bytes between buffers with different pitches.
+void CopyPlane(const mfxU8* src,
+               mfxU32 srcPitch,
+               mfxU8* dst,
+               mfxU32 dstPitch,
+               mfxU32 rowBytes,
+               mfxU32 height);
+
+#endif //__FRAME_KERNELS_H__
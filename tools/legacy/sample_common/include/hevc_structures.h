@@ -0,0 +1,268 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __HEVC_STRUCTURES_H__
+#define __HEVC_STRUCTURES_H__
+
+#include "avc_structures.h"
+
+namespace ProtectedLibrary {
+
+enum {
+    HEVC_MAX_NUM_VPS           = 16,
+    HEVC_MAX_NUM_SPS           = 16,
+    HEVC_MAX_NUM_PPS           = 64,
+    HEVC_MAX_SUB_LAYERS        = 7,
+    HEVC_MAX_SHORT_TERM_RPS    = 64,
+    HEVC_MAX_LONG_TERM_REF_SPS = 32,
+    HEVC_MAX_DPB_SIZE          = 16,
+    HEVC_MAX_TILE_COLUMNS      = 20,
+    HEVC_MAX_TILE_ROWS         = 22
+};
+
+enum HEVC_NAL_Unit_Type {
+    HEVC_NAL_UT_TRAIL_N    = 0,
+    HEVC_NAL_UT_TRAIL_R    = 1,
+    HEVC_NAL_UT_BLA_W_LP   = 16,
+    HEVC_NAL_UT_BLA_W_RADL = 17,
+    HEVC_NAL_UT_BLA_N_LP   = 18,
+    HEVC_NAL_UT_IDR_W_RADL = 19,
+    HEVC_NAL_UT_IDR_N_LP   = 20,
+    HEVC_NAL_UT_CRA        = 21,
+    HEVC_NAL_UT_IRAP_MAX   = 23,
+    HEVC_NAL_UT_VPS        = 32,
+    HEVC_NAL_UT_SPS        = 33,
+    HEVC_NAL_UT_PPS        = 34,
+    HEVC_NAL_UT_AUD        = 35,
+    HEVC_NAL_UT_EOS        = 36,
+    HEVC_NAL_UT_EOB        = 37,
+    HEVC_NAL_UT_FD         = 38,
+    HEVC_NAL_UT_PREFIX_SEI = 39,
+    HEVC_NAL_UT_SUFFIX_SEI = 40
+};
+
+#pragma pack(16)
+
+// General part of profile_tier_level(), sub-layer information is skipped
+struct HEVCProfileTierLevel {
+    mfxU8 general_profile_space;
+    mfxU8 general_tier_flag;
+    mfxU8 general_profile_idc;
+    mfxU32 general_profile_compatibility_flags;
+    mfxU8 general_progressive_source_flag;
+    mfxU8 general_interlaced_source_flag;
+    mfxU8 general_non_packed_constraint_flag;
+    mfxU8 general_frame_only_constraint_flag;
+    mfxU8 general_level_idc;
+};
+
+// Video parameter set structure, HRD parameters and extensions are not parsed
+struct HEVCVideoParamSetBase {
+    mfxU8 vps_video_parameter_set_id;
+    mfxU8 vps_base_layer_internal_flag;
+    mfxU8 vps_base_layer_available_flag;
+    mfxU8 vps_max_layers;
+    mfxU8 vps_max_sub_layers;
+    mfxU8 vps_temporal_id_nesting_flag;
+    HEVCProfileTierLevel profile_tier_level;
+    mfxU8 vps_sub_layer_ordering_info_present_flag;
+    mfxU32 vps_max_dec_pic_buffering[HEVC_MAX_SUB_LAYERS];
+    mfxU32 vps_max_num_reorder_pics[HEVC_MAX_SUB_LAYERS];
+    mfxU32 vps_max_latency_increase[HEVC_MAX_SUB_LAYERS];
+    mfxU8 vps_max_layer_id;
+    mfxU32 vps_num_layer_sets;
+    mfxU8 vps_timing_info_present_flag;
+    mfxU32 vps_num_units_in_tick;
+    mfxU32 vps_time_scale;
+    mfxU8 vps_poc_proportional_to_timing_flag;
+    mfxU32 vps_num_ticks_poc_diff_one;
+    mfxU32 vps_num_hrd_parameters;
+
+    void Reset() {
+        HEVCVideoParamSetBase vps = {};
+        *this                     = vps;
+    }
+};
+
+struct HEVCVideoParamSet : public HeapObject, public HEVCVideoParamSetBase {
+    HEVCVideoParamSet() : HeapObject(), HEVCVideoParamSetBase() {
+        Reset();
+    }
+
+    mfxI32 GetID() const {
+        return vps_video_parameter_set_id;
+    }
+
+    virtual void Reset() {
+        HEVCVideoParamSetBase::Reset();
+        vps_video_parameter_set_id = HEVC_MAX_NUM_VPS;
+    }
+};
+
+// Sequence parameter set structure, VUI and extensions are not parsed.
+// Lazy parsing stops after log2_max_pic_order_cnt_lsb.
+struct HEVCSeqParamSetBase {
+    mfxU8 sps_video_parameter_set_id;
+    mfxU8 sps_max_sub_layers;
+    mfxU8 sps_temporal_id_nesting_flag;
+    HEVCProfileTierLevel profile_tier_level;
+    mfxU8 sps_seq_parameter_set_id;
+    mfxU8 chroma_format_idc;
+    mfxU8 separate_colour_plane_flag;
+    mfxU32 pic_width_in_luma_samples;
+    mfxU32 pic_height_in_luma_samples;
+    mfxU8 conformance_window_flag;
+    mfxU32 conf_win_left_offset;
+    mfxU32 conf_win_right_offset;
+    mfxU32 conf_win_top_offset;
+    mfxU32 conf_win_bottom_offset;
+    mfxU8 bit_depth_luma;
+    mfxU8 bit_depth_chroma;
+    mfxU8 log2_max_pic_order_cnt_lsb;
+
+    mfxU8 sps_sub_layer_ordering_info_present_flag;
+    mfxU32 sps_max_dec_pic_buffering[HEVC_MAX_SUB_LAYERS];
+    mfxU32 sps_max_num_reorder_pics[HEVC_MAX_SUB_LAYERS];
+    mfxU32 sps_max_latency_increase[HEVC_MAX_SUB_LAYERS];
+    mfxU8 log2_min_luma_coding_block_size;
+    mfxU8 log2_diff_max_min_luma_coding_block_size;
+    mfxU8 log2_min_transform_block_size;
+    mfxU8 log2_diff_max_min_transform_block_size;
+    mfxU8 max_transform_hierarchy_depth_inter;
+    mfxU8 max_transform_hierarchy_depth_intra;
+    mfxU8 scaling_list_enabled_flag;
+    mfxU8 sps_scaling_list_data_present_flag;
+    mfxU8 amp_enabled_flag;
+    mfxU8 sample_adaptive_offset_enabled_flag;
+    mfxU8 pcm_enabled_flag;
+    mfxU8 pcm_sample_bit_depth_luma;
+    mfxU8 pcm_sample_bit_depth_chroma;
+    mfxU8 log2_min_pcm_luma_coding_block_size;
+    mfxU8 log2_diff_max_min_pcm_luma_coding_block_size;
+    mfxU8 pcm_loop_filter_disabled_flag;
+    mfxU8 num_short_term_ref_pic_sets;
+    mfxU8 long_term_ref_pics_present_flag;
+    mfxU8 num_long_term_ref_pics_sps;
+    mfxU8 sps_temporal_mvp_enabled_flag;
+    mfxU8 strong_intra_smoothing_enabled_flag;
+    mfxU8 vui_parameters_present_flag;
+
+    // These fields are calculated from values above
+    mfxU8 NumDeltaPocs[HEVC_MAX_SHORT_TERM_RPS];
+    mfxU32 PicSizeInCtbsY;
+
+    void Reset() {
+        HEVCSeqParamSetBase sps = {};
+        *this                   = sps;
+    }
+};
+
+struct HEVCSeqParamSet : public HeapObject, public HEVCSeqParamSetBase {
+    HEVCSeqParamSet() : HeapObject(), HEVCSeqParamSetBase() {
+        Reset();
+    }
+
+    mfxI32 GetID() const {
+        return sps_seq_parameter_set_id;
+    }
+
+    virtual void Reset() {
+        HEVCSeqParamSetBase::Reset();
+        sps_seq_parameter_set_id = HEVC_MAX_NUM_SPS;
+    }
+};
+
+// Picture parameter set structure, extensions are not parsed.
+// Lazy parsing stops after num_extra_slice_header_bits.
+struct HEVCPicParamSetBase {
+    mfxU8 pps_pic_parameter_set_id;
+    mfxU8 pps_seq_parameter_set_id;
+    mfxU8 dependent_slice_segments_enabled_flag;
+    mfxU8 output_flag_present_flag;
+    mfxU8 num_extra_slice_header_bits;
+
+    mfxU8 sign_data_hiding_enabled_flag;
+    mfxU8 cabac_init_present_flag;
+    mfxU8 num_ref_idx_l0_default_active;
+    mfxU8 num_ref_idx_l1_default_active;
+    mfxI8 init_qp;
+    mfxU8 constrained_intra_pred_flag;
+    mfxU8 transform_skip_enabled_flag;
+    mfxU8 cu_qp_delta_enabled_flag;
+    mfxU8 diff_cu_qp_delta_depth;
+    mfxI8 pps_cb_qp_offset;
+    mfxI8 pps_cr_qp_offset;
+    mfxU8 pps_slice_chroma_qp_offsets_present_flag;
+    mfxU8 weighted_pred_flag;
+    mfxU8 weighted_bipred_flag;
+    mfxU8 transquant_bypass_enabled_flag;
+    mfxU8 tiles_enabled_flag;
+    mfxU8 entropy_coding_sync_enabled_flag;
+    mfxU8 num_tile_columns;
+    mfxU8 num_tile_rows;
+    mfxU8 uniform_spacing_flag;
+    mfxU16 column_width[HEVC_MAX_TILE_COLUMNS];
+    mfxU16 row_height[HEVC_MAX_TILE_ROWS];
+    mfxU8 loop_filter_across_tiles_enabled_flag;
+    mfxU8 pps_loop_filter_across_slices_enabled_flag;
+    mfxU8 deblocking_filter_control_present_flag;
+    mfxU8 deblocking_filter_override_enabled_flag;
+    mfxU8 pps_deblocking_filter_disabled_flag;
+    mfxI8 pps_beta_offset_div2;
+    mfxI8 pps_tc_offset_div2;
+    mfxU8 pps_scaling_list_data_present_flag;
+    mfxU8 lists_modification_present_flag;
+    mfxU8 log2_parallel_merge_level;
+    mfxU8 slice_segment_header_extension_present_flag;
+    mfxU8 pps_extension_present_flag;
+
+    void Reset() {
+        HEVCPicParamSetBase pps = {};
+        *this                   = pps;
+    }
+};
+
+struct HEVCPicParamSet : public HeapObject, public HEVCPicParamSetBase {
+    HEVCPicParamSet() : HeapObject(), HEVCPicParamSetBase() {
+        Reset();
+    }
+
+    mfxI32 GetID() const {
+        return pps_pic_parameter_set_id;
+    }
+
+    virtual void Reset() {
+        HEVCPicParamSetBase::Reset();
+        pps_pic_parameter_set_id = HEVC_MAX_NUM_PPS;
+        pps_seq_parameter_set_id = HEVC_MAX_NUM_SPS;
+    }
+};
+
+// Beginning of the slice segment header, enough to detect picture boundaries
+struct HEVCSliceHeader {
+    mfxU8 nal_unit_type;
+    mfxU8 nuh_layer_id;
+    mfxU8 nuh_temporal_id;
+
+    // Part 1
+    mfxU8 first_slice_segment_in_pic_flag;
+    mfxU8 no_output_of_prior_pics_flag;
+    mfxU8 slice_pic_parameter_set_id;
+
+    // Part 2
+    mfxU8 dependent_slice_segment_flag;
+    mfxU32 slice_segment_address;
+    mfxU8 slice_type;
+    mfxU8 pic_output_flag;
+    mfxU8 colour_plane_id;
+    mfxU32 slice_pic_order_cnt_lsb;
+};
+
+#pragma pack()
+
+} // namespace ProtectedLibrary
+
+#endif // __HEVC_STRUCTURES_H__
@@ -0,0 +1,214 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __LOCKFREE_RING_H__
+#define __LOCKFREE_RING_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "vpl/mfxdefs.h"
+
+// Sleeping side of lock-free structures. Waiter announces itself before it checks
+// the condition, so Notify() takes the mutex only when somebody may sleep: a burst
+// of notifications without waiters costs an atomic load each and wakes nobody.
+class CWaitPoint {
+public:
+    CWaitPoint() : m_waiters(0), m_mutex(), m_cv() {}
+
+    // Waits until ready() returns true, returns false on timeout
+    template <class Pred>
+    bool WaitFor(Pred ready, mfxU32 msec) {
+        if (ready())
+            return true;
+
+        m_waiters.fetch_add(1);
+        bool result;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            result = m_cv.wait_for(lock, std::chrono::milliseconds(msec), ready);
+        }
+        m_waiters.fetch_sub(1);
+        return result;
+    }
+
+    // Has to be called after the change of the state ready() checks is visible
+    void Notify() {
+        if (!m_waiters.load())
+            return;
+        // the waiter can't miss the notification between its check and the wait
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_cv.notify_all();
+    }
+
+protected:
+    std::atomic<mfxU32> m_waiters;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+private:
+    CWaitPoint(const CWaitPoint&);
+    void operator=(const CWaitPoint&);
+};
+
+// Bounded ring passing items from one producer thread to consumers which take them
+// in order. Item stays in the ring after Front() until it's released, release may
+// be made by any thread and out of order: slots are freed when the oldest item is
+// released. Head and tail are 64-bit counters, they never wrap in practice, so the
+// compare-exchange of the head can't succeed on a stale value.
+// Every slot keeps the sequence of the item it holds, 2*i while item i is in the
+// ring and 2*i+1 once it's released. Readers may lag behind the head while Push()
+// reuses the slot for the item i+capacity, so the item is copied and the sequence
+// is checked again after the copy: the copy is used only if the slot still holds
+// item i, and release is a compare-exchange of the sequence of item i.
+template <class T>
+class CLockFreeRing {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "item may be copied while the producer overwrites it");
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit CLockFreeRing(mfxU32 capacity) : m_mask(0), m_slots(), m_head(0), m_tail(0) {
+        Reset(capacity);
+    }
+
+    // Drops all items and reallocates the slots, there must be no concurrent users
+    void Reset(mfxU32 capacity) {
+        mfxU32 size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_mask = size - 1;
+        m_slots.reset(new Slot[size]);
+        m_head.store(0);
+        m_tail.store(0);
+    }
+
+    mfxU32 GetCapacity() const {
+        return (mfxU32)(m_mask + 1);
+    }
+    // Number of items pushed and not freed yet
+    mfxU32 GetLength() const {
+        return (mfxU32)(m_tail.load() - m_head.load());
+    }
+    bool IsFull() const {
+        return GetLength() > m_mask;
+    }
+
+    // Producer only. Returns false if the ring is full.
+    bool Push(const T& item) {
+        mfxU64 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+            return false;
+
+        // readers of the previous item of the slot see it's being overwritten
+        Slot& slot = m_slots[tail & m_mask];
+        slot.seq.store(SLOT_BUSY, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.item = item;
+        slot.seq.store(2 * tail, std::memory_order_release);
+        m_tail.store(tail + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Copies the oldest item which isn't released, returns false if there is none
+    bool Front(T& item) const {
+        mfxU64 tail = m_tail.load(std::memory_order_acquire);
+        for (mfxU64 i = m_head.load(std::memory_order_acquire); i < tail; i++) {
+            if (Read(i, item))
+                return true;
+        }
+        return false;
+    }
+
+    // Releases the oldest item for which match(item) is true, returns false if
+    // there is no such item
+    template <class Pred>
+    bool Release(Pred match) {
+        bool released = false;
+        mfxU64 tail   = m_tail.load(std::memory_order_acquire);
+        for (mfxU64 i = m_head.load(std::memory_order_acquire); i < tail; i++) {
+            T item;
+            if (!Read(i, item) || !match(item))
+                continue;
+            // only one of the threads releasing the same item succeeds, and none
+            // if the slot was reused meanwhile
+            mfxU64 seq = 2 * i;
+            if (m_slots[i & m_mask].seq.compare_exchange_strong(seq,
+                                                                2 * i + 1,
+                                                                std::memory_order_acq_rel)) {
+                released = true;
+                break;
+            }
+        }
+        if (released)
+            AdvanceHead();
+        return released;
+    }
+
+    // Releases all items pushed so far, returns the number of items released by this
+    // call. Items are released as by Release(), so consumers may read and release
+    // them concurrently: each item is released by one thread only.
+    mfxU32 Clear() {
+        mfxU32 released = 0;
+        mfxU64 tail     = m_tail.load(std::memory_order_acquire);
+        for (mfxU64 i = m_head.load(std::memory_order_acquire); i < tail; i++) {
+            mfxU64 seq = 2 * i;
+            if (m_slots[i & m_mask].seq.compare_exchange_strong(seq,
+                                                                2 * i + 1,
+                                                                std::memory_order_acq_rel))
+                released++;
+        }
+        AdvanceHead();
+        return released;
+    }
+
+protected:
+    static const mfxU64 SLOT_BUSY = ~(mfxU64)0;
+
+    struct Slot {
+        Slot() : item(), seq(SLOT_BUSY) {}
+        T item;
+        std::atomic<mfxU64> seq;
+    };
+
+    // Copies item i if it's in the ring and not released
+    bool Read(mfxU64 i, T& item) const {
+        const Slot& slot = m_slots[i & m_mask];
+        if (slot.seq.load(std::memory_order_acquire) != 2 * i)
+            return false;
+        item = slot.item;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == 2 * i;
+    }
+
+    // Frees released slots at the head. Threads releasing items concurrently move
+    // the head together, each of them until it reaches an item not released yet.
+    void AdvanceHead() {
+        for (;;) {
+            mfxU64 head = m_head.load(std::memory_order_acquire);
+            if (head == m_tail.load(std::memory_order_acquire) ||
+                m_slots[head & m_mask].seq.load(std::memory_order_acquire) != 2 * head + 1)
+                return;
+            m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel);
+        }
+    }
+
+    mfxU64 m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+    // producer and consumers write different counters, keep them on their own lines
+    alignas(64) std::atomic<mfxU64> m_head;
+    alignas(64) std::atomic<mfxU64> m_tail;
+
+private:
+    CLockFreeRing(const CLockFreeRing&);
+    void operator=(const CLockFreeRing&);
+};
+
+#endif //__LOCKFREE_RING_H__
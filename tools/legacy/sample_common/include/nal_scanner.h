@@ -0,0 +1,62 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __NAL_SCANNER_H__
+#define __NAL_SCANNER_H__
+
+#include <stddef.h>
+
+#include "vpl/mfxdefs.h"
+
+// Returns pointer to the first 00 00 01 sequence fully inside [begin, end) or 'end'.
+// Uses the same instruction set as the frame kernels (see GetFrameKernels()).
+const mfxU8* FindAnnexBStartCode(const mfxU8* begin, const mfxU8* end);
+
+// Returns pointer to the first 00 00 03 (emulation prevention) sequence fully inside
+// [begin, end) or 'end'.
+const mfxU8* FindEmulationPrevention(const mfxU8* begin, const mfxU8* end);
+
+enum NalStreamType { NAL_STREAM_AVC = 0, NAL_STREAM_HEVC, NAL_STREAM_VVC };
+
+struct NalUnitInfo {
+    const mfxU8* data; // NAL unit header, start code is not included
+    mfxU32 size; // size of the NAL unit without start code and trailing zeros
+    mfxU32 startCodeSize; // 3 or 4 bytes
+    mfxU32 type; // nal_unit_type of the given stream type
+};
+
+// Iterates over NAL units of Annex-B H.264, HEVC or VVC elementary stream
+class CNalUnitIterator {
+public:
+    explicit CNalUnitIterator(NalStreamType type = NAL_STREAM_AVC);
+
+    // Sets data to iterate over. If data is not complete, the last NAL unit is not
+    // returned till the next start code, it is left in remainder.
+    void Init(const mfxU8* data, size_t size, bool complete = true);
+
+    // Returns false if there are no more NAL units
+    bool GetNext(NalUnitInfo& nal);
+
+    // Returns data not consumed by the iterator (starting from the start code of
+    // the incomplete NAL unit)
+    const mfxU8* GetRemainder() const {
+        return m_pCurrent;
+    }
+    size_t GetRemainderSize() const {
+        return (size_t)(m_pEnd - m_pCurrent);
+    }
+
+    static mfxU32 GetNalUnitType(NalStreamType type, const mfxU8* header, size_t size);
+
+protected:
+    NalStreamType m_type;
+    const mfxU8* m_pBegin;
+    const mfxU8* m_pCurrent; // start code of the next NAL unit
+    const mfxU8* m_pEnd;
+    bool m_bComplete;
+};
+
+#endif //__NAL_SCANNER_H__
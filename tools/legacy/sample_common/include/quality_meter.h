@@ -0,0 +1,112 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __QUALITY_METER_H__
+#define __QUALITY_METER_H__
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "vpl/mfxvideo++.h"
+
+#include "quality_metrics.h"
+#include "sample_utils.h"
+#include "time_statistics.h"
+#include "vpl_implementation_loader.h"
+
+// Measures quality of the encoder output in-process. Copies of the encoder input
+// frames are kept until the coded frames are decoded by an own decoder session,
+// decoded frames are compared with them in display order.
+class CEncodeQualityMeter {
+public:
+    CEncodeQualityMeter();
+    virtual ~CEncodeQualityMeter();
+
+    // Decoder session is created with the same implementation as pParentSession,
+    // it shares the device handle of the parent session if there is one.
+    virtual mfxStatus Init(VPLImplementationLoader* pLoader,
+                           MFXVideoSession* pParentSession,
+                           const mfxVideoParam& encParams,
+                           mfxU32 metrics,
+                           mfxU32 numThreads = 0);
+    virtual void Close();
+
+    bool IsInitialized() const {
+        return m_bInitialized;
+    }
+
+    // Queues the encoder input frame, it's copied once 'syncp' of pSession (the
+    // operation producing the frame, if any) is completed. The pipeline isn't
+    // waited for: the surface is kept locked until the copy, the copy is done
+    // by the next calls which find the operation completed. If the surface data
+    // isn't locked it's locked through pAllocator or mapped to copy it.
+    virtual mfxStatus AddReference(mfxFrameSurface1* pSurface,
+                                   mfxFrameAllocator* pAllocator = NULL,
+                                   MFXVideoSession* pSession     = NULL,
+                                   mfxSyncPoint syncp            = NULL);
+    // Decodes coded frame and compares the output with the kept input frames
+    virtual mfxStatus ProcessBitstream(const mfxBitstream& bs);
+    // Copies all queued frames and drains frames buffered by the decoder at the
+    // end of the stream
+    virtual mfxStatus Flush();
+    // Unlocks the queued frames without copying them, e.g. before the surfaces
+    // of the pipeline are freed on reset
+    virtual void DropPendingReferences();
+
+    const CQualityMetrics& GetMetrics() const {
+        return m_metrics;
+    }
+    // Time spent in the meter, to be excluded from the pipeline performance
+    CTimeStatisticsReal& GetTimeStatistics() {
+        return m_statTime;
+    }
+    void PrintStatistics(const msdk_char* prefix, FILE* pFile = stdout) const;
+
+protected:
+    struct Frame {
+        mfxFrameSurface1 surface;
+        std::vector<mfxU8> data;
+    };
+
+    // Input frame not copied yet
+    struct PendingReference {
+        mfxFrameSurface1* pSurface;
+        mfxFrameAllocator* pAllocator;
+        MFXVideoSession* pSession;
+        mfxSyncPoint syncp;
+    };
+
+    mfxStatus CopyFrame(const mfxFrameSurface1& src, Frame& dst);
+    mfxStatus CopyReference(const PendingReference& ref);
+    // Copies queued frames in order while their operations are completed, the
+    // first numWait frames are waited for
+    mfxStatus ResolveReferences(size_t numWait);
+    void ReleaseReference(PendingReference& ref);
+    mfxStatus DecodeFrames(mfxBitstream* pBS);
+    mfxStatus CompareFrame(mfxFrameSurface1* pDecoded);
+
+    bool m_bInitialized;
+    bool m_bDecoderInitialized;
+    MainVideoSession m_session;
+    std::unique_ptr<MFXVideoDECODE> m_pDecoder;
+    mfxVideoParam m_decParams;
+    mfxBitstreamWrapper m_bitstream;
+
+    CQualityMetrics m_metrics;
+    std::deque<PendingReference> m_pending;
+    size_t m_maxPending; // frames queued beyond it are waited for
+    std::deque<std::unique_ptr<Frame>> m_references;
+    std::vector<std::unique_ptr<Frame>> m_freeFrames;
+    mfxU32 m_numUnmatched; // decoded frames without a reference
+    CTimeStatisticsReal m_statTime;
+
+private:
+    CEncodeQualityMeter(const CEncodeQualityMeter&);
+    void operator=(const CEncodeQualityMeter&);
+};
+
+#endif //__QUALITY_METER_H__
@@ -0,0 +1,143 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __QUALITY_METRICS_H__
+#define __QUALITY_METRICS_H__
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vpl/mfxstructures.h"
+
+#include "vm/strings_defs.h"
+
+enum QualityMetricsFlags {
+    QUALITY_METRIC_PSNR   = 0x1,
+    QUALITY_METRIC_SSIM   = 0x2,
+    QUALITY_METRIC_MSSSIM = 0x4,
+    QUALITY_METRIC_ALL    = QUALITY_METRIC_PSNR | QUALITY_METRIC_SSIM | QUALITY_METRIC_MSSSIM
+};
+
+// Parses comma separated list of metrics (psnr, ssim, msssim or all).
+// Returns combination of QualityMetricsFlags, 0 if the list is invalid.
+mfxU32 ParseQualityMetrics(const msdk_char* strMetrics);
+
+// Quality of a single frame. Per plane values are in Y, U, V order, YUV values
+// are weighted by the number of samples in the planes. MS-SSIM is luma only.
+struct QualityMetricsValues {
+    mfxF64 psnr[3];
+    mfxF64 psnrYUV;
+    mfxF64 ssim[3];
+    mfxF64 ssimYUV;
+    mfxF64 msssim;
+};
+
+// PSNR, SSIM and MS-SSIM of NV12, I420, YV12 and P010 frames.
+// SSIM is computed over 8x8 windows placed every 4 samples, MS-SSIM uses up to
+// 5 scales (fewer for small frames, the weights are renormalized then).
+// Planes are split into bands of rows processed by a pool of worker threads,
+// row kernels use the best instruction set selected by GetFrameKernels().
+class CQualityMetrics {
+public:
+    CQualityMetrics();
+    virtual ~CQualityMetrics();
+
+    // Metrics are computed over CropW x CropH of 'info', numThreads = 0 uses
+    // all logical processors.
+    virtual mfxStatus Init(const mfxFrameInfo& info, mfxU32 metrics, mfxU32 numThreads = 0);
+    virtual void Close();
+
+    // Compares surfaces of the same layout as 'info' given to Init(). Surfaces
+    // must be in locked system memory. Statistics are accumulated.
+    virtual mfxStatus Compare(const mfxFrameSurface1* pRef,
+                              const mfxFrameSurface1* pDist,
+                              QualityMetricsValues* pValues = NULL);
+
+    mfxU32 GetMetrics() const {
+        return m_metrics;
+    }
+    mfxU32 GetFrameCount() const {
+        return m_numFrames;
+    }
+
+    // Average values over all compared frames, 'global' PSNR is computed from
+    // the mean squared error of the whole sequence
+    void GetAverage(QualityMetricsValues& values, mfxF64* pGlobalPsnrYUV = NULL) const;
+    void PrintStatistics(const msdk_char* prefix, FILE* pFile = stdout) const;
+    void ResetStatistics();
+
+protected:
+    enum { NUM_PLANES = 3, MAX_MSSSIM_SCALES = 5 };
+
+    struct Plane {
+        const mfxU8* ptr;
+        mfxU32 pitch; // in bytes
+    };
+
+    struct Job {
+        mfxU32 type;
+        mfxU32 plane;
+        mfxU32 first; // rows of samples for PSNR, rows of 4x4 blocks for SSIM
+        mfxU32 last;
+    };
+
+    struct JobResult {
+        mfxU64 ssd;
+        mfxF64 ssim;
+        mfxF64 cs;
+    };
+
+    mfxStatus MapPlanes(const mfxFrameSurface1* pSurface, mfxU32 slot);
+    void AddJobs(mfxU32 type, mfxU32 plane, mfxU32 rows);
+    void RunJobs();
+    void ExecuteJobs();
+    void ExecuteJob(const Job& job, JobResult& result);
+    void WorkerRoutine();
+
+    mfxU32 m_metrics;
+    mfxU32 m_fourCC;
+    mfxU32 m_width[NUM_PLANES];
+    mfxU32 m_height[NUM_PLANES];
+    mfxU32 m_bytesPerSample;
+    mfxU32 m_shift; // MSB aligned samples are shifted down by this value
+    mfxF64 m_maxValue;
+
+    Plane m_planes[2][NUM_PLANES];
+    std::vector<mfxU8> m_scratch[2][NUM_PLANES];
+    std::vector<mfxU16> m_scales[2]; // downscaled luma for MS-SSIM, reused between frames
+    mfxU32 m_numScales;
+    mfxF64 m_scaleWeights[MAX_MSSSIM_SCALES];
+
+    // thread pool
+    std::vector<Job> m_jobs;
+    std::vector<Job> m_queue; // jobs of the next round
+    std::vector<JobResult> m_results;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_cvStart;
+    std::condition_variable m_cvDone;
+    std::atomic<mfxU32> m_nextJob;
+    mfxU32 m_pendingJobs;
+    mfxU32 m_activeWorkers;
+    mfxU64 m_generation;
+    bool m_bStop;
+
+    // statistics
+    mfxU32 m_numFrames;
+    mfxU64 m_totalSsd[NUM_PLANES];
+    QualityMetricsValues m_sum;
+    QualityMetricsValues m_min;
+
+private:
+    CQualityMetrics(const CQualityMetrics&);
+    void operator=(const CQualityMetrics&);
+};
+
+#endif //__QUALITY_METRICS_H__
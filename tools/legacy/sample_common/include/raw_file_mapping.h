@@ -0,0 +1,63 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __RAW_FILE_MAPPING_H__
+#define __RAW_FILE_MAPPING_H__
+
+#include <stddef.h>
+
+#include "vpl/mfxstructures.h"
+
+#include "vm/strings_defs.h"
+
+// Maps raw video file into the memory, so system memory surfaces may point
+// directly to the frames of the file instead of the preloaded copies. Pages are
+// loaded by the OS on the first access and may be evicted under memory pressure,
+// so clips larger than RAM may be used. Mapping is read-only: surfaces may only
+// be inputs of the components, writing to them faults.
+class CRawFileMapping {
+public:
+    CRawFileMapping();
+    virtual ~CRawFileMapping();
+
+    virtual mfxStatus Open(const msdk_char* strFileName);
+    virtual void Close();
+
+    bool IsOpen() const {
+        return m_pData != NULL;
+    }
+    const mfxU8* GetData() const {
+        return m_pData;
+    }
+    mfxU64 GetSize() const {
+        return m_size;
+    }
+
+    // Returns size of the frame stored with pitch equal to the width, or 0 if
+    // surface of the given layout can't point to such frame: color format is not
+    // supported, or crops don't cover the whole surface.
+    static mfxU32 GetFrameSize(const mfxFrameInfo& info);
+
+    mfxU32 GetFrameCount(const mfxFrameInfo& info) const;
+
+    // Points the surface data to the frame with given index. Returns
+    // MFX_ERR_MORE_DATA if file has no such frame.
+    mfxStatus MapFrame(mfxU32 index, const mfxFrameInfo& info, mfxFrameData& data);
+
+protected:
+#if defined(_WIN32) || defined(_WIN64)
+    void* m_hFile;
+    void* m_hMapping;
+#endif
+    mfxU8* m_pData;
+    mfxU64 m_size;
+
+private:
+    CRawFileMapping(const CRawFileMapping&);
+    void operator=(const CRawFileMapping&);
+};
+
+#endif //__RAW_FILE_MAPPING_H__
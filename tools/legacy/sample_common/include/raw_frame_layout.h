@@ -0,0 +1,61 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __RAW_FRAME_LAYOUT_H__
+#define __RAW_FRAME_LAYOUT_H__
+
+#include <stdio.h>
+
+#include "vpl/mfxstructures.h"
+
+// Layout of a frame stored plane after plane, as in raw video files and in the
+// system memory surfaces. Planes are placed like SysMemFrameAllocator places them:
+// chroma rows of I420, YV12 and I010 have half of the luma pitch, all other planes
+// have the same pitch.
+struct RawFrameLayout {
+    enum { MAX_PLANES = 3 };
+
+    mfxU32 fourCC;
+    mfxU32 width;
+    mfxU32 height;
+    mfxU32 numPlanes;
+    mfxU32 rowBytes[MAX_PLANES]; // bytes of samples in a row
+    mfxU32 rows[MAX_PLANES];
+    mfxU32 pitch[MAX_PLANES];
+    mfxU32 offset[MAX_PLANES];
+    mfxU32 size;
+};
+
+// Fills layout of width x height frame, pitch is the pitch of the first plane,
+// 0 means rows without padding. Returns false for unsupported color formats
+// and pitches which are too small or can't be halved.
+bool GetRawFrameLayout(mfxU32 fourCC,
+                       mfxU32 width,
+                       mfxU32 height,
+                       mfxU32 pitch,
+                       RawFrameLayout& layout);
+
+// Points frame data to the planes of the frame stored at 'ptr' and sets the pitch.
+// Data.MemId is kept, so it may be a mapped surface of the library.
+mfxStatus SetRawFramePlanes(const RawFrameLayout& layout, mfxU8* ptr, mfxFrameData& data);
+
+// Gets the first bytes of the planes of the frame data in the plane order of the
+// layout, e.g. V goes before U for YV12. Returns false for unsupported color formats
+// and missing planes.
+bool GetRawFramePlanes(const RawFrameLayout& layout,
+                       const mfxFrameData& data,
+                       mfxU8* planes[RawFrameLayout::MAX_PLANES]);
+
+// Reads frame stored in the file with 'src' layout straight to the planes of locked
+// or mapped frame data of the same color format, 'info' gives its size, which covers
+// the frame of the file. One read per frame when the planes follow each other as in
+// the file, one per plane when pitches match, one per row otherwise.
+mfxStatus ReadRawFrame(FILE* file,
+                       const RawFrameLayout& src,
+                       const mfxFrameInfo& info,
+                       const mfxFrameData& data);
+
+#endif //__RAW_FRAME_LAYOUT_H__
@@ -12,6 +12,7 @@
 #include <climits>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <stdexcept>
@@ -43,6 +44,10 @@
 #include "sample_types.h"
 
 #include "abstract_splitter.h"
+#include "async_file_writer.h"
+#include "raw_file_mapping.h"
+#include "raw_frame_layout.h"
+#include "stream_index.h"
 #include "avc_bitstream.h"
 #include "avc_headers.h"
 #include "avc_nal_spl.h"
@@ -829,6 +834,19 @@ public:
         MaxLength = n_bytes;
     }
 
+    // Moves the data to the beginning of the storage and returns the previous one,
+    // the storage has to fit DataLength bytes
+    std::vector<mfxU8> Exchange(std::vector<mfxU8>&& storage) {
+        if (DataLength)
+            std::copy(Data + DataOffset, Data + DataOffset + DataLength, storage.begin());
+        DataOffset = 0;
+
+        std::swap(m_data, storage);
+        Data      = m_data.empty() ? NULL : m_data.data();
+        MaxLength = (mfxU32)m_data.size();
+        return std::move(storage);
+    }
+
 private:
     std::vector<mfxU8> m_data;
 };
@@ -848,11 +866,64 @@ public:
     virtual mfxStatus LoadNextFrame2(mfxFrameSurface1* pSurface,
                                      int bytes_to_read,
                                      mfxU8* buf_read);
+    // Points system memory surface to the next frame of the memory mapped file
+    // instead of reading it. Returns MFX_ERR_UNSUPPORTED if the frame can't be
+    // used without conversion (color format, P010 shift or crops), so caller
+    // should fall back to LoadNextFrame().
+    virtual mfxStatus MapNextFrame(mfxFrameSurface1* pSurface);
+    // Tells whether MapNextFrame() can point surfaces of the given layout to the
+    // file, opens the mapping of the view on success.
+    virtual bool CanMapFrames(const mfxFrameInfo& info);
     virtual void Reset();
+    // Makes LoadNextFrame() read 'numFrames' frames of a file with one read to a
+    // staging arena and copy the planes from there, 0 or 1 reads plane by plane.
+    // Has to be called before the first frame is loaded.
+    void SetReadBatch(mfxU32 numFrames) {
+        m_batchFrames = numFrames;
+    }
+    // Makes LoadNextFrame() read frames of the file color format straight to the
+    // planes of the surface, without the staging buffer: one read per frame, plane
+    // or row depending on the surface pitch. Frames which need a conversion (P010
+    // shift, crop offsets) and batched reads still go through the staging buffer.
+    void SetReadInPlace(bool bInPlace) {
+        m_bReadInPlace = bInPlace;
+    }
     mfxU32 m_ColorFormat; // color format of input YUV data, YUV420 or NV12
 
 protected:
+    // Frames read ahead from a file
+    struct ReadBatch {
+        std::vector<mfxU8> arena;
+        size_t begin; // first byte not returned yet
+        size_t end; // end of the data read from the file
+    };
+
+    // Reads plane of 'h' rows of 'rowBytes' bytes to the surface with given pitch,
+    // 16-bit samples are shifted left by 'shift' bits on the fly
+    mfxStatus ReadPlane(mfxU32 vid,
+                        mfxU8* dst,
+                        mfxU32 pitch,
+                        mfxU32 rowBytes,
+                        mfxU32 h,
+                        mfxU32 shift = 0);
+    // Returns the next 'size' bytes of the view file from the batch arena or read to
+    // the staging buffer, NULL at the end of the file
+    const mfxU8* ReadData(mfxU32 vid, size_t size);
+    // Allocates batch arena of the view for frames of w x h in the file color format
+    void InitReadBatch(mfxU32 vid, mfxU32 w, mfxU32 h);
+    // Reads w x h frame of the view straight to the surface planes, returns
+    // MFX_ERR_UNSUPPORTED without reading if the frame needs a conversion
+    mfxStatus ReadFrameInPlace(mfxU32 vid, mfxU32 w, mfxU32 h, mfxFrameSurface1* pSurface);
+
     std::vector<FILE*> m_files;
+    std::vector<mfxU8> m_buffer; // staging buffer for the plane being read
+    std::vector<ReadBatch> m_batches; // per view, created by the first LoadNextFrame()
+    mfxU32 m_batchFrames;
+    bool m_bReadInPlace;
+
+    std::vector<msdk_string> m_fileNames;
+    std::vector<std::unique_ptr<CRawFileMapping>> m_mappings; // created on the first mapped frame
+    std::vector<mfxU32> m_mappedFrames; // index of the next frame to map, per view
 
     bool shouldShift10BitsHigh;
     bool m_bInited;
@@ -868,11 +939,25 @@ public:
     virtual mfxStatus WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint = true);
     virtual mfxStatus Reset();
     virtual void Close();
+    // Makes the next Init() to write the data from a dedicated I/O thread
+    void SetAsyncWrite(bool enable, bool directIO = false) {
+        m_bAsyncWrite = enable;
+        m_bDirectIO   = directIO;
+    }
     mfxU32 m_nProcessedFramesNum;
     bool m_bSkipWriting;
 
 protected:
+    bool IsSinkOpened() const {
+        return m_fSink || (m_pAsyncSink && m_pAsyncSink->IsOpen());
+    }
+    // Writes data to the file or queues it to the I/O thread
+    mfxStatus WriteData(const void* data, size_t size);
+
     FILE* m_fSink;
+    std::unique_ptr<CAsyncFileWriter> m_pAsyncSink;
+    bool m_bAsyncWrite;
+    bool m_bDirectIO;
     bool m_bInited;
     msdk_string m_sFile;
 };
@@ -891,13 +976,35 @@ public:
     void SetMultiView() {
         m_bIsMultiView = true;
     }
+    // Makes the next Init() to write the frames from a dedicated I/O thread
+    void SetAsyncWrite(bool enable, bool directIO = false) {
+        m_bAsyncWrite = enable;
+        m_bDirectIO   = directIO;
+    }
 
 protected:
+    // Checks that output file of the view is opened
+    mfxStatus CheckOutput(mfxU32 vid);
+    // Writes data to the output file of the view or queues it to the I/O thread
+    mfxStatus WriteData(mfxU32 vid, const void* data, size_t size);
+    // Writes plane of 'h' rows of 'rowBytes' bytes from the surface with given pitch,
+    // 16-bit samples are shifted right by 'shift' bits on the fly
+    mfxStatus WritePlane(mfxU32 vid,
+                         const mfxU8* src,
+                         mfxU32 pitch,
+                         mfxU32 rowBytes,
+                         mfxU32 h,
+                         mfxU32 shift = 0);
+
     FILE *m_fDest, **m_fDestMVC;
     bool m_bInited, m_bIsMultiView;
     mfxU32 m_numCreatedFiles;
     msdk_string m_sFile;
     mfxU32 m_nViews;
+    std::vector<mfxU8> m_buffer; // staging buffer for the plane being written
+    std::vector<std::unique_ptr<CAsyncFileWriter>> m_asyncDest; // one writer per view
+    bool m_bAsyncWrite;
+    bool m_bDirectIO;
 };
 
 class CSmplBitstreamReader {
@@ -905,15 +1012,50 @@ public:
     CSmplBitstreamReader();
     virtual ~CSmplBitstreamReader();
 
-    //resets position to file begin
+    //resets position to file begin (or to the beginning of the frame range)
     virtual void Reset();
     virtual void Close();
     virtual mfxStatus Init(const msdk_char* strFileName);
     virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
 
+    // Enables random access. Index of the access units is built on the first use with
+    // a single pass over the file. With bPersist it is kept in '<file>.idx' sidecar
+    // file and loaded from it next time.
+    virtual mfxStatus InitIndex(mfxU32 codecId, bool bPersist = false);
+    // Index is immutable once built, so readers of the same file may share it
+    void SetIndex(std::shared_ptr<const CStreamIndex> pIndex);
+    std::shared_ptr<const CStreamIndex> GetIndex();
+
+    // Positions the reader to the access unit of the given frame (in decode order)
+    virtual mfxStatus SeekToFrame(mfxU32 frame);
+    // Limits reading to 'count' frames starting from the key frame at or before
+    // 'first' (count 0 means till the end of stream). At the end of the range stream
+    // either ends or starts over from the first frame of the range if bLoop is set.
+    // Several workers may read disjoint ranges (see CStreamIndex::SplitAtKeyFrames)
+    // of the same file.
+    virtual mfxStatus SetFrameRange(mfxU32 first, mfxU32 count, bool bLoop = false);
+
 protected:
+    virtual StreamIndexFormat GetIndexFormat(mfxU32 codecId) const;
+    // Moves file position to the access unit, 'frame' is its index
+    virtual mfxStatus SetPosition(const StreamIndexEntry& entry, mfxU32 frame);
+    bool HasFrameRange() const {
+        return m_endFrame != 0;
+    }
+
     FILE* m_fSource;
     bool m_bInited;
+
+    msdk_tstring m_fileName;
+    std::shared_ptr<const CStreamIndex> m_pIndex;
+    StreamIndexFormat m_indexFormat;
+    bool m_bPersistIndex;
+
+    // Frame range [m_firstFrame, m_endFrame), m_endFrame is 0 if range is not set
+    mfxU32 m_firstFrame;
+    mfxU32 m_endFrame;
+    mfxU64 m_rangeEnd; // file offset of the end of the range
+    bool m_bLoop;
 };
 
 class CH264FrameReader : public CSmplBitstreamReader {
@@ -926,6 +1068,9 @@ public:
     virtual mfxStatus Init(const msdk_char* strFileName);
     virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
 
+protected:
+    virtual mfxStatus SetPosition(const StreamIndexEntry& entry, mfxU32 frame);
+
 private:
     mfxBitstream* m_processedBS;
     // input bit stream
@@ -963,6 +1108,9 @@ public:
     virtual mfxStatus ReadNextFrame(mfxBitstream* pBS);
 
 protected:
+    virtual StreamIndexFormat GetIndexFormat(mfxU32 codecId) const;
+    virtual mfxStatus SetPosition(const StreamIndexEntry& entry, mfxU32 frame);
+
     /*bytes 0-3    signature: 'DKIF'
     bytes 4-5    version (should be 0)
     bytes 6-7    length of header in bytes
@@ -987,6 +1135,8 @@ protected:
         mfxU32 unused;
     } m_hdr;
     mfxStatus ReadHeader();
+
+    mfxU32 m_frameIndex; // index of the next frame to read
 };
 
 // writes bitstream to duplicate-file & supports joining
@@ -1464,6 +1614,9 @@ inline mfxStatus msdk_opt_read(const msdk_string& string, T& value) {
     return msdk_opt_read(string.c_str(), value);
 }
 
+// Parses list of logical processors like "0-3,8,10-11"
+mfxStatus msdk_parse_cpu_list(const msdk_char* string, std::vector<mfxU32>& cpus);
+
 mfxStatus StrFormatToCodecFormatFourCC(msdk_char* strInput, mfxU32& codecFormat);
 msdk_string StatusToString(mfxStatus sts);
 mfxI32 getMonitorType(msdk_char* str);
@@ -0,0 +1,89 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __STREAM_INDEX_H__
+#define __STREAM_INDEX_H__
+
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "vpl/mfxdefs.h"
+
+#include "vm/strings_defs.h"
+
+enum StreamIndexFormat {
+    STREAM_INDEX_UNKNOWN = 0,
+    STREAM_INDEX_AVC, // Annex-B H.264
+    STREAM_INDEX_HEVC, // Annex-B H.265
+    STREAM_INDEX_IVF // VP8, VP9 or AV1 in IVF container
+};
+
+struct StreamIndexEntry {
+    enum { FLAG_KEY_FRAME = 0x1 };
+
+    mfxU64 offset; // file offset of the access unit (IVF frame header for IVF)
+    mfxU64 timeStamp; // IVF frame time stamp, 0 for elementary streams
+    mfxU32 size; // access units are contiguous: size is the distance to the next one
+    mfxU32 flags;
+};
+
+// Index of access units of the coded stream file built with a single pass over
+// the file. Access unit starts with the first non-VCL NAL unit (AUD, parameter
+// sets, prefix SEI) after the last VCL NAL unit of the previous one, or with the
+// first slice of the picture. Key frames are IDR pictures for H.264, IRAP pictures
+// of the base layer for HEVC if the parameter sets they refer to precede them, key
+// frames for VP8/VP9 and temporal units with sequence header for AV1.
+class CStreamIndex {
+public:
+    CStreamIndex();
+    virtual ~CStreamIndex();
+
+    virtual mfxStatus Build(const msdk_char* strFileName, StreamIndexFormat format);
+
+    // Sidecar file keeps the index between runs, its fields are stored little-endian
+    // after a versioned header. Load() fails if the index was written by another
+    // version, or built for another format or stream file of different size.
+    virtual mfxStatus Save(const msdk_char* strIndexName) const;
+    virtual mfxStatus Load(const msdk_char* strIndexName,
+                           const msdk_char* strFileName,
+                           StreamIndexFormat format);
+
+    void Clear();
+
+    StreamIndexFormat GetFormat() const {
+        return m_format;
+    }
+    mfxU64 GetFileSize() const {
+        return m_fileSize;
+    }
+    mfxU32 GetFrameCount() const {
+        return (mfxU32)m_entries.size();
+    }
+    const StreamIndexEntry& GetEntry(mfxU32 frame) const {
+        return m_entries[frame];
+    }
+
+    // Returns the closest key frame at or before the given frame, 0 if there is none
+    mfxU32 FindKeyFrame(mfxU32 frame) const;
+
+    // Splits the stream into at most 'parts' ranges of (first frame, frame count)
+    // starting at key frames, so each one may be read and decoded independently
+    void SplitAtKeyFrames(mfxU32 parts, std::vector<std::pair<mfxU32, mfxU32>>& ranges) const;
+
+    static mfxU64 GetFileSize(const msdk_char* strFileName);
+
+protected:
+    mfxStatus BuildAnnexB(FILE* file);
+    mfxStatus BuildIVF(FILE* file);
+
+    StreamIndexFormat m_format;
+    mfxU64 m_fileSize;
+    std::vector<StreamIndexEntry> m_entries;
+    std::vector<mfxU32> m_keyFrames; // indices of the key frames in ascending order
+};
+
+#endif //__STREAM_INDEX_H__
@@ -8,8 +8,10 @@
 #define __SYSMEM_ALLOCATOR_H__
 
 #include <stdlib.h>
+#include <map>
 #include <vector>
 #include "base_allocator.h"
+#include "vm/strings_defs.h"
 
 struct sBuffer {
     mfxU32 id;
@@ -19,12 +21,35 @@ struct sBuffer {
 
 struct sFrame {
     mfxU32 id;
+    mfxU32 offset; // of the frame data from the header
     mfxFrameInfo info;
 };
 
+enum SysMemAllocatorOptions {
+    SYSMEM_ALLOC_ALIGN64 = 0x1, // frame data is aligned to 64 bytes instead of 32
+    SYSMEM_ALLOC_ALIGN4K = 0x2, // frame data is aligned to 4096 bytes
+    SYSMEM_ALLOC_SLAB    = 0x4, // frames of a response share a single allocation
+    SYSMEM_ALLOC_THP     = 0x8, // 2MB transparent huge pages are requested with madvise()
+    SYSMEM_ALLOC_HUGETLB = 0x10, // 2MB pages of the hugetlbfs pool, THP when the pool is empty
+    SYSMEM_ALLOC_NUMA    = 0x20 // pages are bound to the NUMA node, see nNumaNode
+};
+
+// Parses comma separated list of options (align64, align4k, slab, thp, hugetlb, numa).
+// Returns combination of SysMemAllocatorOptions, 0 if the list is invalid.
+mfxU32 ParseSysMemAllocatorOptions(const msdk_char* strOptions);
+
 struct SysMemAllocatorParams : mfxAllocatorParams {
-    SysMemAllocatorParams() : mfxAllocatorParams(), pBufferAllocator(NULL) {}
+    SysMemAllocatorParams()
+            : mfxAllocatorParams(),
+              pBufferAllocator(NULL),
+              nOptions(0),
+              nNumaNode(-1) {}
     MFXBufferAllocator* pBufferAllocator;
+    // SysMemAllocatorOptions, page options and slabs need own buffer allocator
+    // (pBufferAllocator == NULL) and are ignored otherwise
+    mfxU32 nOptions;
+    // node of SYSMEM_ALLOC_NUMA, -1 - node of the thread allocating the frames
+    mfxI32 nNumaNode;
 };
 
 class SysMemFrameAllocator : public BaseFrameAllocator {
@@ -47,10 +72,35 @@ protected:
                                   mfxU16 memType,
                                   mfxMemId* midOut);
 
+    // Memory of the frames allocated with page options, frames of a slab share one region
+    struct Region {
+        mfxU8* base; // start of the allocation
+        size_t size; // size of the allocation
+        bool mapped; // allocated with mmap()
+    };
+
+    // Allocates 'size' bytes of memory placed according to the page options
+    mfxStatus AllocRegion(size_t size, Region& region);
+    void FreeRegion(Region& region);
+    // Allocates frames of the response in regions instead of the buffer allocator
+    mfxStatus AllocRegionFrames(mfxFrameAllocRequest* request,
+                                mfxU32 nbytes,
+                                mfxFrameAllocResponse* response);
+    static bool IsInRegions(const std::vector<Region>& regions, mfxMemId mid);
+    bool IsRegionMid(mfxMemId mid);
+    // Allocates frame of 'nbytes' of data with the buffer allocator
+    mfxStatus AllocBufferFrame(const mfxFrameInfo& info, mfxU32 nbytes, mfxU16 type, mfxMemId* mid);
+    // Fills the header of the frame stored in the buffer, data follows it aligned
+    mfxStatus InitFrameHeader(mfxMemId mid, const mfxFrameInfo& info);
+    mfxU32 GetAlignment() const;
+
     MFXBufferAllocator* m_pBufferAllocator;
     bool m_bOwnBufferAllocator;
+    mfxU32 m_nOptions;
+    mfxI32 m_nNumaNode;
 
     std::vector<mfxFrameAllocResponse*> m_vResp;
+    std::map<mfxMemId*, std::vector<Region>> m_regions; // by mids of the responses
 
     mfxMemId* GetMidHolder(mfxMemId mid);
 };
@@ -15,12 +15,22 @@
 
     #define MSDK_FOPEN(file, name, mode) _tfopen_s(&file, name, mode)
 
+    #define MSDK_FSEEK64(file, offset, origin) _fseeki64(file, (__int64)(offset), origin)
+    #define MSDK_FTELL64(file)                 ((mfxI64)_ftelli64(file))
+    #define MSDK_REMOVE(name)                  _tremove(name)
+    #define MSDK_RENAME(oldName, newName)      _trename(oldName, newName)
+
     #define msdk_fgets _fgetts
 #else // #if defined(_WIN32) || defined(_WIN64)
     #include <unistd.h>
 
     #define MSDK_FOPEN(file, name, mode) (file = fopen(name, mode))
 
+    #define MSDK_FSEEK64(file, offset, origin) fseeko(file, (off_t)(offset), origin)
+    #define MSDK_FTELL64(file)                 ((mfxI64)ftello(file))
+    #define MSDK_REMOVE(name)                  remove(name)
+    #define MSDK_RENAME(oldName, newName)      rename(oldName, newName)
+
     #define msdk_fgets fgets
 #endif // #if defined(_WIN32) || defined(_WIN64)
 
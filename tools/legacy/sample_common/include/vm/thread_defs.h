@@ -7,6 +7,8 @@
 #ifndef __THREAD_DEFS_H__
 #define __THREAD_DEFS_H__
 
+#include <vector>
+
 #include "vm/strings_defs.h"
 #include "vpl/mfxdefs.h"
 
@@ -121,4 +123,13 @@ mfxStatus msdk_setrlimit_vmem(mfxU64 size);
 mfxStatus msdk_thread_get_schedtype(const msdk_char*, mfxI32& type);
 void msdk_thread_printf_scheduling_help();
 
+// Sets logical processors the calling thread may run on. On Linux threads started
+// by the thread inherit them, on Windows new threads get processors of the process.
+mfxStatus msdk_thread_set_affinity(const std::vector<mfxU32>& cpus);
+mfxStatus msdk_thread_get_affinity(std::vector<mfxU32>& cpus);
+// Number of NUMA nodes, 1 if the system doesn't report them
+mfxU32 msdk_get_numa_node_count();
+// Logical processors of the NUMA node
+mfxStatus msdk_get_numa_node_cpus(mfxU32 node, std::vector<mfxU32>& cpus);
+
 #endif //__THREAD_DEFS_H__
@@ -0,0 +1,421 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <malloc.h>
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#include "async_file_writer.h"
+#include "sample_defs.h"
+#include "vm/file_defs.h"
+
+// Maximum number of chunks written by a single system call
+#define MAX_BATCH_SIZE 64
+
+CAsyncFileWriter::CAsyncFileWriter()
+        :
+#if defined(_WIN32) || defined(_WIN64)
+          m_file(NULL),
+#else
+          m_fd(-1),
+#endif
+          m_bOpened(false),
+          m_bUseDirectIO(false),
+          m_bDirectIO(false),
+          m_offset(0),
+          m_chunkSize(0),
+          m_chunkCount(0),
+          m_chunks(),
+          m_free(),
+          m_queue(),
+          m_current(NULL),
+          m_written(0),
+          m_mutex(),
+          m_queueCond(),
+          m_freeCond(),
+          m_thread(),
+          m_bStop(false),
+          m_bWriting(false),
+          m_sts(MFX_ERR_NONE) {
+}
+
+CAsyncFileWriter::~CAsyncFileWriter() {
+    Close();
+}
+
+mfxStatus CAsyncFileWriter::Open(const msdk_char* strFileName,
+                                 bool directIO,
+                                 mfxU32 chunkSize,
+                                 mfxU32 chunkCount) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+
+    Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+    // Direct I/O is not supported, data is written with buffered fwrite from the I/O thread
+    directIO = false;
+    MSDK_FOPEN(m_file, strFileName, MSDK_STRING("wb+"));
+    MSDK_CHECK_POINTER(m_file, MFX_ERR_NULL_PTR);
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    #ifdef O_DIRECT
+    if (directIO) {
+        m_fd = open(strFileName, flags | O_DIRECT, 0644);
+        // File system may not support direct I/O, fall back to the buffered one
+        if (m_fd < 0 && errno != EINVAL)
+            return MFX_ERR_NULL_PTR;
+    }
+    #endif
+    directIO = directIO && m_fd >= 0;
+    if (m_fd < 0)
+        m_fd = open(strFileName, flags, 0644);
+    MSDK_CHECK_ERROR(m_fd, -1, MFX_ERR_NULL_PTR);
+#endif
+
+    m_bUseDirectIO = directIO;
+    m_bDirectIO    = directIO;
+    m_offset       = 0;
+    m_written      = 0;
+    m_chunkSize    = std::max<size_t>(chunkSize, DIRECT_IO_ALIGNMENT);
+    m_chunkSize    = (m_chunkSize + DIRECT_IO_ALIGNMENT - 1) & ~(size_t)(DIRECT_IO_ALIGNMENT - 1);
+    m_chunkCount   = std::max<size_t>(chunkCount, 2);
+    m_bStop        = false;
+    m_bWriting     = false;
+    m_sts          = MFX_ERR_NONE;
+
+    m_thread  = std::thread(&CAsyncFileWriter::IOThreadRoutine, this);
+    m_bOpened = true;
+
+    return MFX_ERR_NONE;
+}
+
+CAsyncFileWriter::Chunk* CAsyncFileWriter::GetFreeChunk(std::unique_lock<std::mutex>& lock) {
+    if (m_free.empty() && m_chunks.size() < m_chunkCount) {
+        // Chunks are allocated on demand, aligned for the direct I/O
+        void* data = NULL;
+#if defined(_WIN32) || defined(_WIN64)
+        data = _aligned_malloc(m_chunkSize, DIRECT_IO_ALIGNMENT);
+#else
+        if (posix_memalign(&data, DIRECT_IO_ALIGNMENT, m_chunkSize))
+            data = NULL;
+#endif
+        if (!data) {
+            m_sts = MFX_ERR_MEMORY_ALLOC;
+            return NULL;
+        }
+        Chunk* chunk = new Chunk;
+        chunk->data  = (mfxU8*)data;
+        chunk->size  = 0;
+        m_chunks.push_back(chunk);
+        return chunk;
+    }
+
+    // Backpressure: wait for the I/O thread to release a chunk
+    m_freeCond.wait(lock, [this]() {
+        return !m_free.empty() || m_sts != MFX_ERR_NONE;
+    });
+    if (m_free.empty())
+        return NULL;
+
+    Chunk* chunk = m_free.back();
+    m_free.pop_back();
+    return chunk;
+}
+
+mfxStatus CAsyncFileWriter::Write(const void* data, size_t size) {
+    MSDK_CHECK_ERROR(m_bOpened, false, MFX_ERR_NOT_INITIALIZED);
+    if (size)
+        MSDK_CHECK_POINTER(data, MFX_ERR_NULL_PTR);
+
+    const mfxU8* src = (const mfxU8*)data;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (size) {
+        if (m_sts != MFX_ERR_NONE)
+            return m_sts;
+
+        if (!m_current) {
+            m_current = GetFreeChunk(lock);
+            if (!m_current)
+                return m_sts;
+        }
+
+        // Current chunk is owned by the caller, so it is filled out of the lock
+        Chunk* chunk = m_current;
+        size_t n     = std::min(size, m_chunkSize - chunk->size);
+        lock.unlock();
+        memcpy(chunk->data + chunk->size, src, n);
+        lock.lock();
+
+        chunk->size += n;
+        src += n;
+        size -= n;
+
+        if (chunk->size == m_chunkSize) {
+            m_queue.push_back(chunk);
+            m_current = NULL;
+            m_written = 0;
+            m_queueCond.notify_one();
+        }
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CAsyncFileWriter::Flush() {
+    MSDK_CHECK_ERROR(m_bOpened, false, MFX_ERR_NOT_INITIALIZED);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_current) {
+        if (m_current->size > m_written) {
+            m_queue.push_back(m_current);
+            m_current = NULL;
+            m_written = 0;
+            m_queueCond.notify_one();
+        }
+        else if (!m_current->size) {
+            m_free.push_back(m_current);
+            m_current = NULL;
+        }
+        // Otherwise the chunk holds only the tail flushed before, it is kept
+    }
+
+    m_freeCond.wait(lock, [this]() {
+        return m_queue.empty() && !m_bWriting;
+    });
+
+    return m_sts;
+}
+
+mfxStatus CAsyncFileWriter::WriteAt(mfxU64 offset, const void* data, size_t size) {
+    MSDK_CHECK_POINTER(data, MFX_ERR_NULL_PTR);
+
+    // I/O thread is idle after the flush till the next Write()
+    mfxStatus sts = Flush();
+    MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::Flush failed");
+
+#if defined(_WIN32) || defined(_WIN64)
+    if (_fseeki64(m_file, (__int64)offset, SEEK_SET) || fwrite(data, 1, size, m_file) != size) {
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    }
+    if (_fseeki64(m_file, 0, SEEK_END))
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+#else
+    // Data isn't aligned, so it is written through the page cache
+    bool bDirectIO = m_bDirectIO;
+    sts            = SetDirectIO(false);
+    MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::SetDirectIO failed");
+
+    if (pwrite(m_fd, data, size, (off_t)offset) != (ssize_t)size)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    sts = SetDirectIO(bDirectIO);
+    MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::SetDirectIO failed");
+
+    // Flushed tail kept in the current chunk is written again, so it gets the new data too
+    if (m_current && offset < m_offset + m_current->size && offset + size > m_offset) {
+        mfxU64 begin = std::max<mfxU64>(offset, m_offset);
+        mfxU64 end   = std::min<mfxU64>(offset + size, m_offset + m_current->size);
+        memcpy(m_current->data + (begin - m_offset),
+               (const mfxU8*)data + (begin - offset),
+               (size_t)(end - begin));
+    }
+#endif
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CAsyncFileWriter::Close() {
+    if (!m_bOpened)
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+        m_queueCond.notify_one();
+    }
+    m_thread.join();
+
+#if defined(_WIN32) || defined(_WIN64)
+    fclose(m_file);
+    m_file = NULL;
+#else
+    close(m_fd);
+    m_fd = -1;
+#endif
+
+    FreeChunks();
+    m_bOpened      = false;
+    m_bUseDirectIO = false;
+    m_bDirectIO    = false;
+    m_offset       = 0;
+
+    return sts;
+}
+
+void CAsyncFileWriter::FreeChunks() {
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+#if defined(_WIN32) || defined(_WIN64)
+        _aligned_free(m_chunks[i]->data);
+#else
+        free(m_chunks[i]->data);
+#endif
+        delete m_chunks[i];
+    }
+    m_chunks.clear();
+    m_free.clear();
+    m_queue.clear();
+    m_current = NULL;
+    m_written = 0;
+}
+
+void CAsyncFileWriter::IOThreadRoutine() {
+    std::vector<Chunk*> batch;
+    batch.reserve(MAX_BATCH_SIZE);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_queueCond.wait(lock, [this]() {
+            return m_bStop || !m_queue.empty();
+        });
+        if (m_queue.empty())
+            break;
+
+        // Everything queued so far is written at once
+        while (!m_queue.empty() && batch.size() < MAX_BATCH_SIZE) {
+            batch.push_back(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_bWriting      = true;
+        mfxStatus sts   = m_sts;
+        size_t tailSize = 0;
+
+        lock.unlock();
+        // After an error data is dropped, so the caller is never blocked forever
+        if (sts == MFX_ERR_NONE)
+            sts = WriteChunks(batch, tailSize);
+        lock.lock();
+
+        if (m_sts == MFX_ERR_NONE)
+            m_sts = sts;
+        for (size_t i = 0; i < batch.size(); i++) {
+            Chunk* chunk = batch[i];
+            // Flushed tail becomes the start of the current chunk, the caller appends
+            // the next data to it. Flush() waits, so the caller holds no chunk now.
+            if (tailSize && i + 1 == batch.size() && m_sts == MFX_ERR_NONE && !m_current) {
+                memmove(chunk->data, chunk->data + chunk->size - tailSize, tailSize);
+                chunk->size = tailSize;
+                m_current   = chunk;
+                m_written   = tailSize;
+                continue;
+            }
+            chunk->size = 0;
+            m_free.push_back(chunk);
+        }
+        batch.clear();
+        m_bWriting = false;
+        m_freeCond.notify_all();
+    }
+}
+
+mfxStatus CAsyncFileWriter::SetDirectIO(bool enable) {
+#if !defined(_WIN32) && !defined(_WIN64) && defined(O_DIRECT)
+    if (m_bDirectIO != enable) {
+        int flags = fcntl(m_fd, F_GETFL);
+        flags     = enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+        if (flags < 0 || fcntl(m_fd, F_SETFL, flags) < 0)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        m_bDirectIO = enable;
+    }
+#endif
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CAsyncFileWriter::WriteChunks(std::vector<Chunk*>& chunks, size_t& tailSize) {
+    tailSize = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (fwrite(chunks[i]->data, 1, chunks[i]->size, m_file) != chunks[i]->size)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+    }
+    return MFX_ERR_NONE;
+#else
+    std::vector<struct iovec> iov(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        iov[i].iov_base = chunks[i]->data;
+        iov[i].iov_len  = chunks[i]->size;
+    }
+    // Only the last chunk written on flush may be partial. Direct I/O requires
+    // aligned sizes, so its tail is written separately.
+    if (m_bUseDirectIO && !chunks.empty()) {
+        tailSize = chunks.back()->size % DIRECT_IO_ALIGNMENT;
+        iov.back().iov_len -= tailSize;
+    }
+
+    size_t idx = 0;
+    while (idx < iov.size()) {
+        ssize_t n = pwritev(m_fd, &iov[idx], (int)(iov.size() - idx), (off_t)m_offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // File system accepted O_DIRECT on open but rejects direct writes
+            if (errno == EINVAL && m_bDirectIO) {
+                m_bUseDirectIO = false;
+                if (SetDirectIO(false) == MFX_ERR_NONE)
+                    continue;
+            }
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        }
+        m_offset += (mfxU64)n;
+
+        // Skip written data, pwritev may return early
+        size_t written = (size_t)n;
+        while (idx < iov.size() && written >= iov[idx].iov_len) {
+            written -= iov[idx].iov_len;
+            idx++;
+        }
+        if (written) {
+            iov[idx].iov_base = (mfxU8*)iov[idx].iov_base + written;
+            iov[idx].iov_len -= written;
+        }
+    }
+
+    if (tailSize) {
+        // Tail goes through the page cache, then direct I/O is restored for the
+        // next chunk, which starts at the aligned offset with the tail again
+        const mfxU8* tail = chunks.back()->data + chunks.back()->size - tailSize;
+        mfxStatus sts     = SetDirectIO(false);
+        MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::SetDirectIO failed");
+        if (pwrite(m_fd, tail, tailSize, (off_t)m_offset) != (ssize_t)tailSize)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+        if (m_bUseDirectIO) {
+            sts = SetDirectIO(true);
+            MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::SetDirectIO failed");
+        }
+        else {
+            // Direct I/O was dropped on the way, the tail is final
+            m_offset += tailSize;
+            tailSize = 0;
+        }
+    }
+    return MFX_ERR_NONE;
+#endif
+}
@@ -4,6 +4,10 @@
   # SPDX-License-Identifier: MIT
   ############################################################################*/
 
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
+
 #include "avc_bitstream.h"
 #include "sample_defs.h"
 
@@ -212,7 +216,37 @@ mfxStatus AVCBaseBitstream::GetNALUnitType(NAL_Unit_Type& uNALUnitType, mfxU8& u
     return MFX_ERR_NONE;
 } // GetNALUnitType
 
+static inline mfxU32 CountLeadingZeros(mfxU64 value) {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (mfxU32)index;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32)))
+        return 31 - (mfxU32)index;
+    _BitScanReverse(&index, (unsigned long)value);
+    return 63 - (mfxU32)index;
+#else
+    return (mfxU32)__builtin_clzll(value);
+#endif
+}
+
 mfxI32 AVCBaseBitstream::GetVLCElement(bool bIsSigned) {
+    // Window has at least 33 bits, so codewords with up to 15 leading zeros (31 bits)
+    // are decoded from it without loops
+    mfxU64 w = PeekWindow();
+    if (w >> 48) {
+        mfxU32 length = 2 * CountLeadingZeros(w) + 1;
+        mfxU32 code   = (mfxU32)(w >> (64 - length)) - 1;
+        SkipBits(length);
+
+        if (!bIsSigned)
+            return (mfxI32)code;
+        mfxI32 value = (mfxI32)((code + 1) >> 1);
+        return (code & 1) ? value : -value;
+    }
+
     mfxI32 sval = 0;
 
     mfxStatus ippRes = DecodeExpGolombOne(&m_pbs, &m_bitOffset, &sval, bIsSigned);
@@ -285,7 +319,7 @@ AVCHeadersBitstream::AVCHeadersBitstream(mfxU8* const pb, const mfxU32 maxsize)
 //  AVCBitstream::GetSequenceParamSet()
 //    Read sequence parameter set data from bitstream.
 // ---------------------------------------------------------------------------
-mfxStatus AVCHeadersBitstream::GetSequenceParamSet(AVCSeqParamSet* sps) {
+mfxStatus AVCHeadersBitstream::GetSequenceParamSet(AVCSeqParamSet* sps, HeaderParseMode mode) {
     // Not all members of the seq param set structure are contained in all
     // seq param sets. So start by init all to zero.
     mfxStatus ps = MFX_ERR_NONE;
@@ -574,7 +608,7 @@ mfxStatus AVCHeadersBitstream::GetSequenceParamSet(AVCSeqParamSet* sps) {
     } // don't need else because we zeroid structure
 
     sps->vui_parameters_present_flag = (mfxU8)Get1Bit();
-    if (sps->vui_parameters_present_flag) {
+    if (sps->vui_parameters_present_flag && mode == PARSE_HEADERS_FULL) {
         if (ps == MFX_ERR_NONE)
             ps = GetVUIParam(sps);
     }
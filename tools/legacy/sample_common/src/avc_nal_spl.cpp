@@ -6,6 +6,7 @@
 
 #include "avc_nal_spl.h"
 #include "avc_structures.h"
+#include "nal_scanner.h"
 #include "sample_defs.h"
 
 namespace ProtectedLibrary {
@@ -40,16 +41,18 @@ static mfxI32 FindStartCode(mfxU8*(&pb), mfxU32& nSize) {
     if (nSize < 4)
         return 0;
 
-    // find start code
-    while ((4 <= nSize) && ((0 != pb[0]) || (0 != pb[1]) || (1 != pb[2]))) {
-        pb += 1;
-        nSize -= 1;
+    // find start code followed by at least one byte
+    mfxU8* end = pb + nSize;
+    mfxU8* sc  = (mfxU8*)FindAnnexBStartCode(pb, end - 1);
+    if (sc == end - 1) {
+        pb    = end - 3;
+        nSize = 3;
+        return 0;
     }
 
-    if (4 <= nSize)
-        return ((pb[0] << 24) | (pb[1] << 16) | (pb[2] << 8) | (pb[3]));
-
-    return 0;
+    nSize -= (mfxU32)(sc - pb);
+    pb = sc;
+    return ((pb[0] << 24) | (pb[1] << 16) | (pb[2] << 8) | (pb[3]));
 }
 
 mfxStatus MoveBitstream(mfxBitstream* source, mfxI32 moveSize) {
@@ -235,41 +238,30 @@ mfxI32 StartCodeIterator::EndOfStream(mfxBitstream* dst) {
 }
 
 mfxI32 StartCodeIterator::FindStartCode(mfxU8*(&pb), mfxU32& data_size, mfxI32& startCodeSize) {
-    mfxU32 zeroCount = 0;
-
-    for (mfxU32 i = 0; i < (mfxU32)data_size; i++, pb++) {
-        switch (pb[0]) {
-            case 0x00:
-                zeroCount++;
-                break;
-            case 0x01:
-                if (zeroCount >= 2) {
-                    startCodeSize = std::min(zeroCount + 1, 4u);
-                    data_size -= i + 1;
-                    pb++; // remove 0x01 symbol
-                    zeroCount = 0;
-                    if (data_size >= 1) {
-                        return pb[0] & AVC_NAL_UNITTYPE_BITS_MASK;
-                    }
-                    else {
-                        pb -= startCodeSize;
-                        data_size += startCodeSize;
-                        startCodeSize = 0;
-                        return 0;
-                    }
-                }
-                zeroCount = 0;
-                break;
-            default:
-                zeroCount = 0;
-                break;
-        }
+    mfxU8* begin = pb;
+    mfxU8* end   = pb + data_size;
+    mfxU8* sc    = (mfxU8*)FindAnnexBStartCode(begin, end);
+
+    if (sc == end) {
+        // keep trailing zeros, they may be the beginning of the next start code
+        mfxU32 zeroCount = 0;
+        while (zeroCount < 3 && end - zeroCount > begin && !end[-(mfxI32)zeroCount - 1])
+            zeroCount++;
+        pb            = end - zeroCount;
+        data_size     = zeroCount;
+        startCodeSize = 0;
+        return 0;
     }
 
-    zeroCount = std::min(zeroCount, 3u);
-    pb -= zeroCount;
-    data_size += zeroCount;
-    zeroCount     = 0;
+    // 4-byte start code if one more zero precedes 00 00 01
+    startCodeSize = (sc > begin && !sc[-1]) ? 4 : 3;
+    pb            = sc + 3; // remove 0x01 symbol
+    data_size     = (mfxU32)(end - pb);
+    if (data_size >= 1)
+        return pb[0] & AVC_NAL_UNITTYPE_BITS_MASK;
+
+    pb -= startCodeSize;
+    data_size += startCodeSize;
     startCodeSize = 0;
     return 0;
 }
@@ -21,7 +21,12 @@ void AVCFrameInfo::Reset() {
     m_index = 0;
 }
 
-AVC_Spl::AVC_Spl() : m_WaitForIDR(true), m_currentInfo(0), m_pLastSlice(0), m_lastNalUnit(0) {
+AVC_Spl::AVC_Spl()
+        : m_WaitForIDR(true),
+          m_parseMode(PARSE_HEADERS_FULL),
+          m_currentInfo(0),
+          m_pLastSlice(0),
+          m_lastNalUnit(0) {
     Init();
 }
 
@@ -100,7 +105,7 @@ mfxStatus AVC_Spl::DecodeHeader(mfxBitstream* nalUnit) {
             // sequence parameter set
             case NAL_UT_SPS: {
                 AVCSeqParamSet sps;
-                umcRes = bitStream.GetSequenceParamSet(&sps);
+                umcRes = bitStream.GetSequenceParamSet(&sps, m_parseMode);
                 if (umcRes == MFX_ERR_NONE) {
                     AVCSeqParamSet* temp =
                         m_headers.m_SeqParams.GetHeader(sps.seq_parameter_set_id);
@@ -296,7 +301,7 @@ AVCSlice* AVC_Spl::DecodeSliceHeader(mfxBitstream* nalUnit) {
     pSlice->m_seqParamSetEx = m_headers.m_SeqExParams.GetHeader(seq_parameter_set_id);
     pSlice->m_dTime         = nalUnit->TimeStamp;
 
-    if (!pSlice->DecodeHeader(swappingMemory, swappingSize)) {
+    if (!pSlice->DecodeHeader(swappingMemory, swappingSize, m_parseMode)) {
         return 0;
     }
 
@@ -493,18 +498,21 @@ mfxStatus AVC_Spl::AddSliceNalUnit(mfxBitstream* nalUnit, AVCSlice* slice) {
 
     AVCHeadersBitstream* bs = slice->GetBitStream();
 
-    newSlice.HeaderLength = (mfxU32)bs->BytesDecoded();
+    newSlice.HeaderLength = 0;
+    if (m_parseMode == PARSE_HEADERS_FULL) {
+        newSlice.HeaderLength = (mfxU32)bs->BytesDecoded();
 
-    // add number of 003 sequence to HeaderLength
-    for (mfxU8* ptr = nalUnit->Data + sizeof(start_code_prefix);
-         ptr < nalUnit->Data + sizeof(start_code_prefix) + newSlice.HeaderLength;
-         ptr++) {
-        if (ptr[0] == 0 && ptr[1] == 0 && ptr[2] == 3) {
-            newSlice.HeaderLength++;
+        // add number of 003 sequence to HeaderLength
+        for (mfxU8* ptr = nalUnit->Data + sizeof(start_code_prefix);
+             ptr < nalUnit->Data + sizeof(start_code_prefix) + newSlice.HeaderLength;
+             ptr++) {
+            if (ptr[0] == 0 && ptr[1] == 0 && ptr[2] == 3) {
+                newSlice.HeaderLength++;
+            }
         }
-    }
 
-    newSlice.HeaderLength += sizeof(start_code_prefix) + 1;
+        newSlice.HeaderLength += sizeof(start_code_prefix) + 1;
+    }
 
     newSlice.DataLength = sliceLength;
     newSlice.DataOffset = m_frame.DataLength;
@@ -629,6 +637,7 @@ void AVCSlice::Reset() {
     m_seqParamSetMvcEx = 0;
     m_seqParamSetEx    = 0;
     m_dTime            = 0;
+    m_pPart1Source     = 0;
     memset(&m_sliceHeader, 0, sizeof(m_sliceHeader));
 }
 
@@ -637,6 +646,7 @@ AVCSliceHeader* AVCSlice::GetSliceHeader() {
 }
 
 mfxI32 AVCSlice::RetrievePicParamSetNumber(mfxU8* pSource, mfxU32 nSourceSize) {
+    m_pPart1Source = 0;
     if (!nSourceSize)
         return -1;
 
@@ -658,12 +668,11 @@ mfxI32 AVCSlice::RetrievePicParamSetNumber(mfxU8* pSource, mfxU32 nSourceSize) {
         return -1;
     }
 
+    m_pPart1Source = pSource;
     return m_sliceHeader.pic_parameter_set_id;
 }
 
-bool AVCSlice::DecodeHeader(mfxU8* pSource, mfxU32 nSourceSize) {
-    m_bitStream.Reset(pSource, nSourceSize);
-
+bool AVCSlice::DecodeHeader(mfxU8* pSource, mfxU32 nSourceSize, HeaderParseMode mode) {
     if (!nSourceSize)
         return false;
 
@@ -673,22 +682,32 @@ bool AVCSlice::DecodeHeader(mfxU8* pSource, mfxU32 nSourceSize) {
     // is not supposed to change within the picture, so can be
     // discarded when read again here.
     try {
-        memset(&m_sliceHeader, 0, sizeof(m_sliceHeader));
-
-        umcRes = m_bitStream.GetNALUnitType(m_sliceHeader.nal_unit_type, m_sliceHeader.nal_ref_idc);
-        if (MFX_ERR_NONE != umcRes)
-            return false;
-
-        // decode first part of slice header
-        umcRes = m_bitStream.GetSliceHeaderPart1(&m_sliceHeader);
-        if (MFX_ERR_NONE != umcRes)
-            return false;
+        // Bitstream is already positioned after the first part
+        if (pSource != m_pPart1Source) {
+            m_bitStream.Reset(pSource, nSourceSize);
+            memset(&m_sliceHeader, 0, sizeof(m_sliceHeader));
+
+            umcRes =
+                m_bitStream.GetNALUnitType(m_sliceHeader.nal_unit_type, m_sliceHeader.nal_ref_idc);
+            if (MFX_ERR_NONE != umcRes)
+                return false;
+
+            // decode first part of slice header
+            umcRes = m_bitStream.GetSliceHeaderPart1(&m_sliceHeader);
+            if (MFX_ERR_NONE != umcRes)
+                return false;
+        }
+        m_pPart1Source = 0;
 
         // decode second part of slice header
         umcRes = m_bitStream.GetSliceHeaderPart2(&m_sliceHeader, m_picParamSet, m_seqParamSet);
         if (MFX_ERR_NONE != umcRes)
             return false;
 
+        // Fields used to detect access unit boundaries are all parsed
+        if (mode == PARSE_HEADERS_LAZY)
+            return true;
+
         PredWeightTable m_PredWeight[2][MAX_NUM_REF_FRAMES];
         RefPicListReorderInfo ReorderInfoL0;
         RefPicListReorderInfo ReorderInfoL1;
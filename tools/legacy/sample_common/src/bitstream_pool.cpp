@@ -0,0 +1,55 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "bitstream_pool.h"
+
+CBitstreamBufferPool::CBitstreamBufferPool() : m_mutex(), m_free() {}
+
+std::vector<mfxU8> CBitstreamBufferPool::Acquire(mfxU32 size) {
+    mfxU32 index = GetClassIndex(size);
+    if (index >= NUM_CLASSES)
+        return std::vector<mfxU8>(size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free[index].empty()) {
+            std::vector<mfxU8> buffer(std::move(m_free[index].back()));
+            m_free[index].pop_back();
+            return buffer;
+        }
+    }
+    // allocated out of the lock
+    return std::vector<mfxU8>((mfxU32)MIN_CLASS_SIZE << index);
+}
+
+void CBitstreamBufferPool::Release(std::vector<mfxU8>&& buffer) {
+    if (buffer.size() > 0xFFFFFFFF)
+        return;
+
+    mfxU32 size  = (mfxU32)buffer.size();
+    mfxU32 index = GetClassIndex(size);
+    if (index >= NUM_CLASSES || ((mfxU32)MIN_CLASS_SIZE << index) != size)
+        return;
+
+    std::vector<mfxU8> released(std::move(buffer));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free[index].size() < MAX_FREE_BUFFERS)
+        m_free[index].push_back(std::move(released));
+}
+
+mfxU32 CBitstreamBufferPool::GetClassSize(mfxU32 size) {
+    mfxU32 index = GetClassIndex(size);
+    return (index < NUM_CLASSES) ? ((mfxU32)MIN_CLASS_SIZE << index) : size;
+}
+
+mfxU32 CBitstreamBufferPool::GetClassIndex(mfxU32 size) {
+    mfxU32 index = 0;
+    while (index < NUM_CLASSES && ((mfxU32)MIN_CLASS_SIZE << index) < size)
+        index++;
+    return index;
+}
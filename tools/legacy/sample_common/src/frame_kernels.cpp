@@ -0,0 +1,319 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define FRAME_KERNELS_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define FRAME_KERNELS_TARGET(isa)
+    #else
+        #define FRAME_KERNELS_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#endif
+
+void CopyPlane(const mfxU8* src,
+               mfxU32 srcPitch,
+               mfxU8* dst,
+               mfxU32 dstPitch,
+               mfxU32 rowBytes,
+               mfxU32 height) {
+    if (srcPitch == rowBytes && dstPitch == rowBytes) {
+        memcpy(dst, src, (size_t)rowBytes * height);
+        return;
+    }
+    for (mfxU32 i = 0; i < height; i++) {
+        memcpy(dst + (size_t)i * dstPitch, src + (size_t)i * srcPitch, rowBytes);
+    }
+}
+
+// Scalar kernels, also used for the tails of the vector kernels
+
+static void InterleaveUV_C(const mfxU8* u, const mfxU8* v, mfxU8* uv, mfxU32 w) {
+    for (mfxU32 i = 0; i < w; i++) {
+        uv[2 * i]     = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+static void DeinterleaveUV_C(const mfxU8* uv, mfxU8* u, mfxU8* v, mfxU32 w) {
+    for (mfxU32 i = 0; i < w; i++) {
+        u[i] = uv[2 * i];
+        v[i] = uv[2 * i + 1];
+    }
+}
+
+static void ShiftLeft16_C(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    for (mfxU32 i = 0; i < count; i++) {
+        dst[i] = (mfxU16)(src[i] << shift);
+    }
+}
+
+static void ShiftRight16_C(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    for (mfxU32 i = 0; i < count; i++) {
+        dst[i] = (mfxU16)(src[i] >> shift);
+    }
+}
+
+#ifdef FRAME_KERNELS_X86
+
+// SSE2 kernels
+
+FRAME_KERNELS_TARGET("sse2")
+static void InterleaveUV_SSE2(const mfxU8* u, const mfxU8* v, mfxU8* uv, mfxU32 w) {
+    mfxU32 i = 0;
+    for (; i + 16 <= w; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(u + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(v + i));
+        _mm_storeu_si128((__m128i*)(uv + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i*)(uv + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+    }
+    InterleaveUV_C(u + i, v + i, uv + 2 * i, w - i);
+}
+
+FRAME_KERNELS_TARGET("sse2")
+static void DeinterleaveUV_SSE2(const mfxU8* uv, mfxU8* u, mfxU8* v, mfxU32 w) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    mfxU32 i           = 0;
+    for (; i + 16 <= w; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(uv + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(uv + 2 * i + 16));
+        _mm_storeu_si128((__m128i*)(u + i),
+                         _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i*)(v + i),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    DeinterleaveUV_C(uv + 2 * i, u + i, v + i, w - i);
+}
+
+FRAME_KERNELS_TARGET("sse2")
+static void ShiftLeft16_SSE2(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_sll_epi16(a, s));
+    }
+    ShiftLeft16_C(src + i, dst + i, count - i, shift);
+}
+
+FRAME_KERNELS_TARGET("sse2")
+static void ShiftRight16_SSE2(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_srl_epi16(a, s));
+    }
+    ShiftRight16_C(src + i, dst + i, count - i, shift);
+}
+
+// AVX2 kernels
+
+FRAME_KERNELS_TARGET("avx2")
+static void InterleaveUV_AVX2(const mfxU8* u, const mfxU8* v, mfxU8* uv, mfxU32 w) {
+    mfxU32 i = 0;
+    for (; i + 32 <= w; i += 32) {
+        __m256i a  = _mm256_loadu_si256((const __m256i*)(u + i));
+        __m256i b  = _mm256_loadu_si256((const __m256i*)(v + i));
+        __m256i lo = _mm256_unpacklo_epi8(a, b);
+        __m256i hi = _mm256_unpackhi_epi8(a, b);
+        // unpack works within 128-bit lanes, restore the order of lanes
+        _mm256_storeu_si256((__m256i*)(uv + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(uv + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    InterleaveUV_SSE2(u + i, v + i, uv + 2 * i, w - i);
+}
+
+FRAME_KERNELS_TARGET("avx2")
+static void DeinterleaveUV_AVX2(const mfxU8* uv, mfxU8* u, mfxU8* v, mfxU32 w) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+    mfxU32 i           = 0;
+    for (; i + 32 <= w; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(uv + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(uv + 2 * i + 32));
+        __m256i x = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i y = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        // pack works within 128-bit lanes, restore the order of qwords
+        _mm256_storeu_si256((__m256i*)(u + i), _mm256_permute4x64_epi64(x, 0xD8));
+        _mm256_storeu_si256((__m256i*)(v + i), _mm256_permute4x64_epi64(y, 0xD8));
+    }
+    DeinterleaveUV_SSE2(uv + 2 * i, u + i, v + i, w - i);
+}
+
+FRAME_KERNELS_TARGET("avx2")
+static void ShiftLeft16_AVX2(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_sll_epi16(a, s));
+    }
+    ShiftLeft16_SSE2(src + i, dst + i, count - i, shift);
+}
+
+FRAME_KERNELS_TARGET("avx2")
+static void ShiftRight16_AVX2(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_srl_epi16(a, s));
+    }
+    ShiftRight16_SSE2(src + i, dst + i, count - i, shift);
+}
+
+// AVX-512 kernels
+
+FRAME_KERNELS_TARGET("avx512f,avx512bw")
+static void InterleaveUV_AVX512(const mfxU8* u, const mfxU8* v, mfxU8* uv, mfxU32 w) {
+    const __m512i idxLo = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+    const __m512i idxHi = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+    mfxU32 i            = 0;
+    for (; i + 64 <= w; i += 64) {
+        __m512i a  = _mm512_loadu_si512((const void*)(u + i));
+        __m512i b  = _mm512_loadu_si512((const void*)(v + i));
+        __m512i lo = _mm512_unpacklo_epi8(a, b);
+        __m512i hi = _mm512_unpackhi_epi8(a, b);
+        _mm512_storeu_si512((void*)(uv + 2 * i), _mm512_permutex2var_epi64(lo, idxLo, hi));
+        _mm512_storeu_si512((void*)(uv + 2 * i + 64), _mm512_permutex2var_epi64(lo, idxHi, hi));
+    }
+    InterleaveUV_AVX2(u + i, v + i, uv + 2 * i, w - i);
+}
+
+FRAME_KERNELS_TARGET("avx512f,avx512bw")
+static void DeinterleaveUV_AVX512(const mfxU8* uv, mfxU8* u, mfxU8* v, mfxU32 w) {
+    const __m512i mask = _mm512_set1_epi16(0x00FF);
+    const __m512i idx  = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    mfxU32 i           = 0;
+    for (; i + 64 <= w; i += 64) {
+        __m512i a = _mm512_loadu_si512((const void*)(uv + 2 * i));
+        __m512i b = _mm512_loadu_si512((const void*)(uv + 2 * i + 64));
+        __m512i x = _mm512_packus_epi16(_mm512_and_si512(a, mask), _mm512_and_si512(b, mask));
+        __m512i y = _mm512_packus_epi16(_mm512_srli_epi16(a, 8), _mm512_srli_epi16(b, 8));
+        _mm512_storeu_si512((void*)(u + i), _mm512_permutex2var_epi64(x, idx, x));
+        _mm512_storeu_si512((void*)(v + i), _mm512_permutex2var_epi64(y, idx, y));
+    }
+    DeinterleaveUV_AVX2(uv + 2 * i, u + i, v + i, w - i);
+}
+
+FRAME_KERNELS_TARGET("avx512f,avx512bw")
+static void ShiftLeft16_AVX512(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i a = _mm512_loadu_si512((const void*)(src + i));
+        _mm512_storeu_si512((void*)(dst + i), _mm512_sll_epi16(a, s));
+    }
+    ShiftLeft16_AVX2(src + i, dst + i, count - i, shift);
+}
+
+FRAME_KERNELS_TARGET("avx512f,avx512bw")
+static void ShiftRight16_AVX512(const mfxU16* src, mfxU16* dst, mfxU32 count, mfxU32 shift) {
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    mfxU32 i        = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i a = _mm512_loadu_si512((const void*)(src + i));
+        _mm512_storeu_si512((void*)(dst + i), _mm512_srl_epi16(a, s));
+    }
+    ShiftRight16_AVX2(src + i, dst + i, count - i, shift);
+}
+
+static FrameKernelsIsa DetectIsa() {
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 0);
+    int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    if (!(regs[3] & (1 << 26))) // SSE2
+        return FRAME_KERNELS_SCALAR;
+    // OS must save YMM (and ZMM) state on context switch
+    if (!(regs[2] & (1 << 27)) || maxLeaf < 7) // OSXSAVE
+        return FRAME_KERNELS_SSE2;
+    unsigned long long xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6)
+        return FRAME_KERNELS_SSE2;
+    __cpuidex(regs, 7, 0);
+    if (!(regs[1] & (1 << 5))) // AVX2
+        return FRAME_KERNELS_SSE2;
+    if ((xcr0 & 0xE6) == 0xE6 && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30))) // AVX512F, BW
+        return FRAME_KERNELS_AVX512;
+    return FRAME_KERNELS_AVX2;
+    #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return FRAME_KERNELS_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return FRAME_KERNELS_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return FRAME_KERNELS_SSE2;
+    return FRAME_KERNELS_SCALAR;
+    #endif
+}
+
+#else // !FRAME_KERNELS_X86
+
+static FrameKernelsIsa DetectIsa() {
+    return FRAME_KERNELS_SCALAR;
+}
+
+#endif // FRAME_KERNELS_X86
+
+static const FrameKernels g_Kernels[] = {
+    { FRAME_KERNELS_SCALAR, InterleaveUV_C, DeinterleaveUV_C, ShiftLeft16_C, ShiftRight16_C },
+#ifdef FRAME_KERNELS_X86
+    { FRAME_KERNELS_SSE2,
+      InterleaveUV_SSE2,
+      DeinterleaveUV_SSE2,
+      ShiftLeft16_SSE2,
+      ShiftRight16_SSE2 },
+    { FRAME_KERNELS_AVX2,
+      InterleaveUV_AVX2,
+      DeinterleaveUV_AVX2,
+      ShiftLeft16_AVX2,
+      ShiftRight16_AVX2 },
+    { FRAME_KERNELS_AVX512,
+      InterleaveUV_AVX512,
+      DeinterleaveUV_AVX512,
+      ShiftLeft16_AVX512,
+      ShiftRight16_AVX512 },
+#endif
+};
+
+static FrameKernelsIsa GetMaxIsa() {
+    FrameKernelsIsa isa = DetectIsa();
+
+    const char* cap = getenv("SAMPLE_FRAME_KERNELS");
+    if (cap) {
+        static const char* names[] = { "scalar", "sse2", "avx2", "avx512" };
+        for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+            if (!strcmp(cap, names[i]) && i < (int)isa) {
+                isa = (FrameKernelsIsa)i;
+                break;
+            }
+        }
+    }
+    return isa;
+}
+
+const FrameKernels* GetFrameKernels(FrameKernelsIsa isa) {
+    static const FrameKernelsIsa maxIsa = DetectIsa();
+    if (isa > maxIsa || (size_t)isa >= sizeof(g_Kernels) / sizeof(g_Kernels[0]))
+        return NULL;
+    return &g_Kernels[isa];
+}
+
+const FrameKernels& GetFrameKernels() {
+    static const FrameKernels& kernels = g_Kernels[GetMaxIsa()];
+    return kernels;
+}
@@ -49,8 +49,9 @@ mfxStatus GeneralAllocator::Init(mfxAllocatorParams* pParams) {
         MSDK_CHECK_STATUS(sts, "m_D3DAllocator.get failed");
     }
 
+    // options of system memory frames are passed through
     m_SYSAllocator.reset(new SysMemFrameAllocator);
-    sts = m_SYSAllocator.get()->Init(0);
+    sts = m_SYSAllocator.get()->Init(dynamic_cast<SysMemAllocatorParams*>(pParams));
     MSDK_CHECK_STATUS(sts, "m_SYSAllocator.get failed");
 
     return sts;
@@ -0,0 +1,493 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include <algorithm>
+
+#include "avc_bitstream.h"
+#include "sample_defs.h"
+
+namespace ProtectedLibrary {
+
+static inline mfxU32 CeilLog2(mfxU32 value) {
+    mfxU32 bits = 0;
+    while (((mfxU32)1 << bits) < value)
+        bits++;
+    return bits;
+}
+
+HEVCHeadersBitstream::HEVCHeadersBitstream() : AVCBaseBitstream() {}
+
+HEVCHeadersBitstream::HEVCHeadersBitstream(mfxU8* const pb, const mfxU32 maxsize)
+        : AVCBaseBitstream(pb, maxsize) {}
+
+mfxStatus HEVCHeadersBitstream::GetNALUnitHeader(HEVC_NAL_Unit_Type& uNALUnitType,
+                                                 mfxU8& uLayerId,
+                                                 mfxU8& uTemporalId) {
+    mfxU32 header = GetBits(16);
+
+    // forbidden_zero_bit
+    if (header & 0x8000)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    uNALUnitType = (HEVC_NAL_Unit_Type)((header >> 9) & 0x3f);
+    uLayerId     = (mfxU8)((header >> 3) & 0x3f);
+    uTemporalId  = (mfxU8)(header & 0x7);
+    if (!uTemporalId)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    uTemporalId -= 1;
+    return MFX_ERR_NONE;
+}
+
+void HEVCHeadersBitstream::GetProfileTierLevel(HEVCProfileTierLevel* ptl,
+                                               mfxU32 maxSubLayersMinus1) {
+    ptl->general_profile_space               = (mfxU8)GetBits(2);
+    ptl->general_tier_flag                   = (mfxU8)Get1Bit();
+    ptl->general_profile_idc                 = (mfxU8)GetBits(5);
+    ptl->general_profile_compatibility_flags = GetBits(32);
+    ptl->general_progressive_source_flag     = (mfxU8)Get1Bit();
+    ptl->general_interlaced_source_flag      = (mfxU8)Get1Bit();
+    ptl->general_non_packed_constraint_flag  = (mfxU8)Get1Bit();
+    ptl->general_frame_only_constraint_flag  = (mfxU8)Get1Bit();
+    // 43 bits of constraint flags and general_inbld_flag
+    SkipBits(32);
+    SkipBits(12);
+    ptl->general_level_idc = (mfxU8)GetBits(8);
+
+    mfxU8 profilePresent[HEVC_MAX_SUB_LAYERS] = {};
+    mfxU8 levelPresent[HEVC_MAX_SUB_LAYERS]   = {};
+    for (mfxU32 i = 0; i < maxSubLayersMinus1; i++) {
+        profilePresent[i] = (mfxU8)Get1Bit();
+        levelPresent[i]   = (mfxU8)Get1Bit();
+    }
+    if (maxSubLayersMinus1) {
+        // reserved_zero_2bits
+        SkipBits(2 * (8 - maxSubLayersMinus1));
+    }
+
+    for (mfxU32 i = 0; i < maxSubLayersMinus1; i++) {
+        if (profilePresent[i]) {
+            // 88 bits of sub-layer profile
+            SkipBits(32);
+            SkipBits(32);
+            SkipBits(24);
+        }
+        if (levelPresent[i])
+            SkipBits(8);
+    }
+}
+
+void HEVCHeadersBitstream::SkipScalingListData() {
+    for (mfxU32 sizeId = 0; sizeId < 4; sizeId++) {
+        for (mfxU32 matrixId = 0; matrixId < 6; matrixId += (sizeId == 3) ? 3 : 1) {
+            // scaling_list_pred_mode_flag
+            if (!Get1Bit()) {
+                // scaling_list_pred_matrix_id_delta
+                GetVLCElement(false);
+                continue;
+            }
+
+            mfxU32 coefNum = (std::min)(64u, 1u << (4 + (sizeId << 1)));
+            if (sizeId > 1) {
+                // scaling_list_dc_coef_minus8
+                GetVLCElement(true);
+            }
+            for (mfxU32 i = 0; i < coefNum; i++) {
+                // scaling_list_delta_coef
+                GetVLCElement(true);
+            }
+        }
+    }
+}
+
+mfxStatus HEVCHeadersBitstream::GetShortTermRefPicSet(HEVCSeqParamSet* sps, mfxU32 idx) {
+    mfxU32 inter_ref_pic_set_prediction_flag = idx ? Get1Bit() : 0;
+
+    if (inter_ref_pic_set_prediction_flag) {
+        // delta_idx_minus1 is present in slice headers only, so the reference is the previous set
+        mfxU32 refIdx = idx - 1;
+
+        // delta_rps_sign, abs_delta_rps_minus1
+        Get1Bit();
+        if (GetVLCElement(false) > 32767)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+        mfxU32 count = 0;
+        for (mfxU32 j = 0; j <= sps->NumDeltaPocs[refIdx]; j++) {
+            mfxU32 used_by_curr_pic_flag = Get1Bit();
+            mfxU32 use_delta_flag        = used_by_curr_pic_flag ? 1 : Get1Bit();
+            count += used_by_curr_pic_flag | use_delta_flag;
+        }
+
+        if (count > HEVC_MAX_DPB_SIZE)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        sps->NumDeltaPocs[idx] = (mfxU8)count;
+        return MFX_ERR_NONE;
+    }
+
+    mfxU32 num_negative_pics = GetVLCElement(false);
+    mfxU32 num_positive_pics = GetVLCElement(false);
+    if (num_negative_pics > HEVC_MAX_DPB_SIZE || num_positive_pics > HEVC_MAX_DPB_SIZE ||
+        num_negative_pics + num_positive_pics > HEVC_MAX_DPB_SIZE)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    for (mfxU32 i = 0; i < num_negative_pics + num_positive_pics; i++) {
+        // delta_poc_s0/s1_minus1, used_by_curr_pic_s0/s1_flag
+        GetVLCElement(false);
+        Get1Bit();
+    }
+
+    sps->NumDeltaPocs[idx] = (mfxU8)(num_negative_pics + num_positive_pics);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus HEVCHeadersBitstream::GetVideoParamSet(HEVCVideoParamSet* vps) {
+    vps->Reset();
+
+    vps->vps_video_parameter_set_id    = (mfxU8)GetBits(4);
+    vps->vps_base_layer_internal_flag  = (mfxU8)Get1Bit();
+    vps->vps_base_layer_available_flag = (mfxU8)Get1Bit();
+    vps->vps_max_layers                = (mfxU8)(GetBits(6) + 1);
+    vps->vps_max_sub_layers            = (mfxU8)(GetBits(3) + 1);
+    vps->vps_temporal_id_nesting_flag  = (mfxU8)Get1Bit();
+
+    if (vps->vps_max_sub_layers > HEVC_MAX_SUB_LAYERS)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    // vps_reserved_0xffff_16bits
+    if (GetBits(16) != 0xffff)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    GetProfileTierLevel(&vps->profile_tier_level, vps->vps_max_sub_layers - 1);
+
+    vps->vps_sub_layer_ordering_info_present_flag = (mfxU8)Get1Bit();
+    mfxU32 first = vps->vps_sub_layer_ordering_info_present_flag ? 0 : vps->vps_max_sub_layers - 1;
+    for (mfxU32 i = first; i < vps->vps_max_sub_layers; i++) {
+        vps->vps_max_dec_pic_buffering[i] = GetVLCElement(false) + 1;
+        vps->vps_max_num_reorder_pics[i]  = GetVLCElement(false);
+        vps->vps_max_latency_increase[i]  = GetVLCElement(false);
+    }
+    // values of the highest sub-layer are used for all of them
+    for (mfxU32 i = 0; i < first; i++) {
+        vps->vps_max_dec_pic_buffering[i] = vps->vps_max_dec_pic_buffering[first];
+        vps->vps_max_num_reorder_pics[i]  = vps->vps_max_num_reorder_pics[first];
+        vps->vps_max_latency_increase[i]  = vps->vps_max_latency_increase[first];
+    }
+
+    vps->vps_max_layer_id   = (mfxU8)GetBits(6);
+    vps->vps_num_layer_sets = GetVLCElement(false) + 1;
+    if (vps->vps_num_layer_sets > 1024)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    for (mfxU32 i = 1; i < vps->vps_num_layer_sets; i++) {
+        for (mfxU32 j = 0; j <= vps->vps_max_layer_id; j++) {
+            // layer_id_included_flag
+            Get1Bit();
+        }
+    }
+
+    vps->vps_timing_info_present_flag = (mfxU8)Get1Bit();
+    if (vps->vps_timing_info_present_flag) {
+        vps->vps_num_units_in_tick               = GetBits(32);
+        vps->vps_time_scale                      = GetBits(32);
+        vps->vps_poc_proportional_to_timing_flag = (mfxU8)Get1Bit();
+        if (vps->vps_poc_proportional_to_timing_flag)
+            vps->vps_num_ticks_poc_diff_one = GetVLCElement(false) + 1;
+        vps->vps_num_hrd_parameters = GetVLCElement(false);
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus HEVCHeadersBitstream::GetSequenceParamSet(HEVCSeqParamSet* sps, HeaderParseMode mode) {
+    sps->Reset();
+
+    sps->sps_video_parameter_set_id   = (mfxU8)GetBits(4);
+    sps->sps_max_sub_layers           = (mfxU8)(GetBits(3) + 1);
+    sps->sps_temporal_id_nesting_flag = (mfxU8)Get1Bit();
+
+    if (sps->sps_max_sub_layers > HEVC_MAX_SUB_LAYERS)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    GetProfileTierLevel(&sps->profile_tier_level, sps->sps_max_sub_layers - 1);
+
+    mfxU32 sps_id = GetVLCElement(false);
+    if (sps_id > HEVC_MAX_NUM_SPS - 1)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    sps->sps_seq_parameter_set_id = (mfxU8)sps_id;
+
+    mfxU32 chroma_format_idc = GetVLCElement(false);
+    if (chroma_format_idc > 3)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    sps->chroma_format_idc = (mfxU8)chroma_format_idc;
+    if (sps->chroma_format_idc == 3)
+        sps->separate_colour_plane_flag = (mfxU8)Get1Bit();
+
+    sps->pic_width_in_luma_samples  = GetVLCElement(false);
+    sps->pic_height_in_luma_samples = GetVLCElement(false);
+    if (!sps->pic_width_in_luma_samples || !sps->pic_height_in_luma_samples)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    sps->conformance_window_flag = (mfxU8)Get1Bit();
+    if (sps->conformance_window_flag) {
+        sps->conf_win_left_offset   = GetVLCElement(false);
+        sps->conf_win_right_offset  = GetVLCElement(false);
+        sps->conf_win_top_offset    = GetVLCElement(false);
+        sps->conf_win_bottom_offset = GetVLCElement(false);
+    }
+
+    mfxU32 bit_depth_luma   = GetVLCElement(false) + 8;
+    mfxU32 bit_depth_chroma = GetVLCElement(false) + 8;
+    if (bit_depth_luma > 16 || bit_depth_chroma > 16)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    sps->bit_depth_luma   = (mfxU8)bit_depth_luma;
+    sps->bit_depth_chroma = (mfxU8)bit_depth_chroma;
+
+    mfxU32 log2_max_pic_order_cnt_lsb = GetVLCElement(false) + 4;
+    if (log2_max_pic_order_cnt_lsb > 16)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    sps->log2_max_pic_order_cnt_lsb = (mfxU8)log2_max_pic_order_cnt_lsb;
+
+    if (mode == PARSE_HEADERS_LAZY)
+        return MFX_ERR_NONE;
+
+    sps->sps_sub_layer_ordering_info_present_flag = (mfxU8)Get1Bit();
+    mfxU32 first = sps->sps_sub_layer_ordering_info_present_flag ? 0 : sps->sps_max_sub_layers - 1;
+    for (mfxU32 i = first; i < sps->sps_max_sub_layers; i++) {
+        sps->sps_max_dec_pic_buffering[i] = GetVLCElement(false) + 1;
+        sps->sps_max_num_reorder_pics[i]  = GetVLCElement(false);
+        sps->sps_max_latency_increase[i]  = GetVLCElement(false);
+    }
+    for (mfxU32 i = 0; i < first; i++) {
+        sps->sps_max_dec_pic_buffering[i] = sps->sps_max_dec_pic_buffering[first];
+        sps->sps_max_num_reorder_pics[i]  = sps->sps_max_num_reorder_pics[first];
+        sps->sps_max_latency_increase[i]  = sps->sps_max_latency_increase[first];
+    }
+
+    sps->log2_min_luma_coding_block_size          = (mfxU8)(GetVLCElement(false) + 3);
+    sps->log2_diff_max_min_luma_coding_block_size = (mfxU8)GetVLCElement(false);
+    sps->log2_min_transform_block_size            = (mfxU8)(GetVLCElement(false) + 2);
+    sps->log2_diff_max_min_transform_block_size   = (mfxU8)GetVLCElement(false);
+    sps->max_transform_hierarchy_depth_inter      = (mfxU8)GetVLCElement(false);
+    sps->max_transform_hierarchy_depth_intra      = (mfxU8)GetVLCElement(false);
+
+    mfxU32 log2CtbSize =
+        sps->log2_min_luma_coding_block_size + sps->log2_diff_max_min_luma_coding_block_size;
+    if (log2CtbSize < 4 || log2CtbSize > 6)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    mfxU32 ctbSize      = 1u << log2CtbSize;
+    sps->PicSizeInCtbsY = ((sps->pic_width_in_luma_samples + ctbSize - 1) >> log2CtbSize) *
+                          ((sps->pic_height_in_luma_samples + ctbSize - 1) >> log2CtbSize);
+
+    sps->scaling_list_enabled_flag = (mfxU8)Get1Bit();
+    if (sps->scaling_list_enabled_flag) {
+        sps->sps_scaling_list_data_present_flag = (mfxU8)Get1Bit();
+        if (sps->sps_scaling_list_data_present_flag)
+            SkipScalingListData();
+    }
+
+    sps->amp_enabled_flag                    = (mfxU8)Get1Bit();
+    sps->sample_adaptive_offset_enabled_flag = (mfxU8)Get1Bit();
+    sps->pcm_enabled_flag                    = (mfxU8)Get1Bit();
+    if (sps->pcm_enabled_flag) {
+        sps->pcm_sample_bit_depth_luma                    = (mfxU8)(GetBits(4) + 1);
+        sps->pcm_sample_bit_depth_chroma                  = (mfxU8)(GetBits(4) + 1);
+        sps->log2_min_pcm_luma_coding_block_size          = (mfxU8)(GetVLCElement(false) + 3);
+        sps->log2_diff_max_min_pcm_luma_coding_block_size = (mfxU8)GetVLCElement(false);
+        sps->pcm_loop_filter_disabled_flag                = (mfxU8)Get1Bit();
+    }
+
+    mfxU32 num_short_term_ref_pic_sets = GetVLCElement(false);
+    if (num_short_term_ref_pic_sets > HEVC_MAX_SHORT_TERM_RPS)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    sps->num_short_term_ref_pic_sets = (mfxU8)num_short_term_ref_pic_sets;
+
+    for (mfxU32 i = 0; i < sps->num_short_term_ref_pic_sets; i++) {
+        mfxStatus sts = GetShortTermRefPicSet(sps, i);
+        if (sts != MFX_ERR_NONE)
+            return sts;
+    }
+
+    sps->long_term_ref_pics_present_flag = (mfxU8)Get1Bit();
+    if (sps->long_term_ref_pics_present_flag) {
+        mfxU32 num_long_term_ref_pics_sps = GetVLCElement(false);
+        if (num_long_term_ref_pics_sps > HEVC_MAX_LONG_TERM_REF_SPS)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        sps->num_long_term_ref_pics_sps = (mfxU8)num_long_term_ref_pics_sps;
+
+        for (mfxU32 i = 0; i < sps->num_long_term_ref_pics_sps; i++) {
+            // lt_ref_pic_poc_lsb_sps, used_by_curr_pic_lt_sps_flag
+            SkipBits(sps->log2_max_pic_order_cnt_lsb);
+            Get1Bit();
+        }
+    }
+
+    sps->sps_temporal_mvp_enabled_flag       = (mfxU8)Get1Bit();
+    sps->strong_intra_smoothing_enabled_flag = (mfxU8)Get1Bit();
+    sps->vui_parameters_present_flag         = (mfxU8)Get1Bit();
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus HEVCHeadersBitstream::GetPictureParamSet(HEVCPicParamSet* pps, HeaderParseMode mode) {
+    pps->Reset();
+
+    mfxU32 pps_id = GetVLCElement(false);
+    if (pps_id > HEVC_MAX_NUM_PPS - 1)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    pps->pps_pic_parameter_set_id = (mfxU8)pps_id;
+
+    mfxU32 sps_id = GetVLCElement(false);
+    if (sps_id > HEVC_MAX_NUM_SPS - 1)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    pps->pps_seq_parameter_set_id = (mfxU8)sps_id;
+
+    pps->dependent_slice_segments_enabled_flag = (mfxU8)Get1Bit();
+    pps->output_flag_present_flag              = (mfxU8)Get1Bit();
+    pps->num_extra_slice_header_bits           = (mfxU8)GetBits(3);
+
+    if (mode == PARSE_HEADERS_LAZY)
+        return MFX_ERR_NONE;
+
+    pps->sign_data_hiding_enabled_flag = (mfxU8)Get1Bit();
+    pps->cabac_init_present_flag       = (mfxU8)Get1Bit();
+
+    mfxU32 num_ref_idx_l0 = GetVLCElement(false) + 1;
+    mfxU32 num_ref_idx_l1 = GetVLCElement(false) + 1;
+    if (num_ref_idx_l0 > 15 || num_ref_idx_l1 > 15)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    pps->num_ref_idx_l0_default_active = (mfxU8)num_ref_idx_l0;
+    pps->num_ref_idx_l1_default_active = (mfxU8)num_ref_idx_l1;
+
+    mfxI32 init_qp = 26 + GetVLCElement(true);
+    if (init_qp < -38 || init_qp > 51)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    pps->init_qp = (mfxI8)init_qp;
+
+    pps->constrained_intra_pred_flag = (mfxU8)Get1Bit();
+    pps->transform_skip_enabled_flag = (mfxU8)Get1Bit();
+    pps->cu_qp_delta_enabled_flag    = (mfxU8)Get1Bit();
+    if (pps->cu_qp_delta_enabled_flag)
+        pps->diff_cu_qp_delta_depth = (mfxU8)GetVLCElement(false);
+
+    mfxI32 cb_qp_offset = GetVLCElement(true);
+    mfxI32 cr_qp_offset = GetVLCElement(true);
+    if (cb_qp_offset < -12 || cb_qp_offset > 12 || cr_qp_offset < -12 || cr_qp_offset > 12)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    pps->pps_cb_qp_offset = (mfxI8)cb_qp_offset;
+    pps->pps_cr_qp_offset = (mfxI8)cr_qp_offset;
+
+    pps->pps_slice_chroma_qp_offsets_present_flag = (mfxU8)Get1Bit();
+    pps->weighted_pred_flag                       = (mfxU8)Get1Bit();
+    pps->weighted_bipred_flag                     = (mfxU8)Get1Bit();
+    pps->transquant_bypass_enabled_flag           = (mfxU8)Get1Bit();
+    pps->tiles_enabled_flag                       = (mfxU8)Get1Bit();
+    pps->entropy_coding_sync_enabled_flag         = (mfxU8)Get1Bit();
+
+    if (pps->tiles_enabled_flag) {
+        mfxU32 num_tile_columns = GetVLCElement(false) + 1;
+        mfxU32 num_tile_rows    = GetVLCElement(false) + 1;
+        if (num_tile_columns > HEVC_MAX_TILE_COLUMNS || num_tile_rows > HEVC_MAX_TILE_ROWS)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+        pps->num_tile_columns = (mfxU8)num_tile_columns;
+        pps->num_tile_rows    = (mfxU8)num_tile_rows;
+
+        pps->uniform_spacing_flag = (mfxU8)Get1Bit();
+        if (!pps->uniform_spacing_flag) {
+            // the last column and row take the rest of the picture
+            for (mfxU32 i = 0; i + 1 < pps->num_tile_columns; i++)
+                pps->column_width[i] = (mfxU16)(GetVLCElement(false) + 1);
+            for (mfxU32 i = 0; i + 1 < pps->num_tile_rows; i++)
+                pps->row_height[i] = (mfxU16)(GetVLCElement(false) + 1);
+        }
+        pps->loop_filter_across_tiles_enabled_flag = (mfxU8)Get1Bit();
+    }
+    else {
+        pps->num_tile_columns = 1;
+        pps->num_tile_rows    = 1;
+    }
+
+    pps->pps_loop_filter_across_slices_enabled_flag = (mfxU8)Get1Bit();
+    pps->deblocking_filter_control_present_flag     = (mfxU8)Get1Bit();
+    if (pps->deblocking_filter_control_present_flag) {
+        pps->deblocking_filter_override_enabled_flag = (mfxU8)Get1Bit();
+        pps->pps_deblocking_filter_disabled_flag     = (mfxU8)Get1Bit();
+        if (!pps->pps_deblocking_filter_disabled_flag) {
+            pps->pps_beta_offset_div2 = (mfxI8)GetVLCElement(true);
+            pps->pps_tc_offset_div2   = (mfxI8)GetVLCElement(true);
+        }
+    }
+
+    pps->pps_scaling_list_data_present_flag = (mfxU8)Get1Bit();
+    if (pps->pps_scaling_list_data_present_flag)
+        SkipScalingListData();
+
+    pps->lists_modification_present_flag             = (mfxU8)Get1Bit();
+    pps->log2_parallel_merge_level                   = (mfxU8)(GetVLCElement(false) + 2);
+    pps->slice_segment_header_extension_present_flag = (mfxU8)Get1Bit();
+    pps->pps_extension_present_flag                  = (mfxU8)Get1Bit();
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus HEVCHeadersBitstream::GetSliceHeaderPart1(HEVCSliceHeader* hdr) {
+    hdr->first_slice_segment_in_pic_flag = (mfxU8)Get1Bit();
+    if (hdr->nal_unit_type >= HEVC_NAL_UT_BLA_W_LP && hdr->nal_unit_type <= HEVC_NAL_UT_IRAP_MAX)
+        hdr->no_output_of_prior_pics_flag = (mfxU8)Get1Bit();
+
+    mfxU32 pps_id = GetVLCElement(false);
+    if (pps_id > HEVC_MAX_NUM_PPS - 1)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    hdr->slice_pic_parameter_set_id = (mfxU8)pps_id;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus HEVCHeadersBitstream::GetSliceHeaderPart2(HEVCSliceHeader* hdr,
+                                                    const HEVCPicParamSet* pps,
+                                                    const HEVCSeqParamSet* sps) {
+    hdr->dependent_slice_segment_flag = 0;
+    hdr->slice_segment_address        = 0;
+    hdr->pic_output_flag              = 1;
+
+    if (!hdr->first_slice_segment_in_pic_flag) {
+        // address length is known only from the fully parsed SPS
+        if (!sps->PicSizeInCtbsY)
+            return MFX_ERR_NOT_INITIALIZED;
+
+        if (pps->dependent_slice_segments_enabled_flag)
+            hdr->dependent_slice_segment_flag = (mfxU8)Get1Bit();
+        hdr->slice_segment_address = GetBits(CeilLog2(sps->PicSizeInCtbsY));
+        if (hdr->slice_segment_address >= sps->PicSizeInCtbsY)
+            return MFX_ERR_UNDEFINED_BEHAVIOR;
+    }
+
+    // the rest is inherited from the independent slice segment
+    if (hdr->dependent_slice_segment_flag)
+        return MFX_ERR_NONE;
+
+    // slice_reserved_flag
+    if (pps->num_extra_slice_header_bits)
+        SkipBits(pps->num_extra_slice_header_bits);
+
+    mfxU32 slice_type = GetVLCElement(false);
+    if (slice_type > 2)
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+    hdr->slice_type = (mfxU8)slice_type;
+
+    if (pps->output_flag_present_flag)
+        hdr->pic_output_flag = (mfxU8)Get1Bit();
+    if (sps->separate_colour_plane_flag)
+        hdr->colour_plane_id = (mfxU8)GetBits(2);
+
+    if (hdr->nal_unit_type != HEVC_NAL_UT_IDR_W_RADL && hdr->nal_unit_type != HEVC_NAL_UT_IDR_N_LP)
+        hdr->slice_pic_order_cnt_lsb = GetBits(sps->log2_max_pic_order_cnt_lsb);
+
+    return MFX_ERR_NONE;
+}
+
+} // namespace ProtectedLibrary
@@ -0,0 +1,202 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "frame_kernels.h"
+#include "nal_scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define NAL_SCANNER_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define NAL_SCANNER_TARGET(isa)
+    #else
+        #define NAL_SCANNER_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#endif
+
+typedef const mfxU8* (*FindPrefixFunc)(const mfxU8* p, const mfxU8* end, mfxU8 last);
+
+// Looks for 00 00 'last', 'last' is not zero
+static const mfxU8* FindPrefix_C(const mfxU8* p, const mfxU8* end, mfxU8 last) {
+    while (end - p >= 3) {
+        if (p[2] == last) {
+            if (!p[1] && !p[0])
+                return p;
+            p += 1;
+        }
+        else if (p[2]) {
+            // Neither of p, p + 1, p + 2 can start the sequence
+            p += 3;
+        }
+        else {
+            p += 1;
+        }
+    }
+    return end;
+}
+
+#ifdef NAL_SCANNER_X86
+
+static inline mfxU32 CountTrailingZeros(mfxU64 mask) {
+    #if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+        #if defined(_M_X64)
+    _BitScanForward64(&index, mask);
+        #else
+    if (!_BitScanForward(&index, (unsigned long)mask)) {
+        _BitScanForward(&index, (unsigned long)(mask >> 32));
+        index += 32;
+    }
+        #endif
+    return (mfxU32)index;
+    #else
+    return (mfxU32)__builtin_ctzll(mask);
+    #endif
+}
+
+// Each step compares three overlapping vectors: p[i] == 0, p[i + 1] == 0, p[i + 2] == last
+
+NAL_SCANNER_TARGET("sse2")
+static const mfxU8* FindPrefix_SSE2(const mfxU8* p, const mfxU8* end, mfxU8 last) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i tail = _mm_set1_epi8((char)last);
+    while (end - p >= 16 + 2) {
+        __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), tail);
+        // 'last' bytes are rare in the coded data, so most of the steps end here
+        if (_mm_movemask_epi8(c)) {
+            __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero);
+            __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), zero);
+            mfxU32 mask = (mfxU32)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a, b), c));
+            if (mask)
+                return p + CountTrailingZeros(mask);
+        }
+        p += 16;
+    }
+    return FindPrefix_C(p, end, last);
+}
+
+NAL_SCANNER_TARGET("avx2")
+static const mfxU8* FindPrefix_AVX2(const mfxU8* p, const mfxU8* end, mfxU8 last) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i tail = _mm256_set1_epi8((char)last);
+    while (end - p >= 32 + 2) {
+        __m256i c = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 2)), tail);
+        if (_mm256_movemask_epi8(c)) {
+            __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), zero);
+            __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 1)), zero);
+            mfxU32 mask =
+                (mfxU32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(a, b), c));
+            if (mask)
+                return p + CountTrailingZeros(mask);
+        }
+        p += 32;
+    }
+    return FindPrefix_SSE2(p, end, last);
+}
+
+NAL_SCANNER_TARGET("avx512f,avx512bw")
+static const mfxU8* FindPrefix_AVX512(const mfxU8* p, const mfxU8* end, mfxU8 last) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i tail = _mm512_set1_epi8((char)last);
+    while (end - p >= 64 + 2) {
+        __mmask64 c = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(p + 2)), tail);
+        if (c) {
+            __mmask64 a = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)p), zero);
+            __mmask64 b = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)(p + 1)), zero);
+            mfxU64 mask = (mfxU64)(a & b & c);
+            if (mask)
+                return p + CountTrailingZeros(mask);
+        }
+        p += 64;
+    }
+    return FindPrefix_AVX2(p, end, last);
+}
+
+#endif // NAL_SCANNER_X86
+
+static FindPrefixFunc GetFindPrefix() {
+    static const FindPrefixFunc funcs[] = {
+        FindPrefix_C,
+#ifdef NAL_SCANNER_X86
+        FindPrefix_SSE2,
+        FindPrefix_AVX2,
+        FindPrefix_AVX512
+#endif
+    };
+    static const FindPrefixFunc func = funcs[GetFrameKernels().isa];
+    return func;
+}
+
+const mfxU8* FindAnnexBStartCode(const mfxU8* begin, const mfxU8* end) {
+    return GetFindPrefix()(begin, end, 0x01);
+}
+
+const mfxU8* FindEmulationPrevention(const mfxU8* begin, const mfxU8* end) {
+    return GetFindPrefix()(begin, end, 0x03);
+}
+
+CNalUnitIterator::CNalUnitIterator(NalStreamType type)
+        : m_type(type),
+          m_pBegin(NULL),
+          m_pCurrent(NULL),
+          m_pEnd(NULL),
+          m_bComplete(true) {}
+
+void CNalUnitIterator::Init(const mfxU8* data, size_t size, bool complete) {
+    m_pBegin    = data;
+    m_pEnd      = data + size;
+    m_bComplete = complete;
+    // Skip leading garbage, remainder starts with the start code
+    m_pCurrent = FindAnnexBStartCode(data, m_pEnd);
+    if (m_pCurrent == m_pEnd && !complete) {
+        // Keep zeros which may become a start code with the next portion of data
+        mfxU32 zeros = 0;
+        while (zeros < 2 && m_pCurrent > data && !m_pCurrent[-1]) {
+            m_pCurrent--;
+            zeros++;
+        }
+    }
+}
+
+mfxU32 CNalUnitIterator::GetNalUnitType(NalStreamType type, const mfxU8* header, size_t size) {
+    switch (type) {
+        case NAL_STREAM_AVC:
+            return size >= 1 ? (header[0] & 0x1f) : 0;
+        case NAL_STREAM_HEVC:
+            return size >= 2 ? ((header[0] >> 1) & 0x3f) : 0;
+        case NAL_STREAM_VVC:
+            return size >= 2 ? ((header[1] >> 3) & 0x1f) : 0;
+        default:
+            return 0;
+    }
+}
+
+bool CNalUnitIterator::GetNext(NalUnitInfo& nal) {
+    if (m_pEnd - m_pCurrent < 3)
+        return false;
+
+    const mfxU8* header = m_pCurrent + 3;
+    const mfxU8* next   = FindAnnexBStartCode(header, m_pEnd);
+    if (next == m_pEnd && !m_bComplete)
+        return false;
+
+    // Zeros before the next start code are either trailing_zero_8bits or
+    // the leading zero of the 4-byte start code
+    const mfxU8* last = next;
+    while (last > header && !last[-1])
+        last--;
+
+    nal.data          = header;
+    nal.size          = (mfxU32)(last - header);
+    nal.startCodeSize = (m_pCurrent > m_pBegin && !m_pCurrent[-1]) ? 4 : 3;
+    nal.type          = GetNalUnitType(m_type, header, nal.size);
+
+    m_pCurrent = next;
+    return true;
+}
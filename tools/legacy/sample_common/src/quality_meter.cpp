@@ -0,0 +1,465 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "frame_kernels.h"
+#include "quality_meter.h"
+#include "sample_defs.h"
+#include "vm/atomic_defs.h"
+
+namespace {
+
+// Accounts the time of a public call of the meter on every return path
+class TimeMeasurementGuard {
+public:
+    explicit TimeMeasurementGuard(CTimeStatisticsReal& stat) : m_stat(stat) {
+        m_stat.StartTimeMeasurement();
+    }
+    ~TimeMeasurementGuard() {
+        m_stat.StopTimeMeasurement();
+    }
+
+private:
+    CTimeStatisticsReal& m_stat;
+
+    TimeMeasurementGuard(const TimeMeasurementGuard&);
+    void operator=(const TimeMeasurementGuard&);
+};
+
+#if (MFX_VERSION >= 2000)
+// Returns the surface output by the decoder to the library on every return path
+class DecodedSurfaceGuard {
+public:
+    explicit DecodedSurfaceGuard(mfxFrameSurface1* pSurface) : m_pSurface(pSurface) {}
+    ~DecodedSurfaceGuard() {
+        std::ignore = m_pSurface->FrameInterface->Release(m_pSurface);
+    }
+
+private:
+    mfxFrameSurface1* m_pSurface;
+
+    DecodedSurfaceGuard(const DecodedSurfaceGuard&);
+    void operator=(const DecodedSurfaceGuard&);
+};
+#endif
+
+} // namespace
+
+CEncodeQualityMeter::CEncodeQualityMeter()
+        : m_bInitialized(false),
+          m_bDecoderInitialized(false),
+          m_session(),
+          m_pDecoder(),
+          m_decParams(),
+          m_bitstream(),
+          m_metrics(),
+          m_pending(),
+          m_maxPending(0),
+          m_references(),
+          m_freeFrames(),
+          m_numUnmatched(0),
+          m_statTime() {}
+
+CEncodeQualityMeter::~CEncodeQualityMeter() {
+    Close();
+}
+
+mfxStatus CEncodeQualityMeter::Init(VPLImplementationLoader* pLoader,
+                                    MFXVideoSession* pParentSession,
+                                    const mfxVideoParam& encParams,
+                                    mfxU32 metrics,
+                                    mfxU32 numThreads) {
+    MSDK_CHECK_POINTER(pLoader, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(pParentSession, MFX_ERR_NULL_PTR);
+
+    Close();
+
+#if (MFX_VERSION >= 2000)
+    mfxStatus sts = m_metrics.Init(encParams.mfx.FrameInfo, metrics, numThreads);
+    if (MFX_ERR_UNSUPPORTED == sts) {
+        msdk_printf(MSDK_STRING("error: quality metrics support NV12, I420, YV12 and P010 only\n"));
+        return sts;
+    }
+    MSDK_CHECK_STATUS(sts, "m_metrics.Init failed");
+
+    sts = m_session.CreateSession(pLoader);
+    MSDK_CHECK_STATUS(sts, "m_session.CreateSession failed");
+
+    // share the device with the encoder session, if any
+    static const mfxHandleType handleTypes[] = { MFX_HANDLE_VA_DISPLAY,
+                                                 MFX_HANDLE_D3D11_DEVICE,
+                                                 MFX_HANDLE_D3D9_DEVICE_MANAGER };
+    for (mfxHandleType type : handleTypes) {
+        mfxHDL hdl = NULL;
+        if (MFX_ERR_NONE == pParentSession->GetHandle(type, &hdl) && hdl) {
+            sts = m_session.SetHandle(type, hdl);
+            MSDK_CHECK_STATUS(sts, "m_session.SetHandle failed");
+            break;
+        }
+    }
+
+    m_pDecoder.reset(new MFXVideoDECODE(m_session));
+
+    m_decParams             = {};
+    m_decParams.mfx.CodecId = encParams.mfx.CodecId;
+    m_bitstream.Extend(1024 * 1024);
+    m_bitstream.DataOffset = 0;
+    m_bitstream.DataLength = 0;
+    // the meter is given whole coded frames
+    m_bitstream.DataFlag = MFX_BITSTREAM_COMPLETE_FRAME;
+
+    // frames in flight of the encoder are kept locked, the pools of the pipeline
+    // are sized for them
+    m_maxPending = std::max<size_t>(encParams.AsyncDepth, 1);
+
+    m_bInitialized = true;
+    return MFX_ERR_NONE;
+#else
+    (void)encParams;
+    (void)metrics;
+    (void)numThreads;
+    msdk_printf(MSDK_STRING("error: quality metrics require API 2.0 or newer\n"));
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+void CEncodeQualityMeter::Close() {
+    if (m_pDecoder) {
+        std::ignore = m_pDecoder->Close();
+        m_pDecoder.reset();
+    }
+    if (m_bInitialized)
+        std::ignore = m_session.Close();
+
+    DropPendingReferences();
+    m_references.clear();
+    m_freeFrames.clear();
+    m_metrics.Close();
+
+    m_bInitialized        = false;
+    m_bDecoderInitialized = false;
+    m_numUnmatched        = 0;
+}
+
+mfxStatus CEncodeQualityMeter::CopyFrame(const mfxFrameSurface1& src, Frame& dst) {
+    const mfxFrameInfo& info = src.Info;
+    const mfxFrameData& data = src.Data;
+    MSDK_CHECK_POINTER(data.Y, MFX_ERR_LOCK_MEMORY);
+
+    mfxU32 bytesPerSample = (info.FourCC == MFX_FOURCC_P010) ? 2 : 1;
+    mfxU32 w              = info.CropW ? info.CropW : info.Width;
+    mfxU32 h              = info.CropH ? info.CropH : info.Height;
+    mfxU32 srcPitch       = ((mfxU32)data.PitchHigh << 16) + data.PitchLow;
+    mfxU32 pitch          = w * bytesPerSample;
+    mfxU32 cropX          = info.CropX & ~1;
+    mfxU32 cropY          = info.CropY & ~1;
+
+    // crop rectangle only, pitch is the width
+    dst.data.resize(pitch * h + pitch * (h / 2));
+    mfxU8* ptr = &dst.data[0];
+
+    dst.surface                = {};
+    dst.surface.Info           = info;
+    dst.surface.Info.Width     = (mfxU16)w;
+    dst.surface.Info.Height    = (mfxU16)h;
+    dst.surface.Info.CropX     = 0;
+    dst.surface.Info.CropY     = 0;
+    dst.surface.Info.CropW     = (mfxU16)w;
+    dst.surface.Info.CropH     = (mfxU16)h;
+    dst.surface.Data.PitchHigh = (mfxU16)(pitch >> 16);
+    dst.surface.Data.PitchLow  = (mfxU16)(pitch & 0xffff);
+    dst.surface.Data.Y         = ptr;
+
+    CopyPlane(data.Y + cropY * srcPitch + cropX * bytesPerSample,
+              srcPitch,
+              ptr,
+              pitch,
+              w * bytesPerSample,
+              h);
+    ptr += pitch * h;
+
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_P010:
+            MSDK_CHECK_POINTER(data.UV, MFX_ERR_LOCK_MEMORY);
+            dst.surface.Data.UV = ptr;
+            CopyPlane(data.UV + (cropY / 2) * srcPitch + cropX * bytesPerSample,
+                      srcPitch,
+                      ptr,
+                      pitch,
+                      w * bytesPerSample,
+                      h / 2);
+            break;
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+            MSDK_CHECK_POINTER(data.U, MFX_ERR_LOCK_MEMORY);
+            MSDK_CHECK_POINTER(data.V, MFX_ERR_LOCK_MEMORY);
+            dst.surface.Data.U = ptr;
+            dst.surface.Data.V = ptr + (pitch / 2) * (h / 2);
+            CopyPlane(data.U + (cropY / 2) * (srcPitch / 2) + cropX / 2,
+                      srcPitch / 2,
+                      dst.surface.Data.U,
+                      pitch / 2,
+                      w / 2,
+                      h / 2);
+            CopyPlane(data.V + (cropY / 2) * (srcPitch / 2) + cropX / 2,
+                      srcPitch / 2,
+                      dst.surface.Data.V,
+                      pitch / 2,
+                      w / 2,
+                      h / 2);
+            break;
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CEncodeQualityMeter::AddReference(mfxFrameSurface1* pSurface,
+                                            mfxFrameAllocator* pAllocator,
+                                            MFXVideoSession* pSession,
+                                            mfxSyncPoint syncp) {
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    TimeMeasurementGuard timeGuard(m_statTime);
+
+    // same as the references the pipelines take on the surfaces they pass on
+    msdk_atomic_inc16((volatile mfxU16*)&pSurface->Data.Locked);
+#if (MFX_VERSION >= 2000)
+    if (pSurface->FrameInterface)
+        std::ignore = pSurface->FrameInterface->AddRef(pSurface);
+#endif
+    m_pending.push_back({ pSurface, pAllocator, pSession, syncp });
+
+    size_t numWait = m_pending.size() > m_maxPending ? m_pending.size() - m_maxPending : 0;
+    return ResolveReferences(numWait);
+}
+
+mfxStatus CEncodeQualityMeter::ResolveReferences(size_t numWait) {
+    while (!m_pending.empty()) {
+        PendingReference& ref = m_pending.front();
+        if (ref.pSession && ref.syncp) {
+            mfxU32 waitMs = numWait ? MSDK_WAIT_INTERVAL : 0;
+            mfxStatus sts = ref.pSession->SyncOperation(ref.syncp, waitMs);
+            if (MFX_WRN_IN_EXECUTION == sts && !numWait)
+                break;
+            MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
+        }
+
+        mfxStatus sts = CopyReference(ref);
+        ReleaseReference(ref);
+        m_pending.pop_front();
+        MSDK_CHECK_STATUS(sts, "CopyReference failed");
+
+        if (numWait)
+            numWait--;
+    }
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CEncodeQualityMeter::CopyReference(const PendingReference& ref) {
+    std::unique_ptr<Frame> frame;
+    if (m_freeFrames.empty()) {
+        frame.reset(new Frame);
+    }
+    else {
+        frame = std::move(m_freeFrames.back());
+        m_freeFrames.pop_back();
+    }
+
+    mfxFrameSurface1* pSurface   = ref.pSurface;
+    mfxFrameAllocator* pAllocator = ref.pAllocator;
+    mfxStatus sts                 = MFX_ERR_NONE;
+    if (pSurface->Data.Y) {
+        sts = CopyFrame(*pSurface, *frame);
+    }
+#if (MFX_VERSION >= 2000)
+    else if (pSurface->FrameInterface) {
+        sts = pSurface->FrameInterface->Map(pSurface, MFX_MAP_READ);
+        MSDK_CHECK_STATUS(sts, "FrameInterface->Map failed");
+        sts                = CopyFrame(*pSurface, *frame);
+        mfxStatus stsUnmap = pSurface->FrameInterface->Unmap(pSurface);
+        MSDK_CHECK_STATUS(stsUnmap, "FrameInterface->Unmap failed");
+    }
+#endif
+    else if (pAllocator && pSurface->Data.MemId) {
+        sts = pAllocator->Lock(pAllocator->pthis, pSurface->Data.MemId, &pSurface->Data);
+        MSDK_CHECK_STATUS(sts, "pAllocator->Lock failed");
+        sts = CopyFrame(*pSurface, *frame);
+        mfxStatus stsUnlock =
+            pAllocator->Unlock(pAllocator->pthis, pSurface->Data.MemId, &pSurface->Data);
+        MSDK_CHECK_STATUS(stsUnlock, "pAllocator->Unlock failed");
+    }
+    else {
+        sts = MFX_ERR_LOCK_MEMORY;
+    }
+    MSDK_CHECK_STATUS(sts, "CopyFrame failed");
+
+    m_references.push_back(std::move(frame));
+    return MFX_ERR_NONE;
+}
+
+void CEncodeQualityMeter::DropPendingReferences() {
+    for (PendingReference& ref : m_pending)
+        ReleaseReference(ref);
+    m_pending.clear();
+}
+
+void CEncodeQualityMeter::ReleaseReference(PendingReference& ref) {
+    msdk_atomic_dec16((volatile mfxU16*)&ref.pSurface->Data.Locked);
+#if (MFX_VERSION >= 2000)
+    if (ref.pSurface->FrameInterface)
+        std::ignore = ref.pSurface->FrameInterface->Release(ref.pSurface);
+#endif
+    ref.pSurface = NULL;
+}
+
+mfxStatus CEncodeQualityMeter::ProcessBitstream(const mfxBitstream& bs) {
+    if (!m_bInitialized)
+        return MFX_ERR_NOT_INITIALIZED;
+    if (!bs.DataLength)
+        return MFX_ERR_NONE;
+
+    TimeMeasurementGuard timeGuard(m_statTime);
+
+    // inputs of the coded frame are completed by now
+    mfxStatus sts = ResolveReferences(0);
+    MSDK_CHECK_STATUS(sts, "ResolveReferences failed");
+
+    // keep the data not consumed by the decoder yet
+    if (m_bitstream.DataOffset) {
+        memmove(m_bitstream.Data,
+                m_bitstream.Data + m_bitstream.DataOffset,
+                m_bitstream.DataLength);
+        m_bitstream.DataOffset = 0;
+    }
+    m_bitstream.Extend(m_bitstream.DataLength + bs.DataLength);
+    MSDK_MEMCPY(m_bitstream.Data + m_bitstream.DataLength,
+                bs.Data + bs.DataOffset,
+                bs.DataLength);
+    m_bitstream.DataLength += bs.DataLength;
+
+#if (MFX_VERSION >= 2000)
+    if (!m_bDecoderInitialized) {
+        sts = m_pDecoder->DecodeHeader(&m_bitstream, &m_decParams);
+        if (MFX_ERR_MORE_DATA == sts)
+            return MFX_ERR_NONE;
+        MSDK_CHECK_STATUS(sts, "m_pDecoder->DecodeHeader failed");
+
+        // decoder allocates system memory surfaces by itself
+        m_decParams.IOPattern  = MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+        m_decParams.AsyncDepth = 1;
+        sts                    = m_pDecoder->Init(&m_decParams);
+        MSDK_IGNORE_MFX_STS(sts, MFX_WRN_PARTIAL_ACCELERATION);
+        MSDK_CHECK_STATUS(sts, "m_pDecoder->Init failed");
+        m_bDecoderInitialized = true;
+    }
+
+    sts = DecodeFrames(&m_bitstream);
+#endif
+
+    return sts;
+}
+
+mfxStatus CEncodeQualityMeter::Flush() {
+    if (!m_bInitialized)
+        return MFX_ERR_NONE;
+
+    TimeMeasurementGuard timeGuard(m_statTime);
+
+    mfxStatus sts = ResolveReferences(m_pending.size());
+    MSDK_CHECK_STATUS(sts, "ResolveReferences failed");
+
+    if (!m_bDecoderInitialized)
+        return MFX_ERR_NONE;
+
+    return DecodeFrames(NULL);
+}
+
+mfxStatus CEncodeQualityMeter::DecodeFrames(mfxBitstream* pBS) {
+#if (MFX_VERSION >= 2000)
+    for (;;) {
+        mfxFrameSurface1* pOut = NULL;
+        mfxSyncPoint syncp     = NULL;
+
+        mfxStatus sts = m_pDecoder->DecodeFrameAsync(pBS, NULL, &pOut, &syncp);
+        if (MFX_WRN_DEVICE_BUSY == sts) {
+            MSDK_SLEEP(1);
+            continue;
+        }
+        if (MFX_ERR_MORE_DATA == sts)
+            return MFX_ERR_NONE;
+        if (MFX_ERR_NONE < sts && !syncp)
+            continue;
+        MSDK_CHECK_STATUS(sts, "m_pDecoder->DecodeFrameAsync failed");
+
+        if (syncp && pOut) {
+            sts = CompareFrame(pOut);
+            MSDK_CHECK_STATUS(sts, "CompareFrame failed");
+        }
+    }
+#else
+    (void)pBS;
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+mfxStatus CEncodeQualityMeter::CompareFrame(mfxFrameSurface1* pDecoded) {
+#if (MFX_VERSION >= 2000)
+    DecodedSurfaceGuard surfaceGuard(pDecoded);
+
+    mfxStatus sts = pDecoded->FrameInterface->Synchronize(pDecoded, MSDK_WAIT_INTERVAL);
+    MSDK_CHECK_STATUS(sts, "FrameInterface->Synchronize failed");
+
+    // the input of the decoded frame may be still queued
+    if (m_references.empty() && !m_pending.empty()) {
+        sts = ResolveReferences(1);
+        MSDK_CHECK_STATUS(sts, "ResolveReferences failed");
+    }
+
+    if (m_references.empty()) {
+        m_numUnmatched++;
+    }
+    else {
+        sts = pDecoded->FrameInterface->Map(pDecoded, MFX_MAP_READ);
+        MSDK_CHECK_STATUS(sts, "FrameInterface->Map failed");
+
+        sts = m_metrics.Compare(&m_references.front()->surface, pDecoded);
+
+        mfxStatus stsUnmap = pDecoded->FrameInterface->Unmap(pDecoded);
+        MSDK_CHECK_STATUS(sts, "m_metrics.Compare failed");
+        MSDK_CHECK_STATUS(stsUnmap, "FrameInterface->Unmap failed");
+
+        m_freeFrames.push_back(std::move(m_references.front()));
+        m_references.pop_front();
+    }
+
+    return MFX_ERR_NONE;
+#else
+    (void)pDecoded;
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+void CEncodeQualityMeter::PrintStatistics(const msdk_char* prefix, FILE* pFile) const {
+    m_metrics.PrintStatistics(prefix, pFile);
+    size_t numNotDecoded = m_references.size() + m_pending.size();
+    if (m_numUnmatched || numNotDecoded) {
+        msdk_fprintf(pFile,
+                     MSDK_STRING("%s warning: %u decoded frames without input, %u input frames ")
+                         MSDK_STRING("not decoded\n"),
+                     prefix,
+                     (unsigned int)m_numUnmatched,
+                     (unsigned int)numNotDecoded);
+    }
+}
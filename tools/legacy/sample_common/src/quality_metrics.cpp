@@ -0,0 +1,1032 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "frame_kernels.h"
+#include "quality_metrics.h"
+#include "sample_defs.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define QUALITY_METRICS_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #define QUALITY_METRICS_TARGET(isa)
+    #else
+        #define QUALITY_METRICS_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#endif
+
+enum { JOB_SSD = 0, JOB_SSIM, JOB_MSSSIM };
+
+// Capped PSNR value of identical frames
+static const mfxF64 MAX_PSNR = 100.0;
+
+// Weights of MS-SSIM scales from the original paper
+static const mfxF64 MSSSIM_WEIGHTS[] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+// Sums of a 4x4 block: sum(a), sum(b), sum(a*a) + sum(b*b), sum(a*b)
+typedef mfxI32 BlockSums[4];
+
+// Row kernels. Samples are 8-bit or 16-bit with at most 12 significant bits.
+struct MetricsKernels {
+    // sum of squared differences of 'w' samples
+    mfxU64 (*Ssd8)(const mfxU8* a, const mfxU8* b, mfxU32 w);
+    mfxU64 (*Ssd16)(const mfxU16* a, const mfxU16* b, mfxU32 w);
+    // sums of 'blocks' horizontally adjacent 4x4 blocks
+    void (*BlockSums8)(const mfxU8* a,
+                       mfxU32 pitchA,
+                       const mfxU8* b,
+                       mfxU32 pitchB,
+                       mfxU32 blocks,
+                       BlockSums* sums);
+    void (*BlockSums16)(const mfxU8* a,
+                        mfxU32 pitchA,
+                        const mfxU8* b,
+                        mfxU32 pitchB,
+                        mfxU32 blocks,
+                        BlockSums* sums);
+};
+
+// Scalar kernels, also used for the tails of the vector kernels
+
+static mfxU64 Ssd8_C(const mfxU8* a, const mfxU8* b, mfxU32 w) {
+    mfxU64 ssd = 0;
+    for (mfxU32 i = 0; i < w; i++) {
+        mfxI32 d = (mfxI32)a[i] - b[i];
+        ssd += (mfxU32)(d * d);
+    }
+    return ssd;
+}
+
+static mfxU64 Ssd16_C(const mfxU16* a, const mfxU16* b, mfxU32 w) {
+    mfxU64 ssd = 0;
+    for (mfxU32 i = 0; i < w; i++) {
+        mfxI32 d = (mfxI32)a[i] - b[i];
+        ssd += (mfxU32)(d * d);
+    }
+    return ssd;
+}
+
+template <typename T>
+static void BlockSums_C(const mfxU8* a,
+                        mfxU32 pitchA,
+                        const mfxU8* b,
+                        mfxU32 pitchB,
+                        mfxU32 blocks,
+                        BlockSums* sums) {
+    for (mfxU32 i = 0; i < blocks; i++) {
+        mfxI32 s1 = 0, s2 = 0, ss = 0, s12 = 0;
+        for (mfxU32 y = 0; y < 4; y++) {
+            const T* x0 = (const T*)(a + y * pitchA) + 4 * i;
+            const T* y0 = (const T*)(b + y * pitchB) + 4 * i;
+            for (mfxU32 x = 0; x < 4; x++) {
+                s1 += x0[x];
+                s2 += y0[x];
+                ss += x0[x] * x0[x] + y0[x] * y0[x];
+                s12 += x0[x] * y0[x];
+            }
+        }
+        sums[i][0] = s1;
+        sums[i][1] = s2;
+        sums[i][2] = ss;
+        sums[i][3] = s12;
+    }
+}
+
+#ifdef QUALITY_METRICS_X86
+
+// SSE2 kernels
+
+QUALITY_METRICS_TARGET("sse2")
+static mfxU64 ReduceAdd64_SSE2(__m128i v) {
+    v = _mm_add_epi64(v, _mm_unpackhi_epi64(v, v));
+    #if defined(__x86_64__) || defined(_M_X64)
+    return (mfxU64)_mm_cvtsi128_si64(v);
+    #else
+    mfxU64 r;
+    _mm_storel_epi64((__m128i*)&r, v);
+    return r;
+    #endif
+}
+
+QUALITY_METRICS_TARGET("sse2")
+static __m128i Widen32_SSE2(__m128i v) {
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_add_epi64(_mm_unpacklo_epi32(v, zero), _mm_unpackhi_epi32(v, zero));
+}
+
+QUALITY_METRICS_TARGET("sse2")
+static mfxU64 Ssd8_SSE2(const mfxU8* a, const mfxU8* b, mfxU32 w) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc        = zero;
+    mfxU32 i           = 0;
+    // 32-bit lanes are flushed to 64-bit accumulator every 1024 samples
+    while (i + 16 <= w) {
+        __m128i acc32 = zero;
+        for (mfxU32 n = 0; n < 64 && i + 16 <= w; n++, i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i d0 =
+                _mm_sub_epi16(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero));
+            __m128i d1 =
+                _mm_sub_epi16(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero));
+            acc32 = _mm_add_epi32(acc32, _mm_madd_epi16(d0, d0));
+            acc32 = _mm_add_epi32(acc32, _mm_madd_epi16(d1, d1));
+        }
+        acc = _mm_add_epi64(acc, Widen32_SSE2(acc32));
+    }
+    return ReduceAdd64_SSE2(acc) + Ssd8_C(a + i, b + i, w - i);
+}
+
+QUALITY_METRICS_TARGET("sse2")
+static mfxU64 Ssd16_SSE2(const mfxU16* a, const mfxU16* b, mfxU32 w) {
+    __m128i acc = _mm_setzero_si128();
+    mfxU32 i    = 0;
+    for (; i + 8 <= w; i += 8) {
+        __m128i d = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(a + i)),
+                                  _mm_loadu_si128((const __m128i*)(b + i)));
+        acc       = _mm_add_epi64(acc, Widen32_SSE2(_mm_madd_epi16(d, d)));
+    }
+    return ReduceAdd64_SSE2(acc) + Ssd16_C(a + i, b + i, w - i);
+}
+
+// s1 and s2 hold 16-bit sums of columns, ss and s12 32-bit sums of column pairs
+// of 2 adjacent blocks. Reduces them to sums of the blocks.
+QUALITY_METRICS_TARGET("sse2")
+static void StoreBlockSums2_SSE2(__m128i s1, __m128i s2, __m128i ss, __m128i s12, BlockSums* sums) {
+    const __m128i ones = _mm_set1_epi16(1);
+    s1                 = _mm_madd_epi16(s1, ones);
+    s2                 = _mm_madd_epi16(s2, ones);
+
+    __m128i t0 = _mm_unpacklo_epi32(s1, s2);
+    __m128i t1 = _mm_unpackhi_epi32(s1, s2);
+    __m128i p  = _mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1));
+    t0         = _mm_unpacklo_epi32(ss, s12);
+    t1         = _mm_unpackhi_epi32(ss, s12);
+    __m128i q  = _mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1));
+
+    _mm_storeu_si128((__m128i*)sums[0], _mm_unpacklo_epi64(p, q));
+    _mm_storeu_si128((__m128i*)sums[1], _mm_unpackhi_epi64(p, q));
+}
+
+QUALITY_METRICS_TARGET("sse2")
+static void BlockSums8_SSE2(const mfxU8* a,
+                            mfxU32 pitchA,
+                            const mfxU8* b,
+                            mfxU32 pitchB,
+                            mfxU32 blocks,
+                            BlockSums* sums) {
+    const __m128i zero = _mm_setzero_si128();
+    mfxU32 i           = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m128i s1[2] = { zero, zero }, s2[2] = { zero, zero };
+        __m128i ss[2] = { zero, zero }, s12[2] = { zero, zero };
+        for (mfxU32 y = 0; y < 4; y++) {
+            __m128i x  = _mm_loadu_si128((const __m128i*)(a + y * pitchA + 4 * i));
+            __m128i z  = _mm_loadu_si128((const __m128i*)(b + y * pitchB + 4 * i));
+            __m128i xs[2] = { _mm_unpacklo_epi8(x, zero), _mm_unpackhi_epi8(x, zero) };
+            __m128i zs[2] = { _mm_unpacklo_epi8(z, zero), _mm_unpackhi_epi8(z, zero) };
+            for (mfxU32 k = 0; k < 2; k++) {
+                s1[k] = _mm_add_epi16(s1[k], xs[k]);
+                s2[k] = _mm_add_epi16(s2[k], zs[k]);
+                ss[k] = _mm_add_epi32(
+                    ss[k],
+                    _mm_add_epi32(_mm_madd_epi16(xs[k], xs[k]), _mm_madd_epi16(zs[k], zs[k])));
+                s12[k] = _mm_add_epi32(s12[k], _mm_madd_epi16(xs[k], zs[k]));
+            }
+        }
+        StoreBlockSums2_SSE2(s1[0], s2[0], ss[0], s12[0], sums + i);
+        StoreBlockSums2_SSE2(s1[1], s2[1], ss[1], s12[1], sums + i + 2);
+    }
+    BlockSums_C<mfxU8>(a + 4 * i, pitchA, b + 4 * i, pitchB, blocks - i, sums + i);
+}
+
+QUALITY_METRICS_TARGET("sse2")
+static void BlockSums16_SSE2(const mfxU8* a,
+                             mfxU32 pitchA,
+                             const mfxU8* b,
+                             mfxU32 pitchB,
+                             mfxU32 blocks,
+                             BlockSums* sums) {
+    const __m128i zero = _mm_setzero_si128();
+    mfxU32 i           = 0;
+    for (; i + 2 <= blocks; i += 2) {
+        __m128i s1 = zero, s2 = zero, ss = zero, s12 = zero;
+        for (mfxU32 y = 0; y < 4; y++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + y * pitchA + 8 * i));
+            __m128i z = _mm_loadu_si128((const __m128i*)(b + y * pitchB + 8 * i));
+            s1        = _mm_add_epi16(s1, x);
+            s2        = _mm_add_epi16(s2, z);
+            ss  = _mm_add_epi32(ss, _mm_add_epi32(_mm_madd_epi16(x, x), _mm_madd_epi16(z, z)));
+            s12 = _mm_add_epi32(s12, _mm_madd_epi16(x, z));
+        }
+        StoreBlockSums2_SSE2(s1, s2, ss, s12, sums + i);
+    }
+    BlockSums_C<mfxU16>(a + 8 * i, pitchA, b + 8 * i, pitchB, blocks - i, sums + i);
+}
+
+// AVX2 kernels
+
+QUALITY_METRICS_TARGET("avx2")
+static __m128i Fold64_AVX2(__m256i v) {
+    return _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+QUALITY_METRICS_TARGET("avx2")
+static mfxU64 Ssd8_AVX2(const mfxU8* a, const mfxU8* b, mfxU32 w) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc        = zero;
+    mfxU32 i           = 0;
+    while (i + 32 <= w) {
+        __m256i acc32 = zero;
+        for (mfxU32 n = 0; n < 32 && i + 32 <= w; n++, i += 32) {
+            __m256i d0 =
+                _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i))),
+                                 _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i))));
+            __m256i d1 = _mm256_sub_epi16(
+                _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + i + 16))),
+                _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + i + 16))));
+            acc32 = _mm256_add_epi32(acc32, _mm256_madd_epi16(d0, d0));
+            acc32 = _mm256_add_epi32(acc32, _mm256_madd_epi16(d1, d1));
+        }
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(acc32, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(acc32, zero));
+    }
+    return ReduceAdd64_SSE2(Fold64_AVX2(acc)) + Ssd8_SSE2(a + i, b + i, w - i);
+}
+
+QUALITY_METRICS_TARGET("avx2")
+static mfxU64 Ssd16_AVX2(const mfxU16* a, const mfxU16* b, mfxU32 w) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc        = zero;
+    mfxU32 i           = 0;
+    for (; i + 16 <= w; i += 16) {
+        __m256i d  = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                     _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i sq = _mm256_madd_epi16(d, d);
+        acc        = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc        = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+    }
+    return ReduceAdd64_SSE2(Fold64_AVX2(acc)) + Ssd16_SSE2(a + i, b + i, w - i);
+}
+
+// Same as StoreBlockSums2_SSE2 for 4 adjacent blocks, each 128-bit lane holds 2 blocks
+QUALITY_METRICS_TARGET("avx2")
+static void StoreBlockSums4_AVX2(__m256i s1, __m256i s2, __m256i ss, __m256i s12, BlockSums* sums) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    s1                 = _mm256_madd_epi16(s1, ones);
+    s2                 = _mm256_madd_epi16(s2, ones);
+
+    __m256i t0 = _mm256_unpacklo_epi32(s1, s2);
+    __m256i t1 = _mm256_unpackhi_epi32(s1, s2);
+    __m256i p = _mm256_add_epi32(_mm256_unpacklo_epi64(t0, t1), _mm256_unpackhi_epi64(t0, t1));
+    t0        = _mm256_unpacklo_epi32(ss, s12);
+    t1        = _mm256_unpackhi_epi32(ss, s12);
+    __m256i q = _mm256_add_epi32(_mm256_unpacklo_epi64(t0, t1), _mm256_unpackhi_epi64(t0, t1));
+
+    __m256i lo = _mm256_unpacklo_epi64(p, q); // blocks 0 and 2
+    __m256i hi = _mm256_unpackhi_epi64(p, q); // blocks 1 and 3
+    _mm_storeu_si128((__m128i*)sums[0], _mm256_castsi256_si128(lo));
+    _mm_storeu_si128((__m128i*)sums[1], _mm256_castsi256_si128(hi));
+    _mm_storeu_si128((__m128i*)sums[2], _mm256_extracti128_si256(lo, 1));
+    _mm_storeu_si128((__m128i*)sums[3], _mm256_extracti128_si256(hi, 1));
+}
+
+QUALITY_METRICS_TARGET("avx2")
+static void BlockSums4_AVX2(__m256i (&x)[4], __m256i (&z)[4], BlockSums* sums) {
+    __m256i s1  = _mm256_add_epi16(_mm256_add_epi16(x[0], x[1]), _mm256_add_epi16(x[2], x[3]));
+    __m256i s2  = _mm256_add_epi16(_mm256_add_epi16(z[0], z[1]), _mm256_add_epi16(z[2], z[3]));
+    __m256i ss  = _mm256_setzero_si256();
+    __m256i s12 = _mm256_setzero_si256();
+    for (mfxU32 y = 0; y < 4; y++) {
+        ss  = _mm256_add_epi32(ss, _mm256_madd_epi16(x[y], x[y]));
+        ss  = _mm256_add_epi32(ss, _mm256_madd_epi16(z[y], z[y]));
+        s12 = _mm256_add_epi32(s12, _mm256_madd_epi16(x[y], z[y]));
+    }
+    StoreBlockSums4_AVX2(s1, s2, ss, s12, sums);
+}
+
+QUALITY_METRICS_TARGET("avx2")
+static void BlockSums8_AVX2(const mfxU8* a,
+                            mfxU32 pitchA,
+                            const mfxU8* b,
+                            mfxU32 pitchB,
+                            mfxU32 blocks,
+                            BlockSums* sums) {
+    mfxU32 i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m256i x[4], z[4];
+        for (mfxU32 y = 0; y < 4; y++) {
+            x[y] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + y * pitchA + 4 * i)));
+            z[y] = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(b + y * pitchB + 4 * i)));
+        }
+        BlockSums4_AVX2(x, z, sums + i);
+    }
+    BlockSums_C<mfxU8>(a + 4 * i, pitchA, b + 4 * i, pitchB, blocks - i, sums + i);
+}
+
+QUALITY_METRICS_TARGET("avx2")
+static void BlockSums16_AVX2(const mfxU8* a,
+                             mfxU32 pitchA,
+                             const mfxU8* b,
+                             mfxU32 pitchB,
+                             mfxU32 blocks,
+                             BlockSums* sums) {
+    mfxU32 i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m256i x[4], z[4];
+        for (mfxU32 y = 0; y < 4; y++) {
+            x[y] = _mm256_loadu_si256((const __m256i*)(a + y * pitchA + 8 * i));
+            z[y] = _mm256_loadu_si256((const __m256i*)(b + y * pitchB + 8 * i));
+        }
+        BlockSums4_AVX2(x, z, sums + i);
+    }
+    BlockSums16_SSE2(a + 8 * i, pitchA, b + 8 * i, pitchB, blocks - i, sums + i);
+}
+
+#endif // QUALITY_METRICS_X86
+
+static const MetricsKernels& GetMetricsKernels() {
+    static const MetricsKernels scalar = { Ssd8_C, Ssd16_C, BlockSums_C<mfxU8>, BlockSums_C<mfxU16> };
+#ifdef QUALITY_METRICS_X86
+    static const MetricsKernels sse2 = { Ssd8_SSE2, Ssd16_SSE2, BlockSums8_SSE2, BlockSums16_SSE2 };
+    static const MetricsKernels avx2 = { Ssd8_AVX2, Ssd16_AVX2, BlockSums8_AVX2, BlockSums16_AVX2 };
+
+    // Follow the instruction set of the frame kernels, so SAMPLE_FRAME_KERNELS caps both
+    switch (GetFrameKernels().isa) {
+        case FRAME_KERNELS_AVX512:
+        case FRAME_KERNELS_AVX2:
+            return avx2;
+        case FRAME_KERNELS_SSE2:
+            return sse2;
+        default:
+            break;
+    }
+#endif
+    return scalar;
+}
+
+// Accumulates SSIM and its contrast-structure term over rows [first, last) of
+// 8x8 windows with step 4. Plane has to be at least 8x8.
+static void SsimRows(const mfxU8* a,
+                     mfxU32 pitchA,
+                     const mfxU8* b,
+                     mfxU32 pitchB,
+                     mfxU32 width,
+                     mfxU32 bytesPerSample,
+                     mfxF64 maxValue,
+                     mfxU32 first,
+                     mfxU32 last,
+                     mfxF64& ssim,
+                     mfxF64& cs) {
+    const MetricsKernels& kernels = GetMetricsKernels();
+    auto blockSums = (bytesPerSample == 1) ? kernels.BlockSums8 : kernels.BlockSums16;
+
+    const mfxF64 N  = 64;
+    const mfxF64 c1 = (0.01 * maxValue) * (0.01 * maxValue) * N * N;
+    const mfxF64 c2 = (0.03 * maxValue) * (0.03 * maxValue);
+
+    mfxU32 blocks = width / 4;
+    std::vector<BlockSums> rows(2 * blocks);
+    BlockSums* prev = &rows[0];
+    BlockSums* curr = &rows[blocks];
+
+    blockSums(a + 4 * first * pitchA, pitchA, b + 4 * first * pitchB, pitchB, blocks, prev);
+    for (mfxU32 y = first; y < last; y++) {
+        blockSums(a + 4 * (y + 1) * pitchA,
+                  pitchA,
+                  b + 4 * (y + 1) * pitchB,
+                  pitchB,
+                  blocks,
+                  curr);
+        for (mfxU32 x = 0; x + 1 < blocks; x++) {
+            mfxF64 s[4];
+            for (mfxU32 k = 0; k < 4; k++)
+                s[k] = (mfxF64)prev[x][k] + prev[x + 1][k] + curr[x][k] + curr[x + 1][k];
+
+            // variances and covariance are unbiased estimates
+            mfxF64 vars  = (s[2] * N - s[0] * s[0] - s[1] * s[1]) / (N * (N - 1));
+            mfxF64 covar = (s[3] * N - s[0] * s[1]) / (N * (N - 1));
+            mfxF64 l     = (2 * s[0] * s[1] + c1) / (s[0] * s[0] + s[1] * s[1] + c1);
+            mfxF64 c     = (2 * covar + c2) / (vars + c2);
+            ssim += l * c;
+            cs += c;
+        }
+        std::swap(prev, curr);
+    }
+}
+
+// Number of windows in SSIM of the plane
+static mfxF64 SsimWindows(mfxU32 width, mfxU32 height) {
+    return (mfxF64)(width / 4 - 1) * (height / 4 - 1);
+}
+
+// 2x2 average, dst is floor(w/2) x floor(h/2)
+static void Downsample(const mfxU8* src,
+                       mfxU32 pitch,
+                       mfxU32 bytesPerSample,
+                       mfxU16* dst,
+                       mfxU32 w,
+                       mfxU32 h) {
+    for (mfxU32 y = 0; y < h; y++, dst += w) {
+        const mfxU8* r0 = src + 2 * y * pitch;
+        const mfxU8* r1 = r0 + pitch;
+        if (bytesPerSample == 1) {
+            for (mfxU32 x = 0; x < w; x++)
+                dst[x] = (mfxU16)((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+        }
+        else {
+            const mfxU16* p0 = (const mfxU16*)r0;
+            const mfxU16* p1 = (const mfxU16*)r1;
+            for (mfxU32 x = 0; x < w; x++)
+                dst[x] = (mfxU16)((p0[2 * x] + p0[2 * x + 1] + p1[2 * x] + p1[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+static mfxF64 Psnr(mfxU64 ssd, mfxF64 samples, mfxF64 maxValue) {
+    if (!ssd)
+        return MAX_PSNR;
+    return std::min(MAX_PSNR, 10.0 * log10(maxValue * maxValue * samples / (mfxF64)ssd));
+}
+
+mfxU32 ParseQualityMetrics(const msdk_char* strMetrics) {
+    if (!strMetrics)
+        return 0;
+
+    msdk_tstring list(strMetrics);
+    mfxU32 metrics = 0;
+    size_t pos     = 0;
+    for (;;) {
+        size_t end         = list.find(MSDK_CHAR(','), pos);
+        msdk_tstring token = list.substr(pos, end == msdk_tstring::npos ? end : end - pos);
+
+        if (token == MSDK_STRING("psnr"))
+            metrics |= QUALITY_METRIC_PSNR;
+        else if (token == MSDK_STRING("ssim"))
+            metrics |= QUALITY_METRIC_SSIM;
+        else if (token == MSDK_STRING("msssim"))
+            metrics |= QUALITY_METRIC_MSSSIM;
+        else if (token == MSDK_STRING("all"))
+            metrics |= QUALITY_METRIC_ALL;
+        else
+            return 0;
+
+        if (end == msdk_tstring::npos)
+            break;
+        pos = end + 1;
+    }
+    return metrics;
+}
+
+CQualityMetrics::CQualityMetrics()
+        : m_metrics(0),
+          m_fourCC(0),
+          m_width(),
+          m_height(),
+          m_bytesPerSample(1),
+          m_shift(0),
+          m_maxValue(255),
+          m_planes(),
+          m_scratch(),
+          m_scales(),
+          m_numScales(0),
+          m_scaleWeights(),
+          m_jobs(),
+          m_queue(),
+          m_results(),
+          m_workers(),
+          m_mutex(),
+          m_cvStart(),
+          m_cvDone(),
+          m_nextJob(0),
+          m_pendingJobs(0),
+          m_activeWorkers(0),
+          m_generation(0),
+          m_bStop(false),
+          m_numFrames(0),
+          m_totalSsd(),
+          m_sum(),
+          m_min() {}
+
+CQualityMetrics::~CQualityMetrics() {
+    Close();
+}
+
+mfxStatus CQualityMetrics::Init(const mfxFrameInfo& info, mfxU32 metrics, mfxU32 numThreads) {
+    Close();
+
+    if (!metrics || (metrics & ~(mfxU32)QUALITY_METRIC_ALL))
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    mfxU32 width  = info.CropW ? info.CropW : info.Width;
+    mfxU32 height = info.CropH ? info.CropH : info.Height;
+    mfxU32 depth  = info.BitDepthLuma;
+
+    switch (info.FourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+            if (depth && depth != 8)
+                return MFX_ERR_UNSUPPORTED;
+            depth            = 8;
+            m_bytesPerSample = 1;
+            break;
+        case MFX_FOURCC_P010:
+            if (!depth)
+                depth = 10;
+            if (depth > 12)
+                return MFX_ERR_UNSUPPORTED;
+            m_bytesPerSample = 2;
+            break;
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    // SSIM needs at least 8x8 chroma planes
+    if ((metrics & (QUALITY_METRIC_SSIM | QUALITY_METRIC_MSSSIM)) && (width < 16 || height < 16))
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    m_metrics  = metrics;
+    m_fourCC   = info.FourCC;
+    m_shift    = 16 - depth;
+    m_maxValue = (mfxF64)((1 << depth) - 1);
+
+    m_width[0]  = width;
+    m_height[0] = height;
+    m_width[1] = m_width[2] = width / 2;
+    m_height[1] = m_height[2] = height / 2;
+
+    if (metrics & QUALITY_METRIC_MSSSIM) {
+        // scales are used while there is at least one SSIM window
+        mfxU32 size = 0;
+        m_numScales = 1;
+        while (m_numScales < MAX_MSSSIM_SCALES && (width >> m_numScales) >= 8 &&
+               (height >> m_numScales) >= 8) {
+            size += (width >> m_numScales) * (height >> m_numScales);
+            m_numScales++;
+        }
+
+        mfxF64 total = 0;
+        for (mfxU32 i = 0; i < m_numScales; i++)
+            total += MSSSIM_WEIGHTS[i];
+        for (mfxU32 i = 0; i < m_numScales; i++)
+            m_scaleWeights[i] = MSSSIM_WEIGHTS[i] / total;
+
+        m_scales[0].resize(size);
+        m_scales[1].resize(size);
+    }
+
+    if (!numThreads)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    // caller's thread executes jobs too
+    for (mfxU32 i = 1; i < numThreads; i++)
+        m_workers.push_back(std::thread(&CQualityMetrics::WorkerRoutine, this));
+
+    ResetStatistics();
+    return MFX_ERR_NONE;
+}
+
+void CQualityMetrics::Close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cvStart.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+    m_workers.clear();
+    m_bStop = false;
+
+    for (mfxU32 i = 0; i < 2; i++) {
+        for (mfxU32 p = 0; p < NUM_PLANES; p++)
+            std::vector<mfxU8>().swap(m_scratch[i][p]);
+        std::vector<mfxU16>().swap(m_scales[i]);
+    }
+    m_metrics   = 0;
+    m_numScales = 0;
+}
+
+void CQualityMetrics::ResetStatistics() {
+    m_numFrames = 0;
+    for (mfxU32 p = 0; p < NUM_PLANES; p++)
+        m_totalSsd[p] = 0;
+
+    QualityMetricsValues zero = {};
+    m_sum                     = zero;
+    m_min.psnrYUV = m_min.ssimYUV = m_min.msssim = 1E100;
+    for (mfxU32 p = 0; p < NUM_PLANES; p++)
+        m_min.psnr[p] = m_min.ssim[p] = 1E100;
+}
+
+mfxStatus CQualityMetrics::MapPlanes(const mfxFrameSurface1* pSurface, mfxU32 slot) {
+    const mfxFrameData& data = pSurface->Data;
+    MSDK_CHECK_POINTER(data.Y, MFX_ERR_LOCK_MEMORY);
+
+    if (pSurface->Info.FourCC != m_fourCC)
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+    if ((mfxU32)pSurface->Info.Width < pSurface->Info.CropX + m_width[0] ||
+        (mfxU32)pSurface->Info.Height < pSurface->Info.CropY + m_height[0])
+        return MFX_ERR_INVALID_VIDEO_PARAM;
+
+    const FrameKernels& kernels = GetFrameKernels();
+    Plane* planes               = m_planes[slot];
+    std::vector<mfxU8>* scratch = m_scratch[slot];
+
+    mfxU32 pitch = ((mfxU32)data.PitchHigh << 16) + data.PitchLow;
+    mfxU32 cropX = pSurface->Info.CropX;
+    mfxU32 cropY = pSurface->Info.CropY;
+    mfxU32 cw    = m_width[1];
+    mfxU32 ch    = m_height[1];
+
+    planes[0].ptr   = data.Y + cropY * pitch + cropX * m_bytesPerSample;
+    planes[0].pitch = pitch;
+
+    switch (m_fourCC) {
+        case MFX_FOURCC_NV12: {
+            MSDK_CHECK_POINTER(data.UV, MFX_ERR_LOCK_MEMORY);
+            const mfxU8* uv = data.UV + (cropY / 2) * pitch + (cropX & ~1);
+            scratch[1].resize(cw * ch);
+            scratch[2].resize(cw * ch);
+            for (mfxU32 y = 0; y < ch; y++)
+                kernels.DeinterleaveUV(uv + y * pitch,
+                                       &scratch[1][y * cw],
+                                       &scratch[2][y * cw],
+                                       cw);
+            for (mfxU32 p = 1; p < NUM_PLANES; p++) {
+                planes[p].ptr   = &scratch[p][0];
+                planes[p].pitch = cw;
+            }
+            break;
+        }
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+            MSDK_CHECK_POINTER(data.U, MFX_ERR_LOCK_MEMORY);
+            MSDK_CHECK_POINTER(data.V, MFX_ERR_LOCK_MEMORY);
+            planes[1].ptr   = data.U + (cropY / 2) * (pitch / 2) + cropX / 2;
+            planes[2].ptr   = data.V + (cropY / 2) * (pitch / 2) + cropX / 2;
+            planes[1].pitch = planes[2].pitch = pitch / 2;
+            break;
+        case MFX_FOURCC_P010: {
+            MSDK_CHECK_POINTER(data.UV, MFX_ERR_LOCK_MEMORY);
+            // samples are MSB aligned if Shift is set
+            mfxU32 shift = pSurface->Info.Shift ? m_shift : 0;
+            if (shift) {
+                scratch[0].resize(2 * m_width[0] * m_height[0]);
+                mfxU16* dst = (mfxU16*)&scratch[0][0];
+                for (mfxU32 y = 0; y < m_height[0]; y++)
+                    kernels.ShiftRight16((const mfxU16*)(planes[0].ptr + y * pitch),
+                                         dst + y * m_width[0],
+                                         m_width[0],
+                                         shift);
+                planes[0].ptr   = &scratch[0][0];
+                planes[0].pitch = 2 * m_width[0];
+            }
+
+            const mfxU8* uv = data.UV + (cropY / 2) * pitch + 2 * (cropX & ~1);
+            scratch[1].resize(2 * cw * ch);
+            scratch[2].resize(2 * cw * ch);
+            mfxU16* u = (mfxU16*)&scratch[1][0];
+            mfxU16* v = (mfxU16*)&scratch[2][0];
+            for (mfxU32 y = 0; y < ch; y++) {
+                const mfxU16* src = (const mfxU16*)(uv + y * pitch);
+                for (mfxU32 x = 0; x < cw; x++) {
+                    u[y * cw + x] = (mfxU16)(src[2 * x] >> shift);
+                    v[y * cw + x] = (mfxU16)(src[2 * x + 1] >> shift);
+                }
+            }
+            for (mfxU32 p = 1; p < NUM_PLANES; p++) {
+                planes[p].ptr   = &scratch[p][0];
+                planes[p].pitch = 2 * cw;
+            }
+            break;
+        }
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+void CQualityMetrics::AddJobs(mfxU32 type, mfxU32 plane, mfxU32 rows) {
+    // a few bands per thread to balance the load, but not too short ones
+    mfxU32 bands   = std::max(1u, std::min(rows / 4, 4 * (mfxU32)(m_workers.size() + 1)));
+    mfxU32 perBand = (rows + bands - 1) / bands;
+    for (mfxU32 first = 0; first < rows; first += perBand) {
+        Job job = { type, plane, first, std::min(rows, first + perBand) };
+        m_queue.push_back(job);
+    }
+}
+
+mfxStatus CQualityMetrics::Compare(const mfxFrameSurface1* pRef,
+                                   const mfxFrameSurface1* pDist,
+                                   QualityMetricsValues* pValues) {
+    MSDK_CHECK_POINTER(pRef, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(pDist, MFX_ERR_NULL_PTR);
+    if (!m_metrics)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    mfxStatus sts = MapPlanes(pRef, 0);
+    MSDK_CHECK_STATUS(sts, "MapPlanes failed");
+    sts = MapPlanes(pDist, 1);
+    MSDK_CHECK_STATUS(sts, "MapPlanes failed");
+
+    bool bSsim = !!(m_metrics & QUALITY_METRIC_SSIM);
+
+    m_queue.clear();
+    for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+        if (m_metrics & QUALITY_METRIC_PSNR)
+            AddJobs(JOB_SSD, p, m_height[p]);
+        // luma SSIM is the first scale of MS-SSIM
+        if (bSsim || (p == 0 && (m_metrics & QUALITY_METRIC_MSSSIM)))
+            AddJobs(JOB_SSIM, p, m_height[p] / 4 - 1);
+    }
+    if ((m_metrics & QUALITY_METRIC_MSSSIM) && m_numScales > 1) {
+        Job job = { JOB_MSSSIM, 0, 0, 0 };
+        m_queue.push_back(job);
+    }
+
+    RunJobs();
+
+    mfxU64 ssd[NUM_PLANES]   = {};
+    mfxF64 ssim[NUM_PLANES]  = {};
+    mfxF64 cs                = 0;
+    mfxF64 msssimOtherScales = 1;
+    for (size_t i = 0; i < m_jobs.size(); i++) {
+        const Job& job          = m_jobs[i];
+        const JobResult& result = m_results[i];
+        if (job.type == JOB_SSD) {
+            ssd[job.plane] += result.ssd;
+        }
+        else if (job.type == JOB_SSIM) {
+            ssim[job.plane] += result.ssim;
+            if (job.plane == 0)
+                cs += result.cs;
+        }
+        else {
+            msssimOtherScales = result.ssim;
+        }
+    }
+
+    QualityMetricsValues values = {};
+    mfxF64 samples[NUM_PLANES];
+    mfxF64 totalSamples = 0;
+    for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+        samples[p] = (mfxF64)m_width[p] * m_height[p];
+        totalSamples += samples[p];
+    }
+
+    if (m_metrics & QUALITY_METRIC_PSNR) {
+        for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+            values.psnr[p] = Psnr(ssd[p], samples[p], m_maxValue);
+            m_totalSsd[p] += ssd[p];
+        }
+        values.psnrYUV = Psnr(ssd[0] + ssd[1] + ssd[2], totalSamples, m_maxValue);
+    }
+    if (bSsim) {
+        for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+            values.ssim[p] = ssim[p] / SsimWindows(m_width[p], m_height[p]);
+            values.ssimYUV += values.ssim[p] * samples[p] / totalSamples;
+        }
+    }
+    if (m_metrics & QUALITY_METRIC_MSSSIM) {
+        mfxF64 windows = SsimWindows(m_width[0], m_height[0]);
+        if (m_numScales > 1)
+            values.msssim =
+                pow(std::max(0.0, cs / windows), m_scaleWeights[0]) * msssimOtherScales;
+        else
+            values.msssim = ssim[0] / windows;
+    }
+
+    m_numFrames++;
+    for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+        m_sum.psnr[p] += values.psnr[p];
+        m_sum.ssim[p] += values.ssim[p];
+        m_min.psnr[p] = std::min(m_min.psnr[p], values.psnr[p]);
+        m_min.ssim[p] = std::min(m_min.ssim[p], values.ssim[p]);
+    }
+    m_sum.psnrYUV += values.psnrYUV;
+    m_sum.ssimYUV += values.ssimYUV;
+    m_sum.msssim += values.msssim;
+    m_min.psnrYUV = std::min(m_min.psnrYUV, values.psnrYUV);
+    m_min.ssimYUV = std::min(m_min.ssimYUV, values.ssimYUV);
+    m_min.msssim  = std::min(m_min.msssim, values.msssim);
+
+    if (pValues)
+        *pValues = values;
+
+    return MFX_ERR_NONE;
+}
+
+void CQualityMetrics::ExecuteJob(const Job& job, JobResult& result) {
+    const MetricsKernels& kernels = GetMetricsKernels();
+    const Plane& a                = m_planes[0][job.plane];
+    const Plane& b                = m_planes[1][job.plane];
+    mfxU32 width                  = m_width[job.plane];
+
+    result.ssd  = 0;
+    result.ssim = 0;
+    result.cs   = 0;
+
+    switch (job.type) {
+        case JOB_SSD:
+            for (mfxU32 y = job.first; y < job.last; y++) {
+                const mfxU8* rowA = a.ptr + y * a.pitch;
+                const mfxU8* rowB = b.ptr + y * b.pitch;
+                result.ssd += (m_bytesPerSample == 1)
+                                  ? kernels.Ssd8(rowA, rowB, width)
+                                  : kernels.Ssd16((const mfxU16*)rowA, (const mfxU16*)rowB, width);
+            }
+            break;
+        case JOB_SSIM:
+            SsimRows(a.ptr,
+                     a.pitch,
+                     b.ptr,
+                     b.pitch,
+                     width,
+                     m_bytesPerSample,
+                     m_maxValue,
+                     job.first,
+                     job.last,
+                     result.ssim,
+                     result.cs);
+            break;
+        case JOB_MSSSIM: {
+            // scales after the first one, the product of their weighted terms
+            const mfxU8* srcA = a.ptr;
+            const mfxU8* srcB = b.ptr;
+            mfxU32 pitchA = a.pitch, pitchB = b.pitch;
+            mfxU32 bytesPerSample = m_bytesPerSample;
+            mfxU16* dstA          = &m_scales[0][0];
+            mfxU16* dstB          = &m_scales[1][0];
+
+            result.ssim = 1;
+            for (mfxU32 s = 1; s < m_numScales; s++) {
+                mfxU32 w = m_width[0] >> s;
+                mfxU32 h = m_height[0] >> s;
+                Downsample(srcA, pitchA, bytesPerSample, dstA, w, h);
+                Downsample(srcB, pitchB, bytesPerSample, dstB, w, h);
+
+                mfxF64 ssim = 0, cs = 0;
+                SsimRows((const mfxU8*)dstA,
+                         2 * w,
+                         (const mfxU8*)dstB,
+                         2 * w,
+                         w,
+                         2,
+                         m_maxValue,
+                         0,
+                         h / 4 - 1,
+                         ssim,
+                         cs);
+                mfxF64 term = (s + 1 < m_numScales) ? cs : ssim;
+                term /= SsimWindows(w, h);
+                result.ssim *= pow(std::max(0.0, term), m_scaleWeights[s]);
+
+                srcA   = (const mfxU8*)dstA;
+                srcB   = (const mfxU8*)dstB;
+                pitchA = pitchB = 2 * w;
+                bytesPerSample  = 2;
+                dstA += w * h;
+                dstB += w * h;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void CQualityMetrics::RunJobs() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // workers still leaving the previous round may read the job list
+        m_cvDone.wait(lock, [this] {
+            return m_activeWorkers == 0;
+        });
+        m_jobs.swap(m_queue);
+        m_results.resize(m_jobs.size());
+        m_pendingJobs = (mfxU32)m_jobs.size();
+        m_nextJob     = 0;
+        m_generation++;
+    }
+    m_cvStart.notify_all();
+
+    ExecuteJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cvDone.wait(lock, [this] {
+        return m_pendingJobs == 0;
+    });
+}
+
+void CQualityMetrics::ExecuteJobs() {
+    for (;;) {
+        mfxU32 i = m_nextJob++;
+        if (i >= m_jobs.size())
+            break;
+
+        ExecuteJob(m_jobs[i], m_results[i]);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_pendingJobs == 0)
+            m_cvDone.notify_all();
+    }
+}
+
+void CQualityMetrics::WorkerRoutine() {
+    mfxU64 generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvStart.wait(lock, [this, generation] {
+                return m_bStop || m_generation != generation;
+            });
+            if (m_bStop)
+                return;
+            generation = m_generation;
+            m_activeWorkers++;
+        }
+
+        ExecuteJobs();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_activeWorkers == 0)
+            m_cvDone.notify_all();
+    }
+}
+
+void CQualityMetrics::GetAverage(QualityMetricsValues& values, mfxF64* pGlobalPsnrYUV) const {
+    QualityMetricsValues avg = {};
+    if (m_numFrames) {
+        for (mfxU32 p = 0; p < NUM_PLANES; p++) {
+            avg.psnr[p] = m_sum.psnr[p] / m_numFrames;
+            avg.ssim[p] = m_sum.ssim[p] / m_numFrames;
+        }
+        avg.psnrYUV = m_sum.psnrYUV / m_numFrames;
+        avg.ssimYUV = m_sum.ssimYUV / m_numFrames;
+        avg.msssim  = m_sum.msssim / m_numFrames;
+    }
+    values = avg;
+
+    if (pGlobalPsnrYUV) {
+        mfxF64 samples = 0;
+        for (mfxU32 p = 0; p < NUM_PLANES; p++)
+            samples += (mfxF64)m_width[p] * m_height[p];
+        *pGlobalPsnrYUV = Psnr(m_totalSsd[0] + m_totalSsd[1] + m_totalSsd[2],
+                               samples * m_numFrames,
+                               m_maxValue);
+    }
+}
+
+void CQualityMetrics::PrintStatistics(const msdk_char* prefix, FILE* pFile) const {
+    if (!m_numFrames)
+        return;
+
+    QualityMetricsValues avg;
+    mfxF64 globalPsnr = 0;
+    GetAverage(avg, &globalPsnr);
+
+    if (m_metrics & QUALITY_METRIC_PSNR) {
+        msdk_fprintf(pFile,
+                     MSDK_STRING("%s PSNR (%u frames) Y:%.3lf U:%.3lf V:%.3lf YUV:%.3lf, ")
+                         MSDK_STRING("Min YUV:%.3lf, Global YUV:%.3lf\n"),
+                     prefix,
+                     (unsigned int)m_numFrames,
+                     avg.psnr[0],
+                     avg.psnr[1],
+                     avg.psnr[2],
+                     avg.psnrYUV,
+                     m_min.psnrYUV,
+                     globalPsnr);
+    }
+    if (m_metrics & QUALITY_METRIC_SSIM) {
+        msdk_fprintf(pFile,
+                     MSDK_STRING("%s SSIM (%u frames) Y:%.5lf U:%.5lf V:%.5lf YUV:%.5lf, ")
+                         MSDK_STRING("Min YUV:%.5lf\n"),
+                     prefix,
+                     (unsigned int)m_numFrames,
+                     avg.ssim[0],
+                     avg.ssim[1],
+                     avg.ssim[2],
+                     avg.ssimYUV,
+                     m_min.ssimYUV);
+    }
+    if (m_metrics & QUALITY_METRIC_MSSSIM) {
+        msdk_fprintf(pFile,
+                     MSDK_STRING("%s MS-SSIM (%u frames, %u scales) Y:%.5lf, Min Y:%.5lf\n"),
+                     prefix,
+                     (unsigned int)m_numFrames,
+                     (unsigned int)m_numScales,
+                     avg.msssim,
+                     m_min.msssim);
+    }
+}
@@ -0,0 +1,148 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "raw_file_mapping.h"
+#include "raw_frame_layout.h"
+#include "sample_defs.h"
+
+CRawFileMapping::CRawFileMapping()
+        :
+#if defined(_WIN32) || defined(_WIN64)
+          m_hFile(INVALID_HANDLE_VALUE),
+          m_hMapping(NULL),
+#endif
+          m_pData(NULL),
+          m_size(0) {
+}
+
+CRawFileMapping::~CRawFileMapping() {
+    Close();
+}
+
+mfxStatus CRawFileMapping::Open(const msdk_char* strFileName) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+
+    Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+    m_hFile = CreateFile(strFileName,
+                         GENERIC_READ,
+                         FILE_SHARE_READ,
+                         NULL,
+                         OPEN_EXISTING,
+                         FILE_FLAG_SEQUENTIAL_SCAN,
+                         NULL);
+    MSDK_CHECK_ERROR(m_hFile, INVALID_HANDLE_VALUE, MFX_ERR_NULL_PTR);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_hFile, &size) || !size.QuadPart) {
+        Close();
+        return MFX_ERR_MORE_DATA;
+    }
+
+    m_hMapping = CreateFileMapping(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_hMapping) {
+        Close();
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    m_pData = (mfxU8*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_pData) {
+        Close();
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+    m_size = (mfxU64)size.QuadPart;
+#else
+    int fd = open(strFileName, O_RDONLY);
+    MSDK_CHECK_ERROR(fd, -1, MFX_ERR_NULL_PTR);
+
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size) {
+        close(fd);
+        return MFX_ERR_MORE_DATA;
+    }
+
+    // Read-only mapping is backed by the page cache and isn't charged to the commit
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // Mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED)
+        return MFX_ERR_MEMORY_ALLOC;
+
+    // Frames are accessed mostly in order, let the kernel read ahead aggressively
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m_pData = (mfxU8*)data;
+    m_size  = (mfxU64)st.st_size;
+#endif
+
+    return MFX_ERR_NONE;
+}
+
+void CRawFileMapping::Close() {
+#if defined(_WIN32) || defined(_WIN64)
+    if (m_pData)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping)
+        CloseHandle(m_hMapping);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+    m_hMapping = NULL;
+    m_hFile    = INVALID_HANDLE_VALUE;
+#else
+    if (m_pData)
+        munmap(m_pData, (size_t)m_size);
+#endif
+    m_pData = NULL;
+    m_size  = 0;
+}
+
+mfxU32 CRawFileMapping::GetFrameSize(const mfxFrameInfo& info) {
+    // Surface pitch is the frame width, so crops have to cover the whole surface
+    if (info.CropX || info.CropY || (info.CropW && info.CropW != info.Width) ||
+        (info.CropH && info.CropH != info.Height))
+        return 0;
+
+    RawFrameLayout layout;
+    return GetRawFrameLayout(info.FourCC, info.Width, info.Height, 0, layout) ? layout.size : 0;
+}
+
+mfxU32 CRawFileMapping::GetFrameCount(const mfxFrameInfo& info) const {
+    mfxU32 frameSize = GetFrameSize(info);
+    return frameSize ? (mfxU32)(m_size / frameSize) : 0;
+}
+
+mfxStatus CRawFileMapping::MapFrame(mfxU32 index, const mfxFrameInfo& info, mfxFrameData& data) {
+    MSDK_CHECK_POINTER(m_pData, MFX_ERR_NOT_INITIALIZED);
+
+    mfxU32 frameSize = GetFrameSize(info);
+    if (!frameSize)
+        return MFX_ERR_UNSUPPORTED;
+    if ((mfxU64)(index + 1) * frameSize > m_size)
+        return MFX_ERR_MORE_DATA;
+
+    RawFrameLayout layout;
+    GetRawFrameLayout(info.FourCC, info.Width, info.Height, 0, layout);
+
+    mfxStatus sts = SetRawFramePlanes(layout, m_pData + (mfxU64)index * frameSize, data);
+    MSDK_CHECK_STATUS(sts, "SetRawFramePlanes failed");
+
+    // Surface memory is not owned by an allocator
+    data.MemId = 0;
+
+    return MFX_ERR_NONE;
+}
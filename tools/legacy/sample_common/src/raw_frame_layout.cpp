@@ -0,0 +1,364 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "raw_frame_layout.h"
+
+#include <string.h>
+
+#include "sample_defs.h"
+
+bool GetRawFrameLayout(mfxU32 fourCC,
+                       mfxU32 width,
+                       mfxU32 height,
+                       mfxU32 pitch,
+                       RawFrameLayout& layout) {
+    memset(&layout, 0, sizeof(layout));
+
+    mfxU32 bytesPerSample = 1; // of the first plane
+    mfxU32 chromaRows     = 0; // rows of the second and third planes
+    bool halfPitch        = false; // chroma planes have half of the luma pitch
+    mfxU32 numPlanes      = 1;
+
+    switch (fourCC) {
+        case MFX_FOURCC_NV12:
+            numPlanes  = 2;
+            chromaRows = height / 2;
+            break;
+        case MFX_FOURCC_NV16:
+            numPlanes  = 2;
+            chromaRows = height;
+            break;
+        case MFX_FOURCC_P010:
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_P016:
+#endif
+            bytesPerSample = 2;
+            numPlanes      = 2;
+            chromaRows     = height / 2;
+            break;
+        case MFX_FOURCC_P210:
+            bytesPerSample = 2;
+            numPlanes      = 2;
+            chromaRows     = height;
+            break;
+        case MFX_FOURCC_I420:
+        case MFX_FOURCC_YV12:
+            numPlanes  = 3;
+            chromaRows = height / 2;
+            halfPitch  = true;
+            break;
+#if (MFX_VERSION >= 2000)
+        case MFX_FOURCC_I010:
+            bytesPerSample = 2;
+            numPlanes      = 3;
+            chromaRows     = height / 2;
+            halfPitch      = true;
+            break;
+#endif
+        case MFX_FOURCC_RGBP:
+            numPlanes  = 3;
+            chromaRows = height;
+            break;
+        case MFX_FOURCC_YUY2:
+        case MFX_FOURCC_UYVY:
+#if (MFX_VERSION >= 1028)
+        case MFX_FOURCC_RGB565:
+#endif
+            bytesPerSample = 2;
+            break;
+        case MFX_FOURCC_RGB3:
+            bytesPerSample = 3;
+            break;
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_BGR4:
+        case MFX_FOURCC_A2RGB10:
+        case MFX_FOURCC_AYUV:
+#if (MFX_VERSION >= 1027)
+        case MFX_FOURCC_Y210:
+        case MFX_FOURCC_Y410:
+#endif
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y216:
+#endif
+            bytesPerSample = 4;
+            break;
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y416:
+            bytesPerSample = 8;
+            break;
+#endif
+        default:
+            return false;
+    }
+
+    mfxU32 rowBytes = width * bytesPerSample;
+    if (!pitch)
+        pitch = rowBytes;
+    if (pitch < rowBytes || (halfPitch && (pitch & 1)))
+        return false;
+
+    layout.fourCC    = fourCC;
+    layout.width     = width;
+    layout.height    = height;
+    layout.numPlanes = numPlanes;
+
+    layout.rowBytes[0] = rowBytes;
+    layout.rows[0]     = height;
+    layout.pitch[0]    = pitch;
+    for (mfxU32 i = 1; i < numPlanes; i++) {
+        // interleaved chroma has as many bytes per row as luma
+        layout.rowBytes[i] = halfPitch ? rowBytes / 2 : rowBytes;
+        layout.rows[i]     = chromaRows;
+        layout.pitch[i]    = halfPitch ? pitch / 2 : pitch;
+    }
+
+    for (mfxU32 i = 0; i < numPlanes; i++) {
+        layout.offset[i] = layout.size;
+        layout.size += layout.pitch[i] * layout.rows[i];
+    }
+    return true;
+}
+
+mfxStatus SetRawFramePlanes(const RawFrameLayout& layout, mfxU8* ptr, mfxFrameData& data) {
+    MSDK_CHECK_POINTER(ptr, MFX_ERR_NULL_PTR);
+
+    mfxU8* plane1 = ptr + layout.offset[1];
+    mfxU8* plane2 = ptr + layout.offset[2];
+
+    switch (layout.fourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_NV16:
+            data.Y = ptr;
+            data.U = plane1;
+            data.V = data.U + 1;
+            break;
+        case MFX_FOURCC_P010:
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_P016:
+#endif
+        case MFX_FOURCC_P210:
+            data.Y = ptr;
+            data.U = plane1;
+            data.V = data.U + 2;
+            break;
+        case MFX_FOURCC_I420:
+#if (MFX_VERSION >= 2000)
+        case MFX_FOURCC_I010:
+#endif
+            data.Y = ptr;
+            data.U = plane1;
+            data.V = plane2;
+            break;
+        case MFX_FOURCC_YV12:
+            data.Y = ptr;
+            data.V = plane1;
+            data.U = plane2;
+            break;
+        case MFX_FOURCC_RGBP:
+            data.B = ptr;
+            data.G = plane1;
+            data.R = plane2;
+            break;
+        case MFX_FOURCC_YUY2:
+            data.Y = ptr;
+            data.U = ptr + 1;
+            data.V = ptr + 3;
+            break;
+        case MFX_FOURCC_UYVY:
+            data.U = ptr;
+            data.Y = ptr + 1;
+            data.V = ptr + 2;
+            break;
+#if (MFX_VERSION >= 1028)
+        case MFX_FOURCC_RGB565:
+            data.B = data.G = data.R = ptr;
+            break;
+#endif
+        case MFX_FOURCC_RGB3:
+            data.B = ptr;
+            data.G = ptr + 1;
+            data.R = ptr + 2;
+            break;
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_A2RGB10:
+            data.B = ptr;
+            data.G = ptr + 1;
+            data.R = ptr + 2;
+            data.A = ptr + 3;
+            break;
+        case MFX_FOURCC_BGR4:
+            data.R = ptr;
+            data.G = ptr + 1;
+            data.B = ptr + 2;
+            data.A = ptr + 3;
+            break;
+        case MFX_FOURCC_AYUV:
+            data.V = ptr;
+            data.U = ptr + 1;
+            data.Y = ptr + 2;
+            data.A = ptr + 3;
+            break;
+#if (MFX_VERSION >= 1027)
+    #if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y216:
+    #endif
+        case MFX_FOURCC_Y210:
+            data.Y16 = (mfxU16*)ptr;
+            data.U16 = data.Y16 + 1;
+            data.V16 = data.Y16 + 3;
+            break;
+        case MFX_FOURCC_Y410:
+            data.Y = ptr;
+            data.U = data.V = data.A = data.Y;
+            break;
+#endif
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y416:
+            data.U16 = (mfxU16*)ptr;
+            data.Y16 = data.U16 + 1;
+            data.V16 = data.Y16 + 1;
+            data.A   = (mfxU8*)(data.V16 + 1);
+            break;
+#endif
+        default:
+            return MFX_ERR_UNSUPPORTED;
+    }
+
+    data.PitchHigh = (mfxU16)(layout.pitch[0] >> 16);
+    data.PitchLow  = (mfxU16)(layout.pitch[0] & 0xffff);
+
+    return MFX_ERR_NONE;
+}
+
+bool GetRawFramePlanes(const RawFrameLayout& layout,
+                       const mfxFrameData& data,
+                       mfxU8* planes[RawFrameLayout::MAX_PLANES]) {
+    planes[0] = planes[1] = planes[2] = NULL;
+
+    switch (layout.fourCC) {
+        case MFX_FOURCC_NV12:
+        case MFX_FOURCC_NV16:
+        case MFX_FOURCC_P010:
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_P016:
+#endif
+        case MFX_FOURCC_P210:
+            planes[0] = data.Y;
+            planes[1] = data.UV;
+            break;
+        case MFX_FOURCC_I420:
+#if (MFX_VERSION >= 2000)
+        case MFX_FOURCC_I010:
+#endif
+            planes[0] = data.Y;
+            planes[1] = data.U;
+            planes[2] = data.V;
+            break;
+        case MFX_FOURCC_YV12:
+            planes[0] = data.Y;
+            planes[1] = data.V;
+            planes[2] = data.U;
+            break;
+        case MFX_FOURCC_RGBP:
+            planes[0] = data.B;
+            planes[1] = data.G;
+            planes[2] = data.R;
+            break;
+        // packed formats start with the first component in memory
+        case MFX_FOURCC_YUY2:
+#if (MFX_VERSION >= 1027)
+        case MFX_FOURCC_Y410:
+#endif
+            planes[0] = data.Y;
+            break;
+        case MFX_FOURCC_UYVY:
+            planes[0] = data.U;
+            break;
+#if (MFX_VERSION >= 1028)
+        case MFX_FOURCC_RGB565:
+#endif
+        case MFX_FOURCC_RGB3:
+        case MFX_FOURCC_RGB4:
+        case MFX_FOURCC_A2RGB10:
+            planes[0] = data.B;
+            break;
+        case MFX_FOURCC_BGR4:
+            planes[0] = data.R;
+            break;
+        case MFX_FOURCC_AYUV:
+            planes[0] = data.V;
+            break;
+#if (MFX_VERSION >= 1027)
+    #if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y216:
+    #endif
+        case MFX_FOURCC_Y210:
+            planes[0] = (mfxU8*)data.Y16;
+            break;
+#endif
+#if (MFX_VERSION >= 1031)
+        case MFX_FOURCC_Y416:
+            planes[0] = (mfxU8*)data.U16;
+            break;
+#endif
+        default:
+            return false;
+    }
+
+    for (mfxU32 i = 0; i < layout.numPlanes; i++) {
+        if (!planes[i])
+            return false;
+    }
+    return true;
+}
+
+mfxStatus ReadRawFrame(FILE* file,
+                       const RawFrameLayout& src,
+                       const mfxFrameInfo& info,
+                       const mfxFrameData& data) {
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+
+    // layout of the frame data gives the pitches of its planes
+    RawFrameLayout dst;
+    mfxU32 pitch = ((mfxU32)data.PitchHigh << 16) + data.PitchLow;
+    if (!GetRawFrameLayout(info.FourCC, info.Width, info.Height, pitch, dst))
+        return MFX_ERR_UNSUPPORTED;
+
+    mfxU8* planes[RawFrameLayout::MAX_PLANES];
+    if (src.fourCC != dst.fourCC || !GetRawFramePlanes(dst, data, planes))
+        return MFX_ERR_UNSUPPORTED;
+
+    bool sameLayout = true;
+    for (mfxU32 i = 0; i < src.numPlanes; i++) {
+        if (src.rows[i] > dst.rows[i] || src.rowBytes[i] > dst.rowBytes[i])
+            return MFX_ERR_UNSUPPORTED;
+        sameLayout = sameLayout && src.pitch[i] == dst.pitch[i] &&
+                     planes[i] == planes[0] + src.offset[i];
+    }
+
+    if (sameLayout) {
+        return (fread(planes[0], 1, src.size, file) == src.size) ? MFX_ERR_NONE
+                                                                 : MFX_ERR_MORE_DATA;
+    }
+
+    for (mfxU32 i = 0; i < src.numPlanes; i++) {
+        if (src.pitch[i] == dst.pitch[i]) {
+            size_t size = (size_t)src.pitch[i] * src.rows[i];
+            if (fread(planes[i], 1, size, file) != size)
+                return MFX_ERR_MORE_DATA;
+            continue;
+        }
+
+        for (mfxU32 y = 0; y < src.rows[i]; y++) {
+            if (fread(planes[i] + (size_t)y * dst.pitch[i], 1, src.rowBytes[i], file) !=
+                src.rowBytes[i])
+                return MFX_ERR_MORE_DATA;
+        }
+    }
+    return MFX_ERR_NONE;
+}
@@ -7,16 +7,22 @@
 #include "mfx_samples_config.h"
 
 #include <math.h>
+#include <string.h>
 #include <algorithm>
 #include <climits>
 #include <iostream>
 #include <map>
 
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <fcntl.h>
+#endif
+
 #include "vpl/mfxcommon.h"
 #include "vpl/mfxjpeg.h"
 #if (MFX_VERSION < 2000)
     #include "mfxvp8.h"
 #endif
+#include "frame_kernels.h"
 #include "sample_defs.h"
 #include "sample_utils.h"
 #include "time_statistics.h"
@@ -76,6 +82,13 @@ mfxStatus GetFrameLength(mfxU16 width, mfxU16 height, mfxU32 ColorFormat, mfxU32
 CSmplYUVReader::CSmplYUVReader()
         : m_ColorFormat(MFX_FOURCC_YV12),
           m_files(),
+          m_buffer(),
+          m_batches(),
+          m_batchFrames(0),
+          m_bReadInPlace(false),
+          m_fileNames(),
+          m_mappings(),
+          m_mappedFrames(),
           shouldShift10BitsHigh(false),
           m_bInited(false) {}
 
@@ -122,8 +135,13 @@ mfxStatus CSmplYUVReader::Init(std::list<msdk_string> inputs,
         FILE* f = 0;
         MSDK_FOPEN(f, (*it).c_str(), MSDK_STRING("rb"));
         MSDK_CHECK_POINTER(f, MFX_ERR_NULL_PTR);
+#if !defined(_WIN32) && !defined(_WIN64)
+        // frames are read in order, so kernel may read ahead more aggressively
+        posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
         m_files.push_back(f);
+        m_fileNames.push_back(*it);
     }
 
     m_ColorFormat = ColorFormat;
@@ -142,6 +160,10 @@ void CSmplYUVReader::Close() {
         fclose(m_files[i]);
     }
     m_files.clear();
+    m_batches.clear();
+    m_fileNames.clear();
+    m_mappings.clear();
+    m_mappedFrames.clear();
     m_bInited = false;
 }
 
@@ -149,6 +171,50 @@ void CSmplYUVReader::Reset() {
     for (mfxU32 i = 0; i < m_files.size(); i++) {
         fseek(m_files[i], 0, SEEK_SET);
     }
+    for (mfxU32 i = 0; i < m_batches.size(); i++) {
+        m_batches[i].begin = m_batches[i].end = 0;
+    }
+    std::fill(m_mappedFrames.begin(), m_mappedFrames.end(), 0);
+}
+
+bool CSmplYUVReader::CanMapFrames(const mfxFrameInfo& info) {
+    if (!m_bInited)
+        return false;
+
+    mfxU32 vid = info.FrameId.ViewId;
+    if (vid >= m_files.size())
+        return false;
+
+    // File data is used as is, so no color conversion or shift is possible
+    if (info.FourCC != m_ColorFormat || shouldShift10BitsHigh ||
+        !CRawFileMapping::GetFrameSize(info))
+        return false;
+
+    if (m_mappings.size() != m_files.size()) {
+        m_mappings.resize(m_files.size());
+        m_mappedFrames.resize(m_files.size(), 0);
+    }
+    if (!m_mappings[vid]) {
+        std::unique_ptr<CRawFileMapping> mapping(new CRawFileMapping());
+        if (mapping->Open(m_fileNames[vid].c_str()) != MFX_ERR_NONE)
+            return false;
+        m_mappings[vid] = std::move(mapping);
+    }
+    return true;
+}
+
+mfxStatus CSmplYUVReader::MapNextFrame(mfxFrameSurface1* pSurface) {
+    MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
+
+    if (!CanMapFrames(pSurface->Info))
+        return MFX_ERR_UNSUPPORTED;
+
+    mfxU32 vid    = pSurface->Info.FrameId.ViewId;
+    mfxStatus sts = m_mappings[vid]->MapFrame(m_mappedFrames[vid], pSurface->Info, pSurface->Data);
+    if (sts == MFX_ERR_NONE)
+        m_mappedFrames[vid]++;
+    return sts;
 }
 
 mfxStatus CSmplYUVReader::SkipNframesFromBeginning(mfxU16 w,
@@ -156,16 +222,22 @@ mfxStatus CSmplYUVReader::SkipNframesFromBeginning(mfxU16 w,
                                                    mfxU32 viewId,
                                                    mfxU32 nframes) {
     // change file position for read from beginning to "frameLength * nframes".
-    mfxU32 frameLength;
+    RawFrameLayout layout;
 
-    if (MFX_ERR_NONE != GetFrameLength(w, h, m_ColorFormat, frameLength)) {
-        msdk_printf(MSDK_STRING("Input color format %s is unsupported in qpfile mode\n"),
+    if (!GetRawFrameLayout(m_ColorFormat, w, h, 0, layout)) {
+        msdk_printf(MSDK_STRING("Input color format %s is unsupported for frame skipping\n"),
                     ColorFormatToStr(m_ColorFormat));
         return MFX_ERR_UNSUPPORTED;
     }
 
-    if (0 != fseek(m_files[viewId], frameLength * nframes, SEEK_SET))
+    // offset of a frame deep in a large file doesn't fit 32 bits
+    if (0 != MSDK_FSEEK64(m_files[viewId], (mfxU64)layout.size * nframes, SEEK_SET))
         return MFX_ERR_MORE_DATA;
+    // data read ahead doesn't follow the new position
+    if (viewId < m_batches.size())
+        m_batches[viewId].begin = m_batches[viewId].end = 0;
+    if (viewId < m_mappedFrames.size())
+        m_mappedFrames[viewId] = nframes;
 
     return MFX_ERR_NONE;
 }
@@ -224,13 +296,115 @@ mfxStatus CSmplYUVReader::LoadNextFrame2(mfxFrameSurface1* pSurface,
     return MFX_ERR_NONE;
 }
 
+mfxStatus CSmplYUVReader::ReadFrameInPlace(mfxU32 vid,
+                                           mfxU32 w,
+                                           mfxU32 h,
+                                           mfxFrameSurface1* pSurface) {
+    const mfxFrameInfo& info = pSurface->Info;
+    if (info.FourCC != m_ColorFormat || shouldShift10BitsHigh || info.CropX || info.CropY)
+        return MFX_ERR_UNSUPPORTED;
+
+    // file keeps frames of the crop size without padding
+    RawFrameLayout layout;
+    if (!GetRawFrameLayout(m_ColorFormat, w, h, 0, layout))
+        return MFX_ERR_UNSUPPORTED;
+
+    return ReadRawFrame(m_files[vid], layout, info, pSurface->Data);
+}
+
+void CSmplYUVReader::InitReadBatch(mfxU32 vid, mfxU32 w, mfxU32 h) {
+    if (m_batches.size() != m_files.size()) {
+        m_batches.resize(m_files.size());
+        for (mfxU32 i = 0; i < m_batches.size(); i++) {
+            m_batches[i].begin = m_batches[i].end = 0;
+        }
+    }
+    if (!m_batches[vid].arena.empty())
+        return;
+
+    // unknown frame size leaves the view without batching
+    RawFrameLayout layout;
+    if (GetRawFrameLayout(m_ColorFormat, w, h, 0, layout))
+        m_batches[vid].arena.resize((size_t)layout.size * m_batchFrames);
+}
+
+const mfxU8* CSmplYUVReader::ReadData(mfxU32 vid, size_t size) {
+    if (vid >= m_batches.size() || m_batches[vid].arena.empty()) {
+        if (m_buffer.size() < size)
+            m_buffer.resize(size);
+        return (fread(m_buffer.data(), 1, size, m_files[vid]) == size) ? m_buffer.data() : NULL;
+    }
+
+    ReadBatch& batch = m_batches[vid];
+    if (batch.arena.size() < size)
+        batch.arena.resize(size);
+    if (batch.end - batch.begin < size) {
+        // remainder of the previous batch goes first, the rest is refilled with one read
+        size_t tail = batch.end - batch.begin;
+        memmove(batch.arena.data(), batch.arena.data() + batch.begin, tail);
+        batch.begin = 0;
+        batch.end   = tail + fread(batch.arena.data() + tail,
+                                 1,
+                                 batch.arena.size() - tail,
+                                 m_files[vid]);
+        if (batch.end < size)
+            return NULL;
+#if !defined(_WIN32) && !defined(_WIN64)
+        // next batch is read in the background while these frames are processed
+        off_t offset = ftello(m_files[vid]);
+        if (offset >= 0)
+            posix_fadvise(fileno(m_files[vid]),
+                          offset,
+                          (off_t)batch.arena.size(),
+                          POSIX_FADV_WILLNEED);
+#endif
+    }
+
+    const mfxU8* data = batch.arena.data() + batch.begin;
+    batch.begin += size;
+    return data;
+}
+
+mfxStatus CSmplYUVReader::ReadPlane(mfxU32 vid,
+                                    mfxU8* dst,
+                                    mfxU32 pitch,
+                                    mfxU32 rowBytes,
+                                    mfxU32 h,
+                                    mfxU32 shift) {
+    size_t size = (size_t)rowBytes * h;
+
+    // Plane without padding is read as is unless it's already in the batch arena
+    bool batched = vid < m_batches.size() && !m_batches[vid].arena.empty();
+    if (!shift && pitch == rowBytes && !batched) {
+        return (fread(dst, 1, size, m_files[vid]) == size) ? MFX_ERR_NONE : MFX_ERR_MORE_DATA;
+    }
+
+    const mfxU8* src = ReadData(vid, size);
+    if (!src)
+        return MFX_ERR_MORE_DATA;
+
+    if (!shift) {
+        CopyPlane(src, rowBytes, dst, pitch, rowBytes, h);
+    }
+    else {
+        const FrameKernels& kernels = GetFrameKernels();
+        for (mfxU32 i = 0; i < h; i++) {
+            kernels.ShiftLeft16((const mfxU16*)(src + (size_t)i * rowBytes),
+                                (mfxU16*)(dst + (size_t)i * pitch),
+                                rowBytes / 2,
+                                shift);
+        }
+    }
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
     // check if reader is initialized
     MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
     MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
 
-    mfxU32 nBytesRead;
-    mfxU16 w, h, i, pitch;
+    mfxStatus sts = MFX_ERR_NONE;
+    mfxU16 w, h, pitch;
     mfxU8 *ptr, *ptr2;
     mfxFrameInfo& pInfo = pSurface->Info;
     mfxFrameData& pData = pSurface->Data;
@@ -240,7 +414,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
 
     mfxU32 vid = pInfo.FrameId.ViewId;
 
-    if (vid > m_files.size()) {
+    if (vid >= m_files.size()) {
         return MFX_ERR_UNSUPPORTED;
     }
 
@@ -253,6 +427,16 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
         h = pInfo.Height;
     }
 
+    if (m_bReadInPlace && m_batchFrames <= 1) {
+        sts = ReadFrameInPlace(vid, w, h, pSurface);
+        if (MFX_ERR_UNSUPPORTED != sts)
+            return sts;
+        sts = MFX_ERR_NONE;
+    }
+
+    if (m_batchFrames > 1)
+        InitReadBatch(vid, w, h);
+
     mfxU32 nBytesPerPixel = (pInfo.FourCC == MFX_FOURCC_P010 || pInfo.FourCC == MFX_FOURCC_P210
 #if (MFX_VERSION >= 1031)
                              || pInfo.FourCC == MFX_FOURCC_P016
@@ -264,6 +448,14 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                                 ? 2
                                 : 1;
 
+    // MS-aligned P0xx/Y2xx are produced by shifting samples while copying from the staging buffer
+    bool shiftP0xx = shouldShift10BitsHigh &&
+                     (MFX_FOURCC_P010 == pInfo.FourCC || MFX_FOURCC_P210 == pInfo.FourCC
+#if (MFX_VERSION >= 1031)
+                      || MFX_FOURCC_P016 == pInfo.FourCC
+#endif
+                     );
+
     if (MFX_FOURCC_YUY2 == pInfo.FourCC || MFX_FOURCC_UYVY == pInfo.FourCC ||
         MFX_FOURCC_RGB4 == pInfo.FourCC || MFX_FOURCC_BGR4 == pInfo.FourCC ||
         MFX_FOURCC_AYUV == pInfo.FourCC || MFX_FOURCC_A2RGB10 == pInfo.FourCC
@@ -285,13 +477,7 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                 //ptr   = std::min({ pData.R, pData.G, pData.B });
                 ptr = ptr + pInfo.CropX * 4 + pInfo.CropY * pData.Pitch;
 
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, 4 * w, m_files[vid]);
-
-                    if ((mfxU32)4 * w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-                }
+                sts = ReadPlane(vid, ptr, pitch, 4 * w, h);
                 break;
             case MFX_FOURCC_YUY2:
             case MFX_FOURCC_UYVY:
@@ -300,25 +486,13 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                           ? pData.Y + pInfo.CropX * 2 + pInfo.CropY * pData.Pitch
                           : pData.U + pInfo.CropX + pInfo.CropY * pData.Pitch;
 
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 2, w, m_files[vid]);
-
-                    if ((mfxU32)w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-                }
+                sts = ReadPlane(vid, ptr, pitch, 2 * w, h);
                 break;
             case MFX_FOURCC_AYUV:
                 pitch = pData.Pitch;
                 ptr   = pData.V + pInfo.CropX * 4 + pInfo.CropY * pData.Pitch;
 
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 4, w, m_files[vid]);
-
-                    if ((mfxU32)w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-                }
+                sts = ReadPlane(vid, ptr, pitch, 4 * w, h);
                 break;
 
 #if (MFX_VERSION >= 1027)
@@ -327,36 +501,24 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
     #if (MFX_VERSION >= 1031)
             case MFX_FOURCC_Y216:
     #endif
-                pitch = pData.Pitch;
-                ptr   = ((pInfo.FourCC == MFX_FOURCC_Y210
+            {
+                bool isY2xx = (pInfo.FourCC == MFX_FOURCC_Y210
     #if (MFX_VERSION >= 1031)
-                        || pInfo.FourCC == MFX_FOURCC_Y216
+                               || pInfo.FourCC == MFX_FOURCC_Y216
     #endif
-                        )
-                           ? pData.Y
-                           : (mfxU8*)pData.Y410) +
-                      pInfo.CropX * 4 + pInfo.CropY * pData.Pitch;
-
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, 4 * w, m_files[vid]);
-
-                    if ((mfxU32)4 * w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-
-                    if ((MFX_FOURCC_Y210 == pInfo.FourCC
-    #if (MFX_VERSION >= 1031)
-                         || MFX_FOURCC_Y216 == pInfo.FourCC
-    #endif
-                         ) &&
-                        shouldShift10BitsHigh) {
-                        mfxU16* shortPtr = (mfxU16*)(ptr + i * pitch);
-                        for (int idx = 0; idx < w * 2; idx++) {
-                            shortPtr[idx] <<= shiftSizeLuma;
-                        }
-                    }
-                }
+                );
+                pitch = pData.Pitch;
+                ptr   = (isY2xx ? pData.Y : (mfxU8*)pData.Y410) + pInfo.CropX * 4 +
+                      pInfo.CropY * pData.Pitch;
+
+                sts = ReadPlane(vid,
+                                ptr,
+                                pitch,
+                                4 * w,
+                                h,
+                                (isY2xx && shouldShift10BitsHigh) ? shiftSizeLuma : 0);
                 break;
+            }
 #endif
             default:
                 return MFX_ERR_UNSUPPORTED;
@@ -375,26 +537,14 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
         ptr   = pData.Y + pInfo.CropX + pInfo.CropY * pData.Pitch;
 
         // read luminance plane
-        for (i = 0; i < h; i++) {
-            nBytesRead = (mfxU32)fread(ptr + i * pitch, nBytesPerPixel, w, m_files[vid]);
-
-            if (w != nBytesRead) {
-                return MFX_ERR_MORE_DATA;
-            }
-
-            // Shifting data if required
-            if ((MFX_FOURCC_P010 == pInfo.FourCC || MFX_FOURCC_P210 == pInfo.FourCC
-#if (MFX_VERSION >= 1031)
-                 || MFX_FOURCC_P016 == pInfo.FourCC
-#endif
-                 ) &&
-                shouldShift10BitsHigh) {
-                mfxU16* shortPtr = (mfxU16*)(ptr + i * pitch);
-                for (int idx = 0; idx < w; idx++) {
-                    shortPtr[idx] <<= shiftSizeLuma;
-                }
-            }
-        }
+        sts = ReadPlane(vid,
+                        ptr,
+                        pitch,
+                        nBytesPerPixel * w,
+                        h,
+                        shiftP0xx ? shiftSizeLuma : 0);
+        if (sts != MFX_ERR_NONE)
+            return sts;
 
         // read chroma planes
         switch (m_ColorFormat) // color format of data in the input file
@@ -402,50 +552,32 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
             case MFX_FOURCC_I420:
             case MFX_FOURCC_YV12:
                 switch (pInfo.FourCC) {
-                    case MFX_FOURCC_NV12:
-
-                        mfxU8 buf[2048]; // maximum supported chroma width for nv12
-                        mfxU32 j, dstOffset[2];
+                    case MFX_FOURCC_NV12: {
                         w /= 2;
                         h /= 2;
                         ptr = pData.UV + pInfo.CropX + (pInfo.CropY / 2) * pitch;
-                        if (w > 2048) {
-                            return MFX_ERR_UNSUPPORTED;
-                        }
-
-                        if (m_ColorFormat == MFX_FOURCC_I420) {
-                            dstOffset[0] = 0;
-                            dstOffset[1] = 1;
-                        }
-                        else {
-                            dstOffset[0] = 1;
-                            dstOffset[1] = 0;
-                        }
-
-                        // load first chroma plane: U (input == I420) or V (input == YV12)
-                        for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(buf, 1, w, m_files[vid]);
-                            if (w != nBytesRead) {
-                                return MFX_ERR_MORE_DATA;
-                            }
-                            for (j = 0; j < w; j++) {
-                                ptr[i * pitch + j * 2 + dstOffset[0]] = buf[j];
-                            }
-                        }
-
-                        // load second chroma plane: V (input == I420) or U (input == YV12)
-                        for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(buf, 1, w, m_files[vid]);
 
-                            if (w != nBytesRead) {
-                                return MFX_ERR_MORE_DATA;
-                            }
-                            for (j = 0; j < w; j++) {
-                                ptr[i * pitch + j * 2 + dstOffset[1]] = buf[j];
-                            }
+                        // both chroma planes are loaded at once and interleaved row by row
+                        size_t planeSize  = (size_t)w * h;
+                        const mfxU8* data = ReadData(vid, 2 * planeSize);
+                        if (!data)
+                            return MFX_ERR_MORE_DATA;
+
+                        // first plane is U (input == I420) or V (input == YV12)
+                        const mfxU8* u = data;
+                        const mfxU8* v = data + planeSize;
+                        if (m_ColorFormat == MFX_FOURCC_YV12)
+                            std::swap(u, v);
+
+                        const FrameKernels& kernels = GetFrameKernels();
+                        for (mfxU32 i = 0; i < h; i++) {
+                            kernels.InterleaveUV(u + (size_t)i * w,
+                                                 v + (size_t)i * w,
+                                                 ptr + (size_t)i * pitch,
+                                                 w);
                         }
-
                         break;
+                    }
                     case MFX_FOURCC_YV12:
                     case MFX_FOURCC_I420:
                         w /= 2;
@@ -461,20 +593,10 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                             ptr2 = pData.U + (pInfo.CropX / 2) + (pInfo.CropY / 2) * pitch;
                         }
 
-                        for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, w, m_files[vid]);
-
-                            if (w != nBytesRead) {
-                                return MFX_ERR_MORE_DATA;
-                            }
-                        }
-                        for (i = 0; i < h; i++) {
-                            nBytesRead = (mfxU32)fread(ptr2 + i * pitch, 1, w, m_files[vid]);
-
-                            if (w != nBytesRead) {
-                                return MFX_ERR_MORE_DATA;
-                            }
-                        }
+                        sts = ReadPlane(vid, ptr, pitch, w, h);
+                        if (sts != MFX_ERR_NONE)
+                            return sts;
+                        sts = ReadPlane(vid, ptr2, pitch, w, h);
                         break;
                     default:
                         return MFX_ERR_UNSUPPORTED;
@@ -487,20 +609,10 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                 ptr  = pData.U + (pInfo.CropX / 2) + (pInfo.CropY / 2) * pitch;
                 ptr2 = pData.V + (pInfo.CropX / 2) + (pInfo.CropY / 2) * pitch;
 
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, 1, w, m_files[vid]);
-
-                    if (w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-                }
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr2 + i * pitch, 1, w, m_files[vid]);
-
-                    if (w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-                }
+                sts = ReadPlane(vid, ptr, pitch, w, h);
+                if (sts != MFX_ERR_NONE)
+                    return sts;
+                sts = ReadPlane(vid, ptr2, pitch, w, h);
                 break;
             case MFX_FOURCC_NV12:
             case MFX_FOURCC_P010:
@@ -512,27 +624,13 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
                     h /= 2;
                 }
                 ptr = pData.UV + pInfo.CropX + (pInfo.CropY / 2) * pitch;
-                for (i = 0; i < h; i++) {
-                    nBytesRead = (mfxU32)fread(ptr + i * pitch, nBytesPerPixel, w, m_files[vid]);
-
-                    if (w != nBytesRead) {
-                        return MFX_ERR_MORE_DATA;
-                    }
-
-                    // Shifting data if required
-                    if ((MFX_FOURCC_P010 == pInfo.FourCC || MFX_FOURCC_P210 == pInfo.FourCC
-#if (MFX_VERSION >= 1031)
-                         || MFX_FOURCC_P016 == pInfo.FourCC
-#endif
-                         ) &&
-                        shouldShift10BitsHigh) {
-                        mfxU16* shortPtr = (mfxU16*)(ptr + i * pitch);
-                        for (int idx = 0; idx < w; idx++) {
-                            shortPtr[idx] <<= shiftSizeChroma;
-                        }
-                    }
-                }
 
+                sts = ReadPlane(vid,
+                                ptr,
+                                pitch,
+                                nBytesPerPixel * w,
+                                h,
+                                shiftP0xx ? shiftSizeChroma : 0);
                 break;
             default:
                 return MFX_ERR_UNSUPPORTED;
@@ -542,11 +640,13 @@ mfxStatus CSmplYUVReader::LoadNextFrame(mfxFrameSurface1* pSurface) {
         return MFX_ERR_UNSUPPORTED;
     }
 
-    return MFX_ERR_NONE;
+    return sts;
 }
 
-CSmplBitstreamWriter::CSmplBitstreamWriter() : m_sFile() {
+CSmplBitstreamWriter::CSmplBitstreamWriter() : m_pAsyncSink(), m_sFile() {
     m_fSink               = NULL;
+    m_bAsyncWrite         = false;
+    m_bDirectIO           = false;
     m_bInited             = false;
     m_nProcessedFramesNum = 0;
     m_bSkipWriting        = false;
@@ -561,6 +661,10 @@ void CSmplBitstreamWriter::Close() {
         fclose(m_fSink);
         m_fSink = NULL;
     }
+    if (m_pAsyncSink) {
+        m_pAsyncSink->Close();
+        m_pAsyncSink.reset();
+    }
 
     m_bInited = false;
 }
@@ -573,8 +677,15 @@ mfxStatus CSmplBitstreamWriter::Init(const msdk_char* strFileName) {
     Close();
 
     //init file to write encoded data
-    MSDK_FOPEN(m_fSink, strFileName, MSDK_STRING("wb+"));
-    MSDK_CHECK_POINTER(m_fSink, MFX_ERR_NULL_PTR);
+    if (m_bAsyncWrite) {
+        m_pAsyncSink.reset(new CAsyncFileWriter());
+        mfxStatus sts = m_pAsyncSink->Open(strFileName, m_bDirectIO);
+        MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::Open failed");
+    }
+    else {
+        MSDK_FOPEN(m_fSink, strFileName, MSDK_STRING("wb+"));
+        MSDK_CHECK_POINTER(m_fSink, MFX_ERR_NULL_PTR);
+    }
 
     m_sFile = msdk_string(strFileName);
     //set init state to true in case of success
@@ -590,23 +701,26 @@ mfxStatus CSmplBitstreamWriter::Reset() {
     return Init(m_sFile.c_str());
 }
 
+mfxStatus CSmplBitstreamWriter::WriteData(const void* data, size_t size) {
+    if (m_pAsyncSink)
+        return m_pAsyncSink->Write(data, size);
+
+    MSDK_CHECK_POINTER(m_fSink, MFX_ERR_NOT_INITIALIZED);
+    MSDK_CHECK_NOT_EQUAL(fwrite(data, 1, size, m_fSink), size, MFX_ERR_UNDEFINED_BEHAVIOR);
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CSmplBitstreamWriter::WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint) {
     // check if writer is initialized
     MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
     MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
 
     if (pMfxBitstream->DataLength) {
-        mfxU32 nBytesWritten = 0;
-
         // when there's no destfile assigned
         if (m_bSkipWriting == false) {
-            nBytesWritten = (mfxU32)fwrite(pMfxBitstream->Data + pMfxBitstream->DataOffset,
-                                           1,
-                                           pMfxBitstream->DataLength,
-                                           m_fSink);
-            MSDK_CHECK_NOT_EQUAL(nBytesWritten,
-                                 pMfxBitstream->DataLength,
-                                 MFX_ERR_UNDEFINED_BEHAVIOR);
+            mfxStatus sts = WriteData(pMfxBitstream->Data + pMfxBitstream->DataOffset,
+                                      pMfxBitstream->DataLength);
+            MSDK_CHECK_STATUS(sts, "WriteData failed");
         }
         else {
             // mark that we don't need bit stream data any more
@@ -683,10 +797,17 @@ void CSmplBitstreamDuplicateWriter::Close() {
     CSmplBitstreamWriter::Close();
 }
 
-CSmplBitstreamReader::CSmplBitstreamReader() {
-    m_fSource = NULL;
-    m_bInited = false;
-}
+CSmplBitstreamReader::CSmplBitstreamReader()
+        : m_fSource(NULL),
+          m_bInited(false),
+          m_fileName(),
+          m_pIndex(),
+          m_indexFormat(STREAM_INDEX_UNKNOWN),
+          m_bPersistIndex(false),
+          m_firstFrame(0),
+          m_endFrame(0),
+          m_rangeEnd(0),
+          m_bLoop(false) {}
 
 CSmplBitstreamReader::~CSmplBitstreamReader() {
     Close();
@@ -699,12 +820,26 @@ void CSmplBitstreamReader::Close() {
     }
 
     m_bInited = false;
+
+    m_fileName.clear();
+    m_pIndex.reset();
+    m_indexFormat   = STREAM_INDEX_UNKNOWN;
+    m_bPersistIndex = false;
+    m_firstFrame    = 0;
+    m_endFrame      = 0;
+    m_rangeEnd      = 0;
+    m_bLoop         = false;
 }
 
 void CSmplBitstreamReader::Reset() {
     if (!m_bInited)
         return;
 
+    if (HasFrameRange()) {
+        std::ignore = SetPosition(m_pIndex->GetEntry(m_firstFrame), m_firstFrame);
+        return;
+    }
+
     fseek(m_fSource, 0, SEEK_SET);
 }
 
@@ -719,10 +854,112 @@ mfxStatus CSmplBitstreamReader::Init(const msdk_char* strFileName) {
     MSDK_FOPEN(m_fSource, strFileName, MSDK_STRING("rb"));
     MSDK_CHECK_POINTER(m_fSource, MFX_ERR_NULL_PTR);
 
-    m_bInited = true;
+    m_fileName = strFileName;
+    m_bInited  = true;
     return MFX_ERR_NONE;
 }
 
+StreamIndexFormat CSmplBitstreamReader::GetIndexFormat(mfxU32 codecId) const {
+    switch (codecId) {
+        case MFX_CODEC_AVC:
+            return STREAM_INDEX_AVC;
+        case MFX_CODEC_HEVC:
+            return STREAM_INDEX_HEVC;
+        default:
+            return STREAM_INDEX_UNKNOWN;
+    }
+}
+
+mfxStatus CSmplBitstreamReader::InitIndex(mfxU32 codecId, bool bPersist) {
+    if (!m_bInited)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    StreamIndexFormat format = GetIndexFormat(codecId);
+    if (format == STREAM_INDEX_UNKNOWN)
+        return MFX_ERR_UNSUPPORTED;
+
+    if (m_pIndex && m_pIndex->GetFormat() != format)
+        m_pIndex.reset();
+
+    m_indexFormat   = format;
+    m_bPersistIndex = bPersist;
+    return MFX_ERR_NONE;
+}
+
+void CSmplBitstreamReader::SetIndex(std::shared_ptr<const CStreamIndex> pIndex) {
+    m_pIndex = pIndex;
+    if (m_pIndex)
+        m_indexFormat = m_pIndex->GetFormat();
+}
+
+std::shared_ptr<const CStreamIndex> CSmplBitstreamReader::GetIndex() {
+    if (m_pIndex || m_indexFormat == STREAM_INDEX_UNKNOWN || !m_bInited)
+        return m_pIndex;
+
+    std::shared_ptr<CStreamIndex> pIndex = std::make_shared<CStreamIndex>();
+    msdk_tstring indexName               = m_fileName + MSDK_STRING(".idx");
+
+    mfxStatus sts = MFX_ERR_NOT_FOUND;
+    if (m_bPersistIndex)
+        sts = pIndex->Load(indexName.c_str(), m_fileName.c_str(), m_indexFormat);
+
+    if (sts != MFX_ERR_NONE) {
+        sts = pIndex->Build(m_fileName.c_str(), m_indexFormat);
+        if (sts != MFX_ERR_NONE) {
+            msdk_printf(MSDK_STRING("WARNING: failed to index %s\n"), m_fileName.c_str());
+            // Don't try again on every call
+            m_indexFormat = STREAM_INDEX_UNKNOWN;
+            return m_pIndex;
+        }
+        if (m_bPersistIndex && pIndex->Save(indexName.c_str()) != MFX_ERR_NONE)
+            msdk_printf(MSDK_STRING("WARNING: failed to write %s\n"), indexName.c_str());
+    }
+
+    m_pIndex = pIndex;
+    return m_pIndex;
+}
+
+mfxStatus CSmplBitstreamReader::SetPosition(const StreamIndexEntry& entry, mfxU32 /*frame*/) {
+    MSDK_CHECK_NOT_EQUAL(MSDK_FSEEK64(m_fSource, entry.offset, SEEK_SET), 0, MFX_ERR_UNKNOWN);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CSmplBitstreamReader::SeekToFrame(mfxU32 frame) {
+    if (!m_bInited)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    std::shared_ptr<const CStreamIndex> pIndex = GetIndex();
+    if (!pIndex)
+        return MFX_ERR_NOT_INITIALIZED;
+    if (frame >= pIndex->GetFrameCount())
+        return MFX_ERR_MORE_DATA;
+
+    return SetPosition(pIndex->GetEntry(frame), frame);
+}
+
+mfxStatus CSmplBitstreamReader::SetFrameRange(mfxU32 first, mfxU32 count, bool bLoop) {
+    if (!m_bInited)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    std::shared_ptr<const CStreamIndex> pIndex = GetIndex();
+    if (!pIndex)
+        return MFX_ERR_NOT_INITIALIZED;
+
+    mfxU32 frames = pIndex->GetFrameCount();
+    if (first >= frames)
+        return MFX_ERR_MORE_DATA;
+
+    // Decoding has to start from the key frame
+    m_firstFrame = pIndex->FindKeyFrame(first);
+    m_endFrame   = (count && count < frames - m_firstFrame) ? m_firstFrame + count : frames;
+    m_bLoop      = bLoop;
+
+    const StreamIndexEntry& last = pIndex->GetEntry(m_endFrame - 1);
+    m_rangeEnd                   = last.offset + last.size;
+
+    return SetPosition(pIndex->GetEntry(m_firstFrame), m_firstFrame);
+}
+
 #define CHECK_SET_EOS(pBitstream)                  \
     if (feof(m_fSource)) {                         \
         pBitstream->DataFlag |= MFX_BITSTREAM_EOS; \
@@ -738,10 +975,30 @@ mfxStatus CSmplBitstreamReader::ReadNextFrame(mfxBitstream* pBS) {
     if (pBS->MaxLength == pBS->DataLength)
         return MFX_ERR_NOT_ENOUGH_BUFFER;
 
+    mfxU32 nBytesToRead = pBS->MaxLength - pBS->DataLength;
+    if (HasFrameRange()) {
+        mfxI64 position = MSDK_FTELL64(m_fSource);
+        if (position < 0)
+            return MFX_ERR_UNKNOWN;
+
+        if ((mfxU64)position >= m_rangeEnd) {
+            if (!m_bLoop) {
+                pBS->DataFlag |= MFX_BITSTREAM_EOS;
+                return MFX_ERR_MORE_DATA;
+            }
+            // Data of the first frame continues the stream, so state of derived
+            // readers is kept
+            position = (mfxI64)m_pIndex->GetEntry(m_firstFrame).offset;
+            MSDK_CHECK_NOT_EQUAL(MSDK_FSEEK64(m_fSource, position, SEEK_SET),
+                                 0,
+                                 MFX_ERR_UNKNOWN);
+        }
+        nBytesToRead = (mfxU32)(std::min)((mfxU64)nBytesToRead, m_rangeEnd - position);
+    }
+
     memmove(pBS->Data, pBS->Data + pBS->DataOffset, pBS->DataLength);
-    pBS->DataOffset = 0;
-    mfxU32 nBytesRead =
-        (mfxU32)fread(pBS->Data + pBS->DataLength, 1, pBS->MaxLength - pBS->DataLength, m_fSource);
+    pBS->DataOffset   = 0;
+    mfxU32 nBytesRead = (mfxU32)fread(pBS->Data + pBS->DataLength, 1, nBytesToRead, m_fSource);
 
     CHECK_SET_EOS(pBS);
 
@@ -784,7 +1041,7 @@ mfxStatus CJPEGFrameReader::ReadNextFrame(mfxBitstream* pBS) {
     return sts;
 }
 
-CIVFFrameReader::CIVFFrameReader() {
+CIVFFrameReader::CIVFFrameReader() : m_frameIndex(0) {
     MSDK_ZERO_MEMORY(m_hdr);
 }
 
@@ -813,7 +1070,23 @@ mfxStatus CIVFFrameReader::ReadHeader() {
 
 void CIVFFrameReader::Reset() {
     CSmplBitstreamReader::Reset();
-    std::ignore = ReadHeader();
+    if (HasFrameRange())
+        return;
+
+    std::ignore  = ReadHeader();
+    m_frameIndex = 0;
+}
+
+StreamIndexFormat CIVFFrameReader::GetIndexFormat(mfxU32 /*codecId*/) const {
+    return STREAM_INDEX_IVF;
+}
+
+mfxStatus CIVFFrameReader::SetPosition(const StreamIndexEntry& entry, mfxU32 frame) {
+    mfxStatus sts = CSmplBitstreamReader::SetPosition(entry, frame);
+    MSDK_CHECK_STATUS(sts, "CSmplBitstreamReader::SetPosition failed");
+
+    m_frameIndex = frame;
+    return MFX_ERR_NONE;
 }
 
 mfxStatus CIVFFrameReader::Init(const msdk_char* strFileName) {
@@ -822,6 +1095,7 @@ mfxStatus CIVFFrameReader::Init(const msdk_char* strFileName) {
 
     sts = ReadHeader();
     MSDK_CHECK_STATUS(sts, "CIVFFrameReader::ReadHeader failed");
+    m_frameIndex = 0;
 
     // check header
     MSDK_CHECK_NOT_EQUAL(MFX_MAKEFOURCC('D', 'K', 'I', 'F'), m_hdr.dkif, MFX_ERR_UNSUPPORTED);
@@ -842,6 +1116,15 @@ mfxStatus CIVFFrameReader::ReadNextFrame(mfxBitstream* pBS) {
     pBS->DataOffset = 0;
     pBS->DataFlag   = MFX_BITSTREAM_COMPLETE_FRAME;
 
+    if (HasFrameRange() && m_frameIndex >= m_endFrame) {
+        if (!m_bLoop) {
+            pBS->DataFlag |= MFX_BITSTREAM_EOS;
+            return MFX_ERR_MORE_DATA;
+        }
+        mfxStatus sts = SetPosition(m_pIndex->GetEntry(m_firstFrame), m_firstFrame);
+        MSDK_CHECK_STATUS(sts, "SetPosition failed");
+    }
+
     /*bytes pos-(pos+3)                       size of frame in bytes (not including the 12-byte header)
       bytes (pos+4)-(pos+11)                  64-bit presentation timestamp
       bytes (pos+12)-(pos+12+nBytesInFrame)   frame data
@@ -866,6 +1149,7 @@ mfxStatus CIVFFrameReader::ReadNextFrame(mfxBitstream* pBS) {
     READ_BYTES(pBS->Data + pBS->DataOffset + pBS->DataLength, nBytesInFrame);
     CHECK_SET_EOS(pBS);
     pBS->DataLength += nBytesInFrame;
+    m_frameIndex++;
 
     // it is application's responsibility to make sure the bitstream contains a single complete frame and nothing else
     // application has to provide input pBS with pBS->DataLength = 0
@@ -881,16 +1165,14 @@ CIVFFrameWriter::CIVFFrameWriter() {
 }
 
 mfxStatus CIVFFrameWriter::WriteStreamHeader() {
-    mfxU32 nBytesWritten = (mfxU32)fwrite(&m_streamHeader, 1, sizeof(m_streamHeader), m_fSink);
-    if (nBytesWritten != sizeof(m_streamHeader))
+    if (WriteData(&m_streamHeader, sizeof(m_streamHeader)) != MFX_ERR_NONE)
         return MFX_ERR_MORE_BITSTREAM;
 
     return MFX_ERR_NONE;
 }
 
 mfxStatus CIVFFrameWriter::WriteFrameHeader() {
-    mfxU32 nBytesWritten = (mfxU32)fwrite(&m_frameHeader, 1, sizeof(m_frameHeader), m_fSink);
-    if (nBytesWritten != sizeof(m_frameHeader))
+    if (WriteData(&m_frameHeader, sizeof(m_frameHeader)) != MFX_ERR_NONE)
         return MFX_ERR_MORE_BITSTREAM;
 
     return MFX_ERR_NONE;
@@ -901,6 +1183,9 @@ void CIVFFrameWriter::UpdateNumberOfFrames() {
         fseek(m_fSink, 24, SEEK_SET);
         fwrite(&m_frameNum, 1, sizeof(mfxU32), m_fSink);
     }
+    else if (m_pAsyncSink && m_pAsyncSink->IsOpen()) {
+        m_pAsyncSink->WriteAt(24, &m_frameNum, sizeof(mfxU32));
+    }
 }
 
 mfxStatus CIVFFrameWriter::Reset() {
@@ -937,7 +1222,7 @@ mfxStatus CIVFFrameWriter::Init(const msdk_char* strFileName,
 // write a complete frame into given bitstream
 mfxStatus CIVFFrameWriter::WriteNextFrame(mfxBitstream* pMfxBitstream, bool isPrint) {
     if (m_bSkipWriting == false)
-        MSDK_CHECK_ERROR(m_fSink, NULL, MFX_ERR_NOT_INITIALIZED);
+        MSDK_CHECK_ERROR(IsSinkOpened(), false, MFX_ERR_NOT_INITIALIZED);
 
     MSDK_CHECK_POINTER(pMfxBitstream, MFX_ERR_NULL_PTR);
 
@@ -967,7 +1252,9 @@ void CIVFFrameWriter::Close() {
 }
 #endif
 
-CSmplYUVWriter::CSmplYUVWriter() : m_sFile() {
+CSmplYUVWriter::CSmplYUVWriter() : m_sFile(), m_buffer(), m_asyncDest() {
+    m_bAsyncWrite     = false;
+    m_bDirectIO       = false;
     m_bInited         = false;
     m_bIsMultiView    = false;
     m_fDest           = NULL;
@@ -987,7 +1274,21 @@ mfxStatus CSmplYUVWriter::Init(const msdk_char* strFileName, const mfxU32 numVie
 
     //open file to write decoded data
 
-    if (!m_bIsMultiView) {
+    if (m_bAsyncWrite) {
+        mfxU32 nFiles = m_bIsMultiView ? numViews : 1;
+        MSDK_CHECK_ERROR(nFiles, 0, MFX_ERR_NOT_INITIALIZED);
+
+        m_asyncDest.resize(nFiles);
+        for (mfxU32 i = 0; i < nFiles; ++i) {
+            m_asyncDest[i].reset(new CAsyncFileWriter());
+            mfxStatus sts = m_asyncDest[i]->Open(
+                m_bIsMultiView ? FormMVCFileName(m_sFile.c_str(), i).c_str() : m_sFile.c_str(),
+                m_bDirectIO);
+            MSDK_CHECK_STATUS(sts, "CAsyncFileWriter::Open failed");
+            ++m_numCreatedFiles;
+        }
+    }
+    else if (!m_bIsMultiView) {
         MSDK_FOPEN(m_fDest, m_sFile.c_str(), MSDK_STRING("wb"));
         MSDK_CHECK_POINTER(m_fDest, MFX_ERR_NULL_PTR);
         ++m_numCreatedFiles;
@@ -1041,6 +1342,12 @@ void CSmplYUVWriter::Close() {
         m_fDestMVC = NULL;
     }
 
+    for (size_t i = 0; i < m_asyncDest.size(); ++i) {
+        if (m_asyncDest[i])
+            m_asyncDest[i]->Close();
+    }
+    m_asyncDest.clear();
+
     m_numCreatedFiles = 0;
     m_bInited         = false;
 }
@@ -1099,6 +1406,72 @@ mfxStatus GetChromaSize(const mfxFrameInfo& pInfo, mfxU32& ChromaW, mfxU32& Chro
     return MFX_ERR_NONE;
 }
 
+mfxStatus CSmplYUVWriter::CheckOutput(mfxU32 vid) {
+    if (m_bAsyncWrite) {
+        MSDK_CHECK_ERROR(vid < m_asyncDest.size(), false, MFX_ERR_NULL_PTR);
+        MSDK_CHECK_POINTER(m_asyncDest[vid], MFX_ERR_NULL_PTR);
+    }
+    else if (!m_bIsMultiView) {
+        MSDK_CHECK_POINTER(m_fDest, MFX_ERR_NULL_PTR);
+    }
+    else {
+        MSDK_CHECK_POINTER(m_fDestMVC, MFX_ERR_NULL_PTR);
+        MSDK_CHECK_POINTER(m_fDestMVC[vid], MFX_ERR_NULL_PTR);
+    }
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CSmplYUVWriter::WriteData(mfxU32 vid, const void* data, size_t size) {
+    if (m_bAsyncWrite)
+        return m_asyncDest[vid]->Write(data, size);
+
+    FILE* dstFile = m_bIsMultiView ? m_fDestMVC[vid] : m_fDest;
+    MSDK_CHECK_NOT_EQUAL(fwrite(data, 1, size, dstFile), size, MFX_ERR_UNDEFINED_BEHAVIOR);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CSmplYUVWriter::WritePlane(mfxU32 vid,
+                                     const mfxU8* src,
+                                     mfxU32 pitch,
+                                     mfxU32 rowBytes,
+                                     mfxU32 h,
+                                     mfxU32 shift) {
+    size_t size = (size_t)rowBytes * h;
+
+    // Plane without padding is written as is
+    if (!shift && pitch == rowBytes) {
+        return WriteData(vid, src, size);
+    }
+
+    // Async writer copies the data anyway, rows go to its queue directly
+    if (!shift && m_bAsyncWrite) {
+        for (mfxU32 i = 0; i < h; i++) {
+            mfxStatus sts = WriteData(vid, src + (size_t)i * pitch, rowBytes);
+            MSDK_CHECK_STATUS(sts, "WriteData failed");
+        }
+        return MFX_ERR_NONE;
+    }
+
+    if (m_buffer.size() < size)
+        m_buffer.resize(size);
+
+    if (!shift) {
+        CopyPlane(src, pitch, m_buffer.data(), rowBytes, rowBytes, h);
+    }
+    else {
+        // Convert MS-aligned samples to LS-aligned ones
+        const FrameKernels& kernels = GetFrameKernels();
+        for (mfxU32 i = 0; i < h; i++) {
+            kernels.ShiftRight16((const mfxU16*)(src + (size_t)i * pitch),
+                                 (mfxU16*)(m_buffer.data() + (size_t)i * rowBytes),
+                                 rowBytes / 2,
+                                 shift);
+        }
+    }
+
+    return WriteData(vid, m_buffer.data(), size);
+}
+
 mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
     MSDK_CHECK_ERROR(m_bInited, false, MFX_ERR_NOT_INITIALIZED);
     MSDK_CHECK_POINTER(pSurface, MFX_ERR_NULL_PTR);
@@ -1106,23 +1479,15 @@ mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
     mfxFrameInfo& pInfo = pSurface->Info;
     mfxFrameData& pData = pSurface->Data;
 
-    mfxU32 i;
-    mfxU32 vid = pInfo.FrameId.ViewId;
+    mfxStatus sts = MFX_ERR_NONE;
+    mfxU32 vid    = pInfo.FrameId.ViewId;
 
-    mfxU32 shiftSizeLuma   = 16 - pInfo.BitDepthLuma;
-    mfxU32 shiftSizeChroma = 16 - pInfo.BitDepthChroma;
-    // Temporary buffer to convert MS to no-MS format
-    std::vector<mfxU16> tmp;
+    mfxU32 shiftSizeLuma   = pInfo.Shift ? 16 - pInfo.BitDepthLuma : 0;
+    mfxU32 shiftSizeChroma = pInfo.Shift ? 16 - pInfo.BitDepthChroma : 0;
 
-    if (!m_bIsMultiView) {
-        MSDK_CHECK_POINTER(m_fDest, MFX_ERR_NULL_PTR);
-    }
-    else {
-        MSDK_CHECK_POINTER(m_fDestMVC, MFX_ERR_NULL_PTR);
-        MSDK_CHECK_POINTER(m_fDestMVC[vid], MFX_ERR_NULL_PTR);
-    }
-
-    FILE* dstFile = m_bIsMultiView ? m_fDestMVC[vid] : m_fDest;
+    sts = CheckOutput(vid);
+    if (sts != MFX_ERR_NONE)
+        return sts;
 
     mfxU32 ChromaW, ChromaH;
     if (MFX_ERR_NONE != GetChromaSize(pInfo, ChromaW, ChromaH))
@@ -1133,130 +1498,62 @@ mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
         case MFX_FOURCC_NV12:
         case MFX_FOURCC_I420:
         case MFX_FOURCC_NV16:
-            for (i = 0; i < pInfo.CropH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX) + i * pData.Pitch,
-                           1,
-                           pInfo.CropW,
-                           dstFile),
-                    pInfo.CropW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+            sts = WritePlane(vid,
+                             pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX),
+                             pData.Pitch,
+                             pInfo.CropW,
+                             pInfo.CropH);
             break;
 #if (MFX_VERSION >= 1027)
         case MFX_FOURCC_Y210:
     #if (MFX_VERSION >= 1031)
         case MFX_FOURCC_Y216: // Luma and chroma will be filled below
     #endif
-        {
-            for (i = 0; i < pInfo.CropH; i++) {
-                mfxU8* pBuffer = ((mfxU8*)pData.Y) + (pInfo.CropY * pData.Pitch + pInfo.CropX * 4) +
-                                 i * pData.Pitch;
-                if (pInfo.Shift) {
-                    // Bits will be shifted to the lower position
-                    tmp.resize(pInfo.CropW * 2);
-
-                    for (int idx = 0; idx < pInfo.CropW * 2; idx++) {
-                        tmp[idx] = ((mfxU16*)pBuffer)[idx] >> shiftSizeLuma;
-                    }
-
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(((const mfxU8*)tmp.data()), 4, pInfo.CropW, dstFile),
-                        pInfo.CropW,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(fwrite(pBuffer, 4, pInfo.CropW, dstFile),
-                                         pInfo.CropW,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
-            return MFX_ERR_NONE;
-        } break;
+            // Bits will be shifted to the lower position
+            return WritePlane(vid,
+                              pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX * 4),
+                              pData.Pitch,
+                              4 * pInfo.CropW,
+                              pInfo.CropH,
+                              shiftSizeLuma);
 #endif
 #if (MFX_VERSION >= 1027)
         case MFX_FOURCC_Y410: // Luma and chroma will be filled below
-        {
-            mfxU8* pBuffer = (mfxU8*)pData.Y410;
-            for (i = 0; i < pInfo.CropH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(
-                        pBuffer + (pInfo.CropY * pData.Pitch + pInfo.CropX * 4) + i * pData.Pitch,
-                        4,
-                        pInfo.CropW,
-                        dstFile),
-                    pInfo.CropW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-            return MFX_ERR_NONE;
-        } break;
+            return WritePlane(vid,
+                              (mfxU8*)pData.Y410 + (pInfo.CropY * pData.Pitch + pInfo.CropX * 4),
+                              pData.Pitch,
+                              4 * pInfo.CropW,
+                              pInfo.CropH);
 #endif
 #if (MFX_VERSION >= 1031)
         case MFX_FOURCC_Y416: // Luma and chroma will be filled below
-        {
-            for (i = 0; i < pInfo.CropH; i++) {
-                mfxU8* pBuffer = ((mfxU8*)pData.U) + (pInfo.CropY * pData.Pitch + pInfo.CropX * 8) +
-                                 i * pData.Pitch;
-                if (pInfo.Shift) {
-                    tmp.resize(pInfo.CropW * 4);
-
-                    for (int idx = 0; idx < pInfo.CropW * 4; idx++) {
-                        tmp[idx] = ((mfxU16*)pBuffer)[idx] >> shiftSizeLuma;
-                    }
-
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(((const mfxU8*)tmp.data()), 8, pInfo.CropW, dstFile),
-                        pInfo.CropW,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(fwrite(pBuffer, 8, pInfo.CropW, dstFile),
-                                         pInfo.CropW,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
-            return MFX_ERR_NONE;
-        } break;
+            return WritePlane(vid,
+                              pData.U + (pInfo.CropY * pData.Pitch + pInfo.CropX * 8),
+                              pData.Pitch,
+                              8 * pInfo.CropW,
+                              pInfo.CropH,
+                              shiftSizeLuma);
 #endif
         case MFX_FOURCC_I010:
-            for (i = 0; i < pInfo.CropH; i++) {
-                mfxU16* shortPtr = (mfxU16*)(pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX) +
-                                             i * pData.Pitch);
-                MSDK_CHECK_NOT_EQUAL(fwrite(shortPtr, 1, (mfxU32)pInfo.CropW * 2, dstFile),
-                                     (mfxU32)pInfo.CropW * 2,
-                                     MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+            sts = WritePlane(vid,
+                             pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX),
+                             pData.Pitch,
+                             2 * pInfo.CropW,
+                             pInfo.CropH);
             break;
         case MFX_FOURCC_P010:
 #if (MFX_VERSION >= 1031)
         case MFX_FOURCC_P016:
 #endif
-        case MFX_FOURCC_P210: {
-            for (i = 0; i < pInfo.CropH; i++) {
-                mfxU16* shortPtr = (mfxU16*)(pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX) +
-                                             i * pData.Pitch);
-                if (pInfo.Shift) {
-                    // Convert MS-P*1* to P*1* and write
-                    // Bits will be shifted to the lower position
-                    tmp.resize(pData.Pitch);
-
-                    for (int idx = 0; idx < pInfo.CropW; idx++) {
-                        tmp[idx] = shortPtr[idx] >> shiftSizeLuma;
-                    }
-
-                    MSDK_CHECK_NOT_EQUAL(fwrite(&tmp[0], 1, (mfxU32)pInfo.CropW * 2, dstFile),
-                                         (mfxU32)pInfo.CropW * 2,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(fwrite(shortPtr, 1, (mfxU32)pInfo.CropW * 2, dstFile),
-                                         (mfxU32)pInfo.CropW * 2,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
-
+        case MFX_FOURCC_P210:
+            // Convert MS-P*1* to P*1* and write
+            sts = WritePlane(vid,
+                             pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX),
+                             pData.Pitch,
+                             2 * pInfo.CropW,
+                             pInfo.CropH,
+                             shiftSizeLuma);
             break;
-        }
         case MFX_FOURCC_RGB4:
         case MFX_FOURCC_AYUV:
         case MFX_FOURCC_A2RGB10:
@@ -1267,129 +1564,57 @@ mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
         default:
             return MFX_ERR_UNSUPPORTED;
     }
+    MSDK_CHECK_STATUS(sts, "WritePlane failed");
 
     //chroma
     switch (pInfo.FourCC) {
-        case MFX_FOURCC_YV12: {
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.V + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                               i * pData.Pitch,
-                           1,
-                           ChromaW,
-                           dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.U + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                               i * pData.Pitch / 2,
-                           1,
-                           ChromaW,
-                           dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-            break;
-        }
+        case MFX_FOURCC_YV12:
         case MFX_FOURCC_I420: {
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.U + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                               i * pData.Pitch / 2,
-                           1,
-                           ChromaW,
-                           dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.V + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                               i * pData.Pitch / 2,
-                           1,
-                           ChromaW,
-                           dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+            mfxU32 offset = pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2;
+            mfxU8* first  = (pInfo.FourCC == MFX_FOURCC_YV12) ? pData.V : pData.U;
+            mfxU8* second = (pInfo.FourCC == MFX_FOURCC_YV12) ? pData.U : pData.V;
+
+            sts = WritePlane(vid, first + offset, pData.Pitch / 2, ChromaW, ChromaH);
+            MSDK_CHECK_STATUS(sts, "WritePlane failed");
+            sts = WritePlane(vid, second + offset, pData.Pitch / 2, ChromaW, ChromaH);
             break;
         }
-        case MFX_FOURCC_NV12: {
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(pData.UV + (pInfo.CropY * pData.Pitch + pInfo.CropX) + i * pData.Pitch,
-                           1,
-                           ChromaW,
-                           dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+        case MFX_FOURCC_NV12:
+            sts = WritePlane(vid,
+                             pData.UV + (pInfo.CropY * pData.Pitch + pInfo.CropX),
+                             pData.Pitch,
+                             ChromaW,
+                             ChromaH);
             break;
-        }
-        case MFX_FOURCC_NV16: {
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(
-                    fwrite(
-                        pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX) + i * pData.Pitch,
-                        1,
-                        ChromaW,
-                        dstFile),
-                    ChromaW,
-                    MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+        case MFX_FOURCC_NV16:
+            sts = WritePlane(vid,
+                             pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX),
+                             pData.Pitch,
+                             ChromaW,
+                             ChromaH);
             break;
-        }
         case MFX_FOURCC_I010: {
             mfxU16 chPitch = pData.Pitch / 2;
             mfxU32 basePtr = (pInfo.CropY * chPitch + pInfo.CropX / 2);
 
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(fwrite(pData.U + basePtr + i * chPitch, 1, ChromaW, dstFile),
-                                     ChromaW,
-                                     MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-
-            basePtr = (pInfo.CropY * chPitch + pInfo.CropX / 2);
-
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(fwrite(pData.V + basePtr + i * chPitch, 1, ChromaW, dstFile),
-                                     ChromaW,
-                                     MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
+            sts = WritePlane(vid, pData.U + basePtr, chPitch, ChromaW, ChromaH);
+            MSDK_CHECK_STATUS(sts, "WritePlane failed");
+            sts = WritePlane(vid, pData.V + basePtr, chPitch, ChromaW, ChromaH);
             break;
         }
         case MFX_FOURCC_P010:
 #if (MFX_VERSION >= 1031)
         case MFX_FOURCC_P016:
 #endif
-        case MFX_FOURCC_P210: {
-            for (i = 0; i < ChromaH; i++) {
-                mfxU16* shortPtr =
-                    (mfxU16*)(pData.UV + (pInfo.CropY * pData.Pitch + pInfo.CropX * 2) +
-                              i * pData.Pitch);
-                if (pInfo.Shift) {
-                    // Convert MS-P*1* to P*1* and write
-                    // Bits will be shifted to the lower position
-                    tmp.resize(pData.Pitch);
-
-                    for (mfxU32 idx = 0; idx < ChromaW; idx++) {
-                        tmp[idx] = shortPtr[idx] >> shiftSizeChroma;
-                    }
-
-                    MSDK_CHECK_NOT_EQUAL(fwrite(&tmp[0], 1, ChromaW * 2, dstFile),
-                                         (mfxU32)ChromaW * 2,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(fwrite(shortPtr, 1, ChromaW * 2, dstFile),
-                                         ChromaW * 2,
-                                         MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
+        case MFX_FOURCC_P210:
+            // Convert MS-P*1* to P*1* and write
+            sts = WritePlane(vid,
+                             pData.UV + (pInfo.CropY * pData.Pitch + pInfo.CropX * 2),
+                             pData.Pitch,
+                             ChromaW * 2,
+                             ChromaH,
+                             shiftSizeChroma);
             break;
-        }
 
         case MFX_FOURCC_RGB4:
         case MFX_FOURCC_AYUV:
@@ -1401,12 +1626,9 @@ mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
             //ptr = std::min( pData.R, pData.G, pData.B );
             ptr = ptr + pInfo.CropX + pInfo.CropY * pData.Pitch;
 
-            for (i = 0; i < ChromaH; i++) {
-                MSDK_CHECK_NOT_EQUAL(fwrite(ptr + i * pData.Pitch, 1, 4 * ChromaW, dstFile),
-                                     4 * ChromaW,
-                                     MFX_ERR_UNDEFINED_BEHAVIOR);
-            }
-            fflush(dstFile);
+            sts = WritePlane(vid, ptr, pData.Pitch, 4 * ChromaW, ChromaH);
+            if (!m_bAsyncWrite)
+                fflush(m_bIsMultiView ? m_fDestMVC[vid] : m_fDest);
             break;
         }
 
@@ -1414,7 +1636,7 @@ mfxStatus CSmplYUVWriter::WriteNextFrame(mfxFrameSurface1* pSurface) {
             return MFX_ERR_UNSUPPORTED;
     }
 
-    return MFX_ERR_NONE;
+    return sts;
 }
 
 mfxStatus CSmplYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
@@ -1424,16 +1646,12 @@ mfxStatus CSmplYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
     mfxFrameInfo& pInfo = pSurface->Info;
     mfxFrameData& pData = pSurface->Data;
 
-    mfxU32 i, j;
-    mfxU32 vid = pInfo.FrameId.ViewId;
+    mfxStatus sts = MFX_ERR_NONE;
+    mfxU32 vid    = pInfo.FrameId.ViewId;
 
-    if (!m_bIsMultiView) {
-        MSDK_CHECK_POINTER(m_fDest, MFX_ERR_NULL_PTR);
-    }
-    else {
-        MSDK_CHECK_POINTER(m_fDestMVC, MFX_ERR_NULL_PTR);
-        MSDK_CHECK_POINTER(m_fDestMVC[vid], MFX_ERR_NULL_PTR);
-    }
+    sts = CheckOutput(vid);
+    if (sts != MFX_ERR_NONE)
+        return sts;
 
     mfxU32 ChromaW, ChromaH;
     if (MFX_ERR_NONE != GetChromaSize(pInfo, ChromaW, ChromaH))
@@ -1442,31 +1660,14 @@ mfxStatus CSmplYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
     // Write Y
     switch (pInfo.FourCC) {
         case MFX_FOURCC_YV12:
-        case MFX_FOURCC_NV12: {
-            for (i = 0; i < pInfo.CropH; i++) {
-                if (!m_bIsMultiView) {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(
-                            pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX) + i * pData.Pitch,
-                            1,
-                            pInfo.CropW,
-                            m_fDest),
-                        pInfo.CropW,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(
-                            pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX) + i * pData.Pitch,
-                            1,
-                            pInfo.CropW,
-                            m_fDestMVC[vid]),
-                        pInfo.CropW,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
+        case MFX_FOURCC_NV12:
+            sts = WritePlane(vid,
+                             pData.Y + (pInfo.CropY * pData.Pitch + pInfo.CropX),
+                             pData.Pitch,
+                             pInfo.CropW,
+                             pInfo.CropH);
+            MSDK_CHECK_STATUS(sts, "WritePlane failed");
             break;
-        }
         default: {
             msdk_printf(MSDK_STRING("ERROR: I420 output is accessible only for NV12 and YV12.\n"));
             return MFX_ERR_UNSUPPORTED;
@@ -1476,101 +1677,33 @@ mfxStatus CSmplYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
     // Write U and V
     switch (pInfo.FourCC) {
         case MFX_FOURCC_YV12: {
-            for (i = 0; i < ChromaH; i++) {
-                if (!m_bIsMultiView) {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(pData.U + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                                   i * pData.Pitch / 2,
-                               1,
-                               ChromaW,
-                               m_fDest),
-                        (mfxU32)pInfo.CropW / 2,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(pData.U + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                                   i * pData.Pitch / 2,
-                               1,
-                               ChromaW,
-                               m_fDestMVC[vid]),
-                        (mfxU32)pInfo.CropW / 2,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
-            for (i = 0; i < ChromaH; i++) {
-                if (!m_bIsMultiView) {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(pData.V + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                                   i * pData.Pitch / 2,
-                               1,
-                               ChromaW,
-                               m_fDest),
-                        (mfxU32)pInfo.CropW / 2,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-                else {
-                    MSDK_CHECK_NOT_EQUAL(
-                        fwrite(pData.V + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2) +
-                                   i * pData.Pitch / 2,
-                               1,
-                               ChromaW,
-                               m_fDestMVC[vid]),
-                        (mfxU32)pInfo.CropW / 2,
-                        MFX_ERR_UNDEFINED_BEHAVIOR);
-                }
-            }
+            mfxU32 offset = pInfo.CropY * pData.Pitch / 2 + pInfo.CropX / 2;
+
+            sts = WritePlane(vid, pData.U + offset, pData.Pitch / 2, ChromaW, ChromaH);
+            MSDK_CHECK_STATUS(sts, "WritePlane failed");
+            sts = WritePlane(vid, pData.V + offset, pData.Pitch / 2, ChromaW, ChromaH);
             break;
         }
         case MFX_FOURCC_NV12: {
-            for (i = 0; i < ChromaH; i++) {
-                for (j = 0; j < ChromaW; j += 2) {
-                    if (!m_bIsMultiView) {
-                        MSDK_CHECK_NOT_EQUAL(
-                            fwrite(pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX) +
-                                       i * pData.Pitch + j,
-                                   1,
-                                   1,
-                                   m_fDest),
-                            1,
-                            MFX_ERR_UNDEFINED_BEHAVIOR);
-                    }
-                    else {
-                        MSDK_CHECK_NOT_EQUAL(
-                            fwrite(pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX) +
-                                       i * pData.Pitch + j,
-                                   1,
-                                   1,
-                                   m_fDestMVC[vid]),
-                            1,
-                            MFX_ERR_UNDEFINED_BEHAVIOR);
-                    }
-                }
-            }
-            for (i = 0; i < ChromaH; i++) {
-                for (j = 1; j < ChromaW; j += 2) {
-                    if (!m_bIsMultiView) {
-                        MSDK_CHECK_NOT_EQUAL(
-                            fwrite(pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX) +
-                                       i * pData.Pitch + j,
-                                   1,
-                                   1,
-                                   m_fDest),
-                            1,
-                            MFX_ERR_UNDEFINED_BEHAVIOR);
-                    }
-                    else {
-                        MSDK_CHECK_NOT_EQUAL(
-                            fwrite(pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX) +
-                                       i * pData.Pitch + j,
-                                   1,
-                                   1,
-                                   m_fDestMVC[vid]),
-                            1,
-                            MFX_ERR_UNDEFINED_BEHAVIOR);
-                    }
-                }
+            // Deinterleave UV plane to the U and V planes and write both at once
+            const mfxU8* src = pData.UV + (pInfo.CropY * pData.Pitch / 2 + pInfo.CropX);
+            mfxU32 w         = ChromaW / 2;
+            size_t planeSize = (size_t)w * ChromaH;
+
+            if (m_buffer.size() < 2 * planeSize)
+                m_buffer.resize(2 * planeSize);
+
+            mfxU8* u                    = m_buffer.data();
+            mfxU8* v                    = m_buffer.data() + planeSize;
+            const FrameKernels& kernels = GetFrameKernels();
+            for (mfxU32 i = 0; i < ChromaH; i++) {
+                kernels.DeinterleaveUV(src + (size_t)i * pData.Pitch,
+                                       u + (size_t)i * w,
+                                       v + (size_t)i * w,
+                                       w);
             }
+
+            sts = WriteData(vid, m_buffer.data(), 2 * planeSize);
             break;
         }
         default: {
@@ -1579,7 +1712,7 @@ mfxStatus CSmplYUVWriter::WriteNextFrameI420(mfxFrameSurface1* pSurface) {
         }
     }
 
-    return MFX_ERR_NONE;
+    return sts;
 }
 
 void QPFile::Reader::ResetState() {
@@ -2341,6 +2474,43 @@ mfxStatus msdk_opt_read(const msdk_char* string, mfxPriority& value) {
 
 mfxStatus msdk_opt_read(msdk_char* string, mfxPriority& value);
 
+mfxStatus msdk_parse_cpu_list(const msdk_char* string, std::vector<mfxU32>& cpus) {
+    // larger numbers are surely typos, sets of the system calls are smaller
+    const long MAX_CPU_NUMBER = 4096;
+
+    cpus.clear();
+    MSDK_CHECK_POINTER(string, MFX_ERR_NULL_PTR);
+
+    const msdk_char* ptr = string;
+    while (*ptr) {
+        msdk_char* stopCharacter;
+        long first = msdk_strtol(ptr, &stopCharacter, 10);
+        if (stopCharacter == ptr || first < 0)
+            return MFX_ERR_UNKNOWN;
+        ptr = stopCharacter;
+
+        long last = first;
+        if (*ptr == MSDK_CHAR('-')) {
+            ptr++;
+            last = msdk_strtol(ptr, &stopCharacter, 10);
+            if (stopCharacter == ptr || last < first)
+                return MFX_ERR_UNKNOWN;
+            ptr = stopCharacter;
+        }
+        if (last >= MAX_CPU_NUMBER)
+            return MFX_ERR_UNKNOWN;
+
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus.push_back((mfxU32)cpu);
+
+        if (*ptr == MSDK_CHAR(',') && *(ptr + 1))
+            ptr++;
+        else if (*ptr)
+            return MFX_ERR_UNKNOWN;
+    }
+    return cpus.empty() ? MFX_ERR_UNKNOWN : MFX_ERR_NONE;
+}
+
 bool IsDecodeCodecSupported(mfxU32 codecFormat) {
     switch (codecFormat) {
         case MFX_CODEC_MPEG2:
@@ -2608,9 +2778,10 @@ mfxStatus CH264FrameReader::Init(const msdk_char* strFileName) {
     m_processedBS   = NULL;
 
     m_originalBS.Extend(1024 * 1024);
-#if (MFX_VERSION < 2000)
-    m_pNALSplitter.reset(new ProtectedLibrary::AVC_Spl());
-#endif
+    ProtectedLibrary::AVC_Spl* pSplitter = new ProtectedLibrary::AVC_Spl();
+    // Only frame data is used, so slice headers are parsed till the frame boundary fields
+    pSplitter->SetParseMode(ProtectedLibrary::PARSE_HEADERS_LAZY);
+    m_pNALSplitter.reset(pSplitter);
     m_frame           = 0;
     m_plainBuffer     = 0;
     m_plainBufferSize = 0;
@@ -2618,6 +2789,23 @@ mfxStatus CH264FrameReader::Init(const msdk_char* strFileName) {
     return sts;
 }
 
+mfxStatus CH264FrameReader::SetPosition(const StreamIndexEntry& entry, mfxU32 frame) {
+    mfxStatus sts = CSmplBitstreamReader::SetPosition(entry, frame);
+    MSDK_CHECK_STATUS(sts, "CSmplBitstreamReader::SetPosition failed");
+
+    // Drop data read ahead from the previous position
+    m_originalBS.DataOffset = 0;
+    m_originalBS.DataLength = 0;
+    m_originalBS.DataFlag   = 0;
+    m_isEndOfStream         = false;
+    m_processedBS           = NULL;
+    m_frame                 = NULL;
+    if (m_pNALSplitter)
+        std::ignore = m_pNALSplitter->Reset();
+
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CH264FrameReader::ReadNextFrame(mfxBitstream* pBS) {
     mfxStatus sts = MFX_ERR_NONE;
     pBS->DataFlag = MFX_BITSTREAM_COMPLETE_FRAME;
@@ -0,0 +1,521 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "avc_bitstream.h"
+#include "avc_nal_spl.h"
+#include "nal_scanner.h"
+#include "sample_defs.h"
+#include "stream_index.h"
+#include "vm/file_defs.h"
+
+#define STREAM_INDEX_MAGIC      MFX_MAKEFOURCC('S', 'I', 'D', 'X')
+#define STREAM_INDEX_VERSION    2
+// Sizes of the serialized header (magic, version, format, file size, count) and entry
+#define STREAM_INDEX_HEADER_SIZE 28
+#define STREAM_INDEX_ENTRY_SIZE  24
+#define STREAM_INDEX_READ_CHUNK (4 * 1024 * 1024)
+// Enough to parse the frame header of VP8/VP9 or OBU headers at the start of AV1 temporal unit
+#define IVF_FRAME_PEEK_SIZE 64
+// Enough to parse the slice segment header of HEVC till the PPS ID
+#define HEVC_SLICE_PEEK_SIZE 16
+
+namespace {
+
+// Sidecar fields are stored one by one in little-endian order, so the file doesn't depend
+// on the byte order of the machine and the padding of the structures
+void PutU32(std::vector<mfxU8>& data, mfxU32 value) {
+    for (mfxU32 i = 0; i < 4; i++)
+        data.push_back((mfxU8)(value >> (8 * i)));
+}
+
+void PutU64(std::vector<mfxU8>& data, mfxU64 value) {
+    for (mfxU32 i = 0; i < 8; i++)
+        data.push_back((mfxU8)(value >> (8 * i)));
+}
+
+mfxU32 GetU32(const mfxU8*& p) {
+    mfxU32 value = 0;
+    for (mfxU32 i = 0; i < 4; i++)
+        value |= (mfxU32)*p++ << (8 * i);
+    return value;
+}
+
+mfxU64 GetU64(const mfxU8*& p) {
+    mfxU64 value = 0;
+    for (mfxU32 i = 0; i < 8; i++)
+        value |= (mfxU64)*p++ << (8 * i);
+    return value;
+}
+
+using namespace ProtectedLibrary;
+
+// Tracks HEVC parameter sets, so an IRAP picture is a key frame only if the parameter sets it
+// refers to precede it in the stream and the decoding may start from it. Only IDs are needed,
+// so the parameter sets are parsed lazily.
+class CHEVCParamSetTracker {
+public:
+    CHEVCParamSetTracker() : m_swapped() {
+        std::fill(m_vps, m_vps + HEVC_MAX_NUM_VPS, false);
+        std::fill(m_spsVps, m_spsVps + HEVC_MAX_NUM_SPS, (mfxU8)HEVC_MAX_NUM_VPS);
+        std::fill(m_ppsSps, m_ppsSps + HEVC_MAX_NUM_PPS, (mfxU8)HEVC_MAX_NUM_SPS);
+    }
+
+    // Returns true for the slice segment of the base layer IRAP picture with known parameter sets
+    bool AddNalUnit(const NalUnitInfo& nal) {
+        bool vcl = nal.type < HEVC_NAL_UT_VPS;
+        if (vcl && (nal.type < HEVC_NAL_UT_BLA_W_LP || nal.type > HEVC_NAL_UT_IRAP_MAX))
+            return false;
+        if (!vcl && nal.type > HEVC_NAL_UT_PPS)
+            return false;
+
+        mfxU32 size = vcl ? (std::min)(nal.size, (mfxU32)HEVC_SLICE_PEEK_SIZE) : nal.size;
+        if (m_swapped.size() < size + 8)
+            m_swapped.resize(size + 8);
+        mfxU32 swappedSize = size;
+        BytesSwapper::SwapMemory(m_swapped.data(),
+                                 swappedSize,
+                                 const_cast<mfxU8*>(nal.data),
+                                 size);
+
+        try {
+            HEVCHeadersBitstream bs(m_swapped.data(), swappedSize);
+            HEVC_NAL_Unit_Type type;
+            mfxU8 layerId, temporalId;
+            if (bs.GetNALUnitHeader(type, layerId, temporalId) != MFX_ERR_NONE || layerId)
+                return false;
+
+            switch (type) {
+                case HEVC_NAL_UT_VPS: {
+                    HEVCVideoParamSet vps;
+                    if (bs.GetVideoParamSet(&vps) == MFX_ERR_NONE)
+                        m_vps[vps.GetID()] = true;
+                    return false;
+                }
+                case HEVC_NAL_UT_SPS: {
+                    HEVCSeqParamSet sps;
+                    if (bs.GetSequenceParamSet(&sps, PARSE_HEADERS_LAZY) == MFX_ERR_NONE)
+                        m_spsVps[sps.GetID()] = sps.sps_video_parameter_set_id;
+                    return false;
+                }
+                case HEVC_NAL_UT_PPS: {
+                    HEVCPicParamSet pps;
+                    if (bs.GetPictureParamSet(&pps, PARSE_HEADERS_LAZY) == MFX_ERR_NONE)
+                        m_ppsSps[pps.GetID()] = pps.pps_seq_parameter_set_id;
+                    return false;
+                }
+                default: {
+                    HEVCSliceHeader hdr = {};
+                    hdr.nal_unit_type   = (mfxU8)type;
+                    if (bs.GetSliceHeaderPart1(&hdr) != MFX_ERR_NONE)
+                        return false;
+                    mfxU8 spsId = m_ppsSps[hdr.slice_pic_parameter_set_id];
+                    return spsId < HEVC_MAX_NUM_SPS && m_spsVps[spsId] < HEVC_MAX_NUM_VPS &&
+                           m_vps[m_spsVps[spsId]];
+                }
+            }
+        }
+        catch (...) {
+            // truncated or corrupted NAL unit
+            return false;
+        }
+    }
+
+protected:
+    std::vector<mfxU8> m_swapped;
+    bool m_vps[HEVC_MAX_NUM_VPS];
+    mfxU8 m_spsVps[HEVC_MAX_NUM_SPS]; // VPS ID of the SPS, HEVC_MAX_NUM_VPS if not received
+    mfxU8 m_ppsSps[HEVC_MAX_NUM_PPS]; // SPS ID of the PPS, HEVC_MAX_NUM_SPS if not received
+};
+
+// Tracks access unit boundaries over the NAL units of the stream
+class CAccessUnitSplitter {
+public:
+    explicit CAccessUnitSplitter(StreamIndexFormat format)
+            : m_format(format),
+              m_hevcParamSets(),
+              m_auStart(0),
+              m_pendingStart(0),
+              m_bStarted(false),
+              m_bHasVcl(false),
+              m_bPending(false),
+              m_bKey(false) {}
+
+    void AddNalUnit(const NalUnitInfo& nal, mfxU64 offset, std::vector<StreamIndexEntry>& aus) {
+        if (!m_bStarted) {
+            m_auStart  = offset;
+            m_bStarted = true;
+        }
+
+        bool vcl, key, firstSlice, prefix;
+        mfxU32 t = nal.type;
+        if (m_format == STREAM_INDEX_AVC) {
+            vcl        = t >= 1 && t <= 5;
+            key        = t == 5;
+            firstSlice = nal.size > 1 && (nal.data[1] & 0x80);
+            prefix     = (t >= 6 && t <= 9) || (t >= 14 && t <= 18);
+        }
+        else {
+            vcl        = t < 32;
+            key        = m_hevcParamSets.AddNalUnit(nal);
+            firstSlice = nal.size > 2 && (nal.data[2] & 0x80);
+            prefix     = (t >= 32 && t <= 35) || t == 39 || (t >= 41 && t <= 44) ||
+                         (t >= 48 && t <= 55);
+        }
+
+        if (!vcl) {
+            // First of the non-VCL units which precede the next picture
+            if (prefix && m_bHasVcl && !m_bPending) {
+                m_pendingStart = offset;
+                m_bPending     = true;
+            }
+            return;
+        }
+
+        if (m_bHasVcl && (m_bPending || firstSlice)) {
+            mfxU64 start = m_bPending ? m_pendingStart : offset;
+            Flush(start, aus);
+            m_auStart = start;
+        }
+        m_bPending = false;
+        m_bHasVcl  = true;
+        m_bKey     = m_bKey || key;
+    }
+
+    // Closes the last access unit, trailing non-VCL units (end of sequence etc.) belong to it
+    void Finish(mfxU64 end, std::vector<StreamIndexEntry>& aus) {
+        if (m_bHasVcl)
+            Flush(end, aus);
+        m_bHasVcl = false;
+    }
+
+protected:
+    void Flush(mfxU64 end, std::vector<StreamIndexEntry>& aus) {
+        StreamIndexEntry entry = {};
+        entry.offset           = m_auStart;
+        entry.size             = (mfxU32)(end - m_auStart);
+        entry.flags            = m_bKey ? StreamIndexEntry::FLAG_KEY_FRAME : 0;
+        aus.push_back(entry);
+        m_bKey = false;
+    }
+
+    StreamIndexFormat m_format;
+    CHEVCParamSetTracker m_hevcParamSets;
+    mfxU64 m_auStart;
+    mfxU64 m_pendingStart;
+    bool m_bStarted;
+    bool m_bHasVcl;
+    bool m_bPending;
+    bool m_bKey;
+};
+
+bool IsVP9KeyFrame(const mfxU8* data, mfxU32 size) {
+    if (!size || (data[0] >> 6) != 2) // frame_marker
+        return false;
+    mfxU32 profile = ((data[0] >> 5) & 1) | (((data[0] >> 4) & 1) << 1);
+    mfxU32 bit     = (profile == 3) ? 5 : 4; // reserved_zero for profile 3
+    if ((data[0] >> (7 - bit)) & 1) // show_existing_frame
+        return false;
+    bit++;
+    return bit < 8 && !((data[0] >> (7 - bit)) & 1); // frame_type == KEY_FRAME
+}
+
+// Temporal unit with the sequence header is a random access point
+bool IsAV1KeyFrame(const mfxU8* data, mfxU32 size) {
+    mfxU32 pos = 0;
+    while (pos < size) {
+        mfxU8 header = data[pos];
+        mfxU32 type  = (header >> 3) & 0xf;
+        if (type == 1) // OBU_SEQUENCE_HEADER
+            return true;
+        pos += 1 + ((header >> 2) & 1);
+        if (!((header >> 1) & 1)) // obu_has_size_field
+            return false;
+
+        mfxU64 obuSize = 0;
+        for (mfxU32 i = 0; i < 8 && pos < size; i++) {
+            mfxU8 byte = data[pos++];
+            obuSize |= (mfxU64)(byte & 0x7f) << (7 * i);
+            if (!(byte & 0x80))
+                break;
+        }
+        if (obuSize >= size)
+            return false;
+        pos += (mfxU32)obuSize;
+    }
+    return false;
+}
+
+} // namespace
+
+CStreamIndex::CStreamIndex() : m_format(STREAM_INDEX_UNKNOWN), m_fileSize(0) {}
+
+CStreamIndex::~CStreamIndex() {}
+
+void CStreamIndex::Clear() {
+    m_format   = STREAM_INDEX_UNKNOWN;
+    m_fileSize = 0;
+    m_entries.clear();
+    m_keyFrames.clear();
+}
+
+mfxU64 CStreamIndex::GetFileSize(const msdk_char* strFileName) {
+    FILE* file = NULL;
+    MSDK_FOPEN(file, strFileName, MSDK_STRING("rb"));
+    if (!file)
+        return 0;
+
+    mfxI64 size = -1;
+    if (!MSDK_FSEEK64(file, 0, SEEK_END))
+        size = MSDK_FTELL64(file);
+    fclose(file);
+    return size > 0 ? (mfxU64)size : 0;
+}
+
+mfxStatus CStreamIndex::Build(const msdk_char* strFileName, StreamIndexFormat format) {
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+    if (format == STREAM_INDEX_UNKNOWN)
+        return MFX_ERR_UNSUPPORTED;
+
+    Clear();
+
+    m_fileSize = GetFileSize(strFileName);
+    MSDK_CHECK_ERROR(m_fileSize, 0, MFX_ERR_MORE_DATA);
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, strFileName, MSDK_STRING("rb"));
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+
+    m_format      = format;
+    mfxStatus sts = (format == STREAM_INDEX_IVF) ? BuildIVF(file) : BuildAnnexB(file);
+    fclose(file);
+
+    if (sts != MFX_ERR_NONE) {
+        Clear();
+        return sts;
+    }
+
+    for (mfxU32 i = 0; i < (mfxU32)m_entries.size(); i++) {
+        if (m_entries[i].flags & StreamIndexEntry::FLAG_KEY_FRAME)
+            m_keyFrames.push_back(i);
+    }
+
+    return m_entries.empty() ? MFX_ERR_MORE_DATA : MFX_ERR_NONE;
+}
+
+mfxStatus CStreamIndex::BuildAnnexB(FILE* file) {
+    CNalUnitIterator iterator(m_format == STREAM_INDEX_AVC ? NAL_STREAM_AVC : NAL_STREAM_HEVC);
+    CAccessUnitSplitter splitter(m_format);
+
+    std::vector<mfxU8> buffer(STREAM_INDEX_READ_CHUNK);
+    mfxU64 bufferOffset = 0; // file offset of the first byte of the buffer
+    size_t dataSize     = 0;
+    bool bEOS           = false;
+
+    while (!bEOS) {
+        // NAL unit larger than the buffer
+        if (dataSize == buffer.size())
+            buffer.resize(2 * buffer.size());
+
+        size_t read = fread(buffer.data() + dataSize, 1, buffer.size() - dataSize, file);
+        if (!read && ferror(file))
+            return MFX_ERR_UNKNOWN;
+        bEOS = !read;
+        dataSize += read;
+
+        iterator.Init(buffer.data(), dataSize, bEOS);
+        NalUnitInfo nal;
+        while (iterator.GetNext(nal)) {
+            mfxU64 offset = bufferOffset + (mfxU64)(nal.data - nal.startCodeSize - buffer.data());
+            splitter.AddNalUnit(nal, offset, m_entries);
+        }
+
+        // Keep the incomplete NAL unit for the next portion of data
+        size_t consumed = (size_t)(iterator.GetRemainder() - buffer.data());
+        memmove(buffer.data(), iterator.GetRemainder(), dataSize - consumed);
+        dataSize -= consumed;
+        bufferOffset += consumed;
+    }
+
+    splitter.Finish(m_fileSize, m_entries);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CStreamIndex::BuildIVF(FILE* file) {
+    mfxU8 header[32];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, "DKIF", 4))
+        return MFX_ERR_UNSUPPORTED;
+
+    mfxU16 headerSize = (mfxU16)(header[6] | (header[7] << 8));
+    mfxU32 fourcc     = MFX_MAKEFOURCC(header[8], header[9], header[10], header[11]);
+
+    mfxU64 offset = headerSize;
+    mfxU8 data[IVF_FRAME_PEEK_SIZE];
+    while (offset + 12 <= m_fileSize) {
+        if (MSDK_FSEEK64(file, offset, SEEK_SET))
+            return MFX_ERR_UNKNOWN;
+
+        mfxU8 frameHeader[12];
+        if (fread(frameHeader, 1, sizeof(frameHeader), file) != sizeof(frameHeader))
+            break;
+
+        StreamIndexEntry entry = {};
+        entry.offset           = offset;
+        mfxU32 frameSize       = 0;
+        for (mfxU32 i = 0; i < 4; i++)
+            frameSize |= (mfxU32)frameHeader[i] << (8 * i);
+        for (mfxU32 i = 0; i < 8; i++)
+            entry.timeStamp |= (mfxU64)frameHeader[4 + i] << (8 * i);
+
+        // Truncated frame at the end of the file is not indexed
+        if (offset + 12 + frameSize > m_fileSize)
+            break;
+        entry.size = 12 + frameSize;
+
+        mfxU32 peek = (std::min)(frameSize, (mfxU32)IVF_FRAME_PEEK_SIZE);
+        if (fread(data, 1, peek, file) != peek)
+            return MFX_ERR_UNKNOWN;
+
+        bool key;
+        switch (fourcc) {
+            case MFX_MAKEFOURCC('V', 'P', '8', '0'):
+                key = peek && !(data[0] & 1);
+                break;
+            case MFX_MAKEFOURCC('V', 'P', '9', '0'):
+                key = IsVP9KeyFrame(data, peek);
+                break;
+            case MFX_MAKEFOURCC('A', 'V', '0', '1'):
+                key = IsAV1KeyFrame(data, peek);
+                break;
+            default:
+                // Unknown codec: only the first frame is assumed to be decodable
+                key = m_entries.empty();
+                break;
+        }
+        entry.flags = key ? StreamIndexEntry::FLAG_KEY_FRAME : 0;
+        m_entries.push_back(entry);
+
+        offset += entry.size;
+    }
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CStreamIndex::Save(const msdk_char* strIndexName) const {
+    MSDK_CHECK_POINTER(strIndexName, MFX_ERR_NULL_PTR);
+    if (m_entries.empty())
+        return MFX_ERR_NOT_INITIALIZED;
+
+    std::vector<mfxU8> data;
+    data.reserve(STREAM_INDEX_HEADER_SIZE + STREAM_INDEX_ENTRY_SIZE * m_entries.size());
+    PutU32(data, STREAM_INDEX_MAGIC);
+    PutU32(data, STREAM_INDEX_VERSION);
+    PutU32(data, (mfxU32)m_format);
+    PutU64(data, m_fileSize);
+    PutU64(data, m_entries.size());
+    for (const StreamIndexEntry& entry : m_entries) {
+        PutU64(data, entry.offset);
+        PutU64(data, entry.timeStamp);
+        PutU32(data, entry.size);
+        PutU32(data, entry.flags);
+    }
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, strIndexName, MSDK_STRING("wb"));
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok      = !fclose(file) && ok;
+
+    return ok ? MFX_ERR_NONE : MFX_ERR_UNKNOWN;
+}
+
+mfxStatus CStreamIndex::Load(const msdk_char* strIndexName,
+                             const msdk_char* strFileName,
+                             StreamIndexFormat format) {
+    MSDK_CHECK_POINTER(strIndexName, MFX_ERR_NULL_PTR);
+    MSDK_CHECK_POINTER(strFileName, MFX_ERR_NULL_PTR);
+
+    Clear();
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, strIndexName, MSDK_STRING("rb"));
+    if (!file)
+        return MFX_ERR_NOT_FOUND;
+
+    mfxU8 header[STREAM_INDEX_HEADER_SIZE];
+    const mfxU8* p  = header;
+    mfxU64 fileSize = 0, count = 0;
+    mfxStatus sts   = MFX_ERR_NOT_FOUND;
+    if (fread(header, 1, sizeof(header), file) == sizeof(header) &&
+        GetU32(p) == STREAM_INDEX_MAGIC && GetU32(p) == STREAM_INDEX_VERSION &&
+        GetU32(p) == (mfxU32)format) {
+        fileSize = GetU64(p);
+        count    = GetU64(p);
+        // Every access unit takes at least a byte of the stream
+        if (count && count <= fileSize && fileSize == GetFileSize(strFileName))
+            sts = MFX_ERR_NONE;
+    }
+
+    std::vector<mfxU8> data;
+    if (sts == MFX_ERR_NONE) {
+        data.resize((size_t)count * STREAM_INDEX_ENTRY_SIZE);
+        if (fread(data.data(), 1, data.size(), file) != data.size())
+            sts = MFX_ERR_NOT_FOUND;
+    }
+    fclose(file);
+
+    // Stale index of the stream which was changed since or of another version
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    m_entries.resize((size_t)count);
+    p = data.data();
+    for (StreamIndexEntry& entry : m_entries) {
+        entry.offset    = GetU64(p);
+        entry.timeStamp = GetU64(p);
+        entry.size      = GetU32(p);
+        entry.flags     = GetU32(p);
+        if (entry.flags & StreamIndexEntry::FLAG_KEY_FRAME)
+            m_keyFrames.push_back((mfxU32)(&entry - m_entries.data()));
+    }
+    m_format   = format;
+    m_fileSize = fileSize;
+
+    return MFX_ERR_NONE;
+}
+
+mfxU32 CStreamIndex::FindKeyFrame(mfxU32 frame) const {
+    std::vector<mfxU32>::const_iterator it =
+        std::upper_bound(m_keyFrames.begin(), m_keyFrames.end(), frame);
+    return (it == m_keyFrames.begin()) ? 0 : *(it - 1);
+}
+
+void CStreamIndex::SplitAtKeyFrames(mfxU32 parts,
+                                    std::vector<std::pair<mfxU32, mfxU32>>& ranges) const {
+    ranges.clear();
+
+    mfxU32 count = GetFrameCount();
+    if (!count || !parts)
+        return;
+
+    std::vector<mfxU32> starts(1, 0);
+    for (mfxU32 i = 1; i < parts; i++) {
+        mfxU32 start = FindKeyFrame((mfxU32)((mfxU64)count * i / parts));
+        if (start > starts.back())
+            starts.push_back(start);
+    }
+
+    for (size_t i = 0; i < starts.size(); i++) {
+        mfxU32 end = (i + 1 < starts.size()) ? starts[i + 1] : count;
+        ranges.push_back(std::make_pair(starts[i], end - starts[i]));
+    }
+}
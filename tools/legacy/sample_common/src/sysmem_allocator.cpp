@@ -5,16 +5,98 @@
   ############################################################################*/
 
 #include "sysmem_allocator.h"
+#include <string.h>
 #include <climits>
 #include "sample_utils.h"
 
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    #ifndef MPOL_PREFERRED
+        #define MPOL_PREFERRED 1
+    #endif
+#endif
+
 #define MSDK_ALIGN32(X) (((mfxU32)((X) + 31)) & (~(mfxU32)31))
 #define ID_BUFFER       MFX_MAKEFOURCC('B', 'U', 'F', 'F')
 #define ID_FRAME        MFX_MAKEFOURCC('F', 'R', 'M', 'E')
 
+namespace {
+
+const size_t SMALL_PAGE_SIZE = 4096;
+const size_t HUGE_PAGE_SIZE  = 2 * 1024 * 1024;
+
+// Options placing the pages, they need own memory
+const mfxU32 SYSMEM_ALLOC_PAGE_OPTIONS =
+    SYSMEM_ALLOC_SLAB | SYSMEM_ALLOC_THP | SYSMEM_ALLOC_HUGETLB | SYSMEM_ALLOC_NUMA;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+#if defined(__linux__)
+// Prefers the NUMA node for the pages of the range, node < 0 is the node of the CPU the
+// calling thread runs on. Pages go to other nodes instead of failing when the node is
+// out of memory.
+void BindToNode(void* ptr, size_t size, mfxI32 preferredNode) {
+    unsigned cpu = 0, node = (unsigned)preferredNode;
+    if (preferredNode < 0 && syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+        return;
+
+    const size_t bitsPerWord = 8 * sizeof(unsigned long);
+    unsigned long nodeMask[16] = {};
+    if (node + 1 >= bitsPerWord * 16)
+        return;
+    nodeMask[node / bitsPerWord] |= 1UL << (node % bitsPerWord);
+
+    syscall(SYS_mbind, ptr, size, MPOL_PREFERRED, nodeMask, bitsPerWord * 16, 0);
+}
+#endif
+
+} // namespace
+
+mfxU32 ParseSysMemAllocatorOptions(const msdk_char* strOptions) {
+    if (!strOptions)
+        return 0;
+
+    msdk_tstring list(strOptions);
+    mfxU32 options = 0;
+    size_t pos     = 0;
+    for (;;) {
+        size_t end         = list.find(MSDK_CHAR(','), pos);
+        msdk_tstring token = list.substr(pos, end == msdk_tstring::npos ? end : end - pos);
+
+        if (token == MSDK_STRING("align64"))
+            options |= SYSMEM_ALLOC_ALIGN64;
+        else if (token == MSDK_STRING("align4k"))
+            options |= SYSMEM_ALLOC_ALIGN4K;
+        else if (token == MSDK_STRING("slab"))
+            options |= SYSMEM_ALLOC_SLAB;
+        else if (token == MSDK_STRING("thp"))
+            options |= SYSMEM_ALLOC_THP;
+        else if (token == MSDK_STRING("hugetlb"))
+            options |= SYSMEM_ALLOC_HUGETLB;
+        else if (token == MSDK_STRING("numa"))
+            options |= SYSMEM_ALLOC_NUMA;
+        else
+            return 0;
+
+        if (end == msdk_tstring::npos)
+            break;
+        pos = end + 1;
+    }
+    return options;
+}
+
 SysMemFrameAllocator::SysMemFrameAllocator()
         : m_pBufferAllocator(0),
-          m_bOwnBufferAllocator(false) {}
+          m_bOwnBufferAllocator(false),
+          m_nOptions(0),
+          m_nNumaNode(-1),
+          m_vResp(),
+          m_regions() {}
 
 SysMemFrameAllocator::~SysMemFrameAllocator() {
     Close();
@@ -30,6 +112,8 @@ mfxStatus SysMemFrameAllocator::Init(mfxAllocatorParams* pParams) {
 
         m_pBufferAllocator    = pSysMemParams->pBufferAllocator;
         m_bOwnBufferAllocator = false;
+        m_nOptions            = pSysMemParams->nOptions;
+        m_nNumaNode           = pSysMemParams->nNumaNode;
     }
 
     // if buffer allocator wasn't passed from application create own
@@ -47,6 +131,12 @@ mfxStatus SysMemFrameAllocator::Init(mfxAllocatorParams* pParams) {
 mfxStatus SysMemFrameAllocator::Close() {
     mfxStatus sts = BaseFrameAllocator::Close();
 
+    for (auto& regions : m_regions) {
+        for (auto& region : regions.second)
+            FreeRegion(region);
+    }
+    m_regions.clear();
+
     if (m_bOwnBufferAllocator) {
         delete m_pBufferAllocator;
         m_pBufferAllocator = 0;
@@ -78,7 +168,7 @@ mfxStatus SysMemFrameAllocator::LockFrame(mfxMemId mid, mfxFrameData* ptr) {
 
     mfxU16 Width2  = (mfxU16)MSDK_ALIGN32(fs->info.Width);
     mfxU16 Height2 = (mfxU16)MSDK_ALIGN32(fs->info.Height);
-    ptr->B = ptr->Y = (mfxU8*)fs + MSDK_ALIGN32(sizeof(sFrame));
+    ptr->B = ptr->Y = (mfxU8*)fs + fs->offset;
 
     switch (fs->info.FourCC) {
         case MFX_FOURCC_NV12:
@@ -356,26 +446,18 @@ mfxStatus SysMemFrameAllocator::ReallocImpl(mfxMemId mid,
     if (!pmid)
         return MFX_ERR_MEMORY_ALLOC;
 
-    mfxStatus sts = m_pBufferAllocator->Free(m_pBufferAllocator->pthis, *pmid);
-    if (MFX_ERR_NONE != sts)
-        return sts;
-
-    sts = m_pBufferAllocator->Alloc(m_pBufferAllocator->pthis,
-                                    MSDK_ALIGN32(nbytes) + MSDK_ALIGN32(sizeof(sFrame)),
-                                    MFX_MEMTYPE_SYSTEM_MEMORY,
-                                    pmid);
-    if (MFX_ERR_NONE != sts)
-        return sts;
+    // frame of a region is released with the region, the new one gets own buffer
+    if (!IsRegionMid(*pmid)) {
+        mfxStatus sts = m_pBufferAllocator->Free(m_pBufferAllocator->pthis, *pmid);
+        if (MFX_ERR_NONE != sts)
+            return sts;
+    }
 
-    sFrame* fs;
-    sts = m_pBufferAllocator->Lock(m_pBufferAllocator->pthis, *pmid, (mfxU8**)&fs);
+    mfxStatus sts =
+        AllocBufferFrame(*info, MSDK_ALIGN32(nbytes), MFX_MEMTYPE_SYSTEM_MEMORY, pmid);
     if (MFX_ERR_NONE != sts)
         return sts;
 
-    fs->id   = ID_FRAME;
-    fs->info = *info;
-    m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, *pmid);
-
     *midOut = *pmid;
     return MFX_ERR_NONE;
 }
@@ -393,27 +475,15 @@ mfxStatus SysMemFrameAllocator::AllocImpl(mfxFrameAllocRequest* request,
     if (!nbytes)
         return MFX_ERR_UNSUPPORTED;
 
+    if (m_bOwnBufferAllocator && (m_nOptions & SYSMEM_ALLOC_PAGE_OPTIONS))
+        return AllocRegionFrames(request, nbytes, response);
+
     std::unique_ptr<mfxMemId[]> mids(new mfxMemId[request->NumFrameSuggested]);
 
     // allocate frames
     for (numAllocated = 0; numAllocated < request->NumFrameSuggested; numAllocated++) {
-        mfxStatus sts = m_pBufferAllocator->Alloc(m_pBufferAllocator->pthis,
-                                                  nbytes + MSDK_ALIGN32(sizeof(sFrame)),
-                                                  request->Type,
-                                                  &(mids[numAllocated]));
-
-        if (MFX_ERR_NONE != sts)
-            break;
-
-        sFrame* fs;
-        sts = m_pBufferAllocator->Lock(m_pBufferAllocator->pthis, mids[numAllocated], (mfxU8**)&fs);
-
-        if (MFX_ERR_NONE != sts)
-            break;
-
-        fs->id   = ID_FRAME;
-        fs->info = request->Info;
-        sts      = m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mids[numAllocated]);
+        mfxStatus sts =
+            AllocBufferFrame(request->Info, nbytes, request->Type, &(mids[numAllocated]));
 
         if (MFX_ERR_NONE != sts)
             break;
@@ -440,8 +510,12 @@ mfxStatus SysMemFrameAllocator::ReleaseResponse(mfxFrameAllocResponse* response)
 
     mfxStatus sts = MFX_ERR_NONE;
 
+    auto regions = m_regions.find(response->mids);
     if (response->mids) {
         for (mfxU32 i = 0; i < response->NumFrameActual; i++) {
+            // frames of regions are released with the regions
+            if (regions != m_regions.end() && IsInRegions(regions->second, response->mids[i]))
+                continue;
             if (response->mids[i]) {
                 sts = m_pBufferAllocator->Free(m_pBufferAllocator->pthis, response->mids[i]);
                 if (MFX_ERR_NONE != sts)
@@ -449,6 +523,11 @@ mfxStatus SysMemFrameAllocator::ReleaseResponse(mfxFrameAllocResponse* response)
             }
         }
     }
+    if (regions != m_regions.end()) {
+        for (auto& region : regions->second)
+            FreeRegion(region);
+        m_regions.erase(regions);
+    }
 
     m_vResp.erase(std::remove(m_vResp.begin(), m_vResp.end(), response), m_vResp.end());
     delete[] response->mids;
@@ -457,6 +536,197 @@ mfxStatus SysMemFrameAllocator::ReleaseResponse(mfxFrameAllocResponse* response)
     return sts;
 }
 
+mfxU32 SysMemFrameAllocator::GetAlignment() const {
+    if (m_nOptions & SYSMEM_ALLOC_ALIGN4K)
+        return 4096;
+    if (m_nOptions & SYSMEM_ALLOC_ALIGN64)
+        return 64;
+    return 32;
+}
+
+mfxStatus SysMemFrameAllocator::InitFrameHeader(mfxMemId mid, const mfxFrameInfo& info) {
+    sFrame* fs;
+    mfxStatus sts = m_pBufferAllocator->Lock(m_pBufferAllocator->pthis, mid, (mfxU8**)&fs);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    mfxU8* data = (mfxU8*)AlignUp((size_t)fs + MSDK_ALIGN32(sizeof(sFrame)), GetAlignment());
+
+    fs->id     = ID_FRAME;
+    fs->offset = (mfxU32)(data - (mfxU8*)fs);
+    fs->info   = info;
+    return m_pBufferAllocator->Unlock(m_pBufferAllocator->pthis, mid);
+}
+
+mfxStatus SysMemFrameAllocator::AllocBufferFrame(const mfxFrameInfo& info,
+                                                 mfxU32 nbytes,
+                                                 mfxU16 type,
+                                                 mfxMemId* mid) {
+    // buffers are 32 bytes aligned, larger alignment needs space to move the data
+    mfxU32 alignment = GetAlignment();
+    mfxU32 slack     = (alignment > 32) ? alignment : 0;
+
+    mfxStatus sts = m_pBufferAllocator->Alloc(m_pBufferAllocator->pthis,
+                                              nbytes + MSDK_ALIGN32(sizeof(sFrame)) + slack,
+                                              type,
+                                              mid);
+    if (MFX_ERR_NONE != sts)
+        return sts;
+
+    return InitFrameHeader(*mid, info);
+}
+
+mfxStatus SysMemFrameAllocator::AllocRegion(size_t size, Region& region) {
+    memset(&region, 0, sizeof(region));
+
+#if defined(__linux__)
+    if (m_nOptions & (SYSMEM_ALLOC_THP | SYSMEM_ALLOC_HUGETLB | SYSMEM_ALLOC_NUMA)) {
+        bool hugePages  = (m_nOptions & (SYSMEM_ALLOC_THP | SYSMEM_ALLOC_HUGETLB)) != 0;
+        size_t pageSize = hugePages ? HUGE_PAGE_SIZE : SMALL_PAGE_SIZE;
+        size_t mapSize  = AlignUp(size, pageSize);
+        void* ptr       = MAP_FAILED;
+
+    #ifdef MAP_HUGETLB
+        if (m_nOptions & SYSMEM_ALLOC_HUGETLB) {
+            ptr = mmap(NULL,
+                       mapSize,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                       -1,
+                       0);
+        }
+    #endif
+        if (ptr == MAP_FAILED) {
+            // huge page aligned range is cut out of a larger mapping, so THP can back all of it
+            size_t extra = hugePages ? HUGE_PAGE_SIZE : 0;
+            mfxU8* raw   = (mfxU8*)mmap(NULL,
+                                      mapSize + extra,
+                                      PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS,
+                                      -1,
+                                      0);
+            if ((void*)raw == MAP_FAILED)
+                return MFX_ERR_MEMORY_ALLOC;
+
+            mfxU8* aligned = (mfxU8*)AlignUp((size_t)raw, pageSize);
+            if (aligned > raw)
+                munmap(raw, aligned - raw);
+            if (raw + extra > aligned)
+                munmap(aligned + mapSize, raw + extra - aligned);
+            ptr = aligned;
+    #ifdef MADV_HUGEPAGE
+            if (hugePages)
+                madvise(ptr, mapSize, MADV_HUGEPAGE);
+    #endif
+        }
+
+        if (m_nOptions & SYSMEM_ALLOC_NUMA)
+            BindToNode(ptr, mapSize, m_nNumaNode);
+
+        // pages are faulted in now, on the chosen node, instead of in the processing loop
+        for (size_t offset = 0; offset < mapSize; offset += SMALL_PAGE_SIZE)
+            ((volatile mfxU8*)ptr)[offset] = 0;
+
+        region.base   = (mfxU8*)ptr;
+        region.size   = mapSize;
+        region.mapped = true;
+        return MFX_ERR_NONE;
+    }
+#endif
+
+    region.base = (mfxU8*)calloc(size, 1);
+    if (!region.base)
+        return MFX_ERR_MEMORY_ALLOC;
+    region.size = size;
+    return MFX_ERR_NONE;
+}
+
+void SysMemFrameAllocator::FreeRegion(Region& region) {
+#if defined(__linux__)
+    if (region.mapped) {
+        munmap(region.base, region.size);
+        region.base = NULL;
+        return;
+    }
+#endif
+    free(region.base);
+    region.base = NULL;
+}
+
+bool SysMemFrameAllocator::IsInRegions(const std::vector<Region>& regions, mfxMemId mid) {
+    for (const auto& region : regions) {
+        if ((mfxU8*)mid >= region.base && (mfxU8*)mid < region.base + region.size)
+            return true;
+    }
+    return false;
+}
+
+bool SysMemFrameAllocator::IsRegionMid(mfxMemId mid) {
+    for (const auto& regions : m_regions) {
+        if (IsInRegions(regions.second, mid))
+            return true;
+    }
+    return false;
+}
+
+mfxStatus SysMemFrameAllocator::AllocRegionFrames(mfxFrameAllocRequest* request,
+                                                  mfxU32 nbytes,
+                                                  mfxFrameAllocResponse* response) {
+    mfxU32 numFrames = request->NumFrameSuggested;
+    if (!numFrames)
+        return MFX_ERR_MEMORY_ALLOC;
+
+    // frame is a buffer of the own buffer allocator, so it's locked the same way,
+    // slack covers alignment of the buffer data and of the frame data
+    mfxU32 alignment = GetAlignment();
+    size_t frameSize = AlignUp(MSDK_ALIGN32(sizeof(sBuffer)) + MSDK_ALIGN32(sizeof(sFrame)) +
+                                   32 + alignment + nbytes,
+                               alignment);
+    bool slab        = (m_nOptions & SYSMEM_ALLOC_SLAB) != 0;
+
+    std::vector<Region> regions;
+    std::unique_ptr<mfxMemId[]> mids(new mfxMemId[numFrames]);
+    mfxStatus sts = MFX_ERR_NONE;
+
+    for (mfxU32 i = 0; i < numFrames; i++) {
+        mfxU8* frame = NULL;
+        if (slab && i) {
+            frame = regions[0].base + i * frameSize;
+        }
+        else {
+            Region region;
+            sts = AllocRegion(slab ? frameSize * numFrames : frameSize, region);
+            if (MFX_ERR_NONE != sts)
+                break;
+            regions.push_back(region);
+            frame = region.base;
+        }
+
+        sBuffer* bs = (sBuffer*)frame;
+        bs->id      = ID_BUFFER;
+        bs->type    = request->Type;
+        bs->nbytes  = (mfxU32)(frameSize - MSDK_ALIGN32(sizeof(sBuffer)));
+        mids[i]     = (mfxMemId)bs;
+
+        sts = InitFrameHeader(mids[i], request->Info);
+        if (MFX_ERR_NONE != sts)
+            break;
+    }
+
+    if (MFX_ERR_NONE != sts) {
+        for (auto& region : regions)
+            FreeRegion(region);
+        return MFX_ERR_MEMORY_ALLOC;
+    }
+
+    response->NumFrameActual = (mfxU16)numFrames;
+    response->mids           = mids.release();
+
+    m_regions[response->mids] = regions;
+    m_vResp.push_back(response);
+    return MFX_ERR_NONE;
+}
+
 SysMemBufferAllocator::SysMemBufferAllocator() {}
 
 SysMemBufferAllocator::~SysMemBufferAllocator() {}
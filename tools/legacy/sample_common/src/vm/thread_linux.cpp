@@ -319,4 +319,72 @@ mfxU32 msdk_get_current_pid() {
     return syscall(SYS_getpid);
 }
 
+/* ****************************************************************************** */
+
+mfxStatus msdk_thread_set_affinity(const std::vector<mfxU32>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (mfxU32 cpu : cpus) {
+        if (cpu >= CPU_SETSIZE)
+            return MFX_ERR_UNSUPPORTED;
+        CPU_SET(cpu, &set);
+    }
+    // pid 0 is the calling thread, not the whole process
+    return sched_setaffinity(0, sizeof(set), &set) ? MFX_ERR_UNSUPPORTED : MFX_ERR_NONE;
+}
+
+mfxStatus msdk_thread_get_affinity(std::vector<mfxU32>& cpus) {
+    cpus.clear();
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set))
+        return MFX_ERR_UNKNOWN;
+
+    for (mfxU32 cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+    return MFX_ERR_NONE;
+}
+
+// Reads list of processors or nodes from sysfs, like "0-3,8\n"
+static mfxStatus msdk_read_sysfs_list(const char* path, std::vector<mfxU32>& list) {
+    list.clear();
+
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return MFX_ERR_NOT_FOUND;
+
+    char buffer[4096] = {};
+    size_t size       = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    while (size && (buffer[size - 1] == '\n' || buffer[size - 1] == ' '))
+        buffer[--size] = 0;
+
+    return msdk_parse_cpu_list(buffer, list);
+}
+
+mfxU32 msdk_get_numa_node_count() {
+    std::vector<mfxU32> nodes;
+    if (MFX_ERR_NONE != msdk_read_sysfs_list("/sys/devices/system/node/online", nodes))
+        return 1;
+    return nodes.back() + 1;
+}
+
+mfxStatus msdk_get_numa_node_cpus(mfxU32 node, std::vector<mfxU32>& cpus) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+    mfxStatus sts = msdk_read_sysfs_list(path, cpus);
+
+    // kernel without NUMA support: single node of all processors
+    if (MFX_ERR_NOT_FOUND == sts && 0 == node && 1 == msdk_get_numa_node_count()) {
+        long count = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < count; cpu++)
+            cpus.push_back((mfxU32)cpu);
+        sts = cpus.empty() ? MFX_ERR_NOT_FOUND : MFX_ERR_NONE;
+    }
+    return sts;
+}
+
 #endif // #if !defined(_WIN32) && !defined(_WIN64)
@@ -127,4 +127,53 @@ mfxU32 msdk_get_current_pid() {
     return GetCurrentProcessId();
 }
 
+// Processors of the first processor group only
+static void msdk_mask_to_cpus(ULONGLONG mask, std::vector<mfxU32>& cpus) {
+    cpus.clear();
+    for (mfxU32 cpu = 0; cpu < 8 * sizeof(mask); cpu++) {
+        if (mask & (1ULL << cpu))
+            cpus.push_back(cpu);
+    }
+}
+
+mfxStatus msdk_thread_set_affinity(const std::vector<mfxU32>& cpus) {
+    DWORD_PTR mask = 0;
+    for (mfxU32 cpu : cpus) {
+        if (cpu >= 8 * sizeof(DWORD_PTR))
+            return MFX_ERR_UNSUPPORTED;
+        mask |= (DWORD_PTR)1 << cpu;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), mask) ? MFX_ERR_NONE : MFX_ERR_UNSUPPORTED;
+}
+
+mfxStatus msdk_thread_get_affinity(std::vector<mfxU32>& cpus) {
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        return MFX_ERR_UNKNOWN;
+
+    // there is no query of the thread mask, setting returns the previous one
+    DWORD_PTR threadMask = SetThreadAffinityMask(GetCurrentThread(), processMask);
+    if (threadMask)
+        SetThreadAffinityMask(GetCurrentThread(), threadMask);
+    else
+        threadMask = processMask;
+
+    msdk_mask_to_cpus(threadMask, cpus);
+    return MFX_ERR_NONE;
+}
+
+mfxU32 msdk_get_numa_node_count() {
+    ULONG highest = 0;
+    return GetNumaHighestNodeNumber(&highest) ? highest + 1 : 1;
+}
+
+mfxStatus msdk_get_numa_node_cpus(mfxU32 node, std::vector<mfxU32>& cpus) {
+    ULONGLONG mask = 0;
+    if (node > 0xff || !GetNumaNodeProcessorMask((UCHAR)node, &mask))
+        return MFX_ERR_NOT_FOUND;
+
+    msdk_mask_to_cpus(mask, cpus);
+    return cpus.empty() ? MFX_ERR_NOT_FOUND : MFX_ERR_NONE;
+}
+
 #endif // #if defined(_WIN32) || defined(_WIN64)
@@ -91,8 +91,14 @@ struct sInputParams {
     mfxU32 fourcc;
     mfxU16 chromaType;
     mfxU32 nFrames;
+    bool bFrameRange; // decode only a range of the input frames
+    mfxU32 nRangeFirst; // the range starts at the key frame at or before this frame
+    mfxU32 nRangeCount; // number of frames in the range, 0 - till the end of stream
+    bool bPersistIndex; // keep the index of the input frames in '<input>.idx'
     mfxU16 eDeinterlace;
     bool outI420;
+    bool bAsyncWrite; // write output file from a dedicated I/O thread
+    bool bDirectIO; // use O_DIRECT for the asynchronous output
 
     bool bPerfMode;
     bool bRenderWin;
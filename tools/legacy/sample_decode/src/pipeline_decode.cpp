@@ -359,6 +359,14 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
     sts                 = m_FileReader->Init(pParams->strSrcFile);
     MSDK_CHECK_STATUS(sts, "m_FileReader->Init failed");
 
+    // Range is read by the index of the access units, so decoding starts at a key frame
+    if (pParams->bFrameRange) {
+        sts = m_FileReader->InitIndex(pParams->videoType, pParams->bPersistIndex);
+        MSDK_CHECK_STATUS(sts, "m_FileReader->InitIndex failed");
+        sts = m_FileReader->SetFrameRange(pParams->nRangeFirst, pParams->nRangeCount);
+        MSDK_CHECK_STATUS(sts, "m_FileReader->SetFrameRange failed");
+    }
+
     mfxInitParamlWrap initPar;
 
 #if (MFX_VERSION >= 2000)
@@ -640,6 +648,7 @@ mfxStatus CDecodingPipeline::Init(sInputParams* pParams) {
 
     if (m_eWorkMode == MODE_FILE_DUMP) {
         // prepare YUV file writer
+        m_FileWriter.SetAsyncWrite(pParams->bAsyncWrite, pParams->bDirectIO);
         sts = m_FileWriter.Init(pParams->strDstFile, pParams->numViews);
         MSDK_CHECK_STATUS(sts, "m_FileWriter.Init failed");
     }
@@ -107,6 +107,11 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage) {
     msdk_printf(
         MSDK_STRING("   [-y416] - pipeline output format: Y416, output file format: Y416\n"));
 #endif
+    msdk_printf(MSDK_STRING("Output file parameters:\n"));
+    msdk_printf(
+        MSDK_STRING("   [-async_write] - write output file from a dedicated I/O thread\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-direct_write] - same as -async_write, bypass page cache (O_DIRECT) if supported\n"));
     msdk_printf(MSDK_STRING("\n"));
 #if D3D_SURFACES_SUPPORT
     msdk_printf(MSDK_STRING("   [-d3d]                    - work with d3d9 surfaces\n"));
@@ -155,6 +160,10 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage) {
     msdk_printf(MSDK_STRING(
         "   [-robust:soft]            - GPU hang recovery by inserting an IDR frame\n"));
     msdk_printf(MSDK_STRING("   [-timeout]                - timeout in seconds\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-frame_range first count] - decode count frames (0 - till the end) starting from the key frame at or before frame first (in decode order), for H.264, H.265 and IVF input. Key frames have to be preceded by the parameter sets\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-persist_index]          - with -frame_range keep the index of the input frames in <input>.idx and reuse it in the next runs\n"));
 #if MFX_VERSION >= 1022
     msdk_printf(
         MSDK_STRING("   [-dec_postproc force/auto] - resize after decoder using direct pipe\n"));
@@ -566,6 +575,21 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-frame_range"))) {
+            if (i + 2 >= nArgNum) {
+                PrintHelp(strInput[0], MSDK_STRING("Not enough parameters for -frame_range key"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nRangeFirst) ||
+                MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nRangeCount)) {
+                PrintHelp(strInput[0], MSDK_STRING("frame range is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            pParams->bFrameRange = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-persist_index"))) {
+            pParams->bPersistIndex = true;
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-adapterNum"))) {
             if (i + 1 >= nArgNum) {
                 PrintHelp(strInput[0], MSDK_STRING("Not enough parameters for -adapterNum key"));
@@ -586,6 +610,13 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
             pParams->fourcc  = MFX_FOURCC_NV12;
             pParams->outI420 = true;
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-async_write"))) {
+            pParams->bAsyncWrite = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-direct_write"))) {
+            pParams->bAsyncWrite = true;
+            pParams->bDirectIO   = true;
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-nv12"))) {
             pParams->fourcc = MFX_FOURCC_NV12;
         }
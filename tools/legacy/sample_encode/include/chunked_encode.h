@@ -0,0 +1,69 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __CHUNKED_ENCODE_H__
+#define __CHUNKED_ENCODE_H__
+
+#include <memory>
+#include <vector>
+
+#include "nal_scanner.h"
+#include "pipeline_encode.h"
+
+// Encodes the input file in chunks at once, a session per chunk, and joins their
+// H.264/HEVC elementary streams into the output file. Chunks start where a single
+// session would put an IDR frame, or an I frame if only the first frame is IDR, so
+// the joined stream is decodable as the one of a single session.
+// Chunk encodes 'overlap' frames before its first frame to bring the BRC to the
+// state it would have there, these frames start with an IDR of their own and are
+// dropped from the output. HRD buffer isn't carried over the chunk boundaries,
+// so HRD conformance of the joined stream isn't guaranteed.
+class CChunkedEncoder {
+public:
+    CChunkedEncoder();
+    virtual ~CChunkedEncoder();
+
+    virtual mfxStatus Init(const sInputParams& params);
+    virtual mfxStatus Run();
+    // Closes the sessions and removes the streams of the chunks
+    virtual void Close();
+    virtual void PrintInfo();
+
+protected:
+    struct Chunk {
+        Chunk() : firstFrame(0), numFrames(0), overlap(0), fileName(), params(), pipeline() {}
+
+        mfxU32 firstFrame; // first frame of the chunk in the input
+        mfxU32 numFrames;
+        mfxU32 overlap; // frames encoded before the first frame, not in the output
+        msdk_string fileName; // elementary stream of the chunk
+        sInputParams params;
+        std::unique_ptr<CEncodingPipeline> pipeline;
+    };
+
+    // Number of frames in the input file
+    mfxStatus GetNumInputFrames(const sInputParams& params, mfxU32& numFrames);
+    // Distance between IDR frames of the encoding by a single session, without -g the
+    // GOP of the library is taken from a session initialized with the parameters
+    mfxStatus GetIdrPeriod(const sInputParams& params, mfxU32& idrPeriod);
+    // Appends the stream of the chunk without its overlap to the output
+    mfxStatus AppendChunk(FILE* output, const Chunk& chunk);
+
+    NalStreamType m_streamType;
+    msdk_string m_outputName;
+    bool m_bHrd; // the encoder keeps HRD conformance, which chunks break
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+
+private:
+    CChunkedEncoder(const CChunkedEncoder&);
+    void operator=(const CChunkedEncoder&);
+};
+
+// Returns offset of access unit 'index' (in decoding order) of Annex-B H.264/HEVC
+// stream in the file, it has to be an IDR with parameter sets before it
+mfxStatus FindIdrAccessUnit(FILE* file, NalStreamType type, mfxU32 index, mfxI64& offset);
+
+#endif //__CHUNKED_ENCODE_H__
@@ -38,6 +38,7 @@
 #endif
 
 #include "preset_manager.h"
+#include "quality_meter.h"
 
 #if defined(ENABLE_V4L2_SUPPORT)
     #include "v4l2_util.h"
@@ -178,6 +179,19 @@ struct sInputParams {
 
     mfxU32 nTimeout;
     mfxU16 nPerfOpt; // size of pre-load buffer which used for loop encode
+    bool bPerfMmap; // pre-load buffer points to the memory mapped input file
+    mfxU32 nReadBatch; // number of input frames read at once, 0 - frame by frame
+    bool bReadInPlace; // read input frames straight to the surface planes
+    bool bAsyncWrite; // write output file from a dedicated I/O thread
+    bool bDirectIO; // use O_DIRECT for the asynchronous output
+    mfxU32 nSysMemOptions; // SysMemAllocatorOptions of system memory frames
+    mfxU32 nQualityMetrics; // QualityMetricsFlags measured by decoding the output in-process
+    mfxU32 nMetricsThreads; // 0 - all logical processors
+    msdk_char strMetricsLog[MSDK_MAX_FILENAME_LEN]; // quality statistics are appended to it
+    mfxU32 nFirstFrame; // input frames before it are skipped
+    mfxU32 nIdrFrame; // frame counted from nFirstFrame forced to be IDR, 0 - none
+    mfxU16 nChunks; // number of chunks of the input encoded at once, see CChunkedEncoder
+    mfxU32 nChunkOverlap; // frames encoded before a chunk to warm up its BRC
 
     mfxU16 nNumSlice;
     bool UseRegionEncode;
@@ -308,6 +322,10 @@ public:
     virtual void Close();
     virtual void SetGpuHangRecoveryFlag();
     virtual void ClearTasks();
+    // Written bitstreams are passed to the meter as well
+    virtual void SetQualityMeter(CEncodeQualityMeter* pMeter) {
+        m_pQualityMeter = pMeter;
+    }
 
 protected:
     sTask* m_pTasks;
@@ -317,6 +335,7 @@ protected:
     bool m_bGpuHangRecovery;
 
     MFXVideoSession* m_pmfxSession;
+    CEncodeQualityMeter* m_pQualityMeter;
 
     CTimeStatistics m_statOverall;
     CTimeStatistics m_statFile;
@@ -350,6 +369,10 @@ public:
     virtual mfxStatus OpenRoundingOffsetFile(sInputParams* pInParams);
     mfxStatus InitEncFrameParams(sTask* pTask);
     mfxU32 GetProcessedFramesNum();
+    // Parameters of the initialized encoder as completed by the library
+    const mfxInfoMFX& GetEncodeInfo() const {
+        return m_mfxEncParams.mfx;
+    }
 #if (MFX_VERSION >= 2000)
     mfxU32 GetSurfaceSize(mfxU32 FourCC, mfxU32 width, mfxU32 height);
     mfxF64 GetElapsedTime() {
@@ -403,10 +426,15 @@ protected:
     mfxAllocatorParams* m_pmfxAllocatorParams;
     MemType m_memType;
     mfxU16 m_nPerfOpt; // size of pre-load buffer which used for loop encode
+    bool m_bPerfMmap; // pre-load buffer points to the memory mapped input file
+    mfxU16 m_nMappedSurfNum; // input surfaces pointing to the mapped file, not allocated
+    mfxU32 m_nSysMemOptions; // SysMemAllocatorOptions of system memory frames
     bool m_bExternalAlloc; // use memory allocator as external for Media SDK
 
     mfxFrameSurface1* m_pEncSurfaces; // frames array for encoder input (vpp output)
     mfxFrameSurface1* m_pVppSurfaces; // frames array for vpp input
+    mfxU16 m_nEncSurfNum; // size of m_pEncSurfaces
+    mfxU16 m_nVppSurfNum; // size of m_pVppSurfaces
     mfxFrameAllocResponse m_EncResponse; // memory allocation response for encoder
     mfxFrameAllocResponse m_VppResponse; // memory allocation response for vpp
     mfxFrameAllocResponse m_PreEncResponse; // memory allocation response for preenc
@@ -436,16 +464,22 @@ protected:
     mfxU32 m_nFramesRead;
     bool m_bCutOutput;
     bool m_bInsertIDR;
+    mfxU32 m_nIdrFrame; // read frame forced to be IDR, 0 - none
     bool m_bTimeOutExceed;
     mfxU16 m_nEncSurfIdx; // index of free surface for encoder input (vpp output)
     mfxU16 m_nVppSurfIdx; // index of free surface for vpp input
 
     bool m_bIsFieldSplitting;
     bool m_bSingleTexture;
+    bool m_bAsyncWrite; // output writers use CAsyncFileWriter
+    bool m_bDirectIO;
 
     CTimeStatisticsReal m_statOverall;
     CTimeStatisticsReal m_statFile;
 
+    std::unique_ptr<CEncodeQualityMeter> m_pQualityMeter;
+    msdk_string m_strMetricsLog;
+
 #if (defined(_WIN64) || defined(_WIN32)) && (MFX_VERSION >= 1031)
     mfxU32 GetPreferredAdapterNum(const mfxAdaptersInfo& adapters, const sInputParams& params);
 #endif
@@ -505,6 +539,8 @@ protected:
                                   ExtendedSurface& Out,
                                   const bool& skipFrame);
     virtual mfxStatus EncodeOneFrame(const ExtendedSurface& In, sTask*& pTask);
+    virtual mfxStatus InitQualityMeter(sInputParams* pParams);
+    virtual mfxStatus AddQualityReference(const ExtendedSurface& In, sTask* pTask);
 
     virtual mfxStatus GetFreeTask(sTask** ppTask);
     virtual MFXVideoSession& GetFirstSession() {
@@ -0,0 +1,363 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "chunked_encode.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "raw_frame_layout.h"
+
+namespace {
+// Portion of a chunk stream read at once while it's searched or copied
+const size_t FILE_BLOCK_SIZE = 1 << 20;
+
+bool IsVclNalUnit(NalStreamType type, mfxU32 nalType) {
+    if (NAL_STREAM_AVC == type)
+        return nalType >= 1 && nalType <= 5;
+    return nalType <= 31;
+}
+
+bool IsIdrNalUnit(NalStreamType type, mfxU32 nalType) {
+    if (NAL_STREAM_AVC == type)
+        return nalType == 5;
+    return nalType == 19 || nalType == 20; // IDR_W_RADL, IDR_N_LP
+}
+
+bool IsSpsNalUnit(NalStreamType type, mfxU32 nalType) {
+    return nalType == ((NAL_STREAM_AVC == type) ? 7u : 33u);
+}
+
+// NAL units which start an access unit when they follow slices of the previous one
+bool IsAccessUnitPrefix(NalStreamType type, mfxU32 nalType) {
+    if (NAL_STREAM_AVC == type)
+        return (nalType >= 6 && nalType <= 9) || (nalType >= 14 && nalType <= 18);
+    return (nalType >= 32 && nalType <= 35) || nalType == 39 || (nalType >= 41 && nalType <= 44) ||
+           (nalType >= 48 && nalType <= 55);
+}
+
+// Removes files on the exit from the scope, except the ones which are kept
+class CRemoveFilesGuard {
+public:
+    CRemoveFilesGuard() : m_names() {}
+    ~CRemoveFilesGuard() {
+        for (auto& name : m_names)
+            MSDK_REMOVE(name.c_str());
+    }
+
+    void Add(const msdk_string& name) {
+        m_names.push_back(name);
+    }
+    void Keep(const msdk_string& name) {
+        m_names.erase(std::remove(m_names.begin(), m_names.end(), name), m_names.end());
+    }
+
+private:
+    std::vector<msdk_string> m_names;
+
+    CRemoveFilesGuard(const CRemoveFilesGuard&);
+    void operator=(const CRemoveFilesGuard&);
+};
+} // namespace
+
+mfxStatus FindIdrAccessUnit(FILE* file, NalStreamType type, mfxU32 index, mfxI64& offset) {
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+    if (MSDK_FSEEK64(file, 0, SEEK_SET))
+        return MFX_ERR_UNKNOWN;
+
+    // first_mb_in_slice == 0 and first_slice_segment_in_pic_flag follow the header
+    const mfxU32 headerSize = (NAL_STREAM_AVC == type) ? 1 : 2;
+
+    std::vector<mfxU8> buffer;
+    mfxI64 bufferOffset = 0; // of the buffer in the file
+    mfxI64 auIndex      = -1; // of the access unit the last NAL unit belongs to
+    bool auHasSlice     = false;
+    bool auHasSps       = false;
+    bool eof            = false;
+    CNalUnitIterator it(type);
+
+    while (!eof) {
+        size_t kept = buffer.size();
+        buffer.resize(kept + FILE_BLOCK_SIZE);
+        size_t read = fread(buffer.data() + kept, 1, FILE_BLOCK_SIZE, file);
+        buffer.resize(kept + read);
+        eof = read < FILE_BLOCK_SIZE;
+
+        it.Init(buffer.data(), buffer.size(), eof);
+        NalUnitInfo nal;
+        while (it.GetNext(nal)) {
+            bool firstSlice = IsVclNalUnit(type, nal.type) && nal.size > headerSize &&
+                              (nal.data[headerSize] & 0x80);
+
+            if ((firstSlice || IsAccessUnitPrefix(type, nal.type)) && (auHasSlice || auIndex < 0)) {
+                auIndex++;
+                auHasSlice = false;
+                auHasSps   = false;
+                // position of 00 00 01
+                if (auIndex == (mfxI64)index)
+                    offset = bufferOffset + (nal.data - buffer.data()) - 3;
+            }
+            if (IsSpsNalUnit(type, nal.type))
+                auHasSps = true;
+            if (firstSlice) {
+                auHasSlice = true;
+                if (auIndex == (mfxI64)index)
+                    return (IsIdrNalUnit(type, nal.type) && auHasSps) ? MFX_ERR_NONE
+                                                                      : MFX_ERR_UNSUPPORTED;
+            }
+        }
+
+        // incomplete NAL unit is searched again with the next block
+        size_t consumed = buffer.size() - it.GetRemainderSize();
+        buffer.erase(buffer.begin(), buffer.begin() + consumed);
+        bufferOffset += consumed;
+    }
+    return MFX_ERR_NOT_FOUND;
+}
+
+CChunkedEncoder::CChunkedEncoder()
+        : m_streamType(NAL_STREAM_AVC),
+          m_outputName(),
+          m_bHrd(false),
+          m_chunks() {}
+
+CChunkedEncoder::~CChunkedEncoder() {
+    Close();
+}
+
+mfxStatus CChunkedEncoder::Init(const sInputParams& params) {
+    Close();
+
+    if (params.nChunks < 1 || params.dstFileBuff.size() != 1 || params.InputFiles.size() != 1 ||
+        (MFX_CODEC_AVC != params.CodecId && MFX_CODEC_HEVC != params.CodecId))
+        return MFX_ERR_UNSUPPORTED;
+
+    m_streamType = (MFX_CODEC_HEVC == params.CodecId) ? NAL_STREAM_HEVC : NAL_STREAM_AVC;
+    m_outputName = params.dstFileBuff[0];
+
+    mfxStatus sts    = MFX_ERR_NONE;
+    mfxU32 numFrames = params.nNumFrames;
+    if (!numFrames) {
+        sts = GetNumInputFrames(params, numFrames);
+        MSDK_CHECK_STATUS(sts, "GetNumInputFrames failed");
+    }
+
+    mfxU32 idrPeriod = 0;
+    sts              = GetIdrPeriod(params, idrPeriod);
+    MSDK_CHECK_STATUS(sts, "GetIdrPeriod failed");
+
+    // chunks start at the IDR frames of the encoding by a single session
+    mfxU32 numIdrs   = (numFrames + idrPeriod - 1) / idrPeriod;
+    mfxU32 numChunks = std::min<mfxU32>(params.nChunks, numIdrs);
+
+    for (mfxU32 i = 0; i < numChunks; i++) {
+        m_chunks.emplace_back(new Chunk);
+        Chunk& chunk = *m_chunks.back();
+
+        mfxU32 end = (i + 1 == numChunks)
+                         ? numFrames
+                         : (mfxU32)((mfxU64)numIdrs * (i + 1) / numChunks) * idrPeriod;
+        chunk.firstFrame = (mfxU32)((mfxU64)numIdrs * i / numChunks) * idrPeriod;
+        chunk.numFrames  = end - chunk.firstFrame;
+        chunk.overlap    = std::min(params.nChunkOverlap, chunk.firstFrame);
+
+        msdk_stringstream name;
+        name << m_outputName << MSDK_STRING(".chunk") << i;
+        chunk.fileName = name.str();
+
+        chunk.params             = params;
+        chunk.params.nNumFrames  = chunk.overlap + chunk.numFrames;
+        chunk.params.nFirstFrame = chunk.firstFrame - chunk.overlap;
+        chunk.params.nIdrFrame   = chunk.overlap;
+        chunk.params.dstFileBuff.assign(1, &chunk.fileName[0]);
+
+        chunk.pipeline.reset(new CEncodingPipeline);
+        sts = chunk.pipeline->Init(&chunk.params);
+        MSDK_CHECK_STATUS(sts, "chunk.pipeline->Init failed");
+    }
+
+    // HRD buffer fullness of a chunk starts anew instead of following the previous one
+    mfxU16 rateControl = m_chunks[0]->pipeline->GetEncodeInfo().RateControlMethod;
+    m_bHrd = (MFX_RATECONTROL_CBR == rateControl || MFX_RATECONTROL_VBR == rateControl ||
+              MFX_RATECONTROL_LA_HRD == rateControl) &&
+             MFX_CODINGOPTION_OFF != params.nNalHrdConformance;
+
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CChunkedEncoder::GetIdrPeriod(const sInputParams& params, mfxU32& idrPeriod) {
+    mfxU32 gopSize     = params.nGopPicSize;
+    mfxU32 idrInterval = params.nIdrInterval;
+    if (!gopSize) {
+        sInputParams probeParams = params;
+        msdk_string probeName    = m_outputName + MSDK_STRING(".chunk0");
+        probeParams.dstFileBuff.assign(1, &probeName[0]);
+
+        CRemoveFilesGuard probeFile;
+        probeFile.Add(probeName);
+        CEncodingPipeline probe;
+        mfxStatus sts = probe.Init(&probeParams);
+        MSDK_CHECK_STATUS(sts, "probe.Init failed");
+        gopSize     = probe.GetEncodeInfo().GopPicSize;
+        idrInterval = probe.GetEncodeInfo().IdrInterval;
+        probe.Close();
+    }
+
+    if (!gopSize) {
+        msdk_printf(MSDK_STRING("error: GOP size of the encoder is unknown, set it by -g\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    // every (IdrInterval + 1)-th I frame is IDR in H.264, every IdrInterval-th in HEVC
+    // and only the first one if IdrInterval is 0, then chunks start at I frames
+    if (MFX_CODEC_AVC == params.CodecId)
+        idrPeriod = gopSize * (idrInterval + 1);
+    else
+        idrPeriod = gopSize * std::max<mfxU32>(idrInterval, 1);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CChunkedEncoder::Run() {
+    if (m_chunks.empty())
+        return MFX_ERR_NOT_INITIALIZED;
+
+    // streams of the chunks are temporary, the output is kept only if it's complete
+    CRemoveFilesGuard tempFiles;
+    for (auto& chunk : m_chunks)
+        tempFiles.Add(chunk->fileName);
+
+    msdk_tick startTime = msdk_time_get_tick();
+
+    std::vector<mfxStatus> results(m_chunks.size(), MFX_ERR_NONE);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        threads.emplace_back([this, i, &results] {
+            results[i] = m_chunks[i]->pipeline->Run();
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    mfxU32 numFrames = 0;
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        if (results[i] < MFX_ERR_NONE) {
+            msdk_printf(MSDK_STRING("error: encoding of chunk %d failed\n"), (int)i);
+            return results[i];
+        }
+        numFrames += m_chunks[i]->numFrames;
+        // streams of the chunks are complete after the writers are closed
+        m_chunks[i]->pipeline->Close();
+    }
+
+    FILE* output = NULL;
+    MSDK_FOPEN(output, m_outputName.c_str(), MSDK_STRING("wb"));
+    MSDK_CHECK_POINTER(output, MFX_ERR_NULL_PTR);
+    tempFiles.Add(m_outputName);
+
+    mfxStatus sts = MFX_ERR_NONE;
+    for (size_t i = 0; i < m_chunks.size() && MFX_ERR_NONE == sts; i++)
+        sts = AppendChunk(output, *m_chunks[i]);
+    if (fclose(output) && MFX_ERR_NONE == sts)
+        sts = MFX_ERR_UNKNOWN;
+    MSDK_CHECK_STATUS(sts, "AppendChunk failed");
+    tempFiles.Keep(m_outputName);
+
+    mfxF64 elapsed = (mfxF64)(msdk_time_get_tick() - startTime) / msdk_time_get_frequency();
+    msdk_printf(MSDK_STRING("Encoded %u frames in %d chunks, %.3f fps\n"),
+                numFrames,
+                (int)m_chunks.size(),
+                elapsed > 0 ? numFrames / elapsed : 0.0);
+
+    return MFX_ERR_NONE;
+}
+
+void CChunkedEncoder::Close() {
+    // writers of the sessions create the streams already at the initialization
+    CRemoveFilesGuard tempFiles;
+    for (auto& chunk : m_chunks) {
+        if (chunk->pipeline)
+            chunk->pipeline->Close();
+        tempFiles.Add(chunk->fileName);
+    }
+    m_chunks.clear();
+}
+
+void CChunkedEncoder::PrintInfo() {
+    if (m_chunks.empty())
+        return;
+
+    // sessions differ only in the frames they encode
+    m_chunks[0]->pipeline->PrintInfo();
+    if (m_bHrd)
+        msdk_printf(MSDK_STRING("WARNING: HRD buffer restarts at every chunk, the output may "
+                                "not conform to HRD, use -NalHrdConformance:off or a rate "
+                                "control without HRD to avoid it\n"));
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        msdk_printf(MSDK_STRING("Chunk %d: frames %u-%u, overlap %u\n"),
+                    (int)i,
+                    m_chunks[i]->firstFrame,
+                    m_chunks[i]->firstFrame + m_chunks[i]->numFrames - 1,
+                    m_chunks[i]->overlap);
+    }
+}
+
+mfxStatus CChunkedEncoder::GetNumInputFrames(const sInputParams& params, mfxU32& numFrames) {
+    RawFrameLayout layout;
+    if (!GetRawFrameLayout(params.FileInputFourCC, params.nWidth, params.nHeight, 0, layout))
+        return MFX_ERR_UNSUPPORTED;
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, params.InputFiles.front().c_str(), MSDK_STRING("rb"));
+    MSDK_CHECK_POINTER(file, MFX_ERR_NULL_PTR);
+
+    mfxI64 size = -1;
+    if (!MSDK_FSEEK64(file, 0, SEEK_END))
+        size = MSDK_FTELL64(file);
+    fclose(file);
+
+    if (size < (mfxI64)layout.size)
+        return MFX_ERR_MORE_DATA;
+
+    numFrames = (mfxU32)(size / layout.size);
+    return MFX_ERR_NONE;
+}
+
+mfxStatus CChunkedEncoder::AppendChunk(FILE* output, const Chunk& chunk) {
+    FILE* input = NULL;
+    MSDK_FOPEN(input, chunk.fileName.c_str(), MSDK_STRING("rb"));
+    MSDK_CHECK_POINTER(input, MFX_ERR_NULL_PTR);
+
+    mfxStatus sts = MFX_ERR_NONE;
+    mfxI64 offset = 0;
+    if (chunk.overlap) {
+        sts = FindIdrAccessUnit(input, m_streamType, chunk.overlap, offset);
+        if (MFX_ERR_NONE != sts)
+            msdk_printf(MSDK_STRING("error: IDR frame at frame %u of the input isn't found\n"),
+                        chunk.firstFrame);
+
+        // the first NAL unit of an access unit has 4-byte start code
+        static const mfxU8 zeroByte = 0;
+        if (MFX_ERR_NONE == sts && fwrite(&zeroByte, 1, 1, output) != 1)
+            sts = MFX_ERR_UNKNOWN;
+    }
+
+    if (MFX_ERR_NONE == sts && MSDK_FSEEK64(input, offset, SEEK_SET))
+        sts = MFX_ERR_UNKNOWN;
+
+    std::vector<mfxU8> block(FILE_BLOCK_SIZE);
+    while (MFX_ERR_NONE == sts) {
+        size_t read = fread(block.data(), 1, block.size(), input);
+        if (read && fwrite(block.data(), 1, read, output) != read)
+            sts = MFX_ERR_UNKNOWN;
+        if (read < block.size())
+            break;
+    }
+
+    fclose(input);
+    return sts;
+}
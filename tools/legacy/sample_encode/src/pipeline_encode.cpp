@@ -101,6 +101,7 @@ CEncTaskPool::CEncTaskPool() : m_statOverall(), m_statFile() {
     m_nTaskBufferStart = 0;
     m_nPoolSize        = 0;
     m_bGpuHangRecovery = false;
+    m_pQualityMeter    = NULL;
 }
 
 CEncTaskPool::~CEncTaskPool() {
@@ -216,6 +217,12 @@ mfxStatus CEncTaskPool::SynchronizeFirstTask() {
         MSDK_CHECK_STATUS_NO_RET(sts, "SyncOperation failed");
 
         if (MFX_ERR_NONE == sts) {
+            // writers consume the bitstream, so the meter has to see it first
+            if (m_pQualityMeter) {
+                sts = m_pQualityMeter->ProcessBitstream(m_pTasks[m_nTaskBufferStart].mfxBS);
+                MSDK_CHECK_STATUS(sts, "m_pQualityMeter->ProcessBitstream failed");
+            }
+
             m_statFile.StartTimeMeasurement();
             sts = m_pTasks[m_nTaskBufferStart].WriteBitstream();
             m_statFile.StopTimeMeasurement();
@@ -311,6 +318,7 @@ void CEncTaskPool::Close() {
     MSDK_SAFE_DELETE_ARRAY(m_pTasks);
 
     m_pmfxSession      = NULL;
+    m_pQualityMeter    = NULL;
     m_nTaskBufferStart = 0;
     m_nPoolSize        = 0;
 }
@@ -1069,8 +1077,22 @@ mfxStatus CEncodingPipeline::AllocFrames() {
     }
 #endif
 
+    // Perf mode surfaces of the input point to the frames of the memory mapped file,
+    // so the allocator provides memory for the rest of the input surfaces only
+    const mfxFrameInfo& inputInfo =
+        m_pmfxVPP ? m_mfxVppParams.vpp.In : m_mfxEncParams.mfx.FrameInfo;
+    m_nMappedSurfNum = 0;
+    if (m_nPerfOpt && m_bPerfMmap && m_memType == SYSTEM_MEMORY) {
+        if (m_FileReader.CanMapFrames(inputInfo))
+            m_nMappedSurfNum = m_nPerfOpt;
+        else
+            msdk_printf(MSDK_STRING("Input can't be memory mapped, frames are preloaded\n"));
+    }
+    mfxU16 nEncMappedNum = m_pmfxVPP ? 0 : m_nMappedSurfNum;
+    mfxU16 nVppMappedNum = m_pmfxVPP ? m_nMappedSurfNum : 0;
+
     // prepare allocation requests
-    EncRequest.NumFrameSuggested = EncRequest.NumFrameMin = nEncSurfNum;
+    EncRequest.NumFrameSuggested = EncRequest.NumFrameMin = nEncSurfNum - nEncMappedNum;
     MSDK_MEMCPY_VAR(EncRequest.Info, &(m_mfxEncParams.mfx.FrameInfo), sizeof(mfxFrameInfo));
     if (m_pmfxVPP) {
         EncRequest.Type |=
@@ -1078,12 +1100,16 @@ mfxStatus CEncodingPipeline::AllocFrames() {
     }
 
     // alloc frames for encoder
-    sts = m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &EncRequest, &m_EncResponse);
-    MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
+    MSDK_ZERO_MEMORY(m_EncResponse);
+    if (EncRequest.NumFrameSuggested) {
+        sts = m_pMFXAllocator->Alloc(m_pMFXAllocator->pthis, &EncRequest, &m_EncResponse);
+        MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
+    }
 
     // alloc frames for vpp if vpp is enabled
-    if (m_pmfxVPP) {
-        VppRequest[0].NumFrameSuggested = VppRequest[0].NumFrameMin = nVppSurfNum;
+    MSDK_ZERO_MEMORY(m_VppResponse);
+    if (m_pmfxVPP && nVppSurfNum > nVppMappedNum) {
+        VppRequest[0].NumFrameSuggested = VppRequest[0].NumFrameMin = nVppSurfNum - nVppMappedNum;
         MSDK_MEMCPY_VAR(VppRequest[0].Info, &(m_mfxVppParams.vpp.In), sizeof(mfxFrameInfo));
 
 #if defined(ENABLE_V4L2_SUPPORT)
@@ -1096,23 +1122,27 @@ mfxStatus CEncodingPipeline::AllocFrames() {
         MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Alloc failed");
     }
 
-    // prepare mfxFrameSurface1 array for encoder
-    m_pEncSurfaces = new mfxFrameSurface1[m_EncResponse.NumFrameActual];
+    // prepare mfxFrameSurface1 array for encoder, mapped surfaces go first
+    m_nEncSurfNum  = nEncMappedNum + m_EncResponse.NumFrameActual;
+    m_pEncSurfaces = new mfxFrameSurface1[m_nEncSurfNum];
     MSDK_CHECK_POINTER(m_pEncSurfaces, MFX_ERR_MEMORY_ALLOC);
 
-    for (int i = 0; i < m_EncResponse.NumFrameActual; i++) {
+    for (int i = 0; i < m_nEncSurfNum; i++) {
         memset(&(m_pEncSurfaces[i]), 0, sizeof(mfxFrameSurface1));
         MSDK_MEMCPY_VAR(m_pEncSurfaces[i].Info,
                         &(m_mfxEncParams.mfx.FrameInfo),
                         sizeof(mfxFrameInfo));
 
-        if (m_bExternalAlloc) {
-            m_pEncSurfaces[i].Data.MemId = m_EncResponse.mids[i];
+        if (i < nEncMappedNum) {
+            // data pointers are set by FillBuffers()
+        }
+        else if (m_bExternalAlloc) {
+            m_pEncSurfaces[i].Data.MemId = m_EncResponse.mids[i - nEncMappedNum];
         }
         else {
             // get YUV pointers
             sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis,
-                                        m_EncResponse.mids[i],
+                                        m_EncResponse.mids[i - nEncMappedNum],
                                         &(m_pEncSurfaces[i].Data));
             MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Lock failed");
         }
@@ -1120,21 +1150,25 @@ mfxStatus CEncodingPipeline::AllocFrames() {
 
     // prepare mfxFrameSurface1 array for vpp if vpp is enabled
     if (m_pmfxVPP) {
-        m_pVppSurfaces = new mfxFrameSurface1[m_VppResponse.NumFrameActual];
+        m_nVppSurfNum  = nVppMappedNum + m_VppResponse.NumFrameActual;
+        m_pVppSurfaces = new mfxFrameSurface1[m_nVppSurfNum];
         MSDK_CHECK_POINTER(m_pVppSurfaces, MFX_ERR_MEMORY_ALLOC);
 
-        for (int i = 0; i < m_VppResponse.NumFrameActual; i++) {
+        for (int i = 0; i < m_nVppSurfNum; i++) {
             MSDK_ZERO_MEMORY(m_pVppSurfaces[i]);
             MSDK_MEMCPY_VAR(m_pVppSurfaces[i].Info,
                             &(m_mfxVppParams.mfx.FrameInfo),
                             sizeof(mfxFrameInfo));
 
-            if (m_bExternalAlloc) {
-                m_pVppSurfaces[i].Data.MemId = m_VppResponse.mids[i];
+            if (i < nVppMappedNum) {
+                // data pointers are set by FillBuffers()
+            }
+            else if (m_bExternalAlloc) {
+                m_pVppSurfaces[i].Data.MemId = m_VppResponse.mids[i - nVppMappedNum];
             }
             else {
                 sts = m_pMFXAllocator->Lock(m_pMFXAllocator->pthis,
-                                            m_VppResponse.mids[i],
+                                            m_VppResponse.mids[i - nVppMappedNum],
                                             &(m_pVppSurfaces[i].Data));
                 MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Lock failed");
             }
@@ -1143,7 +1177,7 @@ mfxStatus CEncodingPipeline::AllocFrames() {
 #if (MFX_VERSION < 2000)
     // prepare Aux buffer for preenc
     if (m_pmfxPreENC) {
-        m_PreEncAuxPool.resize(m_EncResponse.NumFrameActual);
+        m_PreEncAuxPool.resize(m_nEncSurfNum);
         auto laCtrl = m_mfxPreEncParams.AddExtBuffer<mfxExtLAControl>();
 
         int buff_size = sizeof(mfxExtLAFrameStatistics) +
@@ -1175,7 +1209,7 @@ mfxStatus CEncodingPipeline::AllocFrames() {
 
     // prepare mfxEncodeCtrl array for encoder if qpfile mode is enabled
     if (m_bQPFileMode) {
-        m_EncCtrls.resize(m_EncResponse.NumFrameActual);
+        m_EncCtrls.resize(m_nEncSurfNum);
         for (auto& ctrl : m_EncCtrls) {
             ctrl.Payload    = m_UserDataUnregSEI.data();
             ctrl.NumPayload = (mfxU16)m_UserDataUnregSEI.size();
@@ -1300,6 +1334,13 @@ mfxStatus CEncodingPipeline::CreateAllocator() {
         m_pMFXAllocator = new SysMemFrameAllocator;
         MSDK_CHECK_POINTER(m_pMFXAllocator, MFX_ERR_MEMORY_ALLOC);
 
+        if (m_nSysMemOptions) {
+            SysMemAllocatorParams* pSysMemAllocParams = new SysMemAllocatorParams;
+            MSDK_CHECK_POINTER(pSysMemAllocParams, MFX_ERR_MEMORY_ALLOC);
+            pSysMemAllocParams->nOptions = m_nSysMemOptions;
+            m_pmfxAllocatorParams        = pSysMemAllocParams;
+        }
+
         /* In case of system memory we demonstrate "no external allocator" usage model.
         We don't call SetAllocator, Media SDK uses internal allocator.
         We use system memory allocator simply as a memory manager for application*/
@@ -1316,6 +1357,7 @@ void CEncodingPipeline::DeleteFrames() {
     // delete surfaces array
     MSDK_SAFE_DELETE_ARRAY(m_pEncSurfaces);
     MSDK_SAFE_DELETE_ARRAY(m_pVppSurfaces);
+    m_nEncSurfNum = m_nVppSurfNum = 0;
 
     // delete frames
     if (m_pMFXAllocator) {
@@ -1390,9 +1432,14 @@ CEncodingPipeline::CEncodingPipeline()
           m_pmfxAllocatorParams(NULL),
           m_memType(SYSTEM_MEMORY),
           m_nPerfOpt(0),
+          m_bPerfMmap(false),
+          m_nMappedSurfNum(0),
+          m_nSysMemOptions(0),
           m_bExternalAlloc(false),
           m_pEncSurfaces(NULL),
           m_pVppSurfaces(NULL),
+          m_nEncSurfNum(0),
+          m_nVppSurfNum(0),
           m_EncResponse{ 0 },
           m_VppResponse{ 0 },
           m_PreEncResponse{ 0 },
@@ -1415,13 +1462,17 @@ CEncodingPipeline::CEncodingPipeline()
           m_nFramesRead(0),
           m_bCutOutput(false),
           m_bInsertIDR(false),
+          m_nIdrFrame(0),
           m_bTimeOutExceed(false),
           m_nEncSurfIdx(0),
           m_nVppSurfIdx(0),
           m_bIsFieldSplitting(false),
           m_bSingleTexture(false),
+          m_bAsyncWrite(false),
+          m_bDirectIO(false),
           m_statOverall(),
-          m_statFile() {
+          m_statFile(),
+          m_pQualityMeter() {
     m_FileWriters.first = m_FileWriters.second = NULL;
 #if (MFX_VERSION >= 2000)
     m_IVFFileWriters.first = m_IVFFileWriters.second = NULL;
@@ -1452,6 +1503,7 @@ mfxStatus CEncodingPipeline::InitIVFFileWriter(CIVFFrameWriter** ppWriter,
         (*ppWriter)->ForceInitStatus(true);
     }
     else {
+        (*ppWriter)->SetAsyncWrite(m_bAsyncWrite, m_bDirectIO);
         sts = (*ppWriter)->Init(filename, w, h, fr_nom, fr_denom);
     }
 
@@ -1468,6 +1520,7 @@ mfxStatus CEncodingPipeline::InitFileWriter(CSmplBitstreamWriter** ppWriter,
     MSDK_SAFE_DELETE(*ppWriter);
     *ppWriter = new CSmplBitstreamWriter;
     MSDK_CHECK_POINTER(*ppWriter, MFX_ERR_MEMORY_ALLOC);
+    (*ppWriter)->SetAsyncWrite(m_bAsyncWrite, m_bDirectIO);
     mfxStatus sts = (*ppWriter)->Init(filename);
     MSDK_CHECK_STATUS(sts, " failed");
 
@@ -1490,6 +1543,7 @@ mfxStatus CEncodingPipeline::InitFileWriter(CSmplBitstreamWriter** ppWriter,
         (*ppWriter)->ForceInitStatus(true);
     }
     else {
+        (*ppWriter)->SetAsyncWrite(m_bAsyncWrite, m_bDirectIO);
         sts = (*ppWriter)->Init(filename);
     }
 
@@ -2021,14 +2075,28 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
         // prepare input file reader
         sts = m_FileReader.Init(pParams->InputFiles, pParams->FileInputFourCC, readerShift);
         MSDK_CHECK_STATUS(sts, "m_FileReader.Init failed");
+        m_FileReader.SetReadBatch(pParams->nReadBatch);
+        m_FileReader.SetReadInPlace(pParams->bReadInPlace);
+
+        if (pParams->nFirstFrame) {
+            sts = m_FileReader.SkipNframesFromBeginning(pParams->nWidth,
+                                                        pParams->nHeight,
+                                                        0,
+                                                        pParams->nFirstFrame);
+            MSDK_CHECK_STATUS(sts, "m_FileReader.SkipNframesFromBeginning failed");
+        }
     }
 
-    sts = InitFileWriters(pParams);
+    m_bAsyncWrite = pParams->bAsyncWrite;
+    m_bDirectIO   = pParams->bDirectIO;
+    sts           = InitFileWriters(pParams);
     MSDK_CHECK_STATUS(sts, "InitFileWriters failed");
 
     // set memory type
-    m_memType  = pParams->memType;
-    m_nPerfOpt = pParams->nPerfOpt;
+    m_memType        = pParams->memType;
+    m_nPerfOpt       = pParams->nPerfOpt;
+    m_bPerfMmap      = pParams->bPerfMmap;
+    m_nSysMemOptions = pParams->nSysMemOptions;
 
     m_bSoftRobustFlag = pParams->bSoftRobustFlag;
 
@@ -2062,12 +2130,16 @@ mfxStatus CEncodingPipeline::Init(sInputParams* pParams) {
     sts = ResetMFXComponents(pParams);
     MSDK_CHECK_STATUS(sts, "ResetMFXComponents failed");
 
+    sts = InitQualityMeter(pParams);
+    MSDK_CHECK_STATUS(sts, "InitQualityMeter failed");
+
     sts = OpenRoundingOffsetFile(pParams);
     MSDK_CHECK_STATUS(sts, "Failed to open file");
 
     InitV4L2Pipeline(pParams);
 
     m_nFramesToProcess = pParams->nNumFrames;
+    m_nIdrFrame        = pParams->nIdrFrame;
 
     // If output isn't specified work in performance mode and do not insert idr
     m_bCutOutput = pParams->dstFileBuff.size() ? !pParams->bUncut : false;
@@ -2189,8 +2261,21 @@ void CEncodingPipeline::PrintPerFrameStat() {
         msdk_printf(MSDK_STRING("Frame number: %u\r\n"), (unsigned int)nFrames);
         mfxF64 ProcDeltaTime = m_statOverall.GetDeltaTime() - m_statFile.GetDeltaTime() -
                                m_TaskPool.GetFileStatistics().GetDeltaTime();
+        if (m_pQualityMeter)
+            ProcDeltaTime -= m_pQualityMeter->GetTimeStatistics().GetTotalTime();
         msdk_printf(MSDK_STRING("Encoding fps: %.0f\n"), (double)(nFrames / ProcDeltaTime));
     }
+    if (m_pQualityMeter) {
+        m_pQualityMeter->PrintStatistics(MSDK_STRING("Quality"));
+
+        FILE* pLog = NULL;
+        if (!m_strMetricsLog.empty())
+            MSDK_FOPEN(pLog, m_strMetricsLog.c_str(), MSDK_STRING("a"));
+        if (pLog) {
+            m_pQualityMeter->PrintStatistics(MSDK_STRING("Quality"), pLog);
+            fclose(pLog);
+        }
+    }
 }
 
 void CEncodingPipeline::Close() {
@@ -2220,6 +2305,9 @@ void CEncodingPipeline::Close() {
 #endif
     FreeVppFilters();
 
+    // the meter keeps the input surfaces it hasn't copied yet locked
+    m_pQualityMeter.reset();
+
 #if (MFX_VERSION >= 2000)
     if (m_bAPI2XInternalMem == false)
 #endif
@@ -2281,6 +2369,13 @@ mfxStatus CEncodingPipeline::FillBuffers() {
         for (mfxU32 i = 0; i < m_nPerfOpt; i++) {
             mfxFrameSurface1* surface = m_pmfxVPP ? &m_pVppSurfaces[i] : &m_pEncSurfaces[i];
 
+            if (m_nMappedSurfNum) {
+                // Surface points to the frame of the mapped file, nothing is read here
+                mfxStatus sts = m_FileReader.MapNextFrame(surface);
+                MSDK_CHECK_STATUS(sts, "m_FileReader.MapNextFrame failed");
+                continue;
+            }
+
             mfxStatus sts =
                 m_pMFXAllocator->Lock(m_pMFXAllocator->pthis, surface->Data.MemId, &surface->Data);
             MSDK_CHECK_STATUS(sts, "m_pMFXAllocator->Lock failed");
@@ -2310,6 +2405,10 @@ mfxStatus CEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
         MSDK_CHECK_STATUS(sts, "m_pmfxVPP->Close failed");
     }
 
+    // inputs of the frames lost on reset aren't measured
+    if (m_pQualityMeter)
+        m_pQualityMeter->DropPendingReferences();
+
     // free allocated frames
 #if (MFX_VERSION >= 2000)
     if (m_bAPI2XInternalMem == false)
@@ -2328,6 +2427,13 @@ mfxStatus CEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
     {
         sts = AllocFrames();
         MSDK_CHECK_STATUS(sts, "AllocFrames failed");
+
+        // new surfaces of the mapped input point to the file from its first frame
+        if (m_nMappedSurfNum) {
+            m_FileReader.Reset();
+            sts = FillBuffers();
+            MSDK_CHECK_STATUS(sts, "FillBuffers failed");
+        }
     }
 
     m_mfxEncParams.mfx.FrameInfo.FourCC = m_mfxPreEncParams.mfx.FrameInfo.FourCC =
@@ -2411,6 +2517,8 @@ mfxStatus CEncodingPipeline::ResetMFXComponents(sInputParams* pParams) {
     if (m_bSoftRobustFlag)
         m_TaskPool.SetGpuHangRecoveryFlag();
 
+    m_TaskPool.SetQualityMeter(m_pQualityMeter.get());
+
     sts = FillBuffers();
     MSDK_CHECK_STATUS(sts, "FillBuffers failed");
 
@@ -2485,7 +2593,7 @@ mfxStatus CEncodingPipeline::GetFreeTask(sTask** ppTask) {
         sts = m_TaskPool.SynchronizeFirstTask();
         if (sts == MFX_ERR_GPU_HANG && m_bSoftRobustFlag) {
             m_TaskPool.ClearTasks();
-            FreeSurfacePool(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+            FreeSurfacePool(m_pEncSurfaces, m_nEncSurfNum);
             m_bInsertIDR = true;
             sts          = MFX_ERR_NONE;
         }
@@ -2681,7 +2789,7 @@ mfxStatus CEncodingPipeline::Run() {
                 m_nEncSurfIdx %= m_nPerfOpt;
             }
             else {
-                m_nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+                m_nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_nEncSurfNum);
             }
             MSDK_CHECK_ERROR(m_nEncSurfIdx, MSDK_INVALID_SURF_IDX, MFX_ERR_MEMORY_ALLOC);
         }
@@ -2719,7 +2827,7 @@ mfxStatus CEncodingPipeline::Run() {
                     }
                     else {
                         m_nVppSurfIdx =
-                            GetFreeSurface(m_pVppSurfaces, m_VppResponse.NumFrameActual);
+                            GetFreeSurface(m_pVppSurfaces, m_nVppSurfNum);
                     }
                     MSDK_CHECK_ERROR(m_nVppSurfIdx, MSDK_INVALID_SURF_IDX, MFX_ERR_MEMORY_ALLOC);
 #endif
@@ -2817,6 +2925,9 @@ mfxStatus CEncodingPipeline::Run() {
             vppSurface.Syncp    = NULL;
         }
 
+        sts = AddQualityReference(encSurface, pCurrentTask);
+        MSDK_BREAK_ON_ERROR(sts);
+
         sts = EncodeOneFrame(encSurface, pCurrentTask);
 
 #if (MFX_VERSION >= 2000)
@@ -2849,7 +2960,7 @@ mfxStatus CEncodingPipeline::Run() {
 #endif
             {
                 // find free surface for encoder input (vpp output)
-                m_nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+                m_nEncSurfIdx = GetFreeSurface(m_pEncSurfaces, m_nEncSurfNum);
                 MSDK_CHECK_ERROR(m_nEncSurfIdx, MSDK_INVALID_SURF_IDX, MFX_ERR_MEMORY_ALLOC);
                 preencSurface.pSurface = &m_pEncSurfaces[m_nEncSurfIdx];
             }
@@ -2889,6 +3000,9 @@ mfxStatus CEncodingPipeline::Run() {
                 vppSurface.Syncp    = NULL;
             }
 
+            sts = AddQualityReference(encSurface, pCurrentTask);
+            MSDK_BREAK_ON_ERROR(sts);
+
             sts = EncodeOneFrame(encSurface, pCurrentTask);
         }
 
@@ -2920,6 +3034,9 @@ mfxStatus CEncodingPipeline::Run() {
                 vppSurface.Syncp    = NULL;
             }
 
+            sts = AddQualityReference(encSurface, pCurrentTask);
+            MSDK_BREAK_ON_ERROR(sts);
+
             sts = EncodeOneFrame(encSurface, pCurrentTask);
         }
 
@@ -2952,7 +3069,7 @@ mfxStatus CEncodingPipeline::Run() {
         if (sts == MFX_ERR_GPU_HANG && m_bSoftRobustFlag) {
             m_bInsertIDR = true;
             m_TaskPool.ClearTasks(); //may be not needed
-            FreeSurfacePool(m_pEncSurfaces, m_EncResponse.NumFrameActual);
+            FreeSurfacePool(m_pEncSurfaces, m_nEncSurfNum);
             sts = MFX_ERR_NONE;
         }
     }
@@ -2963,6 +3080,12 @@ mfxStatus CEncodingPipeline::Run() {
     // report any errors that occurred in asynchronous part
     MSDK_CHECK_STATUS(sts, "m_TaskPool.SynchronizeFirstTask failed");
 
+    // compare frames still buffered by the decoder of the quality meter
+    if (m_pQualityMeter) {
+        sts = m_pQualityMeter->Flush();
+        MSDK_CHECK_STATUS(sts, "m_pQualityMeter->Flush failed");
+    }
+
 #if (MFX_VERSION >= 2000)
     auto api2x_perf_t2  = std::chrono::high_resolution_clock::now();
     m_api2xPerfLoopTime = static_cast<double>(
@@ -2973,6 +3096,44 @@ mfxStatus CEncodingPipeline::Run() {
     return sts;
 }
 
+mfxStatus CEncodingPipeline::InitQualityMeter(sInputParams* pParams) {
+    if (!pParams->nQualityMetrics)
+        return MFX_ERR_NONE;
+
+#if (MFX_VERSION >= 2000)
+    // the meter decodes a single stream of whole frames
+    if (m_FileWriters.second || m_bIsFieldSplitting) {
+        msdk_printf(MSDK_STRING(
+            "error: quality metrics are not supported with 2 output streams or field split\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    m_pQualityMeter.reset(new CEncodeQualityMeter);
+    mfxStatus sts = m_pQualityMeter->Init(m_pLoader.get(),
+                                          &m_mfxSession,
+                                          m_mfxEncParams,
+                                          pParams->nQualityMetrics,
+                                          pParams->nMetricsThreads);
+    MSDK_CHECK_STATUS(sts, "m_pQualityMeter->Init failed");
+
+    m_TaskPool.SetQualityMeter(m_pQualityMeter.get());
+    m_strMetricsLog = pParams->strMetricsLog;
+    return MFX_ERR_NONE;
+#else
+    msdk_printf(MSDK_STRING("error: quality metrics require API 2.0 or newer\n"));
+    return MFX_ERR_UNSUPPORTED;
+#endif
+}
+
+mfxStatus CEncodingPipeline::AddQualityReference(const ExtendedSurface& In, sTask* pTask) {
+    if (!m_pQualityMeter || !In.pSurface)
+        return MFX_ERR_NONE;
+
+    // input of the encoder is copied by the meter once the preceding VPP task completes
+    mfxSyncPoint syncp = pTask->DependentVppTasks.empty() ? NULL : pTask->DependentVppTasks.back();
+    return m_pQualityMeter->AddReference(In.pSurface, m_pMFXAllocator, &m_mfxSession, syncp);
+}
+
 mfxStatus CEncodingPipeline::LoadNextFrame(mfxFrameSurface1* pSurf) {
     mfxStatus sts = MFX_ERR_NONE;
 
@@ -3043,6 +3204,8 @@ mfxStatus CEncodingPipeline::LoadNextFrame(mfxFrameSurface1* pSurf) {
     if (pSurf)
         pSurf->Data.FrameOrder =
             m_bQPFileMode ? m_QPFileReader.GetCurrentDisplayOrder() : m_nFramesRead;
+    if (m_nIdrFrame && m_nIdrFrame == m_nFramesRead)
+        m_bInsertIDR = true;
     m_nFramesRead++;
 
     return sts;
@@ -256,6 +256,13 @@ mfxStatus CRegionEncodingPipeline::CreateAllocator() {
         m_pMFXAllocator = new SysMemFrameAllocator;
         MSDK_CHECK_POINTER(m_pMFXAllocator, MFX_ERR_MEMORY_ALLOC);
 
+        if (m_nSysMemOptions) {
+            SysMemAllocatorParams* pSysMemAllocParams = new SysMemAllocatorParams;
+            MSDK_CHECK_POINTER(pSysMemAllocParams, MFX_ERR_MEMORY_ALLOC);
+            pSysMemAllocParams->nOptions = m_nSysMemOptions;
+            m_pmfxAllocatorParams        = pSysMemAllocParams;
+        }
+
         /* In case of system memory we demonstrate "no external allocator" usage model.
         We don't call SetAllocator, Media SDK uses internal allocator.
         We use system memory allocator simply as a memory manager for application*/
@@ -9,9 +9,11 @@
 #include <stdarg.h>
 #include <memory>
 #include <string>
+#include "chunked_encode.h"
 #include "pipeline_encode.h"
 #include "pipeline_region_encode.h"
 #include "pipeline_user.h"
+#include "sysmem_allocator.h"
 #include "version.h"
 
 #define VAL_CHECK(val, argIdx, argName)                                                       \
@@ -246,6 +248,29 @@ void PrintHelp(msdk_char* strAppName, const msdk_char* strErrorMessage, ...) {
         "   [-timeout]               - encoding in cycle not less than specific time in seconds\n"));
     msdk_printf(MSDK_STRING(
         "   [-perf_opt n]            - sets number of prefetched frames. In performance mode app preallocates buffer and loads first n frames\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-perf_mmap]             - with -perf_opt system memory surfaces point to the memory mapped input file instead of loaded frames\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-read_batch n]          - reads n input frames at once with a single large read\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-read_in_place]         - reads input frames straight to the surfaces when no conversion is needed, off by default\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-async_write]           - write output file from a dedicated I/O thread\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-direct_write]          - same as -async_write, bypass page cache (O_DIRECT) if supported\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-sysmem_opt list]       - placement of system memory frames, list is comma separated align64,align4k,slab,thp,hugetlb,numa\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-metrics list]          - measures quality of the output against the encoder input, list is comma separated psnr,ssim,msssim or all\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-metrics_threads n]     - number of threads computing the metrics, 0 (default) uses all logical processors\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-metrics_log fileName]  - appends the quality statistics printed at the end to the file as well\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-chunks n]              - splits H.264/HEVC input into n chunks at the IDR frames of -g/-idr_interval or of the encoder defaults, encodes them at once on n sessions and joins the streams\n"
+        "                              HRD buffer restarts at every chunk, so HRD conformance of the output isn't guaranteed\n"));
+    msdk_printf(MSDK_STRING(
+        "   [-chunk_overlap n]       - with -chunks every chunk encodes n previous frames first to warm up the BRC, they are dropped from the output\n"));
     msdk_printf(MSDK_STRING(
         "   [-uncut]                 - do not cut output file in looped mode (in case of -timeout option)\n"));
     msdk_printf(MSDK_STRING(
@@ -927,6 +952,78 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-perf_mmap"))) {
+            pParams->bPerfMmap = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-read_batch"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nReadBatch)) {
+                PrintHelp(strInput[0], MSDK_STRING("read_batch is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-read_in_place"))) {
+            pParams->bReadInPlace = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-async_write"))) {
+            pParams->bAsyncWrite = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-direct_write"))) {
+            pParams->bAsyncWrite = true;
+            pParams->bDirectIO   = true;
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-sysmem_opt"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            pParams->nSysMemOptions = ParseSysMemAllocatorOptions(strInput[++i]);
+            if (!pParams->nSysMemOptions) {
+                PrintHelp(strInput[0], MSDK_STRING("sysmem_opt list is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-metrics"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            pParams->nQualityMetrics = ParseQualityMetrics(strInput[++i]);
+            if (!pParams->nQualityMetrics) {
+                PrintHelp(strInput[0], MSDK_STRING("metrics list is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-metrics_threads"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nMetricsThreads)) {
+                PrintHelp(strInput[0], MSDK_STRING("metrics_threads is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-metrics_log"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->strMetricsLog)) {
+                PrintHelp(strInput[0], MSDK_STRING("metrics_log file name is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-chunks"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nChunks) ||
+                !pParams->nChunks) {
+                PrintHelp(strInput[0], MSDK_STRING("chunks is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-chunk_overlap"))) {
+            VAL_CHECK(i + 1 >= nArgNum, i, strInput[i]);
+
+            if (MFX_ERR_NONE != msdk_opt_read(strInput[++i], pParams->nChunkOverlap)) {
+                PrintHelp(strInput[0], MSDK_STRING("chunk_overlap is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-WeightedPred:default"))) {
             pParams->WeightedPred = MFX_WEIGHTED_PRED_DEFAULT;
         }
@@ -1426,6 +1523,19 @@ mfxStatus ParseInputString(msdk_char* strInput[], mfxU8 nArgNum, sInputParams* p
         pParams->nPicStruct = MFX_PICSTRUCT_PROGRESSIVE;
     }
 
+    if (pParams->nChunks > 1 &&
+        ((MFX_CODEC_AVC != pParams->CodecId && MFX_CODEC_HEVC != pParams->CodecId) ||
+         pParams->numViews > 1 || pParams->dstFileBuff.size() != 1 ||
+         pParams->isV4L2InputEnabled || pParams->nPerfOpt || pParams->nTimeout ||
+         pParams->QPFileMode || pParams->nQualityMetrics ||
+         MFX_PICSTRUCT_PROGRESSIVE != pParams->nPicStruct)) {
+        PrintHelp(
+            strInput[0],
+            MSDK_STRING(
+                "-chunks is supported for progressive H.264 and HEVC encoding of a file to a file without -perf_opt, -timeout, -qpfile and -metrics"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
     if ((pParams->nRateControlMethod == MFX_RATECONTROL_LA) && (!pParams->bUseHWLib)) {
         PrintHelp(strInput[0], MSDK_STRING("Look ahead BRC is supported only with -hw option!"));
         return MFX_ERR_UNSUPPORTED;
@@ -1613,6 +1723,22 @@ int main(int argc, char* argv[])
 
     MSDK_CHECK_PARSE_RESULT(sts, MFX_ERR_NONE, 1);
 
+    if (Params.nChunks > 1) {
+        CChunkedEncoder chunkedEncoder;
+        sts = chunkedEncoder.Init(Params);
+        MSDK_CHECK_STATUS(sts, "chunkedEncoder.Init failed");
+
+        chunkedEncoder.PrintInfo();
+
+        msdk_printf(MSDK_STRING("Processing started\n"));
+        sts = chunkedEncoder.Run();
+        MSDK_CHECK_STATUS(sts, "chunkedEncoder.Run failed");
+
+        chunkedEncoder.Close();
+        msdk_printf(MSDK_STRING("\nProcessing finished\n"));
+        return 0;
+    }
+
     // Choosing which pipeline to use
     pPipeline.reset(CreatePipeline(Params));
 
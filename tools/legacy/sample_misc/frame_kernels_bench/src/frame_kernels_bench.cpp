@@ -0,0 +1,263 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Checks that every SIMD variant of the raw frame kernels supported by the CPU gives
+// the same output as the scalar kernels, then measures their throughput. Checks run
+// over random data, every width up to the maximum, unaligned pointers and all shifts,
+// and fail if a kernel writes out of its row.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame_kernels.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Bytes around the output which the kernels must not touch
+const mfxU32 GUARD_SIZE = 64;
+const mfxU8 GUARD_BYTE  = 0xA5;
+// Pointers are offset up to the widest vector to cover unaligned loads and stores
+const mfxU32 MAX_OFFSET = 64;
+
+const char* isaNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+struct BenchParams {
+    mfxU32 maxWidth; // checks run for every width in [0, maxWidth]
+    mfxU32 numTrials; // random trials per width
+    mfxU32 rowWidth; // width of the rows in the throughput measurement
+    mfxU32 numRounds;
+};
+
+struct CheckResult {
+    mfxU32 interleave; // mismatches against the scalar kernel
+    mfxU32 deinterleave;
+    mfxU32 shiftLeft;
+    mfxU32 shiftRight;
+};
+
+// Buffer with guard bytes on both sides of the data placed at the given offset
+class GuardedBuffer {
+public:
+    GuardedBuffer(mfxU32 size, mfxU32 offset)
+            : m_data(GUARD_SIZE + offset + size + GUARD_SIZE, GUARD_BYTE),
+              m_offset(GUARD_SIZE + offset) {}
+
+    mfxU8* Data() {
+        return m_data.data() + m_offset;
+    }
+    bool operator!=(const GuardedBuffer& other) const {
+        return m_data != other.m_data;
+    }
+
+private:
+    std::vector<mfxU8> m_data;
+    mfxU32 m_offset;
+};
+
+void FillRandom(std::mt19937& rng, mfxU8* data, mfxU32 size) {
+    for (mfxU32 i = 0; i < size; i++)
+        data[i] = (mfxU8)rng();
+}
+
+// Compares the output of the kernels with the scalar ones for width w, outputs of both
+// are compared together with the guard bytes
+void CheckWidth(const FrameKernels& ref,
+                const FrameKernels& test,
+                mfxU32 w,
+                std::mt19937& rng,
+                CheckResult& result) {
+    mfxU32 srcOffset = rng() % MAX_OFFSET;
+    mfxU32 dstOffset = rng() % MAX_OFFSET;
+
+    // u and v planes to uv
+    {
+        std::vector<mfxU8> u(w + MAX_OFFSET), v(w + MAX_OFFSET);
+        FillRandom(rng, u.data(), (mfxU32)u.size());
+        FillRandom(rng, v.data(), (mfxU32)v.size());
+        GuardedBuffer uvRef(2 * w, dstOffset), uvTest(2 * w, dstOffset);
+        ref.InterleaveUV(u.data() + srcOffset, v.data() + srcOffset, uvRef.Data(), w);
+        test.InterleaveUV(u.data() + srcOffset, v.data() + srcOffset, uvTest.Data(), w);
+        result.interleave += uvRef != uvTest;
+    }
+
+    // uv to u and v planes
+    {
+        std::vector<mfxU8> uv(2 * w + MAX_OFFSET);
+        FillRandom(rng, uv.data(), (mfxU32)uv.size());
+        GuardedBuffer uRef(w, dstOffset), vRef(w, dstOffset);
+        GuardedBuffer uTest(w, dstOffset), vTest(w, dstOffset);
+        ref.DeinterleaveUV(uv.data() + srcOffset, uRef.Data(), vRef.Data(), w);
+        test.DeinterleaveUV(uv.data() + srcOffset, uTest.Data(), vTest.Data(), w);
+        result.deinterleave += uRef != uTest || vRef != vTest;
+    }
+
+    // 16-bit shifts of every amount, out of place and in place as the reader does.
+    // Offsets are kept even, the kernels take mfxU16 pointers.
+    std::vector<mfxU8> src(2 * w + MAX_OFFSET);
+    for (mfxU32 shift = 0; shift < 16; shift++) {
+        FillRandom(rng, src.data(), (mfxU32)src.size());
+        const mfxU16* pSrc = (const mfxU16*)(src.data() + (srcOffset & ~1u));
+        mfxU32 offset      = dstOffset & ~1u;
+
+        GuardedBuffer leftRef(2 * w, offset), leftTest(2 * w, offset);
+        ref.ShiftLeft16(pSrc, (mfxU16*)leftRef.Data(), w, shift);
+        test.ShiftLeft16(pSrc, (mfxU16*)leftTest.Data(), w, shift);
+
+        GuardedBuffer rightRef(2 * w, offset), rightTest(2 * w, offset);
+        ref.ShiftRight16(pSrc, (mfxU16*)rightRef.Data(), w, shift);
+        test.ShiftRight16(pSrc, (mfxU16*)rightTest.Data(), w, shift);
+
+        GuardedBuffer inPlaceRef(2 * w, offset), inPlaceTest(2 * w, offset);
+        memcpy(inPlaceRef.Data(), pSrc, 2 * w);
+        memcpy(inPlaceTest.Data(), pSrc, 2 * w);
+        ref.ShiftLeft16((mfxU16*)inPlaceRef.Data(), (mfxU16*)inPlaceRef.Data(), w, shift);
+        test.ShiftLeft16((mfxU16*)inPlaceTest.Data(), (mfxU16*)inPlaceTest.Data(), w, shift);
+        result.shiftLeft += leftRef != leftTest || inPlaceRef != inPlaceTest;
+
+        memcpy(inPlaceRef.Data(), pSrc, 2 * w);
+        memcpy(inPlaceTest.Data(), pSrc, 2 * w);
+        ref.ShiftRight16((mfxU16*)inPlaceRef.Data(), (mfxU16*)inPlaceRef.Data(), w, shift);
+        test.ShiftRight16((mfxU16*)inPlaceTest.Data(), (mfxU16*)inPlaceTest.Data(), w, shift);
+        result.shiftRight += rightRef != rightTest || inPlaceRef != inPlaceTest;
+    }
+}
+
+CheckResult CheckKernels(const FrameKernels& kernels, const BenchParams& params) {
+    const FrameKernels* ref = GetFrameKernels(FRAME_KERNELS_SCALAR);
+    CheckResult result      = {};
+    std::mt19937 rng(1);
+
+    for (mfxU32 w = 0; w <= params.maxWidth; w++) {
+        for (mfxU32 trial = 0; trial < params.numTrials; trial++)
+            CheckWidth(*ref, kernels, w, rng, result);
+    }
+    return result;
+}
+
+double GetGBps(double bytes, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? bytes / seconds / 1e9 : 0;
+}
+
+// Prints GB/s of the data written by each kernel over rows of rowWidth
+void MeasureKernels(const FrameKernels& kernels, const BenchParams& params) {
+    mfxU32 w = params.rowWidth;
+    std::vector<mfxU8> u(w), v(w), uv(2 * w);
+    std::vector<mfxU16> src(w), dst(w);
+    std::mt19937 rng(1);
+    FillRandom(rng, uv.data(), (mfxU32)uv.size());
+    FillRandom(rng, (mfxU8*)src.data(), 2 * w);
+
+    double bytes = 2.0 * w * params.numRounds;
+
+    auto t0 = Clock::now();
+    for (mfxU32 i = 0; i < params.numRounds; i++)
+        kernels.DeinterleaveUV(uv.data(), u.data(), v.data(), w);
+    Clock::duration deinterleave = Clock::now() - t0;
+
+    t0 = Clock::now();
+    for (mfxU32 i = 0; i < params.numRounds; i++)
+        kernels.InterleaveUV(u.data(), v.data(), uv.data(), w);
+    Clock::duration interleave = Clock::now() - t0;
+
+    t0 = Clock::now();
+    for (mfxU32 i = 0; i < params.numRounds; i++)
+        kernels.ShiftLeft16(src.data(), dst.data(), w, 6);
+    Clock::duration shiftLeft = Clock::now() - t0;
+
+    t0 = Clock::now();
+    for (mfxU32 i = 0; i < params.numRounds; i++)
+        kernels.ShiftRight16(dst.data(), src.data(), w, 6);
+    Clock::duration shiftRight = Clock::now() - t0;
+
+    printf("%-8s %12.2f %12.2f %12.2f %12.2f\n",
+           isaNames[kernels.isa],
+           GetGBps(bytes, interleave),
+           GetGBps(bytes, deinterleave),
+           GetGBps(bytes, shiftLeft),
+           GetGBps(bytes, shiftRight));
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-w width]        - checks run for every width up to this, default 300\n");
+    printf("   [-t trials]       - random trials per width, default 4\n");
+    printf("   [-row width]      - width of the measured rows, default 1920\n");
+    printf("   [-r rounds]       - number of measured rows, default 100000\n");
+    printf("Fails if any variant differs from the scalar kernels or writes out of its row.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.maxWidth  = 300;
+    params.numTrials = 4;
+    params.rowWidth  = 1920;
+    params.numRounds = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-w")
+            params.maxWidth = (mfxU32)atoi(value);
+        else if (arg == "-t")
+            params.numTrials = (mfxU32)atoi(value);
+        else if (arg == "-row")
+            params.rowWidth = (mfxU32)atoi(value);
+        else if (arg == "-r")
+            params.numRounds = (mfxU32)atoi(value);
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!params.numTrials || !params.rowWidth || !params.numRounds) {
+        printf("error: number of trials, row width and rounds must be positive\n");
+        return 1;
+    }
+
+    bool ok = true;
+    printf("%-8s %12s %12s %12s %12s\n", "mismatch", "interleave", "deinterleave", "shl", "shr");
+    for (int isa = FRAME_KERNELS_SSE2; isa <= FRAME_KERNELS_AVX512; isa++) {
+        const FrameKernels* kernels = GetFrameKernels((FrameKernelsIsa)isa);
+        if (!kernels) {
+            printf("%-8s %12s\n", isaNames[isa], "n/a");
+            continue;
+        }
+        CheckResult result = CheckKernels(*kernels, params);
+        printf("%-8s %12u %12u %12u %12u\n",
+               isaNames[isa],
+               result.interleave,
+               result.deinterleave,
+               result.shiftLeft,
+               result.shiftRight);
+        ok = ok && !result.interleave && !result.deinterleave && !result.shiftLeft &&
+             !result.shiftRight;
+    }
+
+    printf("\n%-8s %12s %12s %12s %12s\n", "GB/s", "interleave", "deinterleave", "shl", "shr");
+    for (int isa = FRAME_KERNELS_SCALAR; isa <= FRAME_KERNELS_AVX512; isa++) {
+        const FrameKernels* kernels = GetFrameKernels((FrameKernelsIsa)isa);
+        if (kernels)
+            MeasureKernels(*kernels, params);
+    }
+    return ok ? 0 : 1;
+}
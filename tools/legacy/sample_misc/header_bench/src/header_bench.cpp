@@ -0,0 +1,311 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures the header parsing of sample_common: Exp-Golomb decoding of the 64-bit
+// bit reader against the byte loop it replaced, and optionally the frame splitting
+// of an H.264 stream with full and lazy headers parsing or the index of an HEVC
+// stream, which tracks the parameter sets referred by IRAP pictures.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "avc_bitstream.h"
+#include "avc_spl.h"
+#include "stream_index.h"
+
+namespace ProtectedLibrary {
+// Byte loop decoder of avc_bitstream.cpp, used by the bit reader for codes longer than 31 bits
+mfxStatus DecodeExpGolombOne(mfxU32** ppBitStream,
+                             mfxI32* pBitOffset,
+                             mfxI32* pDst,
+                             mfxI32 isSigned);
+} // namespace ProtectedLibrary
+
+using namespace ProtectedLibrary;
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchParams {
+    mfxU32 numCodes;
+    mfxU32 numRounds;
+    std::string avcFile;
+    std::string hevcFile;
+};
+
+double GetRate(double items, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? items / seconds / 1e6 : 0;
+}
+
+// Writes bits MSB first into dwords in the order the bit reader expects after BytesSwapper
+class CBitWriter {
+public:
+    CBitWriter() : m_words(), m_acc(0), m_bits(0) {}
+
+    void PutBits(mfxU32 value, mfxU32 nbits) {
+        for (mfxU32 i = nbits; i > 0; i--) {
+            m_acc = (m_acc << 1) | ((value >> (i - 1)) & 1);
+            if (++m_bits == 32) {
+                m_words.push_back(m_acc);
+                m_acc  = 0;
+                m_bits = 0;
+            }
+        }
+    }
+
+    void PutUE(mfxU32 value) {
+        mfxU32 code   = value + 1;
+        mfxU32 length = 0;
+        while (code >> length)
+            length++;
+        PutBits(0, length - 1);
+        PutBits(code, length);
+    }
+
+    void PutSE(mfxI32 value) {
+        PutUE(value > 0 ? 2 * (mfxU32)value - 1 : 2 * (mfxU32)(-value));
+    }
+
+    // Flushes the last dword, 8 bytes of padding are required by the reader
+    std::vector<mfxU32>& Finish() {
+        if (m_bits)
+            m_words.push_back(m_acc << (32 - m_bits));
+        m_words.push_back(0);
+        m_words.push_back(0);
+        m_acc  = 0;
+        m_bits = 0;
+        return m_words;
+    }
+
+private:
+    std::vector<mfxU32> m_words;
+    mfxU32 m_acc;
+    mfxU32 m_bits;
+};
+
+// Values of the header syntax elements are mostly small, few of them reach thousands
+void GenerateCodes(mfxU32 numCodes, std::vector<mfxI32>& values, std::vector<mfxU32>& words) {
+    std::mt19937 rng(1);
+    CBitWriter writer;
+    values.resize(numCodes);
+    for (mfxU32 i = 0; i < numCodes; i++) {
+        mfxU32 range = rng() % 100;
+        mfxU32 max   = range < 70 ? 4 : range < 95 ? 256 : (1 << 20);
+        mfxI32 value = (mfxI32)(rng() % max);
+        // every fourth element is signed as in slice headers
+        if (i % 4 == 3) {
+            value = (rng() & 1) ? value : -value;
+            writer.PutSE(value);
+        }
+        else {
+            writer.PutUE((mfxU32)value);
+        }
+        values[i] = value;
+    }
+    words = writer.Finish();
+}
+
+// Returns false if any of the decoders returns another value than written
+bool RunVLCBench(const BenchParams& params) {
+    std::vector<mfxI32> values;
+    std::vector<mfxU32> words;
+    GenerateCodes(params.numCodes, values, words);
+
+    std::vector<mfxI32> decoded(values.size());
+    Clock::duration loopTime(0), readerTime(0);
+    mfxU32 loopErrors = 0, readerErrors = 0;
+
+    for (mfxU32 round = 0; round < params.numRounds; round++) {
+        auto t0       = Clock::now();
+        mfxU32* pbs   = words.data();
+        mfxI32 offset = 31;
+        for (mfxU32 i = 0; i < values.size(); i++)
+            DecodeExpGolombOne(&pbs, &offset, &decoded[i], (i % 4 == 3) ? 1 : 0);
+        loopTime += Clock::now() - t0;
+        for (mfxU32 i = 0; i < values.size(); i++)
+            loopErrors += decoded[i] != values[i];
+
+        t0 = Clock::now();
+        AVCBaseBitstream bs((mfxU8*)words.data(), (mfxU32)(words.size() * sizeof(mfxU32)));
+        for (mfxU32 i = 0; i < values.size(); i++)
+            decoded[i] = bs.GetVLCElement(i % 4 == 3);
+        readerTime += Clock::now() - t0;
+        for (mfxU32 i = 0; i < values.size(); i++)
+            readerErrors += decoded[i] != values[i];
+    }
+
+    double codes = (double)values.size() * params.numRounds;
+    printf("%-24s %12s %10s\n", "exp-golomb decoder", "Mcodes/s", "errors");
+    printf("%-24s %12.1f %10u\n", "byte loop", GetRate(codes, loopTime), loopErrors);
+    printf("%-24s %12.1f %10u\n", "64-bit reader", GetRate(codes, readerTime), readerErrors);
+    return !loopErrors && !readerErrors;
+}
+
+bool ReadFile(const std::string& name, std::vector<mfxU8>& data) {
+    FILE* file = fopen(name.c_str(), "rb");
+    if (!file)
+        return false;
+    mfxU8 chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+    return !data.empty();
+}
+
+// Splits the stream into frames as CH264FrameReader does, returns the frame sizes
+mfxStatus SplitAVC(std::vector<mfxU8>& stream,
+                   HeaderParseMode mode,
+                   std::vector<mfxU32>& sizes,
+                   Clock::duration& time) {
+    AVC_Spl splitter;
+    splitter.SetParseMode(mode);
+
+    mfxBitstream bs = {};
+    bs.Data         = stream.data();
+    bs.DataLength   = (mfxU32)stream.size();
+    bs.MaxLength    = (mfxU32)stream.size();
+
+    sizes.clear();
+    auto t0 = Clock::now();
+    // the last frame is returned once the splitter gets no input
+    bool bEOS = false;
+    for (;;) {
+        FrameSplitterInfo* frame = NULL;
+        mfxStatus sts            = splitter.GetFrame(bEOS ? NULL : &bs, &frame);
+        if (sts == MFX_ERR_MORE_DATA) {
+            if (bEOS)
+                break;
+            bEOS = !bs.DataLength;
+            continue;
+        }
+        if (sts != MFX_ERR_NONE)
+            return sts;
+        sizes.push_back(frame->DataLength);
+        splitter.ResetCurrentState();
+    }
+    time = Clock::now() - t0;
+    return MFX_ERR_NONE;
+}
+
+bool RunAVCBench(const BenchParams& params) {
+    std::vector<mfxU8> stream;
+    if (!ReadFile(params.avcFile, stream)) {
+        printf("error: can't read %s\n", params.avcFile.c_str());
+        return false;
+    }
+
+    std::vector<mfxU32> fullSizes, lazySizes;
+    Clock::duration fullTime(0), lazyTime(0);
+    for (mfxU32 round = 0; round < params.numRounds; round++) {
+        Clock::duration time;
+        if (SplitAVC(stream, PARSE_HEADERS_FULL, fullSizes, time) != MFX_ERR_NONE)
+            return false;
+        fullTime += time;
+        if (SplitAVC(stream, PARSE_HEADERS_LAZY, lazySizes, time) != MFX_ERR_NONE)
+            return false;
+        lazyTime += time;
+    }
+
+    double bytes = (double)stream.size() * params.numRounds;
+    printf("%-24s %12s %10s\n", "h.264 frame splitter", "MB/s", "frames");
+    printf("%-24s %12.1f %10zu\n", "full headers", GetRate(bytes, fullTime), fullSizes.size());
+    printf("%-24s %12.1f %10zu\n", "lazy headers", GetRate(bytes, lazyTime), lazySizes.size());
+    if (fullSizes != lazySizes) {
+        printf("error: frames differ between full and lazy parsing\n");
+        return false;
+    }
+    return true;
+}
+
+bool RunHEVCBench(const BenchParams& params) {
+    std::basic_string<msdk_char> name(params.hevcFile.begin(), params.hevcFile.end());
+    CStreamIndex index;
+
+    Clock::duration time(0);
+    for (mfxU32 round = 0; round < params.numRounds; round++) {
+        auto t0       = Clock::now();
+        mfxStatus sts = index.Build(name.c_str(), STREAM_INDEX_HEVC);
+        time += Clock::now() - t0;
+        if (sts != MFX_ERR_NONE) {
+            printf("error: can't index %s, status %d\n", params.hevcFile.c_str(), (int)sts);
+            return false;
+        }
+    }
+
+    mfxU32 keyFrames = 0;
+    for (mfxU32 i = 0; i < index.GetFrameCount(); i++)
+        keyFrames += !!(index.GetEntry(i).flags & StreamIndexEntry::FLAG_KEY_FRAME);
+
+    double bytes = (double)index.GetFileSize() * params.numRounds;
+    printf("%-24s %12s %10s %10s\n", "hevc stream index", "MB/s", "frames", "key");
+    printf("%-24s %12.1f %10u %10u\n",
+           "index build",
+           GetRate(bytes, time),
+           index.GetFrameCount(),
+           keyFrames);
+    return true;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-n codes]        - number of Exp-Golomb codes, default 1000000\n");
+    printf("   [-r rounds]       - number of passes over the data, default 10\n");
+    printf("   [-avc file]       - H.264 elementary stream to split into frames\n");
+    printf("   [-hevc file]      - HEVC elementary stream to index\n");
+    printf("Fails if the decoders disagree with the written codes or full and lazy\n"
+           "parsing split the H.264 stream into different frames.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.numCodes  = 1000000;
+    params.numRounds = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-n")
+            params.numCodes = (mfxU32)atoi(value);
+        else if (arg == "-r")
+            params.numRounds = (mfxU32)atoi(value);
+        else if (arg == "-avc")
+            params.avcFile = value;
+        else if (arg == "-hevc")
+            params.hevcFile = value;
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!params.numCodes || !params.numRounds) {
+        printf("error: number of codes and rounds must be positive\n");
+        return 1;
+    }
+
+    bool ok = RunVLCBench(params);
+    if (!params.avcFile.empty())
+        ok = RunAVCBench(params) && ok;
+    if (!params.hevcFile.empty())
+        ok = RunHEVCBench(params) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,708 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures and checks the parts of the sample_multi_transcode launcher which don't need
+// the library. Sessions of the scheduler are synthetic jobs which burn a few cycles per
+// step and sometimes wait for the device: every job has to run on one thread at a time,
+// make all its steps and complete once, stopped jobs must not run or complete any more.
+// Processor lists of -cpus are parsed and a thread is pinned as the sessions are.
+// Bitstreams of an encoding session are taken, returned and grown as the encoder
+// does, and threads take buffers of the shared bitstream pool against the heap.
+// Commands are appended to a control file while it's watched, as the user does.
+// Real-time sessions are admitted by the costs of a calibrated capacity profile.
+// Metrics of the sessions are rendered as OpenMetrics text and written to a file.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitstream_pool.h"
+#include "capacity_model.h"
+#include "metrics_exporter.h"
+#include "pipeline_transcode.h"
+#include "session_control.h"
+#include "session_scheduler.h"
+#include "vm/thread_defs.h"
+
+using namespace TranscodingSample;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchParams {
+    mfxU32 numThreads;
+    mfxU32 numJobs;
+    mfxU32 numSteps; // of a job
+    mfxU32 work; // iterations of a step
+    mfxU32 numBuffers; // taken from the bitstream pool by a thread
+};
+
+// Session made of steps, the scheduler reports misuse of it to the counters
+class BenchJob : public CSchedulerJob {
+public:
+    BenchJob(mfxU32 index, mfxU32 numSteps, mfxU32 work, mfxStatus finalSts)
+            : m_index(index),
+              m_numSteps(numSteps),
+              m_work(work),
+              m_finalSts(finalSts),
+              m_rng(index),
+              m_running(false),
+              m_steps(0),
+              m_calls(0),
+              m_completions(0),
+              m_completionSts(MFX_ERR_NONE),
+              m_overlaps(0),
+              m_lateCalls(0),
+              m_pCompletion(NULL),
+              m_sink(0) {}
+
+    void SetCompletionQueue(CSessionCompletionQueue* pCompletion) {
+        m_pCompletion = pCompletion;
+    }
+
+    virtual mfxStatus RunStep(mfxU32) {
+        if (m_running.exchange(true))
+            m_overlaps++;
+        m_calls++;
+        if (m_completions.load())
+            m_lateCalls++;
+
+        mfxStatus sts = MFX_ERR_NONE;
+        // device is busy now and then, the step makes no progress
+        if (m_rng() % 8 == 0) {
+            sts = MFX_TASK_WORKING;
+        }
+        else {
+            for (mfxU32 i = 0; i < m_work; i++)
+                m_sink = m_sink * 31 + i;
+            if (++m_steps >= m_numSteps)
+                sts = m_finalSts;
+        }
+
+        m_running.store(false);
+        return sts;
+    }
+
+    virtual void OnComplete(mfxStatus sts) {
+        m_completionSts = sts;
+        m_completions++;
+        if (m_pCompletion)
+            m_pCompletion->Push(m_index);
+    }
+
+    mfxU32 m_index;
+    mfxU32 m_numSteps;
+    mfxU32 m_work;
+    mfxStatus m_finalSts;
+    std::mt19937 m_rng;
+
+    std::atomic<bool> m_running;
+    std::atomic<mfxU32> m_steps;
+    std::atomic<mfxU32> m_calls;
+    std::atomic<mfxU32> m_completions;
+    mfxStatus m_completionSts;
+    std::atomic<mfxU32> m_overlaps; // steps started while another one was running
+    std::atomic<mfxU32> m_lateCalls; // steps after the completion
+    CSessionCompletionQueue* m_pCompletion;
+    mfxU32 m_sink;
+};
+
+double GetRate(double count, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? count / seconds : 0;
+}
+
+mfxPriority GetPriority(mfxU32 index) {
+    static const mfxPriority priorities[] = { MFX_PRIORITY_LOW,
+                                              MFX_PRIORITY_NORMAL,
+                                              MFX_PRIORITY_HIGH };
+    return priorities[index % 3];
+}
+
+// Runs jobs of different lengths to completion, the short ones leave their threads
+// without work, so the long ones get stolen. Every 16th job fails halfway.
+bool CheckScheduler(const BenchParams& params) {
+    std::vector<std::unique_ptr<BenchJob>> jobs;
+    for (mfxU32 i = 0; i < params.numJobs; i++) {
+        bool bFails = i % 16 == 15;
+        mfxU32 numSteps = params.numSteps * (1 + i % 4) / 4;
+        jobs.emplace_back(new BenchJob(i,
+                                       bFails ? numSteps / 2 + 1 : numSteps,
+                                       params.work,
+                                       bFails ? MFX_ERR_ABORTED : MFX_WRN_VALUE_NOT_CHANGED));
+    }
+
+    CSessionCompletionQueue completion;
+    CSessionScheduler scheduler;
+    if (scheduler.Start(params.numThreads) != MFX_ERR_NONE) {
+        printf("error: scheduler doesn't start\n");
+        return false;
+    }
+
+    auto start = Clock::now();
+    for (auto& job : jobs) {
+        job->SetCompletionQueue(&completion);
+        if (scheduler.Submit(job.get(), GetPriority(job->m_index)) != MFX_ERR_NONE) {
+            printf("error: job %u isn't submitted\n", job->m_index);
+            scheduler.Stop();
+            return false;
+        }
+    }
+
+    // the launcher waits for the sessions the same way
+    mfxU32 numCompleted = 0;
+    size_t index;
+    while (numCompleted < params.numJobs && completion.Pop(index, 10000))
+        numCompleted++;
+    Clock::duration time = Clock::now() - start;
+    mfxU32 numThreads    = scheduler.GetNumThreads();
+    scheduler.Stop();
+
+    mfxU64 numSteps = 0, numCalls = 0;
+    mfxU32 errors   = 0;
+    for (auto& job : jobs) {
+        numSteps += job->m_steps;
+        numCalls += job->m_calls;
+        if (job->m_completions != 1 || job->m_completionSts != job->m_finalSts ||
+            job->m_steps != job->m_numSteps || job->m_overlaps || job->m_lateCalls)
+            errors++;
+    }
+
+    printf("scheduler: %u threads, %u jobs, %u completed, %.0f steps/s, %.1f%% idle calls\n",
+           numThreads,
+           params.numJobs,
+           numCompleted,
+           GetRate((double)numSteps, time),
+           numCalls ? 100.0 * (numCalls - numSteps) / numCalls : 0);
+
+    if (numCompleted != params.numJobs || errors) {
+        printf("error: %u jobs ran concurrently, didn't complete once or lost steps\n", errors);
+        return false;
+    }
+    return true;
+}
+
+// Stops the scheduler while its jobs run, they are dropped without completion
+bool CheckStop(const BenchParams& params) {
+    std::vector<std::unique_ptr<BenchJob>> jobs;
+    for (mfxU32 i = 0; i < params.numJobs; i++)
+        jobs.emplace_back(new BenchJob(i, 0xFFFFFFFF, params.work, MFX_WRN_VALUE_NOT_CHANGED));
+
+    CSessionScheduler scheduler;
+    if (scheduler.Start(params.numThreads) != MFX_ERR_NONE) {
+        printf("error: scheduler doesn't start\n");
+        return false;
+    }
+    for (auto& job : jobs)
+        scheduler.Submit(job.get(), GetPriority(job->m_index));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    scheduler.Stop();
+
+    mfxU64 numCalls = 0;
+    for (auto& job : jobs)
+        numCalls += job->m_calls;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    mfxU32 errors  = 0;
+    mfxU64 numLate = 0;
+    for (auto& job : jobs) {
+        errors += job->m_completions != 0 || job->m_overlaps;
+        numLate += job->m_calls;
+    }
+    numLate -= numCalls;
+
+    printf("scheduler stop: %llu steps before the stop, %llu after\n",
+           (unsigned long long)numCalls,
+           (unsigned long long)numLate);
+    if (errors || numLate || !numCalls) {
+        printf("error: stopped jobs ran, completed or didn't start\n");
+        return false;
+    }
+    return true;
+}
+
+bool CheckCpuLists() {
+    static const struct {
+        const msdk_char* list;
+        std::vector<mfxU32> cpus; // empty if the list is invalid
+    } cases[] = {
+        { MSDK_STRING("0-3,8,10-11"), { 0, 1, 2, 3, 8, 10, 11 } },
+        { MSDK_STRING("5"), { 5 } },
+        { MSDK_STRING("2-2,1"), { 2, 1 } },
+        { MSDK_STRING(""), {} },
+        { MSDK_STRING("3-1"), {} },
+        { MSDK_STRING("1,"), {} },
+        { MSDK_STRING(",1"), {} },
+        { MSDK_STRING("1-"), {} },
+        { MSDK_STRING("-1"), {} },
+        { MSDK_STRING("1;2"), {} },
+        { MSDK_STRING("node0"), {} },
+        { MSDK_STRING("4096"), {} },
+    };
+
+    mfxU32 errors = 0;
+    for (const auto& test : cases) {
+        std::vector<mfxU32> cpus;
+        mfxStatus sts = msdk_parse_cpu_list(test.list, cpus);
+        bool bValid   = sts == MFX_ERR_NONE;
+        if (bValid == test.cpus.empty() || (bValid && cpus != test.cpus))
+            errors++;
+    }
+    if (errors) {
+        printf("error: %u processor lists are parsed wrong\n", errors);
+        return false;
+    }
+    return true;
+}
+
+// Pins a thread to one of its processors and back as the session threads of -cpus are
+bool CheckAffinity() {
+    bool ok = true;
+    std::thread thread([&ok] {
+        std::vector<mfxU32> all, pinned, inherited;
+        if (msdk_thread_get_affinity(all) != MFX_ERR_NONE || all.empty()) {
+            printf("error: processors of the thread are unknown\n");
+            ok = false;
+            return;
+        }
+
+        std::vector<mfxU32> last(1, all.back());
+        ok = msdk_thread_set_affinity(last) == MFX_ERR_NONE &&
+             msdk_thread_get_affinity(pinned) == MFX_ERR_NONE && pinned == last;
+#if !defined(_WIN32) && !defined(_WIN64)
+        // threads of the session, e.g. of the quality metrics, stay on its processors
+        std::thread([&inherited] {
+            msdk_thread_get_affinity(inherited);
+        }).join();
+        ok = ok && inherited == last;
+#endif
+        ok = msdk_thread_set_affinity(all) == MFX_ERR_NONE &&
+             msdk_thread_get_affinity(pinned) == MFX_ERR_NONE && pinned == all && ok;
+
+        mfxU32 numNodes = msdk_get_numa_node_count(), numNodeCpus = 0;
+        for (mfxU32 node = 0; node < numNodes; node++) {
+            std::vector<mfxU32> cpus;
+            if (msdk_get_numa_node_cpus(node, cpus) == MFX_ERR_NONE)
+                numNodeCpus += (mfxU32)cpus.size();
+        }
+        printf("affinity: %zu processors, %u NUMA nodes of %u processors\n",
+               all.size(),
+               numNodes,
+               numNodeCpus);
+        if (!ok || !numNodeCpus)
+            printf("error: thread isn't pinned to its processors or NUMA nodes are empty\n");
+        ok = ok && numNodeCpus;
+    });
+    thread.join();
+    return ok;
+}
+
+// Takes and returns bitstreams of the store of a session and grows their buffers as
+// the encoder does on MFX_ERR_NOT_ENOUGH_BUFFER
+bool CheckBitstreamStore() {
+    const mfxU32 numBitstreams = 4;
+    auto pPool                 = std::make_shared<CBitstreamBufferPool>();
+    std::vector<const mfxU8*> buffers;
+    bool ok = true;
+    {
+        ExtendedBSStore store(numBitstreams, pPool);
+        std::vector<ExtendedBS*> taken;
+        for (mfxU32 i = 0; i < numBitstreams; i++)
+            taken.push_back(store.GetNext());
+        std::sort(taken.begin(), taken.end());
+        ok = !store.GetNext() && taken[0] &&
+             std::unique(taken.begin(), taken.end()) == taken.end();
+
+        // bitstreams of other stores and repeated releases are ignored
+        ExtendedBS foreign;
+        store.Release(&foreign);
+        store.Release(taken[0]);
+        store.Release(taken[0]);
+        ExtendedBS* pBS = store.GetNext();
+        ok              = ok && pBS == taken[0] && !store.GetNext();
+
+        mfxBitstreamWrapper& bs = pBS->Bitstream;
+        store.Grow(bs, 1000);
+        for (mfxU32 i = 0; i < 1000; i++)
+            bs.Data[i] = (mfxU8)i;
+        bs.DataLength = 1000;
+        store.Grow(bs, 200000);
+        ok = ok && bs.MaxLength >= 200000 && !bs.DataOffset && bs.DataLength == 1000;
+        for (mfxU32 i = 0; ok && i < 1000; i++)
+            ok = bs.Data[i] == (mfxU8)i;
+
+        // bitstream of a smaller buffer catches up once it's taken again
+        ExtendedBS* pOther = taken[1];
+        store.Grow(pOther->Bitstream, 10);
+        ok = ok && pOther->Bitstream.MaxLength < bs.MaxLength;
+        store.Release(pOther);
+        ok = ok && store.GetNext() == pOther && pOther->Bitstream.MaxLength == bs.MaxLength;
+
+        buffers.push_back(bs.Data);
+        buffers.push_back(pOther->Bitstream.Data);
+    }
+
+    // the store returns its buffers to the pool shared with other sessions
+    std::vector<mfxU8> reused = pPool->Acquire(200000);
+    ok = ok && std::find(buffers.begin(), buffers.end(), reused.data()) != buffers.end();
+    if (!ok) {
+        printf("error: bitstreams of the store are lost, shared or grown wrong\n");
+        return false;
+    }
+    return true;
+}
+
+// Threads take buffers of random sizes from the shared pool and from the heap,
+// a buffer of the pool must have the size of its class and belong to one thread
+bool CheckBitstreamPool(const BenchParams& params) {
+    CBitstreamBufferPool pool;
+    mfxU32 numThreads = params.numThreads ? params.numThreads : std::thread::hardware_concurrency();
+    numThreads        = std::max(numThreads, 1u);
+    std::atomic<mfxU32> errors(0);
+
+    // buffers of other sizes aren't kept, the ones taken have the sizes of their classes
+    pool.Release(std::vector<mfxU8>(100000));
+    if (pool.Acquire(70000).size() != CBitstreamBufferPool::GetClassSize(70000))
+        errors++;
+
+    auto run = [&](bool bPool) {
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (mfxU32 t = 0; t < numThreads; t++) {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(t);
+                mfxU8 tag = (mfxU8)(t + 1);
+                for (mfxU32 i = 0; i < params.numBuffers; i++) {
+                    mfxU32 size = 1000 + rng() % (4 << 20);
+                    std::vector<mfxU8> buffer =
+                        bPool ? pool.Acquire(size) : std::vector<mfxU8>(size);
+                    buffer[0] = buffer[size - 1] = tag;
+                    if (i % 64 == 0)
+                        std::this_thread::yield();
+                    if (bPool && (buffer.size() != CBitstreamBufferPool::GetClassSize(size) ||
+                                  buffer[0] != tag || buffer[size - 1] != tag))
+                        errors++;
+                    if (bPool)
+                        pool.Release(std::move(buffer));
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        return GetRate((double)numThreads * params.numBuffers, Clock::now() - start);
+    };
+
+    double heapRate = run(false);
+    double poolRate = run(true);
+    printf("bitstream buffers: %u threads, %.0f buffers/s from the heap, %.0f from the pool\n",
+           numThreads,
+           heapRate,
+           poolRate);
+    if (errors) {
+        printf("error: %u buffers of the pool were shared or of a wrong size\n", errors.load());
+        return false;
+    }
+    return true;
+}
+
+bool AppendFile(const char* name, const char* text, const char* mode = "a") {
+    FILE* file = fopen(name, mode);
+    if (!file)
+        return false;
+    bool ok = fputs(text, file) >= 0;
+    return fclose(file) == 0 && ok;
+}
+
+bool SameCommand(const SessionCommand& command,
+                 SessionCommand::Type type,
+                 mfxU32 session,
+                 const msdk_char* line) {
+    return command.type == type && command.session == session && command.line == line;
+}
+
+// Commands which were in the file at start are skipped, the complete lines appended later
+// are read once, malformed ones are skipped with a warning
+bool CheckSessionControl() {
+    const char* fileName = "launcher_bench.ctl";
+    std::deque<SessionCommand> commands;
+    CSessionControl control;
+
+    bool ok = AppendFile(fileName, "stop 1\n", "w") &&
+              control.Init(MSDK_STRING("launcher_bench.ctl")) == MFX_ERR_NONE &&
+              AppendFile(fileName,
+                         "add -i in.h264 -o out.h265\n"
+                         "# comment\n"
+                         "\n"
+                         "  stop 2 \r\n"
+                         "restart 3 -i other.h264\n"
+                         "restart 4\n"
+                         "bogus 5\n"
+                         "stop\n"
+                         "add\n"
+                         "quit\n"
+                         "stop 6") &&
+              control.Read(commands) == MFX_ERR_NONE;
+    ok = ok && commands.size() == 5 &&
+         SameCommand(commands[0], SessionCommand::ADD, 0, MSDK_STRING("-i in.h264 -o out.h265")) &&
+         SameCommand(commands[1], SessionCommand::STOP, 2, MSDK_STRING("")) &&
+         SameCommand(commands[2], SessionCommand::RESTART, 3, MSDK_STRING("-i other.h264")) &&
+         SameCommand(commands[3], SessionCommand::RESTART, 4, MSDK_STRING("")) &&
+         SameCommand(commands[4], SessionCommand::QUIT, 0, MSDK_STRING(""));
+
+    // line being written is read once it's complete
+    commands.clear();
+    ok = ok && AppendFile(fileName, "\n") && control.Read(commands) == MFX_ERR_NONE &&
+         control.Read(commands) == MFX_ERR_NONE && commands.size() == 1 &&
+         SameCommand(commands[0], SessionCommand::STOP, 6, MSDK_STRING(""));
+
+    // file written anew is read from the beginning
+    commands.clear();
+    ok = ok && AppendFile(fileName, "quit\n", "w") && control.Read(commands) == MFX_ERR_NONE &&
+         commands.size() == 1 && SameCommand(commands[0], SessionCommand::QUIT, 0, MSDK_STRING(""));
+
+    remove(fileName);
+    if (!ok) {
+        printf("error: commands of the control file are lost, repeated or parsed wrong\n");
+        return false;
+    }
+    return true;
+}
+
+SessionCostKey GetCostKey(mfxU16 width, mfxU16 height, mfxU16 targetUsage) {
+    SessionCostKey key;
+    key.decodeId    = MFX_CODEC_AVC;
+    key.encodeId    = MFX_CODEC_HEVC;
+    key.width       = width;
+    key.height      = height;
+    key.targetUsage = targetUsage;
+    return key;
+}
+
+bool HasCost(const CCapacityModel& model, const SessionCostKey& key, mfxF64 fps, mfxF64 expected) {
+    mfxF64 cost = 0;
+    return model.GetCost(key, fps, cost) && std::fabs(cost - expected) < 1e-9;
+}
+
+// Costs are scaled from the nearest calibrated resolution and raised by the missed
+// deadlines, they survive a round trip through the profile file
+bool CheckCapacityModel() {
+    const msdk_char* fileName = MSDK_STRING("launcher_bench.profile");
+    CCapacityModel model, loaded;
+    mfxF64 cost = 0;
+
+    model.Calibrate(GetCostKey(1920, 1080, 4), 200);
+    model.Calibrate(GetCostKey(1280, 720, 4), 400);
+    bool ok = HasCost(model, GetCostKey(1920, 1080, 4), 50, 0.25) &&
+              HasCost(model, GetCostKey(3840, 2160, 4), 50, 1.0) &&
+              HasCost(model, GetCostKey(1280, 720, 4), 50, 0.125) &&
+              HasCost(model, GetCostKey(640, 360, 4), 50, 0.03125) &&
+              !model.GetCost(GetCostKey(1920, 1080, 7), 50, cost);
+
+    // a fifth of the frames missed, the throughput drops by a fifth; no more than by half
+    model.AddDeadlineMisses(GetCostKey(1920, 1080, 4), 100, 20);
+    model.AddDeadlineMisses(GetCostKey(1280, 720, 4), 100, 100);
+    ok = ok && HasCost(model, GetCostKey(1920, 1080, 4), 40, 0.25) &&
+         HasCost(model, GetCostKey(1280, 720, 4), 50, 0.25);
+
+    ok = ok && model.Save(fileName) == MFX_ERR_NONE && loaded.Load(fileName) == MFX_ERR_NONE &&
+         HasCost(loaded, GetCostKey(1920, 1080, 4), 40, 0.25) &&
+         HasCost(loaded, GetCostKey(1280, 720, 4), 50, 0.25);
+
+    remove(fileName);
+    if (!ok) {
+        printf("error: costs of the capacity model are wrong\n");
+        return false;
+    }
+    return true;
+}
+
+// Sessions are admitted while the sum of their costs fits, get a faster target usage if
+// only that one fits and are rejected otherwise. A finished session frees its share.
+bool CheckAdmission() {
+    const msdk_char* fileName = MSDK_STRING("launcher_bench.profile");
+    CCapacityModel model, saved;
+    model.Calibrate(GetCostKey(1920, 1080, MFX_TARGETUSAGE_BALANCED), 100);
+    model.Calibrate(GetCostKey(1920, 1080, MFX_TARGETUSAGE_BEST_SPEED), 200);
+
+    CAdmissionController controller;
+    bool ok = model.Save(fileName) == MFX_ERR_NONE &&
+              controller.Init(fileName, CAdmissionController::DEFAULT_LOAD) == MFX_ERR_NONE;
+
+    SessionCostKey first = GetCostKey(1920, 1080, 0), second = first, third = first,
+                   offline = first;
+    ok = ok && controller.Admit(1, first, 50) && first.targetUsage == MFX_TARGETUSAGE_BALANCED &&
+         controller.Admit(2, second, 50) && second.targetUsage == MFX_TARGETUSAGE_BEST_SPEED &&
+         !controller.Admit(3, third, 50) && controller.IsRejected(3) &&
+         !controller.IsRejected(2) && controller.Admit(4, offline, 0);
+
+    // the first one frees half of the device, the second one missed half of its deadlines
+    third = GetCostKey(1920, 1080, 0);
+    controller.Complete(1, 100, 0);
+    controller.Complete(2, 100, 50);
+    ok = ok && controller.Admit(5, third, 50) && third.targetUsage == MFX_TARGETUSAGE_BALANCED &&
+         controller.Save() == MFX_ERR_NONE && saved.Load(fileName) == MFX_ERR_NONE &&
+         HasCost(saved, GetCostKey(1920, 1080, MFX_TARGETUSAGE_BEST_SPEED), 50, 0.5);
+
+    remove(fileName);
+    if (!ok) {
+        printf("error: real-time sessions are admitted or rejected wrong\n");
+        return false;
+    }
+    return true;
+}
+
+msdk_tick UsToTicks(mfxU64 us) {
+    return (msdk_tick)(us * CTimer::GetFrequency() / 1000000);
+}
+
+bool HasLine(const std::string& text, const std::string& line) {
+    return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+std::string ReadText(const char* name) {
+    std::string text;
+    FILE* file = fopen(name, "rb");
+    if (!file)
+        return text;
+    char buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+        text.append(buffer, read);
+    fclose(file);
+    return text;
+}
+
+// Durations fall into the buckets of their upper bounds, the rendered text has the values
+// of the sessions and the queues and is written once more at the stop
+bool CheckMetrics() {
+    CLatencyHistogram histogram;
+    const mfxU64 durations[] = { 500, 1000, 1001, 20000, 2000000 };
+    for (mfxU64 us : durations)
+        histogram.Observe(UsToTicks(us));
+
+    mfxU64 counts[CLatencyHistogram::NUM_BOUNDS + 1] = {}, sum = 0;
+    histogram.Read(counts, sum);
+    const mfxU64 expected[CLatencyHistogram::NUM_BOUNDS + 1] = { 2, 1, 0, 0, 0, 1,
+                                                                 0, 0, 0, 0, 0, 1 };
+    bool ok = std::equal(counts, counts + CLatencyHistogram::NUM_BOUNDS + 1, expected) &&
+              sum == 500 + 1000 + 1001 + 20000 + 2000000;
+
+    auto pMetrics = std::make_shared<CSessionMetrics>();
+    pMetrics->AddFrame(UsToTicks(20000), false);
+    pMetrics->AddFrame(UsToTicks(40000), true);
+    pMetrics->SetSurfacePool(CSessionMetrics::POOL_ENCODE, 3, 8);
+    pMetrics->bRunning = true;
+
+    const char* fileName = "launcher_bench.prom";
+    CMetricsExporter exporter;
+    exporter.AddSession(1, pMetrics);
+    exporter.AddQueue(2, []() {
+        return 5u;
+    });
+    std::string text = exporter.Render();
+    ok = ok && text.size() > 6 && text.compare(text.size() - 6, 6, "# EOF\n") == 0 &&
+         HasLine(text, "smt_session_running{session=\"1\"} 1") &&
+         HasLine(text, "smt_session_frames_total{session=\"1\"} 2") &&
+         HasLine(text, "smt_session_deadline_misses_total{session=\"1\"} 1") &&
+         HasLine(text,
+                 "smt_session_stage_latency_seconds_bucket{session=\"1\",stage=\"frame\","
+                 "le=\"0.033333\"} 1") &&
+         HasLine(text,
+                 "smt_session_stage_latency_seconds_count{session=\"1\",stage=\"frame\"} 2") &&
+         HasLine(text, "smt_surface_pool_used{session=\"1\",pool=\"encode\"} 3") &&
+         HasLine(text, "smt_surface_pool_size{session=\"1\",pool=\"encode\"} 8") &&
+         text.find("pool=\"decode\"") == std::string::npos &&
+         HasLine(text, "smt_surface_queue_depth{queue=\"2\"} 5");
+
+    // the last metrics are written at the stop
+    ok = ok && exporter.Start(MSDK_STRING("launcher_bench.prom"), 0, 60000) == MFX_ERR_NONE;
+    pMetrics->AddFrame(UsToTicks(20000), false);
+    exporter.Stop();
+    text = ReadText(fileName);
+    ok = ok && HasLine(text, "smt_session_frames_total{session=\"1\"} 3") &&
+         text.compare(text.size() - 6, 6, "# EOF\n") == 0;
+
+    remove(fileName);
+    if (!ok) {
+        printf("error: metrics of the sessions are rendered wrong\n");
+        return false;
+    }
+    return true;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-t threads]      - threads of the scheduler, default 4, 0 - one per processor\n");
+    printf("   [-j jobs]         - number of jobs, default 64\n");
+    printf("   [-s steps]        - steps of the longest jobs, default 2000\n");
+    printf("   [-w work]         - iterations of a step, default 2000\n");
+    printf("   [-b buffers]      - bitstream buffers taken by a thread, default 10000\n");
+    printf("Fails if jobs run concurrently, lose steps or complete other than once,\n");
+    printf("or if bitstreams are lost or shared, or control commands are read wrong,\n");
+    printf("or if real-time sessions are costed or admitted wrong, or metrics are lost.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.numThreads = 4;
+    params.numJobs    = 64;
+    params.numSteps   = 2000;
+    params.work       = 2000;
+    params.numBuffers = 10000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-t")
+            params.numThreads = (mfxU32)atoi(value);
+        else if (arg == "-j")
+            params.numJobs = (mfxU32)atoi(value);
+        else if (arg == "-s")
+            params.numSteps = (mfxU32)atoi(value);
+        else if (arg == "-w")
+            params.work = (mfxU32)atoi(value);
+        else if (arg == "-b")
+            params.numBuffers = (mfxU32)atoi(value);
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!params.numJobs || params.numSteps < 4) {
+        printf("error: there must be jobs of at least 4 steps\n");
+        return 1;
+    }
+
+    bool ok = CheckScheduler(params);
+    ok      = CheckStop(params) && ok;
+    ok      = CheckCpuLists() && ok;
+    ok      = CheckAffinity() && ok;
+    ok      = CheckBitstreamStore() && ok;
+    ok      = CheckBitstreamPool(params) && ok;
+    ok      = CheckSessionControl() && ok;
+    ok      = CheckCapacityModel() && ok;
+    ok      = CheckAdmission() && ok;
+    ok      = CheckMetrics() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures the Annex-B start code search of the NAL splitters: the vectorized scanner
+// of nal_scanner.h against the byte loop it replaced, and checks that both find the
+// same start codes. Input is an elementary stream or synthetic data dense in zeros.
+// The scanner uses the instruction set of the frame kernels, SAMPLE_FRAME_KERNELS
+// (scalar, sse2, avx2, avx512) selects the variant to check.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame_kernels.h"
+#include "nal_scanner.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+const char* isaNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+struct BenchParams {
+    mfxU32 size; // bytes of synthetic data
+    mfxU32 numRounds;
+    mfxU32 numRanges; // random parts of the data checked separately
+    std::string file;
+};
+
+double GetRate(double bytes, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? bytes / seconds / 1e6 : 0;
+}
+
+// Zero counting loop of StartCodeIterator::FindStartCode() before the scanner,
+// returns offsets of the first zero of every 00 00 01
+void ScanByteLoop(const mfxU8* data, size_t size, std::vector<size_t>& offsets) {
+    offsets.clear();
+    mfxU32 zeroCount = 0;
+    for (size_t i = 0; i < size; i++) {
+        switch (data[i]) {
+            case 0x00:
+                zeroCount++;
+                break;
+            case 0x01:
+                if (zeroCount >= 2)
+                    offsets.push_back(i - 2);
+                zeroCount = 0;
+                break;
+            default:
+                zeroCount = 0;
+                break;
+        }
+    }
+}
+
+void ScanVector(const mfxU8* data, size_t size, std::vector<size_t>& offsets) {
+    offsets.clear();
+    const mfxU8* end = data + size;
+    const mfxU8* p   = FindAnnexBStartCode(data, end);
+    while (p != end) {
+        offsets.push_back((size_t)(p - data));
+        p = FindAnnexBStartCode(p + 3, end);
+    }
+}
+
+// Coded data is mostly random, zeros and start code prefixes are made frequent to
+// reach the slow paths of the scanner: 4-byte start codes, 00 00 00 runs, 00 00 03
+void GenerateData(mfxU32 size, std::vector<mfxU8>& data) {
+    std::mt19937 rng(1);
+    data.resize(size);
+    for (mfxU32 i = 0; i < size; i++) {
+        mfxU32 r = rng() % 64;
+        data[i]  = r < 16 ? 0x00 : r < 18 ? 0x01 : r < 19 ? 0x03 : (mfxU8)rng();
+    }
+    // start codes every few hundred bytes as between NAL units
+    for (mfxU32 i = rng() % 512; i + 4 <= size; i += 3 + rng() % 512) {
+        bool bLongCode = rng() & 1;
+        data[i]        = 0x00;
+        data[i + 1]    = 0x00;
+        data[i + 2]    = bLongCode ? 0x00 : 0x01;
+        if (bLongCode)
+            data[i + 3] = 0x01;
+    }
+}
+
+bool ReadFile(const std::string& name, std::vector<mfxU8>& data) {
+    FILE* file = fopen(name.c_str(), "rb");
+    if (!file)
+        return false;
+    mfxU8 chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+    return !data.empty();
+}
+
+// Compares the start codes found in random parts of the data, which puts the start
+// codes at every position against the vector width and the end of the data
+mfxU32 CheckRanges(const std::vector<mfxU8>& data, mfxU32 numRanges) {
+    std::mt19937 rng(2);
+    std::vector<size_t> loopOffsets, vectorOffsets;
+    mfxU32 mismatches = 0;
+    for (mfxU32 i = 0; i < numRanges; i++) {
+        size_t begin = rng() % data.size();
+        size_t size  = rng() % std::min<size_t>(data.size() - begin + 1, 4096);
+        ScanByteLoop(data.data() + begin, size, loopOffsets);
+        ScanVector(data.data() + begin, size, vectorOffsets);
+        mismatches += loopOffsets != vectorOffsets;
+    }
+    return mismatches;
+}
+
+// Returns false if the scanners disagree on the start codes of the data
+bool RunBench(const char* name, const std::vector<mfxU8>& data, const BenchParams& params) {
+    std::vector<size_t> loopOffsets, vectorOffsets;
+    Clock::duration loopTime(0), vectorTime(0);
+
+    for (mfxU32 round = 0; round < params.numRounds; round++) {
+        auto t0 = Clock::now();
+        ScanByteLoop(data.data(), data.size(), loopOffsets);
+        loopTime += Clock::now() - t0;
+
+        t0 = Clock::now();
+        ScanVector(data.data(), data.size(), vectorOffsets);
+        vectorTime += Clock::now() - t0;
+    }
+
+    // NAL units of the iterator start at the found start codes
+    CNalUnitIterator it;
+    it.Init(data.data(), data.size());
+    mfxU32 numNalUnits = 0;
+    NalUnitInfo nal;
+    while (it.GetNext(nal))
+        numNalUnits++;
+
+    mfxU32 rangeErrors = CheckRanges(data, params.numRanges);
+
+    double bytes = (double)data.size() * params.numRounds;
+    printf("%s, %zu bytes, %zu start codes, %u nal units\n",
+           name,
+           data.size(),
+           loopOffsets.size(),
+           numNalUnits);
+    printf("%-24s %12s\n", "start code search", "MB/s");
+    printf("%-24s %12.1f\n", "byte loop", GetRate(bytes, loopTime));
+    printf("%-24s %12.1f\n", "scanner", GetRate(bytes, vectorTime));
+    printf("%-24s %12u\n\n", "mismatched ranges", rangeErrors);
+
+    if (loopOffsets != vectorOffsets || numNalUnits != loopOffsets.size() || rangeErrors) {
+        printf("error: the scanner finds other start codes than the byte loop\n");
+        return false;
+    }
+    return true;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-s size]         - bytes of synthetic data, default 16777216\n");
+    printf("   [-r rounds]       - number of passes over the data, default 10\n");
+    printf("   [-c ranges]       - random parts of the data checked, default 10000\n");
+    printf("   [-i file]         - Annex-B elementary stream to scan as well\n");
+    printf("Fails if the scanner and the byte loop find different start codes.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.size      = 16 * 1024 * 1024;
+    params.numRounds = 10;
+    params.numRanges = 10000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-s")
+            params.size = (mfxU32)atoi(value);
+        else if (arg == "-r")
+            params.numRounds = (mfxU32)atoi(value);
+        else if (arg == "-c")
+            params.numRanges = (mfxU32)atoi(value);
+        else if (arg == "-i")
+            params.file = value;
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!params.size || !params.numRounds) {
+        printf("error: data size and number of rounds must be positive\n");
+        return 1;
+    }
+
+    printf("scanner isa: %s\n\n", isaNames[GetFrameKernels().isa]);
+
+    std::vector<mfxU8> data;
+    GenerateData(params.size, data);
+    bool ok = RunBench("synthetic", data, params);
+
+    if (!params.file.empty()) {
+        data.clear();
+        if (!ReadFile(params.file, data)) {
+            printf("error: can't read %s\n", params.file.c_str());
+            return 1;
+        }
+        ok = RunBench(params.file.c_str(), data, params) && ok;
+    }
+    return ok ? 0 : 1;
+}
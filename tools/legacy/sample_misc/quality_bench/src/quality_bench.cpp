@@ -0,0 +1,399 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures PSNR, SSIM and MS-SSIM of CQualityMetrics and checks them against a plain
+// computation over the samples of every plane. Frames are synthetic, the distorted one
+// is the reference with noise, surfaces have padded rows so the planes are found
+// through the pitch. The engine uses the instruction set of the frame kernels,
+// SAMPLE_FRAME_KERNELS (scalar, sse2, avx2, avx512) selects the variant to check.
+
+#include "mfx_samples_config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame_kernels.h"
+#include "quality_metrics.h"
+#include "raw_frame_layout.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+const char* isaNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+struct BenchFormat {
+    mfxU32 fourCC;
+    const char* name;
+    mfxU16 bitDepth;
+};
+
+const BenchFormat formats[] = {
+    { MFX_FOURCC_NV12, "NV12", 8 },
+    { MFX_FOURCC_I420, "I420", 8 },
+    { MFX_FOURCC_YV12, "YV12", 8 },
+    { MFX_FOURCC_P010, "P010", 10 },
+};
+
+struct BenchParams {
+    mfxU16 width;
+    mfxU16 height;
+    mfxU32 numFrames; // compared per thread count
+    mfxU32 numThreads; // of the engine, 0 - all logical processors
+    mfxU32 noise; // amplitude of the distortion
+};
+
+// Same as the engine: capped value of identical frames, weights of the MS-SSIM scales
+const double MAX_PSNR          = 100.0;
+const double MSSSIM_WEIGHTS[5] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+struct Plane {
+    mfxU32 width;
+    mfxU32 height;
+    std::vector<mfxU16> samples;
+};
+
+double GetRate(double frames, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? frames / seconds : 0;
+}
+
+// Smooth gradients with some texture, so SSIM of the noisy frame isn't close to 0
+void GeneratePlanes(const BenchParams& params,
+                    mfxU16 bitDepth,
+                    mfxU32 seed,
+                    Plane (&ref)[3],
+                    Plane (&dist)[3]) {
+    std::mt19937 rng(seed);
+    mfxI32 maxValue = (1 << bitDepth) - 1;
+    mfxI32 scale    = 1 << (bitDepth - 8);
+    for (mfxU32 p = 0; p < 3; p++) {
+        mfxU32 w = p ? params.width / 2 : params.width;
+        mfxU32 h = p ? params.height / 2 : params.height;
+        ref[p].width = dist[p].width = w;
+        ref[p].height = dist[p].height = h;
+        ref[p].samples.resize(w * h);
+        dist[p].samples.resize(w * h);
+        for (mfxU32 y = 0; y < h; y++) {
+            for (mfxU32 x = 0; x < w; x++) {
+                mfxI32 v = ((x * (p + 1) + y * (3 - p)) % 200 + rng() % 48) * scale;
+                mfxI32 d = v + ((mfxI32)(rng() % (2 * params.noise + 1)) - (mfxI32)params.noise) *
+                                   scale;
+                ref[p].samples[y * w + x]  = (mfxU16)std::min(v, maxValue);
+                dist[p].samples[y * w + x] = (mfxU16)std::max(0, std::min(d, maxValue));
+            }
+        }
+    }
+}
+
+// System memory surface with the planes placed like SysMemFrameAllocator places them
+struct BenchSurface {
+    std::vector<mfxU8> buffer;
+    mfxFrameSurface1 surface;
+
+    bool Init(const BenchFormat& format, const BenchParams& params, const Plane (&planes)[3]) {
+        RawFrameLayout layout;
+        // rows of 4:2:0 chroma have half of the pitch, so the padding is even
+        if (!GetRawFrameLayout(format.fourCC,
+                               params.width,
+                               params.height,
+                               params.width * (format.bitDepth > 8 ? 2 : 1) + 64,
+                               layout))
+            return false;
+        buffer.assign(layout.size, 0);
+        memset(&surface, 0, sizeof(surface));
+        surface.Info.FourCC         = format.fourCC;
+        surface.Info.Width          = params.width;
+        surface.Info.Height         = params.height;
+        surface.Info.CropW          = params.width;
+        surface.Info.CropH          = params.height;
+        surface.Info.BitDepthLuma   = format.bitDepth;
+        surface.Info.BitDepthChroma = format.bitDepth;
+        // P010 samples are MSB aligned as the library outputs them
+        surface.Info.Shift = format.bitDepth > 8;
+        if (SetRawFramePlanes(layout, buffer.data(), surface.Data) != MFX_ERR_NONE)
+            return false;
+
+        const mfxFrameData& data = surface.Data;
+        mfxU32 pitch             = layout.pitch[0];
+        mfxU32 shift             = surface.Info.Shift ? 16 - format.bitDepth : 0;
+        for (mfxU32 p = 0; p < 3; p++) {
+            const Plane& plane = planes[p];
+            for (mfxU32 y = 0; y < plane.height; y++) {
+                const mfxU16* src = &plane.samples[y * plane.width];
+                for (mfxU32 x = 0; x < plane.width; x++) {
+                    if (format.fourCC == MFX_FOURCC_P010) {
+                        mfxU16* row = (mfxU16*)((p ? data.UV : data.Y) + y * pitch);
+                        row[p ? 2 * x + p - 1 : x] = (mfxU16)(src[x] << shift);
+                    }
+                    else if (format.fourCC == MFX_FOURCC_NV12) {
+                        mfxU8* row                 = (p ? data.UV : data.Y) + y * pitch;
+                        row[p ? 2 * x + p - 1 : x] = (mfxU8)src[x];
+                    }
+                    else {
+                        mfxU8* row = p ? (p == 1 ? data.U : data.V) + y * (pitch / 2)
+                                       : data.Y + y * pitch;
+                        row[x]     = (mfxU8)src[x];
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+double GetPsnr(mfxU64 ssd, double samples, double maxValue) {
+    if (!ssd)
+        return MAX_PSNR;
+    return std::min(MAX_PSNR, 10.0 * log10(maxValue * maxValue * samples / (double)ssd));
+}
+
+mfxU64 GetSsd(const Plane& a, const Plane& b) {
+    mfxU64 ssd = 0;
+    for (size_t i = 0; i < a.samples.size(); i++) {
+        mfxI64 d = (mfxI64)a.samples[i] - b.samples[i];
+        ssd += (mfxU64)(d * d);
+    }
+    return ssd;
+}
+
+// Means of SSIM and its contrast-structure term over 8x8 windows placed every 4 samples
+void GetSsim(const Plane& a, const Plane& b, double maxValue, double& ssim, double& cs) {
+    const double N  = 64;
+    const double c1 = (0.01 * maxValue) * (0.01 * maxValue);
+    const double c2 = (0.03 * maxValue) * (0.03 * maxValue);
+
+    mfxU32 windowsX = a.width / 4 - 1, windowsY = a.height / 4 - 1;
+    ssim = cs = 0;
+    for (mfxU32 wy = 0; wy < windowsY; wy++) {
+        for (mfxU32 wx = 0; wx < windowsX; wx++) {
+            double s1 = 0, s2 = 0, ss = 0, s12 = 0;
+            for (mfxU32 y = 4 * wy; y < 4 * wy + 8; y++) {
+                for (mfxU32 x = 4 * wx; x < 4 * wx + 8; x++) {
+                    double va = a.samples[y * a.width + x], vb = b.samples[y * b.width + x];
+                    s1 += va;
+                    s2 += vb;
+                    ss += va * va + vb * vb;
+                    s12 += va * vb;
+                }
+            }
+            double meanA = s1 / N, meanB = s2 / N;
+            double vars  = (ss - N * (meanA * meanA + meanB * meanB)) / (N - 1);
+            double covar = (s12 - N * meanA * meanB) / (N - 1);
+            double l     = (2 * meanA * meanB + c1) / (meanA * meanA + meanB * meanB + c1);
+            double c     = (2 * covar + c2) / (vars + c2);
+            ssim += l * c;
+            cs += c;
+        }
+    }
+    ssim /= (double)windowsX * windowsY;
+    cs /= (double)windowsX * windowsY;
+}
+
+// 2x2 average with rounding
+Plane Downsample(const Plane& src) {
+    Plane dst;
+    dst.width  = src.width / 2;
+    dst.height = src.height / 2;
+    dst.samples.resize(dst.width * dst.height);
+    for (mfxU32 y = 0; y < dst.height; y++) {
+        const mfxU16* r0 = &src.samples[2 * y * src.width];
+        const mfxU16* r1 = r0 + src.width;
+        for (mfxU32 x = 0; x < dst.width; x++)
+            dst.samples[y * dst.width + x] =
+                (mfxU16)((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+    }
+    return dst;
+}
+
+QualityMetricsValues GetReference(const Plane (&ref)[3], const Plane (&dist)[3], mfxU16 bitDepth) {
+    QualityMetricsValues values = {};
+    double maxValue             = (double)((1 << bitDepth) - 1);
+    double totalSamples         = 0;
+    mfxU64 totalSsd             = 0;
+    for (mfxU32 p = 0; p < 3; p++)
+        totalSamples += (double)ref[p].samples.size();
+
+    for (mfxU32 p = 0; p < 3; p++) {
+        double samples = (double)ref[p].samples.size();
+        mfxU64 ssd     = GetSsd(ref[p], dist[p]);
+        double cs;
+        values.psnr[p] = GetPsnr(ssd, samples, maxValue);
+        GetSsim(ref[p], dist[p], maxValue, values.ssim[p], cs);
+        values.ssimYUV += values.ssim[p] * samples / totalSamples;
+        totalSsd += ssd;
+    }
+    values.psnrYUV = GetPsnr(totalSsd, totalSamples, maxValue);
+
+    // scales while they have a window of SSIM, weights renormalized to the used ones
+    mfxU32 numScales = 1;
+    while (numScales < 5 && (ref[0].width >> numScales) >= 8 && (ref[0].height >> numScales) >= 8)
+        numScales++;
+    double totalWeight = 0;
+    for (mfxU32 s = 0; s < numScales; s++)
+        totalWeight += MSSSIM_WEIGHTS[s];
+
+    Plane a = ref[0], b = dist[0];
+    values.msssim = 1;
+    for (mfxU32 s = 0; s < numScales; s++) {
+        if (s) {
+            a = Downsample(a);
+            b = Downsample(b);
+        }
+        double ssim, cs;
+        GetSsim(a, b, maxValue, ssim, cs);
+        double term = (s + 1 < numScales) ? cs : ssim;
+        values.msssim *= pow(std::max(0.0, term), MSSSIM_WEIGHTS[s] / totalWeight);
+    }
+    return values;
+}
+
+bool IsClose(double a, double b) {
+    return fabs(a - b) <= 1e-9 * std::max(1.0, fabs(b));
+}
+
+bool SameValues(const QualityMetricsValues& a, const QualityMetricsValues& b) {
+    for (mfxU32 p = 0; p < 3; p++) {
+        if (!IsClose(a.psnr[p], b.psnr[p]) || !IsClose(a.ssim[p], b.ssim[p]))
+            return false;
+    }
+    return IsClose(a.psnrYUV, b.psnrYUV) && IsClose(a.ssimYUV, b.ssimYUV) &&
+           IsClose(a.msssim, b.msssim);
+}
+
+void PrintValues(const char* name, const QualityMetricsValues& v) {
+    printf("  %-10s psnr %.4f %.4f %.4f yuv %.4f, ssim %.6f %.6f %.6f yuv %.6f, ms-ssim %.6f\n",
+           name,
+           v.psnr[0],
+           v.psnr[1],
+           v.psnr[2],
+           v.psnrYUV,
+           v.ssim[0],
+           v.ssim[1],
+           v.ssim[2],
+           v.ssimYUV,
+           v.msssim);
+}
+
+// Returns false if the engine fails or its values differ from the plain computation
+bool RunBench(const BenchFormat& format, const BenchParams& params) {
+    Plane ref[3], dist[3];
+    GeneratePlanes(params, format.bitDepth, 1, ref, dist);
+
+    BenchSurface refSurface, distSurface;
+    if (!refSurface.Init(format, params, ref) || !distSurface.Init(format, params, dist)) {
+        printf("error: %s: can't lay out surfaces\n", format.name);
+        return false;
+    }
+
+    CQualityMetrics metrics;
+    if (metrics.Init(refSurface.surface.Info, QUALITY_METRIC_ALL, params.numThreads) !=
+        MFX_ERR_NONE) {
+        printf("error: %s: can't initialize the quality metrics\n", format.name);
+        return false;
+    }
+
+    QualityMetricsValues values = {}, identical = {};
+    Clock::duration time(0);
+    bool ok = true;
+    for (mfxU32 i = 0; ok && i < params.numFrames; i++) {
+        auto t0 = Clock::now();
+        ok      = metrics.Compare(&refSurface.surface, &distSurface.surface, &values) ==
+             MFX_ERR_NONE;
+        time += Clock::now() - t0;
+    }
+    ok = ok &&
+         metrics.Compare(&refSurface.surface, &refSurface.surface, &identical) == MFX_ERR_NONE;
+    metrics.Close();
+    if (!ok) {
+        printf("error: %s: compare failed\n", format.name);
+        return false;
+    }
+
+    QualityMetricsValues expected = GetReference(ref, dist, format.bitDepth);
+    QualityMetricsValues perfect  = GetReference(ref, ref, format.bitDepth);
+
+    printf("%-8s %10.1f fps\n", format.name, GetRate(params.numFrames, time));
+    PrintValues("engine", values);
+    PrintValues("reference", expected);
+
+    if (!SameValues(values, expected) || !SameValues(identical, perfect) ||
+        identical.psnrYUV != MAX_PSNR || !IsClose(identical.msssim, 1)) {
+        printf("error: %s: quality metrics differ from the reference\n", format.name);
+        return false;
+    }
+    return true;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-w width]        - frame width, default 1920\n");
+    printf("   [-h height]       - frame height, default 1080\n");
+    printf("   [-n frames]       - frames compared per format, default 10\n");
+    printf("   [-t threads]      - threads of the engine, default 0 (all logical processors)\n");
+    printf("   [-a amplitude]    - amplitude of the noise of the distorted frame, default 8\n");
+    printf("Fails if the engine and the reference give different values.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.width      = 1920;
+    params.height     = 1080;
+    params.numFrames  = 10;
+    params.numThreads = 0;
+    params.noise      = 8;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-w")
+            params.width = (mfxU16)atoi(value);
+        else if (arg == "-h")
+            params.height = (mfxU16)atoi(value);
+        else if (arg == "-n")
+            params.numFrames = (mfxU32)atoi(value);
+        else if (arg == "-t")
+            params.numThreads = (mfxU32)atoi(value);
+        else if (arg == "-a")
+            params.noise = (mfxU32)atoi(value);
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    // SSIM needs 8x8 windows in the chroma planes
+    if (params.width < 16 || params.height < 16 || ((params.width | params.height) & 1) ||
+        !params.numFrames) {
+        printf("error: sizes must be even and at least 16, number of frames positive\n");
+        return 1;
+    }
+
+    printf("metrics isa: %s\n", isaNames[GetFrameKernels().isa]);
+    printf("%ux%u, %u frames, noise %u\n",
+           params.width,
+           params.height,
+           params.numFrames,
+           params.noise);
+
+    bool ok = true;
+    for (const BenchFormat& format : formats)
+        ok = RunBench(format, params) && ok;
+    return ok ? 0 : 1;
+}
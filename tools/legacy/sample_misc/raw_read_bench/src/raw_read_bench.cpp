@@ -0,0 +1,249 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures reading of raw frames by CSmplYUVReader: through the staging buffer, in
+// batches of frames (SetReadBatch) and straight to the surface planes (SetReadInPlace),
+// and checks that all of them give the same frames. Input is a synthetic file written
+// for every color format, surfaces have padded rows unless the padding is 0, which
+// allows one read per frame in place.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "raw_frame_layout.h"
+#include "sample_utils.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchFormat {
+    mfxU32 fourCC;
+    const char* name;
+    mfxU16 bitDepth;
+};
+
+const BenchFormat formats[] = {
+    { MFX_FOURCC_NV12, "NV12", 8 }, { MFX_FOURCC_I420, "I420", 8 },
+    { MFX_FOURCC_YV12, "YV12", 8 }, { MFX_FOURCC_P010, "P010", 10 },
+    { MFX_FOURCC_YUY2, "YUY2", 8 }, { MFX_FOURCC_RGB4, "RGB4", 8 },
+    { MFX_FOURCC_AYUV, "AYUV", 8 }, { MFX_FOURCC_Y410, "Y410", 10 },
+};
+
+struct BenchParams {
+    mfxU16 width;
+    mfxU16 height;
+    mfxU32 numFrames; // frames of the synthetic file
+    mfxU32 padding; // bytes added to the rows of the surfaces
+    mfxU32 batchFrames; // frames of a batched read
+    std::string file;
+};
+
+double GetRate(double frames, Clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? frames / seconds : 0;
+}
+
+bool WriteFile(const std::string& name, size_t size) {
+    FILE* file = fopen(name.c_str(), "wb");
+    if (!file)
+        return false;
+    std::mt19937 rng(1);
+    std::vector<mfxU8> chunk(64 * 1024);
+    bool ok = true;
+    for (size_t written = 0; ok && written < size; written += chunk.size()) {
+        for (mfxU8& b : chunk)
+            b = (mfxU8)rng();
+        size_t bytes = std::min(chunk.size(), size - written);
+        ok           = fwrite(chunk.data(), 1, bytes, file) == bytes;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+// System memory surface with the planes placed like SysMemFrameAllocator places them
+struct BenchSurface {
+    RawFrameLayout layout;
+    mfxU32 fileFrameSize; // of the frame without padding in the file
+    std::vector<mfxU8> buffer;
+    mfxFrameSurface1 surface;
+
+    bool Init(const BenchFormat& format, const BenchParams& params) {
+        RawFrameLayout packed;
+        if (!GetRawFrameLayout(format.fourCC, params.width, params.height, 0, packed) ||
+            !GetRawFrameLayout(format.fourCC,
+                               params.width,
+                               params.height,
+                               packed.pitch[0] + params.padding,
+                               layout))
+            return false;
+        fileFrameSize = packed.size;
+        buffer.assign(layout.size, 0);
+        memset(&surface, 0, sizeof(surface));
+        surface.Info.FourCC         = format.fourCC;
+        surface.Info.Width          = params.width;
+        surface.Info.Height         = params.height;
+        surface.Info.CropW          = params.width;
+        surface.Info.CropH          = params.height;
+        surface.Info.BitDepthLuma   = format.bitDepth;
+        surface.Info.BitDepthChroma = format.bitDepth;
+        return SetRawFramePlanes(layout, buffer.data(), surface.Data) == MFX_ERR_NONE;
+    }
+};
+
+bool SameFrame(const BenchSurface& a, const BenchSurface& b) {
+    for (mfxU32 i = 0; i < a.layout.numPlanes; i++) {
+        for (mfxU32 row = 0; row < a.layout.rows[i]; row++) {
+            size_t offset = a.layout.offset[i] + (size_t)row * a.layout.pitch[i];
+            if (memcmp(&a.buffer[offset], &b.buffer[offset], a.layout.rowBytes[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Returns false if the readers fail or read different frames
+bool RunBench(const BenchFormat& format, const BenchParams& params) {
+    BenchSurface staged, batched, inPlace;
+    if (!staged.Init(format, params) || !batched.Init(format, params) ||
+        !inPlace.Init(format, params)) {
+        printf("error: %s: can't lay out surfaces\n", format.name);
+        return false;
+    }
+    if (!WriteFile(params.file, (size_t)staged.fileFrameSize * params.numFrames)) {
+        printf("error: can't write %s\n", params.file.c_str());
+        return false;
+    }
+
+    std::list<msdk_string> inputs(1, params.file);
+    CSmplYUVReader stagedReader, batchReader, inPlaceReader;
+    batchReader.SetReadBatch(params.batchFrames);
+    inPlaceReader.SetReadInPlace(true);
+    if (stagedReader.Init(inputs, format.fourCC) != MFX_ERR_NONE ||
+        batchReader.Init(inputs, format.fourCC) != MFX_ERR_NONE ||
+        inPlaceReader.Init(inputs, format.fourCC) != MFX_ERR_NONE) {
+        printf("error: %s: can't open %s\n", format.name, params.file.c_str());
+        return false;
+    }
+
+    Clock::duration stagedTime(0), batchTime(0), inPlaceTime(0);
+    mfxU32 numFrames = 0, mismatches = 0;
+    mfxStatus stagedSts = MFX_ERR_NONE, batchSts = MFX_ERR_NONE, inPlaceSts = MFX_ERR_NONE;
+    for (;;) {
+        auto t0   = Clock::now();
+        stagedSts = stagedReader.LoadNextFrame(&staged.surface);
+        stagedTime += Clock::now() - t0;
+
+        t0       = Clock::now();
+        batchSts = batchReader.LoadNextFrame(&batched.surface);
+        batchTime += Clock::now() - t0;
+
+        t0         = Clock::now();
+        inPlaceSts = inPlaceReader.LoadNextFrame(&inPlace.surface);
+        inPlaceTime += Clock::now() - t0;
+
+        if (stagedSts != MFX_ERR_NONE || batchSts != MFX_ERR_NONE || inPlaceSts != MFX_ERR_NONE)
+            break;
+        numFrames++;
+        mismatches += !SameFrame(staged, batched) || !SameFrame(staged, inPlace);
+    }
+    stagedReader.Close();
+    batchReader.Close();
+    inPlaceReader.Close();
+    remove(params.file.c_str());
+
+    printf("%-8s %10.1f %10.1f %10.1f %10u\n",
+           format.name,
+           GetRate(numFrames, stagedTime),
+           GetRate(numFrames, batchTime),
+           GetRate(numFrames, inPlaceTime),
+           mismatches);
+
+    if (stagedSts != MFX_ERR_MORE_DATA || batchSts != MFX_ERR_MORE_DATA ||
+        inPlaceSts != MFX_ERR_MORE_DATA || numFrames != params.numFrames || mismatches) {
+        printf("error: %s: batched or in place reads give other frames than the staging "
+               "buffer\n",
+               format.name);
+        return false;
+    }
+    return true;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-w width]        - frame width, default 1920\n");
+    printf("   [-h height]       - frame height, default 1080\n");
+    printf("   [-n frames]       - frames of the synthetic file, default 60\n");
+    printf("   [-p padding]      - bytes added to the surface rows, default 64\n");
+    printf("   [-b frames]       - frames of a batched read, default 8\n");
+    printf("   [-o file]         - synthetic file, default raw_read_bench.yuv, removed at exit\n");
+    printf("Fails if batched or in place reads give other frames than the staging buffer.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.width       = 1920;
+    params.height      = 1080;
+    params.numFrames   = 60;
+    params.padding     = 64;
+    params.batchFrames = 8;
+    params.file        = "raw_read_bench.yuv";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-w")
+            params.width = (mfxU16)atoi(value);
+        else if (arg == "-h")
+            params.height = (mfxU16)atoi(value);
+        else if (arg == "-n")
+            params.numFrames = (mfxU32)atoi(value);
+        else if (arg == "-p")
+            params.padding = (mfxU32)atoi(value);
+        else if (arg == "-b")
+            params.batchFrames = (mfxU32)atoi(value);
+        else if (arg == "-o")
+            params.file = value;
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    // chroma of the 4:2:0 formats needs even sizes and halved pitches
+    if (!params.width || !params.height || !params.numFrames ||
+        ((params.width | params.height | params.padding) & 1)) {
+        printf("error: sizes and number of frames must be positive, sizes and padding even\n");
+        return 1;
+    }
+
+    printf("%ux%u, %u frames, %u bytes of row padding, batches of %u frames\n",
+           params.width,
+           params.height,
+           params.numFrames,
+           params.padding,
+           params.batchFrames);
+    printf("%-8s %10s %10s %10s %10s\n", "format", "staged", "batched", "in place", "mismatches");
+
+    bool ok = true;
+    for (const BenchFormat& format : formats)
+        ok = RunBench(format, params) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,351 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures the buffers between a decoding session and the sessions consuming its
+// surfaces: the lock-free ring of SafetySurfaceBuffer against the list guarded by
+// a mutex it replaced. The producer adds every item to the buffer of each consumer
+// (1:N fan-out), consumers take and release items as the encoding sessions do.
+// Also checks that clearing the ring while consumers release items, as a reset of
+// the session does, releases every item exactly once.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lockfree_ring.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Item {
+    mfxU64 seq;
+    Clock::time_point pushed;
+};
+
+struct BenchParams {
+    mfxU32 numItems;
+    mfxU32 depth; // items in flight per consumer, as the async depth of a session
+    mfxU32 numClearRounds;
+    std::vector<mfxU32> consumers;
+};
+
+struct BenchResult {
+    double itemsPerSec; // items delivered to all consumers
+    double avgLatency; // us from push to the consumer
+    double p99Latency;
+    mfxU64 misordered; // items taken out of the push order
+};
+
+// List guarded by a mutex with insertion and release events, as SafetySurfaceBuffer was
+class MutexBuffer {
+public:
+    explicit MutexBuffer(mfxU32) : m_mutex(), m_list(), m_cvInsert(), m_cvRelease() {}
+
+    void Push(const Item& item) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_list.push_back(item);
+        }
+        m_cvInsert.notify_one();
+    }
+    bool Front(Item& item) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_list.empty())
+            return false;
+        item = m_list.front();
+        return true;
+    }
+    void Release(mfxU64 seq) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_list.begin(); it != m_list.end(); ++it) {
+                if (it->seq == seq) {
+                    m_list.erase(it);
+                    break;
+                }
+            }
+        }
+        m_cvRelease.notify_one();
+    }
+    void WaitInsertion() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvInsert.wait_for(lock, std::chrono::milliseconds(100), [this] {
+            return !m_list.empty();
+        });
+    }
+    void WaitLength(mfxU32 depth) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvRelease.wait_for(lock, std::chrono::milliseconds(100), [this, depth] {
+            return m_list.size() < depth;
+        });
+    }
+    mfxU32 GetLength() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (mfxU32)m_list.size();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::list<Item> m_list;
+    std::condition_variable m_cvInsert;
+    std::condition_variable m_cvRelease;
+};
+
+// Lock-free ring with wait points, as SafetySurfaceBuffer is now
+class RingBuffer {
+public:
+    explicit RingBuffer(mfxU32 capacity) : m_ring(capacity), m_insertion(), m_release() {}
+
+    void Push(const Item& item) {
+        while (!m_ring.Push(item))
+            WaitLength(m_ring.GetCapacity());
+        m_insertion.Notify();
+    }
+    bool Front(Item& item) {
+        return m_ring.Front(item);
+    }
+    void Release(mfxU64 seq) {
+        m_ring.Release([seq](const Item& item) {
+            return item.seq == seq;
+        });
+        m_release.Notify();
+    }
+    void WaitInsertion() {
+        Item item;
+        m_insertion.WaitFor(
+            [this, &item] {
+                return m_ring.Front(item);
+            },
+            100);
+    }
+    void WaitLength(mfxU32 depth) {
+        m_release.WaitFor(
+            [this, depth] {
+                return m_ring.GetLength() < depth;
+            },
+            100);
+    }
+    mfxU32 GetLength() {
+        return m_ring.GetLength();
+    }
+
+private:
+    CLockFreeRing<Item> m_ring;
+    CWaitPoint m_insertion;
+    CWaitPoint m_release;
+};
+
+template <class Buffer>
+BenchResult RunBench(const BenchParams& params, mfxU32 numConsumers) {
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    for (mfxU32 i = 0; i < numConsumers; i++)
+        buffers.emplace_back(new Buffer(std::max<mfxU32>(params.depth, 256)));
+
+    std::vector<std::vector<double>> latencies(numConsumers);
+    std::atomic<mfxU64> misordered(0);
+    std::vector<std::thread> consumers;
+
+    Clock::time_point start = Clock::now();
+    for (mfxU32 c = 0; c < numConsumers; c++) {
+        consumers.emplace_back([&, c] {
+            Buffer& buffer                = *buffers[c];
+            std::vector<double>& measured = latencies[c];
+            measured.reserve(params.numItems);
+            for (mfxU32 n = 0; n < params.numItems; n++) {
+                Item item;
+                while (!buffer.Front(item))
+                    buffer.WaitInsertion();
+                if (item.seq != n)
+                    misordered++;
+                measured.push_back(
+                    std::chrono::duration<double, std::micro>(Clock::now() - item.pushed).count());
+                buffer.Release(item.seq);
+            }
+        });
+    }
+
+    for (mfxU32 n = 0; n < params.numItems; n++) {
+        Item item;
+        item.seq = n;
+        for (auto& buffer : buffers) {
+            while (buffer->GetLength() >= params.depth)
+                buffer->WaitLength(params.depth);
+            item.pushed = Clock::now();
+            buffer->Push(item);
+        }
+    }
+
+    for (auto& consumer : consumers)
+        consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto& measured : latencies)
+        all.insert(all.end(), measured.begin(), measured.end());
+    std::sort(all.begin(), all.end());
+
+    BenchResult result = {};
+    double sum         = 0;
+    for (double latency : all)
+        sum += latency;
+    result.itemsPerSec = seconds > 0 ? all.size() / seconds : 0;
+    result.avgLatency  = all.empty() ? 0 : sum / all.size();
+    result.p99Latency  = all.empty() ? 0 : all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    result.misordered  = misordered.load();
+    return result;
+}
+
+// Consumers release the items of a full ring while the producer clears it, returns the
+// number of rounds in which an item was released twice or not at all
+mfxU32 CheckClear(mfxU32 numConsumers, mfxU32 numRounds) {
+    const mfxU32 capacity = 64;
+    std::mt19937 rng(1);
+    mfxU32 failures = 0;
+
+    for (mfxU32 round = 0; round < numRounds; round++) {
+        CLockFreeRing<Item> ring(capacity);
+        for (mfxU32 n = 0; n < capacity; n++) {
+            Item item = { n, Clock::now() };
+            ring.Push(item);
+        }
+
+        std::atomic<mfxU32> released(0), numStarted(0);
+        std::vector<std::thread> consumers;
+        for (mfxU32 c = 0; c < numConsumers; c++) {
+            consumers.emplace_back([&ring, &released, &numStarted, numConsumers] {
+                // all consumers start together
+                numStarted++;
+                while (numStarted.load() < numConsumers)
+                    std::this_thread::yield();
+                Item item;
+                while (ring.Front(item)) {
+                    // the item is used for a while, the clear may come meanwhile
+                    std::this_thread::yield();
+                    mfxU64 seq = item.seq;
+                    if (ring.Release([seq](const Item& i) {
+                            return i.seq == seq;
+                        }))
+                        released++;
+                }
+            });
+        }
+
+        // clear at a random point of the releases
+        while (numStarted.load() != numConsumers)
+            std::this_thread::yield();
+        for (mfxU32 spin = rng() % capacity; spin > 0 && ring.GetLength(); spin--)
+            std::this_thread::yield();
+        released += ring.Clear();
+
+        for (auto& consumer : consumers)
+            consumer.join();
+        failures += released.load() != capacity || ring.GetLength() != 0;
+    }
+    return failures;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-n items]        - number of items passed to each consumer, default 200000\n");
+    printf("   [-depth n]        - items in flight per consumer, default 4\n");
+    printf("   [-c consumers]    - number of consumers, may be repeated, default 1 2 4 8\n");
+    printf("   [-clear rounds]   - rounds of the clear check per consumer count, default 200\n");
+    printf("Producer adds each item to the buffers of all consumers, prints the number of\n"
+           "delivered items per second and the latency from the producer to a consumer.\n"
+           "Fails if a consumer takes the items out of the push order, or if clearing the\n"
+           "ring while consumers release items doesn't release every item once.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.numItems       = 200000;
+    params.depth          = 4;
+    params.numClearRounds = 200;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-n")
+            params.numItems = (mfxU32)atoi(value);
+        else if (arg == "-depth")
+            params.depth = (mfxU32)atoi(value);
+        else if (arg == "-c")
+            params.consumers.push_back((mfxU32)atoi(value));
+        else if (arg == "-clear")
+            params.numClearRounds = (mfxU32)atoi(value);
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (params.consumers.empty())
+        params.consumers = { 1, 2, 4, 8 };
+    if (!params.numItems || !params.depth ||
+        std::find(params.consumers.begin(), params.consumers.end(), 0u) !=
+            params.consumers.end()) {
+        printf("error: number of items, depth and consumers must be positive\n");
+        return 1;
+    }
+
+    printf("%u items per consumer, depth %u\n", params.numItems, params.depth);
+    printf("%-8s %9s %14s %14s %14s\n", "buffer", "consumers", "Mitems/s", "avg us", "p99 us");
+    for (mfxU32 numConsumers : params.consumers) {
+        BenchResult mutexResult = RunBench<MutexBuffer>(params, numConsumers);
+        BenchResult ringResult  = RunBench<RingBuffer>(params, numConsumers);
+
+        printf("%-8s %9u %14.3f %14.2f %14.2f\n",
+               "mutex",
+               numConsumers,
+               mutexResult.itemsPerSec / 1e6,
+               mutexResult.avgLatency,
+               mutexResult.p99Latency);
+        printf("%-8s %9u %14.3f %14.2f %14.2f\n",
+               "ring",
+               numConsumers,
+               ringResult.itemsPerSec / 1e6,
+               ringResult.avgLatency,
+               ringResult.p99Latency);
+        if (mutexResult.misordered || ringResult.misordered) {
+            printf("error: items taken out of order, mutex %llu, ring %llu\n",
+                   (unsigned long long)mutexResult.misordered,
+                   (unsigned long long)ringResult.misordered);
+            return 1;
+        }
+    }
+
+    for (mfxU32 numConsumers : params.consumers) {
+        mfxU32 failures = CheckClear(numConsumers, params.numClearRounds);
+        printf("clear with %u consumers: %u rounds, %u failed\n",
+               numConsumers,
+               params.numClearRounds,
+               failures);
+        if (failures) {
+            printf("error: clear and concurrent releases lost or doubled items\n");
+            return 1;
+        }
+    }
+    return 0;
+}
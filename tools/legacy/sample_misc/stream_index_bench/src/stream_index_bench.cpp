@@ -0,0 +1,323 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Checks the index of the access units used for random access to coded streams and
+// measures how long it takes to build and to load. The index of a synthetic H.264
+// stream is compared with the access units it was generated from, the index of any
+// stream survives the round trip through the sidecar file, and the bitstream reader
+// returns exactly the bytes of the frame range it was limited to.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sample_utils.h"
+#include "stream_index.h"
+
+namespace {
+
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::basic_string<msdk_char> MsdkString;
+
+struct BenchParams {
+    mfxU32 numFrames; // frames of the synthetic stream
+    mfxU32 gopSize; // distance between IDR frames of the synthetic stream
+    mfxU32 numRanges; // random frame ranges read back
+    std::string file;
+    std::string codec; // h264, h265 or ivf
+    std::string tmpFile; // synthetic stream and sidecar files are written next to it
+};
+
+MsdkString ToMsdkString(const std::string& str) {
+    return MsdkString(str.begin(), str.end());
+}
+
+double GetMilliseconds(Clock::duration time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+// Payload bytes are never zero, so no start code appears inside of a NAL unit
+void PutNalUnit(std::mt19937& rng, mfxU8 header, mfxU8 firstByte, std::vector<mfxU8>& data) {
+    static const mfxU8 startCode[] = { 0, 0, 0, 1 };
+    data.insert(data.end(), startCode, startCode + sizeof(startCode));
+    data.push_back(header);
+    data.push_back(firstByte);
+    mfxU32 size = 8 + rng() % 2048;
+    for (mfxU32 i = 0; i < size; i++)
+        data.push_back((mfxU8)(1 + rng() % 255));
+}
+
+// H.264 stream of IDR frames with parameter sets every gopSize frames and P frames
+// between them, some pictures have two slices. Returns the expected index entries.
+void GenerateStream(const BenchParams& params,
+                    std::vector<mfxU8>& data,
+                    std::vector<StreamIndexEntry>& entries) {
+    std::mt19937 rng(1);
+    for (mfxU32 frame = 0; frame < params.numFrames; frame++) {
+        StreamIndexEntry entry = {};
+        entry.offset           = data.size();
+
+        bool bIdr = !(frame % params.gopSize);
+        PutNalUnit(rng, 0x09, 0x10, data); // AUD
+        if (bIdr) {
+            PutNalUnit(rng, 0x67, 0x64, data); // SPS
+            PutNalUnit(rng, 0x68, 0xEE, data); // PPS
+        }
+        // first_mb_in_slice is 0 if the first bit of the slice header is set
+        PutNalUnit(rng, bIdr ? 0x65 : 0x41, 0x88, data);
+        if (rng() & 1)
+            PutNalUnit(rng, bIdr ? 0x65 : 0x41, 0x7A, data);
+
+        entry.size  = (mfxU32)(data.size() - entry.offset);
+        entry.flags = bIdr ? StreamIndexEntry::FLAG_KEY_FRAME : 0;
+        entries.push_back(entry);
+    }
+}
+
+bool WriteFile(const std::string& name, const std::vector<mfxU8>& data) {
+    FILE* file = fopen(name.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return !fclose(file) && ok;
+}
+
+bool ReadFile(const std::string& name, std::vector<mfxU8>& data) {
+    FILE* file = fopen(name.c_str(), "rb");
+    if (!file)
+        return false;
+    mfxU8 chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+    return !data.empty();
+}
+
+bool SameEntries(const CStreamIndex& index, const std::vector<StreamIndexEntry>& entries) {
+    if (index.GetFrameCount() != entries.size())
+        return false;
+    for (mfxU32 i = 0; i < index.GetFrameCount(); i++) {
+        const StreamIndexEntry& a = index.GetEntry(i);
+        const StreamIndexEntry& b = entries[i];
+        if (a.offset != b.offset || a.timeStamp != b.timeStamp || a.size != b.size ||
+            a.flags != b.flags)
+            return false;
+    }
+    return true;
+}
+
+// Saves the index, loads it back and checks that a sidecar of another version is
+// rejected. Returns false on mismatch.
+bool CheckSidecar(const CStreamIndex& index,
+                  const std::string& streamFile,
+                  const std::string& indexFile,
+                  StreamIndexFormat format) {
+    MsdkString streamName = ToMsdkString(streamFile);
+    MsdkString indexName  = ToMsdkString(indexFile);
+
+    auto t0 = Clock::now();
+    if (index.Save(indexName.c_str()) != MFX_ERR_NONE) {
+        printf("error: can't write %s\n", indexFile.c_str());
+        return false;
+    }
+    Clock::duration saveTime = Clock::now() - t0;
+
+    std::vector<StreamIndexEntry> entries;
+    for (mfxU32 i = 0; i < index.GetFrameCount(); i++)
+        entries.push_back(index.GetEntry(i));
+
+    CStreamIndex loaded;
+    t0            = Clock::now();
+    mfxStatus sts = loaded.Load(indexName.c_str(), streamName.c_str(), format);
+    Clock::duration loadTime = Clock::now() - t0;
+
+    // Fields are serialized one by one: 28 bytes of the header and 24 per entry
+    std::vector<mfxU8> sidecar;
+    bool ok = sts == MFX_ERR_NONE && SameEntries(loaded, entries) &&
+              ReadFile(indexFile, sidecar) &&
+              sidecar.size() == 28 + 24 * (size_t)index.GetFrameCount();
+
+    // Version follows the magic
+    bool bRejected = false;
+    if (sidecar.size() > 8) {
+        sidecar[4]++;
+        CStreamIndex stale;
+        bRejected = WriteFile(indexFile, sidecar) &&
+                    stale.Load(indexName.c_str(), streamName.c_str(), format) != MFX_ERR_NONE;
+    }
+    remove(indexFile.c_str());
+
+    printf("%-24s %12.2f\n", "save, ms", GetMilliseconds(saveTime));
+    printf("%-24s %12.2f\n", "load, ms", GetMilliseconds(loadTime));
+    printf("%-24s %12s\n", "sidecar round trip", ok ? "ok" : "mismatch");
+    printf("%-24s %12s\n", "other version", bRejected ? "rejected" : "accepted");
+    return ok && bRejected;
+}
+
+// Reads random frame ranges with the bitstream reader and compares them with the file
+// data from the key frame at or before the first frame to the end of the last frame.
+// Returns number of mismatched ranges.
+mfxU32 CheckRanges(const std::shared_ptr<const CStreamIndex>& pIndex,
+                   const std::string& streamFile,
+                   const std::vector<mfxU8>& data,
+                   mfxU32 numRanges) {
+    std::mt19937 rng(2);
+    mfxU32 frames     = pIndex->GetFrameCount();
+    mfxU32 mismatches = 0;
+    MsdkString name   = ToMsdkString(streamFile);
+
+    for (mfxU32 i = 0; i < numRanges; i++) {
+        mfxU32 first = rng() % frames;
+        mfxU32 count = rng() % 4 ? 1 + rng() % 64 : 0; // till the end sometimes
+
+        mfxU32 key  = pIndex->FindKeyFrame(first);
+        mfxU32 end  = (count && count < frames - key) ? key + count : frames;
+        mfxU64 from = pIndex->GetEntry(key).offset;
+        mfxU64 to   = pIndex->GetEntry(end - 1).offset + pIndex->GetEntry(end - 1).size;
+
+        CSmplBitstreamReader reader;
+        mfxBitstreamWrapper bs(64 * 1024);
+        std::vector<mfxU8> read;
+        bool ok = reader.Init(name.c_str()) == MFX_ERR_NONE;
+        reader.SetIndex(pIndex);
+        ok = ok && reader.SetFrameRange(first, count) == MFX_ERR_NONE;
+        while (ok && reader.ReadNextFrame(&bs) == MFX_ERR_NONE) {
+            const mfxU8* begin = bs.Data + bs.DataOffset;
+            read.insert(read.end(), begin, begin + bs.DataLength);
+            bs.DataLength = 0;
+        }
+
+        mismatches += !ok || read.size() != to - from ||
+                      memcmp(read.data(), data.data() + from, read.size());
+    }
+    return mismatches;
+}
+
+// Builds the index of the stream, checks the sidecar and the frame ranges. Expected
+// entries are compared if given. Returns false on any mismatch.
+bool RunBench(const std::string& streamFile,
+              StreamIndexFormat format,
+              const std::vector<StreamIndexEntry>* pExpected,
+              const BenchParams& params) {
+    std::vector<mfxU8> data;
+    if (!ReadFile(streamFile, data)) {
+        printf("error: can't read %s\n", streamFile.c_str());
+        return false;
+    }
+
+    std::shared_ptr<CStreamIndex> pIndex = std::make_shared<CStreamIndex>();
+    MsdkString name                      = ToMsdkString(streamFile);
+
+    auto t0                   = Clock::now();
+    mfxStatus sts             = pIndex->Build(name.c_str(), format);
+    Clock::duration buildTime = Clock::now() - t0;
+    if (sts != MFX_ERR_NONE) {
+        printf("error: can't index %s\n", streamFile.c_str());
+        return false;
+    }
+
+    mfxU32 keyFrames = 0;
+    for (mfxU32 i = 0; i < pIndex->GetFrameCount(); i++)
+        keyFrames += pIndex->GetEntry(i).flags & StreamIndexEntry::FLAG_KEY_FRAME;
+
+    double seconds = std::chrono::duration<double>(buildTime).count();
+    printf("%s, %zu bytes, %u frames, %u key frames\n",
+           streamFile.c_str(),
+           data.size(),
+           pIndex->GetFrameCount(),
+           keyFrames);
+    printf("%-24s %12.1f\n", "build, MB/s", seconds > 0 ? data.size() / seconds / 1e6 : 0);
+
+    bool ok = true;
+    if (pExpected) {
+        bool bSame = SameEntries(*pIndex, *pExpected);
+        printf("%-24s %12s\n", "generated entries", bSame ? "ok" : "mismatch");
+        ok = bSame;
+    }
+
+    ok = CheckSidecar(*pIndex, streamFile, params.tmpFile + ".idx", format) && ok;
+
+    mfxU32 rangeErrors = CheckRanges(pIndex, streamFile, data, params.numRanges);
+    printf("%-24s %12u\n\n", "mismatched ranges", rangeErrors);
+    return ok && !rangeErrors;
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-n frames]       - frames of the synthetic H.264 stream, default 3000\n");
+    printf("   [-g size]         - distance between its IDR frames, default 30\n");
+    printf("   [-r ranges]       - random frame ranges read back, default 200\n");
+    printf("   [-i file]         - coded stream to check as well\n");
+    printf("   [-c codec]        - its format: h264, h265 or ivf, default h265\n");
+    printf("   [-o file]         - temporary file, default stream_index_bench.tmp\n");
+    printf("Fails if the index, its sidecar or the frame ranges differ from the stream.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.numFrames = 3000;
+    params.gopSize   = 30;
+    params.numRanges = 200;
+    params.codec     = "h265";
+    params.tmpFile   = "stream_index_bench.tmp";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-n")
+            params.numFrames = (mfxU32)atoi(value);
+        else if (arg == "-g")
+            params.gopSize = (mfxU32)atoi(value);
+        else if (arg == "-r")
+            params.numRanges = (mfxU32)atoi(value);
+        else if (arg == "-i")
+            params.file = value;
+        else if (arg == "-c")
+            params.codec = value;
+        else if (arg == "-o")
+            params.tmpFile = value;
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    StreamIndexFormat format = params.codec == "h264"   ? STREAM_INDEX_AVC
+                               : params.codec == "h265" ? STREAM_INDEX_HEVC
+                               : params.codec == "ivf"  ? STREAM_INDEX_IVF
+                                                        : STREAM_INDEX_UNKNOWN;
+    if (!params.numFrames || !params.gopSize || format == STREAM_INDEX_UNKNOWN) {
+        printf("error: number of frames and GOP size must be positive, codec known\n");
+        return 1;
+    }
+
+    std::vector<mfxU8> data;
+    std::vector<StreamIndexEntry> entries;
+    GenerateStream(params, data, entries);
+    if (!WriteFile(params.tmpFile, data)) {
+        printf("error: can't write %s\n", params.tmpFile.c_str());
+        return 1;
+    }
+    bool ok = RunBench(params.tmpFile, STREAM_INDEX_AVC, &entries, params);
+    remove(params.tmpFile.c_str());
+
+    if (!params.file.empty())
+        ok = RunBench(params.file, format, NULL, params) && ok;
+    return ok ? 0 : 1;
+}
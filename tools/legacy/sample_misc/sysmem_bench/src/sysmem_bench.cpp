@@ -0,0 +1,278 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+// Measures throughput of the frame copy/convert kernels over NV12 frames
+// allocated by SysMemFrameAllocator with different placement options, and checks
+// that the frames have the alignment of the options and don't overlap.
+
+#include "mfx_samples_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "frame_kernels.h"
+#include "sysmem_allocator.h"
+
+namespace {
+
+struct BenchParams {
+    mfxU16 width;
+    mfxU16 height;
+    mfxU16 numFrames;
+    mfxU32 numRounds;
+    std::vector<mfxU32> options; // allocator options of the runs
+};
+
+struct BenchResult {
+    double copy; // GB/s of the data written
+    double deinterleave;
+    double interleave;
+    double shift;
+};
+
+double GetGBps(size_t bytes, std::chrono::high_resolution_clock::duration time) {
+    double seconds = std::chrono::duration<double>(time).count();
+    return seconds > 0 ? bytes / seconds / 1e9 : 0;
+}
+
+// Alignment of the frame data the options give
+size_t GetAlignment(mfxU32 options) {
+    if (options & SYSMEM_ALLOC_ALIGN4K)
+        return 4096;
+    return (options & SYSMEM_ALLOC_ALIGN64) ? 64 : 32;
+}
+
+// Returns false if a byte of the frame isn't the value it was filled with
+bool IsFilled(const mfxU8* ptr, size_t size, mfxU8 value) {
+    for (size_t i = 0; i < size; i++) {
+        if (ptr[i] != value)
+            return false;
+    }
+    return true;
+}
+
+std::string OptionsToStr(mfxU32 options) {
+    static const struct {
+        mfxU32 option;
+        const char* name;
+    } names[] = { { SYSMEM_ALLOC_ALIGN64, "align64" }, { SYSMEM_ALLOC_ALIGN4K, "align4k" },
+                  { SYSMEM_ALLOC_SLAB, "slab" },       { SYSMEM_ALLOC_THP, "thp" },
+                  { SYSMEM_ALLOC_HUGETLB, "hugetlb" }, { SYSMEM_ALLOC_NUMA, "numa" } };
+
+    std::string str;
+    for (const auto& name : names) {
+        if (options & name.option)
+            str += (str.empty() ? "" : ",") + std::string(name.name);
+    }
+    return str.empty() ? "default" : str;
+}
+
+mfxStatus RunBench(const BenchParams& params, mfxU32 options, BenchResult& result) {
+    SysMemAllocatorParams allocParams;
+    allocParams.nOptions = options;
+
+    SysMemFrameAllocator allocator;
+    mfxStatus sts = allocator.Init(&allocParams);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    mfxFrameAllocRequest request;
+    memset(&request, 0, sizeof(request));
+    request.Info.FourCC       = MFX_FOURCC_NV12;
+    request.Info.ChromaFormat = MFX_CHROMAFORMAT_YUV420;
+    request.Info.Width        = params.width;
+    request.Info.Height       = params.height;
+    request.Info.CropW        = params.width;
+    request.Info.CropH        = params.height;
+    request.NumFrameMin = request.NumFrameSuggested = params.numFrames;
+    request.Type = MFX_MEMTYPE_SYSTEM_MEMORY | MFX_MEMTYPE_FROM_VPPIN;
+
+    mfxFrameAllocResponse response;
+    memset(&response, 0, sizeof(response));
+    sts = allocator.Alloc(allocator.pthis, &request, &response);
+    if (sts != MFX_ERR_NONE)
+        return sts;
+
+    std::vector<mfxFrameData> frames(response.NumFrameActual);
+    for (mfxU32 i = 0; i < frames.size(); i++) {
+        memset(&frames[i], 0, sizeof(frames[i]));
+        sts = allocator.Lock(allocator.pthis, response.mids[i], &frames[i]);
+        if (sts != MFX_ERR_NONE)
+            return sts;
+        memset(frames[i].Y, i & 0xff, (size_t)frames[i].Pitch * params.height * 3 / 2);
+    }
+
+    // frames of a slab are next to each other, a frame filled later overwrites an overlap
+    for (mfxU32 i = 0; i < frames.size(); i++) {
+        size_t size = (size_t)frames[i].Pitch * params.height * 3 / 2;
+        if ((size_t)frames[i].Y % GetAlignment(options) ||
+            !IsFilled(frames[i].Y, size, (mfxU8)(i & 0xff))) {
+            printf("error: frame %u is misaligned or overlaps another one\n", i);
+            return MFX_ERR_UNKNOWN;
+        }
+    }
+
+    const FrameKernels& kernels = GetFrameKernels();
+    const mfxU32 w              = params.width;
+    const mfxU32 h              = params.height;
+    const mfxU32 pitch          = frames[0].Pitch;
+    const size_t lumaSize       = (size_t)w * h;
+    const size_t chromaSize     = lumaSize / 2;
+
+    std::chrono::high_resolution_clock::duration copy(0), deinterleave(0), interleave(0),
+        shift(0);
+    for (mfxU32 round = 0; round < params.numRounds; round++) {
+        for (mfxU32 i = 0; i < frames.size(); i++) {
+            mfxFrameData& src = frames[i];
+            mfxFrameData& dst = frames[(i + 1) % frames.size()];
+
+            auto t0 = std::chrono::high_resolution_clock::now();
+            CopyPlane(src.Y, pitch, dst.Y, pitch, w, h);
+
+            // UV rows of the source are split to U and V halves of the destination rows
+            auto t1 = std::chrono::high_resolution_clock::now();
+            for (mfxU32 y = 0; y < h / 2; y++) {
+                mfxU8* row = dst.UV + (size_t)y * pitch;
+                kernels.DeinterleaveUV(src.UV + (size_t)y * pitch, row, row + w / 2, w / 2);
+            }
+
+            auto t2 = std::chrono::high_resolution_clock::now();
+            for (mfxU32 y = 0; y < h / 2; y++) {
+                const mfxU8* row = dst.UV + (size_t)y * pitch;
+                kernels.InterleaveUV(row, row + w / 2, src.UV + (size_t)y * pitch, w / 2);
+            }
+
+            // luma is treated as rows of 16-bit samples like P010 input
+            auto t3 = std::chrono::high_resolution_clock::now();
+            for (mfxU32 y = 0; y < h; y++) {
+                kernels.ShiftLeft16((const mfxU16*)(src.Y + (size_t)y * pitch),
+                                    (mfxU16*)(dst.Y + (size_t)y * pitch),
+                                    w / 2,
+                                    6);
+            }
+            auto t4 = std::chrono::high_resolution_clock::now();
+
+            copy += t1 - t0;
+            deinterleave += t2 - t1;
+            interleave += t3 - t2;
+            shift += t4 - t3;
+        }
+    }
+
+    size_t numCalls     = (size_t)params.numRounds * frames.size();
+    result.copy         = GetGBps(lumaSize * numCalls, copy);
+    result.deinterleave = GetGBps(chromaSize * numCalls, deinterleave);
+    result.interleave   = GetGBps(chromaSize * numCalls, interleave);
+    result.shift        = GetGBps(lumaSize * numCalls, shift);
+
+    for (mfxU32 i = 0; i < frames.size(); i++)
+        allocator.Unlock(allocator.pthis, response.mids[i], &frames[i]);
+    allocator.Free(allocator.pthis, &response);
+    return allocator.Close();
+}
+
+void PrintHelp(const char* app) {
+    printf("Usage: %s [options]\n", app);
+    printf("   [-w width]        - frame width, default 7680\n");
+    printf("   [-h height]       - frame height, default 4320\n");
+    printf("   [-n frames]       - number of frames in the allocation, default 8\n");
+    printf("   [-r rounds]       - number of passes over the frames, default 10\n");
+    printf("   [-opts list]      - allocator options to compare, may be repeated; list is\n"
+           "                       comma separated align64,align4k,slab,thp,hugetlb,numa\n"
+           "                       or 'default'. Without -opts a predefined set is run.\n");
+    printf("Runs copy/convert kernels between the frames and prints GB/s of the output.\n");
+    printf("Fails if the frames are misaligned or overlap.\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    params.width     = 7680;
+    params.height    = 4320;
+    params.numFrames = 8;
+    params.numRounds = 10;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-w")
+            params.width = (mfxU16)atoi(value);
+        else if (arg == "-h")
+            params.height = (mfxU16)atoi(value);
+        else if (arg == "-n")
+            params.numFrames = (mfxU16)atoi(value);
+        else if (arg == "-r")
+            params.numRounds = (mfxU32)atoi(value);
+        else if (arg == "-opts") {
+            mfxU32 options = 0;
+            if (strcmp(value, "default")) {
+                std::string list(value);
+                options = ParseSysMemAllocatorOptions(
+                    std::basic_string<msdk_char>(list.begin(), list.end()).c_str());
+                if (!options) {
+                    PrintHelp(argv[0]);
+                    return 1;
+                }
+            }
+            params.options.push_back(options);
+        }
+        else {
+            PrintHelp(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!params.width || !params.height || (params.width & 31) || (params.height & 1) ||
+        params.numFrames < 2 || !params.numRounds) {
+        printf("error: width must be a multiple of 32, height even, at least 2 frames\n");
+        return 1;
+    }
+
+    if (params.options.empty()) {
+        params.options = { 0,
+                           SYSMEM_ALLOC_ALIGN64,
+                           SYSMEM_ALLOC_ALIGN4K,
+                           SYSMEM_ALLOC_SLAB | SYSMEM_ALLOC_ALIGN4K,
+                           SYSMEM_ALLOC_SLAB | SYSMEM_ALLOC_THP,
+                           SYSMEM_ALLOC_SLAB | SYSMEM_ALLOC_HUGETLB,
+                           SYSMEM_ALLOC_SLAB | SYSMEM_ALLOC_THP | SYSMEM_ALLOC_NUMA };
+    }
+
+    static const char* isaNames[] = { "scalar", "sse2", "avx2", "avx512" };
+    printf("%ux%u NV12, %u frames, %u rounds, %s kernels, GB/s of the output\n",
+           params.width,
+           params.height,
+           params.numFrames,
+           params.numRounds,
+           isaNames[GetFrameKernels().isa]);
+    printf("%-28s %10s %10s %10s %10s\n", "options", "copy", "deinterl", "interl", "shift16");
+
+    bool ok = true;
+    for (mfxU32 options : params.options) {
+        BenchResult result = {};
+        mfxStatus sts = RunBench(params, options, result);
+        if (sts != MFX_ERR_NONE) {
+            printf("%-28s failed, status %d\n", OptionsToStr(options).c_str(), (int)sts);
+            ok = false;
+            continue;
+        }
+        printf("%-28s %10.2f %10.2f %10.2f %10.2f\n",
+               OptionsToStr(options).c_str(),
+               result.copy,
+               result.deinterleave,
+               result.interleave,
+               result.shift);
+    }
+    return ok ? 0 : 1;
+}
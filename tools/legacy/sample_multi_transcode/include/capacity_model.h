@@ -0,0 +1,120 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __CAPACITY_MODEL_H__
+#define __CAPACITY_MODEL_H__
+
+#include <map>
+#include <set>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+namespace TranscodingSample {
+
+// Configuration of a session which the cost is measured for
+struct SessionCostKey {
+    SessionCostKey() : decodeId(0), encodeId(0), width(0), height(0), targetUsage(0) {}
+
+    bool operator<(const SessionCostKey& other) const;
+
+    mfxU32 decodeId; // 0 - frames are taken from another session
+    mfxU32 encodeId;
+    mfxU16 width; // of the encoded frames
+    mfxU16 height;
+    mfxU16 targetUsage; // 0 isn't used, it's MFX_TARGETUSAGE_BALANCED
+};
+
+// Throughput of the device for the measured configurations. The profile file has a line per
+// configuration:
+//   <decoder> <encoder> <width>x<height> <target usage> <fps> <frames> <missed frames>
+// fps is measured by a session run alone, frames and missed frames are the ones of real-time
+// sessions run since the calibration and the frames which missed their deadlines.
+class CCapacityModel {
+public:
+    CCapacityModel();
+
+    // The model is empty if the file doesn't exist
+    mfxStatus Load(const msdk_char* fileName);
+    mfxStatus Save(const msdk_char* fileName) const;
+
+    // Sets the throughput of the configuration, the missed deadlines are forgotten
+    void Calibrate(const SessionCostKey& key, mfxF64 fps);
+    // Adds the frames of a finished real-time session, the more frames missed their deadlines
+    // the more expensive the configuration gets
+    void AddDeadlineMisses(const SessionCostKey& key, mfxU32 numFrames, mfxU32 numMissed);
+    // Share of the device a session takes to process fps frames per second. The throughput of
+    // a resolution which isn't measured is scaled from the nearest one. Returns false if the
+    // codecs and the target usage aren't calibrated.
+    bool GetCost(const SessionCostKey& key, mfxF64 fps, mfxF64& cost) const;
+
+    bool IsEmpty() const {
+        return m_entries.empty();
+    }
+
+protected:
+    struct Entry {
+        Entry() : fps(0), numFrames(0), numMissed(0) {}
+
+        mfxF64 fps;
+        mfxU64 numFrames;
+        mfxU64 numMissed;
+    };
+    typedef std::map<SessionCostKey, Entry> EntryMap;
+
+    // Returns the entry of the same codecs and target usage with the closest resolution
+    EntryMap::const_iterator FindNearest(const SessionCostKey& key) const;
+
+    EntryMap m_entries;
+};
+
+// Admits real-time sessions (the ones with -fps) while the sum of their costs fits the share of
+// the device. A session which doesn't fit is given a faster target usage if there is one that
+// fits, otherwise it's rejected. Sessions without -fps have no deadlines and aren't counted.
+class CAdmissionController {
+public:
+    // Share of the device (%) real-time sessions take by default, the rest is the margin for
+    // the estimation error
+    enum { DEFAULT_LOAD = 90 };
+
+    CAdmissionController();
+
+    mfxStatus Init(const msdk_char* profileName, mfxU32 maxLoad);
+
+    // Called by the session before its encoder is initialized, the target usage of the key may
+    // be raised. Returns false if the session is rejected.
+    bool Admit(mfxU32 id, SessionCostKey& key, mfxU32 fps);
+    bool IsRejected(mfxU32 id) const {
+        return m_rejected.find(id) != m_rejected.end();
+    }
+    // Frees the share taken by the finished session and feeds its missed deadlines back into
+    // the model
+    void Complete(mfxU32 id, mfxU32 numFrames, mfxU32 numMissed);
+    // Saves the model if it was changed by the finished sessions
+    mfxStatus Save();
+
+protected:
+    struct Admission {
+        Admission() : key(), cost(0) {}
+
+        SessionCostKey key;
+        mfxF64 cost;
+    };
+
+    msdk_string m_profileName;
+    CCapacityModel m_model;
+    mfxF64 m_maxLoad;
+    mfxF64 m_load; // sum of the costs of the admitted sessions
+    std::map<mfxU32, Admission> m_admitted;
+    std::set<mfxU32> m_rejected;
+    bool m_bModelChanged;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CAdmissionController);
+};
+} // namespace TranscodingSample
+
+#endif //__CAPACITY_MODEL_H__
@@ -0,0 +1,157 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __METRICS_EXPORTER_H__
+#define __METRICS_EXPORTER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+namespace TranscodingSample {
+
+// Histogram of durations, observed by the session thread and read by the exporter
+class CLatencyHistogram {
+public:
+    // upper bounds of the buckets (us), the last bucket has no bound
+    enum { NUM_BOUNDS = 11 };
+    static const msdk_tick BOUNDS[NUM_BOUNDS];
+
+    CLatencyHistogram();
+
+    void Observe(msdk_tick duration);
+    // counts aren't cumulative, sum is in us
+    void Read(mfxU64 counts[NUM_BOUNDS + 1], mfxU64& sum) const;
+
+protected:
+    std::atomic<mfxU64> m_counts[NUM_BOUNDS + 1];
+    std::atomic<mfxU64> m_sum;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CLatencyHistogram);
+};
+
+// Live statistics of a session. The pipeline updates them while it runs, the launcher sets
+// the state of the session.
+class CSessionMetrics {
+public:
+    enum Stage { STAGE_DECODE, STAGE_VPP, STAGE_ENCODE, STAGE_SYNC, STAGE_FRAME, NUM_STAGES };
+    enum Pool { POOL_DECODE, POOL_ENCODE, POOL_SCALER, NUM_POOLS };
+
+    CSessionMetrics();
+
+    // frame is processed in duration, it missed its deadline if it took longer than -fps gives
+    void AddFrame(msdk_tick duration, bool bMissed);
+    void SetSurfacePool(Pool pool, mfxU32 used, mfxU32 size) {
+        poolUsed[pool] = used;
+        poolSize[pool] = size;
+    }
+
+    CLatencyHistogram latency[NUM_STAGES];
+    std::atomic<mfxU64> numFrames;
+    std::atomic<mfxU64> numMissed;
+    std::atomic<mfxU32> poolUsed[NUM_POOLS];
+    std::atomic<mfxU32> poolSize[NUM_POOLS];
+    // encoded frames waiting for sync and output
+    std::atomic<mfxU32> bitstreamQueue;
+    std::atomic<mfxU64> numGpuHangs;
+    // session finished with an error
+    std::atomic<mfxU64> numFailures;
+    std::atomic<bool> bRunning;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSessionMetrics);
+};
+
+// Adds the duration of the scope to the histogram of the stage, does nothing without metrics
+class CStageTimer {
+public:
+    CStageTimer(CSessionMetrics* pMetrics, CSessionMetrics::Stage stage)
+            : m_pMetrics(pMetrics),
+              m_stage(stage),
+              m_start(pMetrics ? msdk_time_get_tick() : 0) {}
+    ~CStageTimer() {
+        if (m_pMetrics)
+            m_pMetrics->latency[m_stage].Observe(msdk_time_get_tick() - m_start);
+    }
+
+protected:
+    CSessionMetrics* m_pMetrics;
+    CSessionMetrics::Stage m_stage;
+    msdk_tick m_start;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CStageTimer);
+};
+
+// Periodically renders the metrics of the sessions as OpenMetrics text. The text replaces the
+// file as a whole, so a reader never sees a partial one, and it's served over HTTP on a port of
+// the local host, e.g. "curl http://127.0.0.1:<port>/metrics".
+class CMetricsExporter {
+public:
+    enum { DEFAULT_INTERVAL = 1000 }; // ms
+
+    CMetricsExporter();
+    virtual ~CMetricsExporter();
+
+    // Sessions and queues are added while the exporter runs, they are never removed
+    void AddSession(mfxU32 session, std::shared_ptr<CSessionMetrics> pMetrics);
+    // Queue of surfaces between the sessions, getLength returns the number of its surfaces
+    void AddQueue(mfxU32 queue, std::function<mfxU32()> getLength);
+
+    // fileName or port may be not set (NULL or 0)
+    mfxStatus Start(const msdk_char* fileName, mfxU16 port, mfxU32 interval);
+    // Writes the last metrics
+    void Stop();
+
+    // Returns the current metrics of all sessions, the text ends with "# EOF"
+    std::string Render();
+
+protected:
+    struct Session {
+        Session() : pMetrics(), lastFrames(0), fps(0) {}
+
+        std::shared_ptr<CSessionMetrics> pMetrics;
+        mfxU64 lastFrames;
+        mfxF64 fps; // over the last interval
+    };
+
+    void ExportRoutine();
+    // updates the frame rates of the sessions
+    void Update(mfxF64 elapsed);
+    mfxStatus WriteFile(const std::string& text);
+    mfxStatus Listen(mfxU16 port);
+    // Answers the connections made until timeout (ms), returns true once the exporter is
+    // stopped
+    bool Serve(mfxU32 timeout);
+
+    std::mutex m_mutex;
+    std::map<mfxU32, Session> m_sessions;
+    std::map<mfxU32, std::function<mfxU32()>> m_queues;
+
+    msdk_string m_fileName;
+    mfxU32 m_interval;
+    int m_socket;
+
+    std::thread m_thread;
+    std::mutex m_stopMutex;
+    std::condition_variable m_stopCondition;
+    bool m_bStop;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CMetricsExporter);
+};
+} // namespace TranscodingSample
+
+#endif //__METRICS_EXPORTER_H__
@@ -22,20 +22,29 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 
 #include <stddef.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <fstream>
 #include <future>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "base_allocator.h"
+#include "bitstream_pool.h"
+#include "capacity_model.h"
+#include "lockfree_ring.h"
+#include "metrics_exporter.h"
 #include "mfx_multi_vpp.h"
 #include "rotate_plugin_api.h"
 #include "sample_defs.h"
 #include "sample_utils.h"
+#include "session_scheduler.h"
 #include "sysmem_allocator.h"
 
 #include "mfxdispatcher.h"
@@ -71,6 +80,8 @@ or https://software.intel.com/en-us/media-client-solutions-support.
 #define TIME_STATS 1 // Enable statistics processing
 #include "time_statistics.h"
 
+#include "quality_meter.h"
+
 #if defined(_WIN32) || defined(_WIN64)
     #include "decode_render.h"
 #endif
@@ -107,6 +118,9 @@ enum PipelineMode {
 
 enum VppCompDumpMode { NULL_RENDER_VPP_COMP = 1, DUMP_FILE_VPP_COMP = 2 };
 
+// Special values of sInputParams::nNumaNode
+enum { NUMA_NODE_NOT_SET = -1, NUMA_NODE_AUTO = -2 };
+
 enum EFieldCopyMode { FC_NONE = 0, FC_T2T = 1, FC_T2B = 2, FC_B2T = 4, FC_B2B = 8, FC_FR2FR = 16 };
 
 struct sVppCompDstRect {
@@ -197,6 +211,16 @@ struct __sInputParams {
     mfxU16 nThreadsNum; // number of internal session threads number
     bool bRobustFlag; // Robust transcoding mode. Allows auto-recovery after hardware errors
     bool bSoftRobustFlag;
+    bool bAsyncWrite; // write output file from a dedicated I/O thread
+    bool bDirectIO; // use O_DIRECT for the asynchronous output
+    mfxU32 nReadBatch; // number of raw input frames read at once, 0 - frame by frame
+    bool bFrameRange; // transcode only a range of the input frames
+    mfxU32 nRangeFirst; // the range starts at the key frame at or before this frame
+    mfxU32 nRangeCount; // number of frames in the range, 0 - till the end of stream
+    bool bPersistIndex; // keep the index of the input frames in '<input>.idx'
+    mfxU32 nSysMemOptions; // SysMemAllocatorOptions of system memory frames
+    mfxI32 nNumaNode; // node of the session threads and system memory frames
+    mfxU32 nQualityMetrics; // QualityMetricsFlags measured on the encoder output
 
     mfxU32 EncodeId; // type of output coded video
     mfxU32 DecodeId; // type of input coded video
@@ -327,6 +351,8 @@ struct __sInputParams {
 
     mfxI32 monitorType;
     bool shouldUseGreedyFormula;
+    bool bUseScheduler; // run sessions on the threads of CSessionScheduler
+    mfxU32 nSchedThreads; // threads of the scheduler, 0 - one per logical processor
     bool enableQSVFF;
     bool bSingleTexture;
 
@@ -378,6 +404,14 @@ struct __sInputParams {
 struct sInputParams : public __sInputParams {
     sInputParams();
     msdk_string DumpLogFileName;
+    // logical processors of the session threads, empty - not restricted
+    std::vector<mfxU32> cpuSet;
+    // buffers of the encoded frames, shared by the sessions, NULL - session's own
+    std::shared_ptr<CBitstreamBufferPool> pBitstreamPool;
+    // admits the real-time session before its encoder is initialized, NULL - not controlled
+    std::shared_ptr<CAdmissionController> pAdmission;
+    // live statistics of the session for the metrics exporter, NULL - not collected
+    std::shared_ptr<CSessionMetrics> pMetrics;
 #if MFX_VERSION >= 1022
     std::vector<mfxExtEncoderROI> m_ROIData;
 
@@ -389,6 +423,10 @@ struct sInputParams : public __sInputParams {
 #endif
 };
 
+// Traces threads of 1:N pipelines to Chrome trace files. Every thread writes events
+// to its own ring without locks, a background thread flushes them to the current
+// trace file periodically and starts the next file when it's large enough, so the
+// tracing of a long run takes a fixed amount of memory.
 class SMTTracer {
 public:
     enum class ThreadType { DEC, CSVPP, VPP, ENC };
@@ -396,8 +434,9 @@ public:
     enum class EventName {
         UNDEF,
         BUSY,
-        SYNC
-        //SURF_POOL
+        SYNC,
+        SURF_POOL, // counter of free surfaces of a pool
+        QUEUE // counter of surfaces waiting in the buffer of a session
     };
 
     enum class EventType { DurationStart, DurationEnd, FlowStart, FlowEnd, Counter };
@@ -410,7 +449,7 @@ public:
         EventName Name; //optional, if not specifyed thread name will be used
         mfxU32 EvID; //unique event ID
         mfxU64 InID; //unique dependency ID, e.g. surface pointer
-        mfxU64 OutID;
+        mfxU64 OutID; //size of the pool for SURF_POOL counter
         mfxU64 TS; //time stamp
     };
 
@@ -431,9 +470,22 @@ public:
     void AddCounterEvent(const ThreadType thType,
                          const mfxU32 thID,
                          const EventName name,
-                         const mfxU64 counter);
+                         const mfxU64 counter,
+                         const mfxU64 total = 0);
+
+    bool IsEnabled() const {
+        return Enabled;
+    }
 
 private:
+    // events of a thread, written by the thread only and read by the flush
+    struct ThreadLog {
+        explicit ThreadLog(mfxU32 capacity) : Ring(capacity), Retired(false) {}
+
+        CLockFreeRing<Event> Ring;
+        std::atomic<bool> Retired; // thread has exited
+    };
+
     //runtime functions
     void AddEvent(const EventType evType,
                   const ThreadType thType,
@@ -442,11 +494,14 @@ private:
                   const void* inID,
                   const void* outID);
     mfxU64 GetCurrentTS();
+    ThreadLog& GetThreadLog();
 
     //log generation functions
-    void SaveTrace(mfxU32 FileID);
+    void FlushRoutine();
+    void Flush();
+    void SaveEvent(const Event& ev);
+    void OpenNextTraceFile();
 
-    void AddFlowEvents();
     void AddFlowEvent(const Event a, const Event b);
 
     void WriteEvent(const Event ev, std::ofstream& TraceFile);
@@ -466,14 +521,33 @@ private:
     void WriteEvID(const Event ev, std::ofstream& TraceFile);
     void WriteComma(std::ofstream& TraceFile);
 
-    const static mfxU32 TraceBufferSizeInMBytes = 7;
+    // events a thread keeps till the flush, new events are dropped when it's full
+    const static mfxU32 ThreadLogEvents = 1 << 16;
+    const static mfxU32 FlushIntervalMs = 500;
+    // events in a trace file, the next file is started after that
+    const static mfxU32 MaxFileEvents = 1000000;
 
     bool Enabled = false;
-    mfxU32 EvID  = 0;
-    std::vector<Event> Log;
-    std::vector<Event> AddonLog;
+    mfxU64 TracerID; // tells thread logs of this tracer from logs of destroyed ones
+    mfxU32 EvID = 0;
     std::chrono::steady_clock::time_point TimeBase;
-    std::mutex TracerFileMutex;
+
+    std::vector<std::shared_ptr<ThreadLog>> Logs;
+    std::mutex LogsMutex;
+    std::atomic<mfxU64> DroppedEvents;
+
+    std::thread FlushThread;
+    std::atomic<bool> StopFlush;
+    CWaitPoint FlushWakeup;
+
+    // state of the flush thread
+    std::vector<Event> Batch;
+    std::unordered_map<mfxU64, Event> LastEnds; // last DurationEnd by its OutID
+    std::ofstream TraceFile;
+    mfxU32 FileID = 0;
+    mfxU32 FileIndex = 0;
+    mfxU32 FileEvents = 0;
+    mfxU64 SavedEvents = 0;
 };
 
 static const mfxU32 DecoderTargetID = 100;
@@ -549,6 +623,7 @@ struct ExtendedBS {
     mfxBitstreamWrapper Bitstream;
     mfxSyncPoint Syncp     = nullptr;
     PreEncAuxBuffer* pCtrl = nullptr;
+    ExtendedBS* pNextFree  = nullptr; // in the free list of ExtendedBSStore
 };
 
 class CIOStat : public CTimeStatistics {
@@ -569,6 +644,10 @@ public:
         ofile = file;
     }
 
+    inline FILE* GetOutputFile() const {
+        return ofile;
+    }
+
     inline void SetDumpName(const msdk_char* name) {
         DumpLogFileName = name;
         if (!DumpLogFileName.empty()) {
@@ -638,37 +717,53 @@ protected:
     msdk_char bufDir[MAX_PREF_LEN];
 };
 
+// Bitstreams of the encoding session. Free bitstreams are linked in a list, so
+// taking and returning one doesn't depend on the async depth. Buffers come from
+// the pool which may be shared with other sessions.
 class ExtendedBSStore {
 public:
-    explicit ExtendedBSStore(mfxU32 size) {
-        m_pExtBS.resize(size);
+    ExtendedBSStore(mfxU32 size, std::shared_ptr<CBitstreamBufferPool> pPool)
+            : m_pExtBS(size),
+              m_pFree(NULL),
+              m_pPool(pPool ? pPool : std::make_shared<CBitstreamBufferPool>()),
+              m_BufferSize(0) {
+        ReleaseAll();
     }
     virtual ~ExtendedBSStore() {
-        m_pExtBS.clear();
+        for (ExtendedBS& extBS : m_pExtBS) {
+            extBS.Bitstream.DataLength = 0;
+            m_pPool->Release(extBS.Bitstream.Exchange(std::vector<mfxU8>()));
+        }
     }
     ExtendedBS* GetNext() {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            if (m_pExtBS[i].IsFree) {
-                m_pExtBS[i].IsFree = false;
-                return &m_pExtBS[i];
-            }
-        }
-        return NULL;
+        ExtendedBS* pBS = m_pFree;
+        if (!pBS)
+            return NULL;
+
+        m_pFree        = pBS->pNextFree;
+        pBS->pNextFree = NULL;
+        pBS->IsFree    = false;
+        // catch up with the buffers grown since the bitstream was used
+        if (pBS->Bitstream.MaxLength && pBS->Bitstream.MaxLength < m_BufferSize)
+            Grow(pBS->Bitstream, m_BufferSize);
+        return pBS;
     }
     void Release(ExtendedBS* pBS) {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            if (&m_pExtBS[i] == pBS) {
-                m_pExtBS[i].IsFree = true;
-                return;
-            }
-        }
-        return;
+        if (!pBS || pBS < m_pExtBS.data() || pBS >= m_pExtBS.data() + m_pExtBS.size() ||
+            pBS->IsFree)
+            return;
+
+        pBS->IsFree    = true;
+        pBS->pNextFree = m_pFree;
+        m_pFree        = pBS;
     }
     void ReleaseAll() {
-        for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
-            m_pExtBS[i].IsFree = true;
+        m_pFree = NULL;
+        for (size_t i = m_pExtBS.size(); i > 0; i--) {
+            m_pExtBS[i - 1].IsFree    = true;
+            m_pExtBS[i - 1].pNextFree = m_pFree;
+            m_pFree                   = &m_pExtBS[i - 1];
         }
-        return;
     }
     void FlushAll() {
         for (mfxU32 i = 0; i < m_pExtBS.size(); i++) {
@@ -677,32 +772,76 @@ public:
         }
         return;
     }
+    // Replaces the buffer of the bitstream with one from the pool of at least size
+    // bytes, the data is kept. Bitstreams taken later get buffers of that size.
+    void Grow(mfxBitstreamWrapper& bs, mfxU32 size) {
+        size         = std::max(size, bs.DataLength);
+        m_BufferSize = std::max(m_BufferSize, CBitstreamBufferPool::GetClassSize(size));
+        if (bs.MaxLength >= size)
+            return;
+        m_pPool->Release(bs.Exchange(m_pPool->Acquire(size)));
+    }
 
 protected:
     std::vector<ExtendedBS> m_pExtBS;
+    ExtendedBS* m_pFree; // head of the list of free bitstreams
+    std::shared_ptr<CBitstreamBufferPool> m_pPool;
+    mfxU32 m_BufferSize; // of the largest buffer the encoder needed
 
 private:
     DISALLOW_COPY_AND_ASSIGN(ExtendedBSStore);
 };
 
+// Wakes threads waiting for free surfaces. The counter is increased each time
+// surfaces may have become free: a downstream component released a surface or
+// a task of the pipeline was synchronized. Waiter reads the counter before it
+// looks for a free surface and sleeps only while the counter is unchanged, so
+// a release made during the lookup isn't missed.
+class SurfaceAvailabilityEvent {
+public:
+    SurfaceAvailabilityEvent() : m_mutex(), m_cv(), m_counter(0) {}
+
+    mfxU64 GetCounter();
+    void Signal();
+    // Returns true if the counter differs from 'counter', false on timeout
+    bool Wait(mfxU64 counter, mfxU32 msec);
+
+protected:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    mfxU64 m_counter;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(SurfaceAvailabilityEvent);
+};
+
 class CTranscodingPipeline;
 // thread safety buffer heterogeneous pipeline
 // only for join sessions
+//
+// Each buffer has one producer, the decoding session. In 1:N mode it adds every
+// surface to the buffers of all encoding sessions and each of them consumes its
+// own buffer, surfaces are reference counted through Data.Locked. In N:1 mode the
+// composing session consumes the buffers of all decoding sessions. Surfaces are
+// passed through a lock-free ring, threads sleep only when the buffer is empty
+// (or full) and are woken only if they sleep.
 class SafetySurfaceBuffer {
 public:
     //this is used only for sanity check
     mfxU32 TargetID = 0;
 
-    struct SurfaceDescriptor {
-        SurfaceDescriptor() : ExtSurface(), Locked(false) {}
-        ExtendedSurface ExtSurface;
-        mfxU32 Locked;
-    };
+    // Producer waits for a release when the buffer is full. Buffer holds a lock of
+    // each surface, so it can't have more surfaces than the pools of the producer,
+    // producer with known pools makes room for them by Reserve().
+    enum { DEFAULT_CAPACITY = 256 };
 
-    SafetySurfaceBuffer(SafetySurfaceBuffer* pNext);
+    SafetySurfaceBuffer(SafetySurfaceBuffer* pNext, mfxU32 capacity = DEFAULT_CAPACITY);
     virtual ~SafetySurfaceBuffer();
 
     mfxU32 GetLength();
+    // Grows the buffer to hold numSurfaces surfaces and the end of stream, so the
+    // producer never waits in AddSurface(). Called before the pipelines start.
+    void Reserve(mfxU32 numSurfaces);
     mfxStatus WaitForSurfaceRelease(mfxU32 msec);
     mfxStatus WaitForSurfaceInsertion(mfxU32 msec);
     void AddSurface(ExtendedSurface Surf);
@@ -710,15 +849,21 @@ public:
     mfxStatus ReleaseSurface(mfxFrameSurface1* pSurf);
     mfxStatus ReleaseSurfaceAll();
     void CancelBuffering();
+    // Event is signalled each time a surface is released, listeners are added
+    // before the pipelines start
+    void AddReleaseListener(SurfaceAvailabilityEvent* pEvent);
 
     SafetySurfaceBuffer* m_pNext;
 
 protected:
-    std::mutex m_mutex;
-    std::list<SurfaceDescriptor> m_SList;
-    bool m_IsBufferingAllowed;
-    MSDKEvent* pRelEvent;
-    MSDKEvent* pInsEvent;
+    void NotifyReleaseListeners();
+
+    CLockFreeRing<ExtendedSurface> m_ring;
+    CWaitPoint m_insertion;
+    CWaitPoint m_release;
+    std::atomic<mfxU64> m_numReleased; // for waiters of a release
+    std::vector<SurfaceAvailabilityEvent*> m_releaseListeners;
+    std::atomic<bool> m_IsBufferingAllowed;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(SafetySurfaceBuffer);
@@ -769,6 +914,8 @@ public:
     virtual mfxStatus Reset(VPLImplementationLoader* mfxLoader);
     virtual mfxStatus Join(MFXVideoSession* pChildSession);
     virtual mfxStatus Run();
+    // Resumable Run() of the session which decodes and encodes, see CSchedulerJob::RunStep()
+    virtual mfxStatus RunStep(mfxU32 waitMs);
     virtual mfxStatus FlushLastFrames() {
         return MFX_ERR_NONE;
     }
@@ -776,6 +923,14 @@ public:
     mfxU32 GetProcessFrames() {
         return m_nProcessedFramesNum;
     }
+    // frames which took longer than the time -fps gives to a frame
+    mfxU32 GetDeadlineMisses() {
+        return m_nDeadlineMisses;
+    }
+    // configuration of the encoding session the capacity model measures
+    const SessionCostKey& GetCostKey() {
+        return m_costKey;
+    }
 
     bool GetJoiningFlag() {
         return m_bIsJoinSession;
@@ -797,7 +952,11 @@ public:
 
     msdk_string GetSessionText() {
         msdk_stringstream ss;
-        ss << m_pmfxSession->operator mfxSession();
+        // session is closed once it's finished under control of the launcher
+        if (m_pmfxSession)
+            ss << m_pmfxSession->operator mfxSession();
+        else
+            ss << MSDK_STRING("closed");
 
         return ss.str();
     }
@@ -826,6 +985,11 @@ protected:
     virtual mfxStatus Decode();
     virtual mfxStatus Encode();
     virtual mfxStatus Transcode();
+    // Transcode() split into steps, each of them submits a frame to the encoder
+    virtual void StartTranscode(bool bStepMode);
+    virtual mfxStatus TranscodeStep(mfxU32 waitMs);
+    virtual mfxStatus FinishTranscode(mfxStatus sts, mfxU32 waitMs);
+    mfxStatus RequeueStep();
     virtual mfxStatus DecodeOneFrame(ExtendedSurface* pExtSurface);
     virtual mfxStatus DecodeLastFrame(ExtendedSurface* pExtSurface);
     virtual mfxStatus VPPOneFrame(ExtendedSurface* pSurfaceIn,
@@ -838,6 +1002,9 @@ protected:
     virtual mfxStatus DecodePreInit(sInputParams* pParams);
     virtual mfxStatus VPPPreInit(sInputParams* pParams);
     virtual mfxStatus EncodePreInit(sInputParams* pParams);
+    virtual mfxStatus InitQualityMeter(sInputParams* pParams, VPLImplementationLoader* mfxLoader);
+    // keeps a copy of the encoder input, Syncp of the surface is synchronized with pSession
+    virtual mfxStatus AddQualityReference(const ExtendedSurface& surf, MFXVideoSession* pSession);
 #if !defined(MFX_ONEVPL)
     virtual mfxStatus PreEncPreInit(sInputParams* pParams);
 #endif
@@ -875,6 +1042,14 @@ protected:
 
     mfxFrameSurface1* GetFreeSurface(bool isDec, mfxU64 timeout);
     mfxFrameSurface1* GetFreeSurfaceForCS(bool isDec, mfxU64 timeout, mfxU32 ID);
+    mfxFrameSurface1* WaitForFreeSurface(std::vector<mfxFrameSurface1*>& pool,
+                                         mfxU32& nextSurface,
+                                         SMTTracer::ThreadType thType,
+                                         mfxU32 thID,
+                                         mfxU64 timeout);
+    // stages wait for surfaces and the device no longer than the step in step mode
+    mfxU64 GetSurfaceWaitInterval() const;
+    void WaitForDevice(MFXVideoSession& session, mfxSyncPoint& syncPoint, mfxStatus& sts);
     mfxU32 GetFreeSurfacesCount(bool isDec);
     PreEncAuxBuffer* GetFreePreEncAuxBuffer();
     void SetEncCtrlRT(ExtendedSurface& extSurface, bool bInsertIDR);
@@ -897,7 +1072,10 @@ protected:
     void FreeMVCSeqDesc();
 
     mfxStatus AllocateSufficientBuffer(mfxBitstreamWrapper* pBS);
-    mfxStatus PutBS();
+    // Returns MFX_TASK_WORKING if the bitstream isn't ready in waitMs shorter than
+    // MSDK_WAIT_INTERVAL, the bitstream stays in the pool then
+    mfxStatus PutBS(mfxU32 waitMs = MSDK_WAIT_INTERVAL);
+    mfxStatus FlushQualityMeter();
 
     mfxStatus DumpSurface2File(mfxFrameSurface1* pSurface);
     mfxStatus Surface2BS(ExtendedSurface* pSurf, mfxBitstreamWrapper* pBS, mfxU32 fourCC);
@@ -916,6 +1094,7 @@ protected:
     void SetNumFramesForReset(mfxU32 nFrames);
 
     void HandlePossibleGpuHang(mfxStatus& sts);
+    void AddFrameMetrics(msdk_tick nFrameTime);
 
     mfxStatus SetAllocatorAndHandleIfRequired();
     mfxStatus LoadGenericPlugin();
@@ -935,6 +1114,7 @@ protected:
     std::unique_ptr<MFXVideoENCODE> m_pmfxENC;
     std::unique_ptr<MFXVideoMultiVPP>
         m_pmfxVPP; // either VPP or VPPPlugin which wraps [VPP]-Plugin-[VPP] pipeline
+    std::unique_ptr<CEncodeQualityMeter> m_pQualityMeter;
 #if !defined(MFX_ONEVPL)
     std::unique_ptr<MFXVideoENC> m_pmfxPreENC;
     std::unique_ptr<MFXVideoUSER> m_pUserDecoderModule;
@@ -967,6 +1147,12 @@ protected:
     SurfPointersArray m_pSurfaceDecPool;
     SurfPointersArray m_pSurfaceEncPool;
     std::map<mfxU32, SurfPointersArray> m_CSSurfacePools;
+    // lookup of a free surface starts from these positions of the pools, entries of
+    // the scaler pools are created with the pools, so their threads don't insert
+    mfxU32 m_nNextDecSurface;
+    mfxU32 m_nNextEncSurface;
+    std::map<mfxU32, mfxU32> m_nNextCSSurface;
+    SurfaceAvailabilityEvent m_surfaceEvent;
 
     mfxU16 m_EncSurfaceType; // actual type of encoder surface pool
     mfxU16 m_DecSurfaceType; // actual type of decoder surface pool
@@ -1026,6 +1212,46 @@ protected:
     mfxU16 m_MemoryModel;
 
     mfxSyncPoint m_LastDecSyncPoint;
+    mfxSyncPoint m_LastVppSyncPoint;
+    mfxSyncPoint m_LastEncSyncPoint;
+    std::map<mfxU32, mfxSyncPoint> m_LastCSVppSyncPoints; // entries created by AllocFrames()
+
+    // State of Transcode() kept between the steps
+    struct TranscodeState {
+        TranscodeState()
+                : DecExtSurface(),
+                  VppExtSurface(),
+                  bStarted(false),
+                  bStepMode(false),
+                  bFlushing(false),
+                  bNeedDecodedFrames(true),
+                  bEndOfFile(false),
+                  bLastCycle(false),
+                  shouldReadNextFrame(true),
+                  start(0),
+                  nNextFrameTime(0),
+                  resumeStage(STAGE_DECODE),
+                  nWaitMs(0),
+                  nStallStart(0) {}
+
+        ExtendedSurface DecExtSurface;
+        ExtendedSurface VppExtSurface;
+        bool bStarted;
+        bool bStepMode; // steps return instead of sleeping and waiting for the device
+        bool bFlushing; // all frames are submitted, encoded bitstreams are written
+        bool bNeedDecodedFrames; // indicates if we need to decode frames
+        bool bEndOfFile;
+        bool bLastCycle;
+        bool shouldReadNextFrame;
+        time_t start;
+        msdk_tick nNextFrameTime; // the next frame is submitted not earlier in step mode
+        // stage which returned MFX_TASK_WORKING, the next step calls it again
+        enum Stage { STAGE_DECODE, STAGE_VPP, STAGE_ENCODE };
+        Stage resumeStage;
+        mfxU32 nWaitMs; // waits for surfaces and the device of the current step
+        msdk_tick nStallStart; // steps are requeued since then, 0 if the last one made progress
+    };
+    TranscodeState m_TranscodeState;
 
     SafetySurfaceBuffer* m_pBuffer;
     CTranscodingPipeline* m_pParentPipeline;
@@ -1054,6 +1280,9 @@ protected:
     FileBitstreamProcessor* m_pBSProcessor;
 
     msdk_tick m_nReqFrameTime; // time required to transcode one frame
+    mfxU32 m_nDeadlineMisses;
+    SessionCostKey m_costKey;
+    std::shared_ptr<CSessionMetrics> m_pMetrics;
 
     mfxU32 statisticsWindowSize; // Sliding window size for Statistics
     mfxU32 m_nOutputFramesNum;
@@ -1107,7 +1336,7 @@ private:
     DISALLOW_COPY_AND_ASSIGN(CTranscodingPipeline);
 };
 
-struct ThreadTranscodeContext {
+struct ThreadTranscodeContext : public CSchedulerJob {
     // Pointer to the session's pipeline
     std::unique_ptr<CTranscodingPipeline> pPipeline;
     // Pointer to bitstream handling object
@@ -1122,25 +1351,76 @@ struct ThreadTranscodeContext {
 
     // Number of processed frames
     mfxU32 numTransFrames = 0;
+    // Number of frames which missed their deadlines
+    mfxU32 numDeadlineMisses = 0;
     // Status of the finished session
     mfxStatus transcodingSts = MFX_ERR_NONE;
 
     // Thread handle
     std::future<void> handle;
+    // Processors of the session thread, empty - not restricted
+    std::vector<mfxU32> cpuSet;
+
+    // Index of the session the launcher is notified with when the session is finished
+    size_t index                         = 0;
+    CSessionCompletionQueue* pCompletion = nullptr;
+    // Session is finished and its resources are freed by the launcher
+    bool bReleased = false;
+    // Session isn't run, the device has no share left for it
+    bool bRejected = false;
+    // Start of the session run by the scheduler
+    std::chrono::system_clock::time_point start_time;
+    bool bStarted = false;
 
     void TranscodeRoutine() {
         using namespace std::chrono;
-        MSDK_CHECK_POINTER_NO_RET(pPipeline);
         transcodingSts = MFX_ERR_NONE;
 
-        auto start_time = system_clock::now();
-        while (MFX_ERR_NONE == transcodingSts) {
-            transcodingSts = pPipeline->Run();
+        if (!cpuSet.empty() && MFX_ERR_NONE != msdk_thread_set_affinity(cpuSet))
+            msdk_printf(MSDK_STRING("Warning: failed to set processors of session %d\n"),
+                        (int)index);
+
+        if (pPipeline) {
+            auto start_time = system_clock::now();
+            while (MFX_ERR_NONE == transcodingSts) {
+                transcodingSts = pPipeline->Run();
+            }
+            working_time =
+                duration_cast<duration<mfxF64>>(system_clock::now() - start_time).count();
+
+            MSDK_IGNORE_MFX_STS(transcodingSts, MFX_WRN_VALUE_NOT_CHANGED);
+            numTransFrames    = pPipeline->GetProcessFrames();
+            numDeadlineMisses = pPipeline->GetDeadlineMisses();
+        }
+
+        if (pCompletion)
+            pCompletion->Push(index);
+    }
+
+    virtual mfxStatus RunStep(mfxU32 waitMs) {
+        MSDK_CHECK_POINTER(pPipeline, MFX_ERR_NULL_PTR);
+        if (!bStarted) {
+            start_time = std::chrono::system_clock::now();
+            bStarted   = true;
         }
+        return pPipeline->RunStep(waitMs);
+    }
+
+    virtual void OnComplete(mfxStatus sts) {
+        using namespace std::chrono;
+        transcodingSts = sts;
+        bStarted       = false;
+
         working_time = duration_cast<duration<mfxF64>>(system_clock::now() - start_time).count();
 
         MSDK_IGNORE_MFX_STS(transcodingSts, MFX_WRN_VALUE_NOT_CHANGED);
-        numTransFrames = pPipeline->GetProcessFrames();
+        if (pPipeline) {
+            numTransFrames    = pPipeline->GetProcessFrames();
+            numDeadlineMisses = pPipeline->GetDeadlineMisses();
+        }
+
+        if (pCompletion)
+            pCompletion->Push(index);
     }
 };
 } // namespace TranscodingSample
@@ -25,7 +25,9 @@ or https://software.intel.com/en-us/media-client-solutions-support.
     #include "mfxadapter.h"
 #endif
 
+#include "capacity_model.h"
 #include "pipeline_transcode.h"
+#include "session_control.h"
 #include "sample_utils.h"
 #include "transcode_utils.h"
 #include "vpl_implementation_loader.h"
@@ -65,10 +67,38 @@ protected:
                                            CTranscodingPipeline* pParentPipeline);
 #endif
     virtual mfxStatus VerifyCrossSessionsOptions();
+    // resolves automatic NUMA placement and processors of the nodes
+    virtual mfxStatus PlaceSessions();
+    virtual mfxStatus PlaceSession(sInputParams& params, size_t index);
+    // threads started during the session init, like I/O ones, inherit the processors
+    void SetInitThreadAffinity(const std::vector<mfxU32>& cpus);
     virtual mfxStatus CreateSafetyBuffers();
+    // opens the input and the output of the session
+    virtual mfxStatus CreateBitstreamProcessor(const sInputParams& params,
+                                               std::unique_ptr<FileBitstreamProcessor>& pProcessor);
     CascadeScalerConfig& CreateCascadeScalerConfig();
+    // all sessions can be split into steps run by CSessionScheduler
+    virtual bool CanUseScheduler();
     virtual void DoTranscoding();
     virtual void DoRobustTranscoding();
+    // runs the sessions one by one and stores their throughput in the calibration profile
+    virtual void DoCalibration();
+    // runs the session on its own thread or by the scheduler if it's given
+    virtual void StartSession(size_t index, CSessionScheduler* pScheduler);
+
+    // Initializes and starts a session while others run. The session decodes and encodes,
+    // it takes the loader and the device of the first session. Returns MFX_WRN_DEVICE_BUSY
+    // if admission control rejects the session.
+    virtual mfxStatus AddSession(const msdk_string& line,
+                                 CSessionScheduler* pScheduler,
+                                 CSessionCompletionQueue* pCompletion);
+    // creates the context of the session with the parameters added last
+    virtual mfxStatus CreateSession(size_t index);
+    // executes the new commands of the control file, returns the number of started sessions
+    virtual size_t ProcessControlCommands(CSessionScheduler* pScheduler,
+                                          CSessionCompletionQueue* pCompletion);
+    // frees the runtime session, frames and files of the finished session
+    virtual void ReleaseSession(size_t index);
 
     virtual void Close();
 
@@ -87,6 +117,8 @@ protected:
     std::vector<std::unique_ptr<FileBitstreamProcessor>> m_pExtBSProcArray;
     std::vector<std::shared_ptr<mfxAllocatorParams>> m_pAllocParams;
     std::vector<std::unique_ptr<CHWDevice>> m_hwdevs;
+    // device handles of the sessions
+    std::vector<mfxHDL> m_hdls;
     msdk_tick m_StartTime;
     // need to work with HW pipeline
     mfxHandleType m_eDevType;
@@ -99,6 +131,22 @@ protected:
 
     CascadeScalerConfig m_CSConfig;
     SMTTracer m_Tracer;
+    // processors of the launcher thread, restored after the sessions are initialized
+    std::vector<mfxU32> m_launcherCpus;
+    // node of the next session placed automatically
+    mfxU32 m_nextNumaNode;
+
+    std::unique_ptr<CSessionControl> m_pControl;
+    // options of the sessions started again once they are finished
+    std::map<size_t, msdk_string> m_restarts;
+    // indexes of the inputs read by frame ranges, one per file shared by its sessions
+    std::map<msdk_string, std::shared_ptr<const CStreamIndex>> m_streamIndexes;
+    bool m_bQuit;
+
+    // admits real-time sessions by the capacity profile, NULL - all are admitted
+    std::shared_ptr<CAdmissionController> m_pAdmission;
+    // exports the statistics of the sessions, NULL without -openmetrics and -openmetrics_port
+    std::unique_ptr<CMetricsExporter> m_pMetrics;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(Launcher);
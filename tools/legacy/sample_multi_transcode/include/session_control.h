@@ -0,0 +1,59 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SESSION_CONTROL_H__
+#define __SESSION_CONTROL_H__
+
+#include <deque>
+
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+namespace TranscodingSample {
+
+// Command to the running launcher, one line of the control file:
+//   add <session options>              - starts a session described as a line of par file
+//   stop <session>                     - stops the session
+//   restart <session> [session options] - stops the session and starts it again once it's
+//                                        finished, with the new options if they are given
+//   quit                               - stops all sessions, the launcher exits
+struct SessionCommand {
+    enum Type { ADD, STOP, RESTART, QUIT };
+
+    SessionCommand() : type(ADD), session(0), line() {}
+
+    Type type;
+    mfxU32 session; // index of the session for STOP and RESTART
+    msdk_string line; // session options for ADD and RESTART, may be empty for RESTART
+};
+
+// Watches the control file of the launcher. Commands are appended to the file while the
+// launcher runs, e.g. "echo stop 2 >> ctl", the ones which were there at start are skipped.
+class CSessionControl {
+public:
+    // How often the launcher checks for new commands (ms)
+    enum { POLL_INTERVAL = 50 };
+
+    CSessionControl();
+
+    // Creates the file if it doesn't exist
+    mfxStatus Init(const msdk_char* fileName);
+    // Appends the complete lines added to the file since the last call to commands
+    mfxStatus Read(std::deque<SessionCommand>& commands);
+
+protected:
+    // Returns false if the line isn't a command
+    bool ParseCommand(const msdk_string& line, SessionCommand& command);
+
+    msdk_string m_fileName;
+    mfxI64 m_offset; // of the first line which isn't read yet
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSessionControl);
+};
+} // namespace TranscodingSample
+
+#endif //__SESSION_CONTROL_H__
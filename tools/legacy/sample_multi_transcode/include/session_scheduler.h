@@ -0,0 +1,113 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#ifndef __SESSION_SCHEDULER_H__
+#define __SESSION_SCHEDULER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lockfree_ring.h"
+#include "sample_defs.h"
+#include "sample_utils.h"
+
+namespace TranscodingSample {
+
+// Session split into resumable steps, see CSessionScheduler
+class CSchedulerJob {
+public:
+    virtual ~CSchedulerJob() {}
+
+    // Makes one step of the job, may block up to waitMs waiting for the device.
+    // Returns MFX_ERR_NONE if the job has more work, MFX_TASK_WORKING if it's waiting
+    // for the device or its frame rate limit and made no progress, the final status
+    // of the job otherwise.
+    virtual mfxStatus RunStep(mfxU32 waitMs) = 0;
+    // Called once by the thread which made the last step of the job
+    virtual void OnComplete(mfxStatus sts) = 0;
+};
+
+// Runs M jobs on N threads. Every thread has its own queue of jobs, takes the job at
+// the front, makes a few steps of it and puts it back to the end, so a job runs on one
+// thread at a time and a thread serves its jobs in turns. Thread without jobs steals
+// them from the others. Priority of a job sets the number of steps it makes in a turn
+// and the order in which jobs are stolen.
+class CSessionScheduler {
+public:
+    enum { NUM_PRIORITIES = MFX_PRIORITY_HIGH + 1 };
+
+    CSessionScheduler();
+    ~CSessionScheduler();
+
+    // Starts numThreads threads, 0 means one per logical processor
+    mfxStatus Start(mfxU32 numThreads);
+    // Jobs are run until they are finished or the scheduler is stopped
+    mfxStatus Submit(CSchedulerJob* job, mfxPriority priority);
+    // Stops threads, jobs which aren't finished are dropped without OnComplete()
+    void Stop();
+
+    mfxU32 GetNumThreads() const {
+        return (mfxU32)m_workers.size();
+    }
+
+protected:
+    struct Task {
+        CSchedulerJob* job;
+        mfxU32 priority;
+    };
+
+    struct Worker {
+        Worker() : mutex(), queue(), thread() {}
+
+        std::mutex mutex;
+        std::deque<Task> queue;
+        std::thread thread;
+    };
+
+    void WorkerRoutine(mfxU32 id);
+    // Returns the number of tasks in the queue after the push
+    size_t Push(mfxU32 id, const Task& task);
+    bool Pop(mfxU32 id, Task& task);
+    bool Steal(mfxU32 id, Task& task);
+    size_t GetQueueLength(mfxU32 id);
+    // Wakes idle threads to steal the work
+    void Signal();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<mfxU32> m_nextWorker; // receives the next submitted job
+    std::atomic<mfxU64> m_numSignals;
+    std::atomic<bool> m_stop;
+    CWaitPoint m_wakeup;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSessionScheduler);
+};
+
+// Indexes of finished sessions, the launcher waits for them instead of polling sessions
+class CSessionCompletionQueue {
+public:
+    CSessionCompletionQueue() : m_mutex(), m_cv(), m_indexes() {}
+
+    void Push(size_t index);
+    // Returns false if no session has finished in msec
+    bool Pop(size_t& index, mfxU32 msec);
+
+protected:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<size_t> m_indexes;
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(CSessionCompletionQueue);
+};
+} // namespace TranscodingSample
+
+#endif //__SESSION_SCHEDULER_H__
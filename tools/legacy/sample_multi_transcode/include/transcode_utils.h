@@ -68,6 +68,38 @@ public:
     };
     void PrintParFileName();
     msdk_string GetLine(mfxU32 n);
+    void SetLine(mfxU32 n, const msdk_string& line);
+    // File of the commands to the running launcher, NULL if it isn't set
+    const msdk_char* GetControlFileName() {
+        return m_controlName;
+    }
+    // Profile the sessions are calibrated into, NULL if it isn't set
+    const msdk_char* GetCalibrationFileName() {
+        return m_calibrationName;
+    }
+    // Profile the sessions are admitted by, NULL if it isn't set
+    const msdk_char* GetCapacityFileName() {
+        return m_capacityName;
+    }
+    // Share of the device (%) for real-time sessions, 0 - default
+    mfxU32 GetCapacityLoad() {
+        return m_capacityLoad;
+    }
+    // File the metrics are written to, NULL if it isn't set
+    const msdk_char* GetMetricsFileName() {
+        return m_metricsName;
+    }
+    // Local port the metrics are served on, 0 if it isn't set
+    mfxU16 GetMetricsPort() {
+        return m_metricsPort;
+    }
+    // Period of the metrics (ms), 0 - default
+    mfxU32 GetMetricsInterval() {
+        return m_metricsInterval;
+    }
+    // Parses options of one session given as a line of par file, the session isn't
+    // returned by GetNextSessionParams() and its line by GetLine()
+    mfxStatus ParseSessionLine(const msdk_string& line, TranscodingSample::sInputParams& params);
 
 protected:
     mfxStatus ParseParFile(FILE* file);
@@ -89,6 +121,13 @@ protected:
     std::map<mfxU32, sPluginParams> m_encoderPlugins;
     FILE* m_PerfFILE;
     msdk_char* m_parName;
+    msdk_char* m_controlName;
+    msdk_char* m_calibrationName;
+    msdk_char* m_capacityName;
+    mfxU32 m_capacityLoad;
+    msdk_char* m_metricsName;
+    mfxU16 m_metricsPort;
+    mfxU32 m_metricsInterval;
     mfxU32 statisticsWindowSize;
     FILE* statisticsLogFile;
     //store a name of a Logfile
@@ -97,6 +136,8 @@ protected:
     bool bRobustFlag;
     bool bSoftRobustFlag;
     bool shouldUseGreedyFormula;
+    bool bUseScheduler;
+    mfxU32 nSchedThreads;
     std::vector<msdk_string> m_lines;
 
 private:
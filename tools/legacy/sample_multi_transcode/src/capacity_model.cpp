@@ -0,0 +1,277 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "capacity_model.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TranscodingSample {
+
+namespace {
+// Missed deadlines can at most halve the throughput of a configuration
+const mfxF64 MAX_MISS_RATIO = 0.5;
+
+msdk_string CodecToString(mfxU32 codecId) {
+    if (!codecId)
+        return MSDK_STRING("none");
+
+    msdk_string str = CodecIdToStr(codecId);
+    size_t last     = str.find_last_not_of(MSDK_CHAR(' '));
+    return str.substr(0, last + 1);
+}
+
+mfxU32 StringToCodec(const msdk_string& str) {
+    if (str == MSDK_STRING("none") || str.empty() || str.size() > 4)
+        return 0;
+
+    msdk_string fcc = str + msdk_string(4 - str.size(), MSDK_CHAR(' '));
+    return MFX_MAKEFOURCC(fcc[0], fcc[1], fcc[2], fcc[3]);
+}
+
+mfxF64 GetNumPixels(const SessionCostKey& key) {
+    return (mfxF64)key.width * key.height;
+}
+} // namespace
+
+bool SessionCostKey::operator<(const SessionCostKey& other) const {
+    if (decodeId != other.decodeId)
+        return decodeId < other.decodeId;
+    if (encodeId != other.encodeId)
+        return encodeId < other.encodeId;
+    if (targetUsage != other.targetUsage)
+        return targetUsage < other.targetUsage;
+    if (width != other.width)
+        return width < other.width;
+    return height < other.height;
+}
+
+CCapacityModel::CCapacityModel() : m_entries() {}
+
+mfxStatus CCapacityModel::Load(const msdk_char* fileName) {
+    MSDK_CHECK_POINTER(fileName, MFX_ERR_NULL_PTR);
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, fileName, MSDK_STRING("r"));
+    if (!file)
+        return MFX_ERR_NONE;
+
+    msdk_char buffer[1024];
+    while (msdk_fgets(buffer, MSDK_ARRAY_LEN(buffer), file)) {
+        // comments
+        if (buffer[0] == '#')
+            continue;
+
+        msdk_stringstream ss(buffer);
+        msdk_string decoder, encoder;
+        msdk_char separator = 0;
+        SessionCostKey key;
+        Entry entry;
+        ss >> decoder >> encoder >> key.width >> separator >> key.height >> key.targetUsage >>
+            entry.fps >> entry.numFrames >> entry.numMissed;
+        if (ss.fail()) {
+            // empty lines
+            if (!decoder.empty())
+                msdk_printf(MSDK_STRING("Warning: line \"%s\" of capacity profile is skipped\n"),
+                            buffer);
+            continue;
+        }
+
+        key.decodeId   = StringToCodec(decoder);
+        key.encodeId   = StringToCodec(encoder);
+        m_entries[key] = entry;
+    }
+
+    fclose(file);
+    return MFX_ERR_NONE;
+} // mfxStatus CCapacityModel::Load(const msdk_char* fileName)
+
+mfxStatus CCapacityModel::Save(const msdk_char* fileName) const {
+    MSDK_CHECK_POINTER(fileName, MFX_ERR_NULL_PTR);
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, fileName, MSDK_STRING("w"));
+    if (!file) {
+        msdk_printf(MSDK_STRING("error: capacity profile \"%s\" can't be written\n"), fileName);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    msdk_fprintf(file,
+                 MSDK_STRING("# decoder encoder resolution target-usage fps frames missed\n"));
+    for (const auto& item : m_entries) {
+        const SessionCostKey& key = item.first;
+        const Entry& entry        = item.second;
+        msdk_fprintf(file,
+                     MSDK_STRING("%s %s %ux%u %u %.3f %llu %llu\n"),
+                     CodecToString(key.decodeId).c_str(),
+                     CodecToString(key.encodeId).c_str(),
+                     key.width,
+                     key.height,
+                     key.targetUsage,
+                     entry.fps,
+                     (unsigned long long)entry.numFrames,
+                     (unsigned long long)entry.numMissed);
+    }
+
+    fclose(file);
+    return MFX_ERR_NONE;
+} // mfxStatus CCapacityModel::Save(const msdk_char* fileName) const
+
+void CCapacityModel::Calibrate(const SessionCostKey& key, mfxF64 fps) {
+    Entry entry;
+    entry.fps      = fps;
+    m_entries[key] = entry;
+}
+
+void CCapacityModel::AddDeadlineMisses(const SessionCostKey& key,
+                                       mfxU32 numFrames,
+                                       mfxU32 numMissed) {
+    EntryMap::const_iterator nearest = FindNearest(key);
+    if (nearest == m_entries.end())
+        return;
+
+    Entry& entry = m_entries[nearest->first];
+    entry.numFrames += numFrames;
+    entry.numMissed += numMissed;
+}
+
+bool CCapacityModel::GetCost(const SessionCostKey& key, mfxF64 fps, mfxF64& cost) const {
+    EntryMap::const_iterator nearest = FindNearest(key);
+    if (nearest == m_entries.end())
+        return false;
+
+    const Entry& entry = nearest->second;
+    mfxF64 throughput  = entry.fps;
+    if (GetNumPixels(key) > 0)
+        throughput *= GetNumPixels(nearest->first) / GetNumPixels(key);
+    if (entry.numFrames)
+        throughput *= 1 - std::min((mfxF64)entry.numMissed / entry.numFrames, MAX_MISS_RATIO);
+
+    if (throughput <= 0)
+        return false;
+
+    cost = fps / throughput;
+    return true;
+} // bool CCapacityModel::GetCost()
+
+CCapacityModel::EntryMap::const_iterator CCapacityModel::FindNearest(
+    const SessionCostKey& key) const {
+    EntryMap::const_iterator nearest = m_entries.end();
+    mfxF64 minDistance               = 0;
+    for (EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const SessionCostKey& candidate = it->first;
+        if (candidate.decodeId != key.decodeId || candidate.encodeId != key.encodeId ||
+            candidate.targetUsage != key.targetUsage || !candidate.width || !candidate.height)
+            continue;
+
+        // resolutions are compared by the ratio of their areas
+        mfxF64 distance = GetNumPixels(key) > 0
+                              ? std::fabs(std::log(GetNumPixels(candidate) / GetNumPixels(key)))
+                              : 0;
+        if (nearest == m_entries.end() || distance < minDistance) {
+            nearest     = it;
+            minDistance = distance;
+        }
+    }
+    return nearest;
+} // CCapacityModel::FindNearest()
+
+CAdmissionController::CAdmissionController()
+        : m_profileName(),
+          m_model(),
+          m_maxLoad(0),
+          m_load(0),
+          m_admitted(),
+          m_rejected(),
+          m_bModelChanged(false) {}
+
+mfxStatus CAdmissionController::Init(const msdk_char* profileName, mfxU32 maxLoad) {
+    MSDK_CHECK_POINTER(profileName, MFX_ERR_NULL_PTR);
+
+    mfxStatus sts = m_model.Load(profileName);
+    MSDK_CHECK_STATUS(sts, "m_model.Load failed");
+    if (m_model.IsEmpty())
+        msdk_printf(MSDK_STRING("Warning: capacity profile \"%s\" is empty, sessions are ")
+                        MSDK_STRING("admitted until it's made by -calibrate\n"),
+                    profileName);
+
+    m_profileName = profileName;
+    m_maxLoad     = maxLoad / 100.0;
+    return MFX_ERR_NONE;
+} // mfxStatus CAdmissionController::Init()
+
+bool CAdmissionController::Admit(mfxU32 id, SessionCostKey& key, mfxU32 fps) {
+    if (!key.targetUsage)
+        key.targetUsage = MFX_TARGETUSAGE_BALANCED;
+    // no deadlines to miss
+    if (!fps)
+        return true;
+
+    for (mfxU16 targetUsage = key.targetUsage; targetUsage <= MFX_TARGETUSAGE_BEST_SPEED;
+         targetUsage++) {
+        SessionCostKey candidate = key;
+        candidate.targetUsage    = targetUsage;
+
+        Admission admission;
+        if (!m_model.GetCost(candidate, fps, admission.cost)) {
+            if (targetUsage != key.targetUsage)
+                continue;
+            msdk_printf(MSDK_STRING("Warning: session isn't calibrated, it's admitted without ")
+                            MSDK_STRING("taking a share of the device\n"));
+            return true;
+        }
+        if (m_load + admission.cost > m_maxLoad)
+            continue;
+
+        if (targetUsage != key.targetUsage)
+            msdk_printf(MSDK_STRING("Session target usage is downgraded from %u to %u to run ")
+                            MSDK_STRING("in real time\n"),
+                        key.targetUsage,
+                        targetUsage);
+
+        key           = candidate;
+        admission.key = candidate;
+        m_load += admission.cost;
+        m_admitted[id] = admission;
+        msdk_printf(MSDK_STRING("Session takes %.1f%% of the device, %.1f%% is taken\n"),
+                    admission.cost * 100,
+                    m_load * 100);
+        return true;
+    }
+
+    m_rejected.insert(id);
+    msdk_printf(MSDK_STRING("Session is rejected, it can't run in real time with %.1f%% of the ")
+                    MSDK_STRING("device taken\n"),
+                m_load * 100);
+    return false;
+} // bool CAdmissionController::Admit(mfxU32 id, SessionCostKey& key, mfxU32 fps)
+
+void CAdmissionController::Complete(mfxU32 id, mfxU32 numFrames, mfxU32 numMissed) {
+    auto it = m_admitted.find(id);
+    if (it == m_admitted.end())
+        return;
+
+    m_load = std::max(m_load - it->second.cost, 0.0);
+    if (numFrames) {
+        m_model.AddDeadlineMisses(it->second.key, numFrames, numMissed);
+        m_bModelChanged = true;
+    }
+    m_admitted.erase(it);
+}
+
+mfxStatus CAdmissionController::Save() {
+    if (!m_bModelChanged)
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = m_model.Save(m_profileName.c_str());
+    MSDK_CHECK_STATUS(sts, "m_model.Save failed");
+    m_bModelChanged = false;
+    return MFX_ERR_NONE;
+}
+
+} // namespace TranscodingSample
@@ -0,0 +1,422 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "metrics_exporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+namespace TranscodingSample {
+
+namespace {
+// How often the exporter checks for new connections and the stop (ms)
+const int POLL_INTERVAL = 100;
+
+const char* const STAGE_NAMES[CSessionMetrics::NUM_STAGES] = { "decode", "vpp", "encode",
+                                                               "sync",   "frame" };
+
+const char* const POOL_NAMES[CSessionMetrics::NUM_POOLS] = { "decode", "encode", "scaler" };
+
+void AddFamily(std::ostringstream& ss, const char* name, const char* type, const char* help) {
+    ss << "# TYPE " << name << " " << type << "\n";
+    ss << "# HELP " << name << " " << help << "\n";
+}
+
+mfxU64 TicksToUs(msdk_tick ticks) {
+    return (mfxU64)(std::max<msdk_tick>(ticks, 0) * 1000000 / CTimer::GetFrequency());
+}
+} // namespace
+
+// durations of frames at 60 and 30 fps have their own bounds
+const msdk_tick CLatencyHistogram::BOUNDS[NUM_BOUNDS] = { 1000,   2500,   5000,   10000,
+                                                          16667,  33333,  50000,  100000,
+                                                          250000, 500000, 1000000 };
+
+CLatencyHistogram::CLatencyHistogram() : m_counts(), m_sum(0) {
+    for (auto& count : m_counts)
+        count = 0;
+}
+
+void CLatencyHistogram::Observe(msdk_tick duration) {
+    mfxU64 us    = TicksToUs(duration);
+    size_t index = 0;
+    while (index < NUM_BOUNDS && (mfxU64)BOUNDS[index] < us)
+        index++;
+
+    m_counts[index].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+}
+
+void CLatencyHistogram::Read(mfxU64 counts[NUM_BOUNDS + 1], mfxU64& sum) const {
+    for (size_t i = 0; i <= NUM_BOUNDS; i++)
+        counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    sum = m_sum.load(std::memory_order_relaxed);
+}
+
+CSessionMetrics::CSessionMetrics()
+        : latency(),
+          numFrames(0),
+          numMissed(0),
+          poolUsed(),
+          poolSize(),
+          bitstreamQueue(0),
+          numGpuHangs(0),
+          numFailures(0),
+          bRunning(false) {
+    for (mfxU32 i = 0; i < NUM_POOLS; i++) {
+        poolUsed[i] = 0;
+        poolSize[i] = 0;
+    }
+}
+
+void CSessionMetrics::AddFrame(msdk_tick duration, bool bMissed) {
+    latency[STAGE_FRAME].Observe(duration);
+    numFrames.fetch_add(1, std::memory_order_relaxed);
+    if (bMissed)
+        numMissed.fetch_add(1, std::memory_order_relaxed);
+}
+
+CMetricsExporter::CMetricsExporter()
+        : m_mutex(),
+          m_sessions(),
+          m_queues(),
+          m_fileName(),
+          m_interval(DEFAULT_INTERVAL),
+          m_socket(-1),
+          m_thread(),
+          m_stopMutex(),
+          m_stopCondition(),
+          m_bStop(false) {}
+
+CMetricsExporter::~CMetricsExporter() {
+    Stop();
+}
+
+void CMetricsExporter::AddSession(mfxU32 session, std::shared_ptr<CSessionMetrics> pMetrics) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Session& entry   = m_sessions[session];
+    entry.pMetrics   = pMetrics;
+    entry.lastFrames = pMetrics ? pMetrics->numFrames.load() : 0;
+    entry.fps        = 0;
+}
+
+void CMetricsExporter::AddQueue(mfxU32 queue, std::function<mfxU32()> getLength) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queues[queue] = getLength;
+}
+
+mfxStatus CMetricsExporter::Start(const msdk_char* fileName, mfxU16 port, mfxU32 interval) {
+    if (m_thread.joinable())
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    m_fileName = fileName ? fileName : MSDK_STRING("");
+    m_interval = interval ? interval : (mfxU32)DEFAULT_INTERVAL;
+    if (port) {
+        mfxStatus sts = Listen(port);
+        MSDK_CHECK_STATUS(sts, "Listen failed");
+    }
+
+    m_bStop  = false;
+    m_thread = std::thread([this]() {
+        ExportRoutine();
+    });
+    return MFX_ERR_NONE;
+} // mfxStatus CMetricsExporter::Start()
+
+void CMetricsExporter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_stopMutex);
+        m_bStop = true;
+    }
+    m_stopCondition.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (m_socket >= 0) {
+        close(m_socket);
+        m_socket = -1;
+    }
+#endif
+}
+
+void CMetricsExporter::ExportRoutine() {
+    msdk_tick last = msdk_time_get_tick();
+    for (;;) {
+        bool bStop = Serve(m_interval);
+
+        msdk_tick now = msdk_time_get_tick();
+        Update((mfxF64)(now - last) / CTimer::GetFrequency());
+        last = now;
+
+        if (!m_fileName.empty()) {
+            mfxStatus sts = WriteFile(Render());
+            MSDK_CHECK_STATUS_NO_RET(sts, "WriteFile failed");
+        }
+        if (bStop)
+            break;
+    }
+}
+
+void CMetricsExporter::Update(mfxF64 elapsed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& item : m_sessions) {
+        Session& session   = item.second;
+        mfxU64 frames      = session.pMetrics->numFrames.load();
+        session.fps        = elapsed > 0 ? (frames - session.lastFrames) / elapsed : 0;
+        session.lastFrames = frames;
+    }
+}
+
+std::string CMetricsExporter::Render() {
+    std::ostringstream ss;
+    ss << std::setprecision(12);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    AddFamily(ss, "smt_session_running", "gauge", "1 while the session runs.");
+    for (const auto& item : m_sessions)
+        ss << "smt_session_running{session=\"" << item.first << "\"} "
+           << (item.second.pMetrics->bRunning ? 1 : 0) << "\n";
+
+    AddFamily(ss, "smt_session_frames", "counter", "Frames processed by the session.");
+    for (const auto& item : m_sessions)
+        ss << "smt_session_frames_total{session=\"" << item.first << "\"} "
+           << item.second.pMetrics->numFrames.load() << "\n";
+
+    AddFamily(ss, "smt_session_fps", "gauge", "Frames per second over the last interval.");
+    for (const auto& item : m_sessions)
+        ss << "smt_session_fps{session=\"" << item.first << "\"} " << item.second.fps << "\n";
+
+    AddFamily(ss,
+              "smt_session_deadline_misses",
+              "counter",
+              "Frames which took longer than -fps of the session gives to a frame.");
+    for (const auto& item : m_sessions)
+        ss << "smt_session_deadline_misses_total{session=\"" << item.first << "\"} "
+           << item.second.pMetrics->numMissed.load() << "\n";
+
+    AddFamily(ss,
+              "smt_session_stage_latency_seconds",
+              "histogram",
+              "Time the session spends in a stage, frame is the whole frame.");
+    ss << "# UNIT smt_session_stage_latency_seconds seconds\n";
+    for (const auto& item : m_sessions) {
+        for (mfxU32 stage = 0; stage < CSessionMetrics::NUM_STAGES; stage++) {
+            mfxU64 counts[CLatencyHistogram::NUM_BOUNDS + 1] = {};
+            mfxU64 sum                                       = 0;
+            item.second.pMetrics->latency[stage].Read(counts, sum);
+
+            std::ostringstream labels;
+            labels << "session=\"" << item.first << "\",stage=\"" << STAGE_NAMES[stage] << "\"";
+
+            // buckets are cumulative
+            mfxU64 count = 0;
+            for (mfxU32 i = 0; i <= CLatencyHistogram::NUM_BOUNDS; i++) {
+                count += counts[i];
+                ss << "smt_session_stage_latency_seconds_bucket{" << labels.str() << ",le=\"";
+                if (i < CLatencyHistogram::NUM_BOUNDS)
+                    ss << CLatencyHistogram::BOUNDS[i] / 1000000.0;
+                else
+                    ss << "+Inf";
+                ss << "\"} " << count << "\n";
+            }
+            ss << "smt_session_stage_latency_seconds_count{" << labels.str() << "} " << count
+               << "\n";
+            ss << "smt_session_stage_latency_seconds_sum{" << labels.str() << "} "
+               << sum / 1000000.0 << "\n";
+        }
+    }
+
+    AddFamily(ss, "smt_surface_pool_used", "gauge", "Surfaces of the pool which are in use.");
+    for (const auto& item : m_sessions) {
+        for (mfxU32 pool = 0; pool < CSessionMetrics::NUM_POOLS; pool++) {
+            if (!item.second.pMetrics->poolSize[pool])
+                continue;
+            ss << "smt_surface_pool_used{session=\"" << item.first << "\",pool=\""
+               << POOL_NAMES[pool] << "\"} " << item.second.pMetrics->poolUsed[pool].load()
+               << "\n";
+        }
+    }
+
+    AddFamily(ss, "smt_surface_pool_size", "gauge", "Surfaces of the pool.");
+    for (const auto& item : m_sessions) {
+        for (mfxU32 pool = 0; pool < CSessionMetrics::NUM_POOLS; pool++) {
+            if (!item.second.pMetrics->poolSize[pool])
+                continue;
+            ss << "smt_surface_pool_size{session=\"" << item.first << "\",pool=\""
+               << POOL_NAMES[pool] << "\"} " << item.second.pMetrics->poolSize[pool].load()
+               << "\n";
+        }
+    }
+
+    AddFamily(ss,
+              "smt_bitstream_queue_depth",
+              "gauge",
+              "Encoded frames of the session waiting for sync and output.");
+    for (const auto& item : m_sessions)
+        ss << "smt_bitstream_queue_depth{session=\"" << item.first << "\"} "
+           << item.second.pMetrics->bitstreamQueue.load() << "\n";
+
+    AddFamily(ss,
+              "smt_surface_queue_depth",
+              "gauge",
+              "Surfaces waiting in the buffer between sessions.");
+    for (const auto& item : m_queues)
+        ss << "smt_surface_queue_depth{queue=\"" << item.first << "\"} " << item.second()
+           << "\n";
+
+    AddFamily(ss, "smt_session_errors", "counter", "GPU hangs and failures of the session.");
+    for (const auto& item : m_sessions) {
+        ss << "smt_session_errors_total{session=\"" << item.first << "\",type=\"gpu_hang\"} "
+           << item.second.pMetrics->numGpuHangs.load() << "\n";
+        ss << "smt_session_errors_total{session=\"" << item.first << "\",type=\"failure\"} "
+           << item.second.pMetrics->numFailures.load() << "\n";
+    }
+
+    ss << "# EOF\n";
+    return ss.str();
+} // std::string CMetricsExporter::Render()
+
+mfxStatus CMetricsExporter::WriteFile(const std::string& text) {
+    // readers see the previous file until the new one replaces it
+    msdk_string tmpName = m_fileName + MSDK_STRING(".tmp");
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, tmpName.c_str(), MSDK_STRING("wb"));
+    if (!file) {
+        msdk_printf(MSDK_STRING("error: metrics file \"%s\" can't be written\n"),
+                    tmpName.c_str());
+        return MFX_ERR_UNSUPPORTED;
+    }
+    size_t written = fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+    if (written != text.size())
+        return MFX_ERR_UNSUPPORTED;
+
+    // existing file isn't replaced on Windows
+    if (MSDK_RENAME(tmpName.c_str(), m_fileName.c_str())) {
+        MSDK_REMOVE(m_fileName.c_str());
+        if (MSDK_RENAME(tmpName.c_str(), m_fileName.c_str()))
+            return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+} // mfxStatus CMetricsExporter::WriteFile(const std::string& text)
+
+#if !defined(_WIN32) && !defined(_WIN64)
+mfxStatus CMetricsExporter::Listen(mfxU16 port) {
+    m_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        msdk_printf(MSDK_STRING("error: metrics socket can't be created\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    int reuse = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // metrics aren't exposed beyond the host
+    sockaddr_in addr     = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(m_socket, (sockaddr*)&addr, sizeof(addr)) || listen(m_socket, SOMAXCONN)) {
+        msdk_printf(MSDK_STRING("error: metrics port %u can't be listened on\n"), port);
+        close(m_socket);
+        m_socket = -1;
+        return MFX_ERR_UNSUPPORTED;
+    }
+    return MFX_ERR_NONE;
+} // mfxStatus CMetricsExporter::Listen(mfxU16 port)
+
+bool CMetricsExporter::Serve(mfxU32 timeout) {
+    msdk_tick deadline = msdk_time_get_tick() + (msdk_tick)timeout * CTimer::GetFrequency() / 1000;
+    for (;;) {
+        msdk_tick now = msdk_time_get_tick();
+        if (now >= deadline)
+            return false;
+        int remaining = (int)((deadline - now) * 1000 / CTimer::GetFrequency());
+
+        if (m_socket < 0) {
+            std::unique_lock<std::mutex> lock(m_stopMutex);
+            return m_stopCondition.wait_for(lock, std::chrono::milliseconds(remaining), [this] {
+                return m_bStop;
+            });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_stopMutex);
+            if (m_bStop)
+                return true;
+        }
+
+        pollfd fd = {};
+        fd.fd     = m_socket;
+        fd.events = POLLIN;
+        if (poll(&fd, 1, std::min(remaining, POLL_INTERVAL)) <= 0)
+            continue;
+
+        int client = accept(m_socket, NULL, NULL);
+        if (client < 0)
+            continue;
+
+        // any request gets the metrics, the request itself isn't needed
+        timeval recvTimeout = {};
+        recvTimeout.tv_sec  = 1;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &recvTimeout, sizeof(recvTimeout));
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16384) {
+            ssize_t size = recv(client, buffer, sizeof(buffer), 0);
+            if (size <= 0)
+                break;
+            request.append(buffer, size);
+        }
+
+        std::string body = Render();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        std::string text = response.str();
+        for (size_t sent = 0; sent < text.size();) {
+            ssize_t size = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (size <= 0)
+                break;
+            sent += size;
+        }
+        close(client);
+    }
+} // bool CMetricsExporter::Serve(mfxU32 timeout)
+#else
+mfxStatus CMetricsExporter::Listen(mfxU16 port) {
+    msdk_printf(MSDK_STRING("error: metrics port %u isn't supported on Windows, use a file\n"),
+                port);
+    return MFX_ERR_UNSUPPORTED;
+}
+
+bool CMetricsExporter::Serve(mfxU32 timeout) {
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    return m_stopCondition.wait_for(lock, std::chrono::milliseconds(timeout), [this] {
+        return m_bStop;
+    });
+}
+#endif
+
+} // namespace TranscodingSample
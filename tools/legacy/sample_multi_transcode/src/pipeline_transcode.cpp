@@ -118,6 +118,16 @@ __sInputParams::__sInputParams()
           nThreadsNum(0),
           bRobustFlag(false),
           bSoftRobustFlag(false),
+          bAsyncWrite(false),
+          bDirectIO(false),
+          nReadBatch(0),
+          bFrameRange(false),
+          nRangeFirst(0),
+          nRangeCount(0),
+          bPersistIndex(false),
+          nSysMemOptions(0),
+          nNumaNode(NUMA_NODE_NOT_SET),
+          nQualityMetrics(0),
           EncodeId(0),
           DecodeId(0),
           strSrcFile(),
@@ -219,6 +229,8 @@ __sInputParams::__sInputParams()
           nRenderColorForamt(0),
           monitorType(0),
           shouldUseGreedyFormula(false),
+          bUseScheduler(false),
+          nSchedThreads(0),
           enableQSVFF(false),
           bSingleTexture(false),
           nExtBRC(EXTBRC_DEFAULT),
@@ -260,7 +272,7 @@ __sInputParams::__sInputParams()
 }
 
 // set structure to define values
-sInputParams::sInputParams() : __sInputParams(), DumpLogFileName(), m_ROIData() {
+sInputParams::sInputParams() : __sInputParams(), DumpLogFileName(), cpuSet(), m_ROIData() {
 #ifdef ENABLE_MCTF
     mctfParam.mode                  = VPP_FILTER_DISABLED;
     mctfParam.params.FilterStrength = 0;
@@ -308,7 +320,8 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_pmfxSession(),
           m_pmfxDEC(),
           m_pmfxENC(),
-          m_pmfxVPP()
+          m_pmfxVPP(),
+          m_pQualityMeter()
 #if !defined(MFX_ONEVPL)
           ,
           m_pmfxPreENC(),
@@ -340,6 +353,10 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_pSurfaceDecPool(),
           m_pSurfaceEncPool(),
           m_CSSurfacePools(),
+          m_nNextDecSurface(0),
+          m_nNextEncSurface(0),
+          m_nNextCSSurface(),
+          m_surfaceEvent(),
           m_EncSurfaceType(0),
           m_DecSurfaceType(0),
           m_pPreEncAuxPool(),
@@ -375,6 +392,10 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_libvaBackend(0),
           m_MemoryModel(UNKNOWN_ALLOC),
           m_LastDecSyncPoint(NULL),
+          m_LastVppSyncPoint(NULL),
+          m_LastEncSyncPoint(NULL),
+          m_LastCSVppSyncPoints(),
+          m_TranscodeState(),
           m_pBuffer(NULL),
           m_pParentPipeline(NULL),
           m_Request{ 0 },
@@ -392,6 +413,9 @@ CTranscodingPipeline::CTranscodingPipeline()
           m_MaxFramesForTranscode(0xFFFFFFFF),
           m_pBSProcessor(NULL),
           m_nReqFrameTime(0),
+          m_nDeadlineMisses(0),
+          m_costKey(),
+          m_pMetrics(),
           statisticsWindowSize(0),
           m_nOutputFramesNum(0),
           inputStatistics(),
@@ -786,6 +810,44 @@ mfxStatus CTranscodingPipeline::EncodePreInit(sInputParams* pParams) {
 
 } // mfxStatus CTranscodingPipeline::EncodeInit(sInputParams *pParams)
 
+mfxStatus CTranscodingPipeline::InitQualityMeter(sInputParams* pParams,
+                                                 VPLImplementationLoader* mfxLoader) {
+    if (!pParams->nQualityMetrics)
+        return MFX_ERR_NONE;
+
+    // the meter compares single stream of whole frames with the encoder input
+    if (!m_pmfxENC.get() || m_nVPPCompEnable || m_bIsFieldSplitting) {
+        msdk_printf(MSDK_STRING(
+            "error: quality metrics require an encoder without composition or field split\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    m_pQualityMeter.reset(new CEncodeQualityMeter);
+    mfxStatus sts = m_pQualityMeter->Init(mfxLoader,
+                                          m_pmfxSession.get(),
+                                          m_mfxEncParams,
+                                          pParams->nQualityMetrics);
+    MSDK_CHECK_STATUS(sts, "m_pQualityMeter->Init failed");
+
+    return MFX_ERR_NONE;
+} // mfxStatus CTranscodingPipeline::InitQualityMeter(sInputParams *pParams)
+
+mfxStatus CTranscodingPipeline::AddQualityReference(const ExtendedSurface& surf,
+                                                    MFXVideoSession* pSession) {
+    if (!m_pQualityMeter || !surf.pSurface)
+        return MFX_ERR_NONE;
+
+    // the surface is copied by the meter once surf.Syncp completes, it keeps the surface
+    // locked until then
+    mfxStatus sts =
+        m_pQualityMeter->AddReference(surf.pSurface, m_pMFXAllocator, pSession, surf.Syncp);
+    MSDK_CHECK_STATUS(sts, "m_pQualityMeter->AddReference failed");
+    // queued surfaces completed meanwhile are unlocked
+    m_surfaceEvent.Signal();
+
+    return MFX_ERR_NONE;
+} // mfxStatus CTranscodingPipeline::AddQualityReference(const ExtendedSurface& surf)
+
 #if !defined(MFX_ONEVPL)
 mfxStatus CTranscodingPipeline::PreEncPreInit(sInputParams* pParams) {
     mfxStatus sts = MFX_ERR_NONE;
@@ -846,6 +908,7 @@ enum { TIME_TO_SLEEP = 1 };
 
 mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
     MFX_ITT_TASK("DecodeOneFrame");
+    CStageTimer timer(m_pMetrics.get(), CSessionMetrics::STAGE_DECODE);
     MSDK_CHECK_POINTER(pExtSurface, MFX_ERR_NULL_PTR);
 
     mfxStatus sts                 = MFX_ERR_MORE_SURFACE;
@@ -862,8 +925,10 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
     DevBusyTimer.Start();
     while (MFX_ERR_MORE_DATA == sts || MFX_ERR_MORE_SURFACE == sts || MFX_ERR_NONE < sts) {
         if (m_rawInput) {
-            pExtSurface->pSurface = GetFreeSurface(false, MSDK_SURFACE_WAIT_INTERVAL);
-            sts                   = m_pBSProcessor->GetInputFrame(pExtSurface->pSurface);
+            pExtSurface->pSurface = GetFreeSurface(false, GetSurfaceWaitInterval());
+            if (!pExtSurface->pSurface && m_TranscodeState.bStepMode)
+                return MFX_TASK_WORKING;
+            sts = m_pBSProcessor->GetInputFrame(pExtSurface->pSurface);
             if (sts != MFX_ERR_NONE)
                 return sts;
         }
@@ -873,12 +938,15 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
                                               SMTTracer::EventName::BUSY,
                                               nullptr,
                                               nullptr);
-            WaitForDeviceToBecomeFree(*m_pmfxSession, m_LastDecSyncPoint, sts);
+            WaitForDevice(*m_pmfxSession, m_LastDecSyncPoint, sts);
+            m_surfaceEvent.Signal();
             m_ScalerConfig.Tracer->EndEvent(SMTTracer::ThreadType::DEC,
                                             0,
                                             SMTTracer::EventName::BUSY,
                                             nullptr,
                                             nullptr);
+            if (MFX_TASK_WORKING == sts)
+                return sts;
         }
         else if (MFX_ERR_MORE_DATA == sts) {
             sts =
@@ -888,7 +956,7 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
 
         if (m_MemoryModel == GENERAL_ALLOC) {
             // Find new working surface
-            pmfxSurface = GetFreeSurface(true, MSDK_SURFACE_WAIT_INTERVAL);
+            pmfxSurface = GetFreeSurface(true, GetSurfaceWaitInterval());
             {
                 std::unique_lock<std::mutex> lock(m_mStopSession);
                 if (m_bForceStop) {
@@ -899,6 +967,9 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
                     return MFX_WRN_VALUE_NOT_CHANGED;
                 }
             }
+            // the step is requeued, the bitstream read so far is decoded by the next one
+            if (!pmfxSurface && m_TranscodeState.bStepMode)
+                return MFX_TASK_WORKING;
             MSDK_CHECK_POINTER_SAFE(
                 pmfxSurface,
                 MFX_ERR_MEMORY_ALLOC,
@@ -955,12 +1026,14 @@ mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface* pExtSurface) {
         sts = m_pmfxSession->SyncOperation(pExtSurface->Syncp, MSDK_WAIT_INTERVAL);
         HandlePossibleGpuHang(sts);
         MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "Decode: SyncOperation failed");
+        m_surfaceEvent.Signal();
     }
     return sts;
 
 } // mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface *pExtSurface)
 mfxStatus CTranscodingPipeline::DecodeLastFrame(ExtendedSurface* pExtSurface) {
     MFX_ITT_TASK("DecodeLastFrame");
+    CStageTimer timer(m_pMetrics.get(), CSessionMetrics::STAGE_DECODE);
     mfxFrameSurface1* pmfxSurface = NULL;
     mfxStatus sts                 = MFX_ERR_MORE_SURFACE;
 
@@ -975,17 +1048,24 @@ mfxStatus CTranscodingPipeline::DecodeLastFrame(ExtendedSurface* pExtSurface) {
     // retrieve the buffered decoded frames
     while (MFX_ERR_MORE_SURFACE == sts || MFX_WRN_DEVICE_BUSY == sts) {
         if (m_rawInput) {
-            pExtSurface->pSurface = GetFreeSurface(false, MSDK_SURFACE_WAIT_INTERVAL);
-            sts                   = m_pBSProcessor->GetInputFrame(pExtSurface->pSurface);
+            pExtSurface->pSurface = GetFreeSurface(false, GetSurfaceWaitInterval());
+            if (!pExtSurface->pSurface && m_TranscodeState.bStepMode)
+                return MFX_TASK_WORKING;
+            sts = m_pBSProcessor->GetInputFrame(pExtSurface->pSurface);
         }
         else if (MFX_WRN_DEVICE_BUSY == sts) {
-            WaitForDeviceToBecomeFree(*m_pmfxSession, m_LastDecSyncPoint, sts);
+            WaitForDevice(*m_pmfxSession, m_LastDecSyncPoint, sts);
+            m_surfaceEvent.Signal();
+            if (MFX_TASK_WORKING == sts)
+                return sts;
         }
 
         if (!m_rawInput) {
             if (m_MemoryModel == GENERAL_ALLOC) {
                 // find new working surface
-                pmfxSurface = GetFreeSurface(true, MSDK_SURFACE_WAIT_INTERVAL);
+                pmfxSurface = GetFreeSurface(true, GetSurfaceWaitInterval());
+                if (!pmfxSurface && m_TranscodeState.bStepMode)
+                    return MFX_TASK_WORKING;
                 MSDK_CHECK_POINTER_SAFE(
                     pmfxSurface,
                     MFX_ERR_MEMORY_ALLOC,
@@ -1030,6 +1110,7 @@ mfxStatus CTranscodingPipeline::DecodeLastFrame(ExtendedSurface* pExtSurface) {
         sts = m_pmfxSession->SyncOperation(pExtSurface->Syncp, MSDK_WAIT_INTERVAL);
         HandlePossibleGpuHang(sts);
         MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "Decode: SyncOperation failed");
+        m_surfaceEvent.Signal();
     }
 
     return sts;
@@ -1039,6 +1120,7 @@ mfxStatus CTranscodingPipeline::VPPOneFrame(ExtendedSurface* pSurfaceIn,
                                             ExtendedSurface* pExtSurface,
                                             mfxU32 ID) {
     MFX_ITT_TASK("VPPOneFrame");
+    CStageTimer timer(m_pMetrics.get(), CSessionMetrics::STAGE_VPP);
     MSDK_CHECK_POINTER(pExtSurface, MFX_ERR_NULL_PTR);
     mfxFrameSurface1* out_surface = NULL;
     mfxStatus sts                 = MFX_ERR_NONE;
@@ -1046,7 +1128,9 @@ mfxStatus CTranscodingPipeline::VPPOneFrame(ExtendedSurface* pSurfaceIn,
     if (m_MemoryModel == GENERAL_ALLOC || m_MemoryModel == VISIBLE_INT_ALLOC) {
         if (m_MemoryModel == GENERAL_ALLOC) {
             // find/wait for a free working surface
-            out_surface = GetFreeSurfaceForCS(false, MSDK_SURFACE_WAIT_INTERVAL, ID);
+            out_surface = GetFreeSurfaceForCS(false, GetSurfaceWaitInterval(), ID);
+            if (!out_surface && m_TranscodeState.bStepMode)
+                return MFX_TASK_WORKING;
             MSDK_CHECK_POINTER_SAFE(
                 out_surface,
                 MFX_ERR_MEMORY_ALLOC,
@@ -1155,7 +1239,16 @@ mfxStatus CTranscodingPipeline::VPPOneFrame(ExtendedSurface* pSurfaceIn,
                                                           nullptr);
                     }
 
-                    MSDK_SLEEP(1); // wait if device is busy
+                    // wait for the last task of the component, it frees the device
+                    if (TargetID == DecoderTargetID && desc.CascadeScaler) {
+                        WaitForDevice(*m_pmfxCSSession.at(desc.PoolID),
+                                      m_LastCSVppSyncPoints.at(desc.PoolID),
+                                      sts);
+                    }
+                    else {
+                        WaitForDevice(*m_pmfxSession, m_LastVppSyncPoint, sts);
+                    }
+                    m_surfaceEvent.Signal();
 
                     if (TargetID == DecoderTargetID && desc.CascadeScaler) {
                         m_ScalerConfig.Tracer->EndEvent(SMTTracer::ThreadType::CSVPP,
@@ -1171,6 +1264,19 @@ mfxStatus CTranscodingPipeline::VPPOneFrame(ExtendedSurface* pSurfaceIn,
                                                         nullptr,
                                                         nullptr);
                     }
+                    if (MFX_TASK_WORKING == sts) {
+#if defined(MFX_ONEVPL)
+                        // the next step takes another output surface
+                        if (m_MemoryModel == VISIBLE_INT_ALLOC) {
+                            mfxStatus sts_release =
+                                out_surface->FrameInterface->Release(out_surface);
+                            MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
+                        }
+#endif //MFX_ONEVPL
+                        pExtSurface->pSurface = NULL;
+                        return sts;
+                    }
+                    MSDK_CHECK_STATUS(sts, "VPP: waiting for the device failed");
                 }
             }
             else {
@@ -1183,12 +1289,20 @@ mfxStatus CTranscodingPipeline::VPPOneFrame(ExtendedSurface* pSurfaceIn,
         }
     }
 
+    if (MFX_ERR_NONE == sts && pExtSurface->Syncp) {
+        if (TargetID == DecoderTargetID && desc.CascadeScaler)
+            m_LastCSVppSyncPoints.at(desc.PoolID) = pExtSurface->Syncp;
+        else
+            m_LastVppSyncPoint = pExtSurface->Syncp;
+    }
+
     return sts;
 
 } // mfxStatus CTranscodingPipeline::DecodeOneFrame(ExtendedSurface *pExtSurface)
 
 mfxStatus CTranscodingPipeline::EncodeOneFrame(ExtendedSurface* pExtSurface,
                                                mfxBitstreamWrapper* pBS) {
+    CStageTimer timer(m_pMetrics.get(), CSessionMetrics::STAGE_ENCODE);
     mfxStatus sts = MFX_ERR_NONE;
 
     if (!pBS->Data) {
@@ -1221,12 +1335,16 @@ mfxStatus CTranscodingPipeline::EncodeOneFrame(ExtendedSurface* pExtSurface,
                                                   SMTTracer::EventName::BUSY,
                                                   nullptr,
                                                   nullptr);
-                MSDK_SLEEP(TIME_TO_SLEEP); // wait if device is busy
+                WaitForDevice(*m_pmfxSession, m_LastEncSyncPoint, sts);
+                m_surfaceEvent.Signal();
                 m_ScalerConfig.Tracer->EndEvent(SMTTracer::ThreadType::ENC,
                                                 TargetID,
                                                 SMTTracer::EventName::BUSY,
                                                 nullptr,
                                                 nullptr);
+                if (MFX_TASK_WORKING == sts)
+                    return sts;
+                MSDK_CHECK_STATUS(sts, "Encode: waiting for the device failed");
             }
         }
         else if (MFX_ERR_NONE < sts && pExtSurface->Syncp) {
@@ -1242,6 +1360,9 @@ mfxStatus CTranscodingPipeline::EncodeOneFrame(ExtendedSurface* pExtSurface,
         }
     }
 
+    if (MFX_ERR_NONE == sts && pExtSurface->Syncp)
+        m_LastEncSyncPoint = pExtSurface->Syncp;
+
     return sts;
 
 } //CTranscodingPipeline::EncodeOneFrame(ExtendedSurface *pExtSurface)
@@ -1314,6 +1435,8 @@ void CTranscodingPipeline::NoMoreFramesSignal() {
 void CTranscodingPipeline::StopSession() {
     std::lock_guard<std::mutex> guard(m_mStopSession);
     m_bForceStop = true;
+    // wake the threads waiting for free surfaces
+    m_surfaceEvent.Signal();
 
     msdk_stringstream ss;
     ss << MSDK_STRING("session [") << GetSessionText() << MSDK_STRING("] m_bForceStop is set")
@@ -1565,6 +1688,7 @@ mfxStatus CTranscodingPipeline::Decode() {
             HandlePossibleGpuHang(sts);
             PreEncExtSurface.Syncp = NULL;
             MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "PreEnc: SyncOperation failed");
+            m_surfaceEvent.Signal();
         }
 
         // add surfaces in queue for all sinks
@@ -1592,6 +1716,10 @@ mfxStatus CTranscodingPipeline::Decode() {
                     return MFX_ERR_UNKNOWN;
                 }
                 buf[i]->AddSurface(OutSurfaces[i]);
+                m_ScalerConfig.Tracer->AddCounterEvent(SMTTracer::ThreadType::ENC,
+                                                       buf[i]->TargetID,
+                                                       SMTTracer::EventName::QUEUE,
+                                                       buf[i]->GetLength());
             }
 
             OutSurfaces.clear();
@@ -1640,6 +1768,7 @@ mfxStatus CTranscodingPipeline::Decode() {
                 HandlePossibleGpuHang(sts);
                 MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
                 frontSurface.Syncp = NULL;
+                m_surfaceEvent.Signal();
             }
         }
 
@@ -1652,9 +1781,13 @@ mfxStatus CTranscodingPipeline::Decode() {
         }
 
         msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
+        AddFrameMetrics(nFrameTime);
         if (nFrameTime < m_nReqFrameTime) {
             MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
         }
+        else if (m_nReqFrameTime) {
+            m_nDeadlineMisses++;
+        }
         if (++m_nProcessedFramesNum >= m_MaxFramesForTranscode) {
             break;
         }
@@ -1713,6 +1846,8 @@ mfxStatus CTranscodingPipeline::Encode() {
                     MSDK_CHECK_ERR_NONE_STATUS(sts,
                                                MFX_ERR_ABORTED,
                                                "Encode: SyncOperation failed");
+                    // the task is the decoding one of the parent, its surfaces are released
+                    m_pParentPipeline->m_surfaceEvent.Signal();
                 }
             }
 
@@ -1780,6 +1915,7 @@ mfxStatus CTranscodingPipeline::Encode() {
                 sts = m_pmfxSession->SyncOperation(VppExtSurface.Syncp, MSDK_WAIT_INTERVAL);
                 HandlePossibleGpuHang(sts);
                 MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "VPP: SyncOperation failed");
+                m_surfaceEvent.Signal();
 
                 /* in case if enabled dumping into file for after VPP composition */
                 if (DUMP_FILE_VPP_COMP == m_vppCompDumpRenderMode) {
@@ -1820,6 +1956,13 @@ mfxStatus CTranscodingPipeline::Encode() {
                 if (bPollFlag) {
                     VppExtSurface.pSurface = 0;
                 }
+                // without VPP the surface comes from the parent session
+                MFXVideoSession* pSyncSession = m_pmfxSession.get();
+                if (!m_pmfxVPP.get() && m_pParentPipeline)
+                    pSyncSession = m_pParentPipeline->m_pmfxSession.get();
+                sts = AddQualityReference(VppExtSurface, pSyncSession);
+                MSDK_CHECK_STATUS(sts, "AddQualityReference failed");
+
                 sts = EncodeOneFrame(&VppExtSurface, &m_BSPool.back()->Bitstream);
 
                 // Count only real surfaces
@@ -1938,9 +2081,13 @@ mfxStatus CTranscodingPipeline::Encode() {
         } // if (m_nVPPCompEnable != VppCompOnly)
 
         msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
+        AddFrameMetrics(nFrameTime);
         if (nFrameTime < m_nReqFrameTime) {
             MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
         }
+        else if (m_nReqFrameTime) {
+            m_nDeadlineMisses++;
+        }
     }
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
 
@@ -2155,231 +2302,317 @@ void CTranscodingPipeline::SetEncCtrlRT(ExtendedSurface& extSurface, bool bInser
     }
 }
 
-mfxStatus CTranscodingPipeline::Transcode() {
-    mfxStatus sts = MFX_ERR_NONE;
-    ExtendedSurface DecExtSurface;
-    ExtendedSurface VppExtSurface;
-    ExtendedBS* pBS          = NULL;
-    bool bNeedDecodedFrames  = true; // indicates if we need to decode frames
-    bool bEndOfFile          = false;
-    bool bLastCycle          = false;
-    bool shouldReadNextFrame = true;
+void CTranscodingPipeline::StartTranscode(bool bStepMode) {
+    m_TranscodeState           = TranscodeState();
+    m_TranscodeState.bStarted  = true;
+    m_TranscodeState.bStepMode = bStepMode;
+    m_TranscodeState.start     = time(0);
+} // void CTranscodingPipeline::StartTranscode(bool bStepMode)
+
+// Makes one iteration of the transcoding loop. Returns MFX_ERR_NONE to be called again,
+// MFX_ERR_MORE_DATA when there are no more frames to submit. In step mode returns
+// MFX_TASK_WORKING if the oldest bitstream isn't ready in waitMs, the frame time isn't over,
+// or decode, VPP or encode has no free surface or finds the device busy in waitMs. The next
+// step calls that stage again with the same frame.
+mfxStatus CTranscodingPipeline::TranscodeStep(mfxU32 waitMs) {
+    mfxStatus sts      = MFX_ERR_NONE;
+    TranscodeState& st = m_TranscodeState;
+    ExtendedBS* pBS    = NULL;
+
+    st.nWaitMs = waitMs;
+
+    if (st.bStepMode && st.nNextFrameTime) {
+        msdk_tick now = msdk_time_get_tick();
+        if (now < st.nNextFrameTime) {
+            MSDK_USLEEP((mfxU32)std::min<msdk_tick>(st.nNextFrameTime - now, waitMs * 1000));
+            if (msdk_time_get_tick() < st.nNextFrameTime)
+                return MFX_TASK_WORKING;
+        }
+    }
+
+    // previous step left the pool full if the oldest bitstream wasn't ready
+    if (m_BSPool.size() >= m_AsyncDepth) {
+        sts = PutBS(waitMs);
+        if (MFX_TASK_WORKING == sts)
+            return sts;
+        MSDK_CHECK_STATUS(sts, "PutBS failed");
+    }
 
-    time_t start = time(0);
-    while (MFX_ERR_NONE == sts) {
-        msdk_tick nBeginTime = msdk_time_get_tick(); // microseconds.
+    msdk_tick nBeginTime = msdk_time_get_tick(); // microseconds.
 
-        if (time(0) - start >= m_nTimeout)
-            bLastCycle = true;
-        if (m_MaxFramesForTranscode == m_nProcessedFramesNum) {
-            DecExtSurface.pSurface = NULL; // to get buffered VPP or ENC frames
-            bNeedDecodedFrames     = false; // no more decoded frames needed
-        }
+    if (time(0) - st.start >= m_nTimeout)
+        st.bLastCycle = true;
+    if (m_MaxFramesForTranscode == m_nProcessedFramesNum) {
+        st.DecExtSurface.pSurface = NULL; // to get buffered VPP or ENC frames
+        st.bNeedDecodedFrames     = false; // no more decoded frames needed
+    }
 
-        // if need more decoded frames
-        // decode a frame
-        if (bNeedDecodedFrames && shouldReadNextFrame) {
-            if (!bEndOfFile) {
-                sts = DecodeOneFrame(&DecExtSurface);
-                if (MFX_ERR_MORE_DATA == sts) {
-                    if (!bLastCycle) {
-                        m_bInsertIDR = true;
+    // if need more decoded frames
+    // decode a frame
+    if (TranscodeState::STAGE_DECODE == st.resumeStage && st.bNeedDecodedFrames &&
+        st.shouldReadNextFrame) {
+        if (!st.bEndOfFile) {
+            sts = DecodeOneFrame(&st.DecExtSurface);
+            if (MFX_ERR_MORE_DATA == sts) {
+                if (!st.bLastCycle) {
+                    m_bInsertIDR = true;
 
-                        m_pBSProcessor->ResetInput();
-                        m_pBSProcessor->ResetOutput();
-                        bNeedDecodedFrames = true;
+                    m_pBSProcessor->ResetInput();
+                    m_pBSProcessor->ResetOutput();
+                    st.bNeedDecodedFrames = true;
 
-                        bEndOfFile = false;
-                        sts        = MFX_ERR_NONE;
-                        continue;
-                    }
-                    else {
-                        bEndOfFile = true;
-                    }
+                    st.bEndOfFile = false;
+                    return MFX_ERR_NONE;
+                }
+                else {
+                    st.bEndOfFile = true;
                 }
             }
-
-            if (bEndOfFile) {
-                sts = DecodeLastFrame(&DecExtSurface);
-            }
-
-            if (sts == MFX_ERR_MORE_DATA) {
-                DecExtSurface.pSurface = NULL; // to get buffered VPP or ENC frames
-                sts                    = MFX_ERR_NONE;
-            }
-            MSDK_CHECK_STATUS(sts, "Decode<One|Last>Frame failed");
         }
-        if (m_bIsFieldWeaving && DecExtSurface.pSurface != NULL) {
-            m_mfxDecParams.mfx.FrameInfo.PicStruct = DecExtSurface.pSurface->Info.PicStruct;
-        }
-        if (m_bIsFieldSplitting && DecExtSurface.pSurface != NULL) {
-            m_mfxDecParams.mfx.FrameInfo.PicStruct = DecExtSurface.pSurface->Info.PicStruct;
+
+        if (st.bEndOfFile) {
+            sts = DecodeLastFrame(&st.DecExtSurface);
         }
-        // pre-process a frame
-        if (m_pmfxVPP.get() && bNeedDecodedFrames && !m_rawInput) {
-            if (m_bIsFieldWeaving) {
-                // In case of field weaving output surface's parameters for ODD calls to VPPOneFrame will be ignored (because VPP will return ERR_MORE_DATA).
-                // So, we need to set output surface picstruct properly for EVEN calls (no matter what will be set for ODD calls).
-                // We might have 2 cases: decoder gives us pairs (TF BF)... or (BF)(TF). In first case we should set TFF for output, in second - BFF.
-                // So, if even input surface is BF, we set TFF for output and vise versa. For odd input surface - no matter what we set.
-                if (DecExtSurface.pSurface) {
-                    if ((DecExtSurface.pSurface->Info.PicStruct &
-                         MFX_PICSTRUCT_FIELD_TFF)) // Incoming Top Field in a single surface
-                    {
-                        m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_BFF;
-                    }
-                    if (DecExtSurface.pSurface->Info.PicStruct &
-                        MFX_PICSTRUCT_FIELD_BFF) // Incoming Bottom Field in a single surface
-                    {
-                        m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_TFF;
-                    }
+
+        if (MFX_TASK_WORKING == sts)
+            return RequeueStep();
+
+        if (sts == MFX_ERR_MORE_DATA) {
+            st.DecExtSurface.pSurface = NULL; // to get buffered VPP or ENC frames
+            sts                       = MFX_ERR_NONE;
+        }
+        MSDK_CHECK_STATUS(sts, "Decode<One|Last>Frame failed");
+    }
+    if (m_bIsFieldWeaving && st.DecExtSurface.pSurface != NULL) {
+        m_mfxDecParams.mfx.FrameInfo.PicStruct = st.DecExtSurface.pSurface->Info.PicStruct;
+    }
+    if (m_bIsFieldSplitting && st.DecExtSurface.pSurface != NULL) {
+        m_mfxDecParams.mfx.FrameInfo.PicStruct = st.DecExtSurface.pSurface->Info.PicStruct;
+    }
+    // pre-process a frame
+    if (TranscodeState::STAGE_ENCODE == st.resumeStage) {
+        // VPP output of the previous step is encoded again
+    }
+    else if (m_pmfxVPP.get() && st.bNeedDecodedFrames && !m_rawInput) {
+        if (m_bIsFieldWeaving) {
+            // In case of field weaving output surface's parameters for ODD calls to VPPOneFrame will be ignored (because VPP will return ERR_MORE_DATA).
+            // So, we need to set output surface picstruct properly for EVEN calls (no matter what will be set for ODD calls).
+            // We might have 2 cases: decoder gives us pairs (TF BF)... or (BF)(TF). In first case we should set TFF for output, in second - BFF.
+            // So, if even input surface is BF, we set TFF for output and vise versa. For odd input surface - no matter what we set.
+            if (st.DecExtSurface.pSurface) {
+                if ((st.DecExtSurface.pSurface->Info.PicStruct &
+                     MFX_PICSTRUCT_FIELD_TFF)) // Incoming Top Field in a single surface
+                {
+                    m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_BFF;
+                }
+                if (st.DecExtSurface.pSurface->Info.PicStruct &
+                    MFX_PICSTRUCT_FIELD_BFF) // Incoming Bottom Field in a single surface
+                {
+                    m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_TFF;
                 }
-                sts = VPPOneFrame(&DecExtSurface, &VppExtSurface);
             }
-            else {
-                if (m_bIsFieldSplitting) {
-                    if (DecExtSurface.pSurface) {
-                        if (DecExtSurface.pSurface->Info.PicStruct & MFX_PICSTRUCT_FIELD_TFF ||
-                            DecExtSurface.pSurface->Info.PicStruct & MFX_PICSTRUCT_FIELD_BFF) {
-                            m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_SINGLE;
-                            sts = VPPOneFrame(&DecExtSurface, &VppExtSurface);
-                        }
-                        else {
-                            VppExtSurface.pSurface = DecExtSurface.pSurface;
-                            VppExtSurface.pAuxCtrl = DecExtSurface.pAuxCtrl;
-                            VppExtSurface.Syncp    = DecExtSurface.Syncp;
-                        }
+            sts = VPPOneFrame(&st.DecExtSurface, &st.VppExtSurface);
+        }
+        else {
+            if (m_bIsFieldSplitting) {
+                if (st.DecExtSurface.pSurface) {
+                    if (st.DecExtSurface.pSurface->Info.PicStruct & MFX_PICSTRUCT_FIELD_TFF ||
+                        st.DecExtSurface.pSurface->Info.PicStruct & MFX_PICSTRUCT_FIELD_BFF) {
+                        m_mfxVppParams.vpp.Out.PicStruct = MFX_PICSTRUCT_FIELD_SINGLE;
+                        sts = VPPOneFrame(&st.DecExtSurface, &st.VppExtSurface);
                     }
                     else {
-                        sts = VPPOneFrame(&DecExtSurface, &VppExtSurface);
+                        st.VppExtSurface.pSurface = st.DecExtSurface.pSurface;
+                        st.VppExtSurface.pAuxCtrl = st.DecExtSurface.pAuxCtrl;
+                        st.VppExtSurface.Syncp    = st.DecExtSurface.Syncp;
                     }
                 }
                 else {
-                    sts = VPPOneFrame(&DecExtSurface, &VppExtSurface);
+                    sts = VPPOneFrame(&st.DecExtSurface, &st.VppExtSurface);
                 }
             }
-            // check for interlaced stream
-
-#if defined(MFX_ONEVPL)
-            if (m_MemoryModel != GENERAL_ALLOC && DecExtSurface.pSurface) {
-                mfxStatus sts_release =
-                    DecExtSurface.pSurface->FrameInterface->Release(DecExtSurface.pSurface);
-                MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
+            else {
+                sts = VPPOneFrame(&st.DecExtSurface, &st.VppExtSurface);
             }
-#endif //MFX_ONEVPL
-        }
-        else // no VPP - just copy pointers
-        {
-            VppExtSurface.pSurface = DecExtSurface.pSurface;
-            VppExtSurface.pAuxCtrl = DecExtSurface.pAuxCtrl;
-            VppExtSurface.Syncp    = DecExtSurface.Syncp;
         }
+        // check for interlaced stream
 
-        if (MFX_ERR_MORE_SURFACE == sts) {
-            shouldReadNextFrame = false;
-            sts                 = MFX_ERR_NONE;
+        if (MFX_TASK_WORKING == sts) {
+            // the decoded frame is kept for the next step
+            st.resumeStage = TranscodeState::STAGE_VPP;
+            return RequeueStep();
         }
-        else {
-            shouldReadNextFrame = true;
+
+#if defined(MFX_ONEVPL)
+        if (m_MemoryModel != GENERAL_ALLOC && st.DecExtSurface.pSurface) {
+            mfxStatus sts_release =
+                st.DecExtSurface.pSurface->FrameInterface->Release(st.DecExtSurface.pSurface);
+            MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
         }
+#endif //MFX_ONEVPL
+    }
+    else // no VPP - just copy pointers
+    {
+        st.VppExtSurface.pSurface = st.DecExtSurface.pSurface;
+        st.VppExtSurface.pAuxCtrl = st.DecExtSurface.pAuxCtrl;
+        st.VppExtSurface.Syncp    = st.DecExtSurface.Syncp;
+    }
 
-        if (sts == MFX_ERR_MORE_DATA) {
-            sts = MFX_ERR_NONE;
-            if (NULL == DecExtSurface.pSurface) // there are no more buffered frames in VPP
-            {
-                VppExtSurface.pSurface = NULL; // to get buffered ENC frames
-            }
-            else {
-                continue; // go get next frame from Decode
-            }
+    if (MFX_ERR_MORE_SURFACE == sts) {
+        st.shouldReadNextFrame = false;
+        sts                    = MFX_ERR_NONE;
+    }
+    else if (TranscodeState::STAGE_ENCODE != st.resumeStage) {
+        st.shouldReadNextFrame = true;
+    }
+
+    if (sts == MFX_ERR_MORE_DATA) {
+        sts = MFX_ERR_NONE;
+        if (NULL == st.DecExtSurface.pSurface) // there are no more buffered frames in VPP
+        {
+            st.VppExtSurface.pSurface = NULL; // to get buffered ENC frames
+        }
+        else {
+            return MFX_ERR_NONE; // go get next frame from Decode
         }
+    }
 
-        MSDK_CHECK_STATUS(sts, "Unexpected error!!");
+    MSDK_CHECK_STATUS(sts, "Unexpected error!!");
 
-        // encode frame
-        pBS = m_pBSStore->GetNext();
-        if (!pBS)
-            return MFX_ERR_NOT_FOUND;
+    // encode frame
+    pBS = m_pBSStore->GetNext();
+    if (!pBS)
+        return MFX_ERR_NOT_FOUND;
 
-        m_BSPool.push_back(pBS);
+    m_BSPool.push_back(pBS);
 
-        // Set Encoding control if it is required.
+    // the frame encoded again was counted and referenced by the step which requeued it
+    bool bEncodeAgain = TranscodeState::STAGE_ENCODE == st.resumeStage;
 
-        SetEncCtrlRT(VppExtSurface, m_bInsertIDR);
+    // Set Encoding control if it is required.
+    if (!bEncodeAgain) {
+        SetEncCtrlRT(st.VppExtSurface, m_bInsertIDR);
         m_bInsertIDR = false;
 
-        if (DecExtSurface.pSurface)
+        if (st.DecExtSurface.pSurface)
             m_nProcessedFramesNum++;
+    }
 
-        if (m_mfxEncParams.mfx.CodecId != MFX_CODEC_DUMP) {
-            sts = EncodeOneFrame(&VppExtSurface, &m_BSPool.back()->Bitstream);
-        }
-        else {
-            sts = Surface2BS(&VppExtSurface, &m_BSPool.back()->Bitstream, m_encoderFourCC);
+    if (m_mfxEncParams.mfx.CodecId != MFX_CODEC_DUMP) {
+        if (!bEncodeAgain) {
+            sts = AddQualityReference(st.VppExtSurface, m_pmfxSession.get());
+            MSDK_CHECK_STATUS(sts, "AddQualityReference failed");
         }
 
+        sts = EncodeOneFrame(&st.VppExtSurface, &m_BSPool.back()->Bitstream);
+    }
+    else {
+        sts = Surface2BS(&st.VppExtSurface, &m_BSPool.back()->Bitstream, m_encoderFourCC);
+    }
+
+    if (MFX_TASK_WORKING == sts) {
+        // the task is not in Encode queue, the encoder input is kept for the next step
+        m_BSPool.pop_back();
+        m_pBSStore->Release(pBS);
+        st.resumeStage = TranscodeState::STAGE_ENCODE;
+        return RequeueStep();
+    }
+    st.resumeStage = TranscodeState::STAGE_DECODE;
+    st.nStallStart = 0;
+
 #if defined(MFX_ONEVPL)
-        if (m_MemoryModel != GENERAL_ALLOC && VppExtSurface.pSurface) {
-            mfxStatus sts_release =
-                VppExtSurface.pSurface->FrameInterface->Release(VppExtSurface.pSurface);
-            MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
-        }
+    if (m_MemoryModel != GENERAL_ALLOC && st.VppExtSurface.pSurface) {
+        mfxStatus sts_release =
+            st.VppExtSurface.pSurface->FrameInterface->Release(st.VppExtSurface.pSurface);
+        MSDK_CHECK_STATUS(sts_release, "FrameInterface->Release failed");
+    }
 #endif //MFX_ONEVPL
 
-        // check if we need one more frame from decode
-        if (MFX_ERR_MORE_DATA == sts) {
-            // the task in not in Encode queue
-            m_BSPool.pop_back();
-            m_pBSStore->Release(pBS);
+    // check if we need one more frame from decode
+    if (MFX_ERR_MORE_DATA == sts) {
+        // the task in not in Encode queue
+        m_BSPool.pop_back();
+        m_pBSStore->Release(pBS);
 
-            if (NULL == VppExtSurface.pSurface) // there are no more buffered frames in encoder
-            {
-                break;
-            }
-            sts = MFX_ERR_NONE;
-            continue;
+        if (NULL == st.VppExtSurface.pSurface) // there are no more buffered frames in encoder
+        {
+            return MFX_ERR_MORE_DATA;
         }
+        return MFX_ERR_NONE;
+    }
 
-        // check encoding result
-        MSDK_CHECK_STATUS(sts, "<EncodeOneFrame|Surface2BS> failed");
+    // check encoding result
+    MSDK_CHECK_STATUS(sts, "<EncodeOneFrame|Surface2BS> failed");
 
-        if (statisticsWindowSize) {
-            if ((statisticsWindowSize && m_nOutputFramesNum &&
-                 0 == m_nProcessedFramesNum % statisticsWindowSize) ||
-                (statisticsWindowSize && (m_nProcessedFramesNum >= m_MaxFramesForTranscode))) {
-                inputStatistics.PrintStatistics(GetPipelineID());
-                outputStatistics.PrintStatistics(
-                    GetPipelineID(),
-                    (m_mfxEncParams.mfx.FrameInfo.FrameRateExtD)
-                        ? (mfxF64)m_mfxEncParams.mfx.FrameInfo.FrameRateExtN /
-                              (mfxF64)m_mfxEncParams.mfx.FrameInfo.FrameRateExtD
-                        : -1);
-                inputStatistics.ResetStatistics();
-                outputStatistics.ResetStatistics();
-            }
-        }
-        else if (0 == (m_nProcessedFramesNum - 1) % 100) {
-            msdk_printf(MSDK_STRING("."));
+    if (statisticsWindowSize) {
+        if ((statisticsWindowSize && m_nOutputFramesNum &&
+             0 == m_nProcessedFramesNum % statisticsWindowSize) ||
+            (statisticsWindowSize && (m_nProcessedFramesNum >= m_MaxFramesForTranscode))) {
+            inputStatistics.PrintStatistics(GetPipelineID());
+            outputStatistics.PrintStatistics(
+                GetPipelineID(),
+                (m_mfxEncParams.mfx.FrameInfo.FrameRateExtD)
+                    ? (mfxF64)m_mfxEncParams.mfx.FrameInfo.FrameRateExtN /
+                          (mfxF64)m_mfxEncParams.mfx.FrameInfo.FrameRateExtD
+                    : -1);
+            inputStatistics.ResetStatistics();
+            outputStatistics.ResetStatistics();
         }
+    }
+    else if (0 == (m_nProcessedFramesNum - 1) % 100) {
+        msdk_printf(MSDK_STRING("."));
+    }
 
-        m_BSPool.back()->Syncp = VppExtSurface.Syncp;
+    m_BSPool.back()->Syncp = st.VppExtSurface.Syncp;
 
-        if (m_BSPool.size() == m_AsyncDepth) {
-            sts = PutBS();
-            MSDK_CHECK_STATUS(sts, "PutBS failed");
-        }
+    if (m_BSPool.size() == m_AsyncDepth) {
+        sts = PutBS(waitMs);
+        if (MFX_TASK_WORKING == sts)
+            sts = MFX_ERR_NONE; // it's synchronized at the beginning of the next step
+        MSDK_CHECK_STATUS(sts, "PutBS failed");
+    }
 
-        msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
-        if (nFrameTime < m_nReqFrameTime) {
+    msdk_tick nFrameTime = msdk_time_get_tick() - nBeginTime;
+    AddFrameMetrics(nFrameTime);
+    if (nFrameTime < m_nReqFrameTime) {
+        if (st.bStepMode)
+            st.nNextFrameTime = nBeginTime + m_nReqFrameTime;
+        else
             MSDK_USLEEP((mfxU32)(m_nReqFrameTime - nFrameTime));
-        }
     }
+    else if (m_nReqFrameTime) {
+        m_nDeadlineMisses++;
+    }
+
+    return sts;
+} // mfxStatus CTranscodingPipeline::TranscodeStep(mfxU32 waitMs)
+
+// Returns MFX_TASK_WORKING to requeue the step, which fails once steps were requeued
+// for as long as Transcode() waits for a free surface
+mfxStatus CTranscodingPipeline::RequeueStep() {
+    TranscodeState& st = m_TranscodeState;
+    msdk_tick now      = msdk_time_get_tick();
+
+    if (!st.nStallStart)
+        st.nStallStart = now;
+    else if (MSDK_GET_TIME(now, st.nStallStart, msdk_time_get_frequency()) * 1000 >
+             MSDK_SURFACE_WAIT_INTERVAL) {
+        msdk_printf(MSDK_STRING("ERROR: No free surfaces or device busy (during long period)\n"));
+        return MFX_ERR_DEVICE_FAILED;
+    }
+    return MFX_TASK_WORKING;
+} // mfxStatus CTranscodingPipeline::RequeueStep()
+
+// Writes bitstreams left in the pool after the last step returned sts
+mfxStatus CTranscodingPipeline::FinishTranscode(mfxStatus sts, mfxU32 waitMs) {
     MSDK_IGNORE_MFX_STS(sts, MFX_ERR_MORE_DATA);
 
     // need to get buffered bitstream
     if (MFX_ERR_NONE == sts) {
         while (m_BSPool.size()) {
-            sts = PutBS();
+            sts = PutBS(waitMs);
+            if (MFX_TASK_WORKING == sts)
+                return sts;
             MSDK_CHECK_STATUS(sts, "PutBS failed");
         }
     }
@@ -2387,10 +2620,23 @@ mfxStatus CTranscodingPipeline::Transcode() {
     if (MFX_ERR_NONE == sts)
         sts = MFX_WRN_VALUE_NOT_CHANGED;
 
+    m_TranscodeState.bStarted = false;
     return sts;
+} // mfxStatus CTranscodingPipeline::FinishTranscode(mfxStatus sts, mfxU32 waitMs)
+
+mfxStatus CTranscodingPipeline::Transcode() {
+    mfxStatus sts = MFX_ERR_NONE;
+
+    StartTranscode(false);
+    while (MFX_ERR_NONE == sts) {
+        sts = TranscodeStep(MSDK_WAIT_INTERVAL);
+    }
+
+    return FinishTranscode(sts, MSDK_WAIT_INTERVAL);
 } // mfxStatus CTranscodingPipeline::Transcode()
 
-mfxStatus CTranscodingPipeline::PutBS() {
+mfxStatus CTranscodingPipeline::PutBS(mfxU32 waitMs) {
+    CStageTimer timer(m_pMetrics.get(), CSessionMetrics::STAGE_SYNC);
     mfxStatus sts            = MFX_ERR_NONE;
     ExtendedBS* pBitstreamEx = m_BSPool.front();
     MSDK_CHECK_POINTER(pBitstreamEx, MFX_ERR_NULL_PTR);
@@ -2402,15 +2648,27 @@ mfxStatus CTranscodingPipeline::PutBS() {
                                           SMTTracer::EventName::SYNC,
                                           pBitstreamEx->Syncp,
                                           nullptr);
-        sts = m_pmfxSession->SyncOperation(pBitstreamEx->Syncp, MSDK_WAIT_INTERVAL);
+        sts = m_pmfxSession->SyncOperation(pBitstreamEx->Syncp, waitMs);
         m_ScalerConfig.Tracer->EndEvent(SMTTracer::ThreadType::ENC,
                                         TargetID,
                                         SMTTracer::EventName::SYNC,
                                         nullptr,
                                         nullptr);
 
+        // short wait of the scheduler, the task is synchronized again later
+        if (MFX_WRN_IN_EXECUTION == sts && waitMs < MSDK_WAIT_INTERVAL)
+            return MFX_TASK_WORKING;
+
         HandlePossibleGpuHang(sts);
         MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "Encode: SyncOperation failed");
+        // the encoder unlocks the surfaces of the synchronized task
+        m_surfaceEvent.Signal();
+
+        // synchronized task frees the device, it isn't waited for again when it's busy
+        if (m_LastEncSyncPoint == pBitstreamEx->Syncp)
+            m_LastEncSyncPoint = NULL;
+        if (m_LastVppSyncPoint == pBitstreamEx->Syncp)
+            m_LastVppSyncPoint = NULL;
     }
 
     m_nOutputFramesNum++;
@@ -2421,6 +2679,13 @@ mfxStatus CTranscodingPipeline::PutBS() {
         outputStatistics.StartTimeMeasurement();
     }
 
+    if (m_pQualityMeter) {
+        sts = m_pQualityMeter->ProcessBitstream(pBitstreamEx->Bitstream);
+        MSDK_CHECK_STATUS(sts, "m_pQualityMeter->ProcessBitstream failed");
+        // copied input surfaces are unlocked
+        m_surfaceEvent.Signal();
+    }
+
     sts = m_pBSProcessor->ProcessOutputBitstream(&pBitstreamEx->Bitstream);
     MSDK_CHECK_STATUS(sts, "m_pBSProcessor->ProcessOutputBitstream failed");
 
@@ -2434,7 +2699,7 @@ mfxStatus CTranscodingPipeline::PutBS() {
     m_pBSStore->Release(pBitstreamEx);
 
     return sts;
-} //mfxStatus CTranscodingPipeline::PutBS()
+} //mfxStatus CTranscodingPipeline::PutBS(mfxU32 waitMs)
 
 mfxStatus CTranscodingPipeline::DumpSurface2File(mfxFrameSurface1* pSurf) {
     mfxStatus sts = MFX_ERR_NONE;
@@ -2481,6 +2746,7 @@ mfxStatus CTranscodingPipeline::Surface2BS(ExtendedSurface* pSurf,
         HandlePossibleGpuHang(sts);
         MSDK_CHECK_ERR_NONE_STATUS(sts, MFX_ERR_ABORTED, "SyncOperation failed");
         pSurf->Syncp = 0;
+        m_surfaceEvent.Signal();
 
         //--- Copying data from surface to bitstream
         if (m_MemoryModel == GENERAL_ALLOC) {
@@ -2815,6 +3081,24 @@ mfxStatus CTranscodingPipeline::InitEncMfxParams(sInputParams* pInParams) {
         0,
         MFX_ERR_INVALID_VIDEO_PARAM);
 
+    m_costKey.decodeId    = pInParams->DecodeId;
+    m_costKey.encodeId    = pInParams->EncodeId;
+    m_costKey.width       = m_mfxEncParams.mfx.FrameInfo.CropW
+                                ? m_mfxEncParams.mfx.FrameInfo.CropW
+                                : m_mfxEncParams.mfx.FrameInfo.Width;
+    m_costKey.height      = m_mfxEncParams.mfx.FrameInfo.CropH
+                                ? m_mfxEncParams.mfx.FrameInfo.CropH
+                                : m_mfxEncParams.mfx.FrameInfo.Height;
+    m_costKey.targetUsage = pInParams->nTargetUsage ? pInParams->nTargetUsage
+                                                    : (mfxU16)MFX_TARGETUSAGE_BALANCED;
+    // the session which doesn't fit the device may be given a faster target usage, the launcher
+    // doesn't run the rejected one
+    if (pInParams->pAdmission) {
+        pInParams->pAdmission->Admit(pInParams->TargetID, m_costKey, pInParams->nFPS);
+        if (pInParams->nTargetUsage || m_costKey.targetUsage != MFX_TARGETUSAGE_BALANCED)
+            pInParams->nTargetUsage = m_costKey.targetUsage;
+    }
+
     m_mfxEncParams.mfx.CodecId     = pInParams->EncodeId;
     m_mfxEncParams.mfx.TargetUsage = pInParams->nTargetUsage; // trade-off between quality and speed
     m_mfxEncParams.AsyncDepth      = m_AsyncDepth;
@@ -3663,6 +3947,9 @@ mfxStatus CTranscodingPipeline::AllocFramesForCS() {
             m_EncSurfaceType = PoolDesc.AllocReq.Type;
         }
         m_CSSurfacePools[PoolDesc.ID] = pool;
+        // threads of the scalers only look up the entries of their pools
+        m_nNextCSSurface[PoolDesc.ID]      = 0;
+        m_LastCSVppSyncPoints[PoolDesc.ID] = NULL;
     }
 
     return MFX_ERR_NONE;
@@ -4102,8 +4389,9 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
         statisticsWindowSize = m_MaxFramesForTranscode;
 
     if (m_bEncodeEnable) {
-        m_pBSStore.reset(new ExtendedBSStore(m_AsyncDepth));
+        m_pBSStore.reset(new ExtendedBSStore(m_AsyncDepth, pParams->pBitstreamPool));
     }
+    m_pMetrics = pParams->pMetrics;
 
     // Determine processing mode
     switch (pParams->eMode) {
@@ -4173,6 +4461,11 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
 
     m_pBuffer = pBuffer;
 
+    // surfaces passed through the buffers are released by the other sessions, which
+    // wakes the surface waits of this one
+    for (SafetySurfaceBuffer* buf = m_pBuffer; buf != NULL; buf = buf->m_pNext)
+        buf->AddReleaseListener(&m_surfaceEvent);
+
 #if defined(MFX_ONEVPL)
     m_initPar.Version.Major = 2;
     m_initPar.Version.Minor = 2;
@@ -4413,6 +4706,9 @@ mfxStatus CTranscodingPipeline::Init(sInputParams* pParams,
 #endif //MFX_VERSION >= 1022
     }
 
+    sts = InitQualityMeter(pParams, mfxLoader);
+    MSDK_CHECK_STATUS(sts, "InitQualityMeter failed");
+
     // Dumping components configuration if required
     if (m_strMfxParamsDumpFile.size()) {
         CParametersDumper::DumpLibraryConfiguration(m_strMfxParamsDumpFile,
@@ -4442,6 +4738,18 @@ mfxStatus CTranscodingPipeline::CompleteInit() {
             MSDK_CHECK_STATUS(sts, "AllocFrames failed");
             LoadStaticSurface();
             MSDK_CHECK_STATUS(sts, "LoadStaticSurface failed");
+
+            // decoding session passes surfaces of its pools to the buffers, all of
+            // them fit, so it never waits for the consumers there
+            mfxU32 numSurfaces = (mfxU32)(m_pSurfaceDecPool.size() + m_pSurfaceEncPool.size());
+            for (auto& pool : m_CSSurfacePools)
+                numSurfaces += (mfxU32)pool.second.size();
+            for (SafetySurfaceBuffer* buf = m_pBuffer; buf != NULL; buf = buf->m_pNext) {
+                buf->Reserve(numSurfaces);
+                // composition uses only the first buffer of the chain
+                if (m_nVPPCompEnable)
+                    break;
+            }
         }
     }
 
@@ -4507,47 +4815,11 @@ mfxStatus CTranscodingPipeline::CompleteInit() {
     return sts;
 } // mfxStatus CTranscodingPipeline::CompleteInit()
 mfxFrameSurface1* CTranscodingPipeline::GetFreeSurface(bool isDec, mfxU64 timeout) {
-    mfxFrameSurface1* pSurf = NULL;
-
-    CTimer t;
-    t.Start();
-    do {
-        {
-            std::lock_guard<std::mutex> lock(m_mStopSession);
-            if (m_bForceStop) {
-                msdk_printf(MSDK_STRING(
-                    "WARNING: m_bForceStop is set, returning NULL ptr from GetFreeSurface\n"));
-                break;
-            }
-        }
-
-        SurfPointersArray& workArray = isDec ? m_pSurfaceDecPool : m_pSurfaceEncPool;
-
-        int available =
-            (int)std::count_if(workArray.begin(), workArray.end(), [](mfxFrameSurface1* s) {
-                return s->Data.Locked == 0;
-            });
-        m_ScalerConfig.Tracer->AddCounterEvent(
-            isDec ? SMTTracer::ThreadType::DEC : SMTTracer::ThreadType::ENC,
-            TargetID,
-            SMTTracer::EventName::UNDEF,
-            available);
-
-        for (mfxU32 i = 0; i < workArray.size(); i++) {
-            if (!workArray[i]->Data.Locked) {
-                pSurf = workArray[i];
-                break;
-            }
-        }
-        if (pSurf) {
-            break;
-        }
-        else {
-            MSDK_SLEEP(TIME_TO_SLEEP);
-        }
-    } while (t.GetTime() < timeout / 1000);
-
-    return pSurf;
+    return WaitForFreeSurface(isDec ? m_pSurfaceDecPool : m_pSurfaceEncPool,
+                              isDec ? m_nNextDecSurface : m_nNextEncSurface,
+                              isDec ? SMTTracer::ThreadType::DEC : SMTTracer::ThreadType::ENC,
+                              TargetID,
+                              timeout);
 } // mfxFrameSurface1* CTranscodingPipeline::GetFreeSurface(bool isDec)
 
 mfxFrameSurface1* CTranscodingPipeline::GetFreeSurfaceForCS(bool isDec, mfxU64 timeout, mfxU32 ID) {
@@ -4555,11 +4827,91 @@ mfxFrameSurface1* CTranscodingPipeline::GetFreeSurfaceForCS(bool isDec, mfxU64 t
         return GetFreeSurface(isDec, timeout);
     }
 
+    auto desc = m_ScalerConfig.GetDesc(ID);
+    return WaitForFreeSurface(m_CSSurfacePools.at(desc.PoolID),
+                              m_nNextCSSurface.at(desc.PoolID),
+                              SMTTracer::ThreadType::CSVPP,
+                              desc.PoolID,
+                              timeout);
+} // mfxFrameSurface1* CTranscodingPipeline::GetFreeSurfaceForCS(bool isDec)
+
+mfxU64 CTranscodingPipeline::GetSurfaceWaitInterval() const {
+    return m_TranscodeState.bStepMode ? m_TranscodeState.nWaitMs : MSDK_SURFACE_WAIT_INTERVAL;
+} // mfxU64 CTranscodingPipeline::GetSurfaceWaitInterval() const
+
+// Waits for the last task of the component, which frees the device. In step mode waits
+// no longer than the step, sts is MFX_TASK_WORKING if the task isn't done by then.
+void CTranscodingPipeline::WaitForDevice(MFXVideoSession& session,
+                                         mfxSyncPoint& syncPoint,
+                                         mfxStatus& sts) {
+    if (!m_TranscodeState.bStepMode) {
+        WaitForDeviceToBecomeFree(session, syncPoint, sts);
+        return;
+    }
+
+    if (!syncPoint) {
+        // tasks of other components or sessions keep the device busy
+        if (m_TranscodeState.nWaitMs)
+            MSDK_SLEEP(std::min<mfxU32>(m_TranscodeState.nWaitMs, TIME_TO_SLEEP));
+        sts = MFX_TASK_WORKING;
+        return;
+    }
+
+    mfxStatus stsSync = session.SyncOperation(syncPoint, m_TranscodeState.nWaitMs);
+    if (MFX_WRN_IN_EXECUTION == stsSync) {
+        sts = MFX_TASK_WORKING;
+    }
+    else if (MFX_ERR_NONE == stsSync) {
+        syncPoint = NULL;
+        sts       = MFX_ERR_NONE;
+    }
+    else {
+        HandlePossibleGpuHang(stsSync);
+        MSDK_TRACE_ERROR(MSDK_STRING("WaitForDevice: SyncOperation failed, sts = ") << stsSync);
+        sts = MFX_ERR_ABORTED;
+    }
+} // void CTranscodingPipeline::WaitForDevice
+
+// Surfaces are taken and released in about the same order, so the lookup starts
+// after the surface returned last and the first checked surface is usually free.
+static mfxFrameSurface1* FindFreeSurface(std::vector<mfxFrameSurface1*>& pool,
+                                         mfxU32& nextSurface) {
+    mfxU32 size = (mfxU32)pool.size();
+    for (mfxU32 i = 0; i < size; i++) {
+        mfxU32 idx = (nextSurface + i) % size;
+        if (!pool[idx]->Data.Locked) {
+            nextSurface = (idx + 1) % size;
+            return pool[idx];
+        }
+    }
+    return NULL;
+}
+
+mfxFrameSurface1* CTranscodingPipeline::WaitForFreeSurface(std::vector<mfxFrameSurface1*>& pool,
+                                                           mfxU32& nextSurface,
+                                                           SMTTracer::ThreadType thType,
+                                                           mfxU32 thID,
+                                                           mfxU64 timeout) {
     mfxFrameSurface1* pSurf = NULL;
 
+    if (m_pMetrics) {
+        CSessionMetrics::Pool metricsPool = CSessionMetrics::POOL_SCALER;
+        if (SMTTracer::ThreadType::DEC == thType)
+            metricsPool = CSessionMetrics::POOL_DECODE;
+        else if (SMTTracer::ThreadType::ENC == thType)
+            metricsPool = CSessionMetrics::POOL_ENCODE;
+
+        mfxU32 used = (mfxU32)std::count_if(pool.begin(), pool.end(), [](mfxFrameSurface1* s) {
+            return s->Data.Locked != 0;
+        });
+        m_pMetrics->SetSurfacePool(metricsPool, used, (mfxU32)pool.size());
+    }
+
     CTimer t;
     t.Start();
-    do {
+    for (;;) {
+        // counter is read before the lookup, releases made during it wake the wait
+        mfxU64 counter = m_surfaceEvent.GetCounter();
         {
             std::lock_guard<std::mutex> lock(m_mStopSession);
             if (m_bForceStop) {
@@ -4569,34 +4921,34 @@ mfxFrameSurface1* CTranscodingPipeline::GetFreeSurfaceForCS(bool isDec, mfxU64 t
             }
         }
 
-        auto desc                    = m_ScalerConfig.GetDesc(ID);
-        SurfPointersArray& workArray = m_CSSurfacePools[desc.PoolID];
+        if (m_ScalerConfig.Tracer->IsEnabled()) {
+            int available =
+                (int)std::count_if(pool.begin(), pool.end(), [](mfxFrameSurface1* s) {
+                    return s->Data.Locked == 0;
+                });
+            m_ScalerConfig.Tracer->AddCounterEvent(thType,
+                                                   thID,
+                                                   SMTTracer::EventName::SURF_POOL,
+                                                   available,
+                                                   pool.size());
+        }
 
-        int available =
-            (int)std::count_if(workArray.begin(), workArray.end(), [](mfxFrameSurface1* s) {
-                return s->Data.Locked == 0;
-            });
-        m_ScalerConfig.Tracer->AddCounterEvent(SMTTracer::ThreadType::CSVPP,
-                                               desc.PoolID,
-                                               SMTTracer::EventName::UNDEF,
-                                               available);
+        pSurf = FindFreeSurface(pool, nextSurface);
+        if (pSurf)
+            break;
 
-        for (mfxU32 i = 0; i < workArray.size(); i++) {
-            if (!workArray[i]->Data.Locked) {
-                pSurf = workArray[i];
-                break;
-            }
-        }
-        if (pSurf) {
+        mfxF64 elapsed = t.GetTime() * 1000; // ms, as the timeout
+        if (elapsed >= (mfxF64)timeout)
             break;
-        }
-        else {
-            MSDK_SLEEP(TIME_TO_SLEEP);
-        }
-    } while (t.GetTime() < timeout / 1000);
+
+        // syncs of the pipeline and releases through the buffers signal the event, the
+        // wait ends with the timeout otherwise (rounded up, so the loop doesn't spin)
+        mfxU32 msec = (mfxU32)std::min<mfxF64>((mfxF64)timeout - elapsed + 1, MFX_INFINITE);
+        m_surfaceEvent.Wait(counter, msec);
+    }
 
     return pSurf;
-} // mfxFrameSurface1* CTranscodingPipeline::GetFreeSurface(bool isDec)
+} // mfxFrameSurface1* CTranscodingPipeline::WaitForFreeSurface
 
 mfxU32 CTranscodingPipeline::GetFreeSurfacesCount(bool isDec) {
     SurfPointersArray& workArray = isDec ? m_pSurfaceDecPool : m_pSurfaceEncPool;
@@ -4641,15 +4993,27 @@ void CTranscodingPipeline::SetNumFramesForReset(mfxU32 nFrames) {
     m_NumFramesForReset = nFrames;
 }
 
+// Frame took nFrameTime since the beginning of its processing
+void CTranscodingPipeline::AddFrameMetrics(msdk_tick nFrameTime) {
+    if (!m_pMetrics)
+        return;
+
+    m_pMetrics->AddFrame(nFrameTime, m_nReqFrameTime && nFrameTime >= m_nReqFrameTime);
+    m_pMetrics->bitstreamQueue = (mfxU32)m_BSPool.size();
+}
+
 void CTranscodingPipeline::HandlePossibleGpuHang(mfxStatus& sts) {
+    if (sts == MFX_ERR_GPU_HANG && m_pMetrics)
+        m_pMetrics->numGpuHangs++;
+
     if (sts == MFX_ERR_GPU_HANG && m_bSoftGpuHangRecovery) {
         msdk_printf(MSDK_STRING(
             "[WARNING] GPU hang happened. Inserting an IDR and continuing transcoding.\n"));
         m_bInsertIDR = true;
         for (BSList::iterator it = m_BSPool.begin(); it != m_BSPool.end(); it++) {
-            (*it)->IsFree               = true;
             (*it)->Bitstream.DataOffset = 0;
             (*it)->Bitstream.DataLength = 0;
+            m_pBSStore->Release(*it);
         }
         m_BSPool.clear();
         sts = MFX_ERR_NONE;
@@ -4746,6 +5110,8 @@ void CTranscodingPipeline::Close() {
 
     m_pmfxVPP.reset();
 
+    m_pQualityMeter.reset();
+
     m_pmfxSession.reset();
 
 #if !defined(MFX_ONEVPL)
@@ -4849,6 +5215,17 @@ mfxStatus CTranscodingPipeline::Reset(VPLImplementationLoader* mfxLoader) {
     for (size_t i = 0; i < m_pSurfaceEncPool.size(); i++) {
         m_pSurfaceEncPool[i]->Data.Locked = 0;
     }
+    m_nNextDecSurface  = 0;
+    m_nNextEncSurface  = 0;
+    m_LastDecSyncPoint = NULL;
+    m_LastVppSyncPoint = NULL;
+    m_LastEncSyncPoint = NULL;
+    // entries of the pools stay, other threads may look them up
+    for (auto& next : m_nNextCSSurface)
+        next.second = 0;
+    for (auto& syncPoint : m_LastCSVppSyncPoints)
+        syncPoint.second = NULL;
+    m_TranscodeState = TranscodeState();
 
     // Release all safety buffers
     SafetySurfaceBuffer* sptr = m_pBuffer;
@@ -5066,7 +5443,10 @@ mfxStatus CTranscodingPipeline::AllocateSufficientBuffer(mfxBitstreamWrapper* pB
                        : 2 * pBS->MaxLength;
     }
 
-    pBS->Extend(new_size);
+    if (m_pBSStore)
+        m_pBSStore->Grow(*pBS, new_size);
+    else
+        pBS->Extend(new_size);
 
     return MFX_ERR_NONE;
 } // CTranscodingPipeline::AllocateSufficientBuffer(mfxBitstreamWrapper* pBS)
@@ -5104,9 +5484,66 @@ mfxStatus CTranscodingPipeline::Run() {
     else
         return MFX_ERR_UNSUPPORTED;
 
+    mfxStatus stsMeter = FlushQualityMeter();
+    MSDK_CHECK_STATUS(stsMeter, "FlushQualityMeter failed");
+
     return sts;
 }
 
+mfxStatus CTranscodingPipeline::RunStep(mfxU32 waitMs) {
+    // only the session which decodes and encodes doesn't wait for other sessions
+    if (!m_bDecodeEnable || !m_bEncodeEnable)
+        return MFX_ERR_UNSUPPORTED;
+
+    TranscodeState& st = m_TranscodeState;
+    if (!st.bStarted)
+        StartTranscode(true);
+
+    mfxStatus sts = MFX_ERR_NONE;
+    if (!st.bFlushing) {
+        sts = TranscodeStep(waitMs);
+        if (MFX_ERR_NONE == sts || MFX_TASK_WORKING == sts)
+            return sts;
+        st.bFlushing = true;
+    }
+
+    sts = FinishTranscode(sts, waitMs);
+    if (MFX_TASK_WORKING == sts)
+        return sts;
+    st.bStarted = false;
+
+    msdk_stringstream ss;
+    ss << MSDK_STRING("CTranscodingPipeline::RunStep::Transcode() [") << GetSessionText()
+       << MSDK_STRING("] failed");
+    MSDK_CHECK_STATUS(sts, ss.str());
+
+    mfxStatus stsMeter = FlushQualityMeter();
+    MSDK_CHECK_STATUS(stsMeter, "FlushQualityMeter failed");
+
+    return sts;
+} // mfxStatus CTranscodingPipeline::RunStep(mfxU32 waitMs)
+
+// Compares frames still buffered by the decoder of the quality meter
+mfxStatus CTranscodingPipeline::FlushQualityMeter() {
+    if (!m_pQualityMeter)
+        return MFX_ERR_NONE;
+
+    mfxStatus sts = m_pQualityMeter->Flush();
+    MSDK_CHECK_STATUS(sts, "m_pQualityMeter->Flush failed");
+
+    msdk_stringstream prefix;
+    prefix << MSDK_STRING("Session ") << GetPipelineID() << MSDK_STRING(" quality");
+    m_pQualityMeter->PrintStatistics(prefix.str().c_str());
+    // and to the -stat-log file along with the timing statistics
+    FILE* pStatFile = outputStatistics.GetOutputFile();
+    if (pStatFile && pStatFile != stdout) {
+        m_pQualityMeter->PrintStatistics(prefix.str().c_str(), pStatFile);
+        fflush(pStatFile);
+    }
+
+    return MFX_ERR_NONE;
+}
+
 void IncreaseReference(mfxFrameSurface1& surf) {
     msdk_atomic_inc16((volatile mfxU16*)(&surf.Data.Locked));
 #if defined(MFX_ONEVPL)
@@ -5125,143 +5562,151 @@ void DecreaseReference(mfxFrameSurface1& surf) {
 #endif
 }
 
-SafetySurfaceBuffer::SafetySurfaceBuffer(SafetySurfaceBuffer* pNext)
-        : m_pNext(pNext),
-          m_mutex(),
-          m_SList(),
-          m_IsBufferingAllowed(true),
-          pInsEvent(nullptr) {
-    mfxStatus sts = MFX_ERR_NONE;
-    pRelEvent     = nullptr;
-    pInsEvent     = nullptr;
-    pRelEvent     = new MSDKEvent(sts, false, false);
-    MSDK_CHECK_POINTER_NO_RET(pRelEvent);
+mfxU64 SurfaceAvailabilityEvent::GetCounter() {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_counter;
+}
+
+void SurfaceAvailabilityEvent::Signal() {
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_counter++;
+    }
+    m_cv.notify_all();
+}
 
-    pInsEvent = new MSDKEvent(sts, false, false);
-    MSDK_CHECK_POINTER_NO_RET(pInsEvent);
+bool SurfaceAvailabilityEvent::Wait(mfxU64 counter, mfxU32 msec) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_cv.wait_for(lock, std::chrono::milliseconds(msec), [this, counter] {
+        return m_counter != counter;
+    });
+}
 
-} // SafetySurfaceBuffer::SafetySurfaceBuffer
+SafetySurfaceBuffer::SafetySurfaceBuffer(SafetySurfaceBuffer* pNext, mfxU32 capacity)
+        : m_pNext(pNext),
+          m_ring(capacity),
+          m_insertion(),
+          m_release(),
+          m_numReleased(0),
+          m_releaseListeners(),
+          m_IsBufferingAllowed(true) {} // SafetySurfaceBuffer::SafetySurfaceBuffer
 
-SafetySurfaceBuffer::~SafetySurfaceBuffer() {
-    if (pRelEvent) {
-        delete pRelEvent;
-    }
-    if (pInsEvent) {
-        delete pInsEvent;
-    }
-} //SafetySurfaceBuffer::~SafetySurfaceBuffer()
+SafetySurfaceBuffer::~SafetySurfaceBuffer() {} //SafetySurfaceBuffer::~SafetySurfaceBuffer()
 
 mfxU32 SafetySurfaceBuffer::GetLength() {
-    std::lock_guard<std::mutex> guard(m_mutex);
-    return (mfxU32)m_SList.size();
+    return m_ring.GetLength();
+}
+
+void SafetySurfaceBuffer::Reserve(mfxU32 numSurfaces) {
+    if (numSurfaces + 1 > m_ring.GetCapacity())
+        m_ring.Reset(numSurfaces + 1);
 }
 
 mfxStatus SafetySurfaceBuffer::WaitForSurfaceRelease(mfxU32 msec) {
-    if (pRelEvent) {
-        return pRelEvent->TimedWait(msec);
-    }
-    else {
-        return MFX_ERR_NULL_PTR;
-    }
+    mfxU64 numReleased = m_numReleased.load();
+    return m_release.WaitFor(
+               [this, numReleased] {
+                   return m_numReleased.load() != numReleased;
+               },
+               msec)
+               ? MFX_ERR_NONE
+               : MFX_TASK_WORKING;
 }
 
 mfxStatus SafetySurfaceBuffer::WaitForSurfaceInsertion(mfxU32 msec) {
-    if (pInsEvent) {
-        return pInsEvent->TimedWait(msec);
-    }
-    else {
-        return MFX_ERR_NULL_PTR;
-    }
+    ExtendedSurface surf;
+    return m_insertion.WaitFor(
+               [this, &surf] {
+                   return m_ring.Front(surf);
+               },
+               msec)
+               ? MFX_ERR_NONE
+               : MFX_TASK_WORKING;
 }
 
 void SafetySurfaceBuffer::AddSurface(ExtendedSurface Surf) {
-    if (!pInsEvent) {
+    if (!m_IsBufferingAllowed)
         return;
-    }
-
-    bool isBufferingAllowed = false;
 
-    {
-        std::lock_guard<std::mutex> guard(m_mutex);
-
-        isBufferingAllowed = m_IsBufferingAllowed;
-        if (isBufferingAllowed) {
-            SurfaceDescriptor sDescriptor;
-            // Locked is used to signal when we can free surface
-            sDescriptor.Locked     = 1;
-            sDescriptor.ExtSurface = Surf;
+    if (Surf.pSurface) {
+        IncreaseReference(*Surf.pSurface);
+    }
 
-            if (Surf.pSurface) {
-                IncreaseReference(*Surf.pSurface);
-            }
+    while (!m_ring.Push(Surf)) {
+        // full, a consumer holds all surfaces of the producer
+        m_release.WaitFor(
+            [this] {
+                return !m_ring.IsFull() || !m_IsBufferingAllowed;
+            },
+            MSDK_SURFACE_WAIT_INTERVAL);
 
-            m_SList.push_back(sDescriptor);
+        if (!m_IsBufferingAllowed) {
+            if (Surf.pSurface)
+                DecreaseReference(*Surf.pSurface);
+            return;
         }
     }
 
-    if (isBufferingAllowed) {
-        pInsEvent->Signal();
-    }
+    m_insertion.Notify();
 
 } // SafetySurfaceBuffer::AddSurface(mfxFrameSurface1 *pSurf)
 
 mfxStatus SafetySurfaceBuffer::GetSurface(ExtendedSurface& Surf) {
-    std::lock_guard<std::mutex> guard(m_mutex);
-
     // no ready surfaces
-    if (0 == m_SList.size()) {
+    if (!m_ring.Front(Surf)) {
         MSDK_ZERO_MEMORY(Surf)
         return MFX_ERR_MORE_SURFACE;
     }
 
-    SurfaceDescriptor sDescriptor = m_SList.front();
-
-    Surf = sDescriptor.ExtSurface;
-
     return MFX_ERR_NONE;
 
 } // SafetySurfaceBuffer::GetSurface()
 
 mfxStatus SafetySurfaceBuffer::ReleaseSurface(mfxFrameSurface1* pSurf) {
-    if (!pRelEvent) {
-        return MFX_ERR_NULL_PTR;
-    }
+    bool released = m_ring.Release([pSurf](const ExtendedSurface& surf) {
+        return surf.pSurface == pSurf;
+    });
+    if (!released)
+        return MFX_ERR_UNKNOWN;
 
-    std::unique_lock<std::mutex> lock(m_mutex);
+    if (pSurf)
+        DecreaseReference(*pSurf);
 
-    std::list<SurfaceDescriptor>::iterator it;
-    for (it = m_SList.begin(); it != m_SList.end(); it++) {
-        if (pSurf == it->ExtSurface.pSurface) {
-            it->Locked--;
-            if (it->ExtSurface.pSurface)
-                DecreaseReference(*it->ExtSurface.pSurface);
-            if (0 == it->Locked) {
-                m_SList.erase(it);
-                lock.unlock();
-
-                // event operation should be out of synced context
-                pRelEvent->Signal();
-            }
+    m_numReleased++;
+    m_release.Notify();
+    NotifyReleaseListeners();
 
-            return MFX_ERR_NONE;
-        }
-    }
-
-    return MFX_ERR_UNKNOWN;
+    return MFX_ERR_NONE;
 } // mfxStatus SafetySurfaceBuffer::ReleaseSurface(mfxFrameSurface1* pSurf)
 
 mfxStatus SafetySurfaceBuffer::ReleaseSurfaceAll() {
-    std::lock_guard<std::mutex> guard(m_mutex);
-
-    m_SList.clear();
+    // consumers may still release surfaces, each one is released here or by them
+    m_ring.Clear();
     m_IsBufferingAllowed = true;
+
+    m_numReleased++;
+    m_release.Notify();
+    NotifyReleaseListeners();
     return MFX_ERR_NONE;
 
 } // mfxStatus SafetySurfaceBuffer::ReleaseSurface(mfxFrameSurface1* pSurf)
 
 void SafetySurfaceBuffer::CancelBuffering() {
-    std::lock_guard<std::mutex> guard(m_mutex);
     m_IsBufferingAllowed = false;
+    // producer waiting for space gives up
+    m_release.Notify();
+}
+
+void SafetySurfaceBuffer::AddReleaseListener(SurfaceAvailabilityEvent* pEvent) {
+    if (pEvent &&
+        std::find(m_releaseListeners.begin(), m_releaseListeners.end(), pEvent) ==
+            m_releaseListeners.end())
+        m_releaseListeners.push_back(pEvent);
+}
+
+void SafetySurfaceBuffer::NotifyReleaseListeners() {
+    for (SurfaceAvailabilityEvent* pEvent : m_releaseListeners)
+        pEvent->Signal();
 }
 
 FileBitstreamProcessor::FileBitstreamProcessor()
@@ -97,13 +97,24 @@ Launcher::Launcher()
           m_pExtBSProcArray(),
           m_pAllocParams(),
           m_hwdevs(),
+          m_hdls(),
           m_StartTime(0),
           m_eDevType(static_cast<mfxHandleType>(0)),
           m_accelerationMode(MFX_ACCEL_MODE_NA),
           m_adapterNum(),
           m_deviceID(),
           m_pLoader(),
-          m_VppDstRects()
+          m_VppDstRects(),
+          m_CSConfig(),
+          m_Tracer(),
+          m_launcherCpus(),
+          m_nextNumaNode(0),
+          m_pControl(),
+          m_restarts(),
+          m_streamIndexes(),
+          m_bQuit(false),
+          m_pAdmission(),
+          m_pMetrics()
 #if (defined(_WIN32) || defined(_WIN64)) && (MFX_VERSION >= 1031)
           ,
           m_DisplaysData(),
@@ -122,13 +133,23 @@ CTranscodingPipeline* CreatePipeline() {
     return new CTranscodingPipeline;
 }
 
+// system memory options are set per session
+std::shared_ptr<mfxAllocatorParams> CreateSysMemAllocatorParams(const sInputParams& params) {
+    std::shared_ptr<SysMemAllocatorParams> pSysMemParams(new SysMemAllocatorParams);
+    pSysMemParams->nOptions = params.nSysMemOptions;
+    if (params.nNumaNode >= 0) {
+        pSysMemParams->nOptions |= SYSMEM_ALLOC_NUMA;
+        pSysMemParams->nNumaNode = params.nNumaNode;
+    }
+    return pSysMemParams;
+}
+
 mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     mfxStatus sts;
     mfxU32 i                     = 0;
     SafetySurfaceBuffer* pBuffer = NULL;
     mfxU32 BufCounter            = 0;
     mfxHDL hdl                   = NULL;
-    std::vector<mfxHDL> hdls;
     sInputParams InputParams;
     bool bNeedToCreateDevice = true;
 
@@ -158,6 +179,65 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     sts = VerifyCrossSessionsOptions();
     MSDK_CHECK_STATUS(sts, "VerifyCrossSessionsOptions failed");
 
+    sts = PlaceSessions();
+    MSDK_CHECK_STATUS(sts, "PlaceSessions failed");
+
+    // buffers released by a finished or reset session are taken by the others
+    std::shared_ptr<CBitstreamBufferPool> pBitstreamPool(new CBitstreamBufferPool);
+    for (i = 0; i < m_InputParamsArray.size(); i++)
+        m_InputParamsArray[i].pBitstreamPool = pBitstreamPool;
+
+    const msdk_char* capacityName = m_parser.GetCapacityFileName();
+    if (m_parser.GetCalibrationFileName()) {
+        if (capacityName) {
+            msdk_printf(MSDK_STRING("error: -calibrate and -capacity can't be used together\n"));
+            return MFX_ERR_UNSUPPORTED;
+        }
+        for (i = 0; i < m_InputParamsArray.size(); i++) {
+            sInputParams& params = m_InputParamsArray[i];
+            // a session is measured alone
+            if (Native != params.eMode || params.bIsJoin || params.bRobustFlag) {
+                msdk_printf(MSDK_STRING("error: session %d can't be calibrated, it has to ")
+                                MSDK_STRING("decode and encode on its own\n"),
+                            i);
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (params.nFPS) {
+                msdk_printf(MSDK_STRING("Warning: -fps of session %d is ignored by -calibrate\n"),
+                            i);
+                params.nFPS = 0;
+            }
+        }
+    }
+    else if (capacityName) {
+        if (m_InputParamsArray[0].bRobustFlag) {
+            msdk_printf(MSDK_STRING("Warning: -capacity is ignored in robust mode\n"));
+        }
+        else {
+            mfxU32 maxLoad = m_parser.GetCapacityLoad();
+            if (!maxLoad)
+                maxLoad = CAdmissionController::DEFAULT_LOAD;
+
+            m_pAdmission.reset(new CAdmissionController);
+            sts = m_pAdmission->Init(capacityName, maxLoad);
+            MSDK_CHECK_STATUS(sts, "m_pAdmission->Init failed");
+
+            // sessions sharing surfaces or a runtime session can't be rejected one by one
+            for (i = 0; i < m_InputParamsArray.size(); i++) {
+                if (Native == m_InputParamsArray[i].eMode && !m_InputParamsArray[i].bIsJoin)
+                    m_InputParamsArray[i].pAdmission = m_pAdmission;
+            }
+        }
+    }
+
+    if (m_parser.GetMetricsFileName() || m_parser.GetMetricsPort()) {
+        m_pMetrics.reset(new CMetricsExporter);
+        for (i = 0; i < m_InputParamsArray.size(); i++) {
+            m_InputParamsArray[i].pMetrics.reset(new CSessionMetrics);
+            m_pMetrics->AddSession((mfxU32)i, m_InputParamsArray[i].pMetrics);
+        }
+    }
+
     m_pLoader.reset(new VPLImplementationLoader);
     sts = m_pLoader->ConfigureAndEnumImplementations(m_InputParamsArray[0].libType,
                                                      m_accelerationMode);
@@ -212,12 +292,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(pAllocParam);
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -254,12 +334,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(pAllocParam);
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -350,12 +430,12 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
                 m_pAllocParams.push_back(std::shared_ptr<mfxAllocatorParams>(pAllocParam));
                 m_hwdevs.push_back(std::move(hwdev));
-                hdls.push_back(hdl);
+                m_hdls.push_back(hdl);
             }
             else {
-                if (!m_pAllocParams.empty() && !hdls.empty()) {
+                if (!m_pAllocParams.empty() && !m_hdls.empty()) {
                     m_pAllocParams.push_back(m_pAllocParams.back());
-                    hdls.push_back(hdls.back());
+                    m_hdls.push_back(m_hdls.back());
                 }
                 else {
                     msdk_printf(MSDK_STRING("error: failed to initialize alloc parameters\n"));
@@ -366,18 +446,23 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 #endif
     }
     if (m_pAllocParams.empty()) {
-        m_pAllocParams.push_back(std::shared_ptr<mfxAllocatorParams>(new SysMemAllocatorParams));
-        hdls.push_back(NULL);
-
-        for (i = 1; i < m_InputParamsArray.size(); i++) {
-            m_pAllocParams.push_back(m_pAllocParams.back());
-            hdls.push_back(NULL);
+        for (i = 0; i < m_InputParamsArray.size(); i++) {
+            m_pAllocParams.push_back(CreateSysMemAllocatorParams(m_InputParamsArray[i]));
+            m_hdls.push_back(NULL);
         }
     }
 
     // each pair of source and sink has own safety buffer
     sts = CreateSafetyBuffers();
     MSDK_CHECK_STATUS(sts, "CreateSafetyBuffers failed");
+    if (m_pMetrics) {
+        for (i = 0; i < m_pBufferArray.size(); i++) {
+            SafetySurfaceBuffer* pQueue = m_pBufferArray[i].get();
+            m_pMetrics->AddQueue((mfxU32)i, [pQueue]() {
+                return pQueue->GetLength();
+            });
+        }
+    }
 
     /* One more hint. Example you have 3 dec + 1 enc sessions
     * (enc means vpp_comp call invoked. m_InputParamsArray.size() is 4.
@@ -399,6 +484,8 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     // create sessions, allocators
     for (i = 0; i < m_InputParamsArray.size(); i++) {
         msdk_printf(MSDK_STRING("Session %d:\n"), i);
+        SetInitThreadAffinity(m_InputParamsArray[i].cpuSet);
+
         std::unique_ptr<GeneralAllocator> pAllocator(new GeneralAllocator);
         sts = pAllocator->Init(m_pAllocParams[i].get());
         MSDK_CHECK_STATUS(sts, "pAllocator->Init failed");
@@ -407,8 +494,10 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 
         std::unique_ptr<ThreadTranscodeContext> pThreadPipeline(new ThreadTranscodeContext);
         // extend BS processing init
-        m_pExtBSProcArray.push_back(
-            std::unique_ptr<FileBitstreamProcessor>(new FileBitstreamProcessor));
+        std::unique_ptr<FileBitstreamProcessor> pBSProcessor;
+        sts = CreateBitstreamProcessor(m_InputParamsArray[i], pBSProcessor);
+        MSDK_CHECK_STATUS(sts, "CreateBitstreamProcessor failed");
+        m_pExtBSProcArray.push_back(std::move(pBSProcessor));
 
         pThreadPipeline->pPipeline.reset(CreatePipeline());
 
@@ -418,44 +507,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 #endif
 
         pThreadPipeline->pBSProcessor = m_pExtBSProcArray.back().get();
-
-        std::unique_ptr<CSmplBitstreamReader> reader;
-        std::unique_ptr<CSmplYUVReader> yuvreader;
-        if (m_InputParamsArray[i].DecodeId == MFX_CODEC_VP9 ||
-            m_InputParamsArray[i].DecodeId == MFX_CODEC_VP8 ||
-            m_InputParamsArray[i].DecodeId == MFX_CODEC_AV1) {
-            reader.reset(new CIVFFrameReader());
-        }
-        else if (m_InputParamsArray[i].DecodeId == MFX_CODEC_RGB4 ||
-                 m_InputParamsArray[i].DecodeId == MFX_CODEC_I420 ||
-                 m_InputParamsArray[i].DecodeId == MFX_CODEC_NV12) {
-            // YUV reader for RGB4 overlay and raw input
-            yuvreader.reset(new CSmplYUVReader());
-        }
-        else {
-            reader.reset(new CSmplBitstreamReader());
-        }
-
-        if (reader.get()) {
-            sts = reader->Init(m_InputParamsArray[i].strSrcFile);
-            MSDK_CHECK_STATUS(sts, "reader->Init failed");
-            sts = m_pExtBSProcArray.back()->SetReader(reader);
-            MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetReader failed");
-        }
-        else if (yuvreader.get()) {
-            std::list<msdk_string> input;
-            input.push_back(m_InputParamsArray[i].strSrcFile);
-            sts = yuvreader->Init(input, m_InputParamsArray[i].DecodeId);
-            MSDK_CHECK_STATUS(sts, "m_YUVReader->Init failed");
-            sts = m_pExtBSProcArray.back()->SetReader(yuvreader);
-            MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetReader failed");
-        }
-
-        std::unique_ptr<CSmplBitstreamWriter> writer(new CSmplBitstreamWriter());
-        sts = writer->Init(m_InputParamsArray[i].strDstFile);
-
-        sts = m_pExtBSProcArray.back()->SetWriter(writer);
-        MSDK_CHECK_STATUS(sts, "m_pExtBSProcArray.back()->SetWriter failed");
+        pThreadPipeline->cpuSet       = m_InputParamsArray[i].cpuSet;
 
         if (Sink == m_InputParamsArray[i].eMode) {
             /* N_to_1 mode */
@@ -509,7 +561,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 #endif
             sts = pThreadPipeline->pPipeline->Init(&m_InputParamsArray[i],
                                                    m_pAllocArray[i].get(),
-                                                   hdls[i],
+                                                   m_hdls[i],
                                                    pSinkPipeline,
                                                    pBuffer,
                                                    m_pExtBSProcArray.back().get(),
@@ -530,7 +582,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
 #endif
             sts = pThreadPipeline->pPipeline->Init(&m_InputParamsArray[i],
                                                    m_pAllocArray[i].get(),
-                                                   hdls[i],
+                                                   m_hdls[i],
                                                    pParentPipeline,
                                                    pBuffer,
                                                    m_pExtBSProcArray.back().get(),
@@ -557,6 +609,7 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
     }
 
     for (i = 0; i < m_InputParamsArray.size(); i++) {
+        SetInitThreadAffinity(m_InputParamsArray[i].cpuSet);
         sts = m_pThreadContextArray[i]->pPipeline->CompleteInit();
         MSDK_CHECK_STATUS(sts, "m_pThreadContextArray[i]->pPipeline->CompleteInit failed");
 
@@ -566,6 +619,38 @@ mfxStatus Launcher::Init(int argc, msdk_char* argv[]) {
             msdk_printf(MSDK_STRING("Session %d was NOT joined with other sessions\n"), i);
 
         m_pThreadContextArray[i]->pPipeline->SetPipelineID(i);
+
+        // rejected session doesn't hold its frames and files
+        if (m_pAdmission && m_pAdmission->IsRejected(m_InputParamsArray[i].TargetID)) {
+            msdk_printf(MSDK_STRING("Session %d is rejected by admission control\n"), i);
+            m_pThreadContextArray[i]->bRejected = true;
+            ReleaseSession(i);
+        }
+    }
+    SetInitThreadAffinity(m_launcherCpus);
+
+    if (m_pMetrics) {
+        sts = m_pMetrics->Start(m_parser.GetMetricsFileName(),
+                                m_parser.GetMetricsPort(),
+                                m_parser.GetMetricsInterval() ? m_parser.GetMetricsInterval()
+                                                              : CMetricsExporter::DEFAULT_INTERVAL);
+        MSDK_CHECK_STATUS(sts, "m_pMetrics->Start failed");
+    }
+
+    const msdk_char* controlName = m_parser.GetControlFileName();
+    if (controlName) {
+        if (m_pThreadContextArray[0]->pPipeline->GetRobustFlag()) {
+            msdk_printf(MSDK_STRING("Warning: -control is ignored in robust mode\n"));
+        }
+        else if (m_parser.GetCalibrationFileName()) {
+            msdk_printf(MSDK_STRING("Warning: -control is ignored by -calibrate\n"));
+        }
+        else {
+            m_pControl.reset(new CSessionControl);
+            sts = m_pControl->Init(controlName);
+            MSDK_CHECK_STATUS(sts, "m_pControl->Init failed");
+            msdk_printf(MSDK_STRING("Sessions are controlled by commands in %s\n"), controlName);
+        }
     }
 
     msdk_printf(MSDK_STRING("\n"));
@@ -580,108 +665,204 @@ void Launcher::Run() {
     // mark start time
     m_StartTime = GetTick();
 
+    if (m_parser.GetCalibrationFileName()) {
+        DoCalibration();
+    }
     // Robust flag is applied to every seession if enabled in one
-    if (m_pThreadContextArray[0]->pPipeline->GetRobustFlag()) {
+    else if (m_pThreadContextArray[0]->pPipeline->GetRobustFlag()) {
         DoRobustTranscoding();
     }
     else {
         DoTranscoding();
     }
 
+    if (m_pAdmission) {
+        mfxStatus sts = m_pAdmission->Save();
+        MSDK_CHECK_STATUS_NO_RET(sts, "m_pAdmission->Save failed");
+    }
+    if (m_pMetrics)
+        m_pMetrics->Stop();
+
     msdk_printf(MSDK_STRING("\nTranscoding finished\n"));
 
 } // mfxStatus Launcher::Init()
 
-void Launcher::DoTranscoding() {
-    auto RunTranscodeRoutine = [](ThreadTranscodeContext* context) {
-        context->handle = std::async(std::launch::async, [context]() {
-            context->TranscodeRoutine();
-        });
-    };
+bool Launcher::CanUseScheduler() {
+    for (size_t i = 0; i < m_InputParamsArray.size(); ++i) {
+        // sessions sharing surfaces wait for each other inside their steps
+        if (Native != m_InputParamsArray[i].eMode) {
+            msdk_printf(MSDK_STRING("Warning: session %d doesn't both decode and encode, ")
+                            MSDK_STRING("-sched is ignored\n"),
+                        (int)i);
+            return false;
+        }
+        if (m_InputParamsArray[i].priority < MFX_PRIORITY_LOW ||
+            m_InputParamsArray[i].priority > MFX_PRIORITY_HIGH) {
+            msdk_printf(MSDK_STRING("Warning: session %d has unsupported priority, ")
+                            MSDK_STRING("-sched is ignored\n"),
+                        (int)i);
+            return false;
+        }
+    }
+    return true;
+} // bool Launcher::CanUseScheduler()
 
-    bool isOverlayUsed = false;
-    for (const auto& context : m_pThreadContextArray) {
+void Launcher::DoTranscoding() {
+    // sessions report their completion instead of being polled
+    CSessionCompletionQueue completion;
+
+    bool isOverlayUsed                = false;
+    size_t numAliveSessions           = 0;
+    size_t numAliveNonOverlaySessions = 0;
+    for (size_t i = 0; i < m_pThreadContextArray.size(); ++i) {
+        const auto& context = m_pThreadContextArray[i];
         MSDK_CHECK_POINTER_NO_RET(context);
-        RunTranscodeRoutine(context.get());
-
         MSDK_CHECK_POINTER_NO_RET(context->pPipeline);
+
+        context->index       = i;
+        context->pCompletion = &completion;
+        if (context->bRejected)
+            continue;
+
         isOverlayUsed = isOverlayUsed || context->pPipeline->IsOverlayUsed();
+        if (!context->pPipeline->IsOverlayUsed())
+            numAliveNonOverlaySessions++;
+        numAliveSessions++;
     }
 
-    // Transcoding threads waiting cycle
-    bool aliveNonOverlaySessions = true;
-    while (aliveNonOverlaySessions) {
-        aliveNonOverlaySessions = false;
-
-        for (size_t i = 0; i < m_pThreadContextArray.size(); ++i) {
-            if (!m_pThreadContextArray[i]->handle.valid())
-                continue;
-
-            //Payslip interval to check the state of working threads:
-            //such interval is usually a realtime, i.e. for 30 fps this would be 33ms,
-            //66ms typically mean either 1/fps or 2/fps payslip checks.
-            auto waitSts = m_pThreadContextArray[i]->handle.wait_for(std::chrono::milliseconds(66));
-            if (waitSts == std::future_status::ready) {
-                // Invoke get() of the handle just to reset the valid state.
-                // This allows to skip already processed sessions
-                m_pThreadContextArray[i]->handle.get();
-
-                // Session is completed, let's check for its status
-                if (m_pThreadContextArray[i]->transcodingSts < MFX_ERR_NONE) {
-                    // Stop all the sessions if an error happened in one
-                    // But do not stop in robust mode when gpu hang's happened
-                    if (m_pThreadContextArray[i]->transcodingSts != MFX_ERR_GPU_HANG ||
-                        !m_pThreadContextArray[i]->pPipeline->GetRobustFlag()) {
-                        msdk_stringstream ss;
-                        ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
-                           << m_pThreadContextArray[i]->pPipeline->GetSessionText()
-                           << MSDK_STRING("] failed with status ")
-                           << StatusToString(m_pThreadContextArray[i]->transcodingSts)
-                           << MSDK_STRING(" shutting down the application...") << std::endl
-                           << std::endl;
-                        msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
-
-                        for (const auto& context : m_pThreadContextArray) {
-                            context->pPipeline->StopSession();
-                        }
-                    }
-                }
-                else if (m_pThreadContextArray[i]->transcodingSts > MFX_ERR_NONE) {
-                    msdk_stringstream ss;
-                    ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
-                       << m_pThreadContextArray[i]->pPipeline->GetSessionText()
-                       << MSDK_STRING("] returned warning status ")
-                       << StatusToString(m_pThreadContextArray[i]->transcodingSts) << std::endl
-                       << std::endl;
-                    msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
-                }
+    std::unique_ptr<CSessionScheduler> pScheduler;
+    if (m_InputParamsArray[0].bUseScheduler && CanUseScheduler()) {
+        // more threads than sessions would only steal from each other
+        mfxU32 numThreads = m_InputParamsArray[0].nSchedThreads;
+        if (!numThreads)
+            numThreads = std::thread::hardware_concurrency();
+        numThreads = std::min(numThreads, (mfxU32)m_pThreadContextArray.size());
+
+        for (const auto& params : m_InputParamsArray) {
+            if (!params.cpuSet.empty()) {
+                msdk_printf(MSDK_STRING("Warning: scheduler threads are shared by the sessions, ")
+                                MSDK_STRING("only frames are placed by -cpus and -numa\n"));
+                break;
             }
-            else {
-                aliveNonOverlaySessions = aliveNonOverlaySessions ||
-                                          !m_pThreadContextArray[i]->pPipeline->IsOverlayUsed();
+        }
+
+        pScheduler.reset(new CSessionScheduler);
+        mfxStatus sts = pScheduler->Start(numThreads);
+        MSDK_CHECK_STATUS_NO_RET(sts, "pScheduler->Start failed");
+        msdk_printf(MSDK_STRING("Sessions are run by %d scheduler threads\n"),
+                    (int)pScheduler->GetNumThreads());
+    }
+    for (size_t i = 0; i < m_pThreadContextArray.size(); ++i) {
+        if (!m_pThreadContextArray[i]->bRejected)
+            StartSession(i, pScheduler.get());
+    }
+
+    // Transcoding sessions waiting cycle, with the control file it lasts until quit command
+    bool isOverlayStopped = false;
+    while (numAliveSessions || (m_pControl && !m_bQuit)) {
+        if (m_pControl) {
+            size_t numStarted = ProcessControlCommands(pScheduler.get(), &completion);
+            numAliveSessions += numStarted;
+            numAliveNonOverlaySessions += numStarted;
+        }
+
+        size_t i = 0;
+        if (!completion.Pop(i, m_pControl ? CSessionControl::POLL_INTERVAL : MSDK_WAIT_INTERVAL))
+            continue;
+
+        numAliveSessions--;
+        if (!m_pThreadContextArray[i]->pPipeline->IsOverlayUsed())
+            numAliveNonOverlaySessions--;
+
+        // Invoke get() of the handle just to reset the valid state.
+        if (m_pThreadContextArray[i]->handle.valid())
+            m_pThreadContextArray[i]->handle.get();
+
+        // frames which missed their deadlines make the configuration more expensive
+        if (m_pAdmission)
+            m_pAdmission->Complete(m_InputParamsArray[i].TargetID,
+                                   m_pThreadContextArray[i]->numTransFrames,
+                                   m_pThreadContextArray[i]->numDeadlineMisses);
+
+        const auto& pMetrics = m_InputParamsArray[i].pMetrics;
+        if (pMetrics) {
+            pMetrics->bRunning = false;
+            if (m_pThreadContextArray[i]->transcodingSts < MFX_ERR_NONE)
+                pMetrics->numFailures++;
+        }
+
+        // Session is completed, let's check for its status
+        if (m_pThreadContextArray[i]->transcodingSts < MFX_ERR_NONE) {
+            // Stop all the sessions if an error happened in one
+            // But do not stop in robust mode when gpu hang's happened
+            // Sessions under control are independent, only the failed one ends
+            if (m_pControl) {
+                msdk_stringstream ss;
+                ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
+                   << m_pThreadContextArray[i]->pPipeline->GetSessionText()
+                   << MSDK_STRING("] failed with status ")
+                   << StatusToString(m_pThreadContextArray[i]->transcodingSts) << std::endl
+                   << std::endl;
+                msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
             }
+            else if (m_pThreadContextArray[i]->transcodingSts != MFX_ERR_GPU_HANG ||
+                     !m_pThreadContextArray[i]->pPipeline->GetRobustFlag()) {
+                msdk_stringstream ss;
+                ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
+                   << m_pThreadContextArray[i]->pPipeline->GetSessionText()
+                   << MSDK_STRING("] failed with status ")
+                   << StatusToString(m_pThreadContextArray[i]->transcodingSts)
+                   << MSDK_STRING(" shutting down the application...") << std::endl
+                   << std::endl;
+                msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+
+                for (const auto& context : m_pThreadContextArray) {
+                    context->pPipeline->StopSession();
+                }
+            }
+        }
+        else if (m_pThreadContextArray[i]->transcodingSts > MFX_ERR_NONE) {
+            msdk_stringstream ss;
+            ss << MSDK_STRING("\n\n session ") << i << MSDK_STRING(" [")
+               << m_pThreadContextArray[i]->pPipeline->GetSessionText()
+               << MSDK_STRING("] returned warning status ")
+               << StatusToString(m_pThreadContextArray[i]->transcodingSts) << std::endl
+               << std::endl;
+            msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
         }
 
         // Stop overlay sessions
         // Note: Overlay sessions never stop themselves so they should be forcibly stopped
         // after stopping of all non-overlay sessions
-        if (!aliveNonOverlaySessions && isOverlayUsed) {
-            // Sending stop message
+        if (!numAliveNonOverlaySessions && isOverlayUsed && !isOverlayStopped) {
             for (const auto& context : m_pThreadContextArray) {
                 if (context->pPipeline->IsOverlayUsed()) {
                     context->pPipeline->StopSession();
                 }
             }
+            isOverlayStopped = true;
+        }
 
-            // Waiting for them to be stopped
-            for (const auto& context : m_pThreadContextArray) {
-                if (!context->handle.valid())
-                    continue;
+        if (m_pControl) {
+            ReleaseSession(i);
 
-                context->handle.wait();
+            auto restart = m_restarts.find(i);
+            if (restart != m_restarts.end()) {
+                msdk_string line = restart->second;
+                m_restarts.erase(restart);
+                if (MFX_ERR_NONE == AddSession(line, pScheduler.get(), &completion)) {
+                    numAliveSessions++;
+                    numAliveNonOverlaySessions++;
+                }
             }
         }
     }
+
+    for (const auto& context : m_pThreadContextArray) {
+        context->pCompletion = nullptr;
+    }
+    if (pScheduler)
+        pScheduler->Stop();
 }
 
 void Launcher::DoRobustTranscoding() {
@@ -717,6 +898,237 @@ void Launcher::DoRobustTranscoding() {
     }
 }
 
+void Launcher::DoCalibration() {
+    const msdk_char* profileName = m_parser.GetCalibrationFileName();
+
+    CCapacityModel model;
+    mfxStatus sts = model.Load(profileName);
+    MSDK_CHECK_STATUS_NO_RET(sts, "model.Load failed");
+
+    // each session has the device to itself
+    for (size_t i = 0; i < m_pThreadContextArray.size(); ++i) {
+        ThreadTranscodeContext& context = *m_pThreadContextArray[i];
+        context.index                   = i;
+        StartSession(i, NULL);
+        context.handle.get();
+        if (m_InputParamsArray[i].pMetrics)
+            m_InputParamsArray[i].pMetrics->bRunning = false;
+
+        const SessionCostKey& key = context.pPipeline->GetCostKey();
+        if (context.transcodingSts < MFX_ERR_NONE || !context.numTransFrames ||
+            context.working_time <= 0 || !key.encodeId) {
+            msdk_printf(MSDK_STRING("Warning: session %d isn't calibrated\n"), (int)i);
+            continue;
+        }
+
+        mfxF64 fps = context.numTransFrames / context.working_time;
+        model.Calibrate(key, fps);
+        msdk_printf(MSDK_STRING("Session %d: %s to %s %ux%u, target usage %u - %.3f fps\n"),
+                    (int)i,
+                    CodecIdToStr(key.decodeId).c_str(),
+                    CodecIdToStr(key.encodeId).c_str(),
+                    key.width,
+                    key.height,
+                    key.targetUsage,
+                    fps);
+    }
+
+    sts = model.Save(profileName);
+    MSDK_CHECK_STATUS_NO_RET(sts, "model.Save failed");
+} // void Launcher::DoCalibration()
+
+void Launcher::StartSession(size_t index, CSessionScheduler* pScheduler) {
+    ThreadTranscodeContext* context = m_pThreadContextArray[index].get();
+    if (m_InputParamsArray[index].pMetrics)
+        m_InputParamsArray[index].pMetrics->bRunning = true;
+    if (pScheduler) {
+        mfxStatus sts = pScheduler->Submit(context, m_InputParamsArray[index].priority);
+        if (MFX_ERR_NONE != sts)
+            context->OnComplete(sts);
+        return;
+    }
+
+    context->handle = std::async(std::launch::async, [context]() {
+        context->TranscodeRoutine();
+    });
+} // void Launcher::StartSession(size_t index, CSessionScheduler* pScheduler)
+
+mfxStatus Launcher::AddSession(const msdk_string& line,
+                               CSessionScheduler* pScheduler,
+                               CSessionCompletionQueue* pCompletion) {
+    size_t i = m_pThreadContextArray.size();
+
+    sInputParams params;
+    mfxStatus sts = m_parser.ParseSessionLine(line, params);
+    MSDK_CHECK_STATUS(sts, "m_parser.ParseSessionLine failed");
+
+    // sessions sharing surfaces or a runtime session are set up together at start
+    if (Native != params.eMode || Native != params.eModeExt || params.bIsJoin) {
+        msdk_printf(MSDK_STRING("error: added session has to decode and encode on its own\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+    if (pScheduler &&
+        (params.priority < MFX_PRIORITY_LOW || params.priority > MFX_PRIORITY_HIGH)) {
+        msdk_printf(MSDK_STRING("error: priority of the added session isn't supported\n"));
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    params.TargetID       = DecoderTargetID + (mfxU32)i;
+    params.pBitstreamPool = m_InputParamsArray[0].pBitstreamPool;
+    params.pAdmission     = m_pAdmission;
+    if (m_pMetrics)
+        params.pMetrics.reset(new CSessionMetrics);
+    m_InputParamsArray.push_back(params);
+
+    msdk_printf(MSDK_STRING("Session %d:\n"), (int)i);
+    sts = CreateSession(i);
+    SetInitThreadAffinity(m_launcherCpus);
+    if (MFX_ERR_NONE != sts) {
+        m_InputParamsArray.pop_back();
+        MSDK_CHECK_STATUS(sts, "CreateSession failed");
+    }
+
+    m_parser.SetLine((mfxU32)i, line);
+    if (m_pMetrics)
+        m_pMetrics->AddSession((mfxU32)i, params.pMetrics);
+    m_pThreadContextArray[i]->index       = i;
+    m_pThreadContextArray[i]->pCompletion = pCompletion;
+    if (m_pAdmission && m_pAdmission->IsRejected(params.TargetID)) {
+        msdk_printf(MSDK_STRING("Session %d is rejected by admission control\n"), (int)i);
+        m_pThreadContextArray[i]->bRejected = true;
+        ReleaseSession(i);
+        return MFX_WRN_DEVICE_BUSY;
+    }
+    StartSession(i, pScheduler);
+
+    msdk_printf(MSDK_STRING("Session %d is started\n"), (int)i);
+    return MFX_ERR_NONE;
+} // mfxStatus Launcher::AddSession()
+
+mfxStatus Launcher::CreateSession(size_t index) {
+    sInputParams& params = m_InputParamsArray[index];
+
+    mfxStatus sts = PlaceSession(params, index);
+    MSDK_CHECK_STATUS(sts, "PlaceSession failed");
+    SetInitThreadAffinity(params.cpuSet);
+
+    // device of the first session is shared, system memory options are set per session
+    std::shared_ptr<mfxAllocatorParams> pAllocParams =
+        m_hwdevs.empty() ? CreateSysMemAllocatorParams(params) : m_pAllocParams[0];
+    mfxHDL hdl = m_hwdevs.empty() ? NULL : m_hdls[0];
+
+    std::unique_ptr<GeneralAllocator> pAllocator(new GeneralAllocator);
+    sts = pAllocator->Init(pAllocParams.get());
+    MSDK_CHECK_STATUS(sts, "pAllocator->Init failed");
+
+    std::unique_ptr<FileBitstreamProcessor> pBSProcessor;
+    sts = CreateBitstreamProcessor(params, pBSProcessor);
+    MSDK_CHECK_STATUS(sts, "CreateBitstreamProcessor failed");
+
+    std::unique_ptr<ThreadTranscodeContext> pThreadPipeline(new ThreadTranscodeContext);
+    pThreadPipeline->pPipeline.reset(CreatePipeline());
+    pThreadPipeline->pBSProcessor = pBSProcessor.get();
+    pThreadPipeline->cpuSet       = params.cpuSet;
+
+#if (defined(_WIN32) || defined(_WIN64)) && (MFX_VERSION >= 1031)
+    pThreadPipeline->pPipeline->SetPrefferiGfx(params.bPrefferiGfx);
+    pThreadPipeline->pPipeline->SetPrefferdGfx(params.dGfxIdx);
+    // force implementation type based on iGfx/dGfx parameters
+    if (params.libType != MFX_IMPL_SOFTWARE) {
+        ForceImplForSession((mfxU32)index);
+        m_pLoader->SetDeviceAndAdapter(m_deviceID, m_adapterNum);
+        sts = m_pLoader->EnumImplementations();
+        MSDK_CHECK_STATUS(sts, "EnumImplementations(m_deviceID, m_adapterNum) failed");
+    }
+#endif
+
+    params.pVppCompDstRects = NULL;
+
+    sts = pThreadPipeline->pPipeline->Init(&params,
+                                           pAllocator.get(),
+                                           hdl,
+                                           NULL,
+                                           NULL,
+                                           pBSProcessor.get(),
+                                           m_pLoader.get(),
+                                           CreateCascadeScalerConfig());
+    MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->Init failed");
+
+    sts = pThreadPipeline->pPipeline->CompleteInit();
+    MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->CompleteInit failed");
+    pThreadPipeline->pPipeline->SetPipelineID((mfxU32)index);
+
+    // set the session's start status (like it is waiting)
+    pThreadPipeline->startStatus = MFX_WRN_DEVICE_BUSY;
+    pThreadPipeline->implType    = params.libType;
+
+    mfxVersion ver = { { 0, 0 } };
+    sts            = pThreadPipeline->pPipeline->QueryMFXVersion(&ver);
+    MSDK_CHECK_STATUS(sts, "pThreadPipeline->pPipeline->QueryMFXVersion failed");
+    PrintInfo((mfxU32)index, &params, &ver);
+
+    m_pAllocParams.push_back(pAllocParams);
+    m_hdls.push_back(hdl);
+    m_pAllocArray.push_back(std::move(pAllocator));
+    m_pExtBSProcArray.push_back(std::move(pBSProcessor));
+    m_pThreadContextArray.push_back(std::move(pThreadPipeline));
+
+    return MFX_ERR_NONE;
+} // mfxStatus Launcher::CreateSession(size_t index)
+
+size_t Launcher::ProcessControlCommands(CSessionScheduler* pScheduler,
+                                        CSessionCompletionQueue* pCompletion) {
+    std::deque<SessionCommand> commands;
+    mfxStatus sts = m_pControl->Read(commands);
+    MSDK_CHECK_STATUS_NO_RET(sts, "m_pControl->Read failed");
+
+    size_t numStarted = 0;
+    for (const SessionCommand& command : commands) {
+        if (m_bQuit)
+            break;
+
+        if (SessionCommand::ADD == command.type) {
+            if (MFX_ERR_NONE == AddSession(command.line, pScheduler, pCompletion))
+                numStarted++;
+        }
+        else if (SessionCommand::QUIT == command.type) {
+            m_bQuit = true;
+            m_restarts.clear();
+            for (const auto& context : m_pThreadContextArray) {
+                if (!context->bReleased)
+                    context->pPipeline->StopSession();
+            }
+        }
+        else if (command.session >= m_pThreadContextArray.size() ||
+                 m_pThreadContextArray[command.session]->bReleased) {
+            msdk_printf(MSDK_STRING("Warning: session %u isn't running, command is skipped\n"),
+                        command.session);
+        }
+        else {
+            // session is started again once it's finished
+            if (SessionCommand::RESTART == command.type)
+                m_restarts[command.session] =
+                    command.line.empty() ? m_parser.GetLine(command.session) : command.line;
+            m_pThreadContextArray[command.session]->pPipeline->StopSession();
+        }
+    }
+    return numStarted;
+} // size_t Launcher::ProcessControlCommands()
+
+void Launcher::ReleaseSession(size_t index) {
+    ThreadTranscodeContext& context = *m_pThreadContextArray[index];
+    const sInputParams& params      = m_InputParamsArray[index];
+    // joined sessions and the ones sharing surfaces are freed together at exit
+    if (context.bReleased || Native != params.eMode || params.bIsJoin)
+        return;
+
+    // frames are freed by the pipeline, files are closed by the processor
+    context.pPipeline->Close();
+    context.pBSProcessor = nullptr;
+    m_pExtBSProcArray[index].reset();
+    context.bReleased = true;
+} // void Launcher::ReleaseSession(size_t index)
+
 mfxStatus Launcher::ProcessResult() {
     FILE* pPerfFile = m_parser.GetPerformanceFile();
 
@@ -737,6 +1149,21 @@ mfxStatus Launcher::ProcessResult() {
         "-------------------------------------------------------------------------------\n"));
 
     for (mfxU32 i = 0; i < m_pThreadContextArray.size(); i++) {
+        // the session wasn't run, it isn't a failure
+        if (m_pThreadContextArray[i]->bRejected) {
+            msdk_stringstream ss;
+            ss << MSDK_STRING("*** session ") << i << MSDK_STRING(" REJECTED by admission control")
+               << std::endl
+               << m_parser.GetLine(i) << std::endl
+               << std::endl;
+
+            msdk_printf(MSDK_STRING("%s"), ss.str().c_str());
+            if (pPerfFile) {
+                msdk_fprintf(pPerfFile, MSDK_STRING("%s"), ss.str().c_str());
+            }
+            continue;
+        }
+
         mfxStatus transcodingSts = m_pThreadContextArray[i]->transcodingSts;
         mfxF64 workTime          = m_pThreadContextArray[i]->working_time;
         mfxU32 framesNum         = m_pThreadContextArray[i]->numTransFrames;
@@ -898,6 +1325,66 @@ mfxStatus Launcher::CheckAndFixAdapterDependency(mfxU32 idxSession,
 }
 #endif //(_WIN32 || _WIN64) && (MFX_VERSION >= 1031)
 
+mfxStatus Launcher::PlaceSessions() {
+    mfxStatus sts = msdk_thread_get_affinity(m_launcherCpus);
+    if (MFX_ERR_NONE != sts)
+        m_launcherCpus.clear();
+
+    mfxI32 sinkNode = NUMA_NODE_NOT_SET;
+    for (size_t i = 0; i < m_InputParamsArray.size(); i++) {
+        sInputParams& params = m_InputParamsArray[i];
+
+        // session taking surfaces of the decoding session stays on its node
+        if (NUMA_NODE_AUTO == params.nNumaNode && Source == params.eMode && sinkNode >= 0)
+            params.nNumaNode = sinkNode;
+
+        sts = PlaceSession(params, i);
+        MSDK_CHECK_STATUS(sts, "PlaceSession failed");
+
+        if (Sink == params.eMode)
+            sinkNode = params.nNumaNode;
+    }
+
+    return MFX_ERR_NONE;
+} // mfxStatus Launcher::PlaceSessions()
+
+mfxStatus Launcher::PlaceSession(sInputParams& params, size_t index) {
+    mfxU32 numNodes = msdk_get_numa_node_count();
+    if (NUMA_NODE_AUTO == params.nNumaNode)
+        params.nNumaNode = (mfxI32)(m_nextNumaNode++ % numNodes);
+
+    if (params.nNumaNode < 0)
+        return MFX_ERR_NONE;
+
+    if ((mfxU32)params.nNumaNode >= numNodes) {
+        msdk_printf(MSDK_STRING("error: NUMA node %d of session %d doesn't exist\n"),
+                    params.nNumaNode,
+                    (int)index);
+        return MFX_ERR_UNSUPPORTED;
+    }
+
+    if (params.cpuSet.empty()) {
+        mfxStatus sts = msdk_get_numa_node_cpus((mfxU32)params.nNumaNode, params.cpuSet);
+        // node of memory only
+        if (MFX_ERR_NONE != sts)
+            msdk_printf(MSDK_STRING("Warning: NUMA node %d has no processors, threads of ")
+                            MSDK_STRING("session %d aren't placed\n"),
+                        params.nNumaNode,
+                        (int)index);
+    }
+    msdk_printf(MSDK_STRING("Session %d is placed on NUMA node %d\n"),
+                (int)index,
+                params.nNumaNode);
+
+    return MFX_ERR_NONE;
+} // mfxStatus Launcher::PlaceSession(sInputParams& params, size_t index)
+
+void Launcher::SetInitThreadAffinity(const std::vector<mfxU32>& cpus) {
+    const std::vector<mfxU32>& target = cpus.empty() ? m_launcherCpus : cpus;
+    if (!target.empty() && MFX_ERR_NONE != msdk_thread_set_affinity(target))
+        msdk_printf(MSDK_STRING("Warning: failed to set processors of the launcher thread\n"));
+} // void Launcher::SetInitThreadAffinity()
+
 mfxStatus Launcher::VerifyCrossSessionsOptions() {
     bool IsSinkPresence       = false;
     bool IsSourcePresence     = false;
@@ -1157,6 +1644,67 @@ mfxStatus Launcher::CreateSafetyBuffers() {
 
 } // mfxStatus Launcher::CreateSafetyBuffers
 
+mfxStatus Launcher::CreateBitstreamProcessor(const sInputParams& params,
+                                             std::unique_ptr<FileBitstreamProcessor>& pProcessor) {
+    mfxStatus sts = MFX_ERR_NONE;
+    pProcessor.reset(new FileBitstreamProcessor);
+
+    std::unique_ptr<CSmplBitstreamReader> reader;
+    std::unique_ptr<CSmplYUVReader> yuvreader;
+    if (params.DecodeId == MFX_CODEC_VP9 || params.DecodeId == MFX_CODEC_VP8 ||
+        params.DecodeId == MFX_CODEC_AV1) {
+        reader.reset(new CIVFFrameReader());
+    }
+    else if (params.DecodeId == MFX_CODEC_RGB4 || params.DecodeId == MFX_CODEC_I420 ||
+             params.DecodeId == MFX_CODEC_NV12) {
+        // YUV reader for RGB4 overlay and raw input
+        yuvreader.reset(new CSmplYUVReader());
+    }
+    else {
+        reader.reset(new CSmplBitstreamReader());
+    }
+
+    if (reader.get()) {
+        sts = reader->Init(params.strSrcFile);
+        MSDK_CHECK_STATUS(sts, "reader->Init failed");
+
+        if (params.bFrameRange) {
+            sts = reader->InitIndex(params.DecodeId, params.bPersistIndex);
+            MSDK_CHECK_STATUS(sts, "reader->InitIndex failed");
+
+            // Sessions reading ranges of the same file index it once
+            std::shared_ptr<const CStreamIndex>& pIndex = m_streamIndexes[params.strSrcFile];
+            if (pIndex)
+                reader->SetIndex(pIndex);
+            else
+                pIndex = reader->GetIndex();
+
+            sts = reader->SetFrameRange(params.nRangeFirst, params.nRangeCount);
+            MSDK_CHECK_STATUS(sts, "reader->SetFrameRange failed");
+        }
+        sts = pProcessor->SetReader(reader);
+        MSDK_CHECK_STATUS(sts, "pProcessor->SetReader failed");
+    }
+    else if (yuvreader.get()) {
+        std::list<msdk_string> input;
+        input.push_back(params.strSrcFile);
+        sts = yuvreader->Init(input, params.DecodeId);
+        MSDK_CHECK_STATUS(sts, "m_YUVReader->Init failed");
+        yuvreader->SetReadBatch(params.nReadBatch);
+        sts = pProcessor->SetReader(yuvreader);
+        MSDK_CHECK_STATUS(sts, "pProcessor->SetReader failed");
+    }
+
+    std::unique_ptr<CSmplBitstreamWriter> writer(new CSmplBitstreamWriter());
+    writer->SetAsyncWrite(params.bAsyncWrite, params.bDirectIO);
+    sts = writer->Init(params.strDstFile);
+
+    sts = pProcessor->SetWriter(writer);
+    MSDK_CHECK_STATUS(sts, "pProcessor->SetWriter failed");
+
+    return MFX_ERR_NONE;
+} // mfxStatus Launcher::CreateBitstreamProcessor()
+
 CascadeScalerConfig::TargetDescriptor CascadeScalerConfig::GetDesc(mfxU32 id) {
     auto itr = std::find_if(Targets.begin(), Targets.end(), [id](TargetDescriptor& d) {
         return d.TargetID == id;
@@ -1300,17 +1848,36 @@ void TranscodingSample::CascadeScalerConfig::CreatePoolList() {
     }
 }
 
-SMTTracer::SMTTracer() : Log(), AddonLog(), TracerFileMutex() {
+SMTTracer::SMTTracer()
+        : TracerID(0),
+          TimeBase(),
+          Logs(),
+          LogsMutex(),
+          DroppedEvents(0),
+          FlushThread(),
+          StopFlush(false),
+          FlushWakeup(),
+          Batch(),
+          LastEnds(),
+          TraceFile() {
+    static std::atomic<mfxU64> NextTracerID(1);
+    TracerID = NextTracerID.fetch_add(1);
     TimeBase = std::chrono::steady_clock::now();
 }
 
 SMTTracer::~SMTTracer() {
-    //this function is intentionally called from destructor to try to save traces in case of a crush
     if (!Enabled)
         return;
 
-    AddFlowEvents();
-    SaveTrace(0xffffff & GetCurrentTS());
+    StopFlush.store(true);
+    FlushWakeup.Notify();
+    if (FlushThread.joinable())
+        FlushThread.join();
+
+    printf("\n### trace: %llu events saved to %d files, %llu dropped\n",
+           (unsigned long long)SavedEvents,
+           (int)(FileIndex + 1),
+           (unsigned long long)DroppedEvents.load());
 }
 
 void SMTTracer::Init() {
@@ -1318,7 +1885,9 @@ void SMTTracer::Init() {
         return;
     }
     Enabled = true;
-    Log.reserve(TraceBufferSizeInMBytes * 1024 * 1024 / sizeof(Event));
+    FileID  = 0xffffff & (mfxU32)std::chrono::system_clock::now().time_since_epoch().count();
+    OpenNextTraceFile();
+    FlushThread = std::thread(&SMTTracer::FlushRoutine, this);
 }
 
 void SMTTracer::BeginEvent(const ThreadType thType,
@@ -1344,33 +1913,16 @@ void SMTTracer::EndEvent(const ThreadType thType,
 void SMTTracer::AddCounterEvent(const ThreadType thType,
                                 const mfxU32 thID,
                                 const EventName name,
-                                const mfxU64 counter) {
+                                const mfxU64 counter,
+                                const mfxU64 total) {
     if (!Enabled)
         return;
-    AddEvent(EventType::Counter, thType, thID, name, reinterpret_cast<void*>(counter), nullptr);
-}
-
-void SMTTracer::SaveTrace(mfxU32 FileID) {
-    string FileName = "smt_trace_" + to_string(FileID) + ".json";
-    std::ofstream TraceFile(FileName, std::ios::out);
-    if (!TraceFile) {
-        return;
-    }
-
-    printf("\n### trace buffer usage [%d/%d] %.2f%%\n",
-           (int)Log.size(),
-           (int)Log.capacity(),
-           100. * Log.size() / Log.capacity());
-    printf("trace file name %s\n", FileName.c_str());
-
-    TraceFile << "[" << endl;
-
-    for (const Event ev : Log) {
-        WriteEvent(ev, TraceFile);
-    }
-    for (const Event ev : AddonLog) {
-        WriteEvent(ev, TraceFile);
-    }
+    AddEvent(EventType::Counter,
+             thType,
+             thID,
+             name,
+             reinterpret_cast<void*>(counter),
+             reinterpret_cast<void*>(total));
 }
 
 void SMTTracer::AddEvent(const EventType evType,
@@ -1384,17 +1936,13 @@ void SMTTracer::AddEvent(const EventType evType,
     ev.ThType = thType;
     ev.ThID   = thID;
     ev.Name   = name;
+    ev.EvID   = 0;
     ev.InID   = reinterpret_cast<mfxU64>(inID);
     ev.OutID  = reinterpret_cast<mfxU64>(outID);
     ev.TS     = GetCurrentTS();
 
-    if (Log.size() == Log.capacity()) {
-        printf("### Logging stopped\n");
-        return;
-    }
-
-    std::lock_guard<std::mutex> guard(TracerFileMutex);
-    Log.push_back(ev);
+    if (!GetThreadLog().Ring.Push(ev))
+        DroppedEvents.fetch_add(1, std::memory_order_relaxed);
 }
 
 mfxU64 SMTTracer::GetCurrentTS() {
@@ -1402,27 +1950,114 @@ mfxU64 SMTTracer::GetCurrentTS() {
     return static_cast<mfxU64>(std::chrono::duration<double, std::micro>(time - TimeBase).count());
 }
 
-void SMTTracer::AddFlowEvents() {
-    for (auto it = Log.begin(); it != Log.end(); ++it) {
-        if (it->EvType != EventType::DurationStart) {
-            continue;
+SMTTracer::ThreadLog& SMTTracer::GetThreadLog() {
+    // log of the thread is retired when the thread exits
+    struct ThreadLogRef {
+        ~ThreadLogRef() {
+            if (log)
+                log->Retired.store(true);
         }
+        mfxU64 tracerID = 0;
+        std::shared_ptr<ThreadLog> log;
+    };
+    thread_local ThreadLogRef ref;
 
-        if (it->InID == 0) {
-            continue;
-        }
+    if (ref.tracerID != TracerID) {
+        if (ref.log)
+            ref.log->Retired.store(true);
+        ref.log.reset(new ThreadLog(ThreadLogEvents));
+        ref.tracerID = TracerID;
 
-        auto itc = std::reverse_iterator<decltype(it)>(it);
+        std::lock_guard<std::mutex> guard(LogsMutex);
+        Logs.push_back(ref.log);
+    }
+    return *ref.log;
+}
 
-        auto itp = find_if(itc, Log.rend(), [&it](Event ev) {
-            return ev.EvType == EventType::DurationEnd && it->InID == ev.OutID;
-        });
-        if (itp == Log.rend()) {
-            continue;
+void SMTTracer::FlushRoutine() {
+    while (!StopFlush.load()) {
+        FlushWakeup.WaitFor(
+            [this] {
+                return StopFlush.load();
+            },
+            FlushIntervalMs);
+        Flush();
+    }
+    // events added by the threads before they were stopped
+    Flush();
+    TraceFile.close();
+}
+
+void SMTTracer::Flush() {
+    std::vector<std::shared_ptr<ThreadLog>> logs;
+    std::vector<bool> retired;
+    {
+        std::lock_guard<std::mutex> guard(LogsMutex);
+        logs = Logs;
+    }
+    // retired thread adds nothing after its log is drained
+    for (auto& log : logs)
+        retired.push_back(log->Retired.load());
+
+    Batch.clear();
+    for (auto& log : logs) {
+        Event ev;
+        while (log->Ring.Front(ev)) {
+            Batch.push_back(ev);
+            log->Ring.Release([](const Event&) {
+                return true;
+            });
         }
+    }
+
+    // flows link the end of an event with the start of the one taking its output, so
+    // events of all threads are saved in the order of time
+    std::stable_sort(Batch.begin(), Batch.end(), [](const Event& a, const Event& b) {
+        return a.TS < b.TS;
+    });
+    for (const Event& ev : Batch) {
+        if (ev.EvType == EventType::DurationStart && ev.InID) {
+            auto it = LastEnds.find(ev.InID);
+            if (it != LastEnds.end())
+                AddFlowEvent(it->second, ev);
+        }
+        else if (ev.EvType == EventType::DurationEnd && ev.OutID) {
+            LastEnds[ev.OutID] = ev;
+        }
+        SaveEvent(ev);
+    }
+    TraceFile.flush();
+
+    std::lock_guard<std::mutex> guard(LogsMutex);
+    for (size_t i = 0; i < logs.size(); i++) {
+        if (retired[i])
+            Logs.erase(std::find(Logs.begin(), Logs.end(), logs[i]));
+    }
+}
 
-        AddFlowEvent(*itp, *it);
+void SMTTracer::SaveEvent(const Event& ev) {
+    if (FileEvents >= MaxFileEvents) {
+        FileIndex++;
+        OpenNextTraceFile();
+    }
+    WriteEvent(ev, TraceFile);
+    FileEvents++;
+    SavedEvents++;
+}
+
+void SMTTracer::OpenNextTraceFile() {
+    string FileName = "smt_trace_" + to_string(FileID) + "_" + to_string(FileIndex) + ".json";
+    TraceFile.close();
+    TraceFile.clear();
+    TraceFile.open(FileName, std::ios::out);
+    FileEvents = 0;
+    if (!TraceFile) {
+        printf("### failed to open trace file %s\n", FileName.c_str());
+        return;
     }
+
+    printf("trace file name %s\n", FileName.c_str());
+    TraceFile << "[" << endl;
 }
 
 void SMTTracer::AddFlowEvent(const Event a, const Event b) {
@@ -1436,14 +2071,14 @@ void SMTTracer::AddFlowEvent(const Event a, const Event b) {
     ev.ThID   = a.ThID;
     ev.EvID   = ++EvID;
     ev.TS     = a.TS;
-    AddonLog.push_back(ev);
+    SaveEvent(ev);
 
     ev.EvType = EventType::FlowEnd;
     ev.ThType = b.ThType;
     ev.ThID   = b.ThID;
     ev.EvID   = EvID;
     ev.TS     = b.TS;
-    AddonLog.push_back(ev);
+    SaveEvent(ev);
 }
 
 void SMTTracer::WriteEvent(const Event ev, std::ofstream& TraceFile) {
@@ -1576,6 +2211,9 @@ void SMTTracer::WriteEventName(const Event ev, std::ofstream& TraceFile) {
     if (ev.EvType == EventType::FlowStart || ev.EvType == EventType::FlowEnd) {
         TraceFile << "link";
     }
+    else if (ev.EvType == EventType::Counter && ev.Name == EventName::QUEUE) {
+        TraceFile << "queue" << ev.ThID;
+    }
     else if (ev.EvType == EventType::Counter) {
         switch (ev.ThType) {
             case ThreadType::DEC:
@@ -1642,7 +2280,14 @@ void SMTTracer::WriteEventInOutIDs(const Event ev, std::ofstream& TraceFile) {
 }
 
 void SMTTracer::WriteEventCounter(const Event ev, std::ofstream& TraceFile) {
-    TraceFile << "\"args\":{\"free surfaces\":" << ev.InID << "}";
+    if (ev.Name == EventName::QUEUE) {
+        TraceFile << "\"args\":{\"depth\":" << ev.InID << "}";
+        return;
+    }
+    TraceFile << "\"args\":{\"free surfaces\":" << ev.InID;
+    if (ev.Name == EventName::SURF_POOL && ev.OutID >= ev.InID)
+        TraceFile << ",\"used surfaces\":" << ev.OutID - ev.InID;
+    TraceFile << "}";
 }
 
 void SMTTracer::WriteEventCategory(std::ofstream& TraceFile) {
@@ -1658,6 +2303,9 @@ void SMTTracer::WriteComma(std::ofstream& TraceFile) {
 } // mfxStatus Launcher::CreateSafetyBuffers
 
 void Launcher::Close() {
+    // exporter reads the queues of surfaces
+    m_pMetrics.reset();
+
     while (m_pThreadContextArray.size()) {
         m_pThreadContextArray[m_pThreadContextArray.size() - 1].reset();
         m_pThreadContextArray.pop_back();
@@ -1667,6 +2315,7 @@ void Launcher::Close() {
     m_pBufferArray.clear();
     m_pExtBSProcArray.clear();
     m_pAllocParams.clear();
+    m_hdls.clear();
     m_hwdevs.clear();
 
 } // void Launcher::Close()
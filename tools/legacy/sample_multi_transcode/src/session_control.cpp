@@ -0,0 +1,124 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "session_control.h"
+
+namespace TranscodingSample {
+
+namespace {
+const msdk_char* const WHITESPACE = MSDK_STRING(" \t\r\n");
+
+msdk_string Trim(const msdk_string& str) {
+    size_t first = str.find_first_not_of(WHITESPACE);
+    if (msdk_string::npos == first)
+        return msdk_string();
+    size_t last = str.find_last_not_of(WHITESPACE);
+    return str.substr(first, last - first + 1);
+}
+} // namespace
+
+CSessionControl::CSessionControl() : m_fileName(), m_offset(0) {}
+
+mfxStatus CSessionControl::Init(const msdk_char* fileName) {
+    MSDK_CHECK_POINTER(fileName, MFX_ERR_NULL_PTR);
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, fileName, MSDK_STRING("a"));
+    if (!file) {
+        msdk_printf(MSDK_STRING("error: control file \"%s\" can't be opened\n"), fileName);
+        return MFX_ERR_UNSUPPORTED;
+    }
+    m_offset = MSDK_FSEEK64(file, 0, SEEK_END) ? 0 : MSDK_FTELL64(file);
+    fclose(file);
+
+    m_fileName = fileName;
+    return MFX_ERR_NONE;
+} // mfxStatus CSessionControl::Init(const msdk_char* fileName)
+
+mfxStatus CSessionControl::Read(std::deque<SessionCommand>& commands) {
+    if (m_fileName.empty())
+        return MFX_ERR_NOT_INITIALIZED;
+
+    FILE* file = NULL;
+    MSDK_FOPEN(file, m_fileName.c_str(), MSDK_STRING("r"));
+    // file may be being replaced
+    if (!file)
+        return MFX_ERR_NONE;
+
+    // file was truncated or created anew, it's read from the beginning
+    if (!MSDK_FSEEK64(file, 0, SEEK_END) && MSDK_FTELL64(file) < m_offset)
+        m_offset = 0;
+
+    if (MSDK_FSEEK64(file, m_offset, SEEK_SET)) {
+        fclose(file);
+        return MFX_ERR_UNKNOWN;
+    }
+
+    msdk_char buffer[1024];
+    msdk_string line;
+    while (msdk_fgets(buffer, MSDK_ARRAY_LEN(buffer), file)) {
+        line += buffer;
+        // the end of the line isn't written yet or doesn't fit the buffer
+        if (line.empty() || line[line.size() - 1] != '\n')
+            continue;
+
+        m_offset = MSDK_FTELL64(file);
+        SessionCommand command;
+        if (ParseCommand(Trim(line), command))
+            commands.push_back(command);
+        line.clear();
+    }
+
+    fclose(file);
+    return MFX_ERR_NONE;
+} // mfxStatus CSessionControl::Read(std::deque<SessionCommand>& commands)
+
+bool CSessionControl::ParseCommand(const msdk_string& line, SessionCommand& command) {
+    // empty lines and comments
+    if (line.empty() || line[0] == '#')
+        return false;
+
+    msdk_stringstream ss(line);
+    msdk_string name;
+    ss >> name;
+
+    if (name == MSDK_STRING("add"))
+        command.type = SessionCommand::ADD;
+    else if (name == MSDK_STRING("stop"))
+        command.type = SessionCommand::STOP;
+    else if (name == MSDK_STRING("restart"))
+        command.type = SessionCommand::RESTART;
+    else if (name == MSDK_STRING("quit"))
+        command.type = SessionCommand::QUIT;
+    else {
+        msdk_printf(MSDK_STRING("Warning: unknown control command \"%s\" is skipped\n"),
+                    line.c_str());
+        return false;
+    }
+
+    if (SessionCommand::STOP == command.type || SessionCommand::RESTART == command.type) {
+        if (!(ss >> command.session)) {
+            msdk_printf(MSDK_STRING("Warning: control command \"%s\" has no session index\n"),
+                        line.c_str());
+            return false;
+        }
+    }
+
+    msdk_string rest;
+    std::getline(ss, rest);
+    command.line = Trim(rest);
+
+    if (SessionCommand::ADD == command.type && command.line.empty()) {
+        msdk_printf(MSDK_STRING("Warning: control command \"%s\" has no session options\n"),
+                    line.c_str());
+        return false;
+    }
+    return true;
+} // bool CSessionControl::ParseCommand(const msdk_string& line, SessionCommand& command)
+
+} // namespace TranscodingSample
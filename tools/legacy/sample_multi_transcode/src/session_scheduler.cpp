@@ -0,0 +1,193 @@
+/*############################################################################
+  # Copyright (C) Intel Corporation
+  #
+  # SPDX-License-Identifier: MIT
+  ############################################################################*/
+
+#include "mfx_samples_config.h"
+
+#include "session_scheduler.h"
+
+#include <chrono>
+
+namespace TranscodingSample {
+
+namespace {
+// Steps a job makes in a turn: low, normal and high priority
+const mfxU32 STEP_QUANTUM[CSessionScheduler::NUM_PRIORITIES] = { 1, 2, 4 };
+// Time a step may wait for the device when all jobs of the thread are waiting (ms)
+const mfxU32 DEVICE_WAIT_SLICE = 2;
+// Idle thread looks for the work of the others at least that often (ms)
+const mfxU32 IDLE_WAIT_INTERVAL = 10;
+} // namespace
+
+CSessionScheduler::CSessionScheduler()
+        : m_workers(),
+          m_nextWorker(0),
+          m_numSignals(0),
+          m_stop(false),
+          m_wakeup() {}
+
+CSessionScheduler::~CSessionScheduler() {
+    Stop();
+}
+
+mfxStatus CSessionScheduler::Start(mfxU32 numThreads) {
+    if (!m_workers.empty())
+        return MFX_ERR_UNDEFINED_BEHAVIOR;
+
+    if (!numThreads)
+        numThreads = std::thread::hardware_concurrency();
+    if (!numThreads)
+        numThreads = 1;
+
+    m_stop.store(false);
+    // all workers exist before the threads start: thieves walk through the array
+    for (mfxU32 i = 0; i < numThreads; i++)
+        m_workers.emplace_back(new Worker);
+    for (mfxU32 i = 0; i < numThreads; i++)
+        m_workers[i]->thread = std::thread(&CSessionScheduler::WorkerRoutine, this, i);
+
+    return MFX_ERR_NONE;
+} // mfxStatus CSessionScheduler::Start(mfxU32 numThreads)
+
+mfxStatus CSessionScheduler::Submit(CSchedulerJob* job, mfxPriority priority) {
+    MSDK_CHECK_POINTER(job, MFX_ERR_NULL_PTR);
+    if (m_workers.empty())
+        return MFX_ERR_NOT_INITIALIZED;
+    if (priority < MFX_PRIORITY_LOW || priority > MFX_PRIORITY_HIGH)
+        return MFX_ERR_UNSUPPORTED;
+
+    Task task = { job, (mfxU32)priority };
+    Push(m_nextWorker.fetch_add(1) % GetNumThreads(), task);
+    Signal();
+
+    return MFX_ERR_NONE;
+} // mfxStatus CSessionScheduler::Submit(CSchedulerJob* job, mfxPriority priority)
+
+void CSessionScheduler::Stop() {
+    m_stop.store(true);
+    Signal();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+    m_workers.clear();
+} // void CSessionScheduler::Stop()
+
+void CSessionScheduler::WorkerRoutine(mfxU32 id) {
+    // turns in a row in which jobs of this thread made no progress
+    size_t numStalled = 0;
+
+    while (!m_stop.load()) {
+        mfxU64 numSignals = m_numSignals.load();
+
+        Task task;
+        if (!Pop(id, task) && !Steal(id, task)) {
+            numStalled = 0;
+            m_wakeup.WaitFor(
+                [this, numSignals] {
+                    return m_stop.load() || m_numSignals.load() != numSignals;
+                },
+                IDLE_WAIT_INTERVAL);
+            continue;
+        }
+
+        // once every job of the thread waits, wait for the device instead of spinning
+        mfxU32 waitMs = (numStalled > GetQueueLength(id)) ? DEVICE_WAIT_SLICE : 0;
+
+        mfxStatus sts = MFX_ERR_NONE;
+        bool progress = false;
+        for (mfxU32 i = 0; i < STEP_QUANTUM[task.priority]; i++) {
+            sts = task.job->RunStep(waitMs);
+            if (MFX_ERR_NONE != sts)
+                break;
+            progress = true;
+        }
+
+        if (MFX_ERR_NONE == sts || MFX_TASK_WORKING == sts) {
+            numStalled = progress ? 0 : numStalled + 1;
+            // the thread takes its only job again, others are worth stealing
+            if (Push(id, task) > 1)
+                Signal();
+            continue;
+        }
+
+        numStalled = 0;
+        task.job->OnComplete(sts);
+    }
+} // void CSessionScheduler::WorkerRoutine(mfxU32 id)
+
+size_t CSessionScheduler::Push(mfxU32 id, const Task& task) {
+    Worker& worker = *m_workers[id];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.queue.push_back(task);
+    return worker.queue.size();
+}
+
+bool CSessionScheduler::Pop(mfxU32 id, Task& task) {
+    Worker& worker = *m_workers[id];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.queue.empty())
+        return false;
+
+    task = worker.queue.front();
+    worker.queue.pop_front();
+    return true;
+}
+
+// Takes the job of the highest priority closest to the end of the queue of another
+// thread: the owner is going to run the jobs at the front first.
+bool CSessionScheduler::Steal(mfxU32 id, Task& task) {
+    mfxU32 numWorkers = GetNumThreads();
+    for (mfxU32 i = 1; i < numWorkers; i++) {
+        Worker& victim = *m_workers[(id + i) % numWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.queue.empty())
+            continue;
+
+        auto best = victim.queue.rbegin();
+        for (auto it = victim.queue.rbegin(); it != victim.queue.rend(); ++it) {
+            if (it->priority > best->priority)
+                best = it;
+        }
+        task = *best;
+        victim.queue.erase(std::next(best).base());
+        return true;
+    }
+    return false;
+} // bool CSessionScheduler::Steal(mfxU32 id, Task& task)
+
+size_t CSessionScheduler::GetQueueLength(mfxU32 id) {
+    Worker& worker = *m_workers[id];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    return worker.queue.size();
+}
+
+void CSessionScheduler::Signal() {
+    m_numSignals.fetch_add(1);
+    m_wakeup.Notify();
+}
+
+void CSessionCompletionQueue::Push(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_indexes.push_back(index);
+    }
+    m_cv.notify_one();
+}
+
+bool CSessionCompletionQueue::Pop(size_t& index, mfxU32 msec) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_cv.wait_for(lock, std::chrono::milliseconds(msec), [this] {
+            return !m_indexes.empty();
+        }))
+        return false;
+
+    index = m_indexes.front();
+    m_indexes.pop_front();
+    return true;
+}
+
+} // namespace TranscodingSample
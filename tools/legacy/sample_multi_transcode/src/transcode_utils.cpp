@@ -126,6 +126,51 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING("  -greedy \n"));
     msdk_printf(
         MSDK_STRING("                Use greedy formula to calculate number of surfaces\n"));
+    msdk_printf(MSDK_STRING("  -sched <threads>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Run sessions in steps on a pool of work-stealing threads instead of\n"));
+    msdk_printf(MSDK_STRING(
+        "                a thread per session, 0 - one thread per logical processor.\n"));
+    msdk_printf(MSDK_STRING(
+        "                Session -priority sets its share of the threads. Only for sessions\n"));
+    msdk_printf(MSDK_STRING("                which decode and encode.\n"));
+    msdk_printf(MSDK_STRING("  -control <file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Take commands appended to the file while sessions run, a command per\n"));
+    msdk_printf(MSDK_STRING(
+        "                line: add <session options>, stop <session>, restart <session>\n"));
+    msdk_printf(MSDK_STRING(
+        "                [session options], quit. Added sessions decode and encode, they\n"));
+    msdk_printf(MSDK_STRING(
+        "                share the device of the first session. The launcher runs until quit.\n"));
+    msdk_printf(MSDK_STRING("  -calibrate <file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Run the sessions one by one as fast as possible and store their\n"));
+    msdk_printf(MSDK_STRING(
+        "                throughput per codecs, resolution and target usage in the profile.\n"));
+    msdk_printf(MSDK_STRING("                Only for sessions which decode and encode.\n"));
+    msdk_printf(MSDK_STRING("  -capacity <file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Admit real-time (-fps) sessions of the par file and added ones while\n"));
+    msdk_printf(MSDK_STRING(
+        "                the calibrated profile says the device sustains them. A session which\n"));
+    msdk_printf(MSDK_STRING(
+        "                doesn't fit gets a faster target usage or is rejected. Frames missing\n"));
+    msdk_printf(
+        MSDK_STRING("                their deadlines are stored in the profile at exit.\n"));
+    msdk_printf(MSDK_STRING("  -capacity_load <percent>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Share of the device real-time sessions may take, default is 90\n"));
+    msdk_printf(MSDK_STRING("  -openmetrics <file-name>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Periodically replace the file with OpenMetrics text: fps, stage\n"));
+    msdk_printf(MSDK_STRING(
+        "                latency histograms, surface pools, queue depths and errors\n"));
+    msdk_printf(MSDK_STRING("  -openmetrics_port <port>\n"));
+    msdk_printf(MSDK_STRING(
+        "                Serve the metrics over HTTP on the port of 127.0.0.1 (not on Windows)\n"));
+    msdk_printf(MSDK_STRING("  -openmetrics_interval <ms>\n"));
+    msdk_printf(MSDK_STRING("                Period of the metrics, default is 1000\n"));
     msdk_printf(MSDK_STRING("\n"));
     msdk_printf(MSDK_STRING("Pipeline description (general options):\n"));
     msdk_printf(MSDK_STRING("  -i::h265|h264|mpeg2|vc1|mvc|jpeg|vp9|av1 <file-name>\n"));
@@ -212,6 +257,31 @@ void TranscodingSample::PrintHelp() {
     msdk_printf(MSDK_STRING(
         "  -robust       Recover from gpu hang errors as they come (by resetting components)\n"));
     msdk_printf(MSDK_STRING("  -robust:soft  Recover from gpu hang errors by inserting an IDR\n"));
+    msdk_printf(MSDK_STRING("  -async_write  Write output file from a dedicated I/O thread\n"));
+    msdk_printf(MSDK_STRING(
+        "  -direct_write Same as -async_write, bypass page cache (O_DIRECT) if supported\n"));
+    msdk_printf(MSDK_STRING(
+        "  -read_batch <n> Read n frames of raw input at once with a single large read\n"));
+    msdk_printf(MSDK_STRING(
+        "  -frame_range <first> <count> Transcode count frames (0 - till the end) starting from\n"
+        "                the key frame at or before frame first (in decode order), for H.264,\n"
+        "                H.265 and IVF input. Parameter sets have to precede the key frames\n"));
+    msdk_printf(MSDK_STRING(
+        "  -persist_index With -frame_range keep the index of the input frames in <input>.idx\n"
+        "                and reuse it in the next runs\n"));
+    msdk_printf(MSDK_STRING(
+        "  -sysmem_opt <list> Placement of system memory frames, list is comma separated\n"
+        "                align64,align4k,slab,thp,hugetlb,numa\n"));
+    msdk_printf(MSDK_STRING(
+        "  -cpus <list>  Run threads of the session, including its I/O threads, on the listed\n"
+        "                logical processors, like 0-7,16-23\n"));
+    msdk_printf(MSDK_STRING(
+        "  -numa <node|auto> Place threads and system memory frames of the session on the NUMA\n"
+        "                node, auto spreads sessions evenly across the nodes. Threads run on\n"
+        "                all processors of the node unless -cpus is set\n"));
+    msdk_printf(MSDK_STRING(
+        "  -metrics <list> Measure quality of the output against the encoder input,\n"
+        "                list is comma separated psnr,ssim,msssim or all\n"));
 
     msdk_printf(MSDK_STRING("  -async        Depth of asynchronous pipeline. default value 1\n"));
     msdk_printf(MSDK_STRING(
@@ -571,11 +641,20 @@ CmdProcessor::CmdProcessor() {
     m_encoderPlugins.clear();
     m_PerfFILE           = NULL;
     m_parName            = NULL;
+    m_controlName        = NULL;
+    m_calibrationName    = NULL;
+    m_capacityName       = NULL;
+    m_capacityLoad       = 0;
+    m_metricsName        = NULL;
+    m_metricsPort        = 0;
+    m_metricsInterval    = 0;
     m_nTimeout           = 0;
     statisticsWindowSize = 0;
     statisticsLogFile    = NULL;
     DumpLogFileName.clear();
     shouldUseGreedyFormula = false;
+    bUseScheduler          = false;
+    nSchedThreads          = 0;
     bRobustFlag            = false;
     bSoftRobustFlag        = false;
 
@@ -604,6 +683,34 @@ msdk_string CmdProcessor::GetLine(mfxU32 n) {
     return msdk_string();
 }
 
+void CmdProcessor::SetLine(mfxU32 n, const msdk_string& line) {
+    if (m_lines.size() <= n)
+        m_lines.resize(n + 1);
+    m_lines[n] = line;
+}
+
+mfxStatus CmdProcessor::ParseSessionLine(const msdk_string& line,
+                                         TranscodingSample::sInputParams& params) {
+    size_t numSessions = m_SessionArray.size();
+    size_t numLines    = m_lines.size();
+
+    std::vector<msdk_char> buffer(line.begin(), line.end());
+    buffer.push_back(0);
+    mfxStatus sts = TokenizeLine(buffer.data(), (mfxU32)line.size());
+
+    // line of options which don't make a session, like -set
+    if (MFX_ERR_NONE == sts && m_SessionArray.size() == numSessions)
+        sts = MFX_ERR_UNSUPPORTED;
+    if (MFX_ERR_NONE == sts)
+        params = m_SessionArray.back();
+
+    m_SessionArray.resize(numSessions);
+    m_lines.resize(numLines);
+    if (m_SessionParamId > numSessions)
+        m_SessionParamId = (mfxU32)numSessions;
+    return sts;
+} //mfxStatus CmdProcessor::ParseSessionLine(const msdk_string& line, sInputParams& params)
+
 mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
     FILE* parFile = NULL;
     mfxStatus sts = MFX_ERR_UNSUPPORTED;
@@ -636,6 +743,81 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
                 return MFX_ERR_UNSUPPORTED;
             }
         }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-control"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-control' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_controlName = argv[0];
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-calibrate"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-calibrate' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_calibrationName = argv[0];
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-capacity"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-capacity' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_capacityName = argv[0];
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-capacity_load"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-capacity_load' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_capacityLoad) || !m_capacityLoad ||
+                m_capacityLoad > 100) {
+                msdk_printf(MSDK_STRING("error: -capacity_load \"%s\" is invalid"), argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-openmetrics"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-openmetrics' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            m_metricsName = argv[0];
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-openmetrics_port"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(
+                    MSDK_STRING("error: no argument given for '-openmetrics_port' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_metricsPort) || !m_metricsPort) {
+                msdk_printf(MSDK_STRING("error: -openmetrics_port \"%s\" is invalid"), argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-openmetrics_interval"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(
+                    MSDK_STRING("error: no argument given for '-openmetrics_interval' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], m_metricsInterval) || !m_metricsInterval) {
+                msdk_printf(MSDK_STRING("error: -openmetrics_interval \"%s\" is invalid"), argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-robust"))) {
             bRobustFlag = true;
         }
@@ -649,6 +831,19 @@ mfxStatus CmdProcessor::ParseCmdLine(int argc, msdk_char* argv[]) {
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-greedy"))) {
             shouldUseGreedyFormula = true;
         }
+        else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-sched"))) {
+            --argc;
+            ++argv;
+            if (!argv[0]) {
+                msdk_printf(MSDK_STRING("error: no argument given for '-sched' option\n"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            if (MFX_ERR_NONE != msdk_opt_read(argv[0], nSchedThreads)) {
+                msdk_printf(MSDK_STRING("error: -sched \"%s\" is invalid"), argv[0]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+            bUseScheduler = true;
+        }
         else if (0 == msdk_strcmp(argv[0], MSDK_STRING("-p"))) {
             if (m_PerfFILE) {
                 msdk_printf(MSDK_STRING("error: only one performance file is supported"));
@@ -1611,6 +1806,8 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
         InputParams.bSoftRobustFlag = true;
 
     InputParams.shouldUseGreedyFormula = shouldUseGreedyFormula;
+    InputParams.bUseScheduler          = bUseScheduler;
+    InputParams.nSchedThreads          = nSchedThreads;
 
     InputParams.statisticsWindowSize = statisticsWindowSize;
     InputParams.statisticsLogFile    = statisticsLogFile;
@@ -1770,6 +1967,66 @@ mfxStatus CmdProcessor::ParseParamsForOneSession(mfxU32 argc, msdk_char* argv[])
         else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-robust:soft"))) {
             InputParams.bSoftRobustFlag = true;
         }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-async_write"))) {
+            InputParams.bAsyncWrite = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-direct_write"))) {
+            InputParams.bAsyncWrite = true;
+            InputParams.bDirectIO   = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-read_batch"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nReadBatch)) {
+                PrintError(MSDK_STRING("Read batch size is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-frame_range"))) {
+            VAL_CHECK(i + 2 >= argc, i, argv[i]);
+            if (MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nRangeFirst) ||
+                MFX_ERR_NONE != msdk_opt_read(argv[++i], InputParams.nRangeCount)) {
+                PrintError(MSDK_STRING("Frame range is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+            InputParams.bFrameRange = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-persist_index"))) {
+            InputParams.bPersistIndex = true;
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-sysmem_opt"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            InputParams.nSysMemOptions = ParseSysMemAllocatorOptions(argv[++i]);
+            if (!InputParams.nSysMemOptions) {
+                PrintError(MSDK_STRING("System memory options are invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-cpus"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            if (MFX_ERR_NONE != msdk_parse_cpu_list(argv[++i], InputParams.cpuSet)) {
+                PrintError(MSDK_STRING("List of processors \"%s\" is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-numa"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            if (0 == msdk_strcmp(argv[++i], MSDK_STRING("auto"))) {
+                InputParams.nNumaNode = NUMA_NODE_AUTO;
+            }
+            else if (MFX_ERR_NONE != msdk_opt_read(argv[i], InputParams.nNumaNode) ||
+                     InputParams.nNumaNode < 0) {
+                PrintError(MSDK_STRING("NUMA node \"%s\" is invalid"), argv[i]);
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
+        else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-metrics"))) {
+            VAL_CHECK(i + 1 == argc, i, argv[i]);
+            InputParams.nQualityMetrics = ParseQualityMetrics(argv[++i]);
+            if (!InputParams.nQualityMetrics) {
+                PrintError(MSDK_STRING("Metrics list is invalid"));
+                return MFX_ERR_UNSUPPORTED;
+            }
+        }
         else if (0 == msdk_strcmp(argv[i], MSDK_STRING("-threads"))) {
             VAL_CHECK(i + 1 == argc, i, argv[i]);
             i++;
@@ -23,6 +23,8 @@ enum { NOT_INIT_VALUE = 0xFFF7 };
 
     #define MULTI_VIEW_COUNT_MAX (1024)
     #define MAX_INPUT_STREAMS    64
+    // Minimal number of perf mode surfaces kept in memory when input can't be mapped
+    #define PERF_READ_AHEAD_FRAMES 16
 
 typedef enum {
     VPP_FILTER_DISABLED           = 0,
@@ -49,6 +49,7 @@
     #endif
 
     #include "base_allocator.h"
+    #include "raw_file_mapping.h"
     #include "sample_vpp_config.h"
     #include "sample_vpp_roi.h"
 
@@ -194,6 +195,7 @@ struct sInputParams {
     bool bPartialAccel;
 
     bool bPerf;
+    bool bPerfMmap; // perf mode surfaces point to the memory mapped input
     mfxU32 numFrames;
     mfxU16 numRepeat;
     bool isOutput;
@@ -301,6 +303,7 @@ struct sInputParams {
 
         bInitEx     = false;
         bPerf       = false;
+        bPerfMmap   = false;
         need_plugin = false;
         use_extapi  = false;
         MSDK_ZERO_MEMORY(strPlgGuid);
@@ -420,13 +423,24 @@ public:
 
 private:
     mfxStatus GetPreAllocFrame(mfxFrameSurfaceWrap** pSurface);
+    // Loads the next frame of the perf mode sequence to the read-ahead window surface
+    mfxStatus ReloadPreAllocFrame(mfxFrameSurfaceWrap* pSurface);
 
     FILE* m_fSrc;
+    msdk_string m_fileName;
     std::list<mfxFrameSurfaceWrap>::iterator m_it;
     std::list<mfxFrameSurfaceWrap> m_SurfacesList;
     bool m_isPerfMode;
     mfxU16 m_Repeat;
 
+    CRawFileMapping m_mapping; // perf mode input when surfaces point to the file
+    bool m_isReadAhead; // perf mode surfaces are a window reloaded during the run
+    MFXFrameAllocator* m_pAllocator; // allocator of the read-ahead window surfaces
+    mfxU32 m_numPerfFrames; // number of frames repeated in perf mode
+    mfxU32 m_servedFrames; // frames returned in the current pass
+    mfxU32 m_nextFrame; // index of the next frame to load to the window
+    mfxU64 m_totalServed;
+
     PTSMaker* m_pPTSMaker;
     mfxU32 m_initFcc;
 };
@@ -382,6 +382,8 @@ void vppPrintHelp(const msdk_char* strAppName, const msdk_char* strErrorMessage)
         MSDK_STRING("   [-async n] - maximum number of asynchronious tasks. def: -async 1 \n"));
     msdk_printf(MSDK_STRING(
         "   [-perf_opt n m] - n: number of prefetech frames. m : number of passes. In performance mode app preallocates bufer and load first n frames,  def: no performace 1 \n"));
+    msdk_printf(MSDK_STRING(
+        "   [-perf_mmap] - with -perf_opt system memory surfaces point to the memory mapped input file instead of preloaded frames. If input layout differs from the surface one, only a window of frames is kept in memory\n"));
     msdk_printf(MSDK_STRING("   [-pts_check] - checking of time stampls. Default is OFF \n"));
     msdk_printf(MSDK_STRING(
         "   [-pts_jump ] - checking of time stamps jumps. Jump for random value since 13-th frame. Also, you can change input frame rate (via pts). Default frame_rate = sf \n"));
@@ -1904,6 +1906,9 @@ mfxStatus vppParseInputString(msdk_char* strInput[],
                 i++;
                 msdk_sscanf(strInput[i], MSDK_STRING("%hu"), &pParams->numRepeat);
             }
+            else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-perf_mmap"))) {
+                pParams->bPerfMmap = true;
+            }
             else if (0 == msdk_strcmp(strInput[i], MSDK_STRING("-pts_check"))) {
                 pParams->ptsCheck = true;
             }
@@ -1109,12 +1109,18 @@ void WipeParams(sInputParams* pParams) {
 
 /* ******************************************************************* */
 
-CRawVideoReader::CRawVideoReader() : m_it(), m_SurfacesList() {
-    m_fSrc       = 0;
-    m_isPerfMode = false;
-    m_Repeat     = 0;
-    m_pPTSMaker  = 0;
-    m_initFcc    = 0;
+CRawVideoReader::CRawVideoReader() : m_fileName(), m_it(), m_SurfacesList(), m_mapping() {
+    m_fSrc          = 0;
+    m_isPerfMode    = false;
+    m_Repeat        = 0;
+    m_isReadAhead   = false;
+    m_pAllocator    = 0;
+    m_numPerfFrames = 0;
+    m_servedFrames  = 0;
+    m_nextFrame     = 0;
+    m_totalServed   = 0;
+    m_pPTSMaker     = 0;
+    m_initFcc       = 0;
 }
 
 mfxStatus CRawVideoReader::Init(const msdk_char* strFileName, PTSMaker* pPTSMaker, mfxU32 fcc) {
@@ -1125,6 +1131,7 @@ mfxStatus CRawVideoReader::Init(const msdk_char* strFileName, PTSMaker* pPTSMake
     MSDK_FOPEN(m_fSrc, strFileName, MSDK_STRING("rb"));
     MSDK_CHECK_POINTER(m_fSrc, MFX_ERR_ABORTED);
 
+    m_fileName  = strFileName;
     m_pPTSMaker = pPTSMaker;
     m_initFcc   = fcc;
     return MFX_ERR_NONE;
@@ -1140,6 +1147,8 @@ void CRawVideoReader::Close() {
         m_fSrc = 0;
     }
     m_SurfacesList.clear();
+    m_mapping.Close();
+    m_isReadAhead = false;
 }
 
 mfxStatus CRawVideoReader::LoadNextFrame2(mfxFrameSurface1* pSurface,
@@ -1731,22 +1740,51 @@ mfxStatus CRawVideoReader::GetNextInputFrame2(sFrameProcessor* pProcessor,
 #endif
 
 mfxStatus CRawVideoReader::GetPreAllocFrame(mfxFrameSurfaceWrap** pSurface) {
-    if (m_it == m_SurfacesList.end()) {
-        m_Repeat--;
+    if (m_it == m_SurfacesList.end())
         m_it = m_SurfacesList.begin();
+
+    if (m_servedFrames == m_numPerfFrames) {
+        m_Repeat--;
+        m_servedFrames = 0;
     }
 
     if (m_it->Data.Locked)
         return MFX_ERR_ABORTED;
 
+    // All window surfaces were used once, so the next frame replaces the oldest one
+    if (m_isReadAhead && m_totalServed >= m_SurfacesList.size()) {
+        mfxStatus sts = ReloadPreAllocFrame(&(*m_it));
+        MFX_CHECK_STS(sts);
+    }
+
     *pSurface = &(*m_it);
     m_it++;
+    m_servedFrames++;
+    m_totalServed++;
     if (0 == m_Repeat)
         return MFX_ERR_MORE_DATA;
 
     return MFX_ERR_NONE;
 }
 
+mfxStatus CRawVideoReader::ReloadPreAllocFrame(mfxFrameSurfaceWrap* pSurface) {
+    if (m_nextFrame == m_numPerfFrames) {
+        if (fseek(m_fSrc, 0, SEEK_SET))
+            return MFX_ERR_MORE_DATA;
+        m_nextFrame = 0;
+    }
+
+    mfxStatus sts = m_pAllocator->Lock(m_pAllocator->pthis, pSurface->Data.MemId, &pSurface->Data);
+    MFX_CHECK_STS(sts);
+    sts = LoadNextFrame(&pSurface->Data, &pSurface->Info);
+    MFX_CHECK_STS(sts);
+    sts = m_pAllocator->Unlock(m_pAllocator->pthis, pSurface->Data.MemId, &pSurface->Data);
+    MFX_CHECK_STS(sts);
+
+    m_nextFrame++;
+    return MFX_ERR_NONE;
+}
+
 mfxStatus CRawVideoReader::PreAllocateFrameChunk(mfxVideoParam* pVideoParam,
                                                  sInputParams* pParams,
                                                  MFXFrameAllocator* pAllocator) {
@@ -1754,18 +1792,56 @@ mfxStatus CRawVideoReader::PreAllocateFrameChunk(mfxVideoParam* pVideoParam,
     mfxFrameAllocRequest request;
     mfxFrameAllocResponse response;
     mfxFrameSurfaceWrap surface;
-    m_isPerfMode = true;
-    m_Repeat     = pParams->numRepeat;
+    m_isPerfMode    = true;
+    m_Repeat        = pParams->numRepeat;
+    m_numPerfFrames = pParams->numFrames;
+    m_servedFrames  = 0;
+    m_totalServed   = 0;
+    m_isReadAhead   = false;
+
+    mfxU32 numSurfaces = pParams->numFrames;
+    if (pParams->bPerfMmap) {
+        mfxFrameInfo& info = pVideoParam->vpp.In;
+        // Surfaces point to the file directly if it has the layout of the system memory surface
+        if (!(pParams->IOPattern & MFX_IOPATTERN_IN_VIDEO_MEMORY) && info.FourCC == m_initFcc &&
+            CRawFileMapping::GetFrameSize(info) &&
+            m_mapping.Open(m_fileName.c_str()) == MFX_ERR_NONE &&
+            m_mapping.GetFrameCount(info) >= pParams->numFrames) {
+            for (mfxU32 i = 0; i < pParams->numFrames; i++) {
+                MSDK_ZERO_MEMORY(surface.Data);
+                surface.Info = info;
+                memset(surface.reserved, 0, sizeof(surface.reserved));
+                sts = m_mapping.MapFrame(i, info, surface.Data);
+                MFX_CHECK_STS(sts);
+                m_SurfacesList.push_back(surface);
+            }
+            m_it = m_SurfacesList.begin();
+            return MFX_ERR_NONE;
+        }
+        m_mapping.Close();
+
+        // Otherwise only a window of frames is kept in memory and reloaded during the run
+        mfxU32 windowSize = std::max<mfxU32>(PERF_READ_AHEAD_FRAMES, 2 * pParams->asyncNum);
+        if (numSurfaces > windowSize) {
+            numSurfaces   = windowSize;
+            m_isReadAhead = true;
+            m_pAllocator  = pAllocator;
+            msdk_printf(MSDK_STRING("Input can't be memory mapped, using read-ahead window of %u "
+                                    "frames\n"),
+                        numSurfaces);
+        }
+    }
+
     request.Info = pVideoParam->vpp.In;
     request.Type =
         (pParams->IOPattern & MFX_IOPATTERN_IN_VIDEO_MEMORY)
             ? (MFX_MEMTYPE_FROM_VPPIN | MFX_MEMTYPE_INTERNAL_FRAME |
                MFX_MEMTYPE_DXVA2_PROCESSOR_TARGET)
             : (MFX_MEMTYPE_FROM_VPPIN | MFX_MEMTYPE_INTERNAL_FRAME | MFX_MEMTYPE_SYSTEM_MEMORY);
-    request.NumFrameSuggested = request.NumFrameMin = (mfxU16)pParams->numFrames;
+    request.NumFrameSuggested = request.NumFrameMin = (mfxU16)numSurfaces;
     sts = pAllocator->Alloc(pAllocator, &request, &response);
     MFX_CHECK_STS(sts);
-    for (; m_SurfacesList.size() < pParams->numFrames;) {
+    for (; m_SurfacesList.size() < numSurfaces;) {
         surface.Data.Locked = 0;
         surface.Data.MemId  = response.mids[m_SurfacesList.size()];
         surface.Info        = pVideoParam->vpp.In;
@@ -1778,7 +1854,8 @@ mfxStatus CRawVideoReader::PreAllocateFrameChunk(mfxVideoParam* pVideoParam,
         MFX_CHECK_STS(sts);
         m_SurfacesList.push_back(surface);
     }
-    m_it = m_SurfacesList.begin();
+    m_nextFrame = numSurfaces;
+    m_it        = m_SurfacesList.begin();
     return MFX_ERR_NONE;
 }
 /* ******************************************************************* */